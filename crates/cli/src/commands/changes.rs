@@ -0,0 +1,160 @@
+//! Change feed command.
+
+use std::time::Duration;
+
+use clap::Args;
+use serde_json::json;
+use sentinel_dbms::futures::StreamExt as _;
+use tracing::{debug, info};
+
+/// Arguments for the changes command.
+#[derive(Args, Clone)]
+pub struct ChangesArgs {
+    /// Path to the Sentinel store
+    #[arg(short, long)]
+    pub store:       String,
+    /// Cursor to resume from, as collection:lsn pairs separated by commas (default: the first
+    /// retained change of every collection)
+    #[arg(long, default_value = "")]
+    pub since:       String,
+    /// Only read the changes of this collection (can be given multiple times)
+    #[arg(short, long = "collection")]
+    pub collections: Vec<String>,
+    /// Maximum number of changes per batch
+    #[arg(long, default_value_t = sentinel_dbms::CHANGE_FEED_BATCH_SIZE)]
+    pub batch_size:  usize,
+    /// Keep polling for new changes instead of exiting once caught up
+    #[arg(short, long)]
+    pub follow:      bool,
+    /// Time to wait between polls in follow mode, in milliseconds
+    #[arg(long, default_value_t = 1000)]
+    pub interval_ms: u64,
+}
+
+/// Print the committed changes of a store since a cursor.
+///
+/// Each batch is printed as one JSON line holding the collection, its changes in commit order and
+/// the cursor to pass to `--since` once the batch has been applied. Delivery is at least once, so
+/// a batch may repeat changes of an earlier one when a transaction was still open.
+///
+/// # Arguments
+/// * `args` - The parsed command-line arguments for changes.
+///
+/// # Returns
+/// Returns `Ok(())` once caught up, or a `SentinelError` if the cursor is invalid, a collection
+/// does not exist or its changes are no longer retained.
+///
+/// # Examples
+/// ```rust,no_run
+/// use sentinel_cli::commands::changes::{run, ChangesArgs};
+///
+/// let args = ChangesArgs {
+///     store:       String::from("/tmp/my_store"),
+///     since:       String::from("users:42"),
+///     collections: vec![String::from("users")],
+///     batch_size:  256,
+///     follow:      false,
+///     interval_ms: 1000,
+/// };
+/// run(args).await?;
+/// ```
+pub async fn run(args: ChangesArgs) -> sentinel_dbms::Result<()> {
+    use sentinel_dbms::wal::ops::StoreWalOps as _;
+
+    let mut cursor: sentinel_dbms::ChangeCursor = args.since.parse()?;
+    let options = sentinel_dbms::ChangeFeedOptions {
+        collections: (!args.collections.is_empty()).then(|| args.collections.clone()),
+        batch_size:  args.batch_size,
+    };
+    let store =
+        sentinel_dbms::Store::new_with_config(&args.store, None, sentinel_dbms::StoreWalConfig::default()).await?;
+    info!("Reading changes of store {} since '{}'", args.store, cursor);
+
+    loop {
+        let mut batches = store.changes_since(&cursor, &options).await?;
+        while let Some(batch) = batches.next().await {
+            let batch = batch?;
+            cursor = batch.cursor;
+            let line = json!({
+                "collection": batch.collection,
+                "cursor": cursor.to_string(),
+                "changes": batch.changes,
+            });
+            #[allow(clippy::print_stdout, reason = "CLI output")]
+            {
+                println!("{}", serde_json::to_string(&line)?);
+            }
+        }
+        if !args.follow {
+            break;
+        }
+        debug!("Caught up at '{}', polling again", cursor);
+        tokio::time::sleep(Duration::from_millis(args.interval_ms)).await;
+    }
+
+    info!("Caught up, resume with --since '{}'", cursor);
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use tempfile::TempDir;
+
+    use super::*;
+
+    /// Arguments reading every change of the store at `store`
+    fn args(store: &str) -> ChangesArgs {
+        ChangesArgs {
+            store:       store.to_owned(),
+            since:       String::new(),
+            collections: Vec::new(),
+            batch_size:  2,
+            follow:      false,
+            interval_ms: 10,
+        }
+    }
+
+    #[tokio::test]
+    async fn test_changes_command_reads_collections() {
+        let temp_dir = TempDir::new().unwrap();
+        let store_path = temp_dir.path().to_string_lossy().to_string();
+        let store = sentinel_dbms::Store::new_with_config(&store_path, None, sentinel_dbms::StoreWalConfig::default())
+            .await
+            .unwrap();
+        let collection = store.collection_with_config("users", None).await.unwrap();
+        for i in 0 .. 3 {
+            collection
+                .insert(&format!("user-{}", i), serde_json::json!({"i": i}))
+                .await
+                .unwrap();
+        }
+
+        assert!(run(args(&store_path)).await.is_ok());
+        assert!(run(ChangesArgs {
+            since: String::from("users:2"),
+            collections: vec![String::from("users")],
+            ..args(&store_path)
+        })
+        .await
+        .is_ok());
+    }
+
+    #[tokio::test]
+    async fn test_changes_command_rejects_invalid_input() {
+        let temp_dir = TempDir::new().unwrap();
+        let store_path = temp_dir.path().to_string_lossy().to_string();
+
+        assert!(run(ChangesArgs {
+            since: String::from("users"),
+            ..args(&store_path)
+        })
+        .await
+        .is_err());
+        assert!(run(ChangesArgs {
+            collections: vec![String::from("missing")],
+            ..args(&store_path)
+        })
+        .await
+        .is_err());
+    }
+}
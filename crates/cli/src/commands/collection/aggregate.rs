@@ -1,13 +1,19 @@
 use clap::Args;
-use sentinel_dbms::{Aggregation, Filter};
+use sentinel_dbms::{Aggregation, AggregationPipeline, Filter};
 use serde_json::Value;
 
 /// Arguments for collection aggregate command.
 #[derive(Args)]
 pub struct AggregateArgs {
-    /// Aggregation operation: count, sum:field, avg:field, min:field, max:field
-    #[arg(short, long)]
-    pub aggregation: String,
+    /// Aggregation operation: count, sum:field, avg:field, min:field, max:field, distinct:field,
+    /// or pN:field for the Nth percentile (can be used multiple times; all are computed in one
+    /// scan)
+    #[arg(short, long, required = true)]
+    pub aggregation: Vec<String>,
+
+    /// Group documents by the values of a top-level field (can be used multiple times)
+    #[arg(long = "group-by", value_name = "FIELD")]
+    pub group_by: Vec<String>,
 
     /// Filter documents (can be used multiple times)
     /// Syntax: field=value, field>value, field<value, field>=value, field<=value,
@@ -22,7 +28,9 @@ pub struct AggregateArgs {
 
 /// Execute collection aggregate command.
 ///
-/// Performs aggregation operations on documents in the specified collection.
+/// Performs aggregation operations on documents in the specified collection. A single
+/// aggregation without grouping prints its value; otherwise one JSON object is printed per group,
+/// holding the group fields and the result of every aggregation, named as in `sum_amount`.
 ///
 /// # Arguments
 /// * `store_path` - Path to the Sentinel store
@@ -39,8 +47,13 @@ pub async fn run(
     passphrase: Option<String>,
     args: AggregateArgs,
 ) -> sentinel_dbms::Result<()> {
-    // Parse aggregation
-    let aggregation = parse_aggregation(&args.aggregation)?;
+    // Parse aggregations
+    let aggregations = args
+        .aggregation
+        .iter()
+        .map(String::as_str)
+        .map(parse_aggregation)
+        .collect::<sentinel_dbms::Result<Vec<_>>>()?;
 
     // Parse filters
     let filters = parse_filters(&args.filter)?;
@@ -55,7 +68,22 @@ pub async fn run(
         .collection_with_config(&collection_name, Some(args.wal.to_overrides()))
         .await?;
 
-    let result = collection.aggregate(filters, aggregation).await?;
+    let result = if let [ref aggregation] = *aggregations.as_slice() &&
+        args.group_by.is_empty()
+    {
+        collection.aggregate(filters, aggregation.clone()).await?
+    }
+    else {
+        let pipeline = AggregationPipeline {
+            filters,
+            group_by: args.group_by,
+            aggregations: aggregations
+                .into_iter()
+                .map(|aggregation| (aggregation.name(), aggregation))
+                .collect(),
+        };
+        Value::Array(collection.aggregate_pipeline(&pipeline).await?)
+    };
 
     println!("{}", serde_json::to_string_pretty(&result)?);
 
@@ -84,9 +112,21 @@ fn parse_aggregation(spec: &str) -> sentinel_dbms::Result<Aggregation> {
         return Ok(Aggregation::Max(field.to_owned()));
     }
 
+    if let Some(field) = spec.strip_prefix("distinct:") {
+        return Ok(Aggregation::DistinctCount(field.to_owned()));
+    }
+
+    if let Some((percentile, field)) = spec.strip_prefix('p').and_then(|rest| rest.split_once(':')) &&
+        let Ok(percentile) = percentile.parse::<f64>() &&
+        (0.0 ..= 100.0).contains(&percentile)
+    {
+        return Ok(Aggregation::Percentile(field.to_owned(), percentile));
+    }
+
     Err(sentinel_dbms::SentinelError::Internal {
         message: format!(
-            "Invalid aggregation: {}. Use count, sum:field, avg:field, min:field, or max:field",
+            "Invalid aggregation: {}. Use count, sum:field, avg:field, min:field, max:field, distinct:field, or \
+             pN:field",
             spec
         ),
     })
@@ -236,7 +276,8 @@ mod tests {
         tokio::time::sleep(tokio::time::Duration::from_millis(10)).await;
 
         let args = AggregateArgs {
-            aggregation: "count".to_string(),
+            aggregation: vec!["count".to_string()],
+            group_by:    vec![],
             filter:      vec![],
             wal:         crate::commands::WalArgs::default(),
         };
@@ -273,7 +314,8 @@ mod tests {
         tokio::time::sleep(tokio::time::Duration::from_millis(10)).await;
 
         let args = AggregateArgs {
-            aggregation: "count".to_string(),
+            aggregation: vec!["count".to_string()],
+            group_by:    vec![],
             filter:      vec![],
             wal:         crate::commands::WalArgs::default(),
         };
@@ -310,7 +352,8 @@ mod tests {
         tokio::time::sleep(tokio::time::Duration::from_millis(10)).await;
 
         let args = AggregateArgs {
-            aggregation: "sum:score".to_string(),
+            aggregation: vec!["sum:score".to_string()],
+            group_by:    vec![],
             filter:      vec![],
             wal:         crate::commands::WalArgs::default(),
         };
@@ -347,7 +390,8 @@ mod tests {
         tokio::time::sleep(tokio::time::Duration::from_millis(10)).await;
 
         let args = AggregateArgs {
-            aggregation: "avg:score".to_string(),
+            aggregation: vec!["avg:score".to_string()],
+            group_by:    vec![],
             filter:      vec![],
             wal:         crate::commands::WalArgs::default(),
         };
@@ -384,7 +428,8 @@ mod tests {
         tokio::time::sleep(tokio::time::Duration::from_millis(10)).await;
 
         let args = AggregateArgs {
-            aggregation: "min:score".to_string(),
+            aggregation: vec!["min:score".to_string()],
+            group_by:    vec![],
             filter:      vec![],
             wal:         crate::commands::WalArgs::default(),
         };
@@ -421,7 +466,8 @@ mod tests {
         tokio::time::sleep(tokio::time::Duration::from_millis(10)).await;
 
         let args = AggregateArgs {
-            aggregation: "max:score".to_string(),
+            aggregation: vec!["max:score".to_string()],
+            group_by:    vec![],
             filter:      vec![],
             wal:         crate::commands::WalArgs::default(),
         };
@@ -468,7 +514,8 @@ mod tests {
         tokio::time::sleep(tokio::time::Duration::from_millis(10)).await;
 
         let args = AggregateArgs {
-            aggregation: "count".to_string(),
+            aggregation: vec!["count".to_string()],
+            group_by:    vec![],
             filter:      vec!["active=true".to_string()],
             wal:         crate::commands::WalArgs::default(),
         };
@@ -495,7 +542,8 @@ mod tests {
         tokio::time::sleep(tokio::time::Duration::from_millis(10)).await;
 
         let args = AggregateArgs {
-            aggregation: "invalid:operation".to_string(),
+            aggregation: vec!["invalid:operation".to_string()],
+            group_by:    vec![],
             filter:      vec![],
             wal:         crate::commands::WalArgs::default(),
         };
@@ -539,6 +587,57 @@ mod tests {
         assert!(matches!(result.unwrap(), Aggregation::Max(field) if field == "value"));
     }
 
+    #[test]
+    fn test_parse_aggregation_distinct_and_percentile() {
+        assert_eq!(
+            parse_aggregation("distinct:user").unwrap(),
+            Aggregation::DistinctCount("user".to_owned())
+        );
+        assert_eq!(
+            parse_aggregation("p99.9:latency").unwrap(),
+            Aggregation::Percentile("latency".to_owned(), 99.9)
+        );
+        assert!(parse_aggregation("p101:latency").is_err());
+        assert!(parse_aggregation("pfoo:latency").is_err());
+    }
+
+    #[tokio::test]
+    async fn test_aggregate_grouped_pipeline() {
+        let temp_dir = TempDir::new().unwrap();
+        let store_path = temp_dir.path().to_string_lossy().to_string();
+        let collection_name = "test_collection".to_string();
+
+        let store = sentinel_dbms::Store::new_with_config(&store_path, None, sentinel_dbms::StoreWalConfig::default())
+            .await
+            .unwrap();
+        let collection = store
+            .collection_with_config(&collection_name, None)
+            .await
+            .unwrap();
+        collection
+            .insert("doc1", json!({"region": "eu", "amount": 10}))
+            .await
+            .unwrap();
+        collection
+            .insert("doc2", json!({"region": "us", "amount": 20}))
+            .await
+            .unwrap();
+
+        let args = AggregateArgs {
+            aggregation: vec![
+                "count".to_string(),
+                "sum:amount".to_string(),
+                "p50:amount".to_string(),
+            ],
+            group_by:    vec!["region".to_string()],
+            filter:      vec![],
+            wal:         crate::commands::WalArgs::default(),
+        };
+
+        let result = run(store_path, collection_name, None, args).await;
+        assert!(result.is_ok());
+    }
+
     #[test]
     fn test_parse_aggregation_invalid() {
         let result = parse_aggregation("invalid:operation");
@@ -1,24 +1,354 @@
-use tokio::fs;
-use clap::Args;
+use std::{io::SeekFrom, time::Instant};
+
+use clap::{Args, ValueEnum};
 use serde_json::Value;
-use tracing::info;
+use tokio::{
+    fs,
+    io::{AsyncBufRead, AsyncBufReadExt as _, AsyncSeekExt as _, AsyncWriteExt as _, BufReader},
+    sync::mpsc,
+};
+use tracing::{debug, info, warn};
+
+/// Default number of documents parsed and inserted per batch.
+const DEFAULT_CHUNK_SIZE: usize = 1000;
+
+/// Format of the bulk-insert input file.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq, ValueEnum)]
+pub enum InputFormat {
+    /// Detect the format from the first non-whitespace byte: `[` starts a JSON array, anything
+    /// else is read as NDJSON.
+    #[default]
+    Auto,
+    /// A single JSON array of documents.
+    Json,
+    /// One JSON document per line.
+    Ndjson,
+}
 
 /// Arguments for collection bulk-insert command.
 #[derive(Args)]
 pub struct BulkInsertArgs {
-    /// JSON file containing array of documents to insert
+    /// File containing the documents to insert, as a JSON array or as NDJSON
     /// Format: [{"id": "doc1", "data": {...}}, {"id": "doc2", "data": {...}}]
+    /// or one {"id": "doc1", "data": {...}} object per line
     #[arg(short, long)]
     pub file: String,
 
+    /// Format of the input file
+    #[arg(long, value_enum, default_value_t = InputFormat::Auto)]
+    pub format: InputFormat,
+
+    /// Number of documents parsed and inserted per batch
+    #[arg(long, default_value_t = DEFAULT_CHUNK_SIZE)]
+    pub chunk_size: usize,
+
+    /// File recording the input offset after every inserted batch
+    #[arg(long)]
+    pub checkpoint: Option<String>,
+
+    /// Resume from the offset recorded in the checkpoint file
+    #[arg(long, requires = "checkpoint")]
+    pub resume: bool,
+
     /// WAL configuration options for this collection
     #[command(flatten)]
     pub wal: crate::commands::WalArgs,
 }
 
+/// A batch of parsed documents together with the input offset right after the last one.
+struct Batch {
+    /// The documents of the batch as (id, data) pairs.
+    documents: Vec<(String, Value)>,
+    /// Offset in the input file just past the last document of the batch.
+    offset:    u64,
+}
+
+/// Builds the error returned for malformed bulk-insert input.
+fn invalid_input(message: &str) -> sentinel_dbms::SentinelError {
+    sentinel_dbms::SentinelError::Internal {
+        message: message.to_owned(),
+    }
+}
+
+/// Splits a parsed input document into its ID and data.
+fn parse_document(value: Value) -> sentinel_dbms::Result<(String, Value)> {
+    let Value::Object(mut object) = value
+    else {
+        return Err(invalid_input("Each document must be an object"));
+    };
+
+    let Some(Value::String(id)) = object.remove("id")
+    else {
+        return Err(invalid_input(
+            "Each document must have an 'id' field with a string value",
+        ));
+    };
+
+    let data = object
+        .remove("data")
+        .ok_or_else(|| invalid_input("Each document must have a 'data' field"))?;
+
+    Ok((id, data))
+}
+
+/// Incremental reader of documents from a JSON array or NDJSON input.
+///
+/// Only the document being parsed is held in memory, so arbitrarily large inputs can be read.
+struct DocumentReader<R> {
+    /// The underlying input.
+    reader:   R,
+    /// The input format, either `Json` or `Ndjson`.
+    format:   InputFormat,
+    /// Offset in the input of the next unread byte.
+    offset:   u64,
+    /// Whether the opening bracket of the JSON array was consumed.
+    in_array: bool,
+    /// Whether the closing bracket of the JSON array was consumed.
+    finished: bool,
+    /// The raw bytes of the document being read.
+    buffer:   Vec<u8>,
+}
+
+impl<R: AsyncBufRead + Unpin> DocumentReader<R> {
+    /// Creates a reader positioned at `offset` of the input.
+    ///
+    /// A non-zero offset must be a checkpoint offset: right after a document of a JSON array, or
+    /// at the start of a line of an NDJSON input.
+    const fn new(reader: R, format: InputFormat, offset: u64) -> Self {
+        Self {
+            reader,
+            format,
+            offset,
+            in_array: offset > 0,
+            finished: false,
+            buffer: Vec::new(),
+        }
+    }
+
+    /// Reads the next document, returning `None` at the end of the input.
+    async fn next_document(&mut self) -> sentinel_dbms::Result<Option<(String, Value)>> {
+        let value = match self.format {
+            InputFormat::Ndjson => self.next_line().await?,
+            InputFormat::Auto | InputFormat::Json => self.next_element().await?,
+        };
+        value.map(parse_document).transpose()
+    }
+
+    /// Reads the next non-empty line of an NDJSON input.
+    async fn next_line(&mut self) -> sentinel_dbms::Result<Option<Value>> {
+        loop {
+            self.buffer.clear();
+            let read = self.reader.read_until(b'\n', &mut self.buffer).await?;
+            if read == 0 {
+                return Ok(None);
+            }
+            self.offset = self.offset.saturating_add(read as u64);
+
+            let line = self.buffer.trim_ascii();
+            if !line.is_empty() {
+                return Ok(Some(serde_json::from_slice(line)?));
+            }
+        }
+    }
+
+    /// Reads the next element of a JSON array input.
+    ///
+    /// Elements are delimited by tracking the nesting depth outside of string literals, and only
+    /// the bytes of the current element are buffered before it is parsed.
+    async fn next_element(&mut self) -> sentinel_dbms::Result<Option<Value>> {
+        if self.finished {
+            return Ok(None);
+        }
+
+        self.buffer.clear();
+        let mut depth = 0_usize;
+        let mut in_string = false;
+        let mut escaped = false;
+        loop {
+            let available = self.reader.fill_buf().await?;
+            if available.is_empty() {
+                return Err(invalid_input(
+                    if self.in_array {
+                        "Unexpected end of the JSON array of documents"
+                    }
+                    else {
+                        "JSON file must contain an array of documents"
+                    },
+                ));
+            }
+
+            let mut consumed = 0_usize;
+            let mut complete = false;
+            for &byte in available {
+                consumed = consumed.saturating_add(1);
+                if depth == 0 {
+                    match byte {
+                        b' ' | b'\t' | b'\n' | b'\r' => {},
+                        b'[' if !self.in_array => self.in_array = true,
+                        b',' if self.in_array => {},
+                        b']' if self.in_array => {
+                            self.finished = true;
+                            complete = true;
+                            break;
+                        },
+                        b'{' if self.in_array => {
+                            depth = 1;
+                            self.buffer.push(byte);
+                        },
+                        _ if self.in_array => return Err(invalid_input("Each document must be an object")),
+                        _ => {
+                            return Err(invalid_input(
+                                "JSON file must contain an array of documents",
+                            ))
+                        },
+                    }
+                    continue;
+                }
+
+                self.buffer.push(byte);
+                if in_string {
+                    if escaped {
+                        escaped = false;
+                    }
+                    else if byte == b'\\' {
+                        escaped = true;
+                    }
+                    else if byte == b'"' {
+                        in_string = false;
+                    }
+                    continue;
+                }
+                match byte {
+                    b'"' => in_string = true,
+                    b'{' | b'[' => depth = depth.saturating_add(1),
+                    b'}' | b']' => {
+                        depth = depth.saturating_sub(1);
+                        if depth == 0 {
+                            complete = true;
+                            break;
+                        }
+                    },
+                    _ => {},
+                }
+            }
+
+            self.reader.consume(consumed);
+            self.offset = self.offset.saturating_add(consumed as u64);
+            if complete {
+                break;
+            }
+        }
+
+        if self.finished {
+            return Ok(None);
+        }
+        Ok(Some(serde_json::from_slice(&self.buffer)?))
+    }
+}
+
+/// Detects the format of the input file from its first non-whitespace byte.
+async fn detect_format(file: &str) -> sentinel_dbms::Result<InputFormat> {
+    let mut reader = BufReader::new(fs::File::open(file).await?);
+    loop {
+        let available = reader.fill_buf().await?;
+        if available.is_empty() {
+            return Ok(InputFormat::Ndjson);
+        }
+        if let Some(&first) = available.iter().find(|byte| !byte.is_ascii_whitespace()) {
+            return Ok(if first == b'[' {
+                InputFormat::Json
+            }
+            else {
+                InputFormat::Ndjson
+            });
+        }
+        let len = available.len();
+        reader.consume(len);
+    }
+}
+
+/// Reads the offset recorded in a checkpoint file, starting from the beginning if there is none.
+async fn read_checkpoint(checkpoint: &str) -> sentinel_dbms::Result<u64> {
+    match fs::read_to_string(checkpoint).await {
+        Ok(content) => {
+            content.trim().parse().map_err(|e| {
+                sentinel_dbms::SentinelError::Internal {
+                    message: format!("Invalid checkpoint file {}: {}", checkpoint, e),
+                }
+            })
+        },
+        Err(e) if e.kind() == std::io::ErrorKind::NotFound => {
+            warn!(
+                "Checkpoint file {} not found, starting from the beginning",
+                checkpoint
+            );
+            Ok(0)
+        },
+        Err(e) => Err(e.into()),
+    }
+}
+
+/// Records `offset` in a checkpoint file.
+///
+/// The offset is written to a temporary file next to it and renamed over it, so a crash leaves
+/// either the previous offset or the new one, never a truncated number.
+async fn write_checkpoint(checkpoint: &str, offset: u64) -> sentinel_dbms::Result<()> {
+    let tmp_path = format!("{}.tmp", checkpoint);
+    let mut file = fs::File::create(&tmp_path).await?;
+    file.write_all(offset.to_string().as_bytes()).await?;
+    file.sync_all().await?;
+    drop(file);
+    fs::rename(&tmp_path, checkpoint).await?;
+    Ok(())
+}
+
+/// Parses the input in batches of `chunk_size` documents and sends them to `batches`.
+///
+/// The channel is bounded, so parsing pauses while the inserter is behind.
+async fn read_batches<R: AsyncBufRead + Unpin>(
+    mut reader: DocumentReader<R>,
+    chunk_size: usize,
+    batches: mpsc::Sender<sentinel_dbms::Result<Batch>>,
+) {
+    loop {
+        let mut documents = Vec::with_capacity(chunk_size);
+        while documents.len() < chunk_size {
+            match reader.next_document().await {
+                Ok(Some(document)) => documents.push(document),
+                Ok(None) => break,
+                Err(e) => {
+                    // The inserter may already have stopped, leaving nobody to report to
+                    drop(batches.send(Err(e)).await);
+                    return;
+                },
+            }
+        }
+
+        let last = documents.len() < chunk_size;
+        if !documents.is_empty() &&
+            batches
+                .send(Ok(Batch {
+                    documents,
+                    offset: reader.offset,
+                }))
+                .await
+                .is_err()
+        {
+            // The inserter stopped after an error
+            return;
+        }
+        if last {
+            return;
+        }
+    }
+}
+
 /// Execute collection bulk-insert command.
 ///
-/// Inserts multiple documents into the specified collection from a JSON file.
+/// Streams documents from a JSON array or NDJSON file into the specified collection. The input
+/// is parsed and inserted in batches of `--chunk-size` documents, each written with a single
+/// batched insert, so memory use is bounded regardless of the input size. With `--checkpoint`,
+/// the input offset is recorded after every batch and `--resume` continues from it.
 ///
 /// # Arguments
 /// * `store_path` - Path to the Sentinel store
@@ -34,53 +364,22 @@ pub async fn run(
     passphrase: Option<String>,
     args: BulkInsertArgs,
 ) -> sentinel_dbms::Result<()> {
-    // Read and parse the JSON file
-    let content = fs::read_to_string(&args.file).await.map_err(|e| {
-        sentinel_dbms::SentinelError::Io {
-            source: e,
-        }
-    })?;
-
-    let json_value: Value = serde_json::from_str(&content).map_err(|e| {
-        sentinel_dbms::SentinelError::Json {
-            source: e,
-        }
-    })?;
-
-    let documents_array = json_value.as_array().ok_or_else(|| {
-        sentinel_dbms::SentinelError::Internal {
-            message: String::from("JSON file must contain an array of documents"),
-        }
-    })?;
-
-    if documents_array.is_empty() {
-        info!("No documents to insert");
-        return Ok(());
-    }
-
-    // Parse documents into (id, data) pairs
-    let mut docs_to_insert = Vec::new();
-    for doc_value in documents_array {
-        let doc_obj = doc_value.as_object().ok_or_else(|| {
-            sentinel_dbms::SentinelError::Internal {
-                message: String::from("Each document must be an object"),
-            }
-        })?;
-
-        let id = doc_obj.get("id").and_then(|v| v.as_str()).ok_or_else(|| {
-            sentinel_dbms::SentinelError::Internal {
-                message: String::from("Each document must have an 'id' field with a string value"),
-            }
-        })?;
-
-        let data = doc_obj.get("data").ok_or_else(|| {
-            sentinel_dbms::SentinelError::Internal {
-                message: String::from("Each document must have a 'data' field"),
-            }
-        })?;
-
-        docs_to_insert.push((id, data.clone()));
+    let format = match args.format {
+        InputFormat::Auto => detect_format(&args.file).await?,
+        format => format,
+    };
+    let start_offset = match args.checkpoint {
+        Some(ref checkpoint) if args.resume => read_checkpoint(checkpoint).await?,
+        _ => 0,
+    };
+
+    let mut file = fs::File::open(&args.file).await?;
+    let file_size = file.metadata().await?.len();
+    if start_offset > 0 {
+        info!("Resuming bulk insert from offset {}", start_offset);
+        file.seek(SeekFrom::Start(start_offset)).await?;
     }
+    let reader = DocumentReader::new(BufReader::new(file), format, start_offset);
 
     let store = sentinel_dbms::Store::new_with_config(
         &store_path,
@@ -92,13 +391,83 @@ pub async fn run(
         .collection_with_config(&collection_name, Some(args.wal.to_overrides()))
         .await?;
 
-    let doc_count = docs_to_insert.len();
+    // One batch is parsed while the previous one is inserted
+    let chunk_size = args.chunk_size.max(1);
+    let (sender, mut batches) = mpsc::channel(1);
+    let parser = tokio::spawn(read_batches(reader, chunk_size, sender));
+
+    let started = Instant::now();
+    let mut inserted = 0_u64;
+    // The batch being inserted when an earlier run stopped may have been partially written
+    let mut skip_existing = start_offset > 0;
+    while let Some(batch) = batches.recv().await {
+        let Batch {
+            mut documents,
+            offset,
+        } = batch?;
+
+        if skip_existing {
+            skip_existing = false;
+            let mut remaining = Vec::with_capacity(documents.len());
+            for (id, data) in documents {
+                if collection
+                    .get_with_verification(&id, &sentinel_dbms::VerificationOptions::disabled())
+                    .await?
+                    .is_none()
+                {
+                    remaining.push((id, data));
+                }
+                else {
+                    debug!("Skipping document {} inserted before the checkpoint", id);
+                }
+            }
+            documents = remaining;
+        }
+
+        let count = documents.len() as u64;
+        let (ids, values): (Vec<_>, Vec<_>) = documents.into_iter().unzip();
+        collection
+            .bulk_insert(ids.iter().map(String::as_str).zip(values).collect())
+            .await?;
+        inserted = inserted.saturating_add(count);
+
+        if let Some(ref checkpoint) = args.checkpoint {
+            write_checkpoint(checkpoint, offset).await?;
+        }
+
+        let elapsed = started.elapsed().as_secs_f64();
+        let rate = if elapsed > 0.0 {
+            inserted as f64 / elapsed
+        }
+        else {
+            0.0
+        };
+        info!(
+            "Inserted {} documents ({} of {} bytes read, {:.0} documents/s)",
+            inserted, offset, file_size, rate
+        );
+    }
+    parser.await.map_err(|e| {
+        sentinel_dbms::SentinelError::Internal {
+            message: format!("Bulk insert reader failed: {}", e),
+        }
+    })?;
 
-    collection.bulk_insert(docs_to_insert).await?;
+    if let Some(ref checkpoint) = args.checkpoint {
+        match fs::remove_file(checkpoint).await {
+            Err(e) if e.kind() != std::io::ErrorKind::NotFound => return Err(e.into()),
+            _ => {},
+        }
+    }
+
+    if inserted == 0 {
+        info!("No documents to insert");
+        return Ok(());
+    }
 
     info!(
         "Successfully inserted {} documents into collection '{}'",
-        doc_count, collection_name
+        inserted, collection_name
     );
 
     Ok(())
@@ -138,8 +507,12 @@ mod tests {
         fs::write(&json_file, json_content).unwrap();
 
         let args = BulkInsertArgs {
-            file: json_file.to_string_lossy().to_string(),
-            wal:  crate::commands::WalArgs::default(),
+            file:       json_file.to_string_lossy().to_string(),
+            format:     InputFormat::Auto,
+            chunk_size: DEFAULT_CHUNK_SIZE,
+            checkpoint: None,
+            resume:     false,
+            wal:        crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -195,8 +568,12 @@ mod tests {
         fs::write(&json_file, json_content).unwrap();
 
         let args = BulkInsertArgs {
-            file: json_file.to_string_lossy().to_string(),
-            wal:  crate::commands::WalArgs::default(),
+            file:       json_file.to_string_lossy().to_string(),
+            format:     InputFormat::Auto,
+            chunk_size: DEFAULT_CHUNK_SIZE,
+            checkpoint: None,
+            resume:     false,
+            wal:        crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -233,8 +610,12 @@ mod tests {
         fs::write(&json_file, json_content).unwrap();
 
         let args = BulkInsertArgs {
-            file: json_file.to_string_lossy().to_string(),
-            wal:  crate::commands::WalArgs::default(),
+            file:       json_file.to_string_lossy().to_string(),
+            format:     InputFormat::Auto,
+            chunk_size: DEFAULT_CHUNK_SIZE,
+            checkpoint: None,
+            resume:     false,
+            wal:        crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -266,8 +647,12 @@ mod tests {
             .unwrap();
 
         let args = BulkInsertArgs {
-            file: "nonexistent.json".to_string(),
-            wal:  crate::commands::WalArgs::default(),
+            file:       "nonexistent.json".to_string(),
+            format:     InputFormat::Auto,
+            chunk_size: DEFAULT_CHUNK_SIZE,
+            checkpoint: None,
+            resume:     false,
+            wal:        crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -307,8 +692,12 @@ mod tests {
         fs::write(&json_file, json_content).unwrap();
 
         let args = BulkInsertArgs {
-            file: json_file.to_string_lossy().to_string(),
-            wal:  crate::commands::WalArgs::default(),
+            file:       json_file.to_string_lossy().to_string(),
+            format:     InputFormat::Auto,
+            chunk_size: DEFAULT_CHUNK_SIZE,
+            checkpoint: None,
+            resume:     false,
+            wal:        crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -345,8 +734,12 @@ mod tests {
         fs::write(&json_file, json_content).unwrap();
 
         let args = BulkInsertArgs {
-            file: json_file.to_string_lossy().to_string(),
-            wal:  crate::commands::WalArgs::default(),
+            file:       json_file.to_string_lossy().to_string(),
+            format:     InputFormat::Auto,
+            chunk_size: DEFAULT_CHUNK_SIZE,
+            checkpoint: None,
+            resume:     false,
+            wal:        crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -383,8 +776,12 @@ mod tests {
         fs::write(&json_file, json_content).unwrap();
 
         let args = BulkInsertArgs {
-            file: json_file.to_string_lossy().to_string(),
-            wal:  crate::commands::WalArgs::default(),
+            file:       json_file.to_string_lossy().to_string(),
+            format:     InputFormat::Auto,
+            chunk_size: DEFAULT_CHUNK_SIZE,
+            checkpoint: None,
+            resume:     false,
+            wal:        crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -421,8 +818,12 @@ mod tests {
         fs::write(&json_file, json_content).unwrap();
 
         let args = BulkInsertArgs {
-            file: json_file.to_string_lossy().to_string(),
-            wal:  crate::commands::WalArgs::default(),
+            file:       json_file.to_string_lossy().to_string(),
+            format:     InputFormat::Auto,
+            chunk_size: DEFAULT_CHUNK_SIZE,
+            checkpoint: None,
+            resume:     false,
+            wal:        crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -459,8 +860,12 @@ mod tests {
         fs::write(&json_file, json_content).unwrap();
 
         let args = BulkInsertArgs {
-            file: json_file.to_string_lossy().to_string(),
-            wal:  crate::commands::WalArgs::default(),
+            file:       json_file.to_string_lossy().to_string(),
+            format:     InputFormat::Auto,
+            chunk_size: DEFAULT_CHUNK_SIZE,
+            checkpoint: None,
+            resume:     false,
+            wal:        crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -473,4 +878,143 @@ mod tests {
 
         assert!(result.is_err());
     }
+
+    #[tokio::test]
+    async fn test_document_reader_splits_array_elements() {
+        let input = br#"[
+            {"id": "doc1", "data": {"text": "brackets ] } [ { and \"quotes\""}},
+            {"id": "doc2", "data": {"list": [1, [2, 3]]}}
+        ]"#;
+        let mut reader = DocumentReader::new(&input[..], InputFormat::Json, 0);
+
+        let (id, data) = reader.next_document().await.unwrap().unwrap();
+        assert_eq!(id, "doc1");
+        assert_eq!(data["text"], "brackets ] } [ { and \"quotes\"");
+        let (id, data) = reader.next_document().await.unwrap().unwrap();
+        assert_eq!(id, "doc2");
+        assert_eq!(data["list"][1][0], 2);
+        assert!(reader.next_document().await.unwrap().is_none());
+        assert_eq!(reader.offset, input.len() as u64);
+    }
+
+    #[tokio::test]
+    async fn test_document_reader_rejects_truncated_array() {
+        let input = br#"[{"id": "doc1", "data": {}}, {"id": "doc2""#;
+        let mut reader = DocumentReader::new(&input[..], InputFormat::Json, 0);
+
+        assert!(reader.next_document().await.unwrap().is_some());
+        assert!(reader.next_document().await.is_err());
+    }
+
+    #[tokio::test]
+    async fn test_bulk_insert_ndjson_in_chunks() {
+        let temp_dir = TempDir::new().unwrap();
+        let store_path = temp_dir.path().join("test_store");
+        let collection_name = "test_collection";
+
+        // Create NDJSON file with more documents than fit in one chunk
+        let json_content = "{\"id\": \"doc1\", \"data\": {\"n\": 1}}\n\n{\"id\": \"doc2\", \"data\": {\"n\": \
+                            2}}\n{\"id\": \"doc3\", \"data\": {\"n\": 3}}\n";
+        let json_file = temp_dir.path().join("docs.ndjson");
+        fs::write(&json_file, json_content).unwrap();
+
+        let args = BulkInsertArgs {
+            file:       json_file.to_string_lossy().to_string(),
+            format:     InputFormat::Auto,
+            chunk_size: 2,
+            checkpoint: None,
+            resume:     false,
+            wal:        crate::commands::WalArgs::default(),
+        };
+
+        let result = run(
+            store_path.to_string_lossy().to_string(),
+            collection_name.to_string(),
+            None,
+            args,
+        )
+        .await;
+
+        assert!(result.is_ok());
+
+        let store = sentinel_dbms::Store::new_with_config(&store_path, None, sentinel_dbms::StoreWalConfig::default())
+            .await
+            .unwrap();
+        let collection = store
+            .collection_with_config(collection_name, None)
+            .await
+            .unwrap();
+        for (id, n) in [("doc1", 1), ("doc2", 2), ("doc3", 3)] {
+            let doc = collection.get(id).await.unwrap().unwrap();
+            assert_eq!(doc.data()["n"], n);
+        }
+    }
+
+    #[tokio::test]
+    async fn test_bulk_insert_resume_from_checkpoint() {
+        let temp_dir = TempDir::new().unwrap();
+        let store_path = temp_dir.path().join("test_store");
+        let collection_name = "test_collection";
+
+        let first = r#"{"id": "doc1", "data": {"n": 1}}"#;
+        let json_content = format!(
+            "{}\n{}\n{}\n",
+            first, r#"{"id": "doc2", "data": {"n": 2}}"#, r#"{"id": "doc3", "data": {"n": 3}}"#
+        );
+        let json_file = temp_dir.path().join("docs.ndjson");
+        fs::write(&json_file, &json_content).unwrap();
+
+        // Simulate an interrupted run that inserted doc1 and doc2 but only checkpointed doc1
+        let store = sentinel_dbms::Store::new_with_config(&store_path, None, sentinel_dbms::StoreWalConfig::default())
+            .await
+            .unwrap();
+        let collection = store
+            .collection_with_config(collection_name, None)
+            .await
+            .unwrap();
+        collection
+            .insert("doc1", serde_json::json!({"n": 1}))
+            .await
+            .unwrap();
+        collection
+            .insert("doc2", serde_json::json!({"n": 2}))
+            .await
+            .unwrap();
+        let checkpoint = temp_dir.path().join("import.checkpoint");
+        fs::write(&checkpoint, (first.len() + 1).to_string()).unwrap();
+
+        let args = BulkInsertArgs {
+            file:       json_file.to_string_lossy().to_string(),
+            format:     InputFormat::Ndjson,
+            chunk_size: DEFAULT_CHUNK_SIZE,
+            checkpoint: Some(checkpoint.to_string_lossy().to_string()),
+            resume:     true,
+            wal:        crate::commands::WalArgs::default(),
+        };
+
+        let result = run(
+            store_path.to_string_lossy().to_string(),
+            collection_name.to_string(),
+            None,
+            args,
+        )
+        .await;
+
+        assert!(result.is_ok());
+        assert!(!checkpoint.exists());
+        let doc3 = collection.get("doc3").await.unwrap().unwrap();
+        assert_eq!(doc3.data()["n"], 3);
+    }
+
+    #[tokio::test]
+    async fn test_checkpoint_is_replaced_atomically() {
+        let temp_dir = TempDir::new().unwrap();
+        let checkpoint = temp_dir.path().join("import.checkpoint");
+        let checkpoint = checkpoint.to_string_lossy().to_string();
+        fs::write(&checkpoint, "12345").unwrap();
+
+        write_checkpoint(&checkpoint, 678).await.unwrap();
+        assert_eq!(read_checkpoint(&checkpoint).await.unwrap(), 678);
+        assert!(!std::path::Path::new(&format!("{}.tmp", checkpoint)).exists());
+    }
 }
@@ -7,9 +7,17 @@ use crate::commands::WalArgs;
 /// Arguments for the collection create command.
 #[derive(Args, Clone, Default)]
 pub struct CreateArgs {
+    /// Encoding of document files written to the collection: pretty, compact or cbor (default:
+    /// pretty)
+    #[arg(long)]
+    pub encoding: Option<sentinel_dbms::DocumentEncoding>,
+    /// Placement of document files: flat, or sharded into `ab/cd/` subdirectories by ID hash
+    /// for collections with millions of documents (default: flat)
+    #[arg(long)]
+    pub layout:   Option<sentinel_dbms::DocumentLayout>,
     /// WAL configuration options for this collection
     #[command(flatten)]
-    pub wal: WalArgs,
+    pub wal:      WalArgs,
 }
 
 /// Create a new collection within an existing Sentinel store.
@@ -53,6 +61,10 @@ fn build_collection_wal_config_overrides(
         args.wal.wal_verify_mode.is_some() ||
         args.wal.wal_auto_verify.is_some() ||
         args.wal.wal_enable_recovery.is_some() ||
+        args.wal.wal_durability.is_some() ||
+        args.wal.wal_retention.is_some() ||
+        args.wal.wal_group_commit_batch.is_some() ||
+        args.wal.wal_group_commit_delay_us.is_some() ||
         global_wal.wal_max_file_size.is_some() ||
         global_wal.wal_format.is_some() ||
         global_wal.wal_compression.is_some() ||
@@ -61,6 +73,10 @@ fn build_collection_wal_config_overrides(
         global_wal.wal_verify_mode.is_some() ||
         global_wal.wal_auto_verify.is_some() ||
         global_wal.wal_enable_recovery.is_some() ||
+        global_wal.wal_durability.is_some() ||
+        global_wal.wal_retention.is_some() ||
+        global_wal.wal_group_commit_batch.is_some() ||
+        global_wal.wal_group_commit_delay_us.is_some() ||
         args.wal.wal_persist_overrides ||
         global_wal.wal_persist_overrides)
         .then(|| {
@@ -88,6 +104,12 @@ fn build_collection_wal_config_overrides(
                     .or(global_wal.wal_max_records)
                     .map(Some),
                 format:                args.wal.wal_format.or(global_wal.wal_format),
+                group_commit:          args
+                    .wal
+                    .group_commit_override()
+                    .or_else(|| global_wal.group_commit_override()),
+                durability:            args.wal.wal_durability.or(global_wal.wal_durability),
+                retention:             args.wal.wal_retention.or(global_wal.wal_retention),
                 persist_overrides:     args.wal.wal_persist_overrides || global_wal.wal_persist_overrides,
             }
         })
@@ -117,7 +139,13 @@ pub async fn run(
         .collection_with_config(&collection, wal_overrides)
         .await
     {
-        Ok(_) => {
+        Ok(created) => {
+            if let Some(encoding) = args.encoding {
+                created.set_document_encoding(encoding).await?;
+            }
+            if let Some(layout) = args.layout {
+                created.migrate_layout(layout).await?;
+            }
             info!("Collection '{}' created successfully", collection);
             Ok(())
         },
@@ -195,6 +223,38 @@ mod tests {
         assert!(result.is_ok());
     }
 
+    #[tokio::test]
+    async fn test_create_collection_with_sharded_layout() {
+        let temp_dir = TempDir::new().unwrap();
+        let store_path = temp_dir.path().join("test_store");
+        let collection_name = "test_collection";
+
+        let args = CreateArgs {
+            layout: Some(sentinel_dbms::DocumentLayout::Sharded),
+            ..CreateArgs::default()
+        };
+        let result = run(
+            store_path.to_string_lossy().to_string(),
+            collection_name.to_string(),
+            None,
+            args,
+        )
+        .await;
+        assert!(result.is_ok());
+
+        let store = sentinel_dbms::Store::new_with_config(&store_path, None, sentinel_dbms::StoreWalConfig::default())
+            .await
+            .unwrap();
+        let collection = store
+            .collection_with_config(collection_name, None)
+            .await
+            .unwrap();
+        assert_eq!(
+            collection.document_layout(),
+            sentinel_dbms::DocumentLayout::Sharded
+        );
+    }
+
     #[tokio::test]
     async fn test_create_collection_nonexistent_store() {
         let temp_dir = TempDir::new().unwrap();
@@ -274,4 +334,32 @@ mod tests {
 
         assert!(result.is_err());
     }
+
+    #[tokio::test]
+    async fn test_create_collection_with_encoding() {
+        let temp_dir = TempDir::new().unwrap();
+        let store_path = temp_dir.path().join("test_store");
+
+        let args = CreateArgs {
+            encoding: Some(sentinel_dbms::DocumentEncoding::Cbor),
+            ..CreateArgs::default()
+        };
+        run(
+            store_path.to_string_lossy().to_string(),
+            "encoded".to_string(),
+            None,
+            args,
+        )
+        .await
+        .unwrap();
+
+        let store = sentinel_dbms::Store::new_with_config(&store_path, None, sentinel_dbms::StoreWalConfig::default())
+            .await
+            .unwrap();
+        let collection = store.collection("encoded").await.unwrap();
+        assert_eq!(
+            collection.document_encoding(),
+            sentinel_dbms::DocumentEncoding::Cbor
+        );
+    }
 }
@@ -1,5 +1,6 @@
 use clap::Args;
-use tracing::info;
+use sentinel_dbms::futures::StreamExt as _;
+use tracing::{error, info};
 
 /// Arguments for collection get-many command.
 #[derive(Args)]
@@ -8,18 +9,50 @@ pub struct GetManyArgs {
     #[arg(short, long = "id", value_name = "ID")]
     pub ids: Vec<String>,
 
-    /// Output format: json or table
+    /// Output format: json, table, or jsonl to print each result as soon as it is read
     #[arg(long, default_value = "json")]
     pub format: String,
 
+    /// Maximum number of document files read concurrently
+    #[arg(long, default_value_t = sentinel_dbms::GET_MANY_CONCURRENCY)]
+    pub concurrency: usize,
+
     /// WAL configuration options for this collection
     #[command(flatten)]
     pub wal: crate::commands::WalArgs,
 }
 
+/// Renders the result for one ID as a JSON object.
+fn result_json(id: &str, result: &sentinel_dbms::Result<Option<sentinel_dbms::Document>>) -> serde_json::Value {
+    match *result {
+        Ok(Some(ref doc)) => {
+            serde_json::json!({
+                "id": id,
+                "found": true,
+                "data": doc.data()
+            })
+        },
+        Ok(None) => {
+            serde_json::json!({
+                "id": id,
+                "found": false
+            })
+        },
+        Err(ref e) => {
+            serde_json::json!({
+                "id": id,
+                "found": false,
+                "error": e.to_string()
+            })
+        },
+    }
+}
+
 /// Execute collection get-many command.
 ///
-/// Retrieves multiple documents from the specified collection by their IDs.
+/// Retrieves multiple documents from the specified collection by their IDs. At most
+/// `concurrency` files are read at once. Every ID gets its own result, so one unreadable
+/// document does not hide the others; the command still fails if any read failed.
 ///
 /// # Arguments
 /// * `store_path` - Path to the Sentinel store
@@ -40,6 +73,14 @@ pub async fn run(
         info!("No document IDs specified");
         return Ok(());
     }
+    if !matches!(args.format.as_str(), "json" | "table" | "jsonl") {
+        return Err(sentinel_dbms::SentinelError::Internal {
+            message: format!(
+                "Invalid format: {}. Use 'json', 'table' or 'jsonl'",
+                args.format
+            ),
+        });
+    }
 
     let store = sentinel_dbms::Store::new_with_config(
         &store_path,
@@ -51,65 +92,79 @@ pub async fn run(
         .collection_with_config(&collection_name, Some(args.wal.to_overrides()))
         .await?;
 
-    // Convert Vec<String> to Vec<&str>
-    let ids: Vec<&str> = args.ids.iter().map(|s| s.as_str()).collect();
-
-    let documents = collection.get_many(&ids).await?;
+    let scan = sentinel_dbms::ScanOptions {
+        concurrency: args.concurrency,
+        ordered:     false,
+    };
+    let mut stream = collection.get_many_with_options(
+        args.ids.clone(),
+        &sentinel_dbms::VerificationOptions::default(),
+        scan,
+    );
+
+    let mut failed = 0_usize;
+    let mut results: Vec<Option<sentinel_dbms::Result<Option<sentinel_dbms::Document>>>> =
+        std::iter::repeat_with(|| None)
+            .take(args.ids.len())
+            .collect();
+    while let Some((index, result)) = stream.next().await {
+        let id = args.ids.get(index).map_or("", String::as_str);
+        if let Err(ref e) = result {
+            error!("Failed to get document '{}': {}", id, e);
+            failed = failed.saturating_add(1);
+        }
+        if args.format == "jsonl" {
+            println!("{}", serde_json::to_string(&result_json(id, &result))?);
+        }
+        else if let Some(slot) = results.get_mut(index) {
+            *slot = Some(result);
+        }
+    }
 
     match args.format.as_str() {
         "json" => {
-            let results: Vec<serde_json::Value> = documents
-                .into_iter()
-                .zip(ids.iter())
-                .map(|(doc, id)| {
-                    doc.map_or_else(
-                        || {
-                            serde_json::json!({
-                                "id": id,
-                                "found": false
-                            })
-                        },
-                        |doc| {
-                            serde_json::json!({
-                                "id": id,
-                                "found": true,
-                                "data": doc.data()
-                            })
-                        },
-                    )
-                })
+            let output: Vec<serde_json::Value> = results
+                .iter()
+                .zip(args.ids.iter())
+                .filter_map(|(result, id)| result.as_ref().map(|result| result_json(id, result)))
                 .collect();
 
-            println!("{}", serde_json::to_string_pretty(&results)?);
+            println!("{}", serde_json::to_string_pretty(&output)?);
         },
         "table" => {
             println!("{:<30} {:<6} Data Preview", "ID", "Found");
             println!("{}", "-".repeat(80));
 
-            for (doc, id) in documents.into_iter().zip(ids.iter()) {
-                let found = if doc.is_some() { "Yes" } else { "No" };
-                let preview = doc.as_ref().map_or_else(
-                    || String::from(""),
-                    |doc| {
+            for (result, id) in results.iter().zip(args.ids.iter()) {
+                let (found, preview) = match *result {
+                    Some(Ok(Some(ref doc))) => {
                         let data_str = serde_json::to_string(&doc.data()).unwrap();
-                        if data_str.chars().count() > 40 {
+                        let preview = if data_str.chars().count() > 40 {
                             format!("{}...", data_str.chars().take(37).collect::<String>())
                         }
                         else {
                             data_str
-                        }
+                        };
+                        ("Yes", preview)
                     },
-                );
+                    Some(Err(ref e)) => ("Error", e.to_string()),
+                    Some(Ok(None)) | None => ("No", String::new()),
+                };
                 println!("{:<30} {:<6} {}", id, found, preview);
             }
         },
-        _ => {
-            return Err(sentinel_dbms::SentinelError::Internal {
-                message: format!("Invalid format: {}. Use 'json' or 'table'", args.format),
-            });
-        },
+        _ => {},
     }
 
+    if failed > 0 {
+        return Err(sentinel_dbms::SentinelError::Internal {
+            message: format!(
+                "{} of {} documents could not be read",
+                failed,
+                args.ids.len()
+            ),
+        });
+    }
     Ok(())
 }
 
@@ -142,9 +197,10 @@ mod tests {
         collection.bulk_insert(docs).await.unwrap();
 
         let args = GetManyArgs {
-            ids:    vec!["doc1".to_string(), "doc2".to_string()],
-            format: "json".to_string(),
-            wal:    crate::commands::WalArgs::default(),
+            ids:         vec!["doc1".to_string(), "doc2".to_string()],
+            format:      "json".to_string(),
+            concurrency: sentinel_dbms::GET_MANY_CONCURRENCY,
+            wal:         crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -178,9 +234,10 @@ mod tests {
         collection.bulk_insert(docs).await.unwrap();
 
         let args = GetManyArgs {
-            ids:    vec!["doc1".to_string(), "doc2".to_string()],
-            format: "table".to_string(),
-            wal:    crate::commands::WalArgs::default(),
+            ids:         vec!["doc1".to_string(), "doc2".to_string()],
+            format:      "table".to_string(),
+            concurrency: sentinel_dbms::GET_MANY_CONCURRENCY,
+            wal:         crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -211,9 +268,10 @@ mod tests {
             .unwrap();
 
         let args = GetManyArgs {
-            ids:    vec![],
-            format: "json".to_string(),
-            wal:    crate::commands::WalArgs::default(),
+            ids:         vec![],
+            format:      "json".to_string(),
+            concurrency: sentinel_dbms::GET_MANY_CONCURRENCY,
+            wal:         crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -244,9 +302,10 @@ mod tests {
             .unwrap();
 
         let args = GetManyArgs {
-            ids:    vec!["doc1".to_string()],
-            format: "invalid".to_string(),
-            wal:    crate::commands::WalArgs::default(),
+            ids:         vec!["doc1".to_string()],
+            format:      "invalid".to_string(),
+            concurrency: sentinel_dbms::GET_MANY_CONCURRENCY,
+            wal:         crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -277,9 +336,10 @@ mod tests {
             .unwrap();
 
         let args = GetManyArgs {
-            ids:    vec!["nonexistent1".to_string(), "nonexistent2".to_string()],
-            format: "json".to_string(),
-            wal:    crate::commands::WalArgs::default(),
+            ids:         vec!["nonexistent1".to_string(), "nonexistent2".to_string()],
+            format:      "json".to_string(),
+            concurrency: sentinel_dbms::GET_MANY_CONCURRENCY,
+            wal:         crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -310,9 +370,10 @@ mod tests {
             .unwrap();
 
         let args = GetManyArgs {
-            ids:    vec!["nonexistent1".to_string(), "nonexistent2".to_string()],
-            format: "table".to_string(),
-            wal:    crate::commands::WalArgs::default(),
+            ids:         vec!["nonexistent1".to_string(), "nonexistent2".to_string()],
+            format:      "table".to_string(),
+            concurrency: sentinel_dbms::GET_MANY_CONCURRENCY,
+            wal:         crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -334,9 +395,10 @@ mod tests {
         let collection_name = "test_collection";
 
         let args = GetManyArgs {
-            ids:    vec!["doc1".to_string()],
-            format: "json".to_string(),
-            wal:    crate::commands::WalArgs::default(),
+            ids:         vec!["doc1".to_string()],
+            format:      "json".to_string(),
+            concurrency: sentinel_dbms::GET_MANY_CONCURRENCY,
+            wal:         crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -367,9 +429,10 @@ mod tests {
             .unwrap();
 
         let args = GetManyArgs {
-            ids:    vec!["valid_id".to_string(), "invalid id with spaces".to_string()],
-            format: "json".to_string(),
-            wal:    crate::commands::WalArgs::default(),
+            ids:         vec!["valid_id".to_string(), "invalid id with spaces".to_string()],
+            format:      "json".to_string(),
+            concurrency: sentinel_dbms::GET_MANY_CONCURRENCY,
+            wal:         crate::commands::WalArgs::default(),
         };
 
         let result = run(
@@ -384,4 +447,47 @@ mod tests {
         // For now, we'll assume it errors on invalid IDs like other commands
         assert!(result.is_err());
     }
+
+    #[tokio::test]
+    async fn test_get_many_jsonl_reports_unreadable_documents() {
+        let temp_dir = TempDir::new().unwrap();
+        let store_path = temp_dir.path().join("test_store");
+        let collection_name = "test_collection";
+
+        let store = sentinel_dbms::Store::new_with_config(&store_path, None, sentinel_dbms::StoreWalConfig::default())
+            .await
+            .unwrap();
+        let collection = store
+            .collection_with_config(collection_name, None)
+            .await
+            .unwrap();
+        collection
+            .bulk_insert(vec![
+                ("doc1", serde_json::json!({"name": "Alice"})),
+                ("doc2", serde_json::json!({"name": "Bob"})),
+            ])
+            .await
+            .unwrap();
+        let corrupt = store_path
+            .join("data")
+            .join(collection_name)
+            .join("doc2.json");
+        std::fs::write(corrupt, "not a document").unwrap();
+
+        let args = GetManyArgs {
+            ids:         vec!["doc1".to_string(), "doc2".to_string()],
+            format:      "jsonl".to_string(),
+            concurrency: 1,
+            wal:         crate::commands::WalArgs::default(),
+        };
+        let result = run(
+            store_path.to_string_lossy().to_string(),
+            collection_name.to_string(),
+            None,
+            args,
+        )
+        .await;
+
+        assert!(result.is_err());
+    }
 }
@@ -3,14 +3,16 @@ use clap::Args;
 /// Arguments for collection info command.
 #[derive(Args)]
 pub struct InfoArgs {
-    /// Output format: table (default)
+    /// Output format: table (default), json, or prometheus when built with the `prometheus`
+    /// feature
     #[arg(long, default_value = "table")]
     pub format: String,
 }
 
 /// Execute collection info command.
 ///
-/// Displays metadata and statistics for the specified collection.
+/// Displays metadata and statistics for the specified collection, followed by the metrics the
+/// store recorded while opening it, which include the operations replayed from its WAL.
 ///
 /// # Arguments
 /// * `store_path` - Path to the Sentinel store
@@ -59,16 +61,63 @@ pub async fn run(
                 println!("Last Checkpoint:   Never");
             }
 
+            println!("Layout:            {}", collection.document_layout());
             println!("Total Documents:   {}", collection.total_documents());
             println!(
                 "Total Size:        {} bytes ({:.2} MB)",
                 collection.total_size_bytes(),
                 collection.total_size_bytes() as f64 / 1_000_000.0
             );
+
+            let metrics = store.metrics();
+            println!();
+            println!("Metrics");
+            println!("====================");
+            for (operation, latency) in [
+                ("Insert:", &metrics.operations.insert),
+                ("Get:", &metrics.operations.get),
+                ("Update:", &metrics.operations.update),
+                ("Delete:", &metrics.operations.delete),
+                ("Query:", &metrics.operations.query),
+                ("Aggregate:", &metrics.operations.aggregate),
+                ("Hash Check:", &metrics.hash_verification),
+                ("Signature Check:", &metrics.signature_verification),
+            ] {
+                println!(
+                    "{:<19}{} ops, p50 {} us, p99 {} us, max {} us",
+                    operation, latency.count, latency.p50, latency.p99, latency.max
+                );
+            }
+            println!(
+                "Documents:         {} scanned, {} returned",
+                metrics.documents_scanned, metrics.documents_returned
+            );
+            println!(
+                "Document I/O:      {} bytes read, {} bytes written",
+                metrics.bytes_read, metrics.bytes_written
+            );
+            println!("Event Queue Depth: {}", metrics.event_queue_depth);
+        },
+        "json" => {
+            let info = serde_json::json!({
+                "name": collection.name(),
+                "created_at": collection.created_at(),
+                "updated_at": collection.updated_at(),
+                "last_checkpoint_at": collection.last_checkpoint_at(),
+                "layout": collection.document_layout().to_string(),
+                "total_documents": collection.total_documents(),
+                "total_size_bytes": collection.total_size_bytes(),
+                "metrics": store.metrics(),
+            });
+            println!("{}", serde_json::to_string_pretty(&info)?);
+        },
+        #[cfg(feature = "prometheus")]
+        "prometheus" => {
+            print!("{}", store.metrics().to_prometheus());
         },
         _ => {
             return Err(sentinel_dbms::SentinelError::Internal {
-                message: format!("Invalid format: {}. Use 'table'", args.format),
+                message: format!("Invalid format: {}. Use 'table' or 'json'", args.format),
             });
         },
     }
@@ -139,7 +188,7 @@ mod tests {
             .unwrap();
 
         // Create a checkpoint
-        sentinel_dbms::wal::ops::CollectionWalOps::checkpoint_wal(&collection)
+        sentinel_dbms::wal::ops::CollectionWalOps::checkpoint_wal(&*collection)
             .await
             .unwrap();
 
@@ -161,6 +210,38 @@ mod tests {
         assert!(result.is_ok());
     }
 
+    #[tokio::test]
+    async fn test_info_command_json_format() {
+        let temp_dir = tempdir().unwrap();
+        let store_path = temp_dir.path().join("store");
+        let collection_name = "test_collection";
+
+        let store = sentinel_dbms::Store::new_with_config(&store_path, None, sentinel_dbms::StoreWalConfig::default())
+            .await
+            .unwrap();
+        let collection = store
+            .collection_with_config(collection_name, None)
+            .await
+            .unwrap();
+        collection
+            .insert("doc1", json!({"name": "Alice"}))
+            .await
+            .unwrap();
+
+        let args = InfoArgs {
+            format: "json".to_string(),
+        };
+        let result = run(
+            store_path.to_string_lossy().to_string(),
+            collection_name.to_string(),
+            None,
+            args,
+        )
+        .await;
+
+        assert!(result.is_ok());
+    }
+
     #[tokio::test]
     async fn test_info_command_invalid_format() {
         let temp_dir = tempdir().unwrap();
@@ -87,7 +87,7 @@ pub async fn run(
         .await?;
 
     if let Some(bulk_file) = args.bulk {
-        insert_bulk_documents(coll, &store_path, &collection, bulk_file).await
+        insert_bulk_documents(&coll, &store_path, &collection, bulk_file).await
     }
     else {
         let id = args.id.ok_or_else(|| {
@@ -100,7 +100,7 @@ pub async fn run(
                 message: "Document data is required for single insert mode".to_owned(),
             }
         })?;
-        insert_single_document(coll, &store_path, &collection, &id, &data).await
+        insert_single_document(&coll, &store_path, &collection, &id, &data).await
     }
 }
 
@@ -116,7 +116,7 @@ pub async fn run(
 /// # Returns
 /// Returns `Ok(())` on success, or a `SentinelError` on failure.
 async fn insert_single_document(
-    coll: sentinel_dbms::Collection,
+    coll: &sentinel_dbms::Collection,
     store_path: &str,
     collection: &str,
     id: &str,
@@ -162,7 +162,7 @@ async fn insert_single_document(
     reason = "Safe arithmetic for counting inserted documents in CLI"
 )]
 async fn insert_bulk_documents(
-    coll: sentinel_dbms::Collection,
+    coll: &sentinel_dbms::Collection,
     store_path: &str,
     collection: &str,
     bulk_file: String,
@@ -0,0 +1,116 @@
+use clap::Args;
+use tracing::{error, info};
+
+/// Arguments for collection migrate-layout command.
+#[derive(Args)]
+pub struct MigrateLayoutArgs {
+    /// Target layout of document files: flat or sharded
+    #[arg(long)]
+    pub layout: sentinel_dbms::DocumentLayout,
+    /// WAL configuration options for this collection
+    #[command(flatten)]
+    pub wal:    crate::commands::WalArgs,
+}
+
+/// Execute collection migrate-layout command.
+///
+/// Moves every document file of the collection into the target layout. The collection can be
+/// used by other processes while this runs; a migration that is interrupted resumes when the
+/// command is run again.
+///
+/// # Arguments
+/// * `store_path` - Path to the Sentinel store
+/// * `collection_name` - Name of the collection
+/// * `passphrase` - Optional passphrase for decrypting signing key
+/// * `args` - Migrate layout command arguments
+///
+/// # Returns
+/// Returns `Ok(())` on success.
+pub async fn run(
+    store_path: String,
+    collection_name: String,
+    passphrase: Option<String>,
+    args: MigrateLayoutArgs,
+) -> sentinel_dbms::Result<()> {
+    let store = sentinel_dbms::Store::new_with_config(
+        &store_path,
+        passphrase.as_deref(),
+        sentinel_dbms::StoreWalConfig::default(),
+    )
+    .await?;
+    let collection = store
+        .collection_with_config(&collection_name, Some(args.wal.to_overrides()))
+        .await?;
+
+    match collection.migrate_layout(args.layout).await {
+        Ok(moved) => {
+            info!(
+                "Collection '{}' now uses the {} layout ({} files moved)",
+                collection_name, args.layout, moved
+            );
+            Ok(())
+        },
+        Err(e) => {
+            error!(
+                "Failed to migrate collection '{}' to the {} layout: {}",
+                collection_name, args.layout, e
+            );
+            Err(e)
+        },
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use serde_json::json;
+    use tempfile::TempDir;
+
+    use super::*;
+
+    #[tokio::test]
+    async fn test_migrate_layout_keeps_documents() {
+        let temp_dir = TempDir::new().unwrap();
+        let store_path = temp_dir.path().join("test_store");
+        let collection_name = "test_collection";
+
+        let store = sentinel_dbms::Store::new_with_config(&store_path, None, sentinel_dbms::StoreWalConfig::default())
+            .await
+            .unwrap();
+        let collection = store
+            .collection_with_config(collection_name, None)
+            .await
+            .unwrap();
+        collection
+            .insert("doc1", json!({"name": "Alice"}))
+            .await
+            .unwrap();
+        drop(collection);
+        store.close_collection(collection_name).await.unwrap();
+
+        let args = MigrateLayoutArgs {
+            layout: sentinel_dbms::DocumentLayout::Sharded,
+            wal:    crate::commands::WalArgs::default(),
+        };
+        let result = run(
+            store_path.to_string_lossy().to_string(),
+            collection_name.to_string(),
+            None,
+            args,
+        )
+        .await;
+        assert!(result.is_ok());
+
+        let store = sentinel_dbms::Store::new_with_config(&store_path, None, sentinel_dbms::StoreWalConfig::default())
+            .await
+            .unwrap();
+        let collection = store
+            .collection_with_config(collection_name, None)
+            .await
+            .unwrap();
+        assert_eq!(
+            collection.document_layout(),
+            sentinel_dbms::DocumentLayout::Sharded
+        );
+        assert!(collection.get("doc1").await.unwrap().is_some());
+    }
+}
@@ -98,6 +98,12 @@ pub enum CollectionCommands {
     ///
     /// Displays metadata and statistics for the collection.
     Info(info::InfoArgs),
+
+    /// Move the document files of a collection into another layout
+    ///
+    /// The collection stays usable while its files are moved.
+    #[command(name = "migrate-layout")]
+    MigrateLayout(migrate_layout::MigrateLayoutArgs),
 }
 
 /// Aggregate command
@@ -120,6 +126,8 @@ mod info;
 mod insert;
 /// List command
 mod list;
+/// Migrate layout command
+mod migrate_layout;
 /// Query command
 mod query;
 /// Update command
@@ -149,6 +157,9 @@ pub async fn run(args: CollectionArgs) -> sentinel_dbms::Result<()> {
             aggregate::run(args.store, args.name, args.passphrase, sub_args).await
         },
         CollectionCommands::Info(sub_args) => info::run(args.store, args.name, args.passphrase, sub_args).await,
+        CollectionCommands::MigrateLayout(sub_args) => {
+            migrate_layout::run(args.store, args.name, args.passphrase, sub_args).await
+        },
     }
 }
 
@@ -253,9 +264,10 @@ mod tests {
             name:       collection_name.to_string(),
             passphrase: None,
             command:    CollectionCommands::GetMany(get_many::GetManyArgs {
-                ids:    vec!["doc1".to_string()],
-                format: "json".to_string(),
-                wal:    crate::commands::WalArgs::default(),
+                ids:         vec!["doc1".to_string()],
+                format:      "json".to_string(),
+                concurrency: sentinel_dbms::GET_MANY_CONCURRENCY,
+                wal:         crate::commands::WalArgs::default(),
             }),
         };
 
@@ -435,8 +447,12 @@ mod tests {
             name:       collection_name.to_string(),
             passphrase: None,
             command:    CollectionCommands::BulkInsert(bulk_insert::BulkInsertArgs {
-                file: json_file_path.to_string_lossy().to_string(),
-                wal:  crate::commands::WalArgs::default(),
+                file:       json_file_path.to_string_lossy().to_string(),
+                format:     bulk_insert::InputFormat::Auto,
+                chunk_size: 1000,
+                checkpoint: None,
+                resume:     false,
+                wal:        crate::commands::WalArgs::default(),
             }),
         };
 
@@ -474,7 +490,8 @@ mod tests {
             name:       collection_name.to_string(),
             passphrase: None,
             command:    CollectionCommands::Aggregate(aggregate::AggregateArgs {
-                aggregation: "count".to_string(),
+                aggregation: vec!["count".to_string()],
+                group_by:    vec![],
                 filter:      vec![],
                 wal:         crate::commands::WalArgs::default(),
             }),
@@ -523,6 +540,7 @@ mod tests {
                 sort:             None,
                 limit:            None,
                 offset:           None,
+                after:            None,
                 project:          None,
                 format:           "json".to_string(),
                 wal:              crate::commands::WalArgs::default(),
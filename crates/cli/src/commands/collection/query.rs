@@ -39,6 +39,9 @@ pub struct QueryArgs {
     /// Skip number of results
     #[arg(long)]
     pub offset:           Option<usize>,
+    /// Resume after the cursor logged by the previous page of the same query
+    #[arg(long, value_name = "cursor")]
+    pub after:            Option<String>,
     /// Project fields (comma-separated)
     #[arg(long, value_name = "field1,field2")]
     pub project:          Option<String>,
@@ -79,6 +82,8 @@ impl QueryArgs {
 /// Query documents in a Sentinel collection with filters and sorting.
 ///
 /// This function allows complex querying with filters, sorting, pagination, and projection.
+/// Once the documents are printed, the cursor after the last one is logged; pass it to `--after`
+/// to read the next page without re-reading the skipped documents as `--offset` does.
 ///
 /// # Arguments
 /// * `store_path` - Path to the Sentinel store
@@ -159,6 +164,9 @@ pub async fn run(
     if let Some(offset) = args.offset {
         query_builder = query_builder.offset(offset);
     }
+    if let Some(after) = args.after.as_deref() {
+        query_builder = query_builder.after(after.parse()?);
+    }
 
     // Parse projection
     if let Some(project_str) = args.project.as_deref() {
@@ -180,14 +188,13 @@ pub async fn run(
         .await?;
 
     // Use query instead of streaming all
-    let result = coll
+    let mut result = coll
         .query_with_verification(query, &verification_options)
         .await?;
 
     // Output documents from the stream
     let mut count = 0usize;
-    let mut stream = result.documents;
-    while let Some(item) = stream.next().await {
+    while let Some(item) = result.documents.next().await {
         match item {
             Ok(doc) => {
                 #[allow(clippy::print_stdout, reason = "CLI output")]
@@ -210,6 +217,9 @@ pub async fn run(
     }
 
     info!("Found {} documents in collection '{}'", count, collection);
+    if let Some(cursor) = result.next_cursor() {
+        info!("Read the next page with --after {}", cursor);
+    }
     Ok(())
 }
 
@@ -364,6 +374,7 @@ mod tests {
             sort:             None,
             limit:            None,
             offset:           None,
+            after:            None,
             project:          None,
             format:           "json".to_string(),
             wal:              WalArgs::default(),
@@ -418,6 +429,7 @@ mod tests {
             sort:             None,
             limit:            None,
             offset:           None,
+            after:            None,
             project:          None,
             format:           "json".to_string(),
             wal:              WalArgs::default(),
@@ -476,6 +488,7 @@ mod tests {
             sort:             None,
             limit:            Some(2),
             offset:           None,
+            after:            None,
             project:          None,
             format:           "json".to_string(),
             wal:              WalArgs::default(),
@@ -491,6 +504,59 @@ mod tests {
         assert!(result.is_ok());
     }
 
+    #[tokio::test]
+    async fn test_query_with_after() {
+        let temp_dir = tempdir().unwrap();
+        let store_path = temp_dir.path().join("store");
+        let collection_name = "test_collection";
+
+        let store = sentinel_dbms::Store::new_with_config(&store_path, None, sentinel_dbms::StoreWalConfig::default())
+            .await
+            .unwrap();
+        let collection = store
+            .collection_with_config(collection_name, None)
+            .await
+            .unwrap();
+        for (id, age) in [("doc1", 30), ("doc2", 25), ("doc3", 35)] {
+            collection
+                .insert(id, serde_json::json!({"age": age}))
+                .await
+                .unwrap();
+        }
+
+        // Resume a sorted query after its first page
+        let cursor = sentinel_dbms::QueryCursor::new(Some(serde_json::json!(25)), "doc2".to_owned());
+        let args = QueryArgs {
+            sort: Some("age:asc".to_string()),
+            limit: Some(1),
+            after: Some(cursor.to_string()),
+            signature_mode: "strict".to_string(),
+            empty_sig_mode: "warn".to_string(),
+            hash_mode: "strict".to_string(),
+            ..Default::default()
+        };
+        let result = run(
+            store_path.to_string_lossy().to_string(),
+            collection_name.to_string(),
+            None,
+            args.clone(),
+        )
+        .await;
+        assert!(result.is_ok());
+
+        let result = run(
+            store_path.to_string_lossy().to_string(),
+            collection_name.to_string(),
+            None,
+            QueryArgs {
+                after: Some("not-a-cursor".to_string()),
+                ..args
+            },
+        )
+        .await;
+        assert!(result.is_err());
+    }
+
     #[tokio::test]
     async fn test_query_invalid_verification_mode() {
         let temp_dir = tempdir().unwrap();
@@ -517,6 +583,7 @@ mod tests {
             sort:             None,
             limit:            None,
             offset:           None,
+            after:            None,
             project:          None,
             format:           "json".to_string(),
             wal:              WalArgs::default(),
@@ -584,6 +651,7 @@ mod tests {
             sort:             None,
             limit:            None,
             offset:           None,
+            after:            None,
             project:          None,
             format:           "json".to_string(),
             wal:              WalArgs::default(),
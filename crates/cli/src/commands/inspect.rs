@@ -0,0 +1,98 @@
+//! Document file inspection command.
+
+use clap::Args;
+use tracing::{error, info};
+
+/// Arguments for the inspect command.
+#[derive(Args, Clone, Default)]
+pub struct InspectArgs {
+    /// Path to a document file, in any document encoding
+    pub file:      String,
+    /// Print only the document data instead of the whole document
+    #[arg(long)]
+    pub data_only: bool,
+}
+
+/// Decode a document file and print it as pretty JSON.
+///
+/// The encoding of the file (pretty or compact JSON, or CBOR) is detected from its content, so
+/// this works on any document file regardless of the collection's encoding setting.
+///
+/// # Arguments
+/// * `args` - The parsed command-line arguments for inspect.
+///
+/// # Returns
+/// Returns `Ok(())` on success, or a `SentinelError` if the file cannot be read or decoded.
+///
+/// # Examples
+/// ```rust,no_run
+/// use sentinel_cli::commands::inspect::{run, InspectArgs};
+///
+/// let args = InspectArgs {
+///     file:      String::from("/tmp/my_store/data/users/user-1.json"),
+///     data_only: false,
+/// };
+/// run(args).await?;
+/// ```
+pub async fn run(args: InspectArgs) -> sentinel_dbms::Result<()> {
+    let bytes = tokio::fs::read(&args.file).await.map_err(|e| {
+        error!("Failed to read document file {}: {}", args.file, e);
+        e
+    })?;
+    let doc = sentinel_dbms::decode_document(&bytes).map_err(|e| {
+        error!("Failed to decode document file {}: {}", args.file, e);
+        e
+    })?;
+    info!(
+        "Document '{}' ({} encoding, {} bytes)",
+        doc.id(),
+        sentinel_dbms::detect_encoding(&bytes),
+        bytes.len()
+    );
+
+    let output = if args.data_only {
+        serde_json::to_string_pretty(doc.data())?
+    }
+    else {
+        serde_json::to_string_pretty(&doc)?
+    };
+    #[allow(clippy::print_stdout, reason = "CLI output")]
+    {
+        println!("{}", output);
+    }
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use serde_json::json;
+    use tempfile::TempDir;
+
+    use super::*;
+
+    #[tokio::test]
+    async fn test_inspect_cbor_document() {
+        let temp_dir = TempDir::new().unwrap();
+        let doc = sentinel_dbms::Document::new_without_signature("doc-1".to_owned(), json!({"a": 1}))
+            .await
+            .unwrap();
+        let path = temp_dir.path().join("doc-1.json");
+        let bytes = sentinel_dbms::encode_document(&doc, sentinel_dbms::DocumentEncoding::Cbor).unwrap();
+        tokio::fs::write(&path, bytes).await.unwrap();
+
+        let args = InspectArgs {
+            file:      path.to_string_lossy().to_string(),
+            data_only: true,
+        };
+        assert!(run(args).await.is_ok());
+    }
+
+    #[tokio::test]
+    async fn test_inspect_missing_file() {
+        let args = InspectArgs {
+            file:      "/nonexistent/doc.json".to_owned(),
+            data_only: false,
+        };
+        assert!(run(args).await.is_err());
+    }
+}
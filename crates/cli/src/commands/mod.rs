@@ -4,8 +4,12 @@ use clap::{Args, Parser, Subcommand};
 ///
 /// This module contains submodules for each CLI command, each implementing
 /// the logic for a specific operation on the Sentinel DBMS.
+/// Change feed command module.
+mod changes;
 /// Collection command module.
 mod collection;
+/// Document file inspection command module.
+mod inspect;
 /// Store command module.
 mod store;
 /// WAL command module.
@@ -53,7 +57,7 @@ pub struct WalArgs {
     #[arg(long, global = true)]
     pub wal_max_file_size: Option<u64>,
 
-    /// WAL file format for collections: binary or json_lines (default: binary)
+    /// WAL file format for collections: binary, binary_v2 or json_lines (default: binary)
     #[arg(long, global = true)]
     pub wal_format: Option<sentinel_dbms::WalFormat>,
 
@@ -81,6 +85,25 @@ pub struct WalArgs {
     #[arg(long, global = true)]
     pub wal_enable_recovery: Option<bool>,
 
+    /// WAL durability for collections: buffered, flush, fdatasync or periodic_fsync:<ms> (default:
+    /// flush)
+    #[arg(long, global = true)]
+    pub wal_durability: Option<sentinel_dbms::WalDurability>,
+
+    /// What WAL checkpoints do with fully checkpointed segments: keep, archive or delete
+    /// (default: delete)
+    #[arg(long, global = true)]
+    pub wal_retention: Option<sentinel_dbms::WalRetention>,
+
+    /// Maximum number of WAL entries committed together in one group commit, 0 disables group
+    /// commit (default: disabled)
+    #[arg(long, global = true)]
+    pub wal_group_commit_batch: Option<usize>,
+
+    /// Maximum time in microseconds a WAL group commit waits for more entries (default: 500)
+    #[arg(long, global = true)]
+    pub wal_group_commit_delay_us: Option<u64>,
+
     /// Persist WAL configuration overrides to disk for existing collections (default: false)
     #[arg(long, global = true)]
     pub wal_persist_overrides: bool,
@@ -159,6 +182,15 @@ pub enum Commands {
     /// Provides commands for checkpointing, verification, recovery, and configuration
     /// of WAL files for collections and the entire store.
     Wal(wal::WalArgs),
+    /// Decode a document file in any encoding and print it as JSON.
+    ///
+    /// Useful to read documents of collections that store compact JSON or CBOR files.
+    Inspect(inspect::InspectArgs),
+    /// Print the committed changes of a store since a cursor.
+    ///
+    /// Reads the WAL of every collection, or of the given ones, across rotated and compressed
+    /// segments, and prints one JSON line per batch with the cursor to resume from.
+    Changes(changes::ChangesArgs),
 }
 
 /// Execute the specified CLI command.
@@ -232,6 +264,8 @@ pub async fn run_command(cli: Cli) -> sentinel_dbms::Result<()> {
         Commands::Store(args) => store::run(args).await,
         Commands::Collection(args) => collection::run(args).await,
         Commands::Wal(args) => wal::run(args).await,
+        Commands::Inspect(args) => inspect::run(args).await,
+        Commands::Changes(args) => changes::run(args).await,
     }
 }
 
@@ -280,6 +314,39 @@ mod tests {
             _ => panic!("Expected Collection command"),
         }
 
+        // Test inspect command
+        let cli_parsed = Cli::try_parse_from(["test", "inspect", "/tmp/doc.json", "--data-only"]).unwrap();
+        match cli_parsed.command {
+            Commands::Inspect(args) => {
+                assert_eq!(args.file, "/tmp/doc.json");
+                assert!(args.data_only);
+            },
+            _ => panic!("Expected Inspect command"),
+        }
+
+        // Test changes command
+        let cli_parsed = Cli::try_parse_from([
+            "test",
+            "changes",
+            "--store",
+            "/tmp/store",
+            "--since",
+            "users:42",
+            "-c",
+            "users",
+            "-c",
+            "orders",
+        ])
+        .unwrap();
+        match cli_parsed.command {
+            Commands::Changes(args) => {
+                assert_eq!(args.since, "users:42");
+                assert_eq!(args.collections, ["users", "orders"]);
+                assert!(!args.follow);
+            },
+            _ => panic!("Expected Changes command"),
+        }
+
         // Test collection insert command
         let cli_parsed = Cli::try_parse_from([
             "test",
@@ -717,7 +784,33 @@ impl WalArgs {
             compression_algorithm: self.wal_compression.map(Some),
             max_records_per_file:  self.wal_max_records.map(Some),
             format:                self.wal_format,
+            group_commit:          self.group_commit_override(),
+            durability:            self.wal_durability,
+            retention:             self.wal_retention,
             persist_overrides:     self.wal_persist_overrides,
         }
     }
+
+    /// Build the group-commit override from the CLI flags.
+    ///
+    /// Returns `None` when no group-commit flag is given, `Some(None)` when group commit is
+    /// explicitly disabled with a batch size of 0, and the merged settings otherwise.
+    pub fn group_commit_override(&self) -> Option<Option<sentinel_dbms::GroupCommitConfig>> {
+        if self.wal_group_commit_batch.is_none() && self.wal_group_commit_delay_us.is_none() {
+            return None;
+        }
+
+        let defaults = sentinel_dbms::GroupCommitConfig::default();
+        match self.wal_group_commit_batch {
+            Some(0) => Some(None),
+            batch => {
+                Some(Some(sentinel_dbms::GroupCommitConfig {
+                    max_batch_entries:  batch.unwrap_or(defaults.max_batch_entries),
+                    max_batch_delay_us: self
+                        .wal_group_commit_delay_us
+                        .unwrap_or(defaults.max_batch_delay_us),
+                }))
+            },
+        }
+    }
 }
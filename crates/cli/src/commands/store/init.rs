@@ -65,6 +65,9 @@ fn build_store_wal_config(args: &InitArgs) -> StoreWalConfig {
         compression_algorithm: args.wal.wal_compression,
         max_records_per_file:  args.wal.wal_max_records,
         format:                args.wal.wal_format.unwrap_or_default(),
+        group_commit:          args.wal.group_commit_override().flatten(),
+        durability:            args.wal.wal_durability.unwrap_or_default(),
+        retention:             args.wal.wal_retention.unwrap_or_default(),
     };
 
     StoreWalConfig {
@@ -78,6 +81,7 @@ fn build_store_wal_config(args: &InitArgs) -> StoreWalConfig {
         auto_checkpoint: args.wal_auto_checkpoint.unwrap_or(true),
         checkpoint_interval_secs: args.wal_checkpoint_interval.unwrap_or(300),
         max_wal_size_bytes: args.wal_store_max_size.unwrap_or(100 * 1024 * 1024), // 100MB default
+        event_queue_capacity: None,
     }
 }
 
@@ -47,44 +47,46 @@ pub async fn run(store_path: String, collection: Option<String>, args: ListArgs)
             collection_name, args.limit
         );
 
-        let mut stream = collection.stream_wal_entries().await?;
+        let mut segments = collection.wal_segments().await?;
         let mut count = 0;
 
-        while let Some(result) = stream.next().await {
-            if count >= args.limit {
-                println!("... (truncated, showing first {} entries)", args.limit);
-                break;
-            }
-
-            let entry = result?;
-            count += 1;
-
-            match args.format.as_str() {
-                "json" => {
-                    let json_entry = json!({
-                        "entry_type": format!("{:?}", entry.entry_type),
-                        "transaction_id": entry.transaction_id_str(),
-                        "collection": entry.collection_str(),
-                        "document_id": entry.document_id_str(),
-                        "timestamp": entry.timestamp,
-                        "data_length": entry.data.as_ref().map(|s| s.len()).unwrap_or(0),
-                        "has_data": entry.data.is_some()
-                    });
-                    println!("{}", serde_json::to_string_pretty(&json_entry)?);
-                },
-                "table" => {
-                    println!(
-                        "{:>3} | {:<8} | {:<12} | {:<10} | {}",
-                        count,
-                        format!("{:?}", entry.entry_type),
-                        entry.transaction_id_str(),
-                        entry.document_id_str(),
-                        chrono::DateTime::from_timestamp(entry.timestamp as i64, 0)
-                            .map(|dt| dt.to_rfc3339())
-                            .unwrap_or_else(|| "invalid timestamp".to_owned())
-                    );
-                },
-                _ => unreachable!("Format should have been validated at function start"),
+        'segments: while let Some(segment) = segments.next_segment().await {
+            let segment = segment?;
+            for entry in segment.entries() {
+                if count >= args.limit {
+                    println!("... (truncated, showing first {} entries)", args.limit);
+                    break 'segments;
+                }
+
+                count += 1;
+
+                match args.format.as_str() {
+                    "json" => {
+                        let json_entry = json!({
+                            "entry_type": format!("{:?}", entry.entry_type),
+                            "transaction_id": entry.transaction_id_str(),
+                            "collection": entry.collection_str(),
+                            "document_id": entry.document_id_str(),
+                            "timestamp": entry.timestamp,
+                            "data_length": entry.data().map_or(0, str::len),
+                            "has_data": entry.data().is_some()
+                        });
+                        println!("{}", serde_json::to_string_pretty(&json_entry)?);
+                    },
+                    "table" => {
+                        println!(
+                            "{:>3} | {:<8} | {:<12} | {:<10} | {}",
+                            count,
+                            format!("{:?}", entry.entry_type),
+                            entry.transaction_id_str(),
+                            entry.document_id_str(),
+                            chrono::DateTime::from_timestamp(entry.timestamp as i64, 0)
+                                .map(|dt| dt.to_rfc3339())
+                                .unwrap_or_else(|| "invalid timestamp".to_owned())
+                        );
+                    },
+                    _ => unreachable!("Format should have been validated at function start"),
+                }
             }
         }
 
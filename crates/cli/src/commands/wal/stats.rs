@@ -71,6 +71,34 @@ pub async fn run(store_path: String, collection: Option<String>, _args: StatsArg
         );
     }
 
+    // Timings of the WAL writes made since the store was opened, recovery included
+    let wal = store.metrics().wal;
+    tracing::info!(
+        "  Written since open: {} entries, {} bytes",
+        wal.entries_written,
+        wal.bytes_written
+    );
+    tracing::info!(
+        "  Batch size: mean {:.1} entries, max {} entries",
+        wal.batch_entries.mean(),
+        wal.batch_entries.max
+    );
+    for (operation, latency) in [
+        ("Append", &wal.append),
+        ("Flush", &wal.flush),
+        ("Fsync", &wal.fsync),
+        ("Rotate", &wal.rotate),
+    ] {
+        tracing::info!(
+            "  {} latency: {} ops, p50 {} us, p99 {} us, max {} us",
+            operation,
+            latency.count,
+            latency.p50,
+            latency.p99,
+            latency.max
+        );
+    }
+
     Ok(())
 }
 
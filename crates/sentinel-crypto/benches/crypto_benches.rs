@@ -1,25 +1,61 @@
 use std::hint::black_box;
 
-use criterion::{async_executor::FuturesExecutor, criterion_group, criterion_main, Criterion};
+use criterion::{async_executor::FuturesExecutor, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
 use sentinel_crypto::{
     decrypt_data,
     derive_key_from_passphrase,
     derive_key_from_passphrase_with_salt,
     encrypt_data,
+    hash_bytes,
     hash_data,
     sign_hash,
     verify_signature,
+    EncryptionAlgorithmChoice,
+    EnvelopeCipher,
     SigningKeyManager,
 };
 use serde_json::json;
 
-fn bench_hash_data(c: &mut Criterion) {
-    let data = json!({"key": "value", "number": 42, "array": [1,2,3,4,5]});
+/// Payload sizes for the hashing benchmarks, from a small document to a very large one
+const HASH_PAYLOAD_SIZES: [usize; 5] = [1024, 16 * 1024, 256 * 1024, 1024 * 1024, 10 * 1024 * 1024];
+
+/// Builds a JSON document whose compact serialization is roughly `size` bytes
+/// Document sizes for the envelope benchmarks, from a small document to a large one spanning
+/// many chunks
+const ENVELOPE_PAYLOAD_SIZES: [usize; 4] = [1024, 16 * 1024, 256 * 1024, 1024 * 1024];
+
+/// The ciphers compared by the envelope benchmarks
+const ENVELOPE_ALGORITHMS: [(&str, EncryptionAlgorithmChoice); 3] = [
+    (
+        "xchacha20poly1305",
+        EncryptionAlgorithmChoice::XChaCha20Poly1305,
+    ),
+    ("aes256gcmsiv", EncryptionAlgorithmChoice::Aes256GcmSiv),
+    ("ascon128", EncryptionAlgorithmChoice::Ascon128),
+];
+
+fn hash_payload(size: usize) -> serde_json::Value {
+    let record = json!({"id": 0, "name": "item", "tags": ["a", "b", "c"], "score": 1.5});
+    let record_len = serde_json::to_vec(&record).unwrap().len() + 1;
+    json!({ "records": vec![record; (size / record_len).max(1)] })
+}
 
-    c.bench_function("hash_data", |b| {
-        b.to_async(FuturesExecutor)
-            .iter(|| async { hash_data(black_box(&data)).await })
-    });
+fn bench_hash_data(c: &mut Criterion) {
+    let mut group = c.benchmark_group("hash_data");
+    for size in HASH_PAYLOAD_SIZES {
+        let data = hash_payload(size);
+        let bytes = serde_json::to_vec(&data).unwrap();
+        group.throughput(Throughput::Bytes(bytes.len() as u64));
+        group.bench_with_input(BenchmarkId::new("value", size), &data, |b, data| {
+            b.to_async(FuturesExecutor)
+                .iter(|| async { hash_data(black_box(data)).await })
+        });
+        group.bench_with_input(BenchmarkId::new("bytes", size), &bytes, |b, bytes| {
+            b.to_async(FuturesExecutor)
+                .iter(|| async { hash_bytes(black_box(bytes)).await })
+        });
+    }
+    group.finish();
 }
 
 fn bench_sign_hash(c: &mut Criterion) {
@@ -222,6 +258,45 @@ fn bench_decrypt_data_large(c: &mut Criterion) {
     });
 }
 
+fn bench_envelope_seal(c: &mut Criterion) {
+    let mut group = c.benchmark_group("envelope_seal");
+    for size in ENVELOPE_PAYLOAD_SIZES {
+        let document = serde_json::to_vec(&hash_payload(size)).unwrap();
+        group.throughput(Throughput::Bytes(document.len() as u64));
+        for (name, algorithm) in ENVELOPE_ALGORITHMS {
+            let cipher = EnvelopeCipher::new(algorithm, &[7u8; 32]);
+            group.bench_with_input(BenchmarkId::new(name, size), &document, |b, document| {
+                b.iter(|| cipher.seal(black_box(document)).unwrap())
+            });
+        }
+    }
+    group.finish();
+}
+
+fn bench_envelope_open(c: &mut Criterion) {
+    let mut group = c.benchmark_group("envelope_open");
+    for size in ENVELOPE_PAYLOAD_SIZES {
+        let document = serde_json::to_vec(&hash_payload(size)).unwrap();
+        group.throughput(Throughput::Bytes(document.len() as u64));
+        for (name, algorithm) in ENVELOPE_ALGORITHMS {
+            let cipher = EnvelopeCipher::new(algorithm, &[7u8; 32]);
+            let envelope = cipher.seal(&document).unwrap();
+            group.bench_with_input(BenchmarkId::new(name, size), &envelope, |b, envelope| {
+                b.iter(|| cipher.open(black_box(envelope)).unwrap())
+            });
+        }
+    }
+    group.finish();
+}
+
+fn bench_envelope_derive(c: &mut Criterion) {
+    let cipher = EnvelopeCipher::new(EncryptionAlgorithmChoice::default(), &[7u8; 32]);
+
+    c.bench_function("envelope_derive", |b| {
+        b.iter(|| cipher.derive(black_box("collection")))
+    });
+}
+
 criterion_group!(
     benches,
     bench_hash_data,
@@ -239,6 +314,9 @@ criterion_group!(
     bench_decrypt_data_small,
     bench_decrypt_data_medium,
     bench_decrypt_data_large,
+    bench_envelope_seal,
+    bench_envelope_open,
+    bench_envelope_derive,
     bench_derive_key_from_passphrase,
     bench_derive_key_from_passphrase_with_salt
 );
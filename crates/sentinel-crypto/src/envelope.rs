@@ -0,0 +1,529 @@
+//! Binary envelope for data encrypted at rest.
+//!
+//! [`encrypt_data`](crate::encrypt_data) hex-encodes its output and looks up the global
+//! configuration on every call, which suits wrapping a key but not encrypting every document and
+//! WAL entry of a collection. An [`EnvelopeCipher`] is built once for a key, keeps the initialised
+//! AEAD, and seals data into a compact binary envelope:
+//!
+//! ```text
+//! header: [magic "SENC"][version: u8][algorithm: u8][reserved: 2 bytes][chunk_size: u32_le][nonce prefix]
+//! chunk:  [ciphertext][tag: 16 bytes]
+//! ```
+//!
+//! The plaintext is split into chunks of `chunk_size` bytes sealed one by one, following the
+//! STREAM construction: the nonce of a chunk is the random nonce prefix of the envelope, the chunk
+//! counter (`u32_be`) and a byte set to 1 on the last chunk only, and the header is authenticated
+//! with every chunk. Reordered, truncated or extended envelopes therefore fail to open. Every chunk
+//! is full except the last, which is shorter and possibly empty, so a reader knows the last chunk
+//! when it sees it. [`EnvelopeCipher::seal_to`] and [`EnvelopeCipher::open_from`] work one chunk
+//! at a time, so large values are never buffered in their encrypted form.
+//!
+//! The nonce prefix fills the nonce of the algorithm, 19 bytes for XChaCha20-Poly1305, 11 for
+//! Ascon and 7 for AES-256-GCM-SIV, whose misuse resistance limits a repeated prefix to revealing
+//! which chunks are identical.
+
+use std::io::{Read, Write};
+
+use aes_gcm_siv::Aes256GcmSiv;
+use ascon_aead::AsconAead128;
+use chacha20poly1305::XChaCha20Poly1305;
+use rand::RngCore as _;
+use tracing::trace;
+use zeroize::Zeroizing;
+
+use crate::{error::CryptoError, EncryptionAlgorithmChoice};
+
+/// Magic bytes at the start of every envelope
+pub const ENVELOPE_MAGIC: [u8; 4] = *b"SENC";
+
+/// Version byte following the envelope magic
+pub const ENVELOPE_VERSION: u8 = 1;
+
+/// Default size of the plaintext chunks, in bytes
+pub const DEFAULT_CHUNK_SIZE: u32 = 64 * 1024;
+
+/// Largest accepted chunk size; larger values in a header are treated as corruption
+pub const MAX_CHUNK_SIZE: u32 = 16 * 1024 * 1024;
+
+/// Size of the authentication tag appended to every chunk
+pub const TAG_LEN: usize = 16;
+
+/// Size of the fixed part of the header, before the nonce prefix
+const FIXED_HEADER_LEN: usize = 12;
+
+/// Bytes of a chunk nonce following the prefix: the counter and the last-chunk flag
+const NONCE_SUFFIX_LEN: usize = 5;
+
+/// Context string of the BLAKE3 key derivation of [`EnvelopeCipher::derive`]
+const DERIVE_KEY_CONTEXT: &str = "sentinel-crypto 2026-10 envelope subkey";
+
+/// Returns whether `bytes` start like an envelope.
+pub fn is_envelope(bytes: &[u8]) -> bool { bytes.starts_with(&ENVELOPE_MAGIC) }
+
+/// Identifier of an algorithm in the envelope header
+const fn algorithm_id(algorithm: &EncryptionAlgorithmChoice) -> u8 {
+    match *algorithm {
+        EncryptionAlgorithmChoice::XChaCha20Poly1305 => 1,
+        EncryptionAlgorithmChoice::Aes256GcmSiv => 2,
+        EncryptionAlgorithmChoice::Ascon128 => 3,
+    }
+}
+
+/// Algorithm of an envelope header identifier
+const fn algorithm_from_id(id: u8) -> Option<EncryptionAlgorithmChoice> {
+    match id {
+        1 => Some(EncryptionAlgorithmChoice::XChaCha20Poly1305),
+        2 => Some(EncryptionAlgorithmChoice::Aes256GcmSiv),
+        3 => Some(EncryptionAlgorithmChoice::Ascon128),
+        _ => None,
+    }
+}
+
+/// Nonce size of an algorithm, in bytes
+const fn nonce_len(algorithm: &EncryptionAlgorithmChoice) -> usize {
+    match *algorithm {
+        EncryptionAlgorithmChoice::XChaCha20Poly1305 => 24,
+        EncryptionAlgorithmChoice::Aes256GcmSiv => 12,
+        EncryptionAlgorithmChoice::Ascon128 => 16,
+    }
+}
+
+/// An initialised AEAD, ready to seal and open chunks
+enum ChunkAead {
+    /// XChaCha20-Poly1305 with a 24-byte nonce
+    XChaCha20Poly1305(Box<XChaCha20Poly1305>),
+    /// AES-256-GCM-SIV with a 12-byte nonce
+    Aes256GcmSiv(Box<Aes256GcmSiv>),
+    /// Ascon-AEAD128 with a 16-byte nonce, keyed with the first 16 bytes of the key
+    Ascon128(Box<AsconAead128>),
+}
+
+impl ChunkAead {
+    /// Initialise `algorithm` with `key`
+    fn new(algorithm: &EncryptionAlgorithmChoice, key: &[u8; 32]) -> Self {
+        use aes_gcm_siv::aead::KeyInit as _;
+        use ascon_aead::aead::KeyInit as _;
+        use chacha20poly1305::aead::KeyInit as _;
+
+        match *algorithm {
+            EncryptionAlgorithmChoice::XChaCha20Poly1305 => {
+                Self::XChaCha20Poly1305(Box::new(XChaCha20Poly1305::new(
+                    chacha20poly1305::Key::from_slice(key),
+                )))
+            },
+            EncryptionAlgorithmChoice::Aes256GcmSiv => {
+                Self::Aes256GcmSiv(Box::new(Aes256GcmSiv::new(
+                    aes_gcm_siv::Key::<Aes256GcmSiv>::from_slice(key),
+                )))
+            },
+            EncryptionAlgorithmChoice::Ascon128 => {
+                let (key_16, _) = key.split_at(16);
+                Self::Ascon128(Box::new(AsconAead128::new(
+                    ascon_aead::Key::<AsconAead128>::from_slice(key_16),
+                )))
+            },
+        }
+    }
+
+    /// Seal one chunk, returning its ciphertext followed by the tag
+    fn seal(&self, nonce: &[u8], aad: &[u8], msg: &[u8]) -> Result<Vec<u8>, CryptoError> {
+        use aes_gcm_siv::aead::Aead as _;
+        use ascon_aead::aead::Aead as _;
+        use chacha20poly1305::aead::Aead as _;
+
+        let result = match *self {
+            Self::XChaCha20Poly1305(ref cipher) => {
+                cipher.encrypt(
+                    chacha20poly1305::XNonce::from_slice(nonce),
+                    chacha20poly1305::aead::Payload {
+                        msg,
+                        aad,
+                    },
+                )
+            },
+            Self::Aes256GcmSiv(ref cipher) => {
+                cipher.encrypt(
+                    aes_gcm_siv::Nonce::from_slice(nonce),
+                    aes_gcm_siv::aead::Payload {
+                        msg,
+                        aad,
+                    },
+                )
+            },
+            Self::Ascon128(ref cipher) => {
+                cipher.encrypt(
+                    ascon_aead::Nonce::<AsconAead128>::from_slice(nonce),
+                    ascon_aead::aead::Payload {
+                        msg,
+                        aad,
+                    },
+                )
+            },
+        };
+        result.map_err(|_| CryptoError::Encryption)
+    }
+
+    /// Open one chunk of ciphertext followed by its tag
+    fn open(&self, nonce: &[u8], aad: &[u8], msg: &[u8]) -> Result<Vec<u8>, CryptoError> {
+        use aes_gcm_siv::aead::Aead as _;
+        use ascon_aead::aead::Aead as _;
+        use chacha20poly1305::aead::Aead as _;
+
+        let result = match *self {
+            Self::XChaCha20Poly1305(ref cipher) => {
+                cipher.decrypt(
+                    chacha20poly1305::XNonce::from_slice(nonce),
+                    chacha20poly1305::aead::Payload {
+                        msg,
+                        aad,
+                    },
+                )
+            },
+            Self::Aes256GcmSiv(ref cipher) => {
+                cipher.decrypt(
+                    aes_gcm_siv::Nonce::from_slice(nonce),
+                    aes_gcm_siv::aead::Payload {
+                        msg,
+                        aad,
+                    },
+                )
+            },
+            Self::Ascon128(ref cipher) => {
+                cipher.decrypt(
+                    ascon_aead::Nonce::<AsconAead128>::from_slice(nonce),
+                    ascon_aead::aead::Payload {
+                        msg,
+                        aad,
+                    },
+                )
+            },
+        };
+        result.map_err(|_| CryptoError::Decryption)
+    }
+}
+
+/// The header of an envelope, authenticated with every chunk
+struct Header {
+    /// The encoded header
+    bytes:      Vec<u8>,
+    /// Algorithm the chunks are sealed with
+    algorithm:  EncryptionAlgorithmChoice,
+    /// Size of the plaintext chunks
+    chunk_size: usize,
+}
+
+impl Header {
+    /// Nonce of chunk `counter`, following the nonce prefix of the header
+    fn nonce(&self, counter: u32, last: bool) -> Vec<u8> {
+        let prefix = self.bytes.get(FIXED_HEADER_LEN ..).unwrap_or_default();
+        let mut nonce = Vec::with_capacity(prefix.len().saturating_add(NONCE_SUFFIX_LEN));
+        nonce.extend_from_slice(prefix);
+        nonce.extend_from_slice(&counter.to_be_bytes());
+        nonce.push(u8::from(last));
+        nonce
+    }
+
+    /// Read and validate a header from the start of `reader`
+    fn read_from<R: Read>(reader: &mut R) -> Result<Self, CryptoError> {
+        let mut fixed = [0u8; FIXED_HEADER_LEN];
+        reader
+            .read_exact(&mut fixed)
+            .map_err(|_| CryptoError::Decryption)?;
+        let [m0, m1, m2, m3, version, id, _, _, c0, c1, c2, c3] = fixed;
+        if [m0, m1, m2, m3] != ENVELOPE_MAGIC || version != ENVELOPE_VERSION {
+            return Err(CryptoError::Decryption);
+        }
+        let algorithm = algorithm_from_id(id).ok_or(CryptoError::Decryption)?;
+        let chunk_size = u32::from_le_bytes([c0, c1, c2, c3]);
+        if chunk_size == 0 || chunk_size > MAX_CHUNK_SIZE {
+            return Err(CryptoError::Decryption);
+        }
+
+        let mut bytes = fixed.to_vec();
+        bytes.resize(
+            FIXED_HEADER_LEN
+                .saturating_add(nonce_len(&algorithm))
+                .saturating_sub(NONCE_SUFFIX_LEN),
+            0,
+        );
+        reader
+            .read_exact(bytes.get_mut(FIXED_HEADER_LEN ..).unwrap_or_default())
+            .map_err(|_| CryptoError::Decryption)?;
+        Ok(Self {
+            bytes,
+            algorithm,
+            chunk_size: chunk_size as usize,
+        })
+    }
+}
+
+/// Read from `reader` until `buffer` is full or the input ends, returning the bytes read
+fn read_full<R: Read>(reader: &mut R, buffer: &mut [u8]) -> std::io::Result<usize> {
+    let mut filled = 0usize;
+    while let Some(rest) = buffer.get_mut(filled ..) &&
+        !rest.is_empty()
+    {
+        match reader.read(rest) {
+            Ok(0) => break,
+            Ok(read) => filled = filled.saturating_add(read),
+            Err(e) if e.kind() == std::io::ErrorKind::Interrupted => {},
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(filled)
+}
+
+/// Seals and opens binary envelopes with one key.
+///
+/// The AEAD of the sealing algorithm is initialised once, so a cipher kept for the lifetime of a
+/// collection costs nothing to reuse. Envelopes sealed with another algorithm under the same key
+/// are still opened, the algorithm being recorded in their header. The key is zeroized on drop.
+pub struct EnvelopeCipher {
+    /// The key, kept to open envelopes of other algorithms
+    key:        Zeroizing<[u8; 32]>,
+    /// Algorithm new envelopes are sealed with
+    algorithm:  EncryptionAlgorithmChoice,
+    /// The initialised AEAD of `algorithm`
+    aead:       ChunkAead,
+    /// Size of the plaintext chunks of new envelopes
+    chunk_size: u32,
+}
+
+impl std::fmt::Debug for EnvelopeCipher {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.debug_struct("EnvelopeCipher")
+            .field("algorithm", &self.algorithm)
+            .field("chunk_size", &self.chunk_size)
+            .finish_non_exhaustive()
+    }
+}
+
+impl EnvelopeCipher {
+    /// Create a cipher sealing envelopes with `algorithm` and `key`.
+    pub fn new(algorithm: EncryptionAlgorithmChoice, key: &[u8; 32]) -> Self {
+        Self {
+            key: Zeroizing::new(*key),
+            aead: ChunkAead::new(&algorithm, key),
+            algorithm,
+            chunk_size: DEFAULT_CHUNK_SIZE,
+        }
+    }
+
+    /// Create a cipher for `context`, such as the name of a collection, whose key is derived
+    /// from the key of this one. The new cipher uses the same algorithm and chunk size.
+    ///
+    /// The subkey is derived with BLAKE3 in key derivation mode, which is cheap enough to run
+    /// whenever a collection is opened: the slow passphrase derivation only protects the key of
+    /// the parent cipher, and runs once.
+    pub fn derive(&self, context: &str) -> Self {
+        let mut hasher = blake3::Hasher::new_derive_key(DERIVE_KEY_CONTEXT);
+        hasher.update(self.key.as_slice());
+        hasher.update(context.as_bytes());
+        let key = Zeroizing::new(*hasher.finalize().as_bytes());
+        Self::new(self.algorithm.clone(), &key).with_chunk_size(self.chunk_size)
+    }
+
+    /// Use chunks of `chunk_size` bytes for new envelopes, clamped to `1 ..= MAX_CHUNK_SIZE`.
+    #[must_use]
+    pub fn with_chunk_size(mut self, chunk_size: u32) -> Self {
+        self.chunk_size = chunk_size.clamp(1, MAX_CHUNK_SIZE);
+        self
+    }
+
+    /// Get the algorithm new envelopes are sealed with.
+    pub const fn algorithm(&self) -> &EncryptionAlgorithmChoice { &self.algorithm }
+
+    /// Get the size of an envelope holding `plaintext_len` bytes.
+    pub fn sealed_len(&self, plaintext_len: usize) -> usize {
+        let chunk_size = self.chunk_size as usize;
+        let chunks = (plaintext_len / chunk_size).saturating_add(1);
+        FIXED_HEADER_LEN
+            .saturating_add(nonce_len(&self.algorithm))
+            .saturating_sub(NONCE_SUFFIX_LEN)
+            .saturating_add(plaintext_len)
+            .saturating_add(chunks.saturating_mul(TAG_LEN))
+    }
+
+    /// Seal `plaintext` into a new envelope.
+    ///
+    /// # Errors
+    ///
+    /// * `CryptoError::Encryption` - If a chunk cannot be sealed
+    pub fn seal(&self, plaintext: &[u8]) -> Result<Vec<u8>, CryptoError> {
+        let mut envelope = Vec::with_capacity(self.sealed_len(plaintext.len()));
+        self.seal_to(plaintext, &mut envelope)?;
+        Ok(envelope)
+    }
+
+    /// Seal `plaintext` into an envelope written to `writer` one chunk at a time, returning the
+    /// number of bytes written.
+    ///
+    /// # Errors
+    ///
+    /// * `CryptoError::Encryption` - If a chunk cannot be sealed or there are too many chunks
+    /// * `CryptoError::Io` - If writing fails
+    pub fn seal_to<W: Write>(&self, plaintext: &[u8], mut writer: W) -> Result<u64, CryptoError> {
+        let mut header = Vec::with_capacity(FIXED_HEADER_LEN.saturating_add(nonce_len(&self.algorithm)));
+        header.extend_from_slice(&ENVELOPE_MAGIC);
+        header.push(ENVELOPE_VERSION);
+        header.push(algorithm_id(&self.algorithm));
+        header.extend_from_slice(&[0u8; 2]);
+        header.extend_from_slice(&self.chunk_size.to_le_bytes());
+        let mut prefix = vec![0u8; nonce_len(&self.algorithm).saturating_sub(NONCE_SUFFIX_LEN)];
+        rand::rng().fill_bytes(&mut prefix);
+        header.extend_from_slice(&prefix);
+        let header = Header {
+            bytes:      header,
+            algorithm:  self.algorithm.clone(),
+            chunk_size: self.chunk_size as usize,
+        };
+        writer.write_all(&header.bytes)?;
+        let mut written = header.bytes.len() as u64;
+
+        // The last chunk is always shorter than a full one, empty if the plaintext fills them all
+        let mut chunks = plaintext.chunks(header.chunk_size).peekable();
+        let mut counter = 0u32;
+        loop {
+            let chunk = chunks.next().unwrap_or_default();
+            let last = chunk.len() < header.chunk_size && chunks.peek().is_none();
+            let sealed = self
+                .aead
+                .seal(&header.nonce(counter, last), &header.bytes, chunk)?;
+            writer.write_all(&sealed)?;
+            written = written.saturating_add(sealed.len() as u64);
+            if last {
+                break;
+            }
+            counter = counter.checked_add(1).ok_or(CryptoError::Encryption)?;
+        }
+        writer.flush()?;
+
+        trace!(
+            "Sealed {} bytes into a {} byte envelope ({} chunks)",
+            plaintext.len(),
+            written,
+            counter.saturating_add(1)
+        );
+        Ok(written)
+    }
+
+    /// Open an envelope held in memory.
+    ///
+    /// # Errors
+    ///
+    /// * `CryptoError::Decryption` - If the envelope is malformed, truncated or was not sealed with
+    ///   this key
+    pub fn open(&self, envelope: &[u8]) -> Result<Vec<u8>, CryptoError> { self.open_from(envelope) }
+
+    /// Open an envelope read from `reader` one chunk at a time.
+    ///
+    /// Only one chunk of ciphertext is held in memory at a time; the plaintext is returned whole.
+    ///
+    /// # Errors
+    ///
+    /// * `CryptoError::Decryption` - If the envelope is malformed, truncated or was not sealed with
+    ///   this key
+    /// * `CryptoError::Io` - If reading fails
+    pub fn open_from<R: Read>(&self, mut reader: R) -> Result<Vec<u8>, CryptoError> {
+        let header = Header::read_from(&mut reader)?;
+        let other;
+        let aead = if header.algorithm == self.algorithm {
+            &self.aead
+        }
+        else {
+            other = ChunkAead::new(&header.algorithm, &self.key);
+            &other
+        };
+
+        let mut plaintext = Vec::new();
+        let mut chunk = vec![0u8; header.chunk_size.saturating_add(TAG_LEN)];
+        let mut counter = 0u32;
+        loop {
+            let read = read_full(&mut reader, &mut chunk)?;
+            let last = read < chunk.len();
+            let sealed = chunk.get(.. read).unwrap_or_default();
+            plaintext.extend_from_slice(&aead.open(&header.nonce(counter, last), &header.bytes, sealed)?);
+            if last {
+                break;
+            }
+            counter = counter.checked_add(1).ok_or(CryptoError::Decryption)?;
+        }
+
+        trace!(
+            "Opened a {} byte envelope ({} chunks)",
+            plaintext.len(),
+            counter.saturating_add(1)
+        );
+        Ok(plaintext)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Every supported algorithm
+    fn algorithms() -> [EncryptionAlgorithmChoice; 3] {
+        [
+            EncryptionAlgorithmChoice::XChaCha20Poly1305,
+            EncryptionAlgorithmChoice::Aes256GcmSiv,
+            EncryptionAlgorithmChoice::Ascon128,
+        ]
+    }
+
+    #[test]
+    fn test_envelope_round_trips_across_chunk_boundaries() {
+        for algorithm in algorithms() {
+            let cipher = EnvelopeCipher::new(algorithm, &[7u8; 32]).with_chunk_size(16);
+            for len in [0, 1, 15, 16, 17, 32, 100] {
+                let plaintext = (0 .. len).map(|i| i as u8).collect::<Vec<_>>();
+                let envelope = cipher.seal(&plaintext).unwrap();
+                assert!(is_envelope(&envelope));
+                assert_eq!(envelope.len(), cipher.sealed_len(len));
+                assert_eq!(cipher.open(&envelope).unwrap(), plaintext);
+            }
+        }
+    }
+
+    #[test]
+    fn test_envelope_rejects_tampering() {
+        let cipher = EnvelopeCipher::new(EncryptionAlgorithmChoice::XChaCha20Poly1305, &[1u8; 32]).with_chunk_size(8);
+        let envelope = cipher.seal(b"a value spanning several chunks").unwrap();
+        let header_len = cipher.sealed_len(0) - TAG_LEN;
+
+        let mut flipped = envelope.clone();
+        *flipped.last_mut().unwrap() ^= 1;
+        assert!(cipher.open(&flipped).is_err());
+
+        // Dropping the last chunk leaves a full chunk that was not sealed as the last one
+        let chunk_len = 8 + TAG_LEN;
+        let truncated = &envelope[.. envelope.len() - (envelope.len() - header_len) % chunk_len];
+        assert!(cipher.open(truncated).is_err());
+
+        let mut reordered = envelope.clone();
+        reordered[header_len .. header_len + 2 * chunk_len].rotate_left(chunk_len);
+        assert!(cipher.open(&reordered).is_err());
+
+        let mut downgraded = envelope.clone();
+        downgraded[8] = 16;
+        assert!(cipher.open(&downgraded).is_err());
+
+        let other = EnvelopeCipher::new(EncryptionAlgorithmChoice::XChaCha20Poly1305, &[2u8; 32]);
+        assert!(other.open(&envelope).is_err());
+        assert!(cipher.open(b"SENC").is_err());
+        assert!(cipher.open(b"not an envelope").is_err());
+    }
+
+    #[test]
+    fn test_derived_ciphers_are_separated_by_context() {
+        let master = EnvelopeCipher::new(EncryptionAlgorithmChoice::Aes256GcmSiv, &[9u8; 32]);
+        let users = master.derive("users");
+        let envelope = users.seal(b"secret").unwrap();
+        assert!(master.derive("orders").open(&envelope).is_err());
+        assert!(master.open(&envelope).is_err());
+
+        // Envelopes record their algorithm, so a cipher with another default still opens them
+        let ascon = EnvelopeCipher::new(EncryptionAlgorithmChoice::Ascon128, &[9u8; 32]);
+        assert_eq!(ascon.derive("users").open(&envelope).unwrap(), b"secret");
+    }
+}
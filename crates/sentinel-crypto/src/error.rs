@@ -60,6 +60,10 @@ pub enum CryptoError {
     /// Global config already set
     #[error("Global config already set")]
     ConfigAlreadySet,
+
+    /// I/O errors while streaming an envelope
+    #[error("I/O error: {0}")]
+    Io(#[from] std::io::Error),
 }
 
 /// Specific errors for hashing operations
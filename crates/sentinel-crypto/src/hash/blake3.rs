@@ -1,8 +1,20 @@
+use std::io;
+
 use serde_json::Value;
 use tracing::trace;
 
 use crate::{error::CryptoError, hash_trait::HashFunction};
 
+/// Input size from which BLAKE3 hashes a chunk on the rayon thread pool.
+///
+/// Below this size, handing the work to other threads costs more than it saves.
+pub const PARALLEL_HASH_THRESHOLD: usize = 128 * 1024;
+
+/// Amount of serialized data buffered before it is fed to the hasher.
+///
+/// Large enough that every full batch is hashed in parallel.
+const HASH_BATCH_LEN: usize = 1024 * 1024;
+
 /// Blake3 hash implementation.
 /// Uses the BLAKE3 cryptographic hash function, which provides high performance
 /// and security. Supports parallel computation for large inputs.
@@ -15,16 +27,68 @@ pub struct Blake3Hasher;
 impl HashFunction for Blake3Hasher {
     fn hash_data(data: &Value) -> Result<String, CryptoError> {
         trace!("Hashing data with Blake3");
-        let json_str = serde_json::to_string(data).map_err(CryptoError::from)?;
-        let hash = blake3::hash(json_str.as_bytes());
-        let hash_str = hash.to_hex().to_string();
+        let mut writer = HashWriter::default();
+        serde_json::to_writer(&mut writer, data).map_err(CryptoError::from)?;
+        let hash_str = writer.finalize().to_hex().to_string();
         trace!("Blake3 hash computed: {}", hash_str);
         Ok(hash_str)
     }
+
+    fn hash_bytes(bytes: &[u8]) -> String {
+        trace!("Hashing {} bytes with Blake3", bytes.len());
+        let mut hasher = blake3::Hasher::new();
+        update(&mut hasher, bytes);
+        let hash_str = hasher.finalize().to_hex().to_string();
+        trace!("Blake3 hash computed: {}", hash_str);
+        hash_str
+    }
 }
 
 impl crate::hash_trait::private::Sealed for Blake3Hasher {}
 
+/// Feeds `bytes` to `hasher`, in parallel when the input is large enough to benefit.
+fn update(hasher: &mut blake3::Hasher, bytes: &[u8]) {
+    if bytes.len() >= PARALLEL_HASH_THRESHOLD {
+        hasher.update_rayon(bytes);
+    }
+    else {
+        hasher.update(bytes);
+    }
+}
+
+/// Sink for a streaming serializer that hashes the bytes written to it.
+///
+/// The serializer writes many small pieces, so they are batched before reaching the hasher. The
+/// batch grows only as far as the input needs, so small documents never allocate a full batch.
+#[derive(Default)]
+struct HashWriter {
+    /// The running hash of every flushed batch.
+    hasher: blake3::Hasher,
+    /// Bytes written since the last flushed batch.
+    batch:  Vec<u8>,
+}
+
+impl HashWriter {
+    /// Hashes the remaining batch and returns the hash of everything written.
+    fn finalize(mut self) -> blake3::Hash {
+        update(&mut self.hasher, &self.batch);
+        self.hasher.finalize()
+    }
+}
+
+impl io::Write for HashWriter {
+    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+        self.batch.extend_from_slice(buf);
+        if self.batch.len() >= HASH_BATCH_LEN {
+            update(&mut self.hasher, &self.batch);
+            self.batch.clear();
+        }
+        Ok(buf.len())
+    }
+
+    fn flush(&mut self) -> io::Result<()> { Ok(()) }
+}
+
 #[test]
 fn test_blake3_hash() {
     let data = serde_json::json!({"key": "value", "number": 42});
@@ -33,3 +97,20 @@ fn test_blake3_hash() {
     let hash2 = Blake3Hasher::hash_data(&data).unwrap();
     assert_eq!(hash, hash2);
 }
+
+#[test]
+fn test_blake3_hash_matches_serialized_bytes() {
+    let small = serde_json::json!({"key": "value", "number": 42});
+    let large = serde_json::json!({"blob": "x".repeat(3 * HASH_BATCH_LEN)});
+    for data in [small, large] {
+        let bytes = serde_json::to_vec(&data).unwrap();
+        assert_eq!(
+            Blake3Hasher::hash_data(&data).unwrap(),
+            Blake3Hasher::hash_bytes(&bytes)
+        );
+        assert_eq!(
+            Blake3Hasher::hash_bytes(&bytes),
+            blake3::hash(&bytes).to_hex().to_string()
+        );
+    }
+}
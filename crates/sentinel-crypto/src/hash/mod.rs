@@ -1,3 +1,3 @@
 pub mod blake3;
 
-pub use blake3::Blake3Hasher;
+pub use blake3::{Blake3Hasher, PARALLEL_HASH_THRESHOLD};
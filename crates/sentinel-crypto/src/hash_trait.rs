@@ -24,6 +24,17 @@ pub trait HashFunction: private::Sealed {
     /// # Errors
     /// Returns `CryptoError::Hashing` if JSON serialization fails
     fn hash_data(data: &Value) -> Result<String, CryptoError>;
+
+    /// Computes a cryptographic hash of already canonicalized bytes.
+    /// Hashing the JSON serialization of a value yields the same digest as
+    /// `hash_data` on that value, without serializing it again.
+    ///
+    /// # Arguments
+    /// * `bytes` - The canonical bytes to hash
+    ///
+    /// # Returns
+    /// A hex-encoded string representing the hash digest
+    fn hash_bytes(bytes: &[u8]) -> String;
 }
 
 // Sealing the trait to prevent external implementations
@@ -28,6 +28,9 @@
 //!
 //! - BLAKE3: High-performance hash function with parallel support.
 //! - Ed25519: Fast elliptic curve signatures with 128-bit security.
+//! - [`EnvelopeCipher`]: Data at rest is sealed into binary, chunked envelopes by a cipher that is
+//!   initialised once per key, with per-collection subkeys derived by BLAKE3 instead of a new
+//!   passphrase derivation.
 //!
 //! ## Usage
 //!
@@ -50,6 +53,7 @@
 pub mod crypto_config;
 pub mod encrypt;
 pub mod encrypt_trait;
+pub mod envelope;
 pub mod error;
 pub mod hash;
 pub mod hash_trait;
@@ -63,6 +67,7 @@ pub use crypto_config::*;
 pub use ed25519_dalek::{Signature, SigningKey, VerifyingKey};
 pub use encrypt::{Aes256GcmSivEncryptor, Ascon128Encryptor, EncryptionKeyManager, XChaCha20Poly1305Encryptor};
 pub use encrypt_trait::EncryptionAlgorithm;
+pub use envelope::{is_envelope, EnvelopeCipher};
 pub use error::CryptoError;
 pub use hash_trait::HashFunction;
 pub use key_derivation::{Argon2KeyDerivation, Pbkdf2KeyDerivation};
@@ -86,6 +91,20 @@ pub async fn hash_data(data: &Value) -> Result<String, CryptoError> {
     result
 }
 
+/// Computes the hash of canonical JSON bytes using the globally configured algorithm.
+///
+/// The digest equals that of [`hash_data`] on the value the bytes serialize, so callers holding
+/// the compact JSON of a value can skip deserializing and re-serializing it.
+pub async fn hash_bytes(bytes: &[u8]) -> Result<String, CryptoError> {
+    trace!("Hashing {} bytes using global config", bytes.len());
+    let config = get_global_crypto_config().await?;
+    let hash = match config.hash_algorithm {
+        HashAlgorithmChoice::Blake3 => crate::hash::Blake3Hasher::hash_bytes(bytes),
+    };
+    debug!("Bytes hashed successfully: {}", hash);
+    Ok(hash)
+}
+
 /// Signs the given hash using the globally configured algorithm.
 pub async fn sign_hash(hash: &str, private_key: &SigningKey) -> Result<String, CryptoError> {
     trace!("Signing hash using global config");
@@ -110,6 +129,24 @@ pub async fn verify_signature(hash: &str, signature: &str, public_key: &Verifyin
     result
 }
 
+/// Verifies many `(hash, signature)` pairs made with one key using the globally configured
+/// algorithm.
+///
+/// The configuration is looked up once for the whole batch. Each item gets its own result, in
+/// order, with the same meaning as the result of [`verify_signature`].
+pub async fn verify_signatures(
+    items: &[(&str, &str)],
+    public_key: &VerifyingKey,
+) -> Result<Vec<Result<bool, CryptoError>>, CryptoError> {
+    trace!("Verifying {} signatures using global config", items.len());
+    let config = get_global_crypto_config().await?;
+    let results = match config.signature_algorithm {
+        SignatureAlgorithmChoice::Ed25519 => Ed25519Signer::verify_signatures(items, public_key),
+    };
+    debug!("Verified a batch of {} signatures", results.len());
+    Ok(results)
+}
+
 /// Encrypts data using the globally configured algorithm.
 pub async fn encrypt_data(data: &[u8], key: &[u8; 32]) -> Result<String, CryptoError> {
     trace!(
@@ -208,6 +245,17 @@ mod tests {
         assert_eq!(hash, hash2);
     }
 
+    #[tokio::test]
+    async fn test_hash_bytes_matches_hash_data() {
+        init_logging();
+        let data = serde_json::json!({"key": "value", "number": 42});
+        let bytes = serde_json::to_vec(&data).unwrap();
+        assert_eq!(
+            hash_bytes(&bytes).await.unwrap(),
+            hash_data(&data).await.unwrap()
+        );
+    }
+
     #[tokio::test]
     #[serial_test::serial]
     async fn test_set_global_crypto_config_already_set() {
@@ -346,6 +394,29 @@ mod tests {
         // Should be Decryption error
     }
 
+    #[tokio::test]
+    async fn test_verify_signatures_batch() {
+        init_logging();
+        let key = SigningKey::from_bytes(&[0u8; 32]);
+        let hashes = ["hash_a", "hash_b", "hash_c", "hash_d", "hash_e"];
+        let mut signatures = Vec::new();
+        for hash in hashes {
+            signatures.push(sign_hash(hash, &key).await.unwrap());
+        }
+        let mut items: Vec<(&str, &str)> = hashes
+            .iter()
+            .zip(&signatures)
+            .map(|(hash, signature)| (*hash, signature.as_str()))
+            .collect();
+        items[2].0 = "tampered";
+
+        let results = verify_signatures(&items, &key.verifying_key())
+            .await
+            .unwrap();
+        let valid: Vec<bool> = results.into_iter().map(|r| r.unwrap()).collect();
+        assert_eq!(valid, vec![true, true, false, true, true]);
+    }
+
     #[tokio::test]
     async fn test_verify_signature_invalid_hex() {
         init_logging();
@@ -29,16 +29,84 @@ impl SignatureAlgorithm for Ed25519Signer {
 
     fn verify_signature(hash: &str, signature: &str, public_key: &VerifyingKey) -> Result<bool, CryptoError> {
         trace!("Verifying signature with Ed25519");
-        let sig_bytes = hex::decode(signature).map_err(CryptoError::Hex)?;
-        let sig_array: [u8; 64] = sig_bytes
-            .as_slice()
-            .try_into()
-            .map_err(|_| CryptoError::InvalidSignatureLength)?;
-        let sig = Signature::from_bytes(&sig_array);
+        let sig = parse_signature(signature)?;
         let is_valid = public_key.verify(hash.as_bytes(), &sig).is_ok();
         debug!("Ed25519 signature verification result: {}", is_valid);
         Ok(is_valid)
     }
+
+    fn verify_signatures(items: &[(&str, &str)], public_key: &VerifyingKey) -> Vec<Result<bool, CryptoError>> {
+        trace!("Verifying {} signatures with Ed25519", items.len());
+        let parsed: Vec<Result<Signature, CryptoError>> = items
+            .iter()
+            .map(|&(_, signature)| parse_signature(signature))
+            .collect();
+        let mut messages = Vec::with_capacity(items.len());
+        let mut signatures = Vec::with_capacity(items.len());
+        for (&(hash, _), sig) in items.iter().zip(&parsed) {
+            if let Ok(ref sig) = *sig {
+                messages.push(hash.as_bytes());
+                signatures.push(*sig);
+            }
+        }
+
+        let keys = vec![*public_key; signatures.len()];
+        let mut valid = vec![false; signatures.len()];
+        verify_group(&messages, &signatures, &keys, &mut valid);
+        debug!(
+            "Ed25519 batch verification: {} of {} signatures valid",
+            valid.iter().filter(|&&ok| ok).count(),
+            items.len()
+        );
+
+        let mut valid = valid.into_iter();
+        parsed
+            .into_iter()
+            .map(|sig| sig.map(|_| valid.next().unwrap_or(false)))
+            .collect()
+    }
+}
+
+/// Smallest group verified as a batch; smaller groups are verified one signature at a time.
+const MIN_BATCH_LEN: usize = 4;
+
+/// Decodes a hex-encoded Ed25519 signature.
+fn parse_signature(signature: &str) -> Result<Signature, CryptoError> {
+    let sig_bytes = hex::decode(signature).map_err(CryptoError::Hex)?;
+    let sig_array: [u8; 64] = sig_bytes
+        .as_slice()
+        .try_into()
+        .map_err(|_| CryptoError::InvalidSignatureLength)?;
+    Ok(Signature::from_bytes(&sig_array))
+}
+
+/// Verifies a group of signatures as one batch, writing the outcome of each into `valid`.
+///
+/// A rejected batch only says that some signature is invalid, so it is split in halves that are
+/// verified in turn until the invalid signatures are isolated. A few bad signatures in a large
+/// scan therefore cost a handful of extra batches rather than one verification per signature.
+fn verify_group(messages: &[&[u8]], signatures: &[Signature], keys: &[VerifyingKey], valid: &mut [bool]) {
+    if signatures.len() < MIN_BATCH_LEN {
+        for (((message, signature), key), ok) in messages.iter().zip(signatures).zip(keys).zip(valid) {
+            *ok = key.verify(message, signature).is_ok();
+        }
+        return;
+    }
+    if ed25519_dalek::verify_batch(messages, signatures, keys).is_ok() {
+        valid.fill(true);
+        return;
+    }
+    trace!(
+        "Ed25519 batch of {} signatures rejected, splitting it",
+        signatures.len()
+    );
+    let mid = signatures.len() / 2;
+    let (messages_left, messages_right) = messages.split_at(mid);
+    let (signatures_left, signatures_right) = signatures.split_at(mid);
+    let (keys_left, keys_right) = keys.split_at(mid);
+    let (valid_left, valid_right) = valid.split_at_mut(mid);
+    verify_group(messages_left, signatures_left, keys_left, valid_left);
+    verify_group(messages_right, signatures_right, keys_right, valid_right);
 }
 
 impl crate::sign_trait::private::Sealed for Ed25519Signer {}
@@ -64,4 +132,34 @@ mod tests {
         let is_valid_wrong = Ed25519Signer::verify_signature("wrong", &signature, &public_key).unwrap();
         assert!(!is_valid_wrong);
     }
+
+    #[test]
+    fn test_ed25519_verify_signatures_pinpoints_failures() {
+        let private_key = SigningKey::from_bytes(&random());
+        let public_key = private_key.verifying_key();
+
+        let hashes: Vec<String> = (0 .. 20).map(|i| format!("hash_{}", i)).collect();
+        let mut signatures: Vec<String> = hashes
+            .iter()
+            .map(|hash| Ed25519Signer::sign_hash(hash, &private_key).unwrap())
+            .collect();
+        signatures[3] = Ed25519Signer::sign_hash("other", &private_key).unwrap();
+        signatures[17] = "not hex".to_owned();
+        let items: Vec<(&str, &str)> = hashes
+            .iter()
+            .zip(&signatures)
+            .map(|(hash, signature)| (hash.as_str(), signature.as_str()))
+            .collect();
+
+        let results = Ed25519Signer::verify_signatures(&items, &public_key);
+        assert_eq!(results.len(), items.len());
+        for (i, result) in results.iter().enumerate() {
+            match i {
+                3 => assert!(!result.as_ref().unwrap()),
+                17 => assert!(result.is_err()),
+                _ => assert!(result.as_ref().unwrap()),
+            }
+        }
+        assert!(Ed25519Signer::verify_signatures(&[], &public_key).is_empty());
+    }
 }
@@ -42,6 +42,19 @@ pub trait SignatureAlgorithm: private::Sealed {
     /// # Errors
     /// Returns `CryptoError` if verification process fails
     fn verify_signature(hash: &str, signature: &str, public_key: &Self::VerifyingKey) -> Result<bool, CryptoError>;
+
+    /// Verifies many signatures made with the same key at once.
+    /// Batches are checked together where the scheme allows it, which is
+    /// much cheaper than one `verify_signature` call per item; when a batch
+    /// is rejected, the failing items are singled out.
+    ///
+    /// # Arguments
+    /// * `items` - The `(hash, hex-encoded signature)` pairs to verify
+    /// * `public_key` - The verifying key
+    ///
+    /// # Returns
+    /// One result per item, in order, with the same meaning as `verify_signature`
+    fn verify_signatures(items: &[(&str, &str)], public_key: &Self::VerifyingKey) -> Vec<Result<bool, CryptoError>>;
 }
 
 // Sealing the trait to prevent external implementations
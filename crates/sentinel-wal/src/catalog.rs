@@ -0,0 +1,241 @@
+//! Catalog of rotated WAL segments.
+//!
+//! The catalog is a small JSON file stored next to the current WAL file. It lists every rotated
+//! segment with its LSN range, compression state and checkpoint status, and records the LSN up to
+//! which a checkpoint confirmed the data files contain the logged changes. Readers start from
+//! that LSN instead of from the beginning of the log, and checkpoints use it to archive or delete
+//! segments the data files fully cover.
+//!
+//! The catalog is rewritten atomically (write to a temporary file, then rename) whenever a segment
+//! is rotated, compressed or checkpointed.
+
+use std::path::{Path, PathBuf};
+
+use serde::{Deserialize, Serialize};
+use tracing::{debug, trace};
+
+use crate::{CompressionAlgorithm, Result, WalError};
+
+/// Version of the catalog layout
+pub const CATALOG_VERSION: u32 = 1;
+
+/// A rotated WAL segment
+#[derive(Debug, Clone, PartialEq, Eq, Serialize, Deserialize)]
+pub struct SegmentInfo {
+    /// File name of the uncompressed segment, relative to the WAL directory
+    pub file_name:    String,
+    /// LSN of the first entry of the segment
+    pub first_lsn:    u64,
+    /// LSN of the last entry of the segment, `first_lsn - 1` for an empty segment
+    pub last_lsn:     u64,
+    /// Compression applied to the segment file, if any
+    pub compression:  Option<CompressionAlgorithm>,
+    /// Whether a checkpoint covers every entry of the segment
+    pub checkpointed: bool,
+}
+
+impl SegmentInfo {
+    /// Path of the segment file in `dir`, taking its compression into account
+    pub fn path_in(&self, dir: &Path) -> PathBuf {
+        let path = dir.join(&self.file_name);
+        match self.compression {
+            Some(alg) => compressed_path(&path, alg),
+            None => path,
+        }
+    }
+}
+
+/// Path of the compressed copy of a WAL segment
+pub fn compressed_path(path: &Path, alg: CompressionAlgorithm) -> PathBuf {
+    match alg {
+        CompressionAlgorithm::Zstd => path.with_extension("wal.zst"),
+        CompressionAlgorithm::Lz4 => path.with_extension("wal.lz4"),
+        CompressionAlgorithm::Brotli => path.with_extension("wal.br"),
+        CompressionAlgorithm::Deflate => path.with_extension("wal.deflate"),
+        CompressionAlgorithm::Gzip => path.with_extension("wal.gz"),
+    }
+}
+
+/// Persistent catalog of the segments of one WAL
+#[derive(Debug, Clone, PartialEq, Eq, Serialize, Deserialize)]
+pub struct SegmentCatalog {
+    /// Layout version, see [`CATALOG_VERSION`]
+    pub version:           u32,
+    /// Sequence number given to the next rotated segment
+    pub next_segment:      u64,
+    /// Highest LSN covered by a checkpoint, `0` before the first checkpoint
+    pub checkpoint_lsn:    u64,
+    /// LSN of the first entry of the current WAL file
+    pub current_first_lsn: u64,
+    /// Rotated segments, oldest first
+    pub segments:          Vec<SegmentInfo>,
+}
+
+impl Default for SegmentCatalog {
+    fn default() -> Self {
+        Self {
+            version:           CATALOG_VERSION,
+            next_segment:      1,
+            checkpoint_lsn:    0,
+            current_first_lsn: 1,
+            segments:          Vec::new(),
+        }
+    }
+}
+
+impl SegmentCatalog {
+    /// Path of the catalog belonging to the WAL file at `wal_path`
+    pub fn path_for(wal_path: &Path) -> PathBuf { wal_path.with_extension("catalog.json") }
+
+    /// Load the catalog from `path`, or start an empty one if the file does not exist.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::Io` - If the file exists but cannot be read
+    /// * `WalError::Serialization` - If the file is not a valid catalog
+    pub async fn load(path: &Path) -> Result<Self> {
+        match tokio::fs::read(path).await {
+            Ok(bytes) => {
+                let catalog: Self = serde_json::from_slice(&bytes)
+                    .map_err(|e| WalError::Serialization(format!("Invalid WAL segment catalog: {}", e)))?;
+                debug!(
+                    "Loaded WAL segment catalog {:?} with {} segments, checkpoint LSN {}",
+                    path,
+                    catalog.segments.len(),
+                    catalog.checkpoint_lsn
+                );
+                Ok(catalog)
+            },
+            Err(e) if e.kind() == std::io::ErrorKind::NotFound => {
+                trace!("No WAL segment catalog at {:?}, starting a new one", path);
+                Ok(Self::default())
+            },
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    /// Atomically write the catalog to `path`.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::Serialization` - If the catalog cannot be serialized
+    /// * `WalError::Io` - If the file cannot be written or renamed
+    pub async fn save(&self, path: &Path) -> Result<()> {
+        let bytes = serde_json::to_vec_pretty(self).map_err(|e| WalError::Serialization(e.to_string()))?;
+        let tmp_path = path.with_extension("json.tmp");
+        let mut file = tokio::fs::File::create(&tmp_path).await?;
+        tokio::io::AsyncWriteExt::write_all(&mut file, &bytes).await?;
+        file.sync_all().await?;
+        drop(file);
+        tokio::fs::rename(&tmp_path, path).await?;
+        trace!("Saved WAL segment catalog {:?}", path);
+        Ok(())
+    }
+
+    /// Record the current file, rotated out as `file_name`, and start a new current file at
+    /// `next_lsn`
+    pub fn record_rotation(&mut self, file_name: String, next_lsn: u64) {
+        let last_lsn = next_lsn.saturating_sub(1);
+        self.segments.push(SegmentInfo {
+            file_name,
+            first_lsn: self.current_first_lsn,
+            last_lsn,
+            compression: None,
+            checkpointed: last_lsn <= self.checkpoint_lsn,
+        });
+        self.next_segment = self.next_segment.saturating_add(1);
+        self.current_first_lsn = next_lsn;
+    }
+
+    /// Record that the segment `file_name` has been compressed with `alg`
+    pub fn record_compression(&mut self, file_name: &str, alg: CompressionAlgorithm) {
+        if let Some(segment) = self
+            .segments
+            .iter_mut()
+            .find(|segment| segment.file_name == file_name)
+        {
+            segment.compression = Some(alg);
+        }
+    }
+
+    /// Record a checkpoint covering every entry up to `lsn` and mark the covered segments
+    pub fn record_checkpoint(&mut self, lsn: u64) {
+        self.checkpoint_lsn = self.checkpoint_lsn.max(lsn);
+        for segment in &mut self.segments {
+            segment.checkpointed = segment.last_lsn <= self.checkpoint_lsn;
+        }
+    }
+
+    /// Remove the checkpointed segments from the catalog and return them
+    pub fn take_checkpointed(&mut self) -> Vec<SegmentInfo> {
+        let (checkpointed, live) = std::mem::take(&mut self.segments)
+            .into_iter()
+            .partition(|segment| segment.checkpointed);
+        self.segments = live;
+        checkpointed
+    }
+
+    /// Whether `file_name` is one of the cataloged segments
+    pub fn contains(&self, file_name: &str) -> bool {
+        self.segments
+            .iter()
+            .any(|segment| segment.file_name == file_name)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use tempfile::tempdir;
+
+    use super::*;
+
+    #[test]
+    fn test_rotation_and_checkpoint_track_lsn_ranges() {
+        let mut catalog = SegmentCatalog::default();
+        catalog.record_rotation("wal.0000000001.wal".to_owned(), 11);
+        catalog.record_rotation("wal.0000000002.wal".to_owned(), 21);
+        assert_eq!(catalog.next_segment, 3);
+        assert_eq!(catalog.current_first_lsn, 21);
+        assert_eq!(
+            (catalog.segments[1].first_lsn, catalog.segments[1].last_lsn),
+            (11, 20)
+        );
+
+        catalog.record_checkpoint(15);
+        assert!(catalog.segments[0].checkpointed);
+        assert!(!catalog.segments[1].checkpointed);
+
+        let retired = catalog.take_checkpointed();
+        assert_eq!(retired.len(), 1);
+        assert_eq!(retired[0].file_name, "wal.0000000001.wal");
+        assert!(!catalog.contains("wal.0000000001.wal"));
+        assert!(catalog.contains("wal.0000000002.wal"));
+    }
+
+    #[test]
+    fn test_compressed_segment_path() {
+        let mut catalog = SegmentCatalog::default();
+        catalog.record_rotation("wal.0000000001.wal".to_owned(), 2);
+        catalog.record_compression("wal.0000000001.wal", CompressionAlgorithm::Zstd);
+        assert_eq!(
+            catalog.segments[0].path_in(Path::new("dir")),
+            Path::new("dir/wal.0000000001.wal.zst")
+        );
+    }
+
+    #[tokio::test]
+    async fn test_catalog_roundtrip() {
+        let temp_dir = tempdir().unwrap();
+        let path = SegmentCatalog::path_for(&temp_dir.path().join("wal.wal"));
+        assert_eq!(
+            SegmentCatalog::load(&path).await.unwrap(),
+            SegmentCatalog::default()
+        );
+
+        let mut catalog = SegmentCatalog::default();
+        catalog.record_rotation("wal.0000000001.wal".to_owned(), 4);
+        catalog.record_checkpoint(3);
+        catalog.save(&path).await.unwrap();
+        assert_eq!(SegmentCatalog::load(&path).await.unwrap(), catalog);
+    }
+}
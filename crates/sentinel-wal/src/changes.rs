@@ -0,0 +1,482 @@
+//! Change feed over the WAL.
+//!
+//! [`WalManager::changes_since`] streams the changes logged after a given LSN, across rotated and
+//! compressed segments, in batches carrying a resume cursor. Only committed changes are
+//! delivered: entries outside any transaction as they are read, and entries of a
+//! `Begin`/`Commit` transaction once its commit is read, while rolled back transactions are
+//! dropped.
+//!
+//! Delivery is at least once. The cursor of a batch is the highest LSN such that every change
+//! after it is either in a later batch or still to be read, so it never moves past the `Begin`
+//! of a transaction still waiting for its commit. Resuming from such a cursor delivers again the
+//! changes that were logged between that `Begin` and the end of the log; consumers keep changes
+//! idempotent or skip LSNs they already applied.
+//!
+//! The feed reads the segments the catalog still lists. Segments retired by a checkpoint under
+//! [`WalRetention::Delete`](crate::WalRetention::Delete) or
+//! [`WalRetention::Archive`](crate::WalRetention::Archive) are gone from it, so followers that
+//! may lag behind checkpoints need [`WalRetention::Keep`](crate::WalRetention::Keep).
+
+use std::{collections::HashMap, sync::Arc};
+
+use async_stream::stream;
+use futures::Stream;
+use tracing::{debug, trace};
+
+use crate::{
+    catalog::compressed_path,
+    reader::{SegmentSource, WalSegment},
+    CompressionAlgorithm,
+    EntryType,
+    LogEntry,
+    LogEntryRef,
+    PayloadCipher,
+    Result,
+    WalError,
+    WalFormat,
+    WalManager,
+};
+
+/// A committed change read from the WAL.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct WalChange {
+    /// LSN of the entry
+    pub lsn:   u64,
+    /// The logged entry, an insert, update or delete
+    pub entry: LogEntry,
+}
+
+/// A batch of changes delivered by [`WalManager::changes_since`].
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct WalChangeBatch {
+    /// The changes, in commit order
+    pub changes: Vec<WalChange>,
+    /// LSN to resume the feed from once the batch has been applied
+    pub cursor:  u64,
+}
+
+/// Segments holding the entries after a given LSN
+#[derive(Debug)]
+#[allow(
+    clippy::field_scoped_visibility_modifiers,
+    reason = "fields are filled in by the manager"
+)]
+pub(crate) struct ChangeSegments {
+    /// Rotated segments, oldest first
+    pub(crate) rotated:     Vec<SegmentSource>,
+    /// The current file, loaded while appends were locked out
+    pub(crate) current:     Option<WalSegment>,
+    /// Configured format of the WAL
+    pub(crate) format:      WalFormat,
+    /// Compression rotated segments receive in the background
+    pub(crate) compression: Option<CompressionAlgorithm>,
+    /// Cipher decrypting the entries, if the WAL is encrypted
+    pub(crate) cipher:      Option<Arc<dyn PayloadCipher>>,
+    /// LSN of the last entry appended when the snapshot was taken
+    pub(crate) last_lsn:    u64,
+}
+
+impl ChangeSegments {
+    /// Load a rotated segment.
+    ///
+    /// A segment rotated right before the snapshot may have been compressed and its uncompressed
+    /// file removed since, in which case the compressed copy is read.
+    async fn open(&self, source: &SegmentSource) -> Result<WalSegment> {
+        let result = source.open(self.format, self.cipher.as_ref()).await;
+        let Some(alg) = self.compression.filter(|_| source.compression.is_none())
+        else {
+            return result;
+        };
+        match result {
+            Err(WalError::Io(ref e)) if e.kind() == std::io::ErrorKind::NotFound => {
+                trace!(
+                    "WAL segment {:?} was compressed while reading changes",
+                    source.path
+                );
+                let compressed = SegmentSource {
+                    path: compressed_path(&source.path, alg),
+                    compression: Some(alg),
+                    ..source.clone()
+                };
+                compressed.open(self.format, self.cipher.as_ref()).await
+            },
+            result => result,
+        }
+    }
+}
+
+/// A transaction whose commit has not been read yet
+#[derive(Debug)]
+struct OpenTransaction {
+    /// LSN of the `Begin` entry
+    begin_lsn: u64,
+    /// Changes logged in the transaction so far
+    changes:   Vec<WalChange>,
+}
+
+/// Sorts the entries read from the WAL into committed changes
+#[derive(Debug)]
+struct ChangeAssembler {
+    /// Committed changes not delivered yet, in commit order
+    ready:   Vec<WalChange>,
+    /// Transactions waiting for their commit, by transaction ID
+    open:    HashMap<String, OpenTransaction>,
+    /// LSN of the last entry read
+    scanned: u64,
+}
+
+impl ChangeAssembler {
+    /// Start assembling after LSN `after`
+    fn new(after: u64) -> Self {
+        Self {
+            ready:   Vec::new(),
+            open:    HashMap::new(),
+            scanned: after,
+        }
+    }
+
+    /// Sort one entry read from the WAL
+    fn push(&mut self, lsn: u64, entry: &LogEntryRef<'_>) {
+        self.scanned = self.scanned.max(lsn);
+        let transaction_id = entry.transaction_id_str();
+        match entry.entry_type {
+            EntryType::Begin => {
+                self.open.insert(
+                    transaction_id.to_owned(),
+                    OpenTransaction {
+                        begin_lsn: lsn,
+                        changes:   Vec::new(),
+                    },
+                );
+            },
+            EntryType::Commit => {
+                if let Some(transaction) = self.open.remove(transaction_id) {
+                    self.ready.extend(transaction.changes);
+                }
+            },
+            EntryType::Rollback => {
+                if let Some(transaction) = self.open.remove(transaction_id) {
+                    trace!(
+                        "Dropping {} changes of rolled back transaction {}",
+                        transaction.changes.len(),
+                        transaction_id
+                    );
+                }
+            },
+            EntryType::Insert | EntryType::Update | EntryType::Delete => {
+                let change = WalChange {
+                    lsn,
+                    entry: entry.to_log_entry(),
+                };
+                match self.open.get_mut(transaction_id) {
+                    Some(transaction) => transaction.changes.push(change),
+                    None => self.ready.push(change),
+                }
+            },
+        }
+    }
+
+    /// Highest LSN the feed can resume from without losing an undelivered change
+    fn cursor(&self) -> u64 {
+        self.open
+            .values()
+            .map(|transaction| transaction.begin_lsn)
+            .chain(self.ready.iter().map(|change| change.lsn))
+            .map(|lsn| lsn.saturating_sub(1))
+            .fold(self.scanned, u64::min)
+    }
+
+    /// Deliver up to `max` of the committed changes
+    fn take(&mut self, max: usize) -> WalChangeBatch {
+        let changes = self.ready.drain(.. max.min(self.ready.len())).collect();
+        WalChangeBatch {
+            changes,
+            cursor: self.cursor(),
+        }
+    }
+}
+
+impl WalManager {
+    /// Stream the committed changes logged after LSN `lsn`, in batches of up to `batch_size`.
+    ///
+    /// The stream reads the rotated segments the catalog lists, decompressing them in memory,
+    /// then the current file as it was when the stream was created, and ends there; resume from
+    /// the cursor of the last batch to pick up later changes. Changes of one transaction are
+    /// delivered together, split across batches only when the transaction exceeds `batch_size`.
+    /// A final batch without changes is delivered when the cursor moved past entries that carried
+    /// none, such as rolled back transactions.
+    ///
+    /// See the [module documentation](crate::changes) for the delivery guarantees.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::LsnUnavailable` - If the entries after `lsn` were already retired
+    /// * `WalError::Io` - If the write buffer cannot be flushed or a segment cannot be read
+    ///
+    /// # Examples
+    ///
+    /// ```rust,no_run
+    /// use std::path::PathBuf;
+    ///
+    /// use futures::{pin_mut, StreamExt as _};
+    /// use sentinel_wal::{WalConfig, WalManager};
+    ///
+    /// # async fn example() -> Result<(), Box<dyn std::error::Error>> {
+    /// let wal =
+    ///     WalManager::new(PathBuf::from("data/app.wal"), WalConfig::default())
+    ///         .await?;
+    ///
+    /// let mut cursor = 0;
+    /// let changes = wal.changes_since(cursor, 100).await?;
+    /// pin_mut!(changes);
+    /// while let Some(batch) = changes.next().await {
+    ///     let batch = batch?;
+    ///     for change in &batch.changes {
+    ///         println!(
+    ///             "{} {:?} {}",
+    ///             change.lsn,
+    ///             change.entry.entry_type,
+    ///             change.entry.document_id_str()
+    ///         );
+    ///     }
+    ///     cursor = batch.cursor;
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub async fn changes_since(
+        &self,
+        lsn: u64,
+        batch_size: usize,
+    ) -> Result<impl Stream<Item = Result<WalChangeBatch>> + Send + 'static> {
+        let mut segments = self.change_segments(lsn).await?;
+        let batch_size = batch_size.max(1);
+        Ok(stream! {
+            let mut assembler = ChangeAssembler::new(lsn);
+            let mut delivered = lsn;
+            let rotated = std::mem::take(&mut segments.rotated);
+            for source in &rotated {
+                let segment = match segments.open(source).await {
+                    Ok(segment) => segment,
+                    Err(e) => {
+                        yield Err(e);
+                        return;
+                    },
+                };
+                let mut entries = segment.entries();
+                while let Some((lsn, entry)) = entries.next_with_lsn() {
+                    assembler.push(lsn, &entry);
+                    while assembler.ready.len() >= batch_size {
+                        let batch = assembler.take(batch_size);
+                        delivered = batch.cursor;
+                        yield Ok(batch);
+                    }
+                }
+            }
+            if let Some(segment) = segments.current.take() {
+                let mut entries = segment.entries();
+                while let Some((lsn, entry)) = entries.next_with_lsn() {
+                    assembler.push(lsn, &entry);
+                    while assembler.ready.len() >= batch_size {
+                        let batch = assembler.take(batch_size);
+                        delivered = batch.cursor;
+                        yield Ok(batch);
+                    }
+                }
+            }
+
+            // Every entry up to the snapshot was read, including those skipped as invalid
+            assembler.scanned = assembler.scanned.max(segments.last_lsn);
+            while !assembler.ready.is_empty() {
+                let batch = assembler.take(batch_size);
+                delivered = batch.cursor;
+                yield Ok(batch);
+            }
+            let cursor = assembler.cursor();
+            if cursor > delivered {
+                yield Ok(WalChangeBatch {
+                    changes: Vec::new(),
+                    cursor,
+                });
+            }
+            debug!(
+                "Change feed caught up at LSN {} with {} transactions still open",
+                cursor,
+                assembler.open.len()
+            );
+        })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use futures::StreamExt as _;
+    use serde_json::json;
+    use tempfile::tempdir;
+
+    use super::*;
+    use crate::{WalConfig, WalRetention};
+
+    /// Insert entry for document `i`
+    fn insert(i: usize) -> LogEntry {
+        LogEntry::new(
+            EntryType::Insert,
+            "users".to_string(),
+            format!("user-{}", i),
+            Some(json!({"i": i})),
+        )
+    }
+
+    /// Entry of the given type in the transaction of `begin`
+    fn in_transaction(begin: &LogEntry, entry_type: EntryType, id: &str) -> LogEntry {
+        let mut entry = LogEntry::new(entry_type, "users".to_string(), id.to_string(), None);
+        entry.transaction_id = begin.transaction_id.clone();
+        entry
+    }
+
+    /// Begin entry of a new transaction
+    fn begin() -> LogEntry { LogEntry::new(EntryType::Begin, "users".to_string(), String::new(), None) }
+
+    /// Collect the batches of the feed after `lsn`
+    async fn batches(wal: &WalManager, lsn: u64, batch_size: usize) -> Vec<WalChangeBatch> {
+        wal.changes_since(lsn, batch_size)
+            .await
+            .unwrap()
+            .map(|batch| batch.unwrap())
+            .collect()
+            .await
+    }
+
+    /// LSNs of the changes of `batches`
+    fn lsns(batches: &[WalChangeBatch]) -> Vec<u64> {
+        batches
+            .iter()
+            .flat_map(|batch| batch.changes.iter().map(|change| change.lsn))
+            .collect()
+    }
+
+    #[tokio::test]
+    async fn test_changes_span_rotated_and_compressed_segments() {
+        for format in [WalFormat::Binary, WalFormat::BinaryV2, WalFormat::JsonLines] {
+            let temp_dir = tempdir().unwrap();
+            let wal = WalManager::new(
+                temp_dir.path().join("test.wal"),
+                WalConfig {
+                    format,
+                    max_file_size: None,
+                    max_records_per_file: Some(3),
+                    compression_algorithm: Some(CompressionAlgorithm::Zstd),
+                    retention: WalRetention::Keep,
+                    ..Default::default()
+                },
+            )
+            .await
+            .unwrap();
+            for i in 0 .. 10 {
+                wal.write_entry(insert(i)).await.unwrap();
+            }
+            wal.checkpoint_through(wal.last_lsn()).await.unwrap();
+
+            let all = batches(&wal, 0, 4).await;
+            assert_eq!(
+                all.iter()
+                    .map(|batch| batch.changes.len())
+                    .collect::<Vec<_>>(),
+                [4, 4, 2],
+                "{:?}",
+                format
+            );
+            assert_eq!(lsns(&all), (1 ..= 10).collect::<Vec<_>>());
+            assert_eq!(all.last().unwrap().cursor, 10);
+            assert_eq!(all[0].changes[0].entry.document_id_str(), "user-0");
+
+            let resumed = batches(&wal, all[0].cursor, 100).await;
+            assert_eq!(lsns(&resumed), (5 ..= 10).collect::<Vec<_>>());
+            assert!(batches(&wal, 10, 100).await.is_empty());
+        }
+    }
+
+    #[tokio::test]
+    async fn test_changes_wait_for_commit_and_drop_rollbacks() {
+        let temp_dir = tempdir().unwrap();
+        let wal = WalManager::new(temp_dir.path().join("test.wal"), WalConfig::default())
+            .await
+            .unwrap();
+
+        let rolled_back = begin();
+        let open = begin();
+        wal.write_entries(&[
+            rolled_back.clone(),
+            in_transaction(&rolled_back, EntryType::Insert, "dropped"),
+            in_transaction(&rolled_back, EntryType::Rollback, ""),
+            open.clone(),
+            in_transaction(&open, EntryType::Update, "pending"),
+            insert(1),
+        ])
+        .await
+        .unwrap();
+
+        // Only the standalone insert is committed, and the cursor stays before the open Begin
+        let first = batches(&wal, 0, 10).await;
+        assert_eq!(lsns(&first), [6]);
+        assert_eq!(first.last().unwrap().cursor, 3);
+
+        wal.write_entry(in_transaction(&open, EntryType::Commit, ""))
+            .await
+            .unwrap();
+        let second = batches(&wal, 3, 10).await;
+        assert_eq!(lsns(&second), [6, 5]);
+        assert_eq!(second[0].changes[1].entry.document_id_str(), "pending");
+        assert_eq!(second.last().unwrap().cursor, 7);
+
+        // A rolled back transaction delivers nothing but still moves the cursor
+        let dropped = begin();
+        wal.write_entries(&[
+            dropped.clone(),
+            in_transaction(&dropped, EntryType::Delete, "user-1"),
+            in_transaction(&dropped, EntryType::Rollback, ""),
+        ])
+        .await
+        .unwrap();
+        assert_eq!(
+            batches(&wal, 7, 10).await,
+            [WalChangeBatch {
+                changes: Vec::new(),
+                cursor:  10,
+            }]
+        );
+    }
+
+    #[tokio::test]
+    async fn test_changes_before_retired_segments_are_unavailable() {
+        let temp_dir = tempdir().unwrap();
+        let wal = WalManager::new(
+            temp_dir.path().join("test.wal"),
+            WalConfig {
+                max_records_per_file: Some(2),
+                compression_algorithm: None,
+                retention: WalRetention::Delete,
+                ..Default::default()
+            },
+        )
+        .await
+        .unwrap();
+        for i in 0 .. 6 {
+            wal.write_entry(insert(i)).await.unwrap();
+        }
+        wal.checkpoint_through(wal.last_lsn()).await.unwrap();
+        wal.write_entry(insert(6)).await.unwrap();
+        assert_eq!(wal.last_lsn(), 7);
+
+        let err = wal.changes_since(0, 10).await.err().unwrap();
+        assert!(matches!(
+            err,
+            WalError::LsnUnavailable {
+                requested: 1,
+                ..
+            }
+        ));
+        let tail = batches(&wal, 6, 10).await;
+        assert_eq!(lsns(&tail), [7]);
+    }
+}
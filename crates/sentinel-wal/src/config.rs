@@ -69,6 +69,15 @@ pub struct CollectionWalConfig {
     /// WAL file format
     #[serde(default)]
     pub format:                crate::manager::WalFormat,
+    /// Optional group-commit settings for batching concurrent WAL writes
+    #[serde(default)]
+    pub group_commit:          Option<crate::manager::GroupCommitConfig>,
+    /// Durability guarantee applied after each WAL write
+    #[serde(default)]
+    pub durability:            crate::manager::WalDurability,
+    /// What checkpoints do with fully checkpointed WAL segments
+    #[serde(default)]
+    pub retention:             crate::manager::WalRetention,
 }
 
 impl Default for CollectionWalConfig {
@@ -82,6 +91,9 @@ impl Default for CollectionWalConfig {
             compression_algorithm: Some(crate::CompressionAlgorithm::Zstd),
             max_records_per_file:  Some(1000),
             format:                crate::manager::WalFormat::default(),
+            group_commit:          None,
+            durability:            crate::manager::WalDurability::default(),
+            retention:             crate::manager::WalRetention::default(),
         }
     }
 }
@@ -97,6 +109,9 @@ pub struct CollectionWalConfigOverrides {
     pub compression_algorithm: Option<Option<crate::CompressionAlgorithm>>,
     pub max_records_per_file:  Option<Option<usize>>,
     pub format:                Option<crate::manager::WalFormat>,
+    pub group_commit:          Option<Option<crate::manager::GroupCommitConfig>>,
+    pub durability:            Option<crate::manager::WalDurability>,
+    pub retention:             Option<crate::manager::WalRetention>,
     /// Whether to persist the merged configuration to disk (for existing collections)
     pub persist_overrides:     bool,
 }
@@ -121,6 +136,9 @@ impl CollectionWalConfig {
                 .max_records_per_file
                 .unwrap_or(self.max_records_per_file),
             format:                overrides.format.unwrap_or(self.format),
+            group_commit:          overrides.group_commit.unwrap_or(self.group_commit),
+            durability:            overrides.durability.unwrap_or(self.durability),
+            retention:             overrides.retention.unwrap_or(self.retention),
         }
     }
 }
@@ -143,6 +161,10 @@ pub struct StoreWalConfig {
     pub checkpoint_interval_secs:  u64,
     /// Maximum WAL file size before forcing checkpoint (in bytes)
     pub max_wal_size_bytes:        u64,
+    /// Maximum number of events queued from collections to the store before senders wait
+    /// (`None` uses the store default)
+    #[serde(default)]
+    pub event_queue_capacity:      Option<usize>,
 }
 
 impl Default for StoreWalConfig {
@@ -154,6 +176,7 @@ impl Default for StoreWalConfig {
             auto_checkpoint:           true,
             checkpoint_interval_secs:  300,               // 5 minutes
             max_wal_size_bytes:        100 * 1024 * 1024, // 100MB
+            event_queue_capacity:      None,
         }
     }
 }
@@ -165,6 +188,9 @@ impl From<CollectionWalConfig> for crate::manager::WalConfig {
             compression_algorithm: config.compression_algorithm,
             max_records_per_file:  config.max_records_per_file,
             format:                config.format,
+            group_commit:          config.group_commit,
+            durability:            config.durability,
+            retention:             config.retention,
         }
     }
 }
@@ -8,7 +8,7 @@ use tracing::trace;
 use crate::{Result, WalError};
 
 /// Fixed-size byte array for transaction ID (32 bytes)
-#[derive(Debug, Clone, PartialEq, Eq)]
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
 pub struct FixedBytes32([u8; 32]);
 
 impl Serialize for FixedBytes32 {
@@ -50,21 +50,15 @@ impl std::ops::DerefMut for FixedBytes32 {
 
 impl From<&[u8]> for FixedBytes32 {
     fn from(bytes: &[u8]) -> Self {
-        let mut temp = bytes.to_vec();
-        let len = temp.len();
-        #[allow(
-            clippy::arithmetic_side_effects,
-            reason = "safe arithmetic for padding calculation"
-        )]
-        let padded_len = len.div_ceil(16) * 16;
-        temp.resize(padded_len, 0);
+        // Padding to a multiple of 16 within a 32-byte array is the same as zero-filling it, so
+        // no intermediate buffer is needed
         let mut arr = [0u8; 32];
-        let copy_len = temp.len().min(32);
+        let copy_len = bytes.len().min(32);
         #[allow(
             clippy::indexing_slicing,
             reason = "safe slicing with calculated lengths"
         )]
-        arr[.. copy_len].copy_from_slice(&temp[.. copy_len]);
+        arr[.. copy_len].copy_from_slice(&bytes[.. copy_len]);
         Self(arr)
     }
 }
@@ -243,8 +237,7 @@ impl LogEntry {
     /// assert!(bytes.len() > 4);
     /// ```
     pub fn to_bytes(&self) -> Result<Vec<u8>> {
-        let serialized =
-            postcard::to_stdvec(self).map_err(|e: postcard::Error| WalError::Serialization(e.to_string()))?;
+        let serialized = self.to_payload()?;
         let mut hasher = Crc32Hasher::new();
         hasher.update(&serialized);
         let checksum = hasher.finalize();
@@ -322,6 +315,19 @@ impl LogEntry {
             return Err(WalError::ChecksumMismatch);
         }
 
+        Self::from_payload(data)
+    }
+
+    /// Serialize the entry to Postcard without a checksum, as carried by v2 WAL frames.
+    pub(crate) fn to_payload(&self) -> Result<Vec<u8>> {
+        postcard::to_stdvec(self).map_err(|e: postcard::Error| WalError::Serialization(e.to_string()))
+    }
+
+    /// Borrow the entry as a [`LogEntryRef`](crate::LogEntryRef).
+    pub fn as_view(&self) -> crate::LogEntryRef<'_> { crate::LogEntryRef::from(self) }
+
+    /// Deserialize an entry from Postcard data whose integrity was already verified.
+    pub(crate) fn from_payload(data: &[u8]) -> Result<Self> {
         let entry: Self =
             postcard::from_bytes(data).map_err(|e: postcard::Error| WalError::Serialization(e.to_string()))?;
         trace!(
@@ -17,4 +17,11 @@ pub enum WalError {
     FileSizeLimitExceeded,
     #[error("Record limit exceeded")]
     RecordLimitExceeded,
+    #[error("LSN {requested} is no longer retained, the oldest retained LSN is {oldest}")]
+    LsnUnavailable {
+        /// First LSN that was requested
+        requested: u64,
+        /// Oldest LSN still held by a segment
+        oldest:    u64,
+    },
 }
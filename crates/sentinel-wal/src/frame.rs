@@ -0,0 +1,351 @@
+//! Self-framing binary WAL format (v2).
+//!
+//! A v2 WAL file starts with a fixed header followed by a sequence of frames:
+//!
+//! ```text
+//! file header: [magic "SWAL"][version: u8][reserved: 3 bytes][base_lsn: u64_le]
+//! frame:       [marker: 4 bytes][length: u32_le][lsn: u64_le][crc32: u32_le][payload]
+//! ```
+//!
+//! The payload is the postcard-serialized `LogEntry` and `length` is its size in bytes. The
+//! checksum covers the length, the LSN and the payload, so readers jump from frame to frame using
+//! the length prefix and detect a corrupted or torn frame without scanning byte by byte. After a
+//! corrupted frame, readers resynchronise on the next frame marker.
+//!
+//! When the WAL has a [`PayloadCipher`], the payload is instead [`ENCRYPTED_PAYLOAD_MARKER`]
+//! followed by the encrypted entry. A postcard entry starts with its entry type, which is never
+//! that large, so encrypted and plain frames can follow each other in the same file.
+
+use std::borrow::Cow;
+
+use crc32fast::Hasher as Crc32Hasher;
+
+use crate::{PayloadCipher, Result, WalError};
+
+/// Magic bytes at the start of every v2 WAL file
+pub const FILE_MAGIC: [u8; 4] = *b"SWAL";
+
+/// Version byte following the file magic
+pub const FORMAT_VERSION: u8 = 2;
+
+/// Size of the v2 file header in bytes
+pub const FILE_HEADER_LEN: usize = 16;
+
+/// Marker at the start of every frame, used to resynchronise after a corrupted frame
+pub const FRAME_MARKER: [u8; 4] = [0xf5, 0x57, 0x41, 0x4c];
+
+/// Size of a frame header in bytes
+pub const FRAME_HEADER_LEN: usize = 20;
+
+/// Largest accepted frame payload; longer length prefixes are treated as corruption
+pub const MAX_FRAME_PAYLOAD: usize = 256 * 1024 * 1024;
+
+/// First byte of an encrypted frame payload
+pub const ENCRYPTED_PAYLOAD_MARKER: u8 = 0xe5;
+
+/// Offset of the payload length within a frame header
+const LENGTH_OFFSET: usize = 4;
+
+/// Offset of the LSN within a frame header
+const LSN_OFFSET: usize = 8;
+
+/// Offset of the checksum within a frame header
+const CRC_OFFSET: usize = 16;
+
+/// Offset of the base LSN within the file header
+const BASE_LSN_OFFSET: usize = 8;
+
+/// Outcome of decoding the frame at the start of a buffer
+#[derive(Debug, PartialEq, Eq)]
+pub enum Frame<'a> {
+    /// A complete frame with a valid checksum
+    Valid {
+        /// Log sequence number of the frame
+        lsn:     u64,
+        /// The serialized entry
+        payload: &'a [u8],
+        /// Total size of the frame, header included
+        len:     usize,
+    },
+    /// The buffer ends before the frame does
+    Incomplete,
+    /// The bytes at the start of the buffer are not a valid frame
+    Corrupt,
+}
+
+/// Read a little-endian `u32` at `offset`
+fn read_u32(bytes: &[u8], offset: usize) -> Option<u32> {
+    let end = offset.checked_add(4)?;
+    bytes
+        .get(offset .. end)?
+        .try_into()
+        .ok()
+        .map(u32::from_le_bytes)
+}
+
+/// Read a little-endian `u64` at `offset`
+fn read_u64(bytes: &[u8], offset: usize) -> Option<u64> {
+    let end = offset.checked_add(8)?;
+    bytes
+        .get(offset .. end)?
+        .try_into()
+        .ok()
+        .map(u64::from_le_bytes)
+}
+
+/// Checksum of a frame, given the CRC32 of its payload.
+///
+/// The payload checksum is combined rather than recomputed, so sealing a frame costs the same
+/// regardless of the payload size.
+fn frame_checksum(length: u32, lsn: u64, payload_crc: u32) -> u32 {
+    let mut hasher = Crc32Hasher::new();
+    hasher.update(&length.to_le_bytes());
+    hasher.update(&lsn.to_le_bytes());
+    hasher.combine(&Crc32Hasher::new_with_initial_len(
+        payload_crc,
+        u64::from(length),
+    ));
+    hasher.finalize()
+}
+
+/// Build the header of a v2 WAL file whose first frame has the LSN `base_lsn`
+pub fn file_header(base_lsn: u64) -> Vec<u8> {
+    let mut header = Vec::with_capacity(FILE_HEADER_LEN);
+    header.extend_from_slice(&FILE_MAGIC);
+    header.push(FORMAT_VERSION);
+    header.extend_from_slice(&[0_u8; 3]);
+    header.extend_from_slice(&base_lsn.to_le_bytes());
+    header
+}
+
+/// Parse a v2 file header, returning its base LSN, or `None` if `bytes` does not start with one
+pub fn parse_file_header(bytes: &[u8]) -> Option<u64> {
+    if !bytes.starts_with(&FILE_MAGIC) || bytes.get(FILE_MAGIC.len()) != Some(&FORMAT_VERSION) {
+        return None;
+    }
+    read_u64(bytes, BASE_LSN_OFFSET)
+}
+
+/// Wrap a serialized entry into an unsealed frame.
+///
+/// The LSN is left at zero and the checksum slot holds the payload CRC until [`seal_frame`]
+/// stamps the frame at append time.
+///
+/// # Errors
+///
+/// * `WalError::InvalidEntry` - If the payload exceeds [`MAX_FRAME_PAYLOAD`]
+pub fn encode_frame(payload: &[u8]) -> Result<Vec<u8>> {
+    let length = u32::try_from(payload.len())
+        .ok()
+        .filter(|_| payload.len() <= MAX_FRAME_PAYLOAD)
+        .ok_or_else(|| WalError::InvalidEntry("Entry too large for a WAL frame".to_owned()))?;
+
+    let mut frame = Vec::with_capacity(FRAME_HEADER_LEN.saturating_add(payload.len()));
+    frame.extend_from_slice(&FRAME_MARKER);
+    frame.extend_from_slice(&length.to_le_bytes());
+    frame.extend_from_slice(&0_u64.to_le_bytes());
+    frame.extend_from_slice(&crc32fast::hash(payload).to_le_bytes());
+    frame.extend_from_slice(payload);
+    Ok(frame)
+}
+
+/// Stamp an unsealed frame with its LSN and final checksum
+pub fn seal_frame(frame: &mut [u8], lsn: u64) {
+    let (Some(length), Some(payload_crc)) = (read_u32(frame, LENGTH_OFFSET), read_u32(frame, CRC_OFFSET))
+    else {
+        return;
+    };
+    let checksum = frame_checksum(length, lsn, payload_crc);
+
+    if let Some(slot) = frame.get_mut(LSN_OFFSET .. CRC_OFFSET) {
+        slot.copy_from_slice(&lsn.to_le_bytes());
+    }
+    if let Some(slot) = frame.get_mut(CRC_OFFSET .. FRAME_HEADER_LEN) {
+        slot.copy_from_slice(&checksum.to_le_bytes());
+    }
+}
+
+/// Read the LSN and payload length from a frame header without verifying the frame
+pub fn peek_header(header: &[u8]) -> Option<(u64, usize)> {
+    if !header.starts_with(&FRAME_MARKER) {
+        return None;
+    }
+    let length = usize::try_from(read_u32(header, LENGTH_OFFSET)?).ok()?;
+    Some((read_u64(header, LSN_OFFSET)?, length))
+}
+
+/// Decode the frame at the start of `buffer`
+pub fn decode_frame(buffer: &[u8]) -> Frame<'_> {
+    if buffer.len() < FRAME_HEADER_LEN {
+        let marker_prefix = buffer.iter().zip(FRAME_MARKER.iter()).all(|(a, b)| a == b);
+        return if marker_prefix {
+            Frame::Incomplete
+        }
+        else {
+            Frame::Corrupt
+        };
+    }
+
+    let Some((lsn, length)) = peek_header(buffer)
+    else {
+        return Frame::Corrupt;
+    };
+    if length > MAX_FRAME_PAYLOAD {
+        return Frame::Corrupt;
+    }
+    let len = FRAME_HEADER_LEN.saturating_add(length);
+    let Some(payload) = buffer.get(FRAME_HEADER_LEN .. len)
+    else {
+        return Frame::Incomplete;
+    };
+
+    let mut hasher = Crc32Hasher::new();
+    hasher.update(buffer.get(LENGTH_OFFSET .. CRC_OFFSET).unwrap_or_default());
+    hasher.update(payload);
+    if read_u32(buffer, CRC_OFFSET) != Some(hasher.finalize()) {
+        return Frame::Corrupt;
+    }
+
+    Frame::Valid {
+        lsn,
+        payload,
+        len,
+    }
+}
+
+/// Encrypt a serialized entry with `cipher` into a frame payload
+///
+/// # Errors
+///
+/// Returns the error of the cipher if encryption fails.
+pub fn encrypt_payload(cipher: &dyn PayloadCipher, payload: &[u8]) -> Result<Vec<u8>> {
+    let encrypted = cipher.encrypt(payload)?;
+    let mut bytes = Vec::with_capacity(encrypted.len().saturating_add(1));
+    bytes.push(ENCRYPTED_PAYLOAD_MARKER);
+    bytes.extend_from_slice(&encrypted);
+    Ok(bytes)
+}
+
+/// Whether a frame payload was produced by [`encrypt_payload`]
+pub fn is_encrypted(payload: &[u8]) -> bool { payload.first() == Some(&ENCRYPTED_PAYLOAD_MARKER) }
+
+/// Get the serialized entry of a frame payload, decrypting it with `cipher` if it is encrypted
+///
+/// # Errors
+///
+/// * `WalError::InvalidEntry` - If the payload is encrypted and there is no cipher
+///
+/// Returns the error of the cipher if decryption fails.
+pub fn decrypt_payload<'a>(cipher: Option<&dyn PayloadCipher>, payload: &'a [u8]) -> Result<Cow<'a, [u8]>> {
+    let Some(encrypted) = payload.strip_prefix(&[ENCRYPTED_PAYLOAD_MARKER])
+    else {
+        return Ok(Cow::Borrowed(payload));
+    };
+    let cipher =
+        cipher.ok_or_else(|| WalError::InvalidEntry("Encrypted WAL entry but no cipher is configured".to_owned()))?;
+    cipher.decrypt(encrypted).map(Cow::Owned)
+}
+
+/// Find the offset of the next frame marker after the start of `buffer`
+pub fn resync(buffer: &[u8]) -> Option<usize> {
+    buffer
+        .get(1 ..)?
+        .windows(FRAME_MARKER.len())
+        .position(|window| window == FRAME_MARKER)
+        .map(|position| position.saturating_add(1))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Encode and seal a frame
+    fn sealed(payload: &[u8], lsn: u64) -> Vec<u8> {
+        let mut frame = encode_frame(payload).unwrap();
+        seal_frame(&mut frame, lsn);
+        frame
+    }
+
+    #[test]
+    fn test_file_header_roundtrip() {
+        let header = file_header(42);
+        assert_eq!(header.len(), FILE_HEADER_LEN);
+        assert_eq!(parse_file_header(&header), Some(42));
+        assert_eq!(parse_file_header(b"not a v2 wal file"), None);
+        assert_eq!(parse_file_header(&FILE_MAGIC), None);
+    }
+
+    #[test]
+    fn test_frame_roundtrip() {
+        let frame = sealed(b"payload", 7);
+        assert_eq!(
+            decode_frame(&frame),
+            Frame::Valid {
+                lsn:     7,
+                payload: b"payload",
+                len:     FRAME_HEADER_LEN + 7,
+            }
+        );
+    }
+
+    #[test]
+    fn test_combined_checksum_matches_direct_checksum() {
+        let payload = vec![0xab_u8; 10_000];
+        let mut hasher = Crc32Hasher::new();
+        hasher.update(&(payload.len() as u32).to_le_bytes());
+        hasher.update(&99_u64.to_le_bytes());
+        hasher.update(&payload);
+        assert_eq!(
+            frame_checksum(payload.len() as u32, 99, crc32fast::hash(&payload)),
+            hasher.finalize()
+        );
+    }
+
+    #[test]
+    fn test_unsealed_frame_is_corrupt() {
+        let frame = encode_frame(b"payload").unwrap();
+        assert_eq!(decode_frame(&frame), Frame::Corrupt);
+    }
+
+    #[test]
+    fn test_truncated_frame_is_incomplete() {
+        let frame = sealed(b"payload", 1);
+        assert_eq!(decode_frame(&frame[.. frame.len() - 1]), Frame::Incomplete);
+        assert_eq!(decode_frame(&frame[.. 2]), Frame::Incomplete);
+        assert_eq!(decode_frame(b"xx"), Frame::Corrupt);
+    }
+
+    #[test]
+    fn test_corrupted_payload_is_detected() {
+        let mut frame = sealed(b"payload", 1);
+        let last = frame.len() - 1;
+        frame[last] ^= 0xff;
+        assert_eq!(decode_frame(&frame), Frame::Corrupt);
+    }
+
+    #[test]
+    fn test_resync_finds_next_frame() {
+        let first = sealed(b"first", 1);
+        let second = sealed(b"second", 2);
+        let mut buffer = first[.. first.len() - 2].to_vec();
+        buffer.extend_from_slice(&second);
+
+        let skip = resync(&buffer).unwrap();
+        assert_eq!(skip, first.len() - 2);
+        assert!(matches!(
+            decode_frame(&buffer[skip ..]),
+            Frame::Valid {
+                lsn: 2,
+                ..
+            }
+        ));
+        assert_eq!(resync(&second), None);
+    }
+
+    #[test]
+    fn test_peek_header() {
+        let frame = sealed(b"payload", 5);
+        assert_eq!(peek_header(&frame[.. FRAME_HEADER_LEN]), Some((5, 7)));
+        assert_eq!(peek_header(&[0_u8; FRAME_HEADER_LEN]), None);
+    }
+}
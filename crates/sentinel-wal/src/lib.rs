@@ -16,6 +16,21 @@
 //! - Data (variable length, JSON string)
 //! - CRC32 checksum (4 bytes)
 //!
+//! The `BinaryV2` format wraps each serialized entry in a length-prefixed frame carrying a
+//! sequence number (LSN) and a checksum, behind a versioned file header. Readers jump directly
+//! from frame to frame instead of searching for checksum boundaries; see [`frame`] for the
+//! layout.
+//!
+//! Rotated segments are recorded in a segment catalog (see [`catalog`]) with their LSN range and
+//! compression state. Checkpoints record the LSN the data files cover, replay starts after it,
+//! and fully checkpointed segments are archived or deleted according to [`WalRetention`].
+//!
+//! [`WalManager::changes_since`] streams the committed changes after an LSN across rotated and
+//! compressed segments, in batches carrying a resume cursor; see [`changes`].
+//!
+//! Every manager records the latency of its appends, flushes, fsyncs and rotations, its batch
+//! sizes and the bytes it wrote into [`WalMetrics`], which several managers can share.
+//!
 //! ## Features
 //!
 //! - Postcard serialization for efficiency and maintainability
@@ -24,21 +39,30 @@
 //! - Checkpoint mechanism for log compaction
 //! - Crash recovery via log replay
 
+pub mod catalog;
+pub mod changes;
 pub mod compression;
 pub mod config;
 pub mod entry;
 pub mod error;
+pub mod frame;
 pub mod manager;
+pub mod metrics;
+pub mod reader;
 pub mod recovery;
 pub mod traits;
 pub mod verification;
 
 // Re-exports
 pub use error::WalError;
+pub use catalog::{SegmentCatalog, SegmentInfo};
+pub use changes::{WalChange, WalChangeBatch};
 pub use entry::{EntryType, FixedBytes256, FixedBytes32, LogEntry};
-pub use manager::{WalConfig, WalFormat, WalManager};
+pub use manager::{GroupCommitConfig, WalConfig, WalDurability, WalFormat, WalManager, WalRetention};
+pub use metrics::{Histogram, HistogramSnapshot, WalMetrics, WalMetricsSnapshot};
+pub use reader::{LogEntryRef, SegmentEntries, WalSegment, WalSegments};
 pub use config::{CollectionWalConfig, CollectionWalConfigOverrides, StoreWalConfig, WalFailureMode};
-pub use traits::WalDocumentOps;
+pub use traits::{PayloadCipher, WalDocumentOps};
 pub use verification::{verify_wal_consistency, WalVerificationIssue, WalVerificationResult};
 pub use recovery::{recover_from_wal_force, recover_from_wal_safe, WalRecoveryFailure, WalRecoveryResult};
 pub use compression::*;
@@ -613,9 +637,6 @@ mod tests {
             wal.write_entry(entry.clone()).await.unwrap();
         }
 
-        // Checkpoint to ensure all data is flushed
-        wal.checkpoint().await.unwrap();
-
         // Debug: Check file size
         let file_size = tokio::fs::metadata(&wal_path).await.unwrap().len();
         println!("WAL file size: {} bytes", file_size);
@@ -662,34 +683,17 @@ mod tests {
         assert_eq!(docs.len(), 1); // user-1 was deleted, user-2 remains
         assert_eq!(docs["user-2"], json!({"name": "Bob", "age": 25}));
 
-        // Check operations were applied
+        // The log is reduced per document: user-1 nets out to nothing, user-2 is inserted once
         let ops = mock_ops.operations.lock().unwrap();
-        assert_eq!(ops.len(), 4);
+        assert_eq!(ops.len(), 1);
         assert_eq!(
             ops[0],
-            (
-                "Insert".to_string(),
-                "user-1".to_string(),
-                Some(json!({"name": "Alice", "age": 30}))
-            )
-        );
-        assert_eq!(
-            ops[1],
-            (
-                "Update".to_string(),
-                "user-1".to_string(),
-                Some(json!({"name": "Alice", "age": 31}))
-            )
-        );
-        assert_eq!(
-            ops[2],
             (
                 "Insert".to_string(),
                 "user-2".to_string(),
                 Some(json!({"name": "Bob", "age": 25}))
             )
         );
-        assert_eq!(ops[3], ("Delete".to_string(), "user-1".to_string(), None));
     }
 
     /// Test WAL force recovery functionality.
@@ -1,18 +1,38 @@
 //! WAL manager for handling log operations
 
-use std::{fs, path::PathBuf, sync::Arc};
+use std::{
+    fs,
+    io::SeekFrom,
+    path::{Path, PathBuf},
+    sync::{
+        atomic::{AtomicU64, Ordering},
+        Arc,
+    },
+    time::{Duration, Instant},
+};
 
 use crc32fast::Hasher as Crc32Hasher;
 use futures::Stream;
 use tokio::{
     fs::{File, OpenOptions},
-    io::{AsyncBufReadExt as _, AsyncReadExt as _, AsyncWriteExt as _, BufReader, BufWriter},
-    sync::Mutex,
+    io::{AsyncBufReadExt as _, AsyncReadExt as _, AsyncSeekExt as _, AsyncWriteExt as _, BufReader, BufWriter},
+    sync::{mpsc, oneshot, Mutex},
+    task::JoinHandle,
 };
 use tracing::{debug, info, trace, warn};
 use async_stream::stream;
 
-use crate::{LogEntry, Result};
+use crate::{
+    catalog::{compressed_path, SegmentCatalog, SegmentInfo},
+    changes::ChangeSegments,
+    frame::{self, Frame},
+    metrics::WalMetrics,
+    reader::{SegmentSource, WalSegment, WalSegments},
+    LogEntry,
+    PayloadCipher,
+    Result,
+    WalError,
+};
 
 /// WAL file format options
 #[derive(Debug, Clone, Copy, PartialEq, Eq, Default, serde::Serialize, serde::Deserialize)]
@@ -22,6 +42,10 @@ pub enum WalFormat {
     Binary,
     /// JSON Lines format (human-readable, extended)
     JsonLines,
+    /// Versioned binary format with length-prefixed, checksummed frames carrying an LSN.
+    ///
+    /// Readers still accept files written in the legacy `Binary` format.
+    BinaryV2,
 }
 
 impl std::str::FromStr for WalFormat {
@@ -31,6 +55,7 @@ impl std::str::FromStr for WalFormat {
         match s.to_lowercase().as_str() {
             "binary" => Ok(Self::Binary),
             "json_lines" => Ok(Self::JsonLines),
+            "binary_v2" => Ok(Self::BinaryV2),
             _ => Err(format!("Invalid WAL format: {}", s)),
         }
     }
@@ -41,6 +66,113 @@ impl std::fmt::Display for WalFormat {
         match *self {
             Self::Binary => write!(f, "binary"),
             Self::JsonLines => write!(f, "json_lines"),
+            Self::BinaryV2 => write!(f, "binary_v2"),
+        }
+    }
+}
+
+/// Durability guarantee applied after each write (or each group-commit batch).
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, serde::Serialize, serde::Deserialize)]
+pub enum WalDurability {
+    /// Entries stay in the write buffer until it fills, the file rotates or a checkpoint runs.
+    /// Buffered entries are lost if the process exits before then.
+    Buffered,
+    /// Write buffers are flushed to the operating system after every write (default)
+    #[default]
+    Flush,
+    /// Flush and `fdatasync` after every write, or once per batch with group commit
+    FdatasyncPerEntry,
+    /// Flush after every write and `fdatasync` from a background task at the given interval
+    PeriodicFsync(Duration),
+}
+
+impl std::str::FromStr for WalDurability {
+    type Err = String;
+
+    fn from_str(s: &str) -> std::result::Result<Self, Self::Err> {
+        let lower = s.to_lowercase();
+        if let Some(interval) = lower.strip_prefix("periodic_fsync:") {
+            let millis = interval
+                .trim_end_matches("ms")
+                .parse::<u64>()
+                .map_err(|_| format!("Invalid periodic fsync interval: {}", interval))?;
+            if millis == 0 {
+                return Err("Periodic fsync interval must be greater than zero".to_owned());
+            }
+            return Ok(Self::PeriodicFsync(Duration::from_millis(millis)));
+        }
+        match lower.as_str() {
+            "buffered" | "none" => Ok(Self::Buffered),
+            "flush" => Ok(Self::Flush),
+            "fdatasync" | "fdatasync_per_entry" => Ok(Self::FdatasyncPerEntry),
+            _ => Err(format!("Invalid WAL durability: {}", s)),
+        }
+    }
+}
+
+impl std::fmt::Display for WalDurability {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match *self {
+            Self::Buffered => write!(f, "buffered"),
+            Self::Flush => write!(f, "flush"),
+            Self::FdatasyncPerEntry => write!(f, "fdatasync"),
+            Self::PeriodicFsync(interval) => write!(f, "periodic_fsync:{}ms", interval.as_millis()),
+        }
+    }
+}
+
+/// What a checkpoint does with the rotated segments it fully covers.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, serde::Serialize, serde::Deserialize)]
+pub enum WalRetention {
+    /// Keep checkpointed segments in place; readers still skip them
+    Keep,
+    /// Move checkpointed segments to the `archive` directory next to the WAL file
+    Archive,
+    /// Delete checkpointed segments (default)
+    #[default]
+    Delete,
+}
+
+impl std::str::FromStr for WalRetention {
+    type Err = String;
+
+    fn from_str(s: &str) -> std::result::Result<Self, Self::Err> {
+        match s.to_lowercase().as_str() {
+            "keep" => Ok(Self::Keep),
+            "archive" => Ok(Self::Archive),
+            "delete" => Ok(Self::Delete),
+            _ => Err(format!("Invalid WAL retention: {}", s)),
+        }
+    }
+}
+
+impl std::fmt::Display for WalRetention {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match *self {
+            Self::Keep => write!(f, "keep"),
+            Self::Archive => write!(f, "archive"),
+            Self::Delete => write!(f, "delete"),
+        }
+    }
+}
+
+/// Group-commit settings for the WAL writer.
+///
+/// When enabled, concurrent `write_entry` calls are queued to a dedicated writer task that
+/// appends them as one batch and flushes once per batch instead of once per entry.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, serde::Serialize, serde::Deserialize)]
+pub struct GroupCommitConfig {
+    /// Maximum number of entries committed together in one batch
+    pub max_batch_entries:  usize,
+    /// Maximum time in microseconds the writer waits for more entries before committing a batch
+    pub max_batch_delay_us: u64,
+}
+
+impl Default for GroupCommitConfig {
+    fn default() -> Self {
+        Self {
+            max_batch_entries:  256,
+            max_batch_delay_us: 500,
         }
     }
 }
@@ -56,6 +188,12 @@ pub struct WalConfig {
     pub max_records_per_file:  Option<usize>,
     /// WAL file format
     pub format:                WalFormat,
+    /// Optional group-commit settings, `None` writes every entry individually
+    pub group_commit:          Option<GroupCommitConfig>,
+    /// Durability guarantee applied after each write or batch
+    pub durability:            WalDurability,
+    /// What checkpoints do with fully checkpointed segments
+    pub retention:             WalRetention,
 }
 
 impl Default for WalConfig {
@@ -65,6 +203,9 @@ impl Default for WalConfig {
             compression_algorithm: Some(crate::CompressionAlgorithm::Zstd),
             max_records_per_file:  Some(1000),
             format:                WalFormat::default(),
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         }
     }
 }
@@ -80,6 +221,131 @@ pub struct WalManager {
     file:          Arc<tokio::sync::RwLock<BufWriter<File>>>,
     /// Number of entries written
     entries_count: Arc<Mutex<usize>>,
+    /// Size of the current WAL file in bytes, tracked in memory to avoid a stat per write
+    file_size:     Arc<AtomicU64>,
+    /// Queue feeding the group-commit writer task, if group commit is enabled
+    group_commit:  Option<mpsc::Sender<PendingWrite>>,
+    /// Log sequence number assigned to the next entry
+    next_lsn:      Arc<AtomicU64>,
+    /// Catalog of rotated segments and of the checkpoint position
+    catalog:       Arc<Mutex<SegmentCatalog>>,
+    /// Compression tasks of rotated segments that may still be running
+    compressions:  Arc<Mutex<Vec<JoinHandle<()>>>>,
+    /// Timings and volumes of the writes, possibly shared with other managers
+    metrics:       Arc<WalMetrics>,
+    /// Cipher encrypting the payload of every frame, if the WAL is encrypted
+    cipher:        Option<Arc<dyn PayloadCipher>>,
+}
+
+/// A serialized entry waiting for the group-commit writer
+#[derive(Debug)]
+struct PendingWrite {
+    /// The serialized entry bytes
+    bytes: Vec<u8>,
+    /// Completed once the batch containing the entry has been flushed
+    done:  oneshot::Sender<Result<()>>,
+}
+
+/// Payloads at least this large are encrypted on the blocking pool rather than inline, where the
+/// hand-off would cost more than the encryption itself
+const BLOCKING_ENCRYPTION_THRESHOLD: usize = 16 * 1024;
+
+/// Encrypt a serialized entry into a frame payload, off the reactor thread when it is large
+async fn encrypt_payload(cipher: &Arc<dyn PayloadCipher>, payload: Vec<u8>) -> Result<Vec<u8>> {
+    if payload.len() < BLOCKING_ENCRYPTION_THRESHOLD {
+        return frame::encrypt_payload(cipher.as_ref(), &payload);
+    }
+    let cipher = cipher.clone();
+    tokio::task::spawn_blocking(move || frame::encrypt_payload(cipher.as_ref(), &payload))
+        .await
+        .map_err(|e| {
+            WalError::Io(std::io::Error::other(format!(
+                "WAL encryption task failed: {}",
+                e
+            )))
+        })?
+}
+
+/// Recreate a batch failure for each waiter, as `WalError` is not `Clone`
+fn batch_error(error: &WalError) -> WalError {
+    match *error {
+        WalError::Io(ref e) => WalError::Io(std::io::Error::new(e.kind(), e.to_string())),
+        WalError::Serialization(ref msg) => WalError::Serialization(msg.clone()),
+        WalError::InvalidEntry(ref msg) => WalError::InvalidEntry(msg.clone()),
+        WalError::ChecksumMismatch => WalError::ChecksumMismatch,
+        WalError::FileSizeLimitExceeded => WalError::FileSizeLimitExceeded,
+        WalError::RecordLimitExceeded => WalError::RecordLimitExceeded,
+        WalError::LsnUnavailable {
+            requested,
+            oldest,
+        } => {
+            WalError::LsnUnavailable {
+                requested,
+                oldest,
+            }
+        },
+    }
+}
+
+/// Determine the format of a WAL file from its first bytes.
+///
+/// Files starting with the v2 header are read as `BinaryV2` whatever the configured format, and
+/// files without it fall back to the legacy `Binary` reader when `BinaryV2` is configured.
+pub(crate) fn detect_format(head: &[u8], configured: WalFormat) -> WalFormat {
+    if frame::parse_file_header(head).is_some() {
+        return WalFormat::BinaryV2;
+    }
+    match configured {
+        WalFormat::Binary | WalFormat::BinaryV2 => WalFormat::Binary,
+        WalFormat::JsonLines => WalFormat::JsonLines,
+    }
+}
+
+/// Parse the frames of a v2 WAL file held in memory.
+///
+/// Corrupted frames are skipped up to the next frame marker and a torn tail is discarded, and
+/// encrypted frames are decrypted with `cipher`.
+fn parse_v2_entries(buffer: &[u8], cipher: Option<&dyn PayloadCipher>) -> Vec<LogEntry> {
+    let mut entries = Vec::new();
+    let mut offset = frame::FILE_HEADER_LEN;
+    while let Some(remaining) = buffer.get(offset ..) &&
+        !remaining.is_empty()
+    {
+        match frame::decode_frame(remaining) {
+            Frame::Valid {
+                payload,
+                len,
+                ..
+            } => {
+                match frame::decrypt_payload(cipher, payload).and_then(|payload| LogEntry::from_payload(&payload)) {
+                    Ok(entry) => {
+                        trace!("Parsed binary v2 entry: {:?}", entry.entry_type);
+                        entries.push(entry);
+                    },
+                    Err(e) => {
+                        warn!("Skipping invalid WAL entry: {}", e);
+                    },
+                }
+                offset = offset.saturating_add(len);
+            },
+            Frame::Incomplete | Frame::Corrupt => {
+                if let Some(skip) = frame::resync(remaining) {
+                    warn!("Skipping {} corrupted bytes at offset {}", skip, offset);
+                    offset = offset.saturating_add(skip);
+                }
+                else {
+                    warn!(
+                        "Discarding {} bytes of torn WAL tail at offset {}",
+                        remaining.len(),
+                        offset
+                    );
+                    break;
+                }
+            },
+        }
+    }
+    debug!("Parsed {} binary v2 entries", entries.len());
+    entries
 }
 
 impl WalManager {
@@ -124,6 +390,18 @@ impl WalManager {
     /// # }
     /// ```
     pub async fn new(path: PathBuf, config: WalConfig) -> Result<Self> {
+        Self::new_with_metrics(path, config, Arc::default()).await
+    }
+
+    /// Create a new WAL manager recording its write timings and volumes into `metrics`.
+    ///
+    /// Behaves like [`Self::new`]. Several managers can share one [`WalMetrics`] to report the
+    /// writes of a whole store together.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::Io` - If directory creation or file operations fail
+    pub async fn new_with_metrics(path: PathBuf, config: WalConfig, metrics: Arc<WalMetrics>) -> Result<Self> {
         debug!(
             "Creating WAL manager at {:?} with config: max_file_size={:?}, compression={:?}, max_records={:?}, \
              format={:?}",
@@ -142,24 +420,82 @@ impl WalManager {
             .append(true)
             .open(&path)
             .await?;
+        let file_size = file.metadata().await?.len();
+        let catalog = SegmentCatalog::load(&SegmentCatalog::path_for(&path)).await?;
 
-        let manager = Self {
+        let mut manager = Self {
             path: path.clone(),
             config,
             file: Arc::new(tokio::sync::RwLock::new(BufWriter::new(file))),
             entries_count: Arc::new(Mutex::new(0)),
+            file_size: Arc::new(AtomicU64::new(file_size)),
+            group_commit: None,
+            next_lsn: Arc::new(AtomicU64::new(catalog.current_first_lsn)),
+            catalog: Arc::new(Mutex::new(catalog)),
+            compressions: Arc::new(Mutex::new(Vec::new())),
+            metrics,
+            cipher: None,
         };
 
+        if manager.config.format == WalFormat::BinaryV2 {
+            manager.prepare_v2_file().await?;
+        }
+        else if file_size > 0 {
+            manager.skip_unnumbered_entries().await?;
+        }
+
+        if let Some(group_commit) = manager.config.group_commit {
+            debug!(
+                "Group commit enabled: max_batch_entries={}, max_batch_delay_us={}",
+                group_commit.max_batch_entries, group_commit.max_batch_delay_us
+            );
+            manager.group_commit = Some(manager.spawn_group_commit_writer(group_commit));
+        }
+
+        if let WalDurability::PeriodicFsync(interval) = manager.config.durability {
+            debug!("Periodic fsync enabled every {:?}", interval);
+            manager.spawn_periodic_sync(interval);
+        }
+
         info!("WAL manager initialized successfully at {:?}", path);
         Ok(manager)
     }
 
+    /// Encrypt the entries written from now on with `cipher`, and decrypt encrypted entries when
+    /// reading.
+    ///
+    /// Only the payload of `BinaryV2` frames is encrypted. Entries written before the cipher was
+    /// set stay readable, so an existing WAL can start encrypting at any point. Payloads of
+    /// 16 KiB or more are encrypted on the blocking pool, and segments read through
+    /// [`Self::segments`] are decrypted there as a whole.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::InvalidEntry` - If the WAL is not configured with the `BinaryV2` format
+    pub fn with_cipher(mut self, cipher: Arc<dyn PayloadCipher>) -> Result<Self> {
+        if self.config.format != WalFormat::BinaryV2 {
+            return Err(WalError::InvalidEntry(format!(
+                "WAL encryption requires the BinaryV2 format, {:?} is configured",
+                self.config.format
+            )));
+        }
+        debug!("Encrypting the entries of WAL {:?}", self.path);
+        self.cipher = Some(cipher);
+        Ok(self)
+    }
+
+    /// Whether the entries written to the WAL are encrypted.
+    pub const fn is_encrypted(&self) -> bool { self.cipher.is_some() }
+
     /// Write a log entry to the WAL.
     ///
     /// This method appends a log entry to the WAL file using the configured format
     /// (binary or JSON Lines). The entry is serialized and written atomically to ensure
     /// data integrity. For JSON Lines format, each entry is written as a separate line.
     ///
+    /// When group commit is enabled, the entry is handed to the writer task and this method
+    /// returns once the batch containing it has been flushed.
+    ///
     /// # Arguments
     ///
     /// * `entry` - The log entry to write to the WAL
@@ -212,79 +548,389 @@ impl WalManager {
             entry.entry_type, self.config.format
         );
 
-        let bytes = match self.config.format {
+        let mut bytes = self.serialize_entry(&entry).await?;
+
+        if let Some(ref queue) = self.group_commit {
+            let (done, committed) = oneshot::channel();
+            queue
+                .send(PendingWrite {
+                    bytes,
+                    done,
+                })
+                .await
+                .map_err(|_| WalError::Io(std::io::Error::other("WAL group-commit writer has stopped")))?;
+            committed.await.map_err(|_| {
+                WalError::Io(std::io::Error::other(
+                    "WAL group-commit writer dropped the entry",
+                ))
+            })??;
+            debug!("WAL entry committed by group commit");
+            return Ok(());
+        }
+
+        self.append_batch(&mut [bytes.as_mut_slice()]).await?;
+
+        debug!("WAL entry written successfully");
+        Ok(())
+    }
+
+    /// Write several log entries to the WAL as one batch.
+    ///
+    /// All entries are serialized up front and appended with a single flush (and a single
+    /// durability barrier), which is much cheaper than calling `write_entry` for each of them.
+    /// Entries are written in the given order; callers wanting atomic replay should wrap them
+    /// in `Begin`/`Commit` entries sharing a transaction ID.
+    ///
+    /// # Arguments
+    ///
+    /// * `entries` - The log entries to write, in order
+    ///
+    /// # Returns
+    ///
+    /// Returns `Ok(())` once every entry has been written, or a `WalError` if the operation fails.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::Serialization` - If any entry fails to serialize, in which case nothing is
+    ///   written
+    /// * `WalError::Io` - If file write operations fail
+    pub async fn write_entries(&self, entries: &[LogEntry]) -> Result<()> {
+        debug!(
+            "Writing batch of {} WAL entries in format {:?}",
+            entries.len(),
+            self.config.format
+        );
+
+        let mut serialized = Vec::with_capacity(entries.len());
+        for entry in entries {
+            serialized.push(self.serialize_entry(entry).await?);
+        }
+        let mut buffers: Vec<&mut [u8]> = serialized.iter_mut().map(Vec::as_mut_slice).collect();
+        self.append_batch(&mut buffers).await?;
+
+        debug!(
+            "WAL batch of {} entries written successfully",
+            entries.len()
+        );
+        Ok(())
+    }
+
+    /// Serialize an entry in the configured WAL format, encrypting it when the WAL has a cipher
+    async fn serialize_entry(&self, entry: &LogEntry) -> Result<Vec<u8>> {
+        match self.config.format {
             WalFormat::Binary => {
                 trace!("Serializing entry to binary format");
-                entry.to_bytes()?
+                entry.to_bytes()
             },
             WalFormat::JsonLines => {
                 trace!("Serializing entry to JSON format");
                 let json = entry.to_json()?;
                 let mut bytes = json.into_bytes();
                 bytes.push(b'\n'); // Add newline for JSON Lines format
-                bytes
+                Ok(bytes)
             },
-        };
-
-        let entry_size = bytes.len() as u64;
+            WalFormat::BinaryV2 => {
+                trace!("Serializing entry to a binary v2 frame");
+                let payload = entry.to_payload()?;
+                match self.cipher {
+                    Some(ref cipher) => frame::encode_frame(&encrypt_payload(cipher, payload).await?),
+                    None => frame::encode_frame(&payload),
+                }
+            },
+        }
+    }
 
-        // Check file size limit and rotate if needed
-        if let Some(max_size) = self.config.max_file_size {
-            let current_size = tokio::fs::metadata(&self.path).await?.len();
-            #[allow(
-                clippy::arithmetic_side_effects,
-                reason = "safe addition for size check"
-            )]
-            if current_size + entry_size > max_size {
-                debug!(
-                    "File size limit reached ({} + {} > {}), rotating",
-                    current_size, entry_size, max_size
-                );
-                self.rotate().await?;
-            }
+    /// Prepare the current file for `BinaryV2` frames.
+    ///
+    /// A new file receives the v2 header. For an existing v2 file, the LSN counter resumes after
+    /// the last frame, or at the catalog position if that is further. A non-empty file in an older
+    /// format is rotated out so that v2 frames never follow legacy entries in the same file.
+    async fn prepare_v2_file(&self) -> Result<()> {
+        if self.file_size.load(Ordering::Acquire) == 0 {
+            return self.write_v2_header().await;
         }
 
-        // Check record limit and rotate if needed
-        if let Some(max_records) = self.config.max_records_per_file {
-            let count = *self.entries_count.lock().await;
-            if count >= max_records {
-                debug!(
-                    "Record limit reached ({} >= {}), rotating",
-                    count, max_records
+        match Self::scan_v2_file(&self.path).await? {
+            Some(next_lsn) => {
+                debug!("Resuming v2 WAL {:?} at LSN {}", self.path, next_lsn);
+                self.next_lsn.fetch_max(next_lsn, Ordering::AcqRel);
+                Ok(())
+            },
+            None => {
+                info!(
+                    "WAL file {:?} uses an older format, rotating it before writing v2 frames",
+                    self.path
                 );
-                self.rotate().await?;
-            }
+                self.skip_unnumbered_entries().await?;
+                self.rotate().await
+            },
         }
+    }
+
+    /// Advance the LSN counter past the entries of a current file in a format without LSNs.
+    ///
+    /// Such entries are numbered in file order, starting at the first LSN of the file.
+    async fn skip_unnumbered_entries(&self) -> Result<()> {
+        let existing = WalSegment::open(&self.path, self.config.format)
+            .await?
+            .entries()
+            .count() as u64;
+        trace!(
+            "Current WAL file {:?} holds {} entries",
+            self.path,
+            existing
+        );
+        self.next_lsn.fetch_add(existing, Ordering::AcqRel);
+        Ok(())
+    }
 
+    /// Write the v2 file header to the (empty) current file
+    async fn write_v2_header(&self) -> Result<()> {
+        let header = frame::file_header(self.next_lsn.load(Ordering::Acquire));
         let mut file = self.file.write().await;
-        file.write_all(&bytes).await?;
+        file.write_all(&header).await?;
         file.flush().await?;
-        drop(file);
+        self.file_size
+            .fetch_add(header.len() as u64, Ordering::AcqRel);
+        Ok(())
+    }
 
-        #[allow(clippy::arithmetic_side_effects, reason = "safe counter increment")]
-        {
-            *self.entries_count.lock().await += 1;
+    /// Find the LSN following the last frame of a v2 file, or `None` if it is not a v2 file.
+    ///
+    /// Only frame headers are read: payloads are skipped using the length prefix.
+    async fn scan_v2_file(path: &Path) -> Result<Option<u64>> {
+        let mut reader = BufReader::new(File::open(path).await?);
+        let mut header = [0_u8; frame::FILE_HEADER_LEN];
+        match reader.read_exact(&mut header).await {
+            Ok(_) => {},
+            Err(e) if e.kind() == std::io::ErrorKind::UnexpectedEof => return Ok(None),
+            Err(e) => return Err(e.into()),
+        }
+        let Some(mut next_lsn) = frame::parse_file_header(&header)
+        else {
+            return Ok(None);
+        };
+
+        let mut frame_header = [0_u8; frame::FRAME_HEADER_LEN];
+        loop {
+            match reader.read_exact(&mut frame_header).await {
+                Ok(_) => {},
+                Err(e) if e.kind() == std::io::ErrorKind::UnexpectedEof => break,
+                Err(e) => return Err(e.into()),
+            }
+            let Some((lsn, length)) = frame::peek_header(&frame_header)
+            else {
+                // A torn or corrupted tail, new frames are appended after it
+                break;
+            };
+            next_lsn = next_lsn.max(lsn.saturating_add(1));
+            reader
+                .seek(SeekFrom::Current(i64::try_from(length).unwrap_or(i64::MAX)))
+                .await?;
         }
+        Ok(Some(next_lsn))
+    }
 
-        debug!("WAL entry written successfully");
+    /// Append serialized entries to the WAL file and flush once at the end.
+    ///
+    /// Size and record limits are checked before each entry, so a batch may span a rotation.
+    /// Every entry takes the next LSN while the file lock is held, so LSNs follow the file
+    /// order; `BinaryV2` frames are sealed with it.
+    async fn append_batch(&self, entries: &mut [&mut [u8]]) -> Result<()> {
+        let started = Instant::now();
+        let batch_len = entries.len();
+        let mut batch_bytes = 0u64;
+        for bytes in entries.iter_mut() {
+            let bytes: &mut [u8] = bytes;
+            let entry_size = bytes.len() as u64;
+
+            // Check file size limit and rotate if needed
+            if let Some(max_size) = self.config.max_file_size {
+                let current_size = self.file_size.load(Ordering::Acquire);
+                if current_size.saturating_add(entry_size) > max_size {
+                    debug!(
+                        "File size limit reached ({} + {} > {}), rotating",
+                        current_size, entry_size, max_size
+                    );
+                    self.rotate().await?;
+                }
+            }
+
+            // Check record limit and rotate if needed
+            if let Some(max_records) = self.config.max_records_per_file {
+                let count = *self.entries_count.lock().await;
+                if count >= max_records {
+                    debug!(
+                        "Record limit reached ({} >= {}), rotating",
+                        count, max_records
+                    );
+                    self.rotate().await?;
+                }
+            }
+
+            let mut file = self.file.write().await;
+            let lsn = self.next_lsn.fetch_add(1, Ordering::AcqRel);
+            if self.config.format == WalFormat::BinaryV2 {
+                frame::seal_frame(bytes, lsn);
+            }
+            file.write_all(bytes).await?;
+            drop(file);
+            self.file_size.fetch_add(entry_size, Ordering::AcqRel);
+            batch_bytes = batch_bytes.saturating_add(entry_size);
+
+            #[allow(clippy::arithmetic_side_effects, reason = "safe counter increment")]
+            {
+                *self.entries_count.lock().await += 1;
+            }
+        }
+
+        self.apply_durability().await?;
+        self.metrics
+            .record_append(started.elapsed(), batch_len, batch_bytes);
+        trace!("Committed batch of {} WAL entries", batch_len);
+        Ok(())
+    }
+
+    /// Apply the configured durability guarantee to the entries written so far
+    async fn apply_durability(&self) -> Result<()> {
+        match self.config.durability {
+            WalDurability::Buffered => {},
+            WalDurability::Flush | WalDurability::PeriodicFsync(_) => {
+                let mut file = self.file.write().await;
+                let started = Instant::now();
+                file.flush().await?;
+                self.metrics.record_flush(started.elapsed());
+            },
+            WalDurability::FdatasyncPerEntry => {
+                let mut file = self.file.write().await;
+                let started = Instant::now();
+                file.flush().await?;
+                self.metrics.record_flush(started.elapsed());
+                let started = Instant::now();
+                file.get_ref().sync_data().await?;
+                self.metrics.record_fsync(started.elapsed());
+            },
+        }
         Ok(())
     }
 
-    /// Compress a WAL file using the specified algorithm
-    async fn compress_file(path: &PathBuf, alg: crate::CompressionAlgorithm) -> Result<()> {
+    /// Spawn the background task syncing the WAL file at a fixed interval.
+    ///
+    /// The task only holds a weak reference to the file and stops once the manager is dropped.
+    fn spawn_periodic_sync(&self, interval: Duration) {
+        let file = Arc::downgrade(&self.file);
+        let path = self.path.clone();
+        let metrics = self.metrics.clone();
+        tokio::spawn(async move {
+            let mut ticker = tokio::time::interval(interval);
+            ticker.set_missed_tick_behavior(tokio::time::MissedTickBehavior::Delay);
+            // The first tick completes immediately
+            ticker.tick().await;
+            loop {
+                ticker.tick().await;
+                let Some(file) = file.upgrade()
+                else {
+                    break;
+                };
+                let mut writer = file.write().await;
+                let started = Instant::now();
+                let synced = match writer.flush().await {
+                    Ok(()) => writer.get_ref().sync_data().await,
+                    Err(e) => Err(e),
+                };
+                drop(writer);
+                if synced.is_ok() {
+                    metrics.record_fsync(started.elapsed());
+                }
+                if let Err(e) = synced {
+                    warn!("Periodic fsync of WAL file {:?} failed: {}", path, e);
+                }
+            }
+            debug!("Periodic fsync task stopped for {:?}", path);
+        });
+    }
+
+    /// Spawn the group-commit writer task and return the queue feeding it.
+    ///
+    /// The task collects pending entries until either `max_batch_entries` are queued or
+    /// `max_batch_delay_us` has elapsed since the first one, appends them with a single flush
+    /// and then completes every waiter. It stops once all senders have been dropped.
+    fn spawn_group_commit_writer(&self, group_commit: GroupCommitConfig) -> mpsc::Sender<PendingWrite> {
+        let max_batch = group_commit.max_batch_entries.max(1);
+        let max_delay = Duration::from_micros(group_commit.max_batch_delay_us);
+        let (queue, mut pending) = mpsc::channel::<PendingWrite>(max_batch.saturating_mul(4));
+        let writer = self.writer_view();
+
+        tokio::spawn(async move {
+            let mut batch = Vec::with_capacity(max_batch);
+            while let Some(first) = pending.recv().await {
+                batch.push(first);
+                let deadline = tokio::time::Instant::now()
+                    .checked_add(max_delay)
+                    .unwrap_or_else(tokio::time::Instant::now);
+
+                while batch.len() < max_batch {
+                    match pending.try_recv() {
+                        Ok(next) => batch.push(next),
+                        Err(mpsc::error::TryRecvError::Disconnected) => break,
+                        Err(mpsc::error::TryRecvError::Empty) => {
+                            match tokio::time::timeout_at(deadline, pending.recv()).await {
+                                Ok(Some(next)) => batch.push(next),
+                                Ok(None) | Err(_) => break,
+                            }
+                        },
+                    }
+                }
+
+                let mut buffers: Vec<&mut [u8]> = batch
+                    .iter_mut()
+                    .map(|entry| entry.bytes.as_mut_slice())
+                    .collect();
+                let result = writer.append_batch(&mut buffers).await;
+                drop(buffers);
+                trace!("Group commit of {} WAL entries completed", batch.len());
+
+                for entry in batch.drain(..) {
+                    let outcome = match result {
+                        Ok(()) => Ok(()),
+                        Err(ref e) => Err(batch_error(e)),
+                    };
+                    // The waiter may have been cancelled, which is not an error for the batch
+                    drop(entry.done.send(outcome));
+                }
+            }
+            debug!("WAL group-commit writer stopped for {:?}", writer.path);
+        });
+
+        queue
+    }
+
+    /// Create a view sharing this manager's file state without the group-commit queue
+    fn writer_view(&self) -> Self {
+        Self {
+            path:          self.path.clone(),
+            config:        self.config.clone(),
+            file:          self.file.clone(),
+            entries_count: self.entries_count.clone(),
+            file_size:     self.file_size.clone(),
+            group_commit:  None,
+            next_lsn:      self.next_lsn.clone(),
+            catalog:       self.catalog.clone(),
+            compressions:  self.compressions.clone(),
+            metrics:       self.metrics.clone(),
+            cipher:        self.cipher.clone(),
+        }
+    }
+
+    /// Write a compressed copy of a WAL file using the specified algorithm
+    async fn compress_file(path: &Path, alg: crate::CompressionAlgorithm) -> Result<()> {
         debug!(
             "Starting compression of WAL file {:?} with algorithm {:?}",
             path, alg
         );
 
         let input = tokio::fs::File::open(&path).await?;
-        let compressed_path = match alg {
-            crate::CompressionAlgorithm::Zstd => path.with_extension("wal.zst"),
-            crate::CompressionAlgorithm::Lz4 => path.with_extension("wal.lz4"),
-            crate::CompressionAlgorithm::Brotli => path.with_extension("wal.br"),
-            crate::CompressionAlgorithm::Deflate => path.with_extension("wal.deflate"),
-            crate::CompressionAlgorithm::Gzip => path.with_extension("wal.gz"),
-        };
+        let compressed_path = compressed_path(path, alg);
 
         trace!("Compressed file will be saved as {:?}", compressed_path);
         let output = tokio::fs::File::create(&compressed_path).await?;
@@ -327,9 +973,6 @@ impl WalManager {
             },
         }
 
-        // Remove the original file after successful compression
-        trace!("Removing original uncompressed file {:?}", path);
-        tokio::fs::remove_file(&path).await?;
         tracing::info!(
             "Compressed WAL file {} to {}",
             path.display(),
@@ -338,50 +981,111 @@ impl WalManager {
         Ok(())
     }
 
-    /// Rotate the WAL file if limits are reached
+    /// Compress a rotated segment in the background.
+    ///
+    /// The catalog is updated before the uncompressed file is removed, so a crash in between
+    /// leaves a readable segment behind. The task is tracked so that checkpoints and readers can
+    /// wait for it.
+    async fn spawn_compression(&self, path: PathBuf, alg: crate::CompressionAlgorithm) {
+        let catalog = self.catalog.clone();
+        let catalog_path = SegmentCatalog::path_for(&self.path);
+        let file_name = path
+            .file_name()
+            .map(|name| name.to_string_lossy().into_owned())
+            .unwrap_or_default();
+
+        let task = tokio::spawn(async move {
+            let compressed = async {
+                Self::compress_file(&path, alg).await?;
+                let mut catalog = catalog.lock().await;
+                catalog.record_compression(&file_name, alg);
+                catalog.save(&catalog_path).await?;
+                drop(catalog);
+                trace!("Removing original uncompressed file {:?}", path);
+                tokio::fs::remove_file(&path).await?;
+                Ok::<(), WalError>(())
+            };
+            if let Err(e) = compressed.await {
+                tracing::error!("Failed to compress WAL file {}: {}", path.display(), e);
+            }
+        });
+
+        let mut compressions = self.compressions.lock().await;
+        compressions.retain(|task| !task.is_finished());
+        compressions.push(task);
+    }
+
+    /// Wait for the compression of rotated segments to finish
+    async fn wait_for_compressions(&self) {
+        let pending = std::mem::take(&mut *self.compressions.lock().await);
+        for task in pending {
+            if let Err(e) = task.await {
+                warn!("WAL compression task failed: {}", e);
+            }
+        }
+    }
+
+    /// Rotate the WAL file if limits are reached.
+    ///
+    /// The current file is renamed to `{stem}.{sequence}.wal`, using the sequence number from
+    /// the catalog so rotated names never collide, and recorded in the catalog with its LSN range.
     async fn rotate(&self) -> Result<()> {
         info!("Rotating WAL file at {:?}", self.path);
+        let started = Instant::now();
 
-        // Close current file
-        drop(self.file.write().await);
+        // Hold the file lock so no entry is appended between the LSN snapshot and the reopen
+        let mut file = self.file.write().await;
+        // Flush buffered writes so they land in the file being rotated out
+        file.flush().await?;
 
-        // Rename current file to wal.{timestamp}.wal
-        let timestamp = std::time::SystemTime::now()
-            .duration_since(std::time::UNIX_EPOCH)
-            .unwrap()
-            .as_secs();
-        let new_path = self.path.with_extension(format!("{}.wal", timestamp));
+        let mut catalog = self.catalog.lock().await;
+        let new_path = self
+            .path
+            .with_extension(format!("{:010}.wal", catalog.next_segment));
         debug!("Renaming WAL file from {:?} to {:?}", self.path, new_path);
         tokio::fs::rename(&self.path, &new_path).await?;
 
+        let next_lsn = self.next_lsn.load(Ordering::Acquire);
+        let file_name = new_path
+            .file_name()
+            .map(|name| name.to_string_lossy().into_owned())
+            .unwrap_or_default();
+        catalog.record_rotation(file_name, next_lsn);
+        catalog.save(&SegmentCatalog::path_for(&self.path)).await?;
+        drop(catalog);
+
+        // Create new file
+        debug!("Creating new WAL file at {:?}", self.path);
+        let new_file = OpenOptions::new()
+            .create(true)
+            .read(true)
+            .append(true)
+            .open(&self.path)
+            .await?;
+        *file = BufWriter::new(new_file);
+        self.file_size.store(0, Ordering::Release);
+        if self.config.format == WalFormat::BinaryV2 {
+            let header = frame::file_header(next_lsn);
+            file.write_all(&header).await?;
+            file.flush().await?;
+            self.file_size.store(header.len() as u64, Ordering::Release);
+        }
+        drop(file);
+        *self.entries_count.lock().await = 0;
+
         // If compression is enabled, compress asynchronously
         if let Some(alg) = self.config.compression_algorithm {
             debug!(
                 "Compression enabled with algorithm {:?}, starting async compression",
                 alg
             );
-            let path = new_path.clone();
-            tokio::spawn(async move {
-                if let Err(e) = Self::compress_file(&path, alg).await {
-                    tracing::error!("Failed to compress WAL file {}: {}", path.display(), e);
-                }
-            });
+            self.spawn_compression(new_path, alg).await;
         }
         else {
             trace!("Compression disabled, skipping compression step");
         }
 
-        // Create new file
-        debug!("Creating new WAL file at {:?}", self.path);
-        let file = OpenOptions::new()
-            .create(true)
-            .read(true)
-            .append(true)
-            .open(&self.path)
-            .await?;
-        *self.file.write().await = BufWriter::new(file);
-        *self.entries_count.lock().await = 0;
-
+        self.metrics.record_rotate(started.elapsed());
         info!("WAL file rotated successfully");
         Ok(())
     }
@@ -394,7 +1098,7 @@ impl WalManager {
             self.config.format
         );
 
-        match self.config.format {
+        match detect_format(buffer, self.config.format) {
             WalFormat::Binary => {
                 trace!("Parsing binary format entries");
                 self.parse_binary_entries(buffer)
@@ -403,6 +1107,10 @@ impl WalManager {
                 trace!("Parsing JSON Lines format entries");
                 self.parse_json_lines_entries(buffer)
             },
+            WalFormat::BinaryV2 => {
+                trace!("Parsing binary v2 frames");
+                Ok(parse_v2_entries(buffer, self.cipher.as_deref()))
+            },
         }
     }
 
@@ -533,6 +1241,7 @@ impl WalManager {
     /// detects the format (binary or JSON Lines) and parses entries accordingly.
     ///
     /// For binary format, entries are parsed by finding checksum boundaries.
+    /// For binary v2 files, entries are parsed frame by frame using their length prefixes.
     /// For JSON Lines format, entries are parsed line by line.
     ///
     /// # Returns
@@ -574,6 +1283,9 @@ impl WalManager {
     pub async fn read_all_entries(&self) -> Result<Vec<LogEntry>> {
         info!("Reading all WAL entries for recovery from {:?}", self.path);
 
+        // Make entries still held in the write buffer visible to the reader
+        self.file.write().await.flush().await?;
+
         let files = self.get_wal_files()?;
         debug!("Found {} WAL files to read", files.len());
         let mut all_entries = Vec::new();
@@ -595,13 +1307,173 @@ impl WalManager {
         Ok(all_entries)
     }
 
+    /// Rotated WAL files found in the directory that the catalog does not know about.
+    ///
+    /// These were rotated before the catalog existed and carry no LSN range.
+    fn uncataloged_files(&self, catalog: &SegmentCatalog) -> Result<Vec<PathBuf>> {
+        let mut files = self.get_wal_files()?;
+        files.retain(|file| {
+            file != &self.path &&
+                !file
+                    .file_name()
+                    .and_then(|name| name.to_str())
+                    .is_some_and(|name| catalog.contains(name))
+        });
+        Ok(files)
+    }
+
+    /// Directory holding the WAL file and its segments
+    fn wal_dir(&self) -> &Path { self.path.parent().unwrap_or_else(|| Path::new("")) }
+
+    /// Open the WAL segments for zero-copy reading, in replay order.
+    ///
+    /// Rotated segments come first, oldest first, followed by the current file. Replay starts
+    /// after the last checkpoint: fully checkpointed segments are left out and entries covered by
+    /// the checkpoint are skipped. Each segment is loaded only when requested through
+    /// [`WalSegments::next_segment`] (compressed segments are decompressed in memory), and its
+    /// entries are decoded as borrowed [`LogEntryRef`](crate::LogEntryRef) views.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::Io` - If the write buffer cannot be flushed or the directory cannot be listed
+    pub async fn segments(&self) -> Result<WalSegments> {
+        // Make entries still held in the write buffer visible to the reader
+        self.file.write().await.flush().await?;
+        // Rotated segments are being renamed by their compression task until it completes
+        self.wait_for_compressions().await;
+
+        let catalog = self.catalog.lock().await.clone();
+        let start_lsn = catalog.checkpoint_lsn.saturating_add(1);
+        let mut sources = Vec::new();
+
+        // Files rotated before the catalog existed predate any checkpoint
+        if catalog.checkpoint_lsn == 0 {
+            sources.extend(
+                self.uncataloged_files(&catalog)?
+                    .into_iter()
+                    .map(SegmentSource::plain),
+            );
+        }
+        let dir = self.wal_dir();
+        sources.extend(
+            catalog
+                .segments
+                .iter()
+                .filter(|segment| !segment.checkpointed)
+                .map(|segment| {
+                    SegmentSource {
+                        path: segment.path_in(dir),
+                        compression: segment.compression,
+                        first_lsn: segment.first_lsn,
+                        start_lsn,
+                    }
+                }),
+        );
+        if self.path.exists() {
+            sources.push(SegmentSource {
+                path: self.path.clone(),
+                compression: None,
+                first_lsn: catalog.current_first_lsn,
+                start_lsn,
+            });
+        }
+
+        debug!(
+            "Opening {} WAL segments for reading from LSN {}",
+            sources.len(),
+            start_lsn
+        );
+        Ok(WalSegments::new(
+            sources,
+            self.config.format,
+            self.cipher.clone(),
+        ))
+    }
+
+    /// Snapshot the segments holding the entries after LSN `after`, for the change feed.
+    ///
+    /// Unlike [`WalManager::segments`], checkpointed segments still listed in the catalog are
+    /// included, as consumers of the feed may lag behind the checkpoints. The current file is
+    /// loaded while appends are locked out, so no entry can be rotated out between the catalog
+    /// snapshot and the read. Rotated files the catalog does not know about carry no LSN range
+    /// and are left out.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::LsnUnavailable` - If the entries right after `after` were already retired
+    /// * `WalError::Io` - If the write buffer cannot be flushed or the current file cannot be read
+    pub(crate) async fn change_segments(&self, after: u64) -> Result<ChangeSegments> {
+        let mut file = self.file.write().await;
+        file.flush().await?;
+        // Compressions only touch the catalog, so they can finish while appends are locked out
+        self.wait_for_compressions().await;
+
+        let catalog = self.catalog.lock().await.clone();
+        let requested = after.saturating_add(1);
+        let oldest = catalog
+            .segments
+            .first()
+            .map_or(catalog.current_first_lsn, |segment| segment.first_lsn);
+        if requested < oldest {
+            return Err(WalError::LsnUnavailable {
+                requested,
+                oldest,
+            });
+        }
+
+        let dir = self.wal_dir();
+        let rotated = catalog
+            .segments
+            .iter()
+            .filter(|segment| segment.last_lsn >= requested)
+            .map(|segment| {
+                SegmentSource {
+                    path:        segment.path_in(dir),
+                    compression: segment.compression,
+                    first_lsn:   segment.first_lsn,
+                    start_lsn:   requested,
+                }
+            })
+            .collect::<Vec<_>>();
+        let current = match WalSegment::open(self.path.clone(), self.config.format).await {
+            Ok(segment) => {
+                let segment = match self.cipher {
+                    Some(ref cipher) => segment.decrypt(cipher.clone()).await?,
+                    None => segment,
+                };
+                Some(segment.with_lsn_range(catalog.current_first_lsn, requested))
+            },
+            Err(WalError::Io(ref e)) if e.kind() == std::io::ErrorKind::NotFound => None,
+            Err(e) => return Err(e),
+        };
+        let last_lsn = self.next_lsn.load(Ordering::Acquire).saturating_sub(1);
+        drop(file);
+
+        debug!(
+            "Reading changes of {:?} from LSN {} across {} rotated segments",
+            self.path,
+            requested,
+            rotated.len()
+        );
+        Ok(ChangeSegments {
+            rotated,
+            current,
+            format: self.config.format,
+            compression: self.config.compression_algorithm,
+            cipher: self.cipher.clone(),
+            last_lsn,
+        })
+    }
+
     /// Stream log entries from the WAL file.
     ///
     /// This method provides a streaming interface to read WAL entries without loading
     /// the entire file into memory. It's more memory-efficient than `read_all_entries()`
     /// for large WAL files. The stream automatically handles format detection and parsing.
     ///
-    /// For binary format, entries are streamed by reading length prefixes.
+    /// For binary v2 files, entries are streamed frame by frame using their length prefixes,
+    /// resynchronising on the next frame marker after a corrupted frame.
+    /// For legacy binary files, entries are streamed by finding checksum boundaries.
     /// For JSON Lines format, entries are streamed line by line.
     ///
     /// # Returns
@@ -649,20 +1521,101 @@ impl WalManager {
         reason = "safe operations in streaming binary parsing"
     )]
     pub fn stream_entries(&self) -> impl Stream<Item = Result<LogEntry>> + Send + 'static {
-        let wal = Self {
-            path:          self.path.clone(),
-            config:        self.config.clone(),
-            file:          self.file.clone(),
-            entries_count: self.entries_count.clone(),
-        };
+        let wal = self.writer_view();
         stream! {
             let path = wal.path.clone();
             let format = wal.config.format;
             debug!("Streaming WAL entries from {:?} in format {:?}", path, format);
+            // Make entries still held in the write buffer visible to the reader
+            if let Err(e) = wal.file.write().await.flush().await {
+                warn!("Failed to flush WAL buffer before streaming {:?}: {}", path, e);
+            }
             match File::open(&path).await {
                 Ok(file) => {
                     let mut reader = BufReader::new(file);
-                    match format {
+                    // Peek at the file header to tell v2 files from legacy ones
+                    let head = match reader.fill_buf().await {
+                        Ok(head) => head,
+                        Err(e) => {
+                            yield Err(e.into());
+                            return;
+                        }
+                    };
+                    match detect_format(head, format) {
+                        WalFormat::BinaryV2 => {
+                            trace!("Streaming binary v2 frames");
+                            reader.consume(frame::FILE_HEADER_LEN);
+                            let mut buffer = Vec::new();
+                            let mut start = 0_usize;
+                            let mut offset = frame::FILE_HEADER_LEN as u64;
+                            let mut eof = false;
+
+                            loop {
+                                let remaining = &buffer[start..];
+                                if remaining.is_empty() && eof {
+                                    break;
+                                }
+
+                                let mut need_more = false;
+                                match frame::decode_frame(remaining) {
+                                    Frame::Valid { payload, len, .. } => {
+                                        let entry = frame::decrypt_payload(wal.cipher.as_deref(), payload)
+                                            .and_then(|payload| LogEntry::from_payload(&payload));
+                                        match entry {
+                                            Ok(entry) => {
+                                                trace!("Streamed binary v2 entry: {:?}", entry.entry_type);
+                                                yield Ok(entry);
+                                            },
+                                            Err(e) => {
+                                                warn!("Skipping invalid WAL entry: {}", e);
+                                            },
+                                        }
+                                        start += len;
+                                        offset = offset.saturating_add(len as u64);
+                                    },
+                                    Frame::Incomplete if !eof => need_more = true,
+                                    Frame::Incomplete | Frame::Corrupt => {
+                                        match frame::resync(remaining) {
+                                            Some(skip) => {
+                                                warn!("Skipping {} corrupted bytes at offset {} of {:?}", skip, offset, path);
+                                                start += skip;
+                                                offset = offset.saturating_add(skip as u64);
+                                            },
+                                            None if eof => {
+                                                warn!("Discarding {} bytes of torn WAL tail at offset {} of {:?}", remaining.len(), offset, path);
+                                                break;
+                                            },
+                                            None => {
+                                                // Keep the bytes that may hold the start of the next marker
+                                                let skip = remaining.len().saturating_sub(frame::FRAME_MARKER.len() - 1);
+                                                start += skip;
+                                                offset = offset.saturating_add(skip as u64);
+                                                need_more = true;
+                                            },
+                                        }
+                                    },
+                                }
+
+                                if need_more {
+                                    // Drop consumed frames, then read the rest of the current one; the
+                                    // length prefix tells when it is complete, so no rescanning happens
+                                    buffer.drain(..start);
+                                    start = 0;
+                                    let filled = match reader.fill_buf().await {
+                                        Ok(chunk) => {
+                                            buffer.extend_from_slice(chunk);
+                                            chunk.len()
+                                        },
+                                        Err(e) => {
+                                            yield Err(e.into());
+                                            return;
+                                        }
+                                    };
+                                    reader.consume(filled);
+                                    eof = filled == 0;
+                                }
+                            }
+                        },
                         WalFormat::Binary => {
                             trace!("Streaming binary format entries");
                             // Read and parse entries incrementally to avoid loading large files into memory
@@ -779,14 +1732,13 @@ impl WalManager {
 
     /// Perform a checkpoint operation on the WAL.
     ///
-    /// A checkpoint ensures that all pending WAL entries are durably written to disk
-    /// and creates a recovery point. This is different from truncation - checkpointing
-    /// preserves the WAL for potential future recovery while marking a safe recovery point.
+    /// A checkpoint ensures that all pending WAL entries are durably written to disk. It never
+    /// removes anything: every entry is still replayed by recovery afterwards. Use
+    /// [`Self::checkpoint_through`] to also retire the entries whose changes the data files hold.
     ///
     /// The checkpoint process:
     /// 1. Flushes any buffered writes to disk
     /// 2. Ensures file metadata is synchronized
-    /// 3. Records the checkpoint position for recovery
     ///
     /// # Returns
     ///
@@ -794,7 +1746,7 @@ impl WalManager {
     ///
     /// # Errors
     ///
-    /// * `WalError::Io` - If file synchronization operations fail
+    /// * `WalError::Io` - If file synchronization fails
     ///
     /// # Examples
     ///
@@ -827,28 +1779,140 @@ impl WalManager {
     pub async fn checkpoint(&self) -> Result<()> {
         info!("Performing WAL checkpoint at {:?}", self.path);
 
+        let mut file = self.file.write().await;
         // Flush any buffered writes
         debug!("Flushing WAL file buffers");
-        self.file.write().await.flush().await?;
+        file.flush().await?;
 
         // Get the current file handle and sync to disk
         debug!("Syncing WAL file to disk");
-        self.file.write().await.get_ref().sync_all().await?;
+        let started = Instant::now();
+        file.get_ref().sync_all().await?;
+        self.metrics.record_fsync(started.elapsed());
+        drop(file);
 
-        // Record checkpoint position (current file size)
-        let checkpoint_position = self.size().await?;
-        debug!(
-            "Checkpoint created at position: {} bytes",
-            checkpoint_position
-        );
+        info!("WAL checkpoint completed successfully");
+        Ok(())
+    }
+
+    /// Perform a checkpoint and retire the entries up to `lsn`.
+    ///
+    /// Like [`Self::checkpoint`], this makes every entry durable. It then records that the data
+    /// files contain the changes of the entries up to `lsn`, or up to the last entry if lower.
+    /// Recovery and verification start after that point, and rotated segments the checkpoint
+    /// fully covers are archived or deleted according to the configured [`WalRetention`]. The
+    /// current file is kept as is, and entries after `lsn` are still replayed by recovery.
+    ///
+    /// # Caller responsibility
+    ///
+    /// The covered entries can no longer be replayed, so the caller must first make sure the
+    /// data files hold their changes durably, for example by syncing every file they touched.
+    /// A collection's `checkpoint_wal` does this before calling it.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::Io` - If file synchronization, the catalog update or segment removal fails
+    pub async fn checkpoint_through(&self, lsn: u64) -> Result<()> {
+        info!("Performing WAL checkpoint at {:?}", self.path);
+
+        let mut file = self.file.write().await;
+        // Flush any buffered writes
+        debug!("Flushing WAL file buffers");
+        file.flush().await?;
+
+        // Get the current file handle and sync to disk
+        debug!("Syncing WAL file to disk");
+        let started = Instant::now();
+        file.get_ref().sync_all().await?;
+        self.metrics.record_fsync(started.elapsed());
+
+        // Every entry appended so far may be covered, read while no append can take an LSN
+        let covered_lsn = self
+            .next_lsn
+            .load(Ordering::Acquire)
+            .saturating_sub(1)
+            .min(lsn);
+        drop(file);
+
+        // Segments must reach their final name before they can be retired
+        self.wait_for_compressions().await;
+
+        let mut catalog = self.catalog.lock().await;
+        // Files rotated before the catalog existed hold entries older than any LSN
+        let uncataloged = if catalog.checkpoint_lsn == 0 && (covered_lsn > 0 || lsn == u64::MAX) {
+            self.uncataloged_files(&catalog)?
+        }
+        else {
+            Vec::new()
+        };
+        catalog.record_checkpoint(covered_lsn);
+        let retired = if self.config.retention == WalRetention::Keep {
+            Vec::new()
+        }
+        else {
+            catalog.take_checkpointed()
+        };
+        catalog.save(&SegmentCatalog::path_for(&self.path)).await?;
+        drop(catalog);
+        debug!("Checkpoint recorded at LSN {}", covered_lsn);
+
+        // The catalog no longer lists the retired segments, so a crash from here on only leaves
+        // files behind
+        if self.config.retention != WalRetention::Keep {
+            for path in uncataloged {
+                self.retire_file(&path).await?;
+            }
+            for segment in &retired {
+                self.retire_segment(segment).await?;
+            }
+        }
 
         info!(
-            "WAL checkpoint completed successfully at position {}",
-            checkpoint_position
+            "WAL checkpoint completed successfully at LSN {} ({} segments retired)",
+            covered_lsn,
+            retired.len()
         );
         Ok(())
     }
 
+    /// Archive or delete the files of a checkpointed segment
+    async fn retire_segment(&self, segment: &SegmentInfo) -> Result<()> {
+        let dir = self.wal_dir();
+        let plain = dir.join(&segment.file_name);
+        self.retire_file(&segment.path_in(dir)).await?;
+        // A crash during compression can leave the uncompressed file next to the compressed one
+        if segment.compression.is_some() {
+            self.retire_file(&plain).await?;
+        }
+        Ok(())
+    }
+
+    /// Archive or delete one checkpointed WAL file, according to the retention policy
+    async fn retire_file(&self, path: &Path) -> Result<()> {
+        let outcome = match self.config.retention {
+            WalRetention::Keep => return Ok(()),
+            WalRetention::Archive => {
+                let archive = self.wal_dir().join("archive");
+                tokio::fs::create_dir_all(&archive).await?;
+                let target = archive.join(path.file_name().unwrap_or_default());
+                debug!(
+                    "Archiving checkpointed WAL segment {:?} to {:?}",
+                    path, target
+                );
+                tokio::fs::rename(path, &target).await
+            },
+            WalRetention::Delete => {
+                debug!("Deleting checkpointed WAL segment {:?}", path);
+                tokio::fs::remove_file(path).await
+            },
+        };
+        match outcome {
+            Ok(()) => Ok(()),
+            Err(e) if e.kind() == std::io::ErrorKind::NotFound => Ok(()),
+            Err(e) => Err(e.into()),
+        }
+    }
+
     /// Get the current size of the WAL file in bytes.
     ///
     /// This method returns the size of the WAL file on disk, which can be used
@@ -928,6 +1992,18 @@ impl WalManager {
         trace!("WAL entries count: {}", count);
         Ok(count)
     }
+
+    /// Get the write timings and volumes recorded by this manager.
+    ///
+    /// When the metrics are shared through [`Self::new_with_metrics`], the snapshot covers every
+    /// manager sharing them.
+    pub fn metrics(&self) -> crate::WalMetricsSnapshot { self.metrics.snapshot() }
+
+    /// Get the LSN of the last entry appended, 0 while nothing was ever appended.
+    pub fn last_lsn(&self) -> u64 { self.next_lsn.load(Ordering::Acquire).saturating_sub(1) }
+
+    /// Get the LSN of the last entry covered by a checkpoint, 0 before the first checkpoint.
+    pub async fn checkpoint_lsn(&self) -> u64 { self.catalog.lock().await.checkpoint_lsn }
 }
 
 #[cfg(test)]
@@ -938,6 +2014,39 @@ mod tests {
 
     use super::*;
 
+    #[tokio::test]
+    async fn test_wal_manager_records_write_metrics() {
+        let temp_dir = tempdir().unwrap();
+        let metrics = Arc::new(WalMetrics::default());
+        let config = WalConfig {
+            durability: WalDurability::FdatasyncPerEntry,
+            ..Default::default()
+        };
+        let wal = WalManager::new_with_metrics(temp_dir.path().join("test.wal"), config, metrics.clone())
+            .await
+            .unwrap();
+        let entries: Vec<LogEntry> = (0 .. 3)
+            .map(|i| {
+                LogEntry::new(
+                    crate::EntryType::Insert,
+                    "users".to_string(),
+                    format!("user-{}", i),
+                    Some(json!({"n": i})),
+                )
+            })
+            .collect();
+        wal.write_entries(&entries).await.unwrap();
+        wal.write_entry(entries[0].clone()).await.unwrap();
+
+        let snapshot = wal.metrics();
+        assert_eq!(snapshot, metrics.snapshot());
+        assert_eq!(snapshot.entries_written, 4);
+        assert_eq!(snapshot.append.count, 2);
+        assert_eq!(snapshot.batch_entries.max, 3);
+        assert_eq!(snapshot.fsync.count, 2);
+        assert_eq!(snapshot.bytes_written, wal.size().await.unwrap());
+    }
+
     // ============ WalFormat Tests ============
 
     #[test]
@@ -952,6 +2061,10 @@ mod tests {
             "json_lines".parse::<WalFormat>().unwrap(),
             WalFormat::JsonLines
         );
+        assert_eq!(
+            "binary_v2".parse::<WalFormat>().unwrap(),
+            WalFormat::BinaryV2
+        );
     }
 
     #[test]
@@ -974,6 +2087,42 @@ mod tests {
     fn test_wal_format_display() {
         assert_eq!(WalFormat::Binary.to_string(), "binary");
         assert_eq!(WalFormat::JsonLines.to_string(), "json_lines");
+        assert_eq!(WalFormat::BinaryV2.to_string(), "binary_v2");
+    }
+
+    #[test]
+    fn test_wal_durability_from_str_and_display() {
+        assert_eq!(
+            "buffered".parse::<WalDurability>().unwrap(),
+            WalDurability::Buffered
+        );
+        assert_eq!(
+            "FLUSH".parse::<WalDurability>().unwrap(),
+            WalDurability::Flush
+        );
+        assert_eq!(
+            "fdatasync".parse::<WalDurability>().unwrap(),
+            WalDurability::FdatasyncPerEntry
+        );
+        assert_eq!(
+            "periodic_fsync:250ms".parse::<WalDurability>().unwrap(),
+            WalDurability::PeriodicFsync(Duration::from_millis(250))
+        );
+        assert!("periodic_fsync:0".parse::<WalDurability>().is_err());
+        assert!("periodic_fsync:abc".parse::<WalDurability>().is_err());
+        assert!("always".parse::<WalDurability>().is_err());
+
+        for durability in [
+            WalDurability::Buffered,
+            WalDurability::Flush,
+            WalDurability::FdatasyncPerEntry,
+            WalDurability::PeriodicFsync(Duration::from_millis(100)),
+        ] {
+            assert_eq!(
+                durability.to_string().parse::<WalDurability>().unwrap(),
+                durability
+            );
+        }
     }
 
     #[test]
@@ -1022,6 +2171,9 @@ mod tests {
             compression_algorithm: Some(crate::CompressionAlgorithm::Lz4),
             max_records_per_file:  Some(500),
             format:                WalFormat::JsonLines,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         assert_eq!(config.max_file_size, Some(5 * 1024 * 1024));
@@ -1408,6 +2560,9 @@ mod tests {
             compression_algorithm: None,
             max_records_per_file:  None,
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -1439,6 +2594,9 @@ mod tests {
             compression_algorithm: None,
             max_records_per_file:  Some(10), // Set a limit
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -1727,6 +2885,9 @@ mod tests {
             max_file_size:         Some(100), // Small size to trigger rotation
             max_records_per_file:  None,
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -1761,6 +2922,9 @@ mod tests {
             max_file_size:         Some(200),
             max_records_per_file:  None,
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -1789,6 +2953,9 @@ mod tests {
             max_file_size:         Some(150),
             max_records_per_file:  None,
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -1817,6 +2984,9 @@ mod tests {
             max_file_size:         Some(100),
             max_records_per_file:  None,
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -1845,6 +3015,9 @@ mod tests {
             max_file_size:         Some(100),
             max_records_per_file:  None,
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -1874,6 +3047,9 @@ mod tests {
             max_file_size:         None,
             max_records_per_file:  Some(10),
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -2078,6 +3254,9 @@ mod tests {
             compression_algorithm: None,
             max_records_per_file:  None,
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -2178,6 +3357,9 @@ mod tests {
             compression_algorithm: None,
             max_records_per_file:  Some(5),
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -2217,6 +3399,9 @@ mod tests {
             compression_algorithm: None,
             max_records_per_file:  Some(3),
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -2345,6 +3530,9 @@ mod tests {
             max_records_per_file:  None,
             compression_algorithm: None,
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -2521,6 +3709,9 @@ not json at all
             max_records_per_file:  None,
             compression_algorithm: None,
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -2601,6 +3792,9 @@ not json at all
             compression_algorithm: None,
             max_records_per_file:  Some(2),
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -2780,6 +3974,9 @@ not json at all
             compression_algorithm: None,
             max_records_per_file:  Some(1),
             format:                WalFormat::Binary,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
         };
 
         let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
@@ -2851,4 +4048,689 @@ not json at all
 
         assert_eq!(streamed_types.len(), 6);
     }
+
+    #[tokio::test(flavor = "multi_thread", worker_threads = 4)]
+    async fn test_wal_manager_group_commit_concurrent_writes() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("test_group_commit.wal");
+
+        let config = WalConfig {
+            max_records_per_file: None,
+            group_commit: Some(GroupCommitConfig {
+                max_batch_entries:  16,
+                max_batch_delay_us: 1000,
+            }),
+            ..Default::default()
+        };
+        let wal = Arc::new(WalManager::new(wal_path.clone(), config).await.unwrap());
+
+        let mut handles = Vec::new();
+        for i in 0 .. 64 {
+            let wal = wal.clone();
+            handles.push(tokio::spawn(async move {
+                let entry = LogEntry::new(
+                    crate::EntryType::Insert,
+                    "users".to_string(),
+                    format!("user-{}", i),
+                    Some(json!({"index": i})),
+                );
+                wal.write_entry(entry).await
+            }));
+        }
+        for handle in handles {
+            handle.await.unwrap().unwrap();
+        }
+
+        assert_eq!(wal.entries_count().await.unwrap(), 64);
+
+        // Every waiter returns only after its batch was flushed, so all entries are readable
+        let read_entries = wal.read_all_entries().await.unwrap();
+        assert_eq!(read_entries.len(), 64);
+    }
+
+    #[tokio::test]
+    async fn test_wal_manager_group_commit_rotation_on_record_limit() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("test_group_commit_rotation.wal");
+
+        let config = WalConfig {
+            max_file_size: None,
+            compression_algorithm: None,
+            max_records_per_file: Some(2),
+            group_commit: Some(GroupCommitConfig::default()),
+            ..Default::default()
+        };
+        let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
+
+        for i in 0 .. 5 {
+            let entry = LogEntry::new(
+                crate::EntryType::Insert,
+                "users".to_string(),
+                format!("user-{}", i),
+                None,
+            );
+            wal.write_entry(entry).await.unwrap();
+        }
+
+        assert_eq!(wal.entries_count().await.unwrap(), 1);
+        assert_eq!(wal.read_all_entries().await.unwrap().len(), 1);
+    }
+
+    #[tokio::test]
+    async fn test_wal_manager_tracked_size_matches_file() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("test_tracked_size.wal");
+
+        let wal = WalManager::new(wal_path.clone(), WalConfig::default())
+            .await
+            .unwrap();
+        for i in 0 .. 3 {
+            let entry = LogEntry::new(
+                crate::EntryType::Insert,
+                "users".to_string(),
+                format!("user-{}", i),
+                Some(json!({"name": "Alice"})),
+            );
+            wal.write_entry(entry).await.unwrap();
+        }
+
+        let on_disk = tokio::fs::metadata(&wal_path).await.unwrap().len();
+        assert_eq!(wal.file_size.load(Ordering::Acquire), on_disk);
+
+        // Reopening an existing WAL starts from the current file size
+        drop(wal);
+        let reopened = WalManager::new(wal_path, WalConfig::default())
+            .await
+            .unwrap();
+        assert_eq!(reopened.file_size.load(Ordering::Acquire), on_disk);
+    }
+
+    #[tokio::test]
+    async fn test_wal_manager_durability_levels() {
+        let temp_dir = tempdir().unwrap();
+
+        for (name, durability) in [
+            ("buffered", WalDurability::Buffered),
+            ("flush", WalDurability::Flush),
+            ("fdatasync", WalDurability::FdatasyncPerEntry),
+            (
+                "periodic",
+                WalDurability::PeriodicFsync(Duration::from_millis(10)),
+            ),
+        ] {
+            let wal_path = temp_dir
+                .path()
+                .join(format!("test_durability_{}.wal", name));
+            let config = WalConfig {
+                durability,
+                ..Default::default()
+            };
+            let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
+
+            for i in 0 .. 3 {
+                let entry = LogEntry::new(
+                    crate::EntryType::Insert,
+                    "users".to_string(),
+                    format!("user-{}", i),
+                    Some(json!({"name": "Alice"})),
+                );
+                wal.write_entry(entry).await.unwrap();
+            }
+
+            // Buffered entries are flushed before reading, so every level reads back everything
+            assert_eq!(wal.read_all_entries().await.unwrap().len(), 3, "{}", name);
+        }
+    }
+
+    #[tokio::test]
+    async fn test_wal_manager_buffered_durability_defers_flush() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("test_buffered.wal");
+
+        let config = WalConfig {
+            durability: WalDurability::Buffered,
+            ..Default::default()
+        };
+        let wal = WalManager::new(wal_path.clone(), config).await.unwrap();
+        let entry = LogEntry::new(
+            crate::EntryType::Insert,
+            "users".to_string(),
+            "user-1".to_string(),
+            None,
+        );
+        wal.write_entry(entry).await.unwrap();
+
+        assert_eq!(tokio::fs::metadata(&wal_path).await.unwrap().len(), 0);
+
+        wal.checkpoint().await.unwrap();
+        assert!(tokio::fs::metadata(&wal_path).await.unwrap().len() > 0);
+    }
+
+    #[tokio::test]
+    async fn test_wal_manager_write_entries_batch() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("test_write_entries.wal");
+
+        let wal = WalManager::new(wal_path.clone(), WalConfig::default())
+            .await
+            .unwrap();
+
+        let entries: Vec<LogEntry> = (0 .. 10)
+            .map(|i| {
+                LogEntry::new(
+                    crate::EntryType::Insert,
+                    "users".to_string(),
+                    format!("user-{}", i),
+                    Some(json!({"index": i})),
+                )
+            })
+            .collect();
+        wal.write_entries(&entries).await.unwrap();
+
+        let read_entries = wal.read_all_entries().await.unwrap();
+        assert_eq!(read_entries, entries);
+        assert_eq!(wal.entries_count().await.unwrap(), 10);
+    }
+
+    // ============ Binary V2 Tests ============
+
+    /// Config writing v2 frames without rotation or compression
+    fn v2_config() -> WalConfig {
+        WalConfig {
+            max_file_size:         None,
+            compression_algorithm: None,
+            max_records_per_file:  None,
+            format:                WalFormat::BinaryV2,
+            group_commit:          None,
+            durability:            WalDurability::default(),
+            retention:             WalRetention::default(),
+        }
+    }
+
+    /// Entry with a large payload, as produced by big documents
+    fn large_entry(i: usize) -> LogEntry {
+        LogEntry::new(
+            crate::EntryType::Insert,
+            "test".to_string(),
+            format!("doc-{}", i),
+            Some(json!({"data": "x".repeat(64 * 1024), "i": i})),
+        )
+    }
+
+    #[tokio::test]
+    async fn test_binary_v2_roundtrip() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("v2.wal");
+        let wal = WalManager::new(wal_path.clone(), v2_config())
+            .await
+            .unwrap();
+
+        for i in 0 .. 3 {
+            wal.write_entry(large_entry(i)).await.unwrap();
+        }
+
+        let bytes = tokio::fs::read(&wal_path).await.unwrap();
+        assert_eq!(frame::parse_file_header(&bytes), Some(1));
+
+        let entries = wal.read_all_entries().await.unwrap();
+        assert_eq!(entries.len(), 3);
+        assert_eq!(entries[2].document_id_str(), "doc-2");
+
+        let streamed: Vec<_> = wal.stream_entries().collect().await;
+        assert_eq!(streamed.len(), 3);
+        assert!(streamed.iter().all(Result::is_ok));
+    }
+
+    /// Cipher XOR-ing every byte, enough to tell encrypted payloads from plain ones
+    #[derive(Debug)]
+    struct XorCipher;
+
+    impl PayloadCipher for XorCipher {
+        fn encrypt(&self, payload: &[u8]) -> Result<Vec<u8>> { Ok(payload.iter().map(|byte| byte ^ 0x5a).collect()) }
+
+        fn decrypt(&self, encrypted: &[u8]) -> Result<Vec<u8>> { self.encrypt(encrypted) }
+    }
+
+    #[tokio::test]
+    async fn test_binary_v2_encrypts_payloads() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("encrypted.wal");
+        let legacy = WalManager::new(
+            temp_dir.path().join("legacy.wal"),
+            WalConfig {
+                format: WalFormat::Binary,
+                ..v2_config()
+            },
+        )
+        .await
+        .unwrap();
+        assert!(legacy.with_cipher(Arc::new(XorCipher)).is_err());
+
+        // Entries written before the cipher is set stay readable
+        let wal = WalManager::new(wal_path.clone(), v2_config())
+            .await
+            .unwrap();
+        wal.write_entry(large_entry(0)).await.unwrap();
+        drop(wal);
+        let wal = WalManager::new(wal_path.clone(), v2_config())
+            .await
+            .unwrap()
+            .with_cipher(Arc::new(XorCipher))
+            .unwrap();
+        assert!(wal.is_encrypted());
+        wal.write_entries(&[
+            large_entry(1),
+            LogEntry::new(
+                crate::EntryType::Insert,
+                "test".to_string(),
+                "small".to_string(),
+                Some(json!({"secret": "plain text"})),
+            ),
+        ])
+        .await
+        .unwrap();
+
+        let bytes = tokio::fs::read(&wal_path).await.unwrap();
+        assert!(!bytes.windows(10).any(|window| window == b"plain text"));
+
+        assert_eq!(wal.read_all_entries().await.unwrap().len(), 3);
+        let streamed: Vec<_> = wal.stream_entries().collect().await;
+        assert_eq!(streamed.len(), 3);
+        assert!(streamed.iter().all(Result::is_ok));
+        let mut segments = wal.segments().await.unwrap();
+        let segment = segments.next_segment().await.unwrap().unwrap();
+        let ids: Vec<_> = segment
+            .entries()
+            .map(|entry| entry.document_id_str().to_owned())
+            .collect();
+        assert_eq!(ids, ["doc-0", "doc-1", "small"]);
+        drop(wal);
+
+        // Without the cipher, encrypted entries are skipped as invalid
+        let plain = WalManager::new(wal_path, v2_config()).await.unwrap();
+        assert_eq!(plain.read_all_entries().await.unwrap().len(), 1);
+    }
+
+    #[tokio::test]
+    async fn test_binary_v2_lsn_resumes_after_reopen() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("v2_reopen.wal");
+
+        let wal = WalManager::new(wal_path.clone(), v2_config())
+            .await
+            .unwrap();
+        wal.write_entries(&[large_entry(0), large_entry(1)])
+            .await
+            .unwrap();
+        drop(wal);
+
+        let wal = WalManager::new(wal_path.clone(), v2_config())
+            .await
+            .unwrap();
+        assert_eq!(wal.next_lsn.load(Ordering::Acquire), 3);
+        wal.write_entry(large_entry(2)).await.unwrap();
+
+        let bytes = tokio::fs::read(&wal_path).await.unwrap();
+        let mut offset = frame::FILE_HEADER_LEN;
+        let mut lsns = Vec::new();
+        while let Frame::Valid {
+            lsn,
+            len,
+            ..
+        } = frame::decode_frame(&bytes[offset ..])
+        {
+            lsns.push(lsn);
+            offset += len;
+        }
+        assert_eq!(lsns, vec![1, 2, 3]);
+    }
+
+    #[tokio::test]
+    async fn test_binary_v2_discards_torn_tail() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("v2_torn.wal");
+        let wal = WalManager::new(wal_path.clone(), v2_config())
+            .await
+            .unwrap();
+        for i in 0 .. 3 {
+            wal.write_entry(large_entry(i)).await.unwrap();
+        }
+
+        // Simulate a crash in the middle of the last frame
+        let size = wal.size().await.unwrap();
+        std::fs::OpenOptions::new()
+            .write(true)
+            .open(&wal_path)
+            .unwrap()
+            .set_len(size - 100)
+            .unwrap();
+
+        let entries = wal.read_all_entries().await.unwrap();
+        assert_eq!(entries.len(), 2);
+        let streamed: Vec<_> = wal.stream_entries().collect().await;
+        assert_eq!(streamed.len(), 2);
+    }
+
+    #[tokio::test]
+    async fn test_binary_v2_skips_corrupted_frame() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("v2_corrupt.wal");
+        let wal = WalManager::new(wal_path.clone(), v2_config())
+            .await
+            .unwrap();
+        for i in 0 .. 3 {
+            wal.write_entry(large_entry(i)).await.unwrap();
+        }
+
+        // Flip a payload byte of the first frame
+        let mut bytes = tokio::fs::read(&wal_path).await.unwrap();
+        bytes[frame::FILE_HEADER_LEN + frame::FRAME_HEADER_LEN + 10] ^= 0xff;
+        tokio::fs::write(&wal_path, &bytes).await.unwrap();
+
+        let entries = wal.read_all_entries().await.unwrap();
+        let ids: Vec<_> = entries
+            .iter()
+            .map(|e| e.document_id_str().to_owned())
+            .collect();
+        assert_eq!(ids, vec!["doc-1", "doc-2"]);
+
+        let streamed: Vec<_> = wal.stream_entries().collect().await;
+        assert_eq!(streamed.len(), 2);
+    }
+
+    #[tokio::test]
+    async fn test_binary_v2_reads_legacy_binary_files() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("wal.log");
+
+        let legacy = WalManager::new(
+            wal_path.clone(),
+            WalConfig {
+                format: WalFormat::Binary,
+                ..v2_config()
+            },
+        )
+        .await
+        .unwrap();
+        legacy.write_entry(large_entry(0)).await.unwrap();
+        drop(legacy);
+
+        // Opening with v2 rotates the legacy file out instead of appending frames to it
+        let wal = WalManager::new(wal_path.clone(), v2_config())
+            .await
+            .unwrap();
+        let bytes = tokio::fs::read(&wal_path).await.unwrap();
+        assert!(frame::parse_file_header(&bytes).is_some());
+        wal.write_entry(large_entry(1)).await.unwrap();
+
+        let mut ids: Vec<_> = wal
+            .read_all_entries()
+            .await
+            .unwrap()
+            .iter()
+            .map(|e| e.document_id_str().to_owned())
+            .collect();
+        ids.sort();
+        assert_eq!(ids, vec!["doc-0", "doc-1"]);
+    }
+
+    // ============ Segment Catalog Tests ============
+
+    /// Small entry for catalog tests
+    fn small_entry(i: usize) -> LogEntry {
+        LogEntry::new(
+            crate::EntryType::Insert,
+            "users".to_string(),
+            format!("user-{}", i),
+            Some(json!({"i": i})),
+        )
+    }
+
+    /// Configuration rotating every two records, in the given format and retention
+    fn catalog_config(format: WalFormat, retention: WalRetention) -> WalConfig {
+        WalConfig {
+            max_file_size: None,
+            compression_algorithm: None,
+            max_records_per_file: Some(2),
+            format,
+            retention,
+            ..Default::default()
+        }
+    }
+
+    /// Document IDs of every entry replayed from the segments of `wal`
+    async fn replayed_ids(wal: &WalManager) -> Vec<String> {
+        let mut segments = wal.segments().await.unwrap();
+        let mut ids = Vec::new();
+        while let Some(segment) = segments.next_segment().await {
+            let segment = segment.unwrap();
+            ids.extend(
+                segment
+                    .entries()
+                    .map(|view| view.document_id_str().to_owned()),
+            );
+        }
+        ids
+    }
+
+    #[tokio::test]
+    async fn test_rotation_records_segments_in_catalog() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("wal.wal");
+        let wal = WalManager::new(
+            wal_path.clone(),
+            catalog_config(WalFormat::BinaryV2, WalRetention::Keep),
+        )
+        .await
+        .unwrap();
+        for i in 0 .. 5 {
+            wal.write_entry(small_entry(i)).await.unwrap();
+        }
+
+        // Rotations within the same second no longer collide
+        assert!(temp_dir.path().join("wal.0000000001.wal").exists());
+        assert!(temp_dir.path().join("wal.0000000002.wal").exists());
+
+        let catalog = SegmentCatalog::load(&SegmentCatalog::path_for(&wal_path))
+            .await
+            .unwrap();
+        assert_eq!(catalog.next_segment, 3);
+        assert_eq!(catalog.current_first_lsn, 5);
+        let ranges: Vec<_> = catalog
+            .segments
+            .iter()
+            .map(|segment| (segment.first_lsn, segment.last_lsn))
+            .collect();
+        assert_eq!(ranges, vec![(1, 2), (3, 4)]);
+        assert_eq!(replayed_ids(&wal).await.len(), 5);
+    }
+
+    #[tokio::test]
+    async fn test_checkpoint_deletes_covered_segments_in_every_format() {
+        for format in [WalFormat::Binary, WalFormat::BinaryV2, WalFormat::JsonLines] {
+            let temp_dir = tempdir().unwrap();
+            let wal_path = temp_dir.path().join("wal.wal");
+            let wal = WalManager::new(
+                wal_path.clone(),
+                catalog_config(format, WalRetention::Delete),
+            )
+            .await
+            .unwrap();
+            for i in 0 .. 5 {
+                wal.write_entry(small_entry(i)).await.unwrap();
+            }
+
+            wal.checkpoint_through(wal.last_lsn()).await.unwrap();
+            assert!(!temp_dir.path().join("wal.0000000001.wal").exists());
+            assert!(!temp_dir.path().join("wal.0000000002.wal").exists());
+            // The current file is kept, but replay starts after the checkpoint
+            assert!(wal.size().await.unwrap() > 0);
+            assert!(replayed_ids(&wal).await.is_empty(), "format {:?}", format);
+
+            wal.write_entry(small_entry(5)).await.unwrap();
+            assert_eq!(
+                replayed_ids(&wal).await,
+                vec!["user-5"],
+                "format {:?}",
+                format
+            );
+            drop(wal);
+
+            // The checkpoint position survives a restart
+            let wal = WalManager::new(wal_path, catalog_config(format, WalRetention::Delete))
+                .await
+                .unwrap();
+            wal.write_entry(small_entry(6)).await.unwrap();
+            assert_eq!(
+                replayed_ids(&wal).await,
+                vec!["user-5", "user-6"],
+                "format {:?}",
+                format
+            );
+        }
+    }
+
+    #[tokio::test]
+    async fn test_checkpoint_through_keeps_later_entries() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("wal.wal");
+        let wal = WalManager::new(
+            wal_path,
+            catalog_config(WalFormat::BinaryV2, WalRetention::Delete),
+        )
+        .await
+        .unwrap();
+        for i in 0 .. 5 {
+            wal.write_entry(small_entry(i)).await.unwrap();
+        }
+
+        // Only the first segment is fully covered
+        wal.checkpoint_through(3).await.unwrap();
+        assert_eq!(wal.checkpoint_lsn().await, 3);
+        assert!(!temp_dir.path().join("wal.0000000001.wal").exists());
+        assert!(temp_dir.path().join("wal.0000000002.wal").exists());
+        assert_eq!(replayed_ids(&wal).await, vec!["user-3", "user-4"]);
+
+        // A checkpoint never goes back, nor past the last entry
+        wal.checkpoint_through(1).await.unwrap();
+        assert_eq!(wal.checkpoint_lsn().await, 3);
+        wal.checkpoint_through(100).await.unwrap();
+        assert_eq!(wal.checkpoint_lsn().await, 5);
+        assert!(replayed_ids(&wal).await.is_empty());
+    }
+
+    #[tokio::test]
+    async fn test_checkpoint_archives_covered_segments() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("wal.wal");
+        let wal = WalManager::new(
+            wal_path,
+            catalog_config(WalFormat::BinaryV2, WalRetention::Archive),
+        )
+        .await
+        .unwrap();
+        for i in 0 .. 3 {
+            wal.write_entry(small_entry(i)).await.unwrap();
+        }
+
+        wal.checkpoint_through(wal.last_lsn()).await.unwrap();
+        assert!(!temp_dir.path().join("wal.0000000001.wal").exists());
+        assert!(temp_dir
+            .path()
+            .join("archive")
+            .join("wal.0000000001.wal")
+            .exists());
+    }
+
+    #[tokio::test]
+    async fn test_checkpoint_keeps_every_entry() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("wal.wal");
+        let wal = WalManager::new(
+            wal_path,
+            catalog_config(WalFormat::BinaryV2, WalRetention::Delete),
+        )
+        .await
+        .unwrap();
+        for i in 0 .. 5 {
+            wal.write_entry(small_entry(i)).await.unwrap();
+        }
+
+        // Only retiring entries through an LSN removes segments
+        wal.checkpoint().await.unwrap();
+        assert!(temp_dir.path().join("wal.0000000001.wal").exists());
+        assert_eq!(wal.checkpoint_lsn().await, 0);
+        assert_eq!(replayed_ids(&wal).await.len(), 5);
+    }
+
+    #[tokio::test]
+    async fn test_keep_retention_skips_checkpointed_segments() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("wal.wal");
+        let wal = WalManager::new(
+            wal_path,
+            catalog_config(WalFormat::BinaryV2, WalRetention::Keep),
+        )
+        .await
+        .unwrap();
+        for i in 0 .. 3 {
+            wal.write_entry(small_entry(i)).await.unwrap();
+        }
+        wal.checkpoint_through(wal.last_lsn()).await.unwrap();
+        wal.write_entry(small_entry(3)).await.unwrap();
+
+        assert!(temp_dir.path().join("wal.0000000001.wal").exists());
+        assert_eq!(replayed_ids(&wal).await, vec!["user-3"]);
+    }
+
+    #[tokio::test]
+    async fn test_compressed_segments_are_replayed() {
+        let temp_dir = tempdir().unwrap();
+        let wal_path = temp_dir.path().join("wal.wal");
+        let wal = WalManager::new(
+            wal_path.clone(),
+            WalConfig {
+                compression_algorithm: Some(crate::CompressionAlgorithm::Zstd),
+                ..catalog_config(WalFormat::BinaryV2, WalRetention::Delete)
+            },
+        )
+        .await
+        .unwrap();
+        for i in 0 .. 5 {
+            wal.write_entry(small_entry(i)).await.unwrap();
+        }
+
+        assert_eq!(
+            replayed_ids(&wal).await,
+            (0 .. 5).map(|i| format!("user-{}", i)).collect::<Vec<_>>()
+        );
+        assert!(temp_dir.path().join("wal.0000000001.wal.zst").exists());
+        assert!(!temp_dir.path().join("wal.0000000001.wal").exists());
+        let catalog = SegmentCatalog::load(&SegmentCatalog::path_for(&wal_path))
+            .await
+            .unwrap();
+        assert!(catalog
+            .segments
+            .iter()
+            .all(|segment| segment.compression == Some(crate::CompressionAlgorithm::Zstd)));
+
+        wal.checkpoint_through(wal.last_lsn()).await.unwrap();
+        assert!(!temp_dir.path().join("wal.0000000001.wal.zst").exists());
+    }
+
+    #[test]
+    fn test_wal_retention_from_str_and_display() {
+        for retention in [
+            WalRetention::Keep,
+            WalRetention::Archive,
+            WalRetention::Delete,
+        ] {
+            assert_eq!(
+                retention.to_string().parse::<WalRetention>().unwrap(),
+                retention
+            );
+        }
+        assert_eq!(WalRetention::default(), WalRetention::Delete);
+        assert!("forever".parse::<WalRetention>().is_err());
+    }
 }
@@ -0,0 +1,291 @@
+//! Lock-free metrics recorded by the WAL.
+//!
+//! [`Histogram`] counts values such as latencies in log-linear buckets, in the manner of HDR
+//! histograms: every value lands in a bucket less than 1/16 wide relative to the value, recording
+//! is a handful of relaxed atomic operations, and memory stays fixed however many values are
+//! recorded. The database records its own operation latencies in the same histograms.
+
+use std::{
+    sync::atomic::{AtomicU64, Ordering},
+    time::Duration,
+};
+
+use serde::{Deserialize, Serialize};
+
+/// Number of low bits of a value told apart within a power of two
+const SUB_BUCKET_BITS: u32 = 4;
+
+/// Number of buckets covering each power of two
+const SUB_BUCKETS: u64 = 1 << SUB_BUCKET_BITS;
+
+/// Highest power of two with buckets of its own; larger values share the last bucket
+const MAX_EXPONENT: u32 = 40;
+
+/// Total number of buckets of a histogram
+const BUCKETS: usize = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) as usize * SUB_BUCKETS as usize;
+
+/// Index of the bucket counting `value`.
+fn bucket_index(value: u64) -> usize {
+    if value < SUB_BUCKETS {
+        return value as usize;
+    }
+    let exponent = value.ilog2();
+    if exponent > MAX_EXPONENT {
+        return BUCKETS.saturating_sub(1);
+    }
+    let shift = exponent.saturating_sub(SUB_BUCKET_BITS);
+    let sub_bucket = (value >> shift) & SUB_BUCKETS.saturating_sub(1);
+    (u64::from(shift).saturating_add(1))
+        .saturating_mul(SUB_BUCKETS)
+        .saturating_add(sub_bucket) as usize
+}
+
+/// Highest value counted in the bucket at `index`.
+fn bucket_upper_bound(index: usize) -> u64 {
+    let index = index as u64;
+    if index < SUB_BUCKETS {
+        return index;
+    }
+    let shift = (index / SUB_BUCKETS).saturating_sub(1);
+    let sub_bucket = index % SUB_BUCKETS;
+    SUB_BUCKETS
+        .saturating_add(sub_bucket)
+        .saturating_add(1)
+        .checked_shl(shift as u32)
+        .unwrap_or(u64::MAX)
+        .saturating_sub(1)
+}
+
+/// A histogram of `u64` values that can be recorded into concurrently.
+///
+/// Durations are recorded in microseconds.
+#[derive(Debug)]
+pub struct Histogram {
+    /// Number of values counted in each bucket.
+    buckets: Box<[AtomicU64]>,
+    /// Sum of the values recorded.
+    sum:     AtomicU64,
+    /// Smallest value recorded, `u64::MAX` while empty.
+    min:     AtomicU64,
+    /// Largest value recorded.
+    max:     AtomicU64,
+}
+
+impl Default for Histogram {
+    fn default() -> Self {
+        Self {
+            buckets: (0 .. BUCKETS).map(|_| AtomicU64::new(0)).collect(),
+            sum:     AtomicU64::new(0),
+            min:     AtomicU64::new(u64::MAX),
+            max:     AtomicU64::new(0),
+        }
+    }
+}
+
+impl Histogram {
+    /// Records one value.
+    pub fn record(&self, value: u64) {
+        if let Some(bucket) = self.buckets.get(bucket_index(value)) {
+            bucket.fetch_add(1, Ordering::Relaxed);
+        }
+        self.sum.fetch_add(value, Ordering::Relaxed);
+        self.min.fetch_min(value, Ordering::Relaxed);
+        self.max.fetch_max(value, Ordering::Relaxed);
+    }
+
+    /// Records a duration in microseconds.
+    pub fn record_duration(&self, elapsed: Duration) {
+        self.record(u64::try_from(elapsed.as_micros()).unwrap_or(u64::MAX));
+    }
+
+    /// Returns the summary of the values recorded so far.
+    ///
+    /// Values recorded while the snapshot is taken may be counted in some fields and not yet in
+    /// others.
+    pub fn snapshot(&self) -> HistogramSnapshot {
+        let counts: Vec<u64> = self
+            .buckets
+            .iter()
+            .map(|bucket| bucket.load(Ordering::Relaxed))
+            .collect();
+        let count: u64 = counts.iter().sum();
+        if count == 0 {
+            return HistogramSnapshot::default();
+        }
+        let min = self.min.load(Ordering::Relaxed);
+        let max = self.max.load(Ordering::Relaxed);
+        let quantile = |q: f64| {
+            let rank = ((count as f64 * q).ceil() as u64).clamp(1, count);
+            let mut seen = 0u64;
+            for (index, &bucket) in counts.iter().enumerate() {
+                seen = seen.saturating_add(bucket);
+                if seen >= rank {
+                    return bucket_upper_bound(index).clamp(min, max);
+                }
+            }
+            max
+        };
+        HistogramSnapshot {
+            count,
+            sum: self.sum.load(Ordering::Relaxed),
+            min,
+            max,
+            p50: quantile(0.5),
+            p90: quantile(0.9),
+            p99: quantile(0.99),
+            p999: quantile(0.999),
+        }
+    }
+}
+
+/// Summary of the values recorded in a [`Histogram`].
+///
+/// Quantiles are the highest value of the bucket they fall in, so they overstate the exact
+/// quantile by less than 1/16 of it.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, Serialize, Deserialize)]
+pub struct HistogramSnapshot {
+    /// Number of values recorded.
+    pub count: u64,
+    /// Sum of the values recorded.
+    pub sum:   u64,
+    /// Smallest value recorded, 0 when empty.
+    pub min:   u64,
+    /// Largest value recorded.
+    pub max:   u64,
+    /// Median.
+    pub p50:   u64,
+    /// 90th percentile.
+    pub p90:   u64,
+    /// 99th percentile.
+    pub p99:   u64,
+    /// 99.9th percentile.
+    pub p999:  u64,
+}
+
+impl HistogramSnapshot {
+    /// Mean of the values recorded, 0 when empty.
+    pub fn mean(&self) -> f64 {
+        if self.count == 0 {
+            return 0.0;
+        }
+        self.sum as f64 / self.count as f64
+    }
+}
+
+/// Timings and volumes of the writes made by one or more WAL managers.
+///
+/// A store shares one instance between the WAL managers of all its collections, see
+/// [`WalManager::new_with_metrics`](crate::WalManager::new_with_metrics).
+#[derive(Debug, Default)]
+pub struct WalMetrics {
+    /// Time to append a batch, durability barrier included, in microseconds.
+    append:          Histogram,
+    /// Time to flush buffered entries to the file, in microseconds.
+    flush:           Histogram,
+    /// Time to sync the file to disk, in microseconds.
+    fsync:           Histogram,
+    /// Time to rotate the current file out, in microseconds.
+    rotate:          Histogram,
+    /// Number of entries in each appended batch.
+    batch_entries:   Histogram,
+    /// Number of entries written.
+    entries_written: AtomicU64,
+    /// Number of bytes written.
+    bytes_written:   AtomicU64,
+}
+
+impl WalMetrics {
+    /// Records an appended batch of `entries` entries totalling `bytes` bytes.
+    pub(crate) fn record_append(&self, elapsed: Duration, entries: usize, bytes: u64) {
+        self.append.record_duration(elapsed);
+        self.batch_entries.record(entries as u64);
+        self.entries_written
+            .fetch_add(entries as u64, Ordering::Relaxed);
+        self.bytes_written.fetch_add(bytes, Ordering::Relaxed);
+    }
+
+    /// Records a flush of the buffered entries.
+    pub(crate) fn record_flush(&self, elapsed: Duration) { self.flush.record_duration(elapsed); }
+
+    /// Records a sync of the file to disk.
+    pub(crate) fn record_fsync(&self, elapsed: Duration) { self.fsync.record_duration(elapsed); }
+
+    /// Records a rotation of the current file.
+    pub(crate) fn record_rotate(&self, elapsed: Duration) { self.rotate.record_duration(elapsed); }
+
+    /// Returns the metrics recorded so far.
+    pub fn snapshot(&self) -> WalMetricsSnapshot {
+        WalMetricsSnapshot {
+            append:          self.append.snapshot(),
+            flush:           self.flush.snapshot(),
+            fsync:           self.fsync.snapshot(),
+            rotate:          self.rotate.snapshot(),
+            batch_entries:   self.batch_entries.snapshot(),
+            entries_written: self.entries_written.load(Ordering::Relaxed),
+            bytes_written:   self.bytes_written.load(Ordering::Relaxed),
+        }
+    }
+}
+
+/// The metrics of [`WalMetrics`] at one point in time.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, Serialize, Deserialize)]
+pub struct WalMetricsSnapshot {
+    /// Batch append latency in microseconds, durability barrier included.
+    pub append:          HistogramSnapshot,
+    /// Flush latency in microseconds.
+    pub flush:           HistogramSnapshot,
+    /// Fsync latency in microseconds.
+    pub fsync:           HistogramSnapshot,
+    /// Rotation latency in microseconds.
+    pub rotate:          HistogramSnapshot,
+    /// Number of entries per appended batch.
+    pub batch_entries:   HistogramSnapshot,
+    /// Number of entries written.
+    pub entries_written: u64,
+    /// Number of bytes written.
+    pub bytes_written:   u64,
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_bucket_bounds_cover_every_value() {
+        for value in (0 .. 5_000).chain([u64::from(u32::MAX), 1 << 40, u64::MAX]) {
+            let index = bucket_index(value);
+            assert!(index < BUCKETS);
+            if value < 1 << (MAX_EXPONENT + 1) {
+                assert!(bucket_upper_bound(index) >= value);
+                assert!(bucket_upper_bound(index) - value <= value / SUB_BUCKETS);
+            }
+        }
+        assert_eq!(bucket_index(u64::MAX), BUCKETS - 1);
+    }
+
+    #[test]
+    fn test_histogram_quantiles() {
+        let histogram = Histogram::default();
+        assert_eq!(histogram.snapshot(), HistogramSnapshot::default());
+
+        for value in 1 ..= 1000 {
+            histogram.record(value);
+        }
+        let snapshot = histogram.snapshot();
+        assert_eq!(snapshot.count, 1000);
+        assert_eq!(snapshot.sum, 500_500);
+        assert_eq!(snapshot.min, 1);
+        assert_eq!(snapshot.max, 1000);
+        assert!((500 ..= 532).contains(&snapshot.p50));
+        assert!((990 ..= 1000).contains(&snapshot.p99));
+        assert_eq!(snapshot.p999, 1000);
+        assert!((snapshot.mean() - 500.5).abs() < f64::EPSILON);
+    }
+
+    #[test]
+    fn test_histogram_records_durations_in_microseconds() {
+        let histogram = Histogram::default();
+        histogram.record_duration(Duration::from_millis(3));
+        assert_eq!(histogram.snapshot().max, 3000);
+    }
+}
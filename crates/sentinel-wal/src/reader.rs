@@ -0,0 +1,737 @@
+//! Zero-copy WAL segment reader.
+//!
+//! A segment (the current WAL file or a rotated one) is loaded with a single read sized from its
+//! metadata, and entries are decoded as [`LogEntryRef`] views borrowing their identifiers and
+//! payload from that buffer. Replaying a WAL therefore allocates once per segment instead of
+//! several times per entry, and segments are bounded by the rotation limits, so only one bounded
+//! buffer is held at a time.
+
+use std::{
+    borrow::Cow,
+    path::{Path, PathBuf},
+    sync::Arc,
+};
+
+use serde::Deserialize;
+use tracing::{debug, trace, warn};
+
+use crate::{
+    compression::get_compressor,
+    entry::{FixedBytes256, FixedBytes32},
+    frame::{self, Frame},
+    manager::detect_format,
+    CompressionAlgorithm,
+    EntryType,
+    LogEntry,
+    PayloadCipher,
+    Result,
+    WalError,
+    WalFormat,
+};
+
+/// Postcard layout of a `LogEntry`, borrowing every variable-length field
+#[derive(Deserialize)]
+struct RawEntry<'a> {
+    /// Type of the entry
+    entry_type:     EntryType,
+    /// Padded transaction ID
+    #[serde(borrow)]
+    transaction_id: &'a [u8],
+    /// Padded collection name
+    #[serde(borrow)]
+    collection:     &'a [u8],
+    /// Padded document ID
+    #[serde(borrow)]
+    document_id:    &'a [u8],
+    /// Timestamp of the entry
+    timestamp:      u64,
+    /// JSON data payload
+    #[serde(borrow)]
+    data:           Option<&'a str>,
+}
+
+/// JSON Lines layout of a `LogEntry`; strings are only copied when they contain escapes
+#[derive(Deserialize)]
+struct JsonEntry<'a> {
+    /// Type of the entry
+    entry_type:     EntryType,
+    /// Transaction ID
+    #[serde(borrow)]
+    transaction_id: Cow<'a, str>,
+    /// Collection name
+    #[serde(borrow)]
+    collection:     Cow<'a, str>,
+    /// Document ID
+    #[serde(borrow)]
+    document_id:    Cow<'a, str>,
+    /// Timestamp of the entry
+    timestamp:      u64,
+    /// JSON data payload
+    #[serde(borrow, default)]
+    data:           Option<Cow<'a, str>>,
+}
+
+/// A borrowed view of a WAL entry.
+///
+/// Views decoded from a [`WalSegment`] borrow their strings from the segment buffer. Use
+/// [`LogEntryRef::to_log_entry`] to keep an entry beyond the lifetime of its segment.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct LogEntryRef<'a> {
+    /// Type of the entry
+    pub entry_type: EntryType,
+    /// Timestamp of the entry (Unix timestamp in milliseconds)
+    pub timestamp:  u64,
+    /// Transaction ID, without padding
+    transaction_id: Cow<'a, str>,
+    /// Collection name, without padding
+    collection:     Cow<'a, str>,
+    /// Document ID, without padding
+    document_id:    Cow<'a, str>,
+    /// JSON data payload (for insert/update)
+    data:           Option<Cow<'a, str>>,
+}
+
+/// Strip the zero padding of a fixed-size field, rejecting invalid UTF-8
+fn unpad(bytes: &[u8]) -> Result<&str> {
+    std::str::from_utf8(bytes)
+        .map(|s| s.trim_end_matches('\0'))
+        .map_err(|e| WalError::InvalidEntry(format!("Invalid UTF-8 in WAL entry: {}", e)))
+}
+
+impl<'a> LogEntryRef<'a> {
+    /// Build a view from the borrowed postcard fields
+    fn from_raw(raw: RawEntry<'a>) -> Result<Self> {
+        Ok(Self {
+            entry_type:     raw.entry_type,
+            timestamp:      raw.timestamp,
+            transaction_id: Cow::Borrowed(unpad(raw.transaction_id)?),
+            collection:     Cow::Borrowed(unpad(raw.collection)?),
+            document_id:    Cow::Borrowed(unpad(raw.document_id)?),
+            data:           raw.data.map(Cow::Borrowed),
+        })
+    }
+
+    /// Decode a view from postcard data whose integrity was already verified
+    fn from_postcard(data: &'a [u8]) -> Result<Self> {
+        let raw: RawEntry<'a> =
+            postcard::from_bytes(data).map_err(|e: postcard::Error| WalError::Serialization(e.to_string()))?;
+        Self::from_raw(raw)
+    }
+
+    /// Decode a view from a JSON Lines entry
+    fn from_json(line: &'a str) -> Result<Self> {
+        let entry: JsonEntry<'a> =
+            serde_json::from_str(line).map_err(|e| WalError::Serialization(format!("JSON parsing error: {}", e)))?;
+        Ok(Self {
+            entry_type:     entry.entry_type,
+            timestamp:      entry.timestamp,
+            transaction_id: entry.transaction_id,
+            collection:     entry.collection,
+            document_id:    entry.document_id,
+            data:           entry.data,
+        })
+    }
+
+    /// Get the transaction ID.
+    pub fn transaction_id_str(&self) -> &str { &self.transaction_id }
+
+    /// Get the collection name.
+    pub fn collection_str(&self) -> &str { &self.collection }
+
+    /// Get the document ID.
+    pub fn document_id_str(&self) -> &str { &self.document_id }
+
+    /// Get the JSON data payload, if any.
+    pub fn data(&self) -> Option<&str> { self.data.as_deref() }
+
+    /// Parse the data payload as a JSON value.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::Serialization` - If the payload is not valid JSON
+    pub fn data_as_value(&self) -> Result<Option<serde_json::Value>> {
+        self.data()
+            .map(|s| serde_json::from_str(s).map_err(|e| WalError::Serialization(format!("Invalid JSON: {}", e))))
+            .transpose()
+    }
+
+    /// Copy the view into an owned `LogEntry`.
+    pub fn to_log_entry(&self) -> LogEntry {
+        LogEntry {
+            entry_type:     self.entry_type,
+            transaction_id: FixedBytes32::from(self.transaction_id.as_bytes()),
+            collection:     FixedBytes256::from(self.collection.as_bytes()),
+            document_id:    FixedBytes256::from(self.document_id.as_bytes()),
+            timestamp:      self.timestamp,
+            data:           self.data.as_deref().map(str::to_owned),
+        }
+    }
+}
+
+impl<'a> From<&'a LogEntry> for LogEntryRef<'a> {
+    fn from(entry: &'a LogEntry) -> Self {
+        Self {
+            entry_type:     entry.entry_type,
+            timestamp:      entry.timestamp,
+            transaction_id: Cow::Borrowed(entry.transaction_id_str()),
+            collection:     Cow::Borrowed(entry.collection_str()),
+            document_id:    Cow::Borrowed(entry.document_id_str()),
+            data:           entry.data.as_deref().map(Cow::Borrowed),
+        }
+    }
+}
+
+/// A WAL segment loaded for reading.
+#[derive(Debug)]
+pub struct WalSegment {
+    /// Path of the segment file
+    path:      PathBuf,
+    /// The raw segment contents
+    bytes:     Vec<u8>,
+    /// Format of the segment, detected from its header
+    format:    WalFormat,
+    /// LSN of the first entry, for formats whose entries do not carry one
+    first_lsn: u64,
+    /// Entries below this LSN are covered by a checkpoint and skipped
+    start_lsn: u64,
+}
+
+impl WalSegment {
+    /// Load a segment from disk.
+    ///
+    /// Files starting with a v2 header are read as `BinaryV2`; other files are read in the
+    /// `configured` format, with `BinaryV2` falling back to the legacy binary reader.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::Io` - If the file cannot be read
+    pub async fn open<P: Into<PathBuf>>(path: P, configured: WalFormat) -> Result<Self> {
+        let path = path.into();
+        let bytes = tokio::fs::read(&path).await?;
+        let format = detect_format(&bytes, configured);
+        debug!(
+            "Loaded WAL segment {:?} ({} bytes, format {:?})",
+            path,
+            bytes.len(),
+            format
+        );
+        Ok(Self {
+            path,
+            bytes,
+            format,
+            first_lsn: 0,
+            start_lsn: 0,
+        })
+    }
+
+    /// Load a segment compressed with `alg` and decompress it in memory.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::Io` - If the file cannot be read
+    /// * `WalError::Serialization` - If the file cannot be decompressed
+    pub async fn open_compressed<P: Into<PathBuf>>(
+        path: P,
+        configured: WalFormat,
+        alg: CompressionAlgorithm,
+    ) -> Result<Self> {
+        let path = path.into();
+        let compressed = tokio::fs::read(&path).await?;
+        let bytes = get_compressor(alg).decompress(&compressed).await?;
+        let format = detect_format(&bytes, configured);
+        debug!(
+            "Loaded {:?} compressed WAL segment {:?} ({} bytes, {} decompressed, format {:?})",
+            alg,
+            path,
+            compressed.len(),
+            bytes.len(),
+            format
+        );
+        Ok(Self {
+            path,
+            bytes,
+            format,
+            first_lsn: 0,
+            start_lsn: 0,
+        })
+    }
+
+    /// Decrypt the encrypted frames of a `BinaryV2` segment on the blocking pool.
+    ///
+    /// Encrypted frames are replaced by plain frames carrying the same LSN, so entries are then
+    /// borrowed from the buffer as for an unencrypted segment. Frames that cannot be decrypted are
+    /// kept as they are and skipped with a warning when iterating, like any invalid entry.
+    ///
+    /// # Errors
+    ///
+    /// * `WalError::Io` - If the decryption task fails
+    pub(crate) async fn decrypt(mut self, cipher: Arc<dyn PayloadCipher>) -> Result<Self> {
+        if self.format != WalFormat::BinaryV2 {
+            return Ok(self);
+        }
+        let bytes = std::mem::take(&mut self.bytes);
+        let path = self.path.clone();
+        self.bytes = tokio::task::spawn_blocking(move || decrypt_frames(bytes, cipher.as_ref(), &path))
+            .await
+            .map_err(|e| {
+                WalError::Io(std::io::Error::other(format!(
+                    "WAL decryption task failed: {}",
+                    e
+                )))
+            })?;
+        Ok(self)
+    }
+
+    /// Number the entries from `first_lsn` and skip those below `start_lsn`.
+    ///
+    /// `BinaryV2` entries carry their own LSN; other formats are numbered in file order.
+    #[must_use]
+    pub(crate) const fn with_lsn_range(mut self, first_lsn: u64, start_lsn: u64) -> Self {
+        self.first_lsn = first_lsn;
+        self.start_lsn = start_lsn;
+        self
+    }
+
+    /// Get the path of the segment file.
+    pub fn path(&self) -> &Path { &self.path }
+
+    /// Get the format the segment is read in.
+    pub const fn format(&self) -> WalFormat { self.format }
+
+    /// Get the size of the segment in bytes.
+    pub const fn len(&self) -> usize { self.bytes.len() }
+
+    /// Whether the segment is empty.
+    pub const fn is_empty(&self) -> bool { self.bytes.is_empty() }
+
+    /// Iterate over the entries of the segment.
+    ///
+    /// Invalid entries are skipped with a warning, as `WalManager::stream_entries` does. When the
+    /// segment was opened through [`WalSegments`], entries already covered by a checkpoint are
+    /// skipped as well.
+    pub fn entries(&self) -> SegmentEntries<'_> {
+        SegmentEntries {
+            bytes:     &self.bytes,
+            path:      &self.path,
+            format:    self.format,
+            offset:    if self.format == WalFormat::BinaryV2 {
+                frame::FILE_HEADER_LEN
+            }
+            else {
+                0
+            },
+            lsn:       self.first_lsn,
+            start_lsn: self.start_lsn,
+        }
+    }
+}
+
+/// Rewrite the frames of a `BinaryV2` segment with their payloads decrypted.
+///
+/// Segments holding no encrypted frame are returned unchanged. Corrupted bytes and a torn tail
+/// are copied as they are, so readers skip them exactly as they would in the original.
+fn decrypt_frames(bytes: Vec<u8>, cipher: &dyn PayloadCipher, path: &Path) -> Vec<u8> {
+    let mut plain: Option<Vec<u8>> = None;
+    let mut offset = frame::FILE_HEADER_LEN.min(bytes.len());
+    while let Some(remaining) = bytes.get(offset ..) &&
+        !remaining.is_empty()
+    {
+        let (len, decrypted) = match frame::decode_frame(remaining) {
+            Frame::Valid {
+                lsn,
+                payload,
+                len,
+            } if frame::is_encrypted(payload) => {
+                let decrypted = frame::decrypt_payload(Some(cipher), payload)
+                    .and_then(|payload| frame::encode_frame(&payload))
+                    .map(|mut decrypted| {
+                        frame::seal_frame(&mut decrypted, lsn);
+                        decrypted
+                    })
+                    .inspect_err(|e| warn!("Cannot decrypt WAL entry {} of {:?}: {}", lsn, path, e))
+                    .ok();
+                (len, decrypted)
+            },
+            Frame::Valid {
+                len,
+                ..
+            } => (len, None),
+            Frame::Incomplete | Frame::Corrupt => (frame::resync(remaining).unwrap_or(remaining.len()), None),
+        };
+
+        match decrypted {
+            Some(decrypted) => {
+                let plain = plain.get_or_insert_with(|| {
+                    let mut plain = Vec::with_capacity(bytes.len());
+                    plain.extend_from_slice(bytes.get(.. offset).unwrap_or_default());
+                    plain
+                });
+                plain.extend_from_slice(&decrypted);
+            },
+            None => {
+                if let Some(ref mut plain) = plain {
+                    plain.extend_from_slice(remaining.get(.. len).unwrap_or_default());
+                }
+            },
+        }
+        offset = offset.saturating_add(len);
+    }
+    plain.unwrap_or(bytes)
+}
+
+/// Iterator over the entries of a [`WalSegment`].
+#[derive(Debug)]
+pub struct SegmentEntries<'a> {
+    /// The segment contents
+    bytes:     &'a [u8],
+    /// Path of the segment, for diagnostics
+    path:      &'a Path,
+    /// Format of the segment
+    format:    WalFormat,
+    /// Offset of the next unread byte
+    offset:    usize,
+    /// LSN of the next entry, or of the last decoded frame for `BinaryV2`
+    lsn:       u64,
+    /// Entries below this LSN are skipped
+    start_lsn: u64,
+}
+
+impl<'a> SegmentEntries<'a> {
+    /// Advance past `len` bytes
+    const fn advance(&mut self, len: usize) { self.offset = self.offset.saturating_add(len); }
+
+    /// Keep a decoded entry, or warn and skip it
+    fn accept(&self, entry: Result<LogEntryRef<'a>>) -> Option<LogEntryRef<'a>> {
+        entry
+            .inspect_err(|e| warn!("Skipping invalid WAL entry in {:?}: {}", self.path, e))
+            .ok()
+    }
+
+    /// Decode the next v2 frame. `None` ends the iteration, `Some(None)` skips bytes.
+    fn next_frame(&mut self, remaining: &'a [u8]) -> Option<Option<LogEntryRef<'a>>> {
+        match frame::decode_frame(remaining) {
+            Frame::Valid {
+                lsn,
+                payload,
+                len,
+            } => {
+                self.lsn = lsn;
+                self.advance(len);
+                Some(self.accept(LogEntryRef::from_postcard(payload)))
+            },
+            Frame::Incomplete | Frame::Corrupt => {
+                if let Some(skip) = frame::resync(remaining) {
+                    warn!(
+                        "Skipping {} corrupted bytes at offset {} of {:?}",
+                        skip, self.offset, self.path
+                    );
+                    self.advance(skip);
+                    Some(None)
+                }
+                else {
+                    warn!(
+                        "Discarding {} bytes of torn WAL tail at offset {} of {:?}",
+                        remaining.len(),
+                        self.offset,
+                        self.path
+                    );
+                    self.offset = self.bytes.len();
+                    None
+                }
+            },
+        }
+    }
+
+    /// Decode the next legacy binary entry. `None` ends the iteration, `Some(None)` skips bytes.
+    ///
+    /// Postcard is self-delimiting, so the entry is decoded first and its checksum checked
+    /// afterwards; an entry with a mismatching checksum is skipped using its decoded length. Only
+    /// when the entry cannot be decoded at all does this fall back to searching for the next
+    /// checksum boundary, as the legacy format has no framing.
+    fn next_legacy(&mut self, remaining: &'a [u8]) -> Option<Option<LogEntryRef<'a>>> {
+        let checksum_at = |end: usize| {
+            let stop = end.checked_add(4)?;
+            remaining
+                .get(end .. stop)?
+                .try_into()
+                .ok()
+                .map(u32::from_le_bytes)
+        };
+
+        if let Ok((raw, rest)) = postcard::take_from_bytes::<RawEntry<'a>>(remaining) {
+            let data_len = remaining.len().saturating_sub(rest.len());
+            if let (Some(data), Some(expected)) = (remaining.get(.. data_len), checksum_at(data_len)) {
+                self.advance(data_len.saturating_add(4));
+                if crc32fast::hash(data) == expected {
+                    return Some(self.accept(LogEntryRef::from_raw(raw)));
+                }
+                warn!(
+                    "Skipping WAL entry with mismatching checksum in {:?}",
+                    self.path
+                );
+                return Some(None);
+            }
+        }
+
+        let mut end = 0_usize;
+        while let Some(expected) = checksum_at(end) {
+            if let Some(data) = remaining.get(.. end) &&
+                crc32fast::hash(data) == expected
+            {
+                self.advance(end.saturating_add(4));
+                return Some(self.accept(LogEntryRef::from_postcard(data)));
+            }
+            end = end.saturating_add(1);
+        }
+
+        trace!(
+            "No further entries after offset {} of {:?}",
+            self.offset,
+            self.path
+        );
+        self.offset = self.bytes.len();
+        None
+    }
+
+    /// Decode the next JSON Lines entry, returning `None` for blank or invalid lines.
+    fn next_line(&mut self, remaining: &'a [u8]) -> Option<LogEntryRef<'a>> {
+        let (line, consumed) = match remaining.iter().position(|&byte| byte == b'\n') {
+            Some(newline) => (remaining.get(.. newline)?, newline.saturating_add(1)),
+            None => (remaining, remaining.len()),
+        };
+        self.advance(consumed);
+
+        let line = line.trim_ascii();
+        if line.is_empty() {
+            return None;
+        }
+        let entry = std::str::from_utf8(line)
+            .map_err(|e| WalError::Serialization(format!("Invalid UTF-8 in JSON Lines: {}", e)))
+            .and_then(LogEntryRef::from_json);
+        self.accept(entry)
+    }
+}
+
+impl<'a> SegmentEntries<'a> {
+    /// Decode the next entry along with its LSN.
+    ///
+    /// `BinaryV2` entries carry their LSN; entries of other formats are numbered in file order
+    /// from the first LSN of the segment, which is only known for segments opened by the
+    /// `WalManager`, so entries of a segment opened directly are numbered from 0.
+    pub fn next_with_lsn(&mut self) -> Option<(u64, LogEntryRef<'a>)> {
+        let bytes = self.bytes;
+        loop {
+            let remaining = bytes.get(self.offset ..).filter(|r| !r.is_empty())?;
+            let entry = match self.format {
+                WalFormat::BinaryV2 => self.next_frame(remaining)?,
+                WalFormat::Binary => self.next_legacy(remaining)?,
+                WalFormat::JsonLines => self.next_line(remaining),
+            };
+            if let Some(entry) = entry {
+                let lsn = self.lsn;
+                self.lsn = lsn.saturating_add(1);
+                if lsn >= self.start_lsn {
+                    return Some((lsn, entry));
+                }
+                trace!("Skipping checkpointed entry {} of {:?}", lsn, self.path);
+            }
+        }
+    }
+}
+
+impl<'a> Iterator for SegmentEntries<'a> {
+    type Item = LogEntryRef<'a>;
+
+    fn next(&mut self) -> Option<Self::Item> { self.next_with_lsn().map(|(_, entry)| entry) }
+}
+
+/// Location and LSN range of a segment waiting to be read
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub(crate) struct SegmentSource {
+    /// Path of the segment file
+    pub(crate) path:        PathBuf,
+    /// Compression applied to the segment file, if any
+    pub(crate) compression: Option<CompressionAlgorithm>,
+    /// LSN of the first entry of the segment
+    pub(crate) first_lsn:   u64,
+    /// Entries below this LSN are covered by a checkpoint and skipped
+    pub(crate) start_lsn:   u64,
+}
+
+impl SegmentSource {
+    /// An uncompressed segment read from its first entry
+    pub(crate) const fn plain(path: PathBuf) -> Self {
+        Self {
+            path,
+            compression: None,
+            first_lsn: 0,
+            start_lsn: 0,
+        }
+    }
+
+    /// Load the segment from disk, decrypting its entries with `cipher`
+    pub(crate) async fn open(&self, format: WalFormat, cipher: Option<&Arc<dyn PayloadCipher>>) -> Result<WalSegment> {
+        let mut segment = match self.compression {
+            Some(alg) => WalSegment::open_compressed(self.path.clone(), format, alg).await?,
+            None => WalSegment::open(self.path.clone(), format).await?,
+        };
+        if let Some(cipher) = cipher {
+            segment = segment.decrypt(cipher.clone()).await?;
+        }
+        Ok(segment.with_lsn_range(self.first_lsn, self.start_lsn))
+    }
+}
+
+/// The segments of a WAL, opened one at a time in replay order.
+#[derive(Debug, Default)]
+pub struct WalSegments {
+    /// Segments not read yet
+    sources: std::vec::IntoIter<SegmentSource>,
+    /// Configured format of the WAL
+    format:  WalFormat,
+    /// Cipher decrypting the entries, if the WAL is encrypted
+    cipher:  Option<Arc<dyn PayloadCipher>>,
+}
+
+impl WalSegments {
+    /// Create the reader for the given segments, oldest first
+    pub(crate) fn new(sources: Vec<SegmentSource>, format: WalFormat, cipher: Option<Arc<dyn PayloadCipher>>) -> Self {
+        Self {
+            sources: sources.into_iter(),
+            format,
+            cipher,
+        }
+    }
+
+    /// Number of segments not read yet.
+    pub fn remaining(&self) -> usize { self.sources.len() }
+
+    /// Load the next segment, returning `None` once every segment has been read.
+    ///
+    /// Only the returned segment is held in memory; drop it before loading the next one to keep
+    /// memory bounded by the segment size. Compressed segments are decompressed and encrypted
+    /// segments decrypted in memory.
+    pub async fn next_segment(&mut self) -> Option<Result<WalSegment>> {
+        let source = self.sources.next()?;
+        Some(source.open(self.format, self.cipher.as_ref()).await)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use serde_json::json;
+    use tempfile::tempdir;
+
+    use super::*;
+    use crate::{WalConfig, WalManager};
+
+    /// Entry with an escaped JSON payload
+    fn entry(i: usize) -> LogEntry {
+        LogEntry::new(
+            EntryType::Insert,
+            "users".to_string(),
+            format!("user-{}", i),
+            Some(json!({"name": "A \"quoted\" name", "i": i})),
+        )
+    }
+
+    /// Write the given entries to a segment in `format` and load it back
+    async fn segment_with(format: WalFormat, entries: &[LogEntry]) -> (tempfile::TempDir, WalSegment) {
+        let temp_dir = tempdir().unwrap();
+        let path = temp_dir.path().join("segment.wal");
+        let wal = WalManager::new(
+            path.clone(),
+            WalConfig {
+                format,
+                max_file_size: None,
+                max_records_per_file: None,
+                compression_algorithm: None,
+                ..Default::default()
+            },
+        )
+        .await
+        .unwrap();
+        wal.write_entries(entries).await.unwrap();
+        drop(wal);
+        let segment = WalSegment::open(path, format).await.unwrap();
+        (temp_dir, segment)
+    }
+
+    #[tokio::test]
+    async fn test_segment_views_match_entries_in_every_format() {
+        let entries: Vec<_> = (0 .. 5).map(entry).collect();
+        for format in [WalFormat::Binary, WalFormat::BinaryV2, WalFormat::JsonLines] {
+            let (_dir, segment) = segment_with(format, &entries).await;
+            assert_eq!(segment.format(), format);
+            let views: Vec<_> = segment.entries().collect();
+            assert_eq!(views.len(), entries.len(), "format {:?}", format);
+            for (view, entry) in views.iter().zip(&entries) {
+                assert_eq!(view, &entry.as_view());
+                assert_eq!(&view.to_log_entry(), entry);
+            }
+        }
+    }
+
+    #[tokio::test]
+    async fn test_binary_views_borrow_from_segment() {
+        let (_dir, segment) = segment_with(WalFormat::BinaryV2, &[entry(0)]).await;
+        let view = segment.entries().next().unwrap();
+        assert!(matches!(view.document_id, Cow::Borrowed(_)));
+        assert!(matches!(view.data, Some(Cow::Borrowed(_))));
+        assert_eq!(view.document_id_str(), "user-0");
+        assert_eq!(view.data_as_value().unwrap().unwrap()["i"], 0);
+    }
+
+    #[tokio::test]
+    async fn test_legacy_segment_resyncs_after_corruption() {
+        let entries: Vec<_> = (0 .. 3).map(entry).collect();
+        let (_dir, segment) = segment_with(WalFormat::Binary, &entries).await;
+
+        // Corrupt the first byte of the checksum of the first entry
+        let first_len = entries[0].to_bytes().unwrap().len();
+        let mut bytes = segment.bytes.clone();
+        bytes[first_len - 4] ^= 0xff;
+        let corrupted = WalSegment {
+            bytes,
+            ..segment
+        };
+
+        let ids: Vec<_> = corrupted
+            .entries()
+            .map(|view| view.document_id_str().to_owned())
+            .collect();
+        assert_eq!(ids, vec!["user-1", "user-2"]);
+    }
+
+    #[tokio::test]
+    async fn test_segments_are_read_oldest_first() {
+        let temp_dir = tempdir().unwrap();
+        let path = temp_dir.path().join("wal.wal");
+        let wal = WalManager::new(
+            path,
+            WalConfig {
+                max_records_per_file: Some(2),
+                compression_algorithm: None,
+                ..Default::default()
+            },
+        )
+        .await
+        .unwrap();
+        for i in 0 .. 3 {
+            wal.write_entry(entry(i)).await.unwrap();
+        }
+
+        let mut segments = wal.segments().await.unwrap();
+        assert_eq!(segments.remaining(), 2);
+        let mut ids = Vec::new();
+        while let Some(segment) = segments.next_segment().await {
+            let segment = segment.unwrap();
+            ids.extend(
+                segment
+                    .entries()
+                    .map(|view| view.document_id_str().to_owned()),
+            );
+        }
+        assert_eq!(ids, vec!["user-0", "user-1", "user-2"]);
+    }
+}
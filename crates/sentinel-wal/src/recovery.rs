@@ -6,13 +6,16 @@
 //! 2. Handles conflicts gracefully
 //! 3. Is idempotent (can be run multiple times safely)
 
-use std::collections::HashMap;
+use std::{
+    collections::{HashMap, HashSet},
+    sync::Arc,
+};
 
 use futures::StreamExt as _;
 use serde::{Deserialize, Serialize};
 use tracing::{debug, warn};
 
-use crate::{EntryType, LogEntry, Result, WalDocumentOps, WalManager};
+use crate::{entry::FixedBytes32, EntryType, LogEntryRef, Result, WalDocumentOps, WalError, WalManager};
 
 /// Result of WAL recovery operation
 #[derive(Debug)]
@@ -40,11 +43,212 @@ pub struct WalRecoveryFailure {
     pub reason:         String,
 }
 
+impl WalRecoveryFailure {
+    /// Failure for a WAL segment that could not be read
+    fn unreadable(error: &WalError) -> Self {
+        Self {
+            transaction_id: "unknown".to_owned(),
+            document_id:    "unknown".to_owned(),
+            operation_type: "read".to_owned(),
+            reason:         format!("Failed to read WAL segment: {}", error),
+        }
+    }
+}
+
+/// Maximum number of documents replayed concurrently by [`recover_from_wal_safe`]
+pub const RECOVERY_CONCURRENCY: usize = 64;
+
+/// Simulated state of a document while its WAL entries are reduced
+#[derive(Debug, Clone)]
+enum ReplayState {
+    /// The document does not exist
+    Absent,
+    /// The document keeps the state it had before recovery
+    Unchanged,
+    /// The document holds the given data
+    Set(Arc<serde_json::Value>),
+}
+
+/// Net effect of a document's WAL entries from one starting state
+#[derive(Debug, Clone)]
+struct ReplayBranch {
+    /// State of the document after all its entries
+    state:        ReplayState,
+    /// Number of entries that changed the document
+    effective:    usize,
+    /// Data of the update applied while the document kept its state from before recovery. A
+    /// sequential replay skips that update when the document already holds this data.
+    first_update: Option<Arc<serde_json::Value>>,
+}
+
+impl ReplayBranch {
+    /// Branch starting from the given state
+    const fn new(state: ReplayState) -> Self {
+        Self {
+            state,
+            effective: 0,
+            first_update: None,
+        }
+    }
+
+    /// Apply one operation as a sequential safe replay would, counting it if it takes effect
+    fn apply(&mut self, entry_type: EntryType, data: Option<&Arc<serde_json::Value>>) {
+        let next = match (entry_type, &self.state, data) {
+            (EntryType::Insert, &ReplayState::Absent, Some(data)) => ReplayState::Set(Arc::clone(data)),
+            (EntryType::Update, &ReplayState::Unchanged, Some(data)) => {
+                self.first_update = Some(Arc::clone(data));
+                ReplayState::Set(Arc::clone(data))
+            },
+            (EntryType::Update, &ReplayState::Set(ref current), Some(data)) if current != data => {
+                ReplayState::Set(Arc::clone(data))
+            },
+            (EntryType::Delete, &ReplayState::Unchanged | &ReplayState::Set(_), _) => ReplayState::Absent,
+            _ => return,
+        };
+        self.state = next;
+        self.effective = self.effective.saturating_add(1);
+    }
+}
+
+/// The WAL entries of one document, reduced to their net effect.
+///
+/// Whether an entry takes effect during a safe replay depends on whether the document exists on
+/// disk, so the reduction tracks both outcomes and the replay picks one after a single lookup.
+#[derive(Debug)]
+struct DocumentReplay {
+    /// Position of the document in the log, used by the transaction dedupe set
+    slot:           usize,
+    /// Number of entries folded into the reduction
+    entries:        usize,
+    /// Transaction of the last entry, for failure reports
+    transaction_id: String,
+    /// Type of the last entry, for failure reports
+    entry_type:     EntryType,
+    /// Outcome when the document does not exist on disk
+    absent:         ReplayBranch,
+    /// Outcome when the document already exists on disk
+    present:        ReplayBranch,
+}
+
+impl DocumentReplay {
+    /// Empty reduction for the document at `slot`
+    fn new(slot: usize) -> Self {
+        Self {
+            slot,
+            entries: 0,
+            transaction_id: String::new(),
+            entry_type: EntryType::Insert,
+            absent: ReplayBranch::new(ReplayState::Absent),
+            present: ReplayBranch::new(ReplayState::Unchanged),
+        }
+    }
+
+    /// Fold the next entry of the document into the reduction
+    fn fold(&mut self, entry: &LogEntryRef<'_>) -> Result<()> {
+        let data = match entry.entry_type {
+            EntryType::Insert | EntryType::Update => {
+                match entry.data() {
+                    Some(data_str) => {
+                        let data: serde_json::Value = serde_json::from_str(data_str)
+                            .map_err(|e| WalError::Serialization(format!("Invalid JSON in WAL entry: {}", e)))?;
+                        Some(Arc::new(data))
+                    },
+                    None => {
+                        warn!(
+                            "WAL {:?} entry missing data for document {}",
+                            entry.entry_type,
+                            entry.document_id_str()
+                        );
+                        None
+                    },
+                }
+            },
+            EntryType::Delete | EntryType::Begin | EntryType::Commit | EntryType::Rollback => None,
+        };
+
+        self.entries = self.entries.saturating_add(1);
+        self.transaction_id.clear();
+        self.transaction_id.push_str(entry.transaction_id_str());
+        self.entry_type = entry.entry_type;
+        self.absent.apply(entry.entry_type, data.as_ref());
+        self.present.apply(entry.entry_type, data.as_ref());
+        Ok(())
+    }
+}
+
+/// Apply the net effect of a document's entries, returning how many of them took effect.
+///
+/// The count matches a sequential replay of the entries, even though the document is written at
+/// most once.
+async fn replay_document<D>(
+    document_id: &str,
+    absent: ReplayBranch,
+    present: ReplayBranch,
+    document_ops: &D,
+) -> Result<usize>
+where
+    D: WalDocumentOps,
+{
+    let existing = document_ops.get_document(document_id).await?;
+    let branch = if existing.is_some() { present } else { absent };
+
+    // The first update of an existing document is only compared to its data once it is read
+    let first_update_is_noop = matches!(
+        (branch.first_update.as_deref(), existing.as_ref()),
+        (Some(first), Some(current)) if first == current
+    );
+    let effective = if first_update_is_noop {
+        branch.effective.saturating_sub(1)
+    }
+    else {
+        branch.effective
+    };
+
+    match (branch.state, existing) {
+        (ReplayState::Absent, Some(_)) => {
+            document_ops
+                .apply_operation(&EntryType::Delete, document_id, None)
+                .await?;
+        },
+        (ReplayState::Set(data), None) => {
+            document_ops
+                .apply_operation(
+                    &EntryType::Insert,
+                    document_id,
+                    Some(Arc::unwrap_or_clone(data)),
+                )
+                .await?;
+        },
+        (ReplayState::Set(data), Some(current)) => {
+            if current == *data {
+                debug!("Skipping document {} already in its WAL state", document_id);
+            }
+            else {
+                document_ops
+                    .apply_operation(
+                        &EntryType::Update,
+                        document_id,
+                        Some(Arc::unwrap_or_clone(data)),
+                    )
+                    .await?;
+            }
+        },
+        (ReplayState::Absent, None) | (ReplayState::Unchanged, _) => {},
+    }
+    Ok(effective)
+}
+
 /// Recover collection state from WAL entries
 ///
 /// This function replays WAL entries to restore the collection to its
 /// correct state. It only applies operations that haven't been applied yet
 /// and handles conflicts gracefully.
+///
+/// The log is first reduced to the net effect of its entries on each document, so every
+/// document is looked up and written at most once. Documents are then replayed concurrently,
+/// at most [`RECOVERY_CONCURRENCY`] at a time.
+///
+/// Replay starts after the last checkpoint, as entries it covers are already in the data files.
 #[allow(
     clippy::arithmetic_side_effects,
     reason = "safe counter increments in recovery"
@@ -62,52 +266,103 @@ where
         let mut failed = 0;
         let mut failures = Vec::new();
 
-        // Track applied operations to avoid duplicates
-        let mut applied_operations = HashMap::new(); // (doc_id, txn_id) -> applied
-
-        let stream = wal.stream_entries();
-        let mut pinned_stream = std::pin::pin!(stream);
-        while let Some(entry_result) = pinned_stream.next().await {
-            match entry_result {
-                Ok(entry) => {
-                    let key = (
-                        entry.document_id_str().to_owned(),
-                        entry.transaction_id_str().to_owned(),
-                    );
-
-                    // Skip if this operation was already applied
-                    if applied_operations.contains_key(&key) {
-                        skipped += 1;
-                        continue;
-                    }
+        let mut documents: HashMap<String, DocumentReplay> = HashMap::new();
+        // Operations already folded, to skip duplicated entries: (document slot, transaction)
+        let mut applied_operations: HashSet<(usize, FixedBytes32)> = HashSet::new();
 
-                    match replay_wal_entry_safe(&entry, document_ops).await {
-                        Ok(true) => {
-                            recovered += 1;
-                            applied_operations.insert(key, true);
-                        },
-                        Ok(false) => {
-                            skipped += 1;
-                            applied_operations.insert(key, true);
-                        },
-                        Err(e) => {
-                            failed += 1;
-                            failures.push(WalRecoveryFailure {
-                                transaction_id: entry.transaction_id_str().to_owned(),
-                                document_id:    entry.document_id_str().to_owned(),
-                                operation_type: format!("{:?}", entry.entry_type),
-                                reason:         format!("{}", e),
-                            });
-                        },
-                    }
+        let mut segments = wal.segments().await?;
+        while let Some(segment) = segments.next_segment().await {
+            let segment = match segment {
+                Ok(segment) => segment,
+                Err(e) => {
+                    failed += 1;
+                    failures.push(WalRecoveryFailure::unreadable(&e));
+                    continue;
+                },
+            };
+            for entry in segment.entries() {
+                // Transaction control entries don't affect document state
+                if matches!(
+                    entry.entry_type,
+                    EntryType::Begin | EntryType::Commit | EntryType::Rollback
+                ) {
+                    skipped += 1;
+                    continue;
+                }
+
+                let document_id = entry.document_id_str();
+                if !documents.contains_key(document_id) {
+                    let slot = documents.len();
+                    documents.insert(document_id.to_owned(), DocumentReplay::new(slot));
+                }
+                let Some(document) = documents.get_mut(document_id)
+                else {
+                    continue;
+                };
+
+                // Skip if this operation was already applied
+                let key = (
+                    document.slot,
+                    FixedBytes32::from(entry.transaction_id_str().as_bytes()),
+                );
+                if applied_operations.contains(&key) {
+                    skipped += 1;
+                    continue;
+                }
+
+                match document.fold(&entry) {
+                    Ok(()) => {
+                        applied_operations.insert(key);
+                    },
+                    Err(e) => {
+                        failed += 1;
+                        failures.push(WalRecoveryFailure {
+                            transaction_id: entry.transaction_id_str().to_owned(),
+                            document_id:    document_id.to_owned(),
+                            operation_type: format!("{:?}", entry.entry_type),
+                            reason:         format!("{}", e),
+                        });
+                    },
+                }
+            }
+        }
+        drop(applied_operations);
+
+        debug!(
+            "Replaying {} documents reduced from the WAL",
+            documents.len()
+        );
+        let mut replays = futures::stream::iter(documents)
+            .map(|(document_id, document)| {
+                async move {
+                    let DocumentReplay {
+                        entries,
+                        transaction_id,
+                        entry_type,
+                        absent,
+                        present,
+                        ..
+                    } = document;
+                    let outcome = replay_document(&document_id, absent, present, document_ops).await;
+                    (document_id, transaction_id, entry_type, entries, outcome)
+                }
+            })
+            .buffer_unordered(RECOVERY_CONCURRENCY);
+
+        while let Some((document_id, transaction_id, entry_type, entries, outcome)) = replays.next().await {
+            match outcome {
+                Ok(effective) => {
+                    recovered += effective;
+                    skipped += entries.saturating_sub(effective);
                 },
                 Err(e) => {
                     failed += 1;
+                    skipped += entries.saturating_sub(1);
                     failures.push(WalRecoveryFailure {
-                        transaction_id: "unknown".to_owned(),
-                        document_id:    "unknown".to_owned(),
-                        operation_type: "read".to_owned(),
-                        reason:         format!("Failed to read WAL entry: {}", e),
+                        transaction_id,
+                        document_id,
+                        operation_type: format!("{:?}", entry_type),
+                        reason: format!("{}", e),
                     });
                 },
             }
@@ -133,125 +388,6 @@ where
     result
 }
 
-/// Safely replay a single WAL entry
-///
-/// Returns:
-/// - Ok(true) if operation was applied
-/// - Ok(false) if operation was skipped (already applied or conflict)
-/// - Err(_) if operation failed
-async fn replay_wal_entry_safe<D>(entry: &LogEntry, document_ops: &D) -> Result<bool>
-where
-    D: WalDocumentOps,
-{
-    match entry.entry_type {
-        EntryType::Insert => {
-            if let Some(data_str) = entry.data.as_ref() {
-                // Parse the JSON data
-                let data: serde_json::Value = serde_json::from_str(data_str)
-                    .map_err(|e| crate::error::WalError::Serialization(format!("Invalid JSON in WAL insert: {}", e)))?;
-
-                // Check if document already exists
-                match document_ops.get_document(entry.document_id_str()).await {
-                    Ok(Some(_)) => {
-                        // Document already exists, skip insert
-                        debug!(
-                            "Skipping insert for existing document {}",
-                            entry.document_id_str()
-                        );
-                        Ok(false)
-                    },
-                    Ok(None) => {
-                        // Document doesn't exist, apply insert
-                        document_ops
-                            .apply_operation(&EntryType::Insert, entry.document_id_str(), Some(data))
-                            .await?;
-                        Ok(true)
-                    },
-                    Err(e) => {
-                        // Error checking document, fail operation
-                        Err(e)
-                    },
-                }
-            }
-            else {
-                warn!(
-                    "WAL insert entry missing data for document {}",
-                    entry.document_id_str()
-                );
-                Ok(false)
-            }
-        },
-        EntryType::Update => {
-            if let Some(data_str) = entry.data.as_ref() {
-                // Parse the JSON data
-                let data: serde_json::Value = serde_json::from_str(data_str)
-                    .map_err(|e| crate::error::WalError::Serialization(format!("Invalid JSON in WAL update: {}", e)))?;
-
-                // Check if document exists
-                match document_ops.get_document(entry.document_id_str()).await {
-                    Ok(Some(existing_doc)) => {
-                        // Document exists, check if update is needed
-                        if existing_doc != data {
-                            document_ops
-                                .apply_operation(&EntryType::Update, entry.document_id_str(), Some(data))
-                                .await?;
-                            Ok(true)
-                        }
-                        else {
-                            Ok(false)
-                        }
-                    },
-                    Ok(None) => {
-                        // Document doesn't exist, this is an error for update
-                        warn!(
-                            "Skipping update for non-existent document {}",
-                            entry.document_id_str()
-                        );
-                        Ok(false)
-                    },
-                    Err(e) => {
-                        // Error checking document, fail operation
-                        Err(e)
-                    },
-                }
-            }
-            else {
-                warn!(
-                    "WAL update entry missing data for document {}",
-                    entry.document_id_str()
-                );
-                Ok(false)
-            }
-        },
-        EntryType::Delete => {
-            // Check if document exists
-            match document_ops.get_document(entry.document_id_str()).await {
-                Ok(Some(_)) => {
-                    // Document exists, apply delete
-                    document_ops
-                        .apply_operation(&EntryType::Delete, entry.document_id_str(), None)
-                        .await?;
-                    Ok(true)
-                },
-                Ok(None) => {
-                    // Document doesn't exist, skip delete
-                    debug!(
-                        "Skipping delete for non-existent document {}",
-                        entry.document_id_str()
-                    );
-                    Ok(false)
-                },
-                Err(e) => {
-                    // Error checking document, fail operation
-                    Err(e)
-                },
-            }
-        },
-        // Transaction control entries don't affect document state
-        EntryType::Begin | EntryType::Commit | EntryType::Rollback => Ok(false),
-    }
-}
-
 /// Recover collection from WAL with conflict resolution
 ///
 /// This is a more aggressive recovery that attempts to resolve conflicts
@@ -269,40 +405,36 @@ where
     let mut failed = 0;
     let mut failures = Vec::new();
 
-    let stream = wal.stream_entries();
-    let mut pinned_stream = std::pin::pin!(stream);
-    while let Some(entry_result) = pinned_stream.next().await {
-        match entry_result {
-            Ok(entry) => {
-                match replay_wal_entry_force(&entry, document_ops).await {
-                    Ok(applied) => {
-                        if applied {
-                            recovered += 1;
-                        }
-                        else {
-                            skipped += 1;
-                        }
-                    },
-                    Err(e) => {
-                        failed += 1;
-                        failures.push(WalRecoveryFailure {
-                            transaction_id: entry.transaction_id_str().to_owned(),
-                            document_id:    entry.document_id_str().to_owned(),
-                            operation_type: format!("{:?}", entry.entry_type),
-                            reason:         format!("{}", e),
-                        });
-                    },
-                }
-            },
+    let mut segments = wal.segments().await?;
+    while let Some(segment) = segments.next_segment().await {
+        let segment = match segment {
+            Ok(segment) => segment,
             Err(e) => {
                 failed += 1;
-                failures.push(WalRecoveryFailure {
-                    transaction_id: "unknown".to_owned(),
-                    document_id:    "unknown".to_owned(),
-                    operation_type: "read".to_owned(),
-                    reason:         format!("Failed to read WAL entry: {}", e),
-                });
+                failures.push(WalRecoveryFailure::unreadable(&e));
+                continue;
             },
+        };
+        for entry in segment.entries() {
+            match replay_wal_entry_force(&entry, document_ops).await {
+                Ok(applied) => {
+                    if applied {
+                        recovered += 1;
+                    }
+                    else {
+                        skipped += 1;
+                    }
+                },
+                Err(e) => {
+                    failed += 1;
+                    failures.push(WalRecoveryFailure {
+                        transaction_id: entry.transaction_id_str().to_owned(),
+                        document_id:    entry.document_id_str().to_owned(),
+                        operation_type: format!("{:?}", entry.entry_type),
+                        reason:         format!("{}", e),
+                    });
+                },
+            }
         }
     }
 
@@ -320,13 +452,13 @@ where
 }
 
 /// Force replay a WAL entry (overwrites conflicts)
-async fn replay_wal_entry_force<D>(entry: &LogEntry, document_ops: &D) -> Result<bool>
+async fn replay_wal_entry_force<D>(entry: &LogEntryRef<'_>, document_ops: &D) -> Result<bool>
 where
     D: WalDocumentOps,
 {
     match entry.entry_type {
         EntryType::Insert | EntryType::Update => {
-            if let Some(data_str) = entry.data.as_ref() {
+            if let Some(data_str) = entry.data() {
                 let data: serde_json::Value = serde_json::from_str(data_str)
                     .map_err(|e| crate::error::WalError::Serialization(format!("Invalid JSON in WAL entry: {}", e)))?;
 
@@ -406,6 +538,23 @@ mod tests {
         }
     }
 
+    /// Reduce a single entry and replay it, as recovery does for a document logged once
+    async fn replay_wal_entry_safe<D>(entry: &LogEntryRef<'_>, document_ops: &D) -> Result<bool>
+    where
+        D: WalDocumentOps,
+    {
+        let mut document = DocumentReplay::new(0);
+        document.fold(entry)?;
+        replay_document(
+            entry.document_id_str(),
+            document.absent,
+            document.present,
+            document_ops,
+        )
+        .await
+        .map(|effective| effective > 0)
+    }
+
     fn create_test_entry(entry_type: EntryType, doc_id: &str, data: Option<&str>) -> LogEntry {
         use crate::entry::{FixedBytes256, FixedBytes32};
         LogEntry {
@@ -423,7 +572,7 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Insert, "doc1", Some(r#"{"name": "test"}"#));
 
-        let result = replay_wal_entry_safe(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await.unwrap();
         assert!(result);
 
         let doc = ops.get_document("doc1").await.unwrap();
@@ -444,7 +593,7 @@ mod tests {
 
         let entry = create_test_entry(EntryType::Insert, "doc1", Some(r#"{"name": "duplicate"}"#));
 
-        let result = replay_wal_entry_safe(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await.unwrap();
         assert!(!result); // Should be skipped
 
         let doc = ops.get_document("doc1").await.unwrap();
@@ -465,7 +614,7 @@ mod tests {
 
         let entry = create_test_entry(EntryType::Update, "doc1", Some(r#"{"name": "updated"}"#));
 
-        let result = replay_wal_entry_safe(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await.unwrap();
         assert!(result);
 
         let doc = ops.get_document("doc1").await.unwrap();
@@ -477,7 +626,7 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Update, "doc1", Some(r#"{"name": "updated"}"#));
 
-        let result = replay_wal_entry_safe(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await.unwrap();
         assert!(!result); // Should be skipped
     }
 
@@ -495,7 +644,7 @@ mod tests {
 
         let entry = create_test_entry(EntryType::Delete, "doc1", None);
 
-        let result = replay_wal_entry_safe(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await.unwrap();
         assert!(result);
 
         let doc = ops.get_document("doc1").await.unwrap();
@@ -507,7 +656,7 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Delete, "doc1", None);
 
-        let result = replay_wal_entry_safe(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await.unwrap();
         assert!(!result); // Should be skipped
     }
 
@@ -516,7 +665,7 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Begin, "doc1", None);
 
-        let result = replay_wal_entry_safe(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await.unwrap();
         assert!(!result); // Transaction control should be skipped
     }
 
@@ -525,7 +674,7 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Insert, "doc1", Some("invalid json"));
 
-        let result = replay_wal_entry_safe(&entry, &ops).await;
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await;
         assert!(result.is_err());
     }
 
@@ -590,7 +739,7 @@ mod tests {
         let ops = ErrorDocumentOps;
         let entry = create_test_entry(EntryType::Update, "doc1", Some(r#"{"name": "test"}"#));
 
-        let result = replay_wal_entry_safe(&entry, &ops).await;
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await;
         assert!(result.is_err());
     }
 
@@ -628,6 +777,50 @@ mod tests {
         assert_eq!(result.skipped_operations, 4);
     }
 
+    #[tokio::test]
+    async fn test_recover_wal_safe_counts_match_sequential_replay() {
+        use tempfile::tempdir;
+
+        use crate::{EntryType, LogEntry, WalConfig, WalManager};
+
+        let temp_dir = tempdir().unwrap();
+        let wal = WalManager::new(temp_dir.path().join("counts.wal"), WalConfig::default())
+            .await
+            .unwrap();
+        for name in ["first", "second"] {
+            wal.write_entry(LogEntry::new(
+                EntryType::Update,
+                "users".to_string(),
+                "user-1".to_string(),
+                Some(serde_json::json!({"name": name})),
+            ))
+            .await
+            .unwrap();
+        }
+
+        // The document already holds the first update, which a sequential replay skips
+        let ops = MockDocumentOps::new();
+        ops.apply_operation(
+            &EntryType::Insert,
+            "user-1",
+            Some(serde_json::json!({"name": "first"})),
+        )
+        .await
+        .unwrap();
+        let result = recover_from_wal_safe(&wal, &ops).await.unwrap();
+        assert_eq!(result.recovered_operations, 1);
+        assert_eq!(result.skipped_operations, 1);
+
+        // The document already holds the final state: both updates changed it in sequence
+        let result = recover_from_wal_safe(&wal, &ops).await.unwrap();
+        assert_eq!(result.recovered_operations, 2);
+        assert_eq!(result.skipped_operations, 0);
+        assert_eq!(
+            ops.get_document("user-1").await.unwrap().unwrap(),
+            serde_json::json!({"name": "second"})
+        );
+    }
+
     #[tokio::test]
     async fn test_replay_wal_force_io_error_on_delete() {
         // Test force delete handles IO errors gracefully
@@ -660,7 +853,7 @@ mod tests {
         let entry = create_test_entry(EntryType::Delete, "doc1", None);
 
         // Force replay should handle IO error
-        let result = replay_wal_entry_force(&entry, &ops).await;
+        let result = replay_wal_entry_force(&entry.as_view(), &ops).await;
         assert!(result.is_ok() || result.unwrap_err().to_string().contains("permission"));
     }
 
@@ -812,7 +1005,7 @@ mod tests {
         let ops = FailOnInsertDocumentOps;
         let entry = create_test_entry(EntryType::Insert, "fail-doc", Some(r#"{"name": "test"}"#));
 
-        let result = replay_wal_entry_safe(&entry, &ops).await;
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await;
         assert!(result.is_err());
     }
 
@@ -880,7 +1073,7 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Insert, "doc1", None);
 
-        let result = replay_wal_entry_safe(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await.unwrap();
         assert!(!result); // Should be skipped
     }
 
@@ -890,7 +1083,7 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Update, "doc1", None);
 
-        let result = replay_wal_entry_safe(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await.unwrap();
         assert!(!result); // Should be skipped
     }
 
@@ -900,7 +1093,7 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Commit, "doc1", None);
 
-        let result = replay_wal_entry_safe(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await.unwrap();
         assert!(!result);
     }
 
@@ -910,7 +1103,7 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Rollback, "doc1", None);
 
-        let result = replay_wal_entry_safe(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await.unwrap();
         assert!(!result);
     }
 
@@ -920,7 +1113,9 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Insert, "doc1", None);
 
-        let result = replay_wal_entry_force(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_force(&entry.as_view(), &ops)
+            .await
+            .unwrap();
         assert!(!result); // Should return false for missing data
     }
 
@@ -930,7 +1125,9 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Begin, "doc1", None);
 
-        let result = replay_wal_entry_force(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_force(&entry.as_view(), &ops)
+            .await
+            .unwrap();
         assert!(!result);
     }
 
@@ -940,7 +1137,9 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Commit, "doc1", None);
 
-        let result = replay_wal_entry_force(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_force(&entry.as_view(), &ops)
+            .await
+            .unwrap();
         assert!(!result);
     }
 
@@ -950,7 +1149,9 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Rollback, "doc1", None);
 
-        let result = replay_wal_entry_force(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_force(&entry.as_view(), &ops)
+            .await
+            .unwrap();
         assert!(!result);
     }
 
@@ -968,7 +1169,9 @@ mod tests {
 
         let entry = create_test_entry(EntryType::Update, "doc1", Some(r#"{"version": 2}"#));
 
-        let result = replay_wal_entry_force(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_force(&entry.as_view(), &ops)
+            .await
+            .unwrap();
         assert!(result);
 
         let doc = ops.get_document("doc1").await.unwrap();
@@ -1058,7 +1261,7 @@ mod tests {
         };
         let entry = create_test_entry(EntryType::Insert, "doc1", Some(r#"{"name": "test"}"#));
 
-        let result = replay_wal_entry_safe(&entry, &ops).await;
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await;
         assert!(result.is_err());
     }
 
@@ -1129,7 +1332,7 @@ mod tests {
             Some(r#"{"name": "test", "age": 25}"#),
         );
 
-        let result = replay_wal_entry_safe(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await.unwrap();
         assert!(!result); // Should be skipped because data is the same
     }
 
@@ -1158,7 +1361,9 @@ mod tests {
         let ops = DeleteFailsDocumentOps;
         let entry = create_test_entry(EntryType::Delete, "doc1", None);
 
-        let result = replay_wal_entry_force(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_force(&entry.as_view(), &ops)
+            .await
+            .unwrap();
         assert!(!result); // IO error treated as false
     }
 
@@ -1168,7 +1373,7 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Update, "doc1", Some("not valid json"));
 
-        let result = replay_wal_entry_safe(&entry, &ops).await;
+        let result = replay_wal_entry_safe(&entry.as_view(), &ops).await;
         assert!(result.is_err());
     }
 
@@ -1178,7 +1383,9 @@ mod tests {
         let ops = MockDocumentOps::new();
         let entry = create_test_entry(EntryType::Update, "doc1", None);
 
-        let result = replay_wal_entry_force(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_force(&entry.as_view(), &ops)
+            .await
+            .unwrap();
         assert!(!result);
     }
 
@@ -1196,7 +1403,9 @@ mod tests {
 
         let entry = create_test_entry(EntryType::Delete, "doc1", None);
 
-        let result = replay_wal_entry_force(&entry, &ops).await.unwrap();
+        let result = replay_wal_entry_force(&entry.as_view(), &ops)
+            .await
+            .unwrap();
         assert!(result);
 
         let doc = ops.get_document("doc1").await.unwrap();
@@ -1225,7 +1434,57 @@ mod tests {
         let ops = CustomErrorOps;
         let entry = create_test_entry(EntryType::Insert, "doc1", Some(r#"{"name": "test"}"#));
 
-        let result = replay_wal_entry_force(&entry, &ops).await;
+        let result = replay_wal_entry_force(&entry.as_view(), &ops).await;
         assert!(result.is_err());
     }
+
+    #[tokio::test]
+    async fn test_recover_wal_safe_reduces_to_net_effect() {
+        // Each document is written once with the state of its last effective entry
+        use tempfile::tempdir;
+
+        use crate::{EntryType, LogEntry, WalConfig, WalManager};
+
+        let temp_dir = tempdir().unwrap();
+        let wal = WalManager::new(
+            temp_dir.path().join("test_reduce.wal"),
+            WalConfig::default(),
+        )
+        .await
+        .unwrap();
+
+        for (entry_type, doc_id, version) in [
+            (EntryType::Insert, "user-1", Some(1)),
+            (EntryType::Update, "user-1", Some(2)),
+            (EntryType::Insert, "user-2", Some(1)),
+            (EntryType::Update, "user-1", Some(3)),
+            (EntryType::Delete, "user-2", None),
+            (EntryType::Insert, "user-3", Some(1)),
+        ] {
+            wal.write_entry(LogEntry::new(
+                entry_type,
+                "users".to_string(),
+                doc_id.to_string(),
+                version.map(|v| serde_json::json!({ "version": v })),
+            ))
+            .await
+            .unwrap();
+        }
+
+        let ops = MockDocumentOps::new();
+        // user-3 already exists on disk, so its insert is skipped
+        ops.documents
+            .lock()
+            .unwrap()
+            .insert("user-3".to_string(), serde_json::json!({"version": 0}));
+        let result = recover_from_wal_safe(&wal, &ops).await.unwrap();
+
+        assert_eq!(result.recovered_operations, 5);
+        assert_eq!(result.skipped_operations, 1);
+        assert_eq!(result.failed_operations, 0);
+        let docs = ops.documents.lock().unwrap();
+        assert_eq!(docs.get("user-1"), Some(&serde_json::json!({"version": 3})));
+        assert!(!docs.contains_key("user-2"));
+        assert_eq!(docs.get("user-3"), Some(&serde_json::json!({"version": 0})));
+    }
 }
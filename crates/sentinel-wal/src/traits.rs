@@ -1,4 +1,4 @@
-//! Traits for WAL operations that require document access
+//! Traits for WAL operations that require document access or encryption
 
 use serde_json::Value;
 
@@ -19,3 +19,17 @@ pub trait WalDocumentOps: Send + Sync {
         let _ = mode;
     }
 }
+
+/// Encryption of the entries written to a WAL.
+///
+/// A [`WalManager`](crate::WalManager) given a cipher through
+/// [`WalManager::with_cipher`](crate::WalManager::with_cipher) encrypts the serialized entry of
+/// every `BinaryV2` frame it writes and decrypts encrypted frames when reading. Frame headers stay
+/// in the clear, so LSNs, checksums and resynchronisation work unchanged.
+pub trait PayloadCipher: Send + Sync + std::fmt::Debug {
+    /// Encrypt a serialized entry
+    fn encrypt(&self, payload: &[u8]) -> Result<Vec<u8>>;
+
+    /// Decrypt a payload produced by [`Self::encrypt`]
+    fn decrypt(&self, encrypted: &[u8]) -> Result<Vec<u8>>;
+}
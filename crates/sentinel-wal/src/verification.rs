@@ -8,10 +8,9 @@
 
 use std::collections::HashMap;
 
-use futures::StreamExt as _;
 use serde::{Deserialize, Serialize};
 
-use crate::{EntryType, LogEntry, Result, WalDocumentOps, WalManager};
+use crate::{EntryType, LogEntry, LogEntryRef, Result, WalDocumentOps, WalManager};
 
 /// Issues found during WAL verification
 #[derive(Debug, Clone, Serialize, Deserialize)]
@@ -55,26 +54,26 @@ where
     let mut active_transactions = HashMap::new(); // txn_id -> operations
     let mut entries_processed = 0;
 
-    let stream = wal.stream_entries();
-    let mut pinned_stream = std::pin::pin!(stream);
-    while let Some(entry_result) = pinned_stream.next().await {
-        match entry_result {
-            Ok(entry) => {
-                entries_processed += 1;
-                if let Some(issue) =
-                    verify_wal_entry_consistency(&entry, &mut wal_states, &mut active_transactions).await?
-                {
-                    issues.push(issue);
-                }
-            },
+    let mut segments = wal.segments().await?;
+    while let Some(segment) = segments.next_segment().await {
+        let segment = match segment {
+            Ok(segment) => segment,
             Err(e) => {
                 issues.push(WalVerificationIssue {
                     transaction_id: "unknown".to_owned(),
                     document_id:    "unknown".to_owned(),
-                    description:    format!("Failed to read WAL entry: {}", e),
+                    description:    format!("Failed to read WAL segment: {}", e),
                     is_critical:    true,
                 });
+                continue;
             },
+        };
+        for entry in segment.entries() {
+            entries_processed += 1;
+            if let Some(issue) = verify_wal_entry_consistency(&entry, &mut wal_states, &mut active_transactions).await?
+            {
+                issues.push(issue);
+            }
         }
     }
 
@@ -125,7 +124,7 @@ where
 
 /// Verify a single WAL entry for consistency
 async fn verify_wal_entry_consistency(
-    entry: &LogEntry,
+    entry: &LogEntryRef<'_>,
     wal_states: &mut HashMap<String, serde_json::Value>,
     active_transactions: &mut HashMap<String, Vec<LogEntry>>,
 ) -> Result<Option<WalVerificationIssue>> {
@@ -136,12 +135,12 @@ async fn verify_wal_entry_consistency(
     active_transactions
         .entry(txn_id.to_owned())
         .or_insert_with(Vec::new)
-        .push(entry.clone());
+        .push(entry.to_log_entry());
 
     match entry.entry_type {
         EntryType::Begin => {
             // Transaction begin - should not have data
-            if entry.data.is_some() {
+            if entry.data().is_some() {
                 return Ok(Some(WalVerificationIssue {
                     transaction_id: txn_id.to_owned(),
                     document_id:    doc_id.to_owned(),
@@ -151,7 +150,7 @@ async fn verify_wal_entry_consistency(
             }
         },
         EntryType::Insert => {
-            if let Some(data_str) = entry.data.as_ref() {
+            if let Some(data_str) = entry.data() {
                 match serde_json::from_str(data_str) {
                     Ok(data) => {
                         // Check if document already exists in WAL state
@@ -185,7 +184,7 @@ async fn verify_wal_entry_consistency(
             }
         },
         EntryType::Update => {
-            if let Some(data_str) = entry.data.as_ref() {
+            if let Some(data_str) = entry.data() {
                 match serde_json::from_str(data_str) {
                     Ok(data) => {
                         // For partial WAL verification, updates can reference documents
@@ -364,7 +363,7 @@ mod tests {
         let mut entry = create_test_entry(EntryType::Insert, "doc1", "txn1");
         entry.data = Some(r#"{"name": "test"}"#.to_string());
 
-        let result = verify_wal_entry_consistency(&entry, &mut wal_states, &mut active_transactions)
+        let result = verify_wal_entry_consistency(&entry.as_view(), &mut wal_states, &mut active_transactions)
             .await
             .unwrap();
         assert!(result.is_none());
@@ -379,17 +378,25 @@ mod tests {
         // First insert
         let mut insert_entry = create_test_entry(EntryType::Insert, "doc1", "txn1");
         insert_entry.data = Some(r#"{"name": "test"}"#.to_string());
-        verify_wal_entry_consistency(&insert_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        verify_wal_entry_consistency(
+            &insert_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
 
         // Then update
         let mut update_entry = create_test_entry(EntryType::Update, "doc1", "txn2");
         update_entry.data = Some(r#"{"updated": true}"#.to_string());
 
-        let result = verify_wal_entry_consistency(&update_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &update_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         assert!(result.is_none());
     }
 
@@ -400,16 +407,24 @@ mod tests {
 
         // First insert
         let insert_entry = create_test_entry(EntryType::Insert, "doc1", "txn1");
-        verify_wal_entry_consistency(&insert_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        verify_wal_entry_consistency(
+            &insert_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
 
         // Then delete
         let delete_entry = create_test_entry(EntryType::Delete, "doc1", "txn2");
 
-        let result = verify_wal_entry_consistency(&delete_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &delete_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         assert!(result.is_none());
         assert!(!wal_states.contains_key("doc1"));
     }
@@ -422,9 +437,13 @@ mod tests {
         let mut begin_entry = create_test_entry(EntryType::Begin, "doc1", "txn1");
         begin_entry.data = Some(r#"{"unexpected": "data"}"#.to_string());
 
-        let result = verify_wal_entry_consistency(&begin_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &begin_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         assert!(result.is_some());
         let issue = result.unwrap();
         assert_eq!(issue.transaction_id, "txn1");
@@ -441,9 +460,13 @@ mod tests {
         let mut insert_entry = create_test_entry(EntryType::Insert, "doc1", "txn1");
         insert_entry.data = Some(r#"{"invalid": json}"#.to_string());
 
-        let result = verify_wal_entry_consistency(&insert_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &insert_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         assert!(result.is_some());
         let issue = result.unwrap();
         assert_eq!(issue.transaction_id, "txn1");
@@ -460,9 +483,13 @@ mod tests {
         let mut insert_entry = create_test_entry(EntryType::Insert, "doc1", "txn1");
         insert_entry.data = None;
 
-        let result = verify_wal_entry_consistency(&insert_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &insert_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         assert!(result.is_some());
         let issue = result.unwrap();
         assert_eq!(issue.transaction_id, "txn1");
@@ -479,9 +506,13 @@ mod tests {
         let mut update_entry = create_test_entry(EntryType::Update, "doc1", "txn1");
         update_entry.data = Some(r#"{"invalid": json}"#.to_string());
 
-        let result = verify_wal_entry_consistency(&update_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &update_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         assert!(result.is_some());
         let issue = result.unwrap();
         assert_eq!(issue.transaction_id, "txn1");
@@ -498,17 +529,25 @@ mod tests {
         // First insert
         let mut insert_entry1 = create_test_entry(EntryType::Insert, "doc1", "txn1");
         insert_entry1.data = Some(r#"{"name": "test"}"#.to_string());
-        verify_wal_entry_consistency(&insert_entry1, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        verify_wal_entry_consistency(
+            &insert_entry1.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
 
         // Second insert of same document
         let mut insert_entry2 = create_test_entry(EntryType::Insert, "doc1", "txn2");
         insert_entry2.data = Some(r#"{"name": "test2"}"#.to_string());
 
-        let result = verify_wal_entry_consistency(&insert_entry2, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &insert_entry2.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         assert!(result.is_some());
         let issue = result.unwrap();
         assert_eq!(issue.transaction_id, "txn2");
@@ -526,9 +565,13 @@ mod tests {
         update_entry.data = Some(r#"{"name": "updated"}"#.to_string());
 
         // Update on nonexistent is actually valid (creates document-like state)
-        let result = verify_wal_entry_consistency(&update_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &update_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         // This should be None since update is allowed on nonexistent
         assert!(result.is_none());
     }
@@ -541,9 +584,13 @@ mod tests {
         let delete_entry = create_test_entry(EntryType::Delete, "nonexistent", "txn1");
 
         // Delete on nonexistent is actually valid
-        let result = verify_wal_entry_consistency(&delete_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &delete_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         // This should be None since delete is allowed on nonexistent
         assert!(result.is_none());
     }
@@ -556,15 +603,23 @@ mod tests {
         // First insert
         let mut insert_entry = create_test_entry(EntryType::Insert, "doc1", "txn1");
         insert_entry.data = Some(r#"{"name": "test"}"#.to_string());
-        verify_wal_entry_consistency(&insert_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        verify_wal_entry_consistency(
+            &insert_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
 
         // Then delete
         let delete_entry = create_test_entry(EntryType::Delete, "doc1", "txn2");
-        let result = verify_wal_entry_consistency(&delete_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &delete_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         assert!(result.is_none()); // Should be valid
     }
 
@@ -575,15 +630,23 @@ mod tests {
 
         // Begin first
         let begin_entry = create_test_entry(EntryType::Begin, "doc1", "txn1");
-        verify_wal_entry_consistency(&begin_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        verify_wal_entry_consistency(
+            &begin_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
 
         // Try to rollback without operations
         let rollback_entry = create_test_entry(EntryType::Rollback, "doc1", "txn1");
-        let result = verify_wal_entry_consistency(&rollback_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &rollback_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         assert!(result.is_none()); // Rollback after begin without operations should be fine
     }
 
@@ -595,23 +658,35 @@ mod tests {
         // Insert
         let mut insert_entry = create_test_entry(EntryType::Insert, "doc1", "txn1");
         insert_entry.data = Some(r#"{"v": 1}"#.to_string());
-        verify_wal_entry_consistency(&insert_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        verify_wal_entry_consistency(
+            &insert_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
 
         // Update 1
         let mut update1 = create_test_entry(EntryType::Update, "doc1", "txn2");
         update1.data = Some(r#"{"v": 2}"#.to_string());
-        verify_wal_entry_consistency(&update1, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        verify_wal_entry_consistency(
+            &update1.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
 
         // Update 2
         let mut update2 = create_test_entry(EntryType::Update, "doc1", "txn3");
         update2.data = Some(r#"{"v": 3}"#.to_string());
-        let result = verify_wal_entry_consistency(&update2, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &update2.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         assert!(result.is_none()); // Should be valid
     }
 
@@ -621,14 +696,22 @@ mod tests {
         let mut active_transactions = std::collections::HashMap::new();
 
         let begin_entry = create_test_entry(EntryType::Begin, "doc1", "txn1");
-        verify_wal_entry_consistency(&begin_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        verify_wal_entry_consistency(
+            &begin_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
 
         let commit_entry = create_test_entry(EntryType::Commit, "doc1", "txn1");
-        let result = verify_wal_entry_consistency(&commit_entry, &mut wal_states, &mut active_transactions)
-            .await
-            .unwrap();
+        let result = verify_wal_entry_consistency(
+            &commit_entry.as_view(),
+            &mut wal_states,
+            &mut active_transactions,
+        )
+        .await
+        .unwrap();
         assert!(result.is_none()); // Commit should be fine after begin
     }
 }
@@ -1,19 +1,62 @@
-use std::hint::black_box;
+use std::{
+    alloc::{GlobalAlloc, Layout, System},
+    hint::black_box,
+    sync::{
+        atomic::{AtomicUsize, Ordering},
+        Arc,
+    },
+};
 
 use criterion::{criterion_group, criterion_main, Criterion};
 use futures::TryStreamExt;
-use sentinel_dbms::{Aggregation, Collection, Filter, Operator, Query, QueryBuilder, SortOrder, Store};
+use sentinel_dbms::{
+    Aggregation,
+    BlockingBackend,
+    Collection,
+    Filter,
+    Operator,
+    Query,
+    QueryBuilder,
+    SortOrder,
+    StorageBackend,
+    Store,
+    StoreWalConfig,
+    TokioBackend,
+};
 use serde_json::{json, Value};
 use tempfile::tempdir;
 
-async fn setup_collection() -> (Collection, tempfile::TempDir) {
+/// Global allocator counting every allocation, used to report allocations per document.
+struct CountingAllocator;
+
+/// Number of allocations performed since the process started.
+static ALLOCATIONS: AtomicUsize = AtomicUsize::new(0);
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        unsafe { System.alloc(layout) }
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) { unsafe { System.dealloc(ptr, layout) } }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        unsafe { System.realloc(ptr, layout, new_size) }
+    }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAllocator = CountingAllocator;
+
+async fn setup_collection() -> (Arc<Collection>, tempfile::TempDir) {
     let temp_dir = tempdir().unwrap();
     let store = Store::new(temp_dir.path(), None).await.unwrap();
     let collection = store.collection("bench_collection").await.unwrap();
     (collection, temp_dir)
 }
 
-async fn setup_collection_with_data(count: usize) -> (Collection, tempfile::TempDir) {
+async fn setup_collection_with_data(count: usize) -> (Arc<Collection>, tempfile::TempDir) {
     let (collection, temp_dir) = setup_collection().await;
 
     // Insert test data
@@ -301,6 +344,7 @@ fn bench_query_complex(c: &mut Criterion) {
                         sort:       Some(("name".to_string(), SortOrder::Ascending)),
                         limit:      Some(25),
                         offset:     Some(10),
+                        after:      None,
                         projection: None,
                     };
                     let result = black_box(collection.query(query).await.unwrap());
@@ -312,6 +356,37 @@ fn bench_query_complex(c: &mut Criterion) {
     });
 }
 
+fn bench_query_projection_allocations(c: &mut Criterion) {
+    let rt = tokio::runtime::Runtime::new().unwrap();
+    let (collection, _temp_dir) = rt.block_on(async { setup_collection_with_data(1000).await });
+
+    let run_query = || {
+        rt.block_on(async {
+            let query = QueryBuilder::new()
+                .filter("active", Operator::Equals, json!(true))
+                .projection(vec!["name", "value"])
+                .build();
+            let result = collection.query(query).await.unwrap();
+            result.documents.try_collect::<Vec<_>>().await.unwrap()
+        })
+    };
+
+    // Report allocations per returned document so regressions in the per-document path show up
+    let before = ALLOCATIONS.load(Ordering::Relaxed);
+    let docs = run_query();
+    let allocations = ALLOCATIONS.load(Ordering::Relaxed).saturating_sub(before);
+    println!(
+        "collection_query_projection: {} allocations for {} documents ({:.1} per document)",
+        allocations,
+        docs.len(),
+        allocations as f64 / docs.len().max(1) as f64
+    );
+
+    c.bench_function("collection_query_projection", |b| {
+        b.iter(|| black_box(run_query()))
+    });
+}
+
 fn bench_aggregate_count(c: &mut Criterion) {
     let rt = tokio::runtime::Runtime::new().unwrap();
 
@@ -378,6 +453,55 @@ fn bench_aggregate_avg(c: &mut Criterion) {
     });
 }
 
+fn bench_storage_backends(c: &mut Criterion) {
+    let rt = tokio::runtime::Runtime::new().unwrap();
+    let mut group = c.benchmark_group("storage_backend_insert_get");
+
+    let backends: [(&str, Arc<dyn StorageBackend>); 2] = [
+        ("blocking", Arc::new(BlockingBackend)),
+        ("tokio", Arc::new(TokioBackend)),
+    ];
+    for (name, backend) in backends {
+        group.bench_function(name, |b| {
+            b.iter_batched(
+                || {
+                    rt.block_on(async {
+                        let temp_dir = tempdir().unwrap();
+                        let store = Store::new_with_backend(
+                            temp_dir.path(),
+                            None,
+                            StoreWalConfig::default(),
+                            backend.clone(),
+                        )
+                        .await
+                        .unwrap();
+                        let collection = store
+                            .collection_with_config("bench_collection", None)
+                            .await
+                            .unwrap();
+                        (collection, temp_dir)
+                    })
+                },
+                |(collection, _temp_dir)| {
+                    rt.block_on(async move {
+                        for i in 0 .. 10 {
+                            let id = format!("doc_{}", i);
+                            collection
+                                .insert(&id, json!({"name": "test", "value": black_box(i)}))
+                                .await
+                                .unwrap();
+                            black_box(collection.get(&id).await.unwrap());
+                        }
+                    })
+                },
+                criterion::BatchSize::SmallInput,
+            )
+        });
+    }
+
+    group.finish();
+}
+
 criterion_group!(
     benches,
     bench_insert,
@@ -392,8 +516,10 @@ criterion_group!(
     bench_query_simple,
     bench_query_with_sort,
     bench_query_complex,
+    bench_query_projection_allocations,
     bench_aggregate_count,
     bench_aggregate_sum,
-    bench_aggregate_avg
+    bench_aggregate_avg,
+    bench_storage_backends
 );
 criterion_main!(benches);
@@ -1,7 +1,7 @@
 use std::{hint::black_box, sync::Arc};
 
 use criterion::{criterion_group, criterion_main, Criterion};
-use sentinel_dbms::{Collection, Store};
+use sentinel_dbms::{Collection, SentinelError, Store};
 use serde_json::json;
 use tempfile::tempdir;
 use tokio::runtime::Runtime;
@@ -9,7 +9,7 @@ use tokio::runtime::Runtime;
 async fn setup_concurrent_collection(count: usize) -> (Arc<Collection>, tempfile::TempDir) {
     let temp_dir = tempdir().unwrap();
     let store = Store::new(temp_dir.path(), None).await.unwrap();
-    let collection = Arc::new(store.collection("concurrent_test").await.unwrap());
+    let collection = store.collection("concurrent_test").await.unwrap();
 
     // Pre-populate with some data
     for i in 0 .. count {
@@ -158,6 +158,77 @@ fn bench_mixed_concurrent_operations(c: &mut Criterion) {
             criterion::BatchSize::SmallInput,
         )
     });
+
+    // Every writer targets the same few documents, serialized by their document locks
+    c.bench_function("mixed_concurrent_operations_hot_keys", |b| {
+        b.iter_batched(
+            || rt.block_on(async { setup_concurrent_collection(500).await }),
+            |(collection, _temp_dir)| {
+                rt.block_on(async move {
+                    let mut handles = vec![];
+
+                    // Reader threads, away from the hot documents
+                    for thread_id in 0 .. 3 {
+                        let coll = Arc::clone(&collection);
+                        let handle = tokio::spawn(async move {
+                            let start = 200 + thread_id * 100;
+                            let end = start + 100;
+                            for i in start .. end {
+                                let doc = coll.get(&format!("doc_{}", i)).await.unwrap();
+                                black_box(doc);
+                            }
+                        });
+                        handles.push(handle);
+                    }
+
+                    // Merging updater threads, each setting its own field of the hot documents
+                    for thread_id in 0 .. 4 {
+                        let coll = Arc::clone(&collection);
+                        let handle = tokio::spawn(async move {
+                            for i in 0 .. 50 {
+                                let doc_id = format!("doc_{}", i % 4);
+                                let doc = json!({ format!("thread_{}", thread_id): i });
+                                coll.update(&doc_id, doc).await.unwrap();
+                            }
+                        });
+                        handles.push(handle);
+                    }
+
+                    // Optimistic updater threads, retrying increments of a hot counter on conflict
+                    for _ in 0 .. 2 {
+                        let coll = Arc::clone(&collection);
+                        let handle = tokio::spawn(async move {
+                            for _ in 0 .. 25 {
+                                loop {
+                                    // Reads take no lock, and may see a file while it is being rewritten
+                                    let Ok(Some(doc)) = coll.get("doc_0").await
+                                    else {
+                                        continue;
+                                    };
+                                    let value = doc.data()["value"].as_u64().unwrap();
+                                    match coll
+                                        .compare_and_update("doc_0", doc.hash(), json!({"value": value + 1}))
+                                        .await
+                                    {
+                                        Err(SentinelError::VersionConflict {
+                                            ..
+                                        }) => continue,
+                                        result => break result.unwrap(),
+                                    }
+                                }
+                            }
+                        });
+                        handles.push(handle);
+                    }
+
+                    for handle in handles {
+                        handle.await.unwrap();
+                    }
+                })
+            },
+            criterion::BatchSize::SmallInput,
+        )
+    });
 }
 
 fn bench_concurrent_bulk_operations(c: &mut Criterion) {
@@ -1,4 +1,4 @@
-use std::hint::black_box;
+use std::{hint::black_box, sync::Arc};
 
 use criterion::{async_executor::FuturesExecutor, criterion_group, criterion_main, Criterion};
 use futures::TryStreamExt;
@@ -125,7 +125,7 @@ fn bench_fuzzy_crypto_corrupted_ciphertext(c: &mut Criterion) {
 }
 
 // Fuzzy testing for database operations
-async fn setup_fuzzy_collection() -> (Collection, tempfile::TempDir) {
+async fn setup_fuzzy_collection() -> (Arc<Collection>, tempfile::TempDir) {
     let temp_dir = tempdir().unwrap();
     let store = Store::new(temp_dir.path(), None).await.unwrap();
     let collection = store.collection("fuzzy_test").await.unwrap();
@@ -165,6 +165,7 @@ fn bench_fuzzy_db_malformed_queries(c: &mut Criterion) {
                             sort:       None,
                             limit:      None,
                             offset:     None,
+                            after:      None,
                             projection: None,
                         };
                         let _ = black_box(collection.query(query).await);
@@ -1,4 +1,4 @@
-use std::hint::black_box;
+use std::{hint::black_box, sync::Arc};
 
 use criterion::{criterion_group, criterion_main, Criterion};
 use futures::TryStreamExt;
@@ -6,7 +6,7 @@ use sentinel_dbms::{Collection, Operator, QueryBuilder, Store};
 use serde_json::json;
 use tempfile::tempdir;
 
-async fn setup_memory_test_collection(count: usize) -> (Collection, tempfile::TempDir) {
+async fn setup_memory_test_collection(count: usize) -> (Arc<Collection>, tempfile::TempDir) {
     let temp_dir = tempdir().unwrap();
     let store = Store::new(temp_dir.path(), None).await.unwrap();
     let collection = store.collection("memory_test").await.unwrap();
@@ -0,0 +1,451 @@
+//! YCSB-style workload harness.
+//!
+//! Loads a collection, then runs a mix of operations against it from concurrent tasks and prints
+//! one JSON object per line with the throughput and the p50/p99/p999 latency of every operation
+//! type. Unlike the criterion benches, it sweeps the dataset and its configuration, so it shows how
+//! latency degrades with the collection size.
+//!
+//! ```text
+//! cargo bench -p sentinel-dbms --bench workload_harness
+//! SENTINEL_BENCH_DOCUMENTS=100000,1000000 SENTINEL_BENCH_WORKLOADS=read-heavy \
+//!     cargo bench -p sentinel-dbms --bench workload_harness > results.jsonl
+//! ```
+//!
+//! Every dimension is a comma separated list read from the environment:
+//!
+//! | Variable                        | Default                                    |
+//! | ------------------------------- | ------------------------------------------ |
+//! | `SENTINEL_BENCH_WORKLOADS`      | `read-heavy,write-heavy,scan,audit-append` |
+//! | `SENTINEL_BENCH_DOCUMENTS`      | `1000,10000`                               |
+//! | `SENTINEL_BENCH_DOCUMENT_BYTES` | `256,4096`                                 |
+//! | `SENTINEL_BENCH_CONCURRENCY`    | `1,16`                                     |
+//! | `SENTINEL_BENCH_DURABILITY`     | `flush,fdatasync`                          |
+//! | `SENTINEL_BENCH_SIGNING`        | `off,on`                                   |
+//! | `SENTINEL_BENCH_OPERATIONS`     | `2000` operations per run                  |
+//!
+//! A dataset is loaded once per document count, document size, durability mode and signing mode,
+//! and every workload and concurrency level then runs against it in turn. Keys are drawn from a
+//! scrambled Zipfian distribution, as in YCSB, so a few documents are hot.
+
+use std::{
+    str::FromStr,
+    sync::{
+        atomic::{AtomicU64, Ordering},
+        Arc,
+    },
+    time::{Duration, Instant},
+};
+
+use futures::TryStreamExt as _;
+use rand::{rngs::StdRng, Rng as _, SeedableRng as _};
+use sentinel_dbms::{Collection, IndexKind, Operator, QueryBuilder, Store, StoreWalConfig, WalDurability};
+use sentinel_wal::Histogram;
+use serde_json::{json, Value};
+use tempfile::tempdir;
+
+/// Number of documents written per bulk insert while loading a dataset.
+const LOAD_BATCH_SIZE: usize = 1000;
+
+/// Width of the `score` range read by a scan.
+const SCAN_WIDTH: u64 = 100;
+
+/// Maximum number of documents returned by a scan.
+const SCAN_LIMIT: usize = 100;
+
+/// Skew of the Zipfian key distribution, the YCSB default.
+const ZIPFIAN_THETA: f64 = 0.99;
+
+/// Passphrase of the stores that sign their documents.
+const PASSPHRASE: &str = "workload-harness";
+
+/// An operation type of a workload.
+#[derive(Debug, Clone, Copy)]
+enum Op {
+    /// Read one document by key.
+    Read,
+    /// Merge a field into one document.
+    Update,
+    /// Insert a new document.
+    Insert,
+    /// Read a range of documents through the `score` index.
+    Scan,
+}
+
+/// Proportions, in percent, of the operations a workload issues.
+#[derive(Debug, Clone, Copy)]
+struct Workload {
+    /// Name used on the command line and in the output.
+    name:   &'static str,
+    /// Share of reads.
+    read:   u32,
+    /// Share of updates.
+    update: u32,
+    /// Share of inserts.
+    insert: u32,
+    /// Share of scans.
+    scan:   u32,
+}
+
+impl Workload {
+    /// The workloads the harness knows about.
+    const ALL: [Self; 4] = [
+        // YCSB workload B
+        Self {
+            name:   "read-heavy",
+            read:   95,
+            update: 5,
+            insert: 0,
+            scan:   0,
+        },
+        Self {
+            name:   "write-heavy",
+            read:   20,
+            update: 40,
+            insert: 40,
+            scan:   0,
+        },
+        // YCSB workload E
+        Self {
+            name:   "scan",
+            read:   0,
+            update: 0,
+            insert: 5,
+            scan:   95,
+        },
+        // Append-only audit trail
+        Self {
+            name:   "audit-append",
+            read:   0,
+            update: 0,
+            insert: 100,
+            scan:   0,
+        },
+    ];
+
+    /// Picks the next operation from a uniform draw in `0 .. 100`.
+    fn pick(&self, draw: u32) -> Op {
+        if draw < self.read {
+            Op::Read
+        }
+        else if draw < self.read + self.update {
+            Op::Update
+        }
+        else if draw < self.read + self.update + self.insert {
+            Op::Insert
+        }
+        else {
+            Op::Scan
+        }
+    }
+}
+
+impl FromStr for Workload {
+    type Err = String;
+
+    fn from_str(s: &str) -> Result<Self, Self::Err> {
+        Self::ALL
+            .into_iter()
+            .find(|workload| workload.name == s)
+            .ok_or_else(|| format!("unknown workload: {}", s))
+    }
+}
+
+/// Zipfian generator of ranks in `0 .. n`, following Gray et al. as YCSB does.
+struct Zipfian {
+    /// Number of items.
+    n:     f64,
+    /// Zeta(n, theta).
+    zetan: f64,
+    /// 1 / (1 - theta).
+    alpha: f64,
+    /// Precomputed constant of the inverse transform.
+    eta:   f64,
+}
+
+impl Zipfian {
+    /// Builds a generator over `n` items.
+    fn new(n: u64) -> Self {
+        let zeta = |count: u64| {
+            (1 ..= count)
+                .map(|i| 1.0 / (i as f64).powf(ZIPFIAN_THETA))
+                .sum::<f64>()
+        };
+        let zetan = zeta(n);
+        let nf = n as f64;
+        Self {
+            n: nf,
+            zetan,
+            alpha: 1.0 / (1.0 - ZIPFIAN_THETA),
+            eta: (1.0 - (2.0 / nf).powf(1.0 - ZIPFIAN_THETA)) / (1.0 - zeta(2) / zetan),
+        }
+    }
+
+    /// Draws a key index, scrambled so the hot keys are spread over the key space.
+    fn next(&self, rng: &mut StdRng) -> u64 {
+        let u: f64 = rng.r#gen();
+        let uz = u * self.zetan;
+        let rank = if uz < 1.0 {
+            0
+        }
+        else if uz < 1.0 + 0.5_f64.powf(ZIPFIAN_THETA) {
+            1
+        }
+        else {
+            (self.n * (self.eta * u - self.eta + 1.0).powf(self.alpha)) as u64
+        };
+        rank.wrapping_mul(0x9e37_79b9_7f4a_7c15) % (self.n as u64)
+    }
+}
+
+/// One point of the sweep that needs its own dataset.
+#[derive(Debug, Clone, Copy)]
+struct Dataset {
+    /// Number of documents loaded.
+    documents:      u64,
+    /// Approximate size of the data of each document.
+    document_bytes: usize,
+    /// WAL durability mode of the collection.
+    durability:     WalDurability,
+    /// Whether documents are signed.
+    signing:        bool,
+}
+
+/// Latencies of the operations of one run.
+#[derive(Default)]
+struct Latencies {
+    /// Read latency.
+    read:   Histogram,
+    /// Update latency.
+    update: Histogram,
+    /// Insert latency.
+    insert: Histogram,
+    /// Scan latency, until the last document is received.
+    scan:   Histogram,
+}
+
+impl Latencies {
+    /// Returns the histogram of `op`.
+    const fn of(&self, op: Op) -> &Histogram {
+        match op {
+            Op::Read => &self.read,
+            Op::Update => &self.update,
+            Op::Insert => &self.insert,
+            Op::Scan => &self.scan,
+        }
+    }
+}
+
+/// Reads a comma separated list from the environment variable `name`.
+fn env_list<T>(name: &str, default: &str) -> Vec<T>
+where
+    T: FromStr,
+    T::Err: std::fmt::Display,
+{
+    std::env::var(name)
+        .unwrap_or_else(|_| default.to_owned())
+        .split(',')
+        .map(str::trim)
+        .filter(|item| !item.is_empty())
+        .map(|item| {
+            item.parse()
+                .unwrap_or_else(|e| panic!("invalid {} entry {:?}: {}", name, item, e))
+        })
+        .collect()
+}
+
+/// Builds the data of document `index`, padded to about `bytes` bytes.
+fn document(index: u64, bytes: usize, rng: &mut StdRng, documents: u64) -> Value {
+    json!({
+        "index": index,
+        "score": rng.gen_range(0 .. documents.max(1)),
+        "category": format!("category_{}", index % 16),
+        "payload": "x".repeat(bytes.saturating_sub(64)),
+    })
+}
+
+/// Document ID of key `index`.
+fn key(index: u64) -> String { format!("user{:012}", index) }
+
+/// Creates a store and loads the dataset, returning the collection and the load throughput.
+async fn load(dataset: Dataset, root: &std::path::Path) -> (Store, Arc<Collection>, f64) {
+    let mut wal_config = StoreWalConfig::default();
+    wal_config.default_collection_config.durability = dataset.durability;
+    let passphrase = dataset.signing.then_some(PASSPHRASE);
+    let store = Store::new_with_config(root, passphrase, wal_config)
+        .await
+        .unwrap();
+    let collection = store.collection("usertable").await.unwrap();
+    collection
+        .create_index("score", IndexKind::Ordered)
+        .await
+        .unwrap();
+
+    let mut rng = StdRng::seed_from_u64(dataset.documents);
+    let started = Instant::now();
+    let mut next = 0;
+    while next < dataset.documents {
+        let end = (next + LOAD_BATCH_SIZE as u64).min(dataset.documents);
+        let batch: Vec<(String, Value)> = (next .. end)
+            .map(|index| {
+                (
+                    key(index),
+                    document(index, dataset.document_bytes, &mut rng, dataset.documents),
+                )
+            })
+            .collect();
+        collection
+            .bulk_insert(
+                batch
+                    .iter()
+                    .map(|(id, data)| (id.as_str(), data.clone()))
+                    .collect(),
+            )
+            .await
+            .unwrap();
+        next = end;
+    }
+    let throughput = dataset.documents as f64 / started.elapsed().as_secs_f64();
+    (store, collection, throughput)
+}
+
+/// Runs `operations` operations of `workload` from `concurrency` tasks and returns the latencies
+/// and the elapsed time.
+async fn run(
+    collection: &Arc<Collection>,
+    dataset: Dataset,
+    workload: Workload,
+    concurrency: usize,
+    operations: u64,
+    next_key: &Arc<AtomicU64>,
+) -> (Arc<Latencies>, Duration) {
+    let latencies = Arc::new(Latencies::default());
+    let zipfian = Arc::new(Zipfian::new(dataset.documents.max(1)));
+    let per_task = operations / concurrency as u64;
+
+    let started = Instant::now();
+    let tasks: Vec<_> = (0 .. concurrency)
+        .map(|task| {
+            let collection = collection.clone();
+            let latencies = latencies.clone();
+            let zipfian = zipfian.clone();
+            let next_key = next_key.clone();
+            tokio::spawn(async move {
+                let mut rng = StdRng::seed_from_u64(task as u64);
+                for _ in 0 .. per_task {
+                    let op = workload.pick(rng.gen_range(0 .. 100));
+                    let op_started = Instant::now();
+                    match op {
+                        Op::Read => {
+                            let id = key(zipfian.next(&mut rng));
+                            std::hint::black_box(collection.get(&id).await.unwrap());
+                        },
+                        Op::Update => {
+                            let id = key(zipfian.next(&mut rng));
+                            let field = json!({ "updated": rng.r#gen::<u32>() });
+                            collection.update(&id, field).await.unwrap();
+                        },
+                        Op::Insert => {
+                            let index = next_key.fetch_add(1, Ordering::Relaxed);
+                            let data = document(index, dataset.document_bytes, &mut rng, dataset.documents);
+                            collection.insert(&key(index), data).await.unwrap();
+                        },
+                        Op::Scan => {
+                            let start = rng.gen_range(0 .. dataset.documents.max(1));
+                            let query = QueryBuilder::new()
+                                .filter("score", Operator::GreaterOrEqual, json!(start))
+                                .filter("score", Operator::LessThan, json!(start + SCAN_WIDTH))
+                                .limit(SCAN_LIMIT)
+                                .build();
+                            let result = collection.query(query).await.unwrap();
+                            let documents: Vec<_> = result.documents.try_collect().await.unwrap();
+                            std::hint::black_box(documents);
+                        },
+                    }
+                    latencies.of(op).record_duration(op_started.elapsed());
+                }
+            })
+        })
+        .collect();
+    for task in tasks {
+        task.await.unwrap();
+    }
+    (latencies, started.elapsed())
+}
+
+fn main() {
+    let workloads: Vec<Workload> = env_list(
+        "SENTINEL_BENCH_WORKLOADS",
+        "read-heavy,write-heavy,scan,audit-append",
+    );
+    let document_counts: Vec<u64> = env_list("SENTINEL_BENCH_DOCUMENTS", "1000,10000");
+    let document_sizes: Vec<usize> = env_list("SENTINEL_BENCH_DOCUMENT_BYTES", "256,4096");
+    let concurrency_levels: Vec<usize> = env_list("SENTINEL_BENCH_CONCURRENCY", "1,16");
+    let durabilities: Vec<WalDurability> = env_list("SENTINEL_BENCH_DURABILITY", "flush,fdatasync");
+    let signing_modes: Vec<String> = env_list("SENTINEL_BENCH_SIGNING", "off,on");
+    let operations: u64 = std::env::var("SENTINEL_BENCH_OPERATIONS")
+        .ok()
+        .and_then(|value| value.parse().ok())
+        .unwrap_or(2000);
+
+    let runtime = tokio::runtime::Runtime::new().unwrap();
+    for &documents in &document_counts {
+        for &document_bytes in &document_sizes {
+            for &durability in &durabilities {
+                for signing in &signing_modes {
+                    let dataset = Dataset {
+                        documents,
+                        document_bytes,
+                        durability,
+                        signing: signing == "on",
+                    };
+                    runtime.block_on(sweep(dataset, &workloads, &concurrency_levels, operations));
+                }
+            }
+        }
+    }
+}
+
+/// Loads `dataset` and runs every workload at every concurrency level against it, printing one
+/// result line per run.
+async fn sweep(dataset: Dataset, workloads: &[Workload], concurrency_levels: &[usize], operations: u64) {
+    let temp_dir = tempdir().unwrap();
+    let (store, collection, load_throughput) = load(dataset, temp_dir.path()).await;
+    let next_key = Arc::new(AtomicU64::new(dataset.documents));
+
+    for &workload in workloads {
+        for &concurrency in concurrency_levels {
+            let concurrency = concurrency.max(1);
+            let (latencies, elapsed) = run(
+                &collection,
+                dataset,
+                workload,
+                concurrency,
+                operations,
+                &next_key,
+            )
+            .await;
+            let completed = operations / concurrency as u64 * concurrency as u64;
+            let result = json!({
+                "workload": workload.name,
+                "documents": dataset.documents,
+                "document_bytes": dataset.document_bytes,
+                "concurrency": concurrency,
+                "durability": dataset.durability.to_string(),
+                "signing": dataset.signing,
+                "operations": completed,
+                "elapsed_secs": elapsed.as_secs_f64(),
+                "throughput_ops_per_sec": completed as f64 / elapsed.as_secs_f64(),
+                "load_docs_per_sec": load_throughput,
+                "latency_us": {
+                    "read": latencies.read.snapshot(),
+                    "update": latencies.update.snapshot(),
+                    "insert": latencies.insert.snapshot(),
+                    "scan": latencies.scan.snapshot(),
+                },
+                // Recorded by the store since it was opened, including the load
+                "wal": store.metrics().wal,
+            });
+            println!("{}", result);
+        }
+    }
+}
@@ -0,0 +1,420 @@
+//! Aggregation pipelines computing many aggregations over groups of documents in one scan.
+
+use std::collections::BTreeMap;
+
+use serde_json::{json, Map, Value};
+
+use crate::{
+    sketches::{HyperLogLog, TDigest},
+    Aggregation,
+    Collection,
+    Document,
+    Filter,
+};
+
+/// A set of aggregations computed together in a single scan of a collection.
+///
+/// Documents matching every filter are grouped by the values of the `group_by` fields, and
+/// every aggregation is computed for every group. Without `group_by` fields, all matching
+/// documents form one group.
+///
+/// # Example
+///
+/// ```rust
+/// use sentinel_dbms::{Aggregation, AggregationPipeline, Filter};
+/// use serde_json::json;
+///
+/// let pipeline = AggregationPipeline::new()
+///     .filter(Filter::Equals("status".to_owned(), json!("paid")))
+///     .group_by("region")
+///     .aggregate("orders", Aggregation::Count)
+///     .aggregate("revenue", Aggregation::Sum("amount".to_owned()))
+///     .aggregate(
+///         "p95_amount",
+///         Aggregation::Percentile("amount".to_owned(), 95.0),
+///     );
+/// assert_eq!(pipeline.aggregations.len(), 3);
+/// ```
+#[derive(Debug, Clone, PartialEq, Default)]
+pub struct AggregationPipeline {
+    /// Filters documents must all match to be aggregated.
+    pub filters:      Vec<Filter>,
+    /// Top-level fields whose values define the groups.
+    pub group_by:     Vec<String>,
+    /// Aggregations to compute for every group, each with the name of its result.
+    pub aggregations: Vec<(String, Aggregation)>,
+}
+
+impl AggregationPipeline {
+    /// Creates an empty pipeline.
+    pub fn new() -> Self { Self::default() }
+
+    /// Adds a filter documents must match to be aggregated.
+    pub fn filter(mut self, filter: Filter) -> Self {
+        self.filters.push(filter);
+        self
+    }
+
+    /// Adds a top-level field to group documents by.
+    pub fn group_by(mut self, field: &str) -> Self {
+        self.group_by.push(field.to_owned());
+        self
+    }
+
+    /// Adds an aggregation whose result is named `name` in every group.
+    pub fn aggregate(mut self, name: &str, aggregation: Aggregation) -> Self {
+        self.aggregations.push((name.to_owned(), aggregation));
+        self
+    }
+
+    /// Returns the document fields the pipeline reads, or an empty list if it reads none.
+    pub(crate) fn fields(&self) -> Vec<String> {
+        let mut fields: Vec<String> = self
+            .group_by
+            .iter()
+            .cloned()
+            .chain(
+                self.aggregations
+                    .iter()
+                    .filter_map(|&(_, ref aggregation)| aggregation.field().map(str::to_owned)),
+            )
+            .collect();
+        fields.sort_unstable();
+        fields.dedup();
+        fields
+    }
+}
+
+impl Aggregation {
+    /// Returns the default name of the result of the aggregation, such as `count`,
+    /// `sum_amount` or `p95_latency`.
+    pub fn name(&self) -> String {
+        match *self {
+            Self::Count => "count".to_owned(),
+            Self::Sum(ref field) => format!("sum_{}", field),
+            Self::Avg(ref field) => format!("avg_{}", field),
+            Self::Min(ref field) => format!("min_{}", field),
+            Self::Max(ref field) => format!("max_{}", field),
+            Self::DistinctCount(ref field) => format!("distinct_{}", field),
+            Self::Percentile(ref field, percentile) => format!("p{}_{}", percentile, field),
+        }
+    }
+
+    /// Returns the field the aggregation reads, if any.
+    fn field(&self) -> Option<&str> {
+        match *self {
+            Self::Count => None,
+            Self::Sum(ref field) |
+            Self::Avg(ref field) |
+            Self::Min(ref field) |
+            Self::Max(ref field) |
+            Self::DistinctCount(ref field) |
+            Self::Percentile(ref field, _) => Some(field),
+        }
+    }
+}
+
+/// Partial result of one aggregation over some of the documents of a group.
+#[derive(Debug, Clone)]
+enum Accumulator {
+    /// Number of documents.
+    Count(u64),
+    /// Sum of the numeric values.
+    Sum(f64),
+    /// Sum and number of the numeric values.
+    Avg(f64, u64),
+    /// Smallest numeric value.
+    Min(Option<f64>),
+    /// Largest numeric value.
+    Max(Option<f64>),
+    /// Summary of the distinct values.
+    Distinct(HyperLogLog),
+    /// Summary of the distribution of the numeric values.
+    Percentile(TDigest),
+}
+
+impl Accumulator {
+    /// Creates the accumulator of `aggregation` before any document was seen.
+    fn new(aggregation: &Aggregation) -> Self {
+        match *aggregation {
+            Aggregation::Count => Self::Count(0),
+            Aggregation::Sum(_) => Self::Sum(0.0),
+            Aggregation::Avg(_) => Self::Avg(0.0, 0),
+            Aggregation::Min(_) => Self::Min(None),
+            Aggregation::Max(_) => Self::Max(None),
+            Aggregation::DistinctCount(_) => Self::Distinct(HyperLogLog::default()),
+            Aggregation::Percentile(..) => Self::Percentile(TDigest::default()),
+        }
+    }
+
+    /// Adds a document.
+    fn update(&mut self, aggregation: &Aggregation, doc: &Document) {
+        let field = aggregation.field().unwrap_or_default();
+        if let Self::Count(ref mut count) = *self {
+            *count = count.saturating_add(1);
+            return;
+        }
+        if let Self::Distinct(ref mut distinct) = *self {
+            if let Some(value) = doc.data().get(field).filter(|value| !value.is_null()) {
+                distinct.insert(value.to_string().as_str());
+            }
+            return;
+        }
+        let Some(value) = Collection::extract_numeric_value(doc, field)
+        else {
+            return;
+        };
+        match *self {
+            Self::Sum(ref mut sum) => *sum += value,
+            Self::Avg(ref mut sum, ref mut count) => {
+                *sum += value;
+                *count = count.saturating_add(1);
+            },
+            Self::Min(ref mut min) => *min = Some(min.map_or(value, |min| min.min(value))),
+            Self::Max(ref mut max) => *max = Some(max.map_or(value, |max| max.max(value))),
+            Self::Percentile(ref mut digest) => digest.insert(value),
+            Self::Count(_) | Self::Distinct(_) => {},
+        }
+    }
+
+    /// Adds the documents seen by another accumulator of the same aggregation.
+    fn merge(&mut self, other: Self) {
+        match (self, other) {
+            (&mut Self::Count(ref mut count), Self::Count(other)) => *count = count.saturating_add(other),
+            (&mut Self::Sum(ref mut sum), Self::Sum(other)) => *sum += other,
+            (&mut Self::Avg(ref mut sum, ref mut count), Self::Avg(other_sum, other_count)) => {
+                *sum += other_sum;
+                *count = count.saturating_add(other_count);
+            },
+            (&mut Self::Min(ref mut min), Self::Min(other)) => *min = combine_options(*min, other, f64::min),
+            (&mut Self::Max(ref mut max), Self::Max(other)) => *max = combine_options(*max, other, f64::max),
+            (&mut Self::Distinct(ref mut distinct), Self::Distinct(ref other)) => distinct.merge(other),
+            (&mut Self::Percentile(ref mut digest), Self::Percentile(ref other)) => digest.merge(other),
+            (&mut Self::Count(_), _) |
+            (&mut Self::Sum(_), _) |
+            (&mut Self::Avg(..), _) |
+            (&mut Self::Min(_), _) |
+            (&mut Self::Max(_), _) |
+            (&mut Self::Distinct(_), _) |
+            (&mut Self::Percentile(_), _) => {},
+        }
+    }
+
+    /// Returns the result of the aggregation.
+    fn finish(self, aggregation: &Aggregation) -> Value {
+        match self {
+            Self::Count(count) => json!(count),
+            Self::Sum(sum) => json!(sum),
+            Self::Avg(sum, count) => {
+                if count == 0 {
+                    Value::Null
+                }
+                else {
+                    json!(sum / count as f64)
+                }
+            },
+            Self::Min(value) | Self::Max(value) => value.map_or(Value::Null, |value| json!(value)),
+            Self::Distinct(distinct) => json!(distinct.estimate()),
+            Self::Percentile(mut digest) => {
+                let percentile = if let Aggregation::Percentile(_, percentile) = *aggregation {
+                    percentile
+                }
+                else {
+                    50.0
+                };
+                digest
+                    .quantile(percentile / 100.0)
+                    .map_or(Value::Null, |value| json!(value))
+            },
+        }
+    }
+}
+
+/// Combines two optional values with `pick`, keeping whichever is present.
+fn combine_options(left: Option<f64>, right: Option<f64>, pick: fn(f64, f64) -> f64) -> Option<f64> {
+    match (left, right) {
+        (Some(left), Some(right)) => Some(pick(left, right)),
+        (value @ Some(_), None) | (None, value) => value,
+    }
+}
+
+/// The accumulators of one group of documents.
+#[derive(Debug, Clone)]
+struct Group {
+    /// Values of the `group_by` fields shared by the documents of the group.
+    key:          Vec<Value>,
+    /// One accumulator per aggregation of the pipeline.
+    accumulators: Vec<Accumulator>,
+}
+
+impl Group {
+    /// Creates a group before any of its documents was seen.
+    fn new(pipeline: &AggregationPipeline, key: Vec<Value>) -> Self {
+        Self {
+            key,
+            accumulators: pipeline
+                .aggregations
+                .iter()
+                .map(|&(_, ref aggregation)| Accumulator::new(aggregation))
+                .collect(),
+        }
+    }
+}
+
+/// Partial results of a pipeline over some of the documents of a collection.
+///
+/// Tables built over disjoint sets of documents merge into the table of their union, so a scan
+/// can build one table per shard of documents in parallel.
+#[derive(Debug, Clone, Default)]
+pub(crate) struct GroupTable {
+    /// Groups by the JSON encoding of their key, which orders the results.
+    groups: BTreeMap<String, Group>,
+}
+
+impl GroupTable {
+    /// Adds a document that matches the filters of `pipeline`.
+    pub(crate) fn add(&mut self, pipeline: &AggregationPipeline, doc: &Document) {
+        let key: Vec<Value> = pipeline
+            .group_by
+            .iter()
+            .map(|field| doc.data().get(field).cloned().unwrap_or(Value::Null))
+            .collect();
+        let group = self
+            .groups
+            .entry(Value::Array(key.clone()).to_string())
+            .or_insert_with(|| Group::new(pipeline, key));
+        for (accumulator, &(_, ref aggregation)) in group
+            .accumulators
+            .iter_mut()
+            .zip(pipeline.aggregations.iter())
+        {
+            accumulator.update(aggregation, doc);
+        }
+    }
+
+    /// Adds the documents of another table built by the same pipeline.
+    pub(crate) fn merge(&mut self, other: Self) {
+        for (encoded, group) in other.groups {
+            match self.groups.entry(encoded) {
+                std::collections::btree_map::Entry::Vacant(entry) => {
+                    entry.insert(group);
+                },
+                std::collections::btree_map::Entry::Occupied(mut entry) => {
+                    for (accumulator, other) in entry
+                        .get_mut()
+                        .accumulators
+                        .iter_mut()
+                        .zip(group.accumulators)
+                    {
+                        accumulator.merge(other);
+                    }
+                },
+            }
+        }
+    }
+
+    /// Returns one JSON object per group, holding its `group_by` fields and the named result of
+    /// every aggregation, ordered by group key.
+    ///
+    /// Without `group_by` fields there is always exactly one group, even if no document matched.
+    pub(crate) fn finish(mut self, pipeline: &AggregationPipeline) -> Vec<Map<String, Value>> {
+        if pipeline.group_by.is_empty() && self.groups.is_empty() {
+            self.groups
+                .insert(String::new(), Group::new(pipeline, Vec::new()));
+        }
+        self.groups
+            .into_values()
+            .map(|group| {
+                let mut row: Map<String, Value> = pipeline.group_by.iter().cloned().zip(group.key).collect();
+                for (accumulator, &(ref name, ref aggregation)) in group
+                    .accumulators
+                    .into_iter()
+                    .zip(pipeline.aggregations.iter())
+                {
+                    row.insert(name.clone(), accumulator.finish(aggregation));
+                }
+                row
+            })
+            .collect()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    async fn create_doc(data: Value) -> Document {
+        Document::new_without_signature("test".to_owned(), data)
+            .await
+            .unwrap()
+    }
+
+    #[tokio::test]
+    async fn test_group_table_merges_partial_results() {
+        let pipeline = AggregationPipeline::new()
+            .group_by("region")
+            .aggregate("count", Aggregation::Count)
+            .aggregate("total", Aggregation::Sum("amount".to_owned()))
+            .aggregate("avg", Aggregation::Avg("amount".to_owned()))
+            .aggregate("max", Aggregation::Max("amount".to_owned()))
+            .aggregate("users", Aggregation::DistinctCount("user".to_owned()))
+            .aggregate("median", Aggregation::Percentile("amount".to_owned(), 50.0));
+
+        let mut left = GroupTable::default();
+        let mut right = GroupTable::default();
+        left.add(
+            &pipeline,
+            &create_doc(json!({"region": "eu", "amount": 10, "user": "a"})).await,
+        );
+        left.add(
+            &pipeline,
+            &create_doc(json!({"region": "us", "amount": 5, "user": "a"})).await,
+        );
+        right.add(
+            &pipeline,
+            &create_doc(json!({"region": "eu", "amount": 30, "user": "b"})).await,
+        );
+        right.add(
+            &pipeline,
+            &create_doc(json!({"region": "eu", "amount": 20, "user": "a"})).await,
+        );
+        right.add(&pipeline, &create_doc(json!({"amount": "n/a"})).await);
+        left.merge(right);
+
+        let rows = left.finish(&pipeline);
+        assert_eq!(rows.len(), 3);
+        assert_eq!(
+            Value::Object(rows[0].clone()),
+            json!({
+                "region": "eu",
+                "count": 3,
+                "total": 60.0,
+                "avg": 20.0,
+                "max": 30.0,
+                "users": 2,
+                "median": 20.0
+            })
+        );
+        assert_eq!(rows[1]["region"], json!("us"));
+        assert_eq!(rows[1]["total"], json!(5.0));
+        assert_eq!(rows[2]["region"], Value::Null);
+        assert_eq!(rows[2]["count"], json!(1));
+        assert_eq!(rows[2]["max"], Value::Null);
+    }
+
+    #[test]
+    fn test_ungrouped_pipeline_always_has_one_row() {
+        let pipeline = AggregationPipeline::new()
+            .aggregate("count", Aggregation::Count)
+            .aggregate("min", Aggregation::Min("amount".to_owned()));
+        let rows = GroupTable::default().finish(&pipeline);
+        assert_eq!(rows.len(), 1);
+        assert_eq!(rows[0]["count"], json!(0));
+        assert_eq!(rows[0]["min"], Value::Null);
+        assert_eq!(pipeline.fields(), vec!["amount".to_owned()]);
+        assert_eq!(
+            Aggregation::Percentile("latency".to_owned(), 99.9).name(),
+            "p99.9_latency"
+        );
+    }
+}
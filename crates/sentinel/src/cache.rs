@@ -0,0 +1,519 @@
+//! Bounded in-memory cache of parsed and verified documents.
+//!
+//! The cache keeps the most recently used documents of a collection, bounded by the total size of
+//! their serialized form on disk, and evicts in least-recently-used order. Every entry remembers
+//! the size, modification time and, on unix, the inode and status change time of the file it was
+//! read from; a lookup whose file no longer matches is treated as a miss, so documents edited
+//! directly on disk are picked up again. Document writes replace the file, which always changes
+//! its inode. Elsewhere, an edit that keeps the file size and lands within the same timestamp
+//! tick as the cached read can go unnoticed until the entry is evicted or invalidated.
+//!
+//! A reader takes the [`CacheGeneration`] of a document before reading its file, and the document
+//! is only cached if it was not invalidated in between, so a read racing with a write never puts
+//! the document it read back after the writer dropped it.
+//!
+//! Entries also record which verification checks were proven by a strict verification, so a hit
+//! only re-runs the checks the cached document has not passed yet.
+
+use std::{
+    collections::{hash_map::DefaultHasher, BTreeMap, HashMap},
+    hash::{Hash as _, Hasher as _},
+    sync::{
+        atomic::{AtomicU64, Ordering},
+        Mutex,
+    },
+    time::SystemTime,
+};
+
+use serde::{Deserialize, Serialize};
+use tracing::trace;
+
+use crate::{Document, VerificationMode, VerificationOptions};
+
+/// Mask selecting the generation counter of a document ID, one less than their number.
+///
+/// IDs sharing a counter only cause an insert to be skipped after an unrelated invalidation.
+const CACHE_GENERATION_MASK: u64 = 1023;
+
+/// Counters describing the state and effectiveness of a collection's document cache.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, Serialize, Deserialize)]
+pub struct CacheStats {
+    /// Number of lookups answered from the cache.
+    pub hits:           u64,
+    /// Number of lookups that had to read the document from disk.
+    pub misses:         u64,
+    /// Number of entries evicted to stay within the size bound.
+    pub evictions:      u64,
+    /// Number of documents currently cached.
+    pub entries:        u64,
+    /// Total serialized size in bytes of the cached documents.
+    pub size_bytes:     u64,
+    /// Maximum total size in bytes of the cached documents.
+    pub capacity_bytes: u64,
+}
+
+/// Size, modification time and identity of the file a cached document was read from.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct FileFingerprint {
+    /// File length in bytes.
+    pub len:      u64,
+    /// Last modification time, if the platform reports one.
+    pub modified: Option<SystemTime>,
+    /// Inode number and status change time in seconds and nanoseconds, which change when the
+    /// file is replaced; unix only.
+    pub identity: Option<(u64, i64, i64)>,
+}
+
+impl FileFingerprint {
+    /// Builds the fingerprint of a file from its metadata.
+    pub fn from_metadata(metadata: &std::fs::Metadata) -> Self {
+        #[cfg(unix)]
+        let identity = {
+            use std::os::unix::fs::MetadataExt as _;
+            Some((metadata.ino(), metadata.ctime(), metadata.ctime_nsec()))
+        };
+        #[cfg(not(unix))]
+        let identity = None;
+
+        Self {
+            len: metadata.len(),
+            modified: metadata.modified().ok(),
+            identity,
+        }
+    }
+}
+
+/// Generation of a document ID in the cache, taken before reading its file and checked when the
+/// document read is inserted.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct CacheGeneration {
+    /// Index of the generation counter of the ID.
+    slot:  usize,
+    /// Value of the counter when the generation was taken.
+    value: u64,
+}
+
+/// Verification checks a cached document is known to pass.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub struct VerifiedChecks {
+    /// The stored hash matches the document data.
+    pub hash:      bool,
+    /// The signature is valid for the stored hash.
+    pub signature: bool,
+}
+
+impl VerifiedChecks {
+    /// Returns the checks proven by a successful verification with `options`.
+    ///
+    /// Only strict checks prove anything, as warn and silent modes let failures through.
+    pub fn proven_by(options: &VerificationOptions) -> Self {
+        Self {
+            hash:      options.verify_hash && options.hash_verification_mode == VerificationMode::Strict,
+            signature: options.verify_signature && options.signature_verification_mode == VerificationMode::Strict,
+        }
+    }
+
+    /// Returns the options still needed on top of these checks to satisfy `options`.
+    ///
+    /// The empty-signature policy is cheap and always re-applied, so it is left untouched.
+    pub fn remaining(self, options: &VerificationOptions) -> VerificationOptions {
+        VerificationOptions {
+            verify_hash: options.verify_hash && !self.hash,
+            verify_signature: options.verify_signature && !self.signature,
+            ..*options
+        }
+    }
+
+    /// Combines the checks of two successful verifications.
+    const fn union(self, other: Self) -> Self {
+        Self {
+            hash:      self.hash || other.hash,
+            signature: self.signature || other.signature,
+        }
+    }
+}
+
+/// A cached document.
+#[derive(Debug)]
+struct CacheEntry {
+    /// The parsed document.
+    document:    Document,
+    /// Fingerprint of the file the document was read from.
+    fingerprint: FileFingerprint,
+    /// Verification checks the document is known to pass.
+    checks:      VerifiedChecks,
+    /// Recency stamp of the last access.
+    tick:        u64,
+}
+
+/// Mutable state of the cache, guarded by a single lock.
+#[derive(Debug, Default)]
+struct CacheState {
+    /// Cached entries by document ID.
+    entries:     HashMap<String, CacheEntry>,
+    /// Document IDs ordered from least to most recently used.
+    recency:     BTreeMap<u64, String>,
+    /// Next recency stamp.
+    tick:        u64,
+    /// Total serialized size of the cached documents.
+    size_bytes:  u64,
+    /// Invalidation counters, shared by the IDs hashing to the same slot.
+    generations: Vec<u64>,
+}
+
+impl CacheState {
+    /// Returns a fresh recency stamp.
+    const fn next_tick(&mut self) -> u64 {
+        self.tick = self.tick.wrapping_add(1);
+        self.tick
+    }
+
+    /// Returns the current value of the generation counter in `slot`.
+    fn generation(&self, slot: usize) -> u64 { self.generations.get(slot).copied().unwrap_or_default() }
+
+    /// Removes the entry for `id`, returning it if present.
+    fn remove(&mut self, id: &str) -> Option<CacheEntry> {
+        let entry = self.entries.remove(id)?;
+        self.recency.remove(&entry.tick);
+        self.size_bytes = self.size_bytes.saturating_sub(entry.fingerprint.len);
+        Some(entry)
+    }
+}
+
+/// Least-recently-used cache of documents bounded by their serialized size.
+#[derive(Debug)]
+pub struct DocumentCache {
+    /// Maximum total serialized size of the cached documents.
+    capacity_bytes: u64,
+    /// Entries and recency order.
+    state:          Mutex<CacheState>,
+    /// Number of lookups answered from the cache.
+    hits:           AtomicU64,
+    /// Number of lookups that missed.
+    misses:         AtomicU64,
+    /// Number of entries evicted to stay within the size bound.
+    evictions:      AtomicU64,
+}
+
+impl DocumentCache {
+    /// Creates an empty cache holding at most `capacity_bytes` of serialized documents.
+    pub fn new(capacity_bytes: u64) -> Self {
+        Self {
+            capacity_bytes,
+            state: Mutex::new(CacheState {
+                generations: vec![0; (CACHE_GENERATION_MASK as usize).saturating_add(1)],
+                ..CacheState::default()
+            }),
+            hits: AtomicU64::new(0),
+            misses: AtomicU64::new(0),
+            evictions: AtomicU64::new(0),
+        }
+    }
+
+    /// Returns the index of the generation counter of `id`.
+    fn generation_slot(id: &str) -> usize {
+        let mut hasher = DefaultHasher::new();
+        id.hash(&mut hasher);
+        usize::try_from(hasher.finish() & CACHE_GENERATION_MASK).unwrap_or_default()
+    }
+
+    /// Returns the current generation of `id`, to be taken before its file is read and passed to
+    /// [`Self::insert`].
+    pub fn generation(&self, id: &str) -> CacheGeneration {
+        let slot = Self::generation_slot(id);
+        CacheGeneration {
+            slot,
+            value: self.state.lock().unwrap().generation(slot),
+        }
+    }
+
+    /// Looks up `id`, returning the cached document and its proven checks if the file it was read
+    /// from still has the given fingerprint. A stale entry is dropped.
+    pub fn lookup(&self, id: &str, fingerprint: FileFingerprint) -> Option<(Document, VerifiedChecks)> {
+        let mut state = self.state.lock().unwrap();
+        let tick = state.next_tick();
+        let found = match state.entries.get_mut(id) {
+            Some(entry) if entry.fingerprint == fingerprint => {
+                let previous = entry.tick;
+                entry.tick = tick;
+                Some((previous, entry.document.clone(), entry.checks))
+            },
+            Some(_) => {
+                trace!("Cached document {} is stale, dropping it", id);
+                state.remove(id);
+                None
+            },
+            None => None,
+        };
+
+        match found {
+            Some((previous, document, checks)) => {
+                state.recency.remove(&previous);
+                state.recency.insert(tick, id.to_owned());
+                drop(state);
+                self.hits.fetch_add(1, Ordering::Relaxed);
+                Some((document, checks))
+            },
+            None => {
+                drop(state);
+                self.misses.fetch_add(1, Ordering::Relaxed);
+                None
+            },
+        }
+    }
+
+    /// Caches `document` as read from a file with the given fingerprint, evicting the least
+    /// recently used entries as needed.
+    ///
+    /// Documents larger than the whole cache are not cached, nor documents invalidated since
+    /// `generation` was taken, as the file they were read from may have been replaced since.
+    pub fn insert(
+        &self,
+        document: Document,
+        fingerprint: FileFingerprint,
+        checks: VerifiedChecks,
+        generation: CacheGeneration,
+    ) {
+        if fingerprint.len > self.capacity_bytes {
+            return;
+        }
+
+        let id = document.id().to_owned();
+        let mut state = self.state.lock().unwrap();
+        if state.generation(generation.slot) != generation.value {
+            drop(state);
+            trace!(
+                "Document {} was invalidated while it was read, not caching it",
+                id
+            );
+            return;
+        }
+        state.remove(&id);
+        let tick = state.next_tick();
+        state.size_bytes = state.size_bytes.saturating_add(fingerprint.len);
+        state.recency.insert(tick, id.clone());
+        state.entries.insert(
+            id,
+            CacheEntry {
+                document,
+                fingerprint,
+                checks,
+                tick,
+            },
+        );
+
+        let mut evicted = 0_u64;
+        while state.size_bytes > self.capacity_bytes {
+            let Some((_, oldest)) = state.recency.pop_first()
+            else {
+                break;
+            };
+            if let Some(entry) = state.entries.remove(&oldest) {
+                state.size_bytes = state.size_bytes.saturating_sub(entry.fingerprint.len);
+                evicted = evicted.saturating_add(1);
+            }
+        }
+        drop(state);
+
+        if evicted > 0 {
+            trace!("Evicted {} documents from cache", evicted);
+            self.evictions.fetch_add(evicted, Ordering::Relaxed);
+        }
+    }
+
+    /// Records that the cached document `id` passed further verification checks, as long as it
+    /// still comes from a file with the given fingerprint.
+    pub fn mark_verified(&self, id: &str, fingerprint: FileFingerprint, checks: VerifiedChecks) {
+        let mut state = self.state.lock().unwrap();
+        if let Some(entry) = state.entries.get_mut(id) &&
+            entry.fingerprint == fingerprint
+        {
+            entry.checks = entry.checks.union(checks);
+        }
+    }
+
+    /// Drops the cached copy of `id`, if any, and keeps copies read before from being inserted.
+    pub fn invalidate(&self, id: &str) {
+        let slot = Self::generation_slot(id);
+        let mut state = self.state.lock().unwrap();
+        state.remove(id);
+        if let Some(generation) = state.generations.get_mut(slot) {
+            *generation = generation.wrapping_add(1);
+        }
+    }
+
+    /// Returns the current cache counters.
+    pub fn stats(&self) -> CacheStats {
+        let state = self.state.lock().unwrap();
+        CacheStats {
+            hits:           self.hits.load(Ordering::Relaxed),
+            misses:         self.misses.load(Ordering::Relaxed),
+            evictions:      self.evictions.load(Ordering::Relaxed),
+            entries:        state.entries.len() as u64,
+            size_bytes:     state.size_bytes,
+            capacity_bytes: self.capacity_bytes,
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use serde_json::json;
+
+    use super::*;
+
+    async fn document(id: &str) -> Document {
+        Document::new_without_signature(id.to_owned(), json!({"id": id}))
+            .await
+            .unwrap()
+    }
+
+    fn fingerprint(len: u64) -> FileFingerprint {
+        FileFingerprint {
+            len,
+            modified: Some(SystemTime::UNIX_EPOCH),
+            identity: None,
+        }
+    }
+
+    #[tokio::test]
+    async fn test_lookup_hit_and_stale_miss() {
+        let cache = DocumentCache::new(1024);
+        cache.insert(
+            document("a").await,
+            fingerprint(10),
+            VerifiedChecks::default(),
+            cache.generation("a"),
+        );
+
+        assert!(cache.lookup("a", fingerprint(10)).is_some());
+        // A different file size means the document changed on disk
+        assert!(cache.lookup("a", fingerprint(11)).is_none());
+        assert!(cache.lookup("a", fingerprint(10)).is_none());
+
+        let stats = cache.stats();
+        assert_eq!(stats.hits, 1);
+        assert_eq!(stats.misses, 2);
+        assert_eq!(stats.entries, 0);
+        assert_eq!(stats.size_bytes, 0);
+    }
+
+    #[tokio::test]
+    async fn test_evicts_least_recently_used_within_bound() {
+        let cache = DocumentCache::new(30);
+        for id in ["a", "b", "c"] {
+            cache.insert(
+                document(id).await,
+                fingerprint(10),
+                VerifiedChecks::default(),
+                cache.generation(id),
+            );
+        }
+        // Touch "a" so "b" becomes the least recently used entry
+        assert!(cache.lookup("a", fingerprint(10)).is_some());
+
+        cache.insert(
+            document("d").await,
+            fingerprint(10),
+            VerifiedChecks::default(),
+            cache.generation("d"),
+        );
+
+        assert!(cache.lookup("b", fingerprint(10)).is_none());
+        assert!(cache.lookup("a", fingerprint(10)).is_some());
+        assert!(cache.lookup("d", fingerprint(10)).is_some());
+        let stats = cache.stats();
+        assert_eq!(stats.evictions, 1);
+        assert_eq!(stats.size_bytes, 30);
+
+        // Documents larger than the cache are never stored
+        cache.insert(
+            document("e").await,
+            fingerprint(31),
+            VerifiedChecks::default(),
+            cache.generation("e"),
+        );
+        assert!(cache.lookup("e", fingerprint(31)).is_none());
+    }
+
+    #[tokio::test]
+    async fn test_verified_checks_accumulate() {
+        let cache = DocumentCache::new(1024);
+        cache.insert(
+            document("a").await,
+            fingerprint(10),
+            VerifiedChecks::default(),
+            cache.generation("a"),
+        );
+        cache.mark_verified(
+            "a",
+            fingerprint(10),
+            VerifiedChecks::proven_by(&VerificationOptions::default()),
+        );
+
+        let (_, checks) = cache.lookup("a", fingerprint(10)).unwrap();
+        assert!(checks.hash);
+        assert!(checks.signature);
+
+        let remaining = checks.remaining(&VerificationOptions::default());
+        assert!(!remaining.verify_hash);
+        assert!(!remaining.verify_signature);
+
+        let warn_only = VerificationOptions::warn();
+        assert!(!VerifiedChecks::proven_by(&warn_only).hash);
+    }
+
+    #[tokio::test]
+    async fn test_invalidate_removes_entry() {
+        let cache = DocumentCache::new(1024);
+        cache.insert(
+            document("a").await,
+            fingerprint(10),
+            VerifiedChecks::default(),
+            cache.generation("a"),
+        );
+        cache.invalidate("a");
+        assert!(cache.lookup("a", fingerprint(10)).is_none());
+        assert_eq!(cache.stats().entries, 0);
+    }
+
+    #[tokio::test]
+    async fn test_insert_after_invalidation_is_skipped() {
+        let cache = DocumentCache::new(1024);
+        let generation = cache.generation("a");
+        cache.invalidate("a");
+        cache.insert(
+            document("a").await,
+            fingerprint(10),
+            VerifiedChecks::default(),
+            generation,
+        );
+        assert_eq!(cache.stats().entries, 0);
+
+        cache.insert(
+            document("a").await,
+            fingerprint(10),
+            VerifiedChecks::default(),
+            cache.generation("a"),
+        );
+        assert!(cache.lookup("a", fingerprint(10)).is_some());
+    }
+
+    #[tokio::test]
+    async fn test_replaced_file_does_not_match() {
+        let cache = DocumentCache::new(1024);
+        let replaced = |inode| {
+            FileFingerprint {
+                identity: Some((inode, 0, 0)),
+                ..fingerprint(10)
+            }
+        };
+        cache.insert(
+            document("a").await,
+            replaced(1),
+            VerifiedChecks::default(),
+            cache.generation("a"),
+        );
+        assert!(cache.lookup("a", replaced(2)).is_none());
+    }
+}
@@ -1,8 +1,19 @@
-use futures::TryStreamExt as _;
-use serde_json::{json, Value};
+use std::sync::Arc;
+
+use futures::{Stream, StreamExt as _, TryStreamExt as _};
+use serde_json::{Map, Value};
 use tracing::{debug, trace};
 
-use crate::{filtering::matches_filters, Document, Result};
+use crate::{
+    aggregation::{AggregationPipeline, GroupTable},
+    constants::AGGREGATION_CHUNK_SIZE,
+    filtering::FilterPlan,
+    metrics::Operation,
+    streaming::ScanOptions,
+    Document,
+    Result,
+    SentinelError,
+};
 use super::coll::Collection;
 
 #[allow(
@@ -18,6 +29,11 @@ impl Collection {
     /// - `Avg(field)`: Average of numeric values in the specified field
     /// - `Min(field)`: Minimum value in the specified field
     /// - `Max(field)`: Maximum value in the specified field
+    /// - `DistinctCount(field)`: Estimated number of distinct values in the specified field
+    /// - `Percentile(field, p)`: Estimated `p`th percentile of numeric values in the field
+    ///
+    /// To compute several aggregations, or aggregations per group, use
+    /// [`Self::aggregate_pipeline`], which reads the collection only once.
     ///
     /// # Arguments
     ///
@@ -55,71 +71,172 @@ impl Collection {
     pub async fn aggregate(&self, filters: Vec<crate::Filter>, aggregation: crate::Aggregation) -> Result<Value> {
         trace!("Performing aggregation: {:?}", aggregation);
 
-        // Get all documents (we'll filter them)
-        let mut stream = self.all();
+        let name = aggregation.name();
+        let pipeline = AggregationPipeline {
+            filters,
+            group_by: Vec::new(),
+            aggregations: vec![(name.clone(), aggregation)],
+        };
+        let result = self
+            .run_pipeline(&pipeline, &crate::VerificationOptions::default())
+            .await?
+            .into_iter()
+            .next()
+            .and_then(|mut row| row.remove(&name))
+            .unwrap_or(Value::Null);
 
-        let mut count = 0usize;
-        let mut sum = 0.0f64;
-        let mut min = f64::INFINITY;
-        let mut max = f64::NEG_INFINITY;
-        let mut numeric_count = 0usize;
+        debug!("Aggregation result: {}", result);
+        Ok(result)
+    }
 
-        while let Some(doc) = stream.try_next().await? {
-            // Apply filters
-            if !filters.is_empty() {
-                let filter_refs: Vec<&crate::Filter> = filters.iter().collect();
-                if !matches_filters(&doc, &filter_refs) {
-                    continue;
-                }
-            }
+    /// Computes every aggregation of a pipeline, per group, in a single scan of the collection.
+    ///
+    /// Documents are read by the concurrent scan pipeline, strictly verified, and accumulated in
+    /// shards of [`AGGREGATION_CHUNK_SIZE`] documents on the runtime's worker threads; the
+    /// partial results of the shards are then merged. Distinct counts are estimated with
+    /// HyperLogLog, within about 2%, and percentiles with a t-digest, which is most accurate
+    /// towards both ends of the distribution. Both use bounded memory per group.
+    ///
+    /// # Arguments
+    ///
+    /// * `pipeline` - The filters, `group_by` fields and aggregations to compute.
+    ///
+    /// # Returns
+    ///
+    /// Returns one JSON object per group, ordered by group key, holding the `group_by` fields of
+    /// the group and the named result of every aggregation. Without `group_by` fields, exactly one
+    /// object is returned.
+    ///
+    /// # Example
+    ///
+    /// ```rust
+    /// use sentinel_dbms::{Aggregation, AggregationPipeline, Store};
+    /// use serde_json::json;
+    ///
+    /// # async fn example() -> sentinel_dbms::Result<()> {
+    /// let store = Store::new("/path/to/data", None).await?;
+    /// let collection = store.collection("orders").await?;
+    /// collection.insert("order-1", json!({"region": "eu", "amount": 10})).await?;
+    /// collection.insert("order-2", json!({"region": "eu", "amount": 30})).await?;
+    /// collection.insert("order-3", json!({"region": "us", "amount": 5})).await?;
+    ///
+    /// let pipeline = AggregationPipeline::new()
+    ///     .group_by("region")
+    ///     .aggregate("orders", Aggregation::Count)
+    ///     .aggregate("revenue", Aggregation::Sum("amount".to_owned()))
+    ///     .aggregate("largest", Aggregation::Max("amount".to_owned()));
+    /// let groups = collection.aggregate_pipeline(&pipeline).await?;
+    /// assert_eq!(groups[0], json!({"region": "eu", "orders": 2, "revenue": 40.0, "largest": 30.0}));
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub async fn aggregate_pipeline(&self, pipeline: &AggregationPipeline) -> Result<Vec<Value>> {
+        self.aggregate_pipeline_with_verification(pipeline, &crate::VerificationOptions::default())
+            .await
+    }
 
-            count = count.saturating_add(1);
+    /// Computes every aggregation of a pipeline, per group, with custom verification options.
+    ///
+    /// With verification disabled, only the fields the pipeline filters, groups or aggregates on
+    /// are decoded from each document file. See [`Self::aggregate_pipeline`] for the results.
+    ///
+    /// # Arguments
+    ///
+    /// * `pipeline` - The filters, `group_by` fields and aggregations to compute.
+    /// * `options` - Verification options controlling hash and signature verification.
+    ///
+    /// # Returns
+    ///
+    /// Returns one JSON object per group, or a `SentinelError` if a document cannot be read or
+    /// fails verification.
+    pub async fn aggregate_pipeline_with_verification(
+        &self,
+        pipeline: &AggregationPipeline,
+        options: &crate::VerificationOptions,
+    ) -> Result<Vec<Value>> {
+        trace!(
+            "Running aggregation pipeline with {} aggregations grouped by {:?}",
+            pipeline.aggregations.len(),
+            pipeline.group_by
+        );
+        let rows = self.run_pipeline(pipeline, options).await?;
+        debug!("Aggregation pipeline produced {} groups", rows.len());
+        Ok(rows.into_iter().map(Value::Object).collect())
+    }
 
-            // Extract value for field-based aggregations
-            if let crate::Aggregation::Sum(ref field) |
-            crate::Aggregation::Avg(ref field) |
-            crate::Aggregation::Min(ref field) |
-            crate::Aggregation::Max(ref field) = aggregation &&
-                let Some(value) = Self::extract_numeric_value(&doc, field)
-            {
-                sum += value;
-                min = min.min(value);
-                max = max.max(value);
-                numeric_count = numeric_count.checked_add(1).unwrap_or(numeric_count);
-            }
-        }
+    /// Scans the documents matching the filters of `pipeline` and returns its rows.
+    async fn run_pipeline(
+        &self,
+        pipeline: &AggregationPipeline,
+        options: &crate::VerificationOptions,
+    ) -> Result<Vec<Map<String, Value>>> {
+        let _timer = self.metrics.time(Operation::Aggregate);
+        let plan = Arc::new(FilterPlan::compile(&pipeline.filters));
 
-        let result = match aggregation {
-            crate::Aggregation::Count => json!(count),
-            crate::Aggregation::Sum(_) => json!(sum),
-            crate::Aggregation::Avg(_) => {
-                if numeric_count == 0 {
-                    json!(null)
-                }
-                else {
-                    json!(sum / numeric_count as f64)
-                }
-            },
-            crate::Aggregation::Min(_) => {
-                if min == f64::INFINITY {
-                    json!(null)
-                }
-                else {
-                    json!(min)
-                }
-            },
-            crate::Aggregation::Max(_) => {
-                if max == f64::NEG_INFINITY {
-                    json!(null)
-                }
-                else {
-                    json!(max)
-                }
+        // Resolve candidate IDs from the secondary indexes, if any filter can be served by one
+        let candidate_ids = self.index_candidates(&plan);
+        let from_index = candidate_ids.is_some();
+        let id_stream = match candidate_ids {
+            Some(ids) => {
+                Box::pin(tokio_stream::iter(ids.into_iter().map(Ok)))
+                    as std::pin::Pin<Box<dyn Stream<Item = Result<String>> + Send>>
             },
+            None => self.list(),
         };
+        let id_stream = self.metrics.count_scanned(id_stream);
 
-        debug!("Aggregation result: {}", result);
-        Ok(result)
+        let scan = ScanOptions::unordered();
+        // Without verification, documents are filtered while only the fields the pipeline reads
+        // are decoded
+        let lazy = !options.verify_hash && !options.verify_signature;
+        let documents = if lazy {
+            let fields = pipeline.fields();
+            self.load_matching(
+                id_stream,
+                plan.clone(),
+                (!fields.is_empty()).then(|| Arc::from(fields)),
+                scan,
+                from_index,
+            )
+        }
+        else {
+            self.load_documents(id_stream, options, scan, from_index)
+        };
+
+        let shared = Arc::new(pipeline.clone());
+        let partials = documents
+            .ready_chunks(AGGREGATION_CHUNK_SIZE)
+            .map(|chunk| {
+                let pipeline = shared.clone();
+                let plan = plan.clone();
+                async move {
+                    tokio::spawn(async move {
+                        let mut table = GroupTable::default();
+                        for doc in chunk {
+                            let doc = doc?;
+                            if lazy || plan.matches(&doc) {
+                                table.add(&pipeline, &doc);
+                            }
+                        }
+                        Ok::<_, SentinelError>(table)
+                    })
+                    .await
+                    .map_err(|e| {
+                        SentinelError::Internal {
+                            message: format!("Aggregation task failed: {}", e),
+                        }
+                    })?
+                }
+            })
+            .buffer_unordered(scan.concurrency.max(1));
+
+        let table = partials
+            .try_fold(GroupTable::default(), |mut table, partial| {
+                table.merge(partial);
+                std::future::ready(Ok(table))
+            })
+            .await?;
+        Ok(table.finish(pipeline))
     }
 
     /// Extracts a numeric value from a document field for aggregation operations.
@@ -1,11 +1,14 @@
-use std::{path::PathBuf, sync::Arc};
+use std::{
+    path::{Path, PathBuf},
+    sync::Arc,
+};
 
-use tokio::fs as tokio_fs;
 use tracing::{debug, warn};
 use sentinel_wal::WalManager;
 
 use crate::{
-    constants::COLLECTION_METADATA_FILE,
+    constants::{COLLECTION_METADATA_FILE, DELETED_DIR},
+    layout::SHARD_LEVELS,
     metadata::CollectionMetadata,
     validation::is_valid_document_id_chars,
     Result,
@@ -25,7 +28,8 @@ use crate::{
 /// - `{collection_name}/` - Root directory for the collection
 /// - `{collection_name}/{id}.json` - Individual document files with embedded metadata
 /// - `{collection_name}/.deleted/` - Soft-deleted documents (for recovery)
-/// - `{collection_name}/.metadata.json` - Collection metadata and indices (future)
+/// - `{collection_name}/.metadata.json` - Collection metadata and index definitions
+/// - `{collection_name}/.indexes.json` - Persisted secondary index entries
 ///
 /// # Streaming Operations
 ///
@@ -95,12 +99,34 @@ pub struct Collection {
     pub(crate) total_documents:    std::sync::Arc<std::sync::atomic::AtomicU64>,
     /// Total size of all documents in the collection in bytes.
     pub(crate) total_size_bytes:   std::sync::Arc<std::sync::atomic::AtomicU64>,
-    /// Event sender for notifying the store of metadata changes.
-    pub(crate) event_sender:       Option<tokio::sync::mpsc::UnboundedSender<crate::events::StoreEvent>>,
-    /// Background task handle for processing internal events.
+    /// Bounded event sender for notifying the store of metadata changes.
+    pub(crate) event_sender:       Option<tokio::sync::mpsc::Sender<crate::events::StoreEvent>>,
+    /// Document count and size changes not yet forwarded to the store.
+    pub(crate) pending_stats:      Arc<crate::events::StatsDelta>,
+    /// Whether the statistics changed since the metadata was last written.
+    pub(crate) metadata_dirty:     Arc<std::sync::atomic::AtomicBool>,
+    /// In-memory copy of `.metadata.json`, the source of every metadata write.
+    pub(crate) metadata:           Arc<tokio::sync::Mutex<CollectionMetadata>>,
+    /// Background task handle for flushing statistics and metadata.
     pub(crate) event_task:         Option<tokio::task::JoinHandle<()>>,
     /// Whether the collection is currently in recovery mode (skip WAL logging).
     pub(crate) recovery_mode:      std::sync::atomic::AtomicBool,
+    /// Secondary indexes maintained for this collection.
+    pub(crate) indexes:            crate::index::SharedIndexes,
+    /// Optional cache of parsed and verified documents.
+    pub(crate) cache:              std::sync::OnceLock<Arc<crate::cache::DocumentCache>>,
+    /// Manifest of the documents stored in the collection directory.
+    pub(crate) manifest:           Arc<crate::manifest::DocumentManifest>,
+    /// Encoding of newly written document files.
+    pub(crate) document_encoding:  std::sync::RwLock<crate::DocumentEncoding>,
+    /// Placement of the document files, and the placement being migrated from.
+    pub(crate) layout:             std::sync::RwLock<crate::layout::LayoutState>,
+    /// Metrics of the store the collection belongs to.
+    pub(crate) metrics:            Arc<crate::metrics::StoreMetrics>,
+    /// Document files, read and written through the storage backend of the store.
+    pub(crate) files:              crate::storage::DocumentFiles,
+    /// Striped locks serializing the writers of each document.
+    pub(crate) locks:              Arc<crate::locks::DocumentLocks>,
 }
 
 #[allow(
@@ -146,48 +172,219 @@ impl Collection {
     /// may have been applied when the collection was accessed.
     pub const fn wal_config(&self) -> &sentinel_wal::CollectionWalConfig { &self.wal_config }
 
+    /// Returns whether the documents and WAL entries of this collection are encrypted at rest.
+    ///
+    /// See [`Store::encrypted_collection`](crate::Store::encrypted_collection).
+    pub const fn is_encrypted(&self) -> bool { self.files.is_encrypted() }
+
+    /// Enables an in-memory cache of parsed and verified documents for this collection.
+    ///
+    /// The cache serves every holder of the shared collection handle, and enabling it again
+    /// keeps the cache already in place. It holds at most `max_bytes` of serialized documents,
+    /// evicting the least recently used ones first. Cached documents are dropped on `insert`,
+    /// `update`, `upsert` and `delete`, and whenever the size, modification time or, on unix,
+    /// inode of their file changes, so direct edits on disk are still picked up. A cache hit only
+    /// re-runs the verification checks the cached document has not already passed in strict
+    /// mode.
+    ///
+    /// # Example
+    ///
+    /// ```rust
+    /// use sentinel_dbms::Store;
+    /// use serde_json::json;
+    ///
+    /// # async fn example() -> sentinel_dbms::Result<()> {
+    /// let store = Store::new("/path/to/data", None).await?;
+    /// let policies = store.collection("policies").await?.with_cache(64 * 1024 * 1024);
+    ///
+    /// policies.insert("default", json!({"allow": true})).await?;
+    /// policies.get("default").await?; // read from disk
+    /// policies.get("default").await?; // served from the cache
+    ///
+    /// let stats = policies.cache_stats().unwrap();
+    /// assert_eq!(stats.hits, 1);
+    /// # Ok(())
+    /// # }
+    /// ```
+    #[must_use]
+    pub fn with_cache(self: Arc<Self>, max_bytes: u64) -> Arc<Self> {
+        if self
+            .cache
+            .set(Arc::new(crate::cache::DocumentCache::new(max_bytes)))
+            .is_err()
+        {
+            debug!(
+                "Document cache of collection {} already enabled",
+                self.name()
+            );
+        }
+        self
+    }
+
+    /// Returns the document cache counters, or `None` if caching is not enabled.
+    pub fn cache_stats(&self) -> Option<crate::CacheStats> { self.cache.get().map(|cache| cache.stats()) }
+
+    /// Drops the cached copy of a document after it has been written or deleted.
+    pub(crate) fn invalidate_cached(&self, id: &str) {
+        if let Some(cache) = self.cache.get() {
+            cache.invalidate(id);
+        }
+    }
+
+    /// Returns a lightweight handle to this collection for reading documents from detached
+    /// streams.
+    ///
+    /// The handle shares the path, signing key and indexes but has no WAL manager, event
+    /// channel, pending statistics or background task, so it must only be used to read and
+    /// verify documents.
+    pub(crate) fn read_view(&self) -> Self {
+        Self {
+            path:               self.path.clone(),
+            signing_key:        self.signing_key.clone(),
+            wal_manager:        None,
+            stored_wal_config:  self.stored_wal_config.clone(),
+            wal_config:         self.wal_config.clone(),
+            created_at:         self.created_at,
+            updated_at:         std::sync::RwLock::new(self.updated_at()),
+            last_checkpoint_at: std::sync::RwLock::new(self.last_checkpoint_at()),
+            total_documents:    self.total_documents.clone(),
+            total_size_bytes:   self.total_size_bytes.clone(),
+            event_sender:       None,
+            pending_stats:      Arc::default(),
+            metadata_dirty:     Arc::default(),
+            metadata:           self.metadata.clone(),
+            event_task:         None,
+            recovery_mode:      std::sync::atomic::AtomicBool::new(false),
+            indexes:            self.indexes.clone(),
+            cache:              self.cache.clone(),
+            manifest:           self.manifest.clone(),
+            document_encoding:  std::sync::RwLock::new(self.document_encoding()),
+            layout:             std::sync::RwLock::new(*self.layout.read().unwrap()),
+            metrics:            self.metrics.clone(),
+            files:              self.files.clone(),
+            locks:              self.locks.clone(),
+        }
+    }
+
+    /// Stops the background task of the collection without saving pending metadata.
+    ///
+    /// Used when the collection directory is being removed, so the task does not write into it.
+    pub(crate) fn discard(mut self) {
+        if let Some(task) = self.event_task.take() {
+            task.abort();
+        }
+    }
+
+    /// Closes the collection, waiting for its background task to flush the pending statistics
+    /// and metadata a last time.
+    ///
+    /// Used before the collection is reopened, so the new handle loads up to date statistics.
+    pub(crate) async fn close(mut self) {
+        let task = self.event_task.take();
+        // The task flushes and exits once it holds the last reference to the pending statistics
+        drop(self);
+        if let Some(task) = task &&
+            let Err(e) = task.await
+        {
+            warn!("Background task of a closed collection failed: {}", e);
+        }
+    }
+
     /// Saves the current collection metadata to disk.
     ///
     /// This method persists the collection's current state (document count, size, timestamps,
     /// and WAL configuration) to the `.metadata.json` file in the collection directory. This
     /// ensures that metadata remains consistent across restarts and can be used for monitoring
-    /// and optimization.
+    /// and optimization. The file is written from the in-memory copy loaded when the collection
+    /// was opened, so saving never re-reads or re-parses it.
     ///
     /// # Returns
     ///
     /// Returns `Ok(())` on success, or a `SentinelError` if the metadata cannot be saved.
     pub async fn save_metadata(&self) -> Result<()> {
-        let metadata_path = self.path.join(COLLECTION_METADATA_FILE);
-
-        // Load existing metadata to preserve other fields
-        let mut metadata = if tokio_fs::try_exists(&metadata_path).await.unwrap_or(false) {
-            let content = tokio_fs::read_to_string(&metadata_path).await?;
-            serde_json::from_str(&content)?
+        {
+            let mut metadata = self.metadata.lock().await;
+            metadata.wal_config = Some(self.stored_wal_config.clone());
+            metadata.document_encoding = self.document_encoding();
+            let layout = *self.layout.read().unwrap();
+            metadata.layout = layout.current;
+            metadata.layout_migration = layout.previous;
         }
-        else {
-            // Create new metadata if file doesn't exist
-            CollectionMetadata::new(self.name().to_owned())
-        };
-
-        // Update the runtime statistics
-        metadata.document_count = self.total_documents();
-        metadata.total_size_bytes = self.total_size_bytes();
-        metadata.updated_at = std::time::SystemTime::now()
-            .duration_since(std::time::UNIX_EPOCH)
-            .unwrap()
-            .as_secs();
-
-        // Update the WAL configuration
-        metadata.wal_config = Some(self.stored_wal_config.clone());
-
-        // Save back to disk
-        let content = serde_json::to_string_pretty(&metadata)?;
-        tokio_fs::write(&metadata_path, content).await?;
+        write_metadata(
+            &self.path,
+            &self.metadata,
+            self.total_documents(),
+            self.total_size_bytes(),
+            &self.indexes,
+            &self.files,
+        )
+        .await?;
 
         debug!("Collection metadata saved for {}", self.name());
         Ok(())
     }
 
+    /// Returns the encoding used to write document files.
+    pub fn document_encoding(&self) -> crate::DocumentEncoding { *self.document_encoding.read().unwrap() }
+
+    /// Changes the encoding used to write document files and persists it in the metadata.
+    ///
+    /// Existing files keep their encoding until they are next written; reads detect the encoding
+    /// of every file, so collections can hold files in several encodings.
+    ///
+    /// # Returns
+    ///
+    /// Returns `Ok(())` on success, or a `SentinelError` if the metadata cannot be saved.
+    pub async fn set_document_encoding(&self, encoding: crate::DocumentEncoding) -> Result<()> {
+        *self.document_encoding.write().unwrap() = encoding;
+        debug!(
+            "Document encoding of collection {} set to {}",
+            self.name(),
+            encoding
+        );
+        self.save_metadata().await
+    }
+
+    /// Returns the placement of the document files of the collection.
+    ///
+    /// During a layout migration this is the target layout, in which new files are written.
+    pub fn document_layout(&self) -> crate::DocumentLayout { self.layout.read().unwrap().current }
+
+    /// Returns the locator resolving document IDs to files under the current layout.
+    pub(crate) fn locator(&self) -> crate::layout::DocumentLocator {
+        crate::layout::DocumentLocator::new(
+            Arc::from(self.path.as_path()),
+            *self.layout.read().unwrap(),
+            self.files.clone(),
+        )
+    }
+
+    /// Returns the document files and directories to sync for the changes in `unsynced`.
+    ///
+    /// When files changed before the tracking started may not be on disk, these are the files
+    /// of every document under both layouts, the directories holding them and the `.deleted/`
+    /// directory.
+    pub(crate) async fn unsynced_paths(&self, unsynced: &crate::storage::UnsyncedFiles) -> Result<Vec<PathBuf>> {
+        let mut paths = unsynced.paths.clone();
+        if unsynced.all {
+            let locator = self.locator();
+            for id in self.manifest.document_ids().await? {
+                for path in std::iter::once(locator.path(&id)).chain(locator.previous_path(&id)) {
+                    paths.extend(
+                        path.ancestors()
+                            .skip(1)
+                            .take(SHARD_LEVELS)
+                            .map(Path::to_path_buf),
+                    );
+                    paths.insert(path);
+                }
+            }
+            paths.insert(self.path.clone());
+            paths.insert(self.path.join(DELETED_DIR));
+        }
+        Ok(paths.into_iter().collect())
+    }
+
     /// Flushes any pending metadata changes to disk immediately.
     ///
     /// This method forces a synchronous save of the collection metadata to disk,
@@ -292,175 +489,135 @@ impl Collection {
 
     /// Starts the background event processing task for the collection.
     ///
-    /// This method spawns an async task that processes internal collection events
-    /// such as metadata updates and WAL operations. The task runs in the background
-    /// and handles events sent via the event channel.
+    /// Document operations update the collection counters directly and merge their changes into
+    /// the pending statistics. The task spawned here drains them every 500ms:
+    /// - Forwarding the net change to the store as a single `StatsChanged` event
+    /// - Writing the metadata when it changed since the last write
     ///
-    /// The event processor is responsible for:
-    /// - Processing document events (insert, update, delete)
-    /// - Debounced metadata persistence (every 500ms)
-    /// - Coordinating with the store's event system
+    /// The store channel is bounded. When it is full the task waits, and operations keep merging
+    /// into the pending statistics meanwhile, so a burst of writes never queues more than one
+    /// event per collection. Once the collection is dropped the task flushes a last time and
+    /// exits.
     ///
     /// # Note
     ///
     /// This method should only be called once during collection initialization.
     /// Multiple calls will replace the previous event task.
-    #[allow(
-        clippy::integer_division_remainder_used,
-        reason = "false positive in tokio select"
-    )]
     pub fn start_event_processor(&mut self) {
-        let mut event_receiver = {
-            let (tx, rx) = tokio::sync::mpsc::unbounded_channel();
-            self.event_sender = Some(tx);
-            rx
-        };
+        if let Some(task) = self.event_task.take() {
+            task.abort();
+        }
 
         // Clone necessary fields for the background task
+        let name = self.name().to_owned();
         let path = self.path.clone();
+        let event_sender = self.event_sender.clone();
+        let pending_stats = self.pending_stats.clone();
+        let metadata_dirty = self.metadata_dirty.clone();
+        let metadata = self.metadata.clone();
         let total_documents = self.total_documents.clone();
         let total_size_bytes = self.total_size_bytes.clone();
-        let updated_at = std::sync::Arc::new(std::sync::RwLock::new(*self.updated_at.read().unwrap()));
+        let indexes = self.indexes.clone();
+        let files = self.files.clone();
 
         let task = tokio::spawn(async move {
-            // Debouncing: save metadata every 500 milliseconds instead of after every event
+            // Debouncing: flush every 500 milliseconds instead of after every operation
             let mut save_interval = tokio::time::interval(tokio::time::Duration::from_millis(500));
             save_interval.tick().await; // First tick completes immediately
 
-            let mut changed = false;
-
             loop {
-                tokio::select! {
-                    // Process events
-                    event = event_receiver.recv() => {
-                        match event {
-                            Some(crate::events::StoreEvent::CollectionCreated {
-                                ..
-                            }) => {
-                                // Collection creation is handled by the store
-                            },
-                            Some(crate::events::StoreEvent::CollectionDeleted {
-                                ..
-                            }) => {
-                                // Collection dropping is handled by the store
-                            },
-                            Some(crate::events::StoreEvent::DocumentInserted {
-                                collection,
-                                size_bytes,
-                            }) => {
-                                tracing::debug!("Processing document inserted event: {} (size: {})", collection, size_bytes);
-                                // Update atomic counters asynchronously
-                                total_documents.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
-                                total_size_bytes.fetch_add(size_bytes, std::sync::atomic::Ordering::Relaxed);
-                                changed = true;
-                            },
-                            Some(crate::events::StoreEvent::DocumentUpdated {
-                                collection,
-                                old_size_bytes,
-                                new_size_bytes,
-                            }) => {
-                                tracing::debug!("Processing document updated event: {} (old: {}, new: {})",
-                                    collection, old_size_bytes, new_size_bytes);
-                                // Update atomic counters asynchronously
-                                total_size_bytes.fetch_sub(old_size_bytes, std::sync::atomic::Ordering::Relaxed);
-                                total_size_bytes.fetch_add(new_size_bytes, std::sync::atomic::Ordering::Relaxed);
-                                changed = true;
-                            },
-                            Some(crate::events::StoreEvent::DocumentDeleted {
-                                collection,
-                                size_bytes,
-                            }) => {
-                                tracing::debug!("Processing document deleted event: {} (size: {})", collection, size_bytes);
-                                // Update atomic counters asynchronously
-                                total_documents.fetch_sub(1, std::sync::atomic::Ordering::Relaxed);
-                                total_size_bytes.fetch_sub(size_bytes, std::sync::atomic::Ordering::Relaxed);
-                                changed = true;
-                            },
-                            None => {
-                                // Channel closed, exit
-                                break;
-                            },
-                        }
+                save_interval.tick().await;
+                // The collection holds the only other reference to the pending statistics
+                let closed = Arc::strong_count(&pending_stats) == 1;
+
+                let (document_delta, size_delta) = pending_stats.take();
+                if (document_delta != 0 || size_delta != 0) &&
+                    let Some(sender) = event_sender.as_ref()
+                {
+                    let event = crate::events::StoreEvent::StatsChanged {
+                        collection: name.clone(),
+                        document_delta,
+                        size_delta,
+                    };
+                    if sender.send(event).await.is_err() {
+                        tracing::trace!(
+                            "Store event channel closed, dropping statistics of {}",
+                            name
+                        );
                     }
+                }
 
-                    // Periodic metadata save
-                    _ = save_interval.tick() => {
-                        if changed {
-                            // Update the updated_at timestamp (read lock and update)
-                            let now = chrono::Utc::now();
-                            *updated_at.write().unwrap() = now;
-
-                            // Load current values from atomic counters
-                            let document_count = total_documents.load(std::sync::atomic::Ordering::Relaxed);
-                            let size_bytes = total_size_bytes.load(std::sync::atomic::Ordering::Relaxed);
-
-                            // Load existing metadata to preserve other fields
-                            let metadata_path = path.join(crate::constants::COLLECTION_METADATA_FILE);
-                            let mut metadata = if tokio::fs::try_exists(&metadata_path).await.unwrap_or(false) {
-                                match tokio::fs::read_to_string(&metadata_path).await {
-                                    Ok(content) => match serde_json::from_str(&content) {
-                                        Ok(m) => m,
-                                        Err(e) => {
-                                            tracing::error!("Failed to parse collection metadata: {}", e);
-                                            continue;
-                                        }
-                                    },
-                                    Err(e) => {
-                                        tracing::error!("Failed to read collection metadata: {}", e);
-                                        continue;
-                                    }
-                                }
-                            } else {
-                                tracing::warn!("Collection metadata file not found, creating new");
-                                crate::CollectionMetadata::new(path.file_name().unwrap().to_str().unwrap().to_owned())
-                            };
-
-                            // Update the runtime statistics
-                            metadata.document_count = document_count;
-                            metadata.total_size_bytes = size_bytes;
-                            metadata.updated_at = std::time::SystemTime::now()
-                                .duration_since(std::time::UNIX_EPOCH)
-                                .unwrap()
-                                .as_secs();
-
-                            // Save back to disk
-                            match serde_json::to_string_pretty(&metadata) {
-                                Ok(content) => {
-                                    if let Err(e) = tokio::fs::write(&metadata_path, content).await {
-                                        tracing::error!("Failed to save collection metadata in background task: {}", e);
-                                    } else {
-                                        tracing::trace!("Collection metadata saved successfully for {:?}", path);
-                                        changed = false;
-                                    }
-                                }
-                                Err(e) => {
-                                    tracing::error!("Failed to serialize collection metadata: {}", e);
-                                }
-                            }
-                        }
+                if metadata_dirty.swap(false, std::sync::atomic::Ordering::AcqRel) {
+                    let result = write_metadata(
+                        &path,
+                        &metadata,
+                        total_documents.load(std::sync::atomic::Ordering::Relaxed),
+                        total_size_bytes.load(std::sync::atomic::Ordering::Relaxed),
+                        &indexes,
+                        &files,
+                    )
+                    .await;
+                    match result {
+                        Ok(()) => tracing::trace!("Collection metadata saved successfully for {:?}", path),
+                        Err(e) => {
+                            tracing::error!(
+                                "Failed to save collection metadata in background task: {}",
+                                e
+                            );
+                            metadata_dirty.store(true, std::sync::atomic::Ordering::Release);
+                        },
                     }
                 }
+
+                if closed {
+                    break;
+                }
             }
         });
 
         self.event_task = Some(task);
     }
 
-    /// Emits an event to the store's event system.
+    /// Records a change in document count and size made by a document operation.
     ///
-    /// This is an internal method used to notify the store of collection-level
-    /// events such as document insertions, updates, and deletions. The events
-    /// are sent asynchronously and do not block the calling operation.
-    ///
-    /// # Arguments
-    /// Emits an event to the collection's event sender.
-    ///
-    /// * `event` - The event to emit to the store.
-    pub fn emit_event(&self, event: crate::events::StoreEvent) {
-        if let Some(sender) = self.event_sender.as_ref() &&
-            let Err(e) = sender.send(event)
-        {
-            warn!("Failed to emit collection event: {}", e);
-        }
+    /// The collection counters are updated immediately. The store learns about the change on the
+    /// next flush of the event processor, merged with every other change made in between.
+    pub(crate) fn record_stats(&self, documents: i64, size_bytes: i64) {
+        crate::events::apply_delta(&self.total_documents, documents);
+        crate::events::apply_delta(&self.total_size_bytes, size_bytes);
+        self.pending_stats.record(documents, size_bytes);
+        self.metadata_dirty
+            .store(true, std::sync::atomic::Ordering::Release);
     }
 }
+
+/// Writes the in-memory metadata of the collection at `path` with its current statistics, then
+/// persists its secondary indexes.
+///
+/// The file is replaced through `files` with a temporary file renamed over it, so a crash never
+/// leaves a torn `.metadata.json`. The metadata lock is held across the write so concurrent saves
+/// cannot overwrite a newer file with older statistics.
+async fn write_metadata(
+    path: &Path,
+    metadata: &tokio::sync::Mutex<CollectionMetadata>,
+    document_count: u64,
+    total_size_bytes: u64,
+    indexes: &crate::index::SharedIndexes,
+    files: &crate::storage::DocumentFiles,
+) -> Result<()> {
+    let mut metadata = metadata.lock().await;
+    metadata.document_count = document_count;
+    metadata.total_size_bytes = total_size_bytes;
+    metadata.updated_at = std::time::SystemTime::now()
+        .duration_since(std::time::UNIX_EPOCH)
+        .unwrap()
+        .as_secs();
+    metadata.indexes = indexes.read().unwrap().definitions();
+
+    let content = serde_json::to_string_pretty(&*metadata)?;
+    files
+        .replace(&path.join(COLLECTION_METADATA_FILE), content.into_bytes())
+        .await?;
+    drop(metadata);
+    crate::index::persist_indexes(path, indexes, files).await
+}
@@ -0,0 +1,528 @@
+use std::collections::BTreeSet;
+
+use futures::StreamExt as _;
+use serde_json::Value;
+use tracing::{debug, trace, warn};
+
+use crate::{
+    filtering::FilterPlan,
+    index::{persist_indexes, IndexDefinition, IndexKind},
+    Result,
+    VerificationOptions,
+};
+use super::coll::Collection;
+
+#[allow(
+    clippy::multiple_inherent_impl,
+    reason = "multiple impl blocks for Collection are intentional for organization"
+)]
+impl Collection {
+    /// Declares a secondary index on a document field and builds it from the existing documents.
+    ///
+    /// Hash indexes accelerate `Equals` and `In` filters. Ordered indexes additionally accelerate
+    /// numeric range filters and `StartsWith`. Once declared, the index is maintained by
+    /// `insert`, `update`, `upsert` and `delete`, persisted next to the collection metadata and
+    /// used by `query` to select candidate documents before any document file is opened.
+    ///
+    /// Declaring an index on a field that is already indexed with the same kind is a no-op;
+    /// declaring it with a different kind replaces the existing index.
+    ///
+    /// # Arguments
+    ///
+    /// * `field` - The top-level field to index.
+    /// * `kind` - The kind of index to maintain.
+    ///
+    /// # Returns
+    ///
+    /// Returns `Ok(())` once the index is built and persisted, or a `SentinelError` if the
+    /// documents cannot be read or the index cannot be saved.
+    ///
+    /// # Example
+    ///
+    /// ```rust
+    /// use sentinel_dbms::{IndexKind, Operator, QueryBuilder, Store};
+    /// use serde_json::json;
+    ///
+    /// # async fn example() -> sentinel_dbms::Result<()> {
+    /// let store = Store::new("/path/to/data", None).await?;
+    /// let collection = store.collection("audit").await?;
+    ///
+    /// collection.create_index("actor", IndexKind::Hash).await?;
+    /// collection.insert("evt-1", json!({"actor": "alice"})).await?;
+    ///
+    /// // Only the documents listed in the index for "alice" are read
+    /// let query = QueryBuilder::new()
+    ///     .filter("actor", Operator::Equals, json!("alice"))
+    ///     .build();
+    /// let result = collection.query(query).await?;
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub async fn create_index(&self, field: &str, kind: IndexKind) -> Result<()> {
+        trace!(
+            "Creating {} index on field {} in collection {}",
+            kind,
+            field,
+            self.name()
+        );
+        let definition = IndexDefinition::new(field, kind);
+        if self
+            .indexes
+            .read()
+            .unwrap()
+            .definitions()
+            .contains(&definition)
+        {
+            debug!(
+                "Index {:?} already exists in collection {}",
+                definition,
+                self.name()
+            );
+            return Ok(());
+        }
+
+        self.indexes.write().unwrap().define(&definition);
+        let mut id_stream = self.list();
+        while let Some(id) = id_stream.next().await {
+            let id = id?;
+            if let Some(data) = self.read_index_data(&id).await? {
+                self.indexes
+                    .write()
+                    .unwrap()
+                    .index_document_field(field, &id, &data);
+            }
+        }
+
+        self.save_metadata().await?;
+        debug!(
+            "Index on field {} created in collection {}",
+            field,
+            self.name()
+        );
+        Ok(())
+    }
+
+    /// Removes the secondary index on a field.
+    ///
+    /// # Returns
+    ///
+    /// Returns `Ok(true)` if an index existed and was removed, `Ok(false)` otherwise.
+    pub async fn drop_index(&self, field: &str) -> Result<bool> {
+        let removed = self.indexes.write().unwrap().remove_index(field);
+        if removed {
+            self.save_metadata().await?;
+            debug!(
+                "Index on field {} dropped from collection {}",
+                field,
+                self.name()
+            );
+        }
+        Ok(removed)
+    }
+
+    /// Returns the secondary indexes declared on this collection, ordered by field name.
+    pub fn indexes(&self) -> Vec<IndexDefinition> { self.indexes.read().unwrap().definitions() }
+
+    /// Rebuilds all secondary indexes by scanning every document in the collection.
+    ///
+    /// This is done automatically when the persisted index file is missing or does not match
+    /// the declared indexes, but can also be called explicitly after modifying document files
+    /// outside of Sentinel.
+    pub async fn rebuild_indexes(&self) -> Result<()> {
+        let definitions = {
+            let mut indexes = self.indexes.write().unwrap();
+            let definitions = indexes.definitions();
+            for definition in &definitions {
+                indexes.define(definition);
+            }
+            definitions
+        };
+        if definitions.is_empty() {
+            return Ok(());
+        }
+
+        trace!(
+            "Rebuilding {} indexes of collection {}",
+            definitions.len(),
+            self.name()
+        );
+        let mut id_stream = self.list();
+        while let Some(id) = id_stream.next().await {
+            let id = id?;
+            if let Some(data) = self.read_index_data(&id).await? {
+                self.indexes.write().unwrap().index_document(&id, &data);
+            }
+        }
+
+        persist_indexes(&self.path, &self.indexes, &self.files).await?;
+        debug!("Indexes of collection {} rebuilt", self.name());
+        Ok(())
+    }
+
+    /// Re-indexes every document referenced by the WAL after recovery.
+    ///
+    /// Index entries are persisted lazily, so after a crash they may lag behind the documents
+    /// written since the last save. Every such write is recorded in the WAL, so re-indexing the
+    /// current state of the documents it references brings the indexes back in sync without a
+    /// full collection scan.
+    pub(crate) async fn rebuild_indexes_from_wal(&self) -> Result<()> {
+        let Some(wal) = self.wal_manager.as_ref()
+        else {
+            return Ok(());
+        };
+        if self.indexes.read().unwrap().is_empty() {
+            return Ok(());
+        }
+
+        let mut touched = BTreeSet::new();
+        let mut entries = std::pin::pin!(wal.stream_entries());
+        while let Some(entry) = entries.next().await {
+            match entry {
+                // Transaction markers carry no document ID
+                Ok(entry) if Self::validate_document_id(entry.document_id_str()).is_ok() => {
+                    touched.insert(entry.document_id_str().to_owned());
+                },
+                Ok(_) => {},
+                Err(e) => {
+                    warn!(
+                        "Failed to read WAL entry while rebuilding indexes of collection {}: {}",
+                        self.name(),
+                        e
+                    );
+                },
+            }
+        }
+
+        trace!(
+            "Re-indexing {} documents referenced by the WAL of collection {}",
+            touched.len(),
+            self.name()
+        );
+        for id in &touched {
+            match self.read_index_data(id).await? {
+                Some(data) => self.indexes.write().unwrap().index_document(id, &data),
+                None => self.indexes.write().unwrap().remove_document(id),
+            }
+        }
+
+        persist_indexes(&self.path, &self.indexes, &self.files).await
+    }
+
+    /// Adds or refreshes the index entries of a document after it was written.
+    pub(crate) fn index_document(&self, id: &str, data: &Value) {
+        self.indexes.write().unwrap().index_document(id, data);
+    }
+
+    /// Removes the index entries of a document after it was deleted.
+    pub(crate) fn unindex_document(&self, id: &str) { self.indexes.write().unwrap().remove_document(id); }
+
+    /// Resolves the candidate document IDs for the filters of a plan from the secondary indexes.
+    ///
+    /// Returns `None` when none of the filters can be served by an index.
+    pub(crate) fn index_candidates(&self, plan: &FilterPlan) -> Option<Vec<String>> {
+        self.indexes.read().unwrap().candidate_ids(plan.conjuncts())
+    }
+
+    /// Reads the data of a document for indexing purposes.
+    ///
+    /// Verification is skipped since indexes only preselect candidates; documents returned by
+    /// queries are still verified when they are read.
+    async fn read_index_data(&self, id: &str) -> Result<Option<Value>> {
+        Ok(self
+            .read_document(id, &VerificationOptions::disabled())
+            .await?
+            .map(|doc| doc.data))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use futures::TryStreamExt as _;
+    use serde_json::json;
+
+    use crate::{wal::ops::CollectionWalOps as _, Collection, FilterPlan, IndexKind, Operator, QueryBuilder, Store};
+
+    async fn setup_collection() -> (Store, std::sync::Arc<Collection>, tempfile::TempDir) {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let store = Store::new_with_config(
+            temp_dir.path(),
+            None,
+            sentinel_wal::StoreWalConfig::default(),
+        )
+        .await
+        .unwrap();
+        let collection = store.collection_with_config("audit", None).await.unwrap();
+        (store, collection, temp_dir)
+    }
+
+    async fn query_ids(collection: &Collection, query: crate::Query) -> Vec<String> {
+        let result = collection.query(query).await.unwrap();
+        let docs: Vec<_> = result.documents.try_collect().await.unwrap();
+        let mut ids: Vec<String> = docs.iter().map(|d| d.id().to_owned()).collect();
+        ids.sort();
+        ids
+    }
+
+    #[tokio::test]
+    async fn test_create_index_on_existing_documents() {
+        let (_store, collection, _temp_dir) = setup_collection().await;
+        collection
+            .insert("e1", json!({"actor": "alice", "level": 1}))
+            .await
+            .unwrap();
+        collection
+            .insert("e2", json!({"actor": "bob", "level": 5}))
+            .await
+            .unwrap();
+
+        collection
+            .create_index("actor", IndexKind::Hash)
+            .await
+            .unwrap();
+        assert_eq!(collection.indexes().len(), 1);
+
+        let query = QueryBuilder::new()
+            .filter("actor", Operator::Equals, json!("alice"))
+            .build();
+        assert_eq!(query_ids(&collection, query).await, vec!["e1"]);
+    }
+
+    #[tokio::test]
+    async fn test_index_maintained_by_writes() {
+        let (_store, collection, _temp_dir) = setup_collection().await;
+        collection
+            .create_index("level", IndexKind::Ordered)
+            .await
+            .unwrap();
+
+        collection.insert("e1", json!({"level": 1})).await.unwrap();
+        collection.insert("e2", json!({"level": 5})).await.unwrap();
+        collection.upsert("e3", json!({"level": 9})).await.unwrap();
+        collection.update("e1", json!({"level": 7})).await.unwrap();
+        collection.delete("e2").await.unwrap();
+
+        let query = QueryBuilder::new()
+            .filter("level", Operator::GreaterThan, json!(4))
+            .build();
+        assert_eq!(query_ids(&collection, query).await, vec!["e1", "e3"]);
+
+        let query = QueryBuilder::new()
+            .filter("level", Operator::LessThan, json!(4))
+            .build();
+        assert!(query_ids(&collection, query).await.is_empty());
+    }
+
+    #[tokio::test]
+    async fn test_indexed_query_with_sort_and_unindexed_filter() {
+        let (_store, collection, _temp_dir) = setup_collection().await;
+        collection
+            .create_index("actor", IndexKind::Hash)
+            .await
+            .unwrap();
+        collection
+            .insert("e1", json!({"actor": "alice", "level": 3}))
+            .await
+            .unwrap();
+        collection
+            .insert("e2", json!({"actor": "alice", "level": 1}))
+            .await
+            .unwrap();
+        collection
+            .insert("e3", json!({"actor": "bob", "level": 2}))
+            .await
+            .unwrap();
+
+        let query = QueryBuilder::new()
+            .filter("actor", Operator::Equals, json!("alice"))
+            .filter("level", Operator::GreaterThan, json!(1))
+            .build();
+        assert_eq!(query_ids(&collection, query).await, vec!["e1"]);
+
+        let query = QueryBuilder::new()
+            .filter("actor", Operator::Equals, json!("alice"))
+            .sort("level", crate::SortOrder::Ascending)
+            .build();
+        let result = collection.query(query).await.unwrap();
+        let docs: Vec<_> = result.documents.try_collect().await.unwrap();
+        let ids: Vec<_> = docs.iter().map(|d| d.id()).collect();
+        assert_eq!(ids, vec!["e2", "e1"]);
+    }
+
+    #[tokio::test]
+    async fn test_indexes_persist_across_reopen() {
+        let (store, collection, _temp_dir) = setup_collection().await;
+        collection
+            .create_index("actor", IndexKind::Hash)
+            .await
+            .unwrap();
+        collection
+            .insert("e1", json!({"actor": "alice"}))
+            .await
+            .unwrap();
+        collection.flush_metadata().await.unwrap();
+        drop(collection);
+        assert!(store.close_collection("audit").await.unwrap());
+
+        let reopened = store.collection_with_config("audit", None).await.unwrap();
+        assert_eq!(reopened.indexes().len(), 1);
+        assert_eq!(
+            reopened.index_candidates(&FilterPlan::compile(&[crate::Filter::Equals(
+                "actor".to_owned(),
+                json!("alice"),
+            )])),
+            Some(vec!["e1".to_owned()])
+        );
+    }
+
+    #[tokio::test]
+    async fn test_missing_index_file_is_rebuilt_on_open() {
+        let (store, collection, temp_dir) = setup_collection().await;
+        collection
+            .create_index("actor", IndexKind::Hash)
+            .await
+            .unwrap();
+        collection
+            .insert("e1", json!({"actor": "alice"}))
+            .await
+            .unwrap();
+        collection.flush_metadata().await.unwrap();
+        drop(collection);
+        assert!(store.close_collection("audit").await.unwrap());
+
+        let index_file = temp_dir
+            .path()
+            .join("data")
+            .join("audit")
+            .join(crate::COLLECTION_INDEXES_FILE);
+        tokio::fs::remove_file(&index_file).await.unwrap();
+
+        let reopened = store.collection_with_config("audit", None).await.unwrap();
+        assert_eq!(
+            reopened.index_candidates(&FilterPlan::compile(&[crate::Filter::Equals(
+                "actor".to_owned(),
+                json!("alice"),
+            )])),
+            Some(vec!["e1".to_owned()])
+        );
+    }
+
+    #[tokio::test]
+    async fn test_recovery_reindexes_wal_documents() {
+        let (_store, collection, _temp_dir) = setup_collection().await;
+        collection
+            .create_index("actor", IndexKind::Hash)
+            .await
+            .unwrap();
+        collection
+            .insert("e1", json!({"actor": "alice"}))
+            .await
+            .unwrap();
+
+        // Simulate index entries lost in a crash before they were persisted
+        collection.unindex_document("e1");
+        let alice = FilterPlan::compile(&[crate::Filter::Equals("actor".to_owned(), json!("alice"))]);
+        assert_eq!(collection.index_candidates(&alice), Some(vec![]));
+
+        collection.recover_from_wal().await.unwrap();
+        assert_eq!(
+            collection.index_candidates(&alice),
+            Some(vec!["e1".to_owned()])
+        );
+    }
+
+    /// Reads every page of `query` by following the cursor of each page, returning the IDs in
+    /// the order they were returned.
+    async fn paged_ids(collection: &Collection, query: QueryBuilder, page_size: usize) -> Vec<String> {
+        let mut ids = Vec::new();
+        let mut cursor = None;
+        loop {
+            let mut page_query = query.clone().limit(page_size);
+            if let Some(cursor) = cursor.take() {
+                page_query = page_query.after(cursor);
+            }
+            let result = collection.query(page_query.build()).await.unwrap();
+            let last = result.last.clone();
+            let docs: Vec<_> = result.documents.try_collect().await.unwrap();
+            if docs.is_empty() {
+                return ids;
+            }
+            ids.extend(docs.iter().map(|doc| doc.id().to_owned()));
+            cursor = last.lock().unwrap().clone();
+        }
+    }
+
+    #[tokio::test]
+    async fn test_sorted_query_walks_the_ordered_index_from_the_cursor() {
+        let (store, collection, _temp_dir) = setup_collection().await;
+        collection
+            .create_index("rank", IndexKind::Ordered)
+            .await
+            .unwrap();
+        for i in 0 .. 12_i32 {
+            // Missing fields, tied numbers, distinct numbers and strings, with "copy" unindexed
+            let rank = match i % 4 {
+                0 => None,
+                1 => Some(json!(5)),
+                2 => Some(json!(20_i32.saturating_sub(i))),
+                _ => Some(json!(format!("r{}", i % 3))),
+            };
+            let doc = rank.map_or_else(
+                || json!({"even": i % 2 == 0}),
+                |rank| json!({"rank": rank, "copy": rank, "even": i % 2 == 0}),
+            );
+            collection.insert(&format!("e{:02}", i), doc).await.unwrap();
+        }
+
+        for order in [crate::SortOrder::Ascending, crate::SortOrder::Descending] {
+            let indexed = paged_ids(&collection, QueryBuilder::new().sort("rank", order), 5).await;
+            let scanned = paged_ids(&collection, QueryBuilder::new().sort("copy", order), 5).await;
+            assert_eq!(indexed, scanned);
+            assert_eq!(indexed.len(), 12);
+
+            let query = QueryBuilder::new()
+                .filter("even", Operator::Equals, json!(true))
+                .sort("rank", order);
+            let indexed = paged_ids(&collection, query, 2).await;
+            let query = QueryBuilder::new()
+                .filter("even", Operator::Equals, json!(true))
+                .sort("copy", order);
+            assert_eq!(indexed, paged_ids(&collection, query, 2).await);
+        }
+
+        // A page only reads the documents up to its end
+        let before = store.metrics().documents_scanned;
+        let query = QueryBuilder::new()
+            .sort("rank", crate::SortOrder::Descending)
+            .limit(2)
+            .build();
+        let docs: Vec<_> = collection
+            .query(query)
+            .await
+            .unwrap()
+            .documents
+            .try_collect()
+            .await
+            .unwrap();
+        assert_eq!(docs.len(), 2);
+        assert_eq!(store.metrics().documents_scanned.saturating_sub(before), 2);
+    }
+
+    #[tokio::test]
+    async fn test_drop_index() {
+        let (_store, collection, _temp_dir) = setup_collection().await;
+        collection
+            .create_index("actor", IndexKind::Hash)
+            .await
+            .unwrap();
+        assert!(collection.drop_index("actor").await.unwrap());
+        assert!(!collection.drop_index("actor").await.unwrap());
+        assert!(collection.indexes().is_empty());
+        assert_eq!(
+            collection.index_candidates(&FilterPlan::compile(&[crate::Filter::Equals(
+                "actor".to_owned(),
+                json!("alice"),
+            )])),
+            None
+        );
+    }
+}
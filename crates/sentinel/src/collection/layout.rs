@@ -0,0 +1,159 @@
+use std::path::Path;
+
+use futures::{stream, StreamExt as _, TryStreamExt as _};
+use tokio::fs as tokio_fs;
+use tracing::{debug, info, warn};
+
+use crate::{
+    constants::LAYOUT_MIGRATION_CONCURRENCY,
+    layout::{is_shard_dir_name, LayoutState},
+    streaming::stream_document_ids,
+    DocumentLayout,
+    Result,
+};
+use super::coll::Collection;
+
+#[allow(
+    clippy::multiple_inherent_impl,
+    reason = "multiple impl blocks for Collection are intentional for organization"
+)]
+impl Collection {
+    /// Moves the document files of the collection into `layout` while the collection stays in
+    /// use.
+    ///
+    /// The target layout is persisted in the metadata before any file is moved, so new writes go
+    /// to the target layout straight away and reads look a document up under both layouts until
+    /// the migration completes. Files are moved by hard-linking them to their new path and
+    /// removing the old one, which never overwrites a file written concurrently under the new
+    /// layout. Each file is moved with the lock of its document held, so a concurrent write or
+    /// delete sees it either under the old path or under the new one. An interrupted migration is
+    /// recorded in the metadata and is resumed by calling this method again.
+    ///
+    /// Collection handles opened before the migration started keep using the layout they were
+    /// opened with; reopen them once the migration completes.
+    ///
+    /// # Arguments
+    ///
+    /// * `layout` - The layout to move the document files into.
+    ///
+    /// # Returns
+    ///
+    /// Returns the number of files moved, or a `SentinelError` if the collection directory cannot
+    /// be listed, a file cannot be moved or the metadata cannot be saved.
+    ///
+    /// # Example
+    ///
+    /// ```rust
+    /// use sentinel_dbms::{DocumentLayout, Store};
+    /// use serde_json::json;
+    ///
+    /// # async fn example() -> Result<(), Box<dyn std::error::Error>> {
+    /// let store = Store::new("/path/to/data", None).await?;
+    /// let collection = store.collection("users").await?;
+    /// collection.insert("user-1", json!({"name": "Alice"})).await?;
+    ///
+    /// let moved = collection.migrate_layout(DocumentLayout::Sharded).await?;
+    /// assert_eq!(moved, 1);
+    /// assert!(collection.get("user-1").await?.is_some());
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub async fn migrate_layout(&self, layout: DocumentLayout) -> Result<usize> {
+        let state = *self.layout.read().unwrap();
+        if state.current == layout && state.previous.is_none() {
+            debug!(
+                "Collection {} already uses the {} layout",
+                self.name(),
+                layout
+            );
+            return Ok(0);
+        }
+        let previous = if layout == DocumentLayout::Flat {
+            DocumentLayout::Sharded
+        }
+        else {
+            DocumentLayout::Flat
+        };
+        info!(
+            "Migrating collection {} to the {} layout",
+            self.name(),
+            layout
+        );
+
+        *self.layout.write().unwrap() = LayoutState {
+            current:  layout,
+            previous: Some(previous),
+        };
+        self.manifest.set_nested(true);
+        self.save_metadata().await?;
+
+        let mut ids: Vec<String> = stream_document_ids(self.path.clone()).try_collect().await?;
+        ids.sort_unstable();
+        ids.dedup();
+
+        let locator = self.locator();
+        let moved = stream::iter(ids)
+            .map(|id| {
+                let locator = &locator;
+                async move {
+                    // A writer holding the lock may have resolved the old path already
+                    let _lock = self.locks.lock(&id).await;
+                    let moved = locator.migrate(&id).await?;
+                    if moved {
+                        self.invalidate_cached(&id);
+                    }
+                    Ok::<bool, crate::SentinelError>(moved)
+                }
+            })
+            .buffer_unordered(LAYOUT_MIGRATION_CONCURRENCY)
+            .try_fold(0_usize, |count, moved| {
+                async move { Ok(count.saturating_add(usize::from(moved))) }
+            })
+            .await?;
+
+        if !layout.is_nested() {
+            remove_empty_shard_dirs(&self.path).await;
+        }
+
+        *self.layout.write().unwrap() = LayoutState {
+            current:  layout,
+            previous: None,
+        };
+        self.manifest.set_nested(layout.is_nested());
+        self.save_metadata().await?;
+        self.manifest.rebuild().await?;
+
+        info!(
+            "Moved {} document files of collection {} to the {} layout",
+            moved,
+            self.name(),
+            layout
+        );
+        Ok(moved)
+    }
+}
+
+/// Removes the shard directories of `collection_path` that no longer hold any file.
+///
+/// Directories that cannot be removed are left in place; they hold no documents.
+async fn remove_empty_shard_dirs(collection_path: &Path) {
+    let Ok(mut outer) = tokio_fs::read_dir(collection_path).await
+    else {
+        return;
+    };
+    while let Ok(Some(entry)) = outer.next_entry().await {
+        let is_shard = entry.file_name().to_str().is_some_and(is_shard_dir_name);
+        if !is_shard || !entry.file_type().await.is_ok_and(|t| t.is_dir()) {
+            continue;
+        }
+        if let Ok(mut inner) = tokio_fs::read_dir(entry.path()).await {
+            while let Ok(Some(shard)) = inner.next_entry().await {
+                // Fails on shards that still hold files, which is what keeps them
+                drop(tokio_fs::remove_dir(shard.path()).await);
+            }
+        }
+        if let Err(e) = tokio_fs::remove_dir(entry.path()).await {
+            warn!("Shard directory {:?} was not removed: {}", entry.path(), e);
+        }
+    }
+}
@@ -2,6 +2,10 @@
 pub mod aggregation;
 /// Core collection implementation.
 pub mod coll;
+/// Collection secondary index operations.
+pub mod index;
+/// Collection document layout operations.
+pub mod layout;
 /// Collection operations.
 pub mod operations;
 /// Collection query operations.
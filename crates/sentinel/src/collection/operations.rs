@@ -1,9 +1,26 @@
+use std::{
+    path::{Path, PathBuf},
+    pin::Pin,
+    sync::Arc,
+};
+
+use futures::{stream, Stream, StreamExt as _};
 use serde_json::Value;
-use tokio::fs as tokio_fs;
-use tracing::{debug, error, trace, warn};
+use tracing::{debug, error, trace};
 use sentinel_wal::{EntryType, LogEntry};
 
-use crate::{events::StoreEvent, Document, Result, SentinelError};
+use crate::{
+    cache::{DocumentCache, FileFingerprint, VerifiedChecks},
+    constants::{BULK_INSERT_CONCURRENCY, GET_MANY_CONCURRENCY},
+    encoding::{decode_document_with_data, encode_document, DocumentEncoding},
+    metrics::{Operation, StoreMetrics},
+    storage::DocumentFiles,
+    streaming::ScanOptions,
+    verification::VerificationContext,
+    Document,
+    Result,
+    SentinelError,
+};
 use super::coll::Collection;
 
 #[allow(
@@ -50,11 +67,19 @@ impl Collection {
     /// ```
     pub async fn insert(&self, id: &str, data: Value) -> Result<()> {
         trace!("Inserting document with id: {}", id);
+        let _timer = self.metrics.time(Operation::Insert);
         Self::validate_document_id(id)?;
-        let file_path = self.path.join(format!("{}.json", id));
+
+        let _lock = self.locks.lock(id).await;
+        self.insert_locked(id, data).await
+    }
+
+    /// Inserts the new document `id`, with the lock of the document held.
+    async fn insert_locked(&self, id: &str, data: Value) -> Result<()> {
+        let locator = self.locator();
 
         // Check if document already exists - insert should not overwrite (except for system collections)
-        let document_exists = tokio_fs::try_exists(&file_path).await.unwrap_or(false);
+        let document_exists = self.files.exists(&locator.resolve(id).await).await;
         if document_exists && !self.name().starts_with('.') {
             return Err(SentinelError::DocumentAlreadyExists {
                 id:         id.to_owned(),
@@ -78,46 +103,80 @@ impl Collection {
             debug!("WAL entry written for insert operation on document {}", id);
         }
 
-        #[allow(clippy::pattern_type_mismatch, reason = "false positive")]
-        let doc = if let Some(key) = &self.signing_key {
-            debug!("Creating signed document for id: {}", id);
-            Document::new(id.to_owned(), data, key).await?
-        }
-        else {
-            debug!("Creating unsigned document for id: {}", id);
-            Document::new_without_signature(id.to_owned(), data).await?
-        };
-
-        // COVERAGE BYPASS: The error! call in map_err (lines 147-148) is defensive code for
-        // serialization failures that cannot realistically occur with valid Document structs.
-        // Testing would require corrupting serde_json itself. Tarpaulin doesn't track map_err closures
-        // properly.
-        let json = serde_json::to_string_pretty(&doc).map_err(|e| {
-            error!("Failed to serialize document {} to JSON: {}", id, e);
-            e
-        })?;
-
-        tokio_fs::write(&file_path, &json).await.map_err(|e| {
-            error!(
-                "Failed to write document {} to file {:?}: {}",
-                id, file_path, e
-            );
-            e
-        })?;
+        let manifest_write = self.manifest.begin_write();
+        let (doc, size_bytes) = Self::write_new_document(
+            id.to_owned(),
+            data,
+            self.signing_key.clone(),
+            &self.files,
+            &locator.path(id),
+            locator.nests_files(),
+            self.document_encoding(),
+        )
+        .await?;
+        manifest_write.put(id, size_bytes, doc.hash()).await;
+        self.metrics.record_written(size_bytes);
+        self.invalidate_cached(id);
         debug!("Document {} inserted successfully", id);
+        self.index_document(id, doc.data());
 
         // Update collection's last updated timestamp
         *self.updated_at.write().unwrap() = chrono::Utc::now();
 
-        // Emit event - all metadata updates handled asynchronously by event processor
-        self.emit_event(crate::events::StoreEvent::DocumentInserted {
-            collection: self.name().to_owned(),
-            size_bytes: json.len() as u64,
-        });
+        // Merge into the pending statistics, flushed to the metadata and store by the event processor
+        self.record_stats(1, size_bytes as i64);
 
         Ok(())
     }
 
+    /// Creates a new document, signing it when a key is available, and writes it to `file_path`
+    /// in the given encoding, creating its shard directory first when `create_parent` is set.
+    ///
+    /// Returns the document together with the size in bytes of the file written.
+    async fn write_new_document(
+        id: String,
+        data: Value,
+        signing_key: Option<Arc<sentinel_crypto::SigningKey>>,
+        files: &DocumentFiles,
+        file_path: &Path,
+        create_parent: bool,
+        encoding: DocumentEncoding,
+    ) -> Result<(Document, u64)> {
+        let doc = match signing_key {
+            Some(key) => {
+                debug!("Creating signed document for id: {}", id);
+                Document::new(id, data, &key).await?
+            },
+            None => {
+                debug!("Creating unsigned document for id: {}", id);
+                Document::new_without_signature(id, data).await?
+            },
+        };
+
+        // COVERAGE BYPASS: The error! call in map_err is defensive code for serialization
+        // failures that cannot realistically occur with valid Document structs. Testing would
+        // require corrupting serde_json itself. Tarpaulin doesn't track map_err closures properly.
+        let bytes = encode_document(&doc, encoding).map_err(|e| {
+            error!("Failed to serialize document {}: {}", doc.id(), e);
+            e
+        })?;
+
+        let size_bytes = files
+            .write(file_path, bytes, create_parent)
+            .await
+            .map_err(|e| {
+                error!(
+                    "Failed to write document {} to file {:?}: {}",
+                    doc.id(),
+                    file_path,
+                    e
+                );
+                e
+            })?;
+
+        Ok((doc, size_bytes))
+    }
+
     /// Retrieves a document from the collection by its ID.
     ///
     /// Reads the JSON file corresponding to the given ID and deserializes it into
@@ -213,6 +272,17 @@ impl Collection {
         &self,
         id: &str,
         options: &crate::VerificationOptions,
+    ) -> Result<Option<Document>> {
+        let _timer = self.metrics.time(Operation::Get);
+        self.read_document(id, options).await
+    }
+
+    /// Reads a document like [`Self::get_with_verification`] without recording a get, for
+    /// operations that read documents as one of their steps.
+    pub(crate) async fn read_document(
+        &self,
+        id: &str,
+        options: &crate::VerificationOptions,
     ) -> Result<Option<Document>> {
         trace!(
             "Retrieving document with id: {} (verification enabled: {})",
@@ -220,31 +290,107 @@ impl Collection {
             options.verify_signature || options.verify_hash
         );
         Self::validate_document_id(id)?;
-        let file_path = self.path.join(format!("{}.json", id));
-        match tokio_fs::read_to_string(&file_path).await {
-            Ok(content) => {
-                debug!("Document {} found, parsing JSON", id);
-                let mut doc: Document = serde_json::from_str(&content).map_err(|e| {
-                    error!("Failed to parse JSON for document {}: {}", id, e);
+        let file_path = self.locator().resolve(id).await;
+
+        if let Some(cache) = self.cache.get() {
+            return self.get_through_cache(cache, id, &file_path, options).await;
+        }
+
+        let context = self.verification_context(*options);
+        let Some(doc) = Self::read_verified_document(id, &file_path, &self.files, &context, &self.metrics).await?
+        else {
+            return Ok(None);
+        };
+
+        trace!("Document {} retrieved successfully", id);
+        Ok(Some(doc))
+    }
+
+    /// Serves `get_with_verification` through the document cache.
+    ///
+    /// The file is stat'ed on every call so that documents changed on disk are re-read, and a hit
+    /// only runs the verification checks the cached document has not already passed.
+    async fn get_through_cache(
+        &self,
+        cache: &DocumentCache,
+        id: &str,
+        file_path: &Path,
+        options: &crate::VerificationOptions,
+    ) -> Result<Option<Document>> {
+        // Taken before the file is read, so a write racing with the read keeps it out of the cache
+        let generation = cache.generation(id);
+        let fingerprint = match self.files.metadata(file_path).await {
+            Ok(Some(metadata)) => FileFingerprint::from_metadata(&metadata),
+            Ok(None) => {
+                debug!("Document {} not found", id);
+                cache.invalidate(id);
+                return Ok(None);
+            },
+            Err(e) => {
+                error!("IO error reading document {}: {}", id, e);
+                return Err(e);
+            },
+        };
+
+        if let Some((doc, checks)) = cache.lookup(id, fingerprint) {
+            trace!("Document {} served from cache", id);
+            let remaining = checks.remaining(options);
+            self.verify_document(&doc, &remaining).await?;
+            cache.mark_verified(id, fingerprint, VerifiedChecks::proven_by(&remaining));
+            return Ok(Some(doc));
+        }
+
+        let context = self.verification_context(*options);
+        let Some(doc) = Self::read_verified_document(id, file_path, &self.files, &context, &self.metrics).await?
+        else {
+            cache.invalidate(id);
+            return Ok(None);
+        };
+        cache.insert(
+            doc.clone(),
+            fingerprint,
+            VerifiedChecks::proven_by(options),
+            generation,
+        );
+
+        trace!("Document {} retrieved successfully", id);
+        Ok(Some(doc))
+    }
+
+    /// Reads, parses and verifies the document file at `file_path`, returning `None` if it does
+    /// not exist.
+    ///
+    /// The data of a compact file is hashed straight from the file bytes, an encrypted file is
+    /// decrypted first, and the bytes read are recorded in `metrics`.
+    async fn read_verified_document(
+        id: &str,
+        file_path: &Path,
+        files: &DocumentFiles,
+        context: &VerificationContext,
+        metrics: &StoreMetrics,
+    ) -> Result<Option<Document>> {
+        match files.read(file_path).await {
+            Ok(Some((content, file_len))) => {
+                debug!("Document {} found, parsing it", id);
+                metrics.record_read(file_len);
+                let (mut doc, canonical_data) = decode_document_with_data(&content).map_err(|e| {
+                    error!("Failed to parse document {}: {}", id, e);
                     e
                 })?;
                 // Ensure the id matches the filename
                 doc.id = id.to_owned();
-
-                self.verify_document(&doc, options).await?;
-
-                trace!("Document {} retrieved successfully", id);
+                context
+                    .verify_document_with_data(&doc, canonical_data)
+                    .await?;
                 Ok(Some(doc))
             },
-            Err(e) if e.kind() == std::io::ErrorKind::NotFound => {
+            Ok(None) => {
                 debug!("Document {} not found", id);
                 Ok(None)
             },
             Err(e) => {
-                error!("IO error reading document {}: {}", id, e);
-                Err(SentinelError::Io {
-                    source: e,
-                })
+                error!("Error reading document {}: {}", id, e);
+                Err(e)
             },
         }
     }
@@ -294,10 +440,12 @@ impl Collection {
     /// ```
     pub async fn delete(&self, id: &str) -> Result<()> {
         trace!("Deleting document with id: {}", id);
+        let _timer = self.metrics.time(Operation::Delete);
         Self::validate_document_id(id)?;
-        let source_path = self.path.join(format!("{}.json", id));
-        let deleted_dir = self.path.join(".deleted");
-        let dest_path = deleted_dir.join(format!("{}.json", id));
+        let _lock = self.locks.lock(id).await;
+        let locator = self.locator();
+        let source_path = locator.resolve(id).await;
+        let dest_path = self.path.join(".deleted").join(format!("{}.json", id));
 
         // Generate transaction ID for WAL
         // Write to WAL before filesystem operation
@@ -317,44 +465,40 @@ impl Collection {
         }
 
         // Check if source exists
-        match tokio_fs::metadata(&source_path).await {
-            Ok(metadata) => {
+        let manifest_write = self.manifest.begin_write();
+        match self.files.metadata(&source_path).await {
+            Ok(Some(metadata)) => {
                 let file_size = metadata.len();
                 debug!("Document {} exists, moving to .deleted", id);
-                // Create .deleted directory if it doesn't exist
-                tokio_fs::create_dir_all(&deleted_dir).await.map_err(|e| {
-                    error!(
-                        "Failed to create .deleted directory {:?}: {}",
-                        deleted_dir, e
-                    );
-                    e
-                })?;
-                // Move file to .deleted/
-                tokio_fs::rename(&source_path, &dest_path)
+                // Move file to .deleted/, creating the directory if it doesn't exist
+                self.files
+                    .rename(&source_path, &dest_path, true)
                     .await
                     .map_err(|e| {
                         error!("Failed to move document {} to .deleted: {}", id, e);
                         e
                     })?;
+                // A copy left under the layout being migrated from must not be migrated back
+                if let Some(previous_path) = locator.previous_path(id) &&
+                    previous_path != source_path
+                {
+                    drop(self.files.remove(&previous_path).await);
+                }
                 debug!("Document {} soft deleted successfully", id);
+                manifest_write.remove(id).await;
+                self.invalidate_cached(id);
+                self.unindex_document(id);
 
                 // Update collection's last updated timestamp
                 *self.updated_at.write().unwrap() = chrono::Utc::now();
 
-                // Emit event - all metadata updates handled asynchronously by event processor
-                if let Some(sender) = self.event_sender.as_ref() {
-                    let event = StoreEvent::DocumentDeleted {
-                        collection: self.name().to_owned(),
-                        size_bytes: file_size,
-                    };
-                    if let Err(e) = sender.send(event) {
-                        warn!("Failed to send DocumentDeleted event: {}", e);
-                    }
-                }
+                // Merge into the pending statistics, flushed to the metadata and store by the event
+                // processor
+                self.record_stats(-1, (file_size as i64).saturating_neg());
 
                 Ok(())
             },
-            Err(e) if e.kind() == std::io::ErrorKind::NotFound => {
+            Ok(None) => {
                 debug!(
                     "Document {} not found, already deleted or never existed",
                     id
@@ -362,14 +506,15 @@ impl Collection {
 
                 // Update metadata even for not found (still an operation)
                 *self.updated_at.write().unwrap() = chrono::Utc::now();
+                manifest_write.remove(id).await;
+                self.invalidate_cached(id);
+                self.unindex_document(id);
 
                 Ok(())
             },
             Err(e) => {
                 error!("IO error checking document {} existence: {}", id, e);
-                Err(SentinelError::Io {
-                    source: e,
-                })
+                Err(e)
             },
         }
     }
@@ -414,8 +559,15 @@ impl Collection {
     /// Performs bulk insert operations on multiple documents.
     ///
     /// Inserts multiple documents into the collection in a single operation.
-    /// If any document fails to insert, the operation stops and returns an error.
-    /// Documents are inserted in the order provided.
+    /// The whole batch is validated first: every ID must be valid and must not already exist
+    /// (except in system collections), otherwise nothing is written. The batch is then recorded
+    /// in the WAL as a single `Begin`/`Insert...`/`Commit` transaction with one flush, documents
+    /// are hashed, signed and written concurrently, and a single aggregated event updates the
+    /// collection metadata.
+    ///
+    /// The locks of every document of the batch are held from the existence check until the
+    /// files are written, so concurrent writers of the same IDs wait for the batch, and an
+    /// `insert` racing it either fails or makes the batch fail.
     ///
     /// # Arguments
     ///
@@ -424,7 +576,8 @@ impl Collection {
     /// # Returns
     ///
     /// Returns `Ok(())` on success, or a `SentinelError` if any operation fails.
-    /// In case of failure, some documents may have been inserted before the error.
+    /// If writing a document file fails, the other documents of the batch may still have been
+    /// written; the WAL transaction allows them to be recovered.
     ///
     /// # Example
     ///
@@ -460,13 +613,198 @@ impl Collection {
             count,
             self.name()
         );
-        for (id, data) in documents {
-            self.insert(id, data).await?;
+        let _timer = self.metrics.time(Operation::Insert);
+        if documents.is_empty() {
+            debug!("Bulk insert called with no documents");
+            return Ok(());
+        }
+
+        // Validate the whole batch before anything is written
+        let locator = self.locator();
+        let allow_overwrite = self.name().starts_with('.');
+        let mut seen = std::collections::HashSet::with_capacity(count);
+        for document in &documents {
+            Self::validate_document_id(document.0)?;
+            if !seen.insert(document.0) && !allow_overwrite {
+                return Err(SentinelError::DocumentAlreadyExists {
+                    id:         document.0.to_owned(),
+                    collection: self.name().to_owned(),
+                });
+            }
+        }
+        drop(seen);
+
+        // Hold the locks of the batch from the existence check until every file is written
+        let _locks = self
+            .locks
+            .lock_many(documents.iter().map(|document| document.0))
+            .await;
+
+        if !allow_overwrite {
+            let locator = &locator;
+            let files = &self.files;
+            let existing = stream::iter(documents.iter().map(|document| document.0))
+                .map(|id| async move { files.exists(&locator.resolve(id).await).await })
+                .buffered(BULK_INSERT_CONCURRENCY)
+                .collect::<Vec<bool>>()
+                .await;
+            if let Some((document, _)) = documents.iter().zip(existing).find(|&(_, exists)| exists) {
+                return Err(SentinelError::DocumentAlreadyExists {
+                    id:         document.0.to_owned(),
+                    collection: self.name().to_owned(),
+                });
+            }
         }
+
+        // Record the batch in the WAL as one transaction before touching the filesystem
+        if let Some(wal) = self.wal_manager.as_ref() &&
+            !self
+                .recovery_mode
+                .load(std::sync::atomic::Ordering::Relaxed)
+        {
+            let begin = LogEntry::new(
+                EntryType::Begin,
+                self.name().to_owned(),
+                String::new(),
+                None,
+            );
+            let transaction_id = begin.transaction_id.clone();
+            let mut entries = Vec::with_capacity(count.saturating_add(2));
+            entries.push(begin);
+            for document in &documents {
+                let mut entry = LogEntry::new(
+                    EntryType::Insert,
+                    self.name().to_owned(),
+                    document.0.to_owned(),
+                    Some(document.1.clone()),
+                );
+                entry.transaction_id = transaction_id.clone();
+                entries.push(entry);
+            }
+            let mut commit = LogEntry::new(
+                EntryType::Commit,
+                self.name().to_owned(),
+                String::new(),
+                None,
+            );
+            commit.transaction_id = transaction_id;
+            entries.push(commit);
+
+            wal.write_entries(&entries).await?;
+            debug!(
+                "WAL transaction written for bulk insert of {} documents",
+                count
+            );
+        }
+
+        // Hash, sign and write the documents concurrently on the runtime's worker threads
+        let manifest_write = self.manifest.begin_write();
+        let encoding = self.document_encoding();
+        let mut written = stream::iter(documents.into_iter().map(|(id, data)| {
+            let locator = locator.clone();
+            let signing_key = self.signing_key.clone();
+            let files = self.files.clone();
+            let id = id.to_owned();
+            tokio::spawn(async move {
+                let file_path = locator.path(&id);
+                Self::write_new_document(
+                    id,
+                    data,
+                    signing_key,
+                    &files,
+                    &file_path,
+                    locator.nests_files(),
+                    encoding,
+                )
+                .await
+            })
+        }))
+        .buffer_unordered(BULK_INSERT_CONCURRENCY);
+
+        let mut inserted = 0_u64;
+        let mut size_bytes = 0_u64;
+        let mut recorded = Vec::with_capacity(count);
+        let mut first_error = None;
+        while let Some(outcome) = written.next().await {
+            match outcome {
+                Ok(Ok((doc, doc_size))) => {
+                    self.invalidate_cached(doc.id());
+                    self.index_document(doc.id(), doc.data());
+                    inserted = inserted.saturating_add(1);
+                    size_bytes = size_bytes.saturating_add(doc_size);
+                    recorded.push((doc.id, doc_size, doc.hash));
+                },
+                Ok(Err(e)) => {
+                    error!("Failed to write document during bulk insert: {}", e);
+                    first_error.get_or_insert(e);
+                },
+                Err(e) => {
+                    error!("Bulk insert task failed: {}", e);
+                    first_error.get_or_insert(SentinelError::Internal {
+                        message: format!("Bulk insert task failed: {}", e),
+                    });
+                },
+            }
+        }
+        manifest_write.put_many(recorded).await;
+        self.metrics.record_written(size_bytes);
+        if first_error.is_some() {
+            // A failed write may have left a partial file behind that the manifest does not list
+            self.manifest.mark_stale();
+        }
+
+        // Account for every document written, even if part of the batch failed
+        if inserted > 0 {
+            *self.updated_at.write().unwrap() = chrono::Utc::now();
+            self.record_stats(inserted as i64, size_bytes as i64);
+        }
+
+        if let Some(e) = first_error {
+            return Err(e);
+        }
+
         debug!("Bulk insert of {} documents completed successfully", count);
         Ok(())
     }
 
+    /// Merges `new_value` into `existing_value`, with `new_value` taking precedence.
+    ///
+    /// For objects, this performs a deep merge where fields from `new_value` override
+    /// or add to fields in `existing_value`. For other types, `new_value` completely replaces
+    /// `existing_value`. The existing value is modified in place, so only the merged fields are
+    /// moved rather than the whole document being copied.
+    #[allow(
+        clippy::pattern_type_mismatch,
+        reason = "false positive with serde_json::Value"
+    )]
+    fn merge_json_values(existing_value: &mut Value, new_value: Value) {
+        match (existing_value, new_value) {
+            (&mut Value::Object(ref mut existing_map), Value::Object(new_map)) => {
+                for (key, value) in new_map {
+                    if let Some(existing_val) = existing_map.get_mut(&key) {
+                        Self::merge_json_values(existing_val, value);
+                    }
+                    else {
+                        existing_map.insert(key, value);
+                    }
+                }
+            },
+            (existing_value, new_value) => *existing_value = new_value,
+        }
+    }
+
+    /// Reads the document `id` to update it, failing if it does not exist.
+    async fn read_for_update(&self, id: &str) -> Result<Document> {
+        self.read_document(id, &crate::VerificationOptions::default())
+            .await?
+            .ok_or_else(|| {
+                SentinelError::DocumentNotFound {
+                    id:         id.to_owned(),
+                    collection: self.name().to_owned(),
+                }
+            })
+    }
+
     /// Updates a document by merging new data with existing data.
     ///
     /// This method loads the existing document, merges the provided data with the existing
@@ -475,6 +813,9 @@ impl Collection {
     ///
     /// If the document doesn't exist, this method will return an error.
     ///
+    /// Concurrent writers of the same document are serialized, so no update is lost. Use
+    /// [`Collection::compare_and_update`] to also detect documents changed since they were read.
+    ///
     /// # Arguments
     ///
     /// * `id` - The unique identifier of the document to update
@@ -508,51 +849,89 @@ impl Collection {
     /// # Ok(())
     /// # }
     /// ```
-    /// Merges two JSON values, with `new_value` taking precedence over `existing_value`.
-    ///
-    /// For objects, this performs a deep merge where fields from `new_value` override
-    /// or add to fields in `existing_value`. For other types, `new_value` completely replaces
-    /// `existing_value`.
-    #[allow(
-        clippy::pattern_type_mismatch,
-        reason = "false positive with serde_json::Value"
-    )]
-    fn merge_json_values(existing_value: &Value, new_value: Value) -> Value {
-        match (existing_value, &new_value) {
-            (Value::Object(existing_map), Value::Object(new_map)) => {
-                let mut merged = existing_map.clone();
-                for (key, value) in new_map {
-                    if let Some(existing_val) = merged.get(key) {
-                        merged.insert(
-                            key.clone(),
-                            Self::merge_json_values(existing_val, value.clone()),
-                        );
-                    }
-                    else {
-                        merged.insert(key.clone(), value.clone());
-                    }
-                }
-                Value::Object(merged)
-            },
-            _ => new_value,
-        }
-    }
-
     pub async fn update(&self, id: &str, data: Value) -> Result<()> {
         trace!("Updating document with id: {}", id);
+        let _timer = self.metrics.time(Operation::Update);
         Self::validate_document_id(id)?;
 
-        // Load existing document
-        let Some(mut existing_doc) = self.get(id).await?
-        else {
-            return Err(SentinelError::DocumentNotFound {
+        let _lock = self.locks.lock(id).await;
+        let existing_doc = self.read_for_update(id).await?;
+        self.update_locked(id, existing_doc, data).await
+    }
+
+    /// Updates a document by merging new data, provided it has not changed since it was read.
+    ///
+    /// This is an optimistic update: the caller reads the document without holding any lock,
+    /// computes the change, and passes the hash of the document it read. The update only
+    /// happens if the document still has that hash, which changes with every write of different
+    /// data, so a read-modify-write never overwrites a concurrent change. On a conflict, read
+    /// the document again and retry.
+    ///
+    /// # Arguments
+    ///
+    /// * `id` - The unique identifier of the document to update
+    /// * `expected_hash` - The hash of the document the change was computed from
+    /// * `data` - The new data to merge with the existing document data
+    ///
+    /// # Returns
+    ///
+    /// Returns `Ok(())` on success, `SentinelError::VersionConflict` if the document changed
+    /// since it was read, or another `SentinelError` if the operation fails.
+    ///
+    /// # Examples
+    ///
+    /// ```rust
+    /// use sentinel_dbms::{SentinelError, Store};
+    /// use serde_json::json;
+    ///
+    /// # async fn example() -> sentinel_dbms::Result<()> {
+    /// let store = Store::new("/path/to/data", None).await?;
+    /// let accounts = store.collection("accounts").await?;
+    /// accounts.insert("alice", json!({"balance": 100})).await?;
+    ///
+    /// loop {
+    ///     let doc = accounts.get("alice").await?.unwrap();
+    ///     let balance = doc.data()["balance"].as_i64().unwrap();
+    ///     match accounts
+    ///         .compare_and_update("alice", doc.hash(), json!({"balance": balance + 10}))
+    ///         .await
+    ///     {
+    ///         Err(SentinelError::VersionConflict { .. }) => continue,
+    ///         result => break result?,
+    ///     }
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub async fn compare_and_update(&self, id: &str, expected_hash: &str, data: Value) -> Result<()> {
+        trace!(
+            "Updating document with id: {} if its hash is {}",
+            id,
+            expected_hash
+        );
+        let _timer = self.metrics.time(Operation::Update);
+        Self::validate_document_id(id)?;
+
+        let _lock = self.locks.lock(id).await;
+        let existing_doc = self.read_for_update(id).await?;
+        if existing_doc.hash() != expected_hash {
+            debug!("Document {} changed since it was read, not updating", id);
+            return Err(SentinelError::VersionConflict {
                 id:         id.to_owned(),
                 collection: self.name().to_owned(),
+                expected:   expected_hash.to_owned(),
+                actual:     existing_doc.hash().to_owned(),
             });
-        };
+        }
+        self.update_locked(id, existing_doc, data).await
+    }
 
-        // Merge the new data with existing data
-        let merged_data = Self::merge_json_values(existing_doc.data(), data);
+    /// Merges `data` into `existing_doc`, the document `id`, and writes it back, with the lock of
+    /// the document held.
+    async fn update_locked(&self, id: &str, mut existing_doc: Document, data: Value) -> Result<()> {
+        // Merge the new data into the existing data, which is moved out of the document
+        let mut merged_data = std::mem::take(&mut existing_doc.data);
+        Self::merge_json_values(&mut merged_data, data);
 
         // Write to WAL before filesystem operation
         if let Some(wal) = self.wal_manager.as_ref() &&
@@ -583,50 +962,56 @@ impl Collection {
         }
 
         // Get old file size before updating
-        let file_path = self.path.join(format!("{}.json", id));
-        let old_size = tokio_fs::metadata(&file_path)
+        let locator = self.locator();
+        let old_size = self
+            .files
+            .metadata(&locator.resolve(id).await)
             .await
-            .map(|m| m.len())
-            .unwrap_or(0);
+            .ok()
+            .flatten()
+            .map_or(0, |m| m.len());
+        let file_path = locator.path(id);
 
         // Save the updated document
-        let json = serde_json::to_string_pretty(&existing_doc).map_err(|e| {
-            error!("Failed to serialize updated document {} to JSON: {}", id, e);
-            e
-        })?;
-        let new_size = json.len() as u64;
-        tokio_fs::write(&file_path, json).await.map_err(|e| {
-            error!(
-                "Failed to write updated document {} to file {:?}: {}",
-                id, file_path, e
-            );
+        let bytes = encode_document(&existing_doc, self.document_encoding()).map_err(|e| {
+            error!("Failed to serialize updated document {}: {}", id, e);
             e
         })?;
+        let manifest_write = self.manifest.begin_write();
+        let new_size = self
+            .files
+            .write(&file_path, bytes, locator.nests_files())
+            .await
+            .map_err(|e| {
+                error!(
+                    "Failed to write updated document {} to file {:?}: {}",
+                    id, file_path, e
+                );
+                e
+            })?;
+        manifest_write.put(id, new_size, existing_doc.hash()).await;
+        self.metrics.record_written(new_size);
 
         debug!("Document {} updated successfully", id);
+        self.invalidate_cached(id);
+        self.index_document(id, existing_doc.data());
 
         // Update collection's last updated timestamp
         *self.updated_at.write().unwrap() = chrono::Utc::now();
 
-        // Emit event - all metadata updates handled asynchronously by event processor
-        if let Some(sender) = self.event_sender.as_ref() {
-            let event = StoreEvent::DocumentUpdated {
-                collection:     self.name().to_owned(),
-                old_size_bytes: old_size,
-                new_size_bytes: new_size,
-            };
-            if let Err(e) = sender.send(event) {
-                warn!("Failed to send DocumentUpdated event: {}", e);
-            }
-        }
+        // Merge into the pending statistics, flushed to the metadata and store by the event processor
+        self.record_stats(0, (new_size as i64).saturating_sub(old_size as i64));
 
         Ok(())
     }
 
     /// Retrieves multiple documents by their IDs in a single operation.
     ///
-    /// This method efficiently loads multiple documents concurrently. For IDs that don't exist,
-    /// `None` is returned in the corresponding position.
+    /// This method loads up to [`GET_MANY_CONCURRENCY`] documents concurrently, issuing the reads
+    /// in file path order, so large batches neither run out of file descriptors nor seek back and
+    /// forth across the disk. For IDs that don't exist, `None` is returned in the corresponding
+    /// position. The first error fails the whole batch; use `get_many_with_options` to get a
+    /// result per ID instead.
     ///
     /// # Arguments
     ///
@@ -662,14 +1047,23 @@ impl Collection {
     /// # }
     /// ```
     pub async fn get_many(&self, ids: &[&str]) -> Result<Vec<Option<Document>>> {
-        use futures::future::join_all;
-
         trace!("Batch getting {} documents", ids.len());
 
-        let futures = ids.iter().map(|&id| self.get(id));
-        let results = join_all(futures).await;
-
-        let documents = results.into_iter().collect::<Result<Vec<_>>>()?;
+        let scan = ScanOptions {
+            concurrency: GET_MANY_CONCURRENCY,
+            ordered:     false,
+        };
+        let mut results = self.get_many_with_options(
+            ids.iter().map(|&id| id.to_owned()).collect(),
+            &crate::VerificationOptions::default(),
+            scan,
+        );
+        let mut documents: Vec<Option<Document>> = std::iter::repeat_with(|| None).take(ids.len()).collect();
+        while let Some((index, result)) = results.next().await {
+            if let Some(slot) = documents.get_mut(index) {
+                *slot = result?;
+            }
+        }
 
         debug!(
             "Batch get completed, retrieved {} documents",
@@ -678,11 +1072,95 @@ impl Collection {
         Ok(documents)
     }
 
+    /// Retrieves multiple documents by their IDs as a stream of per-ID results.
+    ///
+    /// Reads are issued in file path order, which groups the files of each shard directory
+    /// together under the sharded layout, with at most `scan.concurrency` files open at once.
+    /// Each read runs on its own runtime task and goes through the document cache when one is
+    /// configured. A missing document yields `Ok(None)` and an unreadable or invalid one yields
+    /// its error, without affecting the other IDs.
+    ///
+    /// # Arguments
+    ///
+    /// * `ids` - The document IDs to retrieve.
+    /// * `options` - Verification options controlling hash and signature verification.
+    /// * `scan` - Concurrency of the reads. When `scan.ordered` is set, results are yielded in read
+    ///   order, otherwise as soon as each read completes.
+    ///
+    /// # Returns
+    ///
+    /// Returns a stream of `(index, result)` pairs, where `index` is the position of the ID in
+    /// `ids`.
+    ///
+    /// # Example
+    ///
+    /// ```rust
+    /// use futures::StreamExt;
+    /// use sentinel_dbms::{ScanOptions, Store, VerificationOptions};
+    /// use serde_json::json;
+    ///
+    /// # async fn example() -> sentinel_dbms::Result<()> {
+    /// let store = Store::new("/path/to/data", None).await?;
+    /// let collection = store.collection("users").await?;
+    /// collection.insert("user-1", json!({"name": "Alice"})).await?;
+    ///
+    /// let ids = vec!["user-1".to_owned(), "user-2".to_owned()];
+    /// let mut results = collection.get_many_with_options(
+    ///     ids,
+    ///     &VerificationOptions::default(),
+    ///     ScanOptions::unordered(),
+    /// );
+    /// while let Some((index, result)) = results.next().await {
+    ///     println!("{}: found {}", index, result?.is_some());
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn get_many_with_options(
+        &self,
+        ids: Vec<String>,
+        options: &crate::VerificationOptions,
+        scan: ScanOptions,
+    ) -> Pin<Box<dyn Stream<Item = (usize, Result<Option<Document>>)> + Send>> {
+        let locator = self.locator();
+        let mut reads: Vec<(PathBuf, usize, String)> = ids
+            .into_iter()
+            .enumerate()
+            .map(|(index, id)| (locator.path(&id), index, id))
+            .collect();
+        reads.sort_unstable();
+
+        let collection = Arc::new(self.read_view());
+        let options = *options;
+        let tasks = stream::iter(reads).map(move |(_, index, id)| {
+            let collection = collection.clone();
+            async move {
+                let result = tokio::spawn(async move { collection.get_with_verification(&id, &options).await })
+                    .await
+                    .unwrap_or_else(|e| {
+                        Err(SentinelError::Internal {
+                            message: format!("Document read task failed: {}", e),
+                        })
+                    });
+                (index, result)
+            }
+        });
+
+        let concurrency = scan.concurrency.max(1);
+        if scan.ordered {
+            Box::pin(tasks.buffered(concurrency))
+        }
+        else {
+            Box::pin(tasks.buffer_unordered(concurrency))
+        }
+    }
+
     /// Inserts a document if it doesn't exist, or updates it if it does.
     ///
     /// This is a convenience method that combines insert and update operations.
     /// If the document doesn't exist, it will be inserted. If it exists, the new data
-    /// will be merged with the existing data (see `update` for merge behavior).
+    /// will be merged with the existing data (see `update` for merge behavior). Concurrent
+    /// upserts of the same document are serialized, so exactly one of them inserts it.
     ///
     /// # Arguments
     ///
@@ -721,16 +1199,25 @@ impl Collection {
     /// ```
     pub async fn upsert(&self, id: &str, data: Value) -> Result<bool> {
         trace!("Upserting document with id: {}", id);
+        Self::validate_document_id(id)?;
 
-        if self.get(id).await?.is_some() {
+        // The lock is held from the existence check to the write, so concurrent upserts of a new
+        // document never both insert it
+        let _lock = self.locks.lock(id).await;
+        if let Some(existing_doc) = self
+            .read_document(id, &crate::VerificationOptions::default())
+            .await?
+        {
             // Document exists, update it
-            self.update(id, data).await?;
+            let _timer = self.metrics.time(Operation::Update);
+            self.update_locked(id, existing_doc, data).await?;
             debug!("Document {} updated via upsert", id);
             Ok(false)
         }
         else {
             // Document doesn't exist, insert it
-            self.insert(id, data).await?;
+            let _timer = self.metrics.time(Operation::Insert);
+            self.insert_locked(id, data).await?;
             debug!("Document {} inserted via upsert", id);
             Ok(true)
         }
@@ -875,6 +1362,80 @@ mod tests {
         }
     }
 
+    #[tokio::test]
+    async fn test_bulk_insert_writes_single_wal_transaction() {
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new(temp_dir.path().join("data"), None)
+            .await
+            .unwrap();
+        let collection = store.collection("test").await.unwrap();
+
+        collection
+            .bulk_insert(vec![
+                ("doc-1", json!({"n": 1})),
+                ("doc-2", json!({"n": 2})),
+                ("doc-3", json!({"n": 3})),
+            ])
+            .await
+            .unwrap();
+
+        let entries = collection
+            .wal_manager
+            .as_ref()
+            .unwrap()
+            .read_all_entries()
+            .await
+            .unwrap();
+        assert_eq!(entries.len(), 5);
+        assert_eq!(
+            entries.first().unwrap().entry_type,
+            sentinel_wal::EntryType::Begin
+        );
+        assert_eq!(
+            entries.last().unwrap().entry_type,
+            sentinel_wal::EntryType::Commit
+        );
+        let transaction_id = entries.first().unwrap().transaction_id_str();
+        assert!(entries
+            .iter()
+            .all(|entry| entry.transaction_id_str() == transaction_id));
+
+        collection.flush_metadata().await.unwrap();
+        assert_eq!(collection.count().await.unwrap(), 3);
+    }
+
+    #[tokio::test]
+    async fn test_bulk_insert_rejects_existing_document_without_writing() {
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new(temp_dir.path().join("data"), None)
+            .await
+            .unwrap();
+        let collection = store.collection("test").await.unwrap();
+        collection.insert("doc-2", json!({"n": 2})).await.unwrap();
+
+        let result = collection
+            .bulk_insert(vec![
+                ("doc-1", json!({"n": 1})),
+                ("doc-2", json!({"n": 20})),
+            ])
+            .await;
+        assert!(matches!(
+            result,
+            Err(crate::SentinelError::DocumentAlreadyExists { .. })
+        ));
+        assert!(collection.get("doc-1").await.unwrap().is_none());
+
+        // Duplicate IDs within one batch are rejected as well
+        let result = collection
+            .bulk_insert(vec![("doc-3", json!({"n": 3})), ("doc-3", json!({"n": 4}))])
+            .await;
+        assert!(matches!(
+            result,
+            Err(crate::SentinelError::DocumentAlreadyExists { .. })
+        ));
+        assert!(collection.get("doc-3").await.unwrap().is_none());
+    }
+
     // ============ Get Many Tests ============
 
     #[tokio::test]
@@ -918,6 +1479,55 @@ mod tests {
         assert!(results[3].is_none()); // doc-4 doesn't exist
     }
 
+    #[tokio::test]
+    async fn test_get_many_with_options_reports_each_id() {
+        use futures::StreamExt as _;
+
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new(temp_dir.path().join("data"), None)
+            .await
+            .unwrap();
+        let collection = store.collection("test").await.unwrap();
+        for i in 0 .. 200 {
+            collection
+                .insert(&format!("doc-{}", i), json!({ "n": i }))
+                .await
+                .unwrap();
+        }
+        tokio_fs::write(collection.path.join("doc-7.json"), "not a document")
+            .await
+            .unwrap();
+
+        // More IDs than the concurrency bound, plus a missing, a corrupt and an invalid ID
+        let mut ids: Vec<String> = (0 .. 200).rev().map(|i| format!("doc-{}", i)).collect();
+        ids.push("missing".to_owned());
+        ids.push("bad/id".to_owned());
+        let mut results: Vec<_> = collection
+            .get_many_with_options(
+                ids.clone(),
+                &crate::VerificationOptions::default(),
+                crate::ScanOptions {
+                    concurrency: 8,
+                    ordered:     false,
+                },
+            )
+            .collect()
+            .await;
+        results.sort_by_key(|&(index, _)| index);
+
+        assert_eq!(results.len(), ids.len());
+        for (index, result) in results {
+            match ids[index].as_str() {
+                "doc-7" | "bad/id" => assert!(result.is_err()),
+                "missing" => assert!(result.unwrap().is_none()),
+                id => assert_eq!(result.unwrap().unwrap().id(), id),
+            }
+        }
+
+        // The batch form fails on the corrupt document
+        assert!(collection.get_many(&["doc-1", "doc-7"]).await.is_err());
+    }
+
     // ============ Upsert Tests ============
 
     #[tokio::test]
@@ -968,6 +1578,181 @@ mod tests {
         assert_eq!(doc.data()["value"], 2); // New value added
     }
 
+    #[tokio::test(flavor = "multi_thread", worker_threads = 4)]
+    async fn test_concurrent_writes_to_one_document() {
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new(temp_dir.path().join("data"), None)
+            .await
+            .unwrap();
+        let collection = store.collection("test").await.unwrap();
+
+        // Concurrent upserts of a new document insert it exactly once
+        let upserts: Vec<_> = (0 .. 8)
+            .map(|i| {
+                let collection = collection.clone();
+                tokio::spawn(async move {
+                    collection
+                        .upsert("hot", json!({ format!("upsert_{}", i): i }))
+                        .await
+                        .unwrap()
+                })
+            })
+            .collect();
+        let mut inserted = Vec::new();
+        for upsert in upserts {
+            inserted.push(upsert.await.unwrap());
+        }
+        assert_eq!(inserted.iter().filter(|&&inserted| inserted).count(), 1);
+
+        // Concurrent updates of different fields are all kept
+        let updates: Vec<_> = (0 .. 16)
+            .map(|i| {
+                let collection = collection.clone();
+                tokio::spawn(async move {
+                    collection
+                        .update("hot", json!({ format!("update_{}", i): i }))
+                        .await
+                        .unwrap();
+                })
+            })
+            .collect();
+        for update in updates {
+            update.await.unwrap();
+        }
+
+        let doc = collection.get("hot").await.unwrap().unwrap();
+        let fields = doc.data().as_object().unwrap();
+        assert_eq!(fields.len(), 24);
+        for i in 0 .. 16 {
+            assert_eq!(fields[&format!("update_{}", i)], i);
+        }
+    }
+
+    #[tokio::test(flavor = "multi_thread", worker_threads = 4)]
+    async fn test_bulk_insert_races_insert_of_the_same_document() {
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new(temp_dir.path().join("data"), None)
+            .await
+            .unwrap();
+        let collection = store.collection("test").await.unwrap();
+
+        for round in 0 .. 8 {
+            let id = format!("contended-{}", round);
+            let batch = {
+                let collection = collection.clone();
+                let id = id.clone();
+                let filler = format!("filler-{}", round);
+                tokio::spawn(async move {
+                    collection
+                        .bulk_insert(vec![
+                            (id.as_str(), json!({"by": "bulk"})),
+                            (filler.as_str(), json!({})),
+                        ])
+                        .await
+                })
+            };
+            let single = {
+                let collection = collection.clone();
+                let id = id.clone();
+                tokio::spawn(async move { collection.insert(&id, json!({"by": "insert"})).await })
+            };
+            let batch = batch.await.unwrap();
+            let single = single.await.unwrap();
+
+            // Exactly one writer creates the document, and its data is the one stored
+            assert_ne!(batch.is_ok(), single.is_ok());
+            let expected = if batch.is_ok() { "bulk" } else { "insert" };
+            let doc = collection.get(&id).await.unwrap().unwrap();
+            assert_eq!(doc.data()["by"], expected);
+        }
+    }
+
+    #[tokio::test]
+    async fn test_compare_and_update() {
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new(temp_dir.path().join("data"), None)
+            .await
+            .unwrap();
+        let collection = store.collection("test").await.unwrap();
+        collection
+            .insert("account", json!({"owner": "alice", "balance": 100}))
+            .await
+            .unwrap();
+
+        let read = collection.get("account").await.unwrap().unwrap();
+        collection
+            .compare_and_update("account", read.hash(), json!({"balance": 110}))
+            .await
+            .unwrap();
+
+        // The hash read before the first update is now stale
+        let result = collection
+            .compare_and_update("account", read.hash(), json!({"balance": 120}))
+            .await;
+        assert!(matches!(
+            result,
+            Err(crate::SentinelError::VersionConflict { .. })
+        ));
+        let doc = collection.get("account").await.unwrap().unwrap();
+        assert_eq!(doc.data()["balance"], 110);
+        assert_eq!(doc.data()["owner"], "alice");
+
+        assert!(matches!(
+            collection
+                .compare_and_update("missing", read.hash(), json!({}))
+                .await,
+            Err(crate::SentinelError::DocumentNotFound { .. })
+        ));
+    }
+
+    #[tokio::test(flavor = "multi_thread", worker_threads = 4)]
+    async fn test_compare_and_update_retries_keep_every_increment() {
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new(temp_dir.path().join("data"), None)
+            .await
+            .unwrap();
+        let collection = store.collection("test").await.unwrap();
+        collection
+            .insert("counter", json!({"value": 0}))
+            .await
+            .unwrap();
+
+        let writers: Vec<_> = (0 .. 8)
+            .map(|_| {
+                let collection = collection.clone();
+                tokio::spawn(async move {
+                    loop {
+                        // Reads take no lock, and may see a file while it is being rewritten
+                        let Ok(Some(doc)) = collection.get("counter").await
+                        else {
+                            continue;
+                        };
+                        let value = doc.data()["value"].as_i64().unwrap();
+                        match collection
+                            .compare_and_update(
+                                "counter",
+                                doc.hash(),
+                                json!({"value": value.saturating_add(1)}),
+                            )
+                            .await
+                        {
+                            Err(crate::SentinelError::VersionConflict {
+                                ..
+                            }) => continue,
+                            result => break result.unwrap(),
+                        }
+                    }
+                })
+            })
+            .collect();
+        for writer in writers {
+            writer.await.unwrap();
+        }
+
+        let doc = collection.get("counter").await.unwrap().unwrap();
+        assert_eq!(doc.data()["value"], 8);
+    }
+
     // ============ Delete Tests ============
 
     #[tokio::test]
@@ -1086,35 +1871,36 @@ mod tests {
     #[tokio::test]
     async fn test_merge_json_values_objects() {
         // Test object merging
-        let existing = json!({"a": 1, "b": 2, "c": 3});
-        let new = json!({"b": 20, "d": 4});
+        let mut merged = json!({"a": 1, "b": 2, "c": 3, "nested": {"x": 1, "y": 2}});
+        let new = json!({"b": 20, "d": 4, "nested": {"y": 3}});
 
-        let merged = Collection::merge_json_values(&existing, new);
+        Collection::merge_json_values(&mut merged, new);
         let merged_obj = merged.as_object().unwrap();
 
         assert_eq!(merged_obj["a"], 1); // Preserved
         assert_eq!(merged_obj["b"], 20); // Updated
         assert_eq!(merged_obj["c"], 3); // Preserved
         assert_eq!(merged_obj["d"], 4); // Added
+        assert_eq!(merged_obj["nested"], json!({"x": 1, "y": 3})); // Merged deeply
     }
 
     #[tokio::test]
     async fn test_merge_json_values_non_objects() {
         // When new value is not an object, it should replace entirely
-        let existing = json!({"name": "Alice"});
+        let mut merged = json!({"name": "Alice"});
         let new = json!("replacement string");
 
-        let merged = Collection::merge_json_values(&existing, new);
+        Collection::merge_json_values(&mut merged, new);
         assert_eq!(merged, "replacement string");
     }
 
     #[tokio::test]
     async fn test_merge_json_values_array_replacement() {
         // Arrays should be replaced entirely
-        let existing = json!({"items": [1, 2, 3]});
+        let mut merged = json!({"items": [1, 2, 3]});
         let new = json!({"items": [4, 5]});
 
-        let merged = Collection::merge_json_values(&existing, new);
+        Collection::merge_json_values(&mut merged, new);
         let merged_items = merged["items"].as_array().unwrap();
 
         assert_eq!(merged_items.len(), 2);
@@ -1,18 +1,23 @@
+use std::sync::{Arc, Mutex};
+
 use async_stream::stream;
-use futures::{StreamExt as _, TryStreamExt as _};
+use futures::StreamExt as _;
 use serde_json::Value;
-use tokio::fs as tokio_fs;
 use tokio_stream::Stream;
 use tracing::{debug, trace};
 
 use crate::{
-    comparison::compare_values,
-    filtering::matches_filters,
+    constants::{SORTED_INDEX_BATCH_SIZE, SORT_SPILL_DIR},
+    filtering::FilterPlan,
+    metrics::{MeteredStream, Operation},
     projection::project_document,
-    streaming::stream_document_ids,
+    sorting::{compare_keys, ExternalSorter, TopK},
+    streaming::ScanOptions,
     Document,
+    QueryCursor,
     Result,
     SentinelError,
+    SortOrder,
 };
 use super::coll::Collection;
 
@@ -26,9 +31,17 @@ impl Collection {
     /// This method supports complex filtering, sorting, pagination, and field projection.
     /// For optimal performance and memory usage:
     /// - Queries without sorting use streaming processing with early limit application
-    /// - Queries with sorting collect filtered documents in memory for sorting
+    /// - Queries sorted by a field with an ordered index read the documents in sort order from the
+    ///   index, starting at the cursor, and stop once the page is full
+    /// - Other sorted queries keep only a bounded top-k heap, or `(sort key, id)` pairs spilled to
+    ///   disk, while scanning every candidate
     /// - Projection is applied only to final results to minimize memory usage
     ///
+    /// Results are ordered by the sort key, if any, and then by document ID. To page through them,
+    /// pass [`QueryResult::next_cursor`](crate::QueryResult::next_cursor) of one page to
+    /// [`QueryBuilder::after`](crate::QueryBuilder::after) for the next, rather than increasing
+    /// an offset whose skipped documents are read again for every page.
+    ///
     /// By default, this method verifies both hash and signature with strict mode.
     /// Use `query_with_verification()` to customize verification behavior.
     ///
@@ -79,7 +92,10 @@ impl Collection {
     /// This method supports complex filtering, sorting, pagination, and field projection.
     /// For optimal performance and memory usage:
     /// - Queries without sorting use streaming processing with early limit application
-    /// - Queries with sorting collect filtered documents in memory for sorting
+    /// - Queries sorted by a field with an ordered index read the documents in sort order from the
+    ///   index, starting at the cursor, and stop once the page is full
+    /// - Other sorted queries keep only a bounded top-k heap, or `(sort key, id)` pairs spilled to
+    ///   disk, while scanning every candidate
     /// - Projection is applied only to final results to minimize memory usage
     ///
     /// # Arguments
@@ -128,6 +144,7 @@ impl Collection {
     ) -> Result<crate::QueryResult> {
         use std::time::Instant;
         let start_time = Instant::now();
+        let timer = self.metrics.time(Operation::Query);
 
         trace!(
             "Executing query on collection: {} (verification enabled: {})",
@@ -135,186 +152,416 @@ impl Collection {
             options.verify_signature || options.verify_hash
         );
 
-        // Get all document IDs - but for full streaming, we should avoid this
-        // However, for sorted queries, we need to know all IDs to collect
-        // For non-sorted, we can stream without knowing all IDs
-        let documents_stream = if query.sort.is_some() {
-            // For sorted queries, we need to collect all matching documents
-            let all_ids: Vec<String> = self.list().try_collect().await?;
-            let docs = self
-                .execute_sorted_query_with_verification(&all_ids, &query, options)
-                .await?;
-            let stream = tokio_stream::iter(docs.into_iter().map(Ok));
-            Box::pin(stream) as std::pin::Pin<Box<dyn Stream<Item = Result<Document>> + Send>>
+        // The filters are compiled once and shared by index selection and every document tested
+        let plan = Arc::new(FilterPlan::compile(&query.filters));
+
+        // Resolve candidate IDs from the secondary indexes, if any filter can be served by one
+        let candidate_ids = self.index_candidates(&plan);
+        if let Some(ref ids) = candidate_ids {
+            debug!(
+                "Secondary indexes selected {} candidate documents",
+                ids.len()
+            );
+        }
+
+        let last = Arc::new(Mutex::new(None));
+        let index_sorted = query
+            .sort
+            .as_ref()
+            .is_some_and(|&(ref field, _)| self.indexes.read().unwrap().sorts_by(field));
+        let documents_stream = if index_sorted {
+            debug!("Reading the sorted documents from the ordered index of the sort field");
+            self.execute_index_sorted_query_with_verification(&query, plan, candidate_ids, options, last.clone())?
+        }
+        else if query.sort.is_some() {
+            // Sorted queries only hold a bounded top-k heap or (sort key, id) pairs in memory
+            let id_stream = match candidate_ids {
+                Some(ids) => {
+                    Box::pin(tokio_stream::iter(ids.into_iter().map(Ok)))
+                        as std::pin::Pin<Box<dyn Stream<Item = Result<String>> + Send>>
+                },
+                None => self.list(),
+            };
+            let id_stream = self.metrics.count_scanned(id_stream);
+            self.execute_sorted_query_with_verification(id_stream, &query, plan, options, last.clone())
+                .await?
         }
         else {
             // For non-sorted queries, use streaming
-            self.execute_streaming_query_with_verification(&query, options)
+            self.execute_streaming_query_with_verification(&query, plan, candidate_ids, options, last.clone())
                 .await?
         };
 
         let execution_time = start_time.elapsed();
-        debug!("Query completed in {:?}", execution_time);
+        debug!("Query planned in {:?}", execution_time);
 
         Ok(crate::QueryResult {
-            documents: documents_stream,
+            documents: Box::pin(MeteredStream::new(documents_stream, timer)),
             total_count: None, // For streaming, we don't know the total count upfront
             execution_time,
+            last,
         })
     }
 
-    /// Executes a query that requires sorting by collecting all matching documents first with
-    /// verification.
+    /// Executes a query that requires sorting with verification.
+    ///
+    /// Memory stays bounded regardless of the collection size:
+    /// - With a limit, only the best `offset + limit` matching documents are retained in a top-k
+    ///   heap while the candidates are scanned.
+    /// - Without a limit, only `(sort key, id)` pairs are retained, spilling sorted runs to disk
+    ///   once they exceed [`SORT_RUN_CAPACITY`](crate::sorting::SORT_RUN_CAPACITY). The matching
+    ///   documents are then re-read lazily in sorted order.
+    ///
+    /// The candidates are scanned in ID order and both sorts are stable, so ties are broken by
+    /// document ID. Documents ordered before the cursor of the query are never retained.
     async fn execute_sorted_query_with_verification(
         &self,
-        all_ids: &[String],
+        mut id_stream: std::pin::Pin<Box<dyn Stream<Item = Result<String>> + Send>>,
         query: &crate::Query,
+        plan: Arc<FilterPlan>,
         options: &crate::VerificationOptions,
-    ) -> Result<Vec<Document>> {
-        // For sorted queries, we need to collect all matching documents to sort them
-        // But we can optimize by only keeping document IDs and sort values during filtering
-        let mut matching_docs = Vec::new();
-
-        // Precompute filter references to avoid allocating a new Vec for each document
-        let filter_refs: Vec<_> = query.filters.iter().collect();
+        last: Arc<Mutex<Option<QueryCursor>>>,
+    ) -> Result<std::pin::Pin<Box<dyn Stream<Item = Result<Document>> + Send>>> {
+        let Some((ref field, order)) = query.sort
+        else {
+            return Err(SentinelError::Internal {
+                message: "sorted query executed without a sort field".to_owned(),
+            });
+        };
+        let offset = query.offset.unwrap_or(0);
 
-        for id in all_ids {
-            if let Some(doc) = self.get_with_verification(id, options).await? &&
-                matches_filters(&doc, &filter_refs)
-            {
-                matching_docs.push(doc);
+        if let Some(limit) = query.limit {
+            let mut top = TopK::new(offset.saturating_add(limit), order);
+            while let Some(id) = id_stream.next().await {
+                let id = id?;
+                if let Some(doc) = self.read_document(&id, options).await? &&
+                    plan.matches(&doc)
+                {
+                    let key = doc.data().get(field.as_str()).cloned();
+                    if query.is_after(key.as_ref(), &id) {
+                        top.push(key, doc);
+                    }
+                }
             }
-        }
 
-        if let Some(ref inner) = query.sort {
-            let field = &inner.0;
-            let order = &inner.1;
-            matching_docs.sort_by(|a, b| {
-                let a_val = a.data().get(field.as_str());
-                let b_val = b.data().get(field.as_str());
-                if *order == crate::SortOrder::Ascending {
-                    self.compare_values(a_val, b_val)
-                }
-                else {
-                    self.compare_values(b_val, a_val)
+            // Apply offset and projection to the final results
+            let sorted_docs = top.into_sorted_vec();
+            let sort_field = field.clone();
+            let projection_fields = query.projection.clone();
+            return Ok(Box::pin(stream! {
+                for doc in sorted_docs.into_iter().skip(offset) {
+                    *last.lock().unwrap() = Some(QueryCursor::after_document(&doc, Some(&sort_field)));
+                    let final_doc = if let Some(ref fields) = projection_fields {
+                        project_document(doc, fields)
+                    } else {
+                        doc
+                    };
+                    yield Ok(final_doc);
                 }
-            });
+            }));
         }
 
-        // Apply offset and limit
-        let offset = query.offset.unwrap_or(0);
-        let start_idx = offset.min(matching_docs.len());
-        let end_idx = query.limit.map_or(matching_docs.len(), |limit| {
-            start_idx.saturating_add(limit).min(matching_docs.len())
-        });
-
-        // Apply projection to the final results
-        let mut final_docs = Vec::new();
-        for doc in matching_docs
-            .into_iter()
-            .skip(start_idx)
-            .take(end_idx.saturating_sub(start_idx))
-        {
-            let projected_doc = if let Some(ref fields) = query.projection {
-                self.project_document(&doc, fields).await?
+        let mut sorter =
+            ExternalSorter::new(&self.path.join(SORT_SPILL_DIR), order).with_cipher(self.files.cipher().cloned());
+        while let Some(id) = id_stream.next().await {
+            let id = id?;
+            if let Some(doc) = self.read_document(&id, options).await? &&
+                plan.matches(&doc)
+            {
+                let key = doc.data().get(field.as_str()).cloned();
+                if query.is_after(key.as_ref(), &id) {
+                    sorter.push(key, id).await?;
+                }
             }
-            else {
-                doc
-            };
-            final_docs.push(projected_doc);
         }
+        let mut sorted_ids = sorter.finish().await?;
 
-        Ok(final_docs)
+        let collection = self.read_view();
+        let sort_field = field.clone();
+        let projection_fields = query.projection.clone();
+        let options = *options;
+        Ok(Box::pin(stream! {
+            let mut skipped = 0_usize;
+
+            while let Some(id_result) = sorted_ids.next().await {
+                let id = match id_result {
+                    Ok(id) => id,
+                    Err(e) => {
+                        yield Err(e);
+                        continue;
+                    }
+                };
+
+                // The document may have changed or disappeared since the first pass
+                let doc = match collection.read_document(&id, &options).await {
+                    Ok(Some(doc)) if plan.matches(&doc) => doc,
+                    Ok(_) => continue,
+                    Err(e) => {
+                        yield Err(e);
+                        continue;
+                    }
+                };
+
+                if skipped < offset {
+                    skipped = skipped.saturating_add(1);
+                    continue;
+                }
+                *last.lock().unwrap() = Some(QueryCursor::after_document(&doc, Some(&sort_field)));
+                let final_doc = if let Some(ref fields) = projection_fields {
+                    project_document(doc, fields)
+                } else {
+                    doc
+                };
+                yield Ok(final_doc);
+            }
+        }))
     }
 
-    /// Executes a query without sorting, allowing streaming with early limit application and
-    /// verification.
-    async fn execute_streaming_query_with_verification(
+    /// Executes a query sorted by a field whose ordered index holds its documents in sort order.
+    ///
+    /// The index is walked from the cursor of the query, [`SORTED_INDEX_BATCH_SIZE`] documents
+    /// at a time, so only the documents up to the end of the page are read and verified, along
+    /// with those the filters reject. Documents without the sort field are not indexed: they are
+    /// listed by ID where they sort, first in ascending order and last in descending order.
+    fn execute_index_sorted_query_with_verification(
         &self,
         query: &crate::Query,
+        plan: Arc<FilterPlan>,
+        candidate_ids: Option<Vec<String>>,
         options: &crate::VerificationOptions,
+        last: Arc<Mutex<Option<QueryCursor>>>,
     ) -> Result<std::pin::Pin<Box<dyn Stream<Item = Result<Document>> + Send>>> {
-        let collection_path = self.path.clone();
-        let signing_key = self.signing_key.clone();
-        let filters = query.filters.clone();
-        let projection_fields = query.projection.clone();
-        let limit = query.limit.unwrap_or(usize::MAX);
+        let Some((ref field, order)) = query.sort
+        else {
+            return Err(SentinelError::Internal {
+                message: "sorted query executed without a sort field".to_owned(),
+            });
+        };
+        let collection = Arc::new(self.read_view());
+        let after = query.after.clone();
+
+        // Documents missing the field sort before every key, so they are only listed when the
+        // cursor does not lie past them
+        let after_missing = after
+            .as_ref()
+            .filter(|cursor| cursor.key().is_none())
+            .map(|cursor| cursor.id().to_owned());
+        let lists_missing = order == SortOrder::Descending || after.is_none() || after_missing.is_some();
+        let missing: std::pin::Pin<Box<dyn Stream<Item = Result<(Option<Value>, String)>> + Send>> = if lists_missing {
+            Self::unindexed_sort_keys(
+                &collection,
+                field.clone(),
+                candidate_ids.clone(),
+                after_missing,
+            )
+        }
+        else {
+            Box::pin(futures::stream::empty())
+        };
+        let indexed = Self::indexed_sort_keys(
+            collection.clone(),
+            field.clone(),
+            order,
+            after,
+            candidate_ids,
+        );
+        let mut keyed = match order {
+            SortOrder::Ascending => missing.chain(indexed),
+            SortOrder::Descending => indexed.chain(missing),
+        };
+
         let offset = query.offset.unwrap_or(0);
+        let limit = query.limit.unwrap_or(usize::MAX);
+        let sort_field = field.clone();
+        let projection_fields = query.projection.clone();
         let options = *options;
-
+        let metrics = self.metrics.clone();
         Ok(Box::pin(stream! {
-            let mut id_stream = stream_document_ids(collection_path.clone());
-            let mut yielded = 0;
-            let mut skipped = 0;
-
-            // Precompute filter references to avoid allocating a new Vec for each document
-            let filter_refs: Vec<_> = filters.iter().collect();
-
-            while let Some(id_result) = id_stream.next().await {
-                let id = match id_result {
-                    Ok(id) => id,
+            let mut skipped = 0_usize;
+            let mut returned = 0_usize;
+            while returned < limit && let Some(entry) = keyed.next().await {
+                let (key, id) = match entry {
+                    Ok(entry) => entry,
                     Err(e) => {
                         yield Err(e);
                         continue;
                     }
                 };
+                metrics.record_scanned();
 
-                // Load document
-                let file_path = collection_path.join(format!("{}.json", id));
-                let content = match tokio_fs::read_to_string(&file_path).await {
-                    Ok(content) => content,
+                // The document may have changed since it was indexed, and then sorts elsewhere
+                let doc = match collection.read_document(&id, &options).await {
+                    Ok(Some(doc))
+                        if plan.matches(&doc) &&
+                            compare_keys(doc.data().get(sort_field.as_str()), key.as_ref(), order) == std::cmp::Ordering::Equal =>
+                    {
+                        doc
+                    }
+                    Ok(_) => continue,
                     Err(e) => {
-                        yield Err(e.into());
+                        yield Err(e);
                         continue;
                     }
                 };
 
-                let doc = match serde_json::from_str::<Document>(&content) {
-                    Ok(doc) => {
-                        // Create a new document with the correct ID
-                        let mut doc_with_id = doc;
-                        doc_with_id.id = id.clone();
+                if skipped < offset {
+                    skipped = skipped.saturating_add(1);
+                    continue;
+                }
+                *last.lock().unwrap() = Some(QueryCursor::after_document(&doc, Some(&sort_field)));
+                returned = returned.saturating_add(1);
+                let final_doc = if let Some(ref fields) = projection_fields {
+                    project_document(doc, fields)
+                } else {
+                    doc
+                };
+                yield Ok(final_doc);
+            }
+        }))
+    }
 
-                        let collection_ref = Self {
-                            path: collection_path.clone(),
-                                                created_at: chrono::Utc::now(),
-                                                updated_at: std::sync::RwLock::new(chrono::Utc::now()),
-                                                last_checkpoint_at: std::sync::RwLock::new(None),
-                                                total_documents: std::sync::Arc::new(std::sync::atomic::AtomicU64::new(0)),
-                                                total_size_bytes: std::sync::Arc::new(std::sync::atomic::AtomicU64::new(0)),
-                            signing_key: signing_key.clone(),
-                                                stored_wal_config: sentinel_wal::CollectionWalConfig::default(),
-                                                wal_manager: None,
-                                                wal_config: sentinel_wal::CollectionWalConfig::default(),
-                                                event_sender: None,
-                                                event_task: None,
-                            recovery_mode: std::sync::atomic::AtomicBool::new(false),
-                        };
+    /// Streams the documents holding the indexed sort `field` that come after the cursor `after`
+    /// in `order`, with their sort keys, in sort order, restricted to `candidate_ids` if given.
+    fn indexed_sort_keys(
+        collection: Arc<Self>,
+        field: String,
+        order: SortOrder,
+        after: Option<QueryCursor>,
+        candidate_ids: Option<Vec<String>>,
+    ) -> std::pin::Pin<Box<dyn Stream<Item = Result<(Option<Value>, String)>> + Send>> {
+        Box::pin(stream! {
+            let mut position = after.map(|cursor| (cursor.key().cloned(), cursor.id().to_owned()));
+            loop {
+                let batch = collection.indexes.read().unwrap().sorted_after(
+                    &field,
+                    order,
+                    position.as_ref().map(|&(ref key, ref id)| (key.as_ref(), id.as_str())),
+                    SORTED_INDEX_BATCH_SIZE,
+                );
+                let Some(batch) = batch else {
+                    yield Err(SentinelError::Internal {
+                        message: format!("the ordered index on {} was dropped during the query", field),
+                    });
+                    return;
+                };
+                let exhausted = batch.len() < SORTED_INDEX_BATCH_SIZE;
+                if let Some(&(ref key, ref id)) = batch.last() {
+                    position = Some((Some(key.clone()), id.clone()));
+                }
+                for (key, id) in batch {
+                    if candidate_ids.as_ref().is_none_or(|ids| ids.binary_search(&id).is_ok()) {
+                        yield Ok((Some(key), id));
+                    }
+                }
+                if exhausted {
+                    return;
+                }
+            }
+        })
+    }
 
-                        if let Err(e) = collection_ref.verify_document(&doc_with_id, &options).await {
-                            if matches!(e, SentinelError::HashVerificationFailed { .. } | SentinelError::SignatureVerificationFailed { .. }) {
-                                if options.hash_verification_mode == crate::VerificationMode::Strict
-                                    || options.signature_verification_mode == crate::VerificationMode::Strict
-                                    || options.empty_signature_mode == crate::VerificationMode::Strict
-                                {
-                                    yield Err(e);
-                                    continue;
-                                }
-                            } else {
-                                yield Err(e);
-                                continue;
-                            }
-                        }
+    /// Streams the documents missing the indexed sort `field`, in ID order after `after` if
+    /// given, restricted to `candidate_ids` if given.
+    fn unindexed_sort_keys(
+        collection: &Arc<Self>,
+        field: String,
+        candidate_ids: Option<Vec<String>>,
+        after: Option<String>,
+    ) -> std::pin::Pin<Box<dyn Stream<Item = Result<(Option<Value>, String)>> + Send>> {
+        let ids = match candidate_ids {
+            Some(mut ids) => {
+                if let Some(ref after) = after {
+                    let start = ids.partition_point(|id| id <= after);
+                    ids.drain(.. start);
+                }
+                Box::pin(tokio_stream::iter(ids.into_iter().map(Ok)))
+                    as std::pin::Pin<Box<dyn Stream<Item = Result<String>> + Send>>
+            },
+            None => collection.list_after(after),
+        };
+        let collection = collection.clone();
+        Box::pin(ids.filter_map(move |id| {
+            let entry = match id {
+                Ok(id)
+                    if collection
+                        .indexes
+                        .read()
+                        .unwrap()
+                        .indexes_document(&field, &id) =>
+                {
+                    None
+                },
+                Ok(id) => Some(Ok((None, id))),
+                Err(e) => Some(Err(e)),
+            };
+            std::future::ready(entry)
+        }))
+    }
 
-                        doc_with_id
-                    }
+    /// Executes a query without sorting, allowing streaming with early limit application and
+    /// verification.
+    ///
+    /// When `candidate_ids` is provided, only those documents are read instead of the whole
+    /// collection. Either way the documents are read in ID order, starting right after the ID of
+    /// the cursor of the query, if any.
+    async fn execute_streaming_query_with_verification(
+        &self,
+        query: &crate::Query,
+        plan: Arc<FilterPlan>,
+        candidate_ids: Option<Vec<String>>,
+        options: &crate::VerificationOptions,
+        last: Arc<Mutex<Option<QueryCursor>>>,
+    ) -> Result<std::pin::Pin<Box<dyn Stream<Item = Result<Document>> + Send>>> {
+        let projection_fields = query.projection.clone();
+        let limit = query.limit.unwrap_or(usize::MAX);
+        let offset = query.offset.unwrap_or(0);
+
+        let from_index = candidate_ids.is_some();
+        let after = query.after.as_ref().map(QueryCursor::id);
+        let id_stream = match candidate_ids {
+            Some(mut ids) => {
+                if let Some(after) = after {
+                    let start = ids.partition_point(|id| id.as_str() <= after);
+                    ids.drain(.. start);
+                }
+                Box::pin(tokio_stream::iter(ids.into_iter().map(Ok)))
+                    as std::pin::Pin<Box<dyn Stream<Item = Result<String>> + Send>>
+            },
+            None => self.list_after(after.map(str::to_owned)),
+        };
+        let id_stream = self.metrics.count_scanned(id_stream);
+        // Indexed documents may have been removed outside of Sentinel, so missing files are
+        // skipped when reading index candidates. Without verification, documents are filtered and
+        // projected while only their tested and projected fields are decoded.
+        let lazy = !options.verify_hash && !options.verify_signature;
+        let mut documents = if lazy {
+            self.load_matching(
+                id_stream,
+                plan.clone(),
+                projection_fields.as_deref().map(Arc::from),
+                ScanOptions::default(),
+                from_index,
+            )
+        }
+        else {
+            self.load_documents(id_stream, options, ScanOptions::default(), from_index)
+        };
+
+        Ok(Box::pin(stream! {
+            let mut yielded = 0;
+            let mut skipped = 0;
+
+            while let Some(doc_result) = documents.next().await {
+                let doc = match doc_result {
+                    Ok(doc) => doc,
                     Err(e) => {
-                        yield Err(e.into());
+                        yield Err(e);
                         continue;
                     }
                 };
 
-                if matches_filters(&doc, &filter_refs) {
+                // Lazily loaded documents are already filtered and projected
+                if lazy || plan.matches(&doc) {
                     if skipped < offset {
                         skipped = skipped.saturating_add(1);
                         continue;
@@ -322,10 +569,10 @@ impl Collection {
                     if yielded >= limit {
                         break;
                     }
-                    let final_doc = if let Some(ref fields) = projection_fields {
-                        project_document(&doc, fields).await?
-                    } else {
-                        doc
+                    *last.lock().unwrap() = Some(QueryCursor::after_document(&doc, None));
+                    let final_doc = match projection_fields {
+                        Some(ref fields) if !lazy => project_document(doc, fields),
+                        _ => doc,
                     };
                     yield Ok(final_doc);
                     yielded = yielded.saturating_add(1);
@@ -333,12 +580,4 @@ impl Collection {
             }
         }))
     }
-
-    /// Compares two values for sorting purposes.
-    fn compare_values(&self, a: Option<&Value>, b: Option<&Value>) -> std::cmp::Ordering { compare_values(a, b) }
-
-    /// Projects a document to include only specified fields.
-    async fn project_document(&self, doc: &Document, fields: &[String]) -> Result<Document> {
-        project_document(doc, fields).await
-    }
 }
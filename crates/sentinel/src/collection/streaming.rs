@@ -1,9 +1,23 @@
+use std::sync::Arc;
+
 use async_stream::stream;
-use tokio::fs as tokio_fs;
+use futures::StreamExt as _;
 use tokio_stream::Stream;
-use tracing::{debug, trace};
+use tracing::trace;
 
-use crate::{streaming::stream_document_ids, Document, Result, SentinelError};
+use crate::{
+    constants::SIGNATURE_BATCH_SIZE,
+    encoding::{decode_document_with_data, LazyDocument},
+    filtering::FilterPlan,
+    layout::DocumentLocator,
+    metrics::StoreMetrics,
+    storage::DocumentFiles,
+    streaming::ScanOptions,
+    verification::VerificationContext,
+    Document,
+    Result,
+    SentinelError,
+};
 use super::coll::Collection;
 
 #[allow(
@@ -13,9 +27,11 @@ use super::coll::Collection;
 impl Collection {
     /// Lists all document IDs in the collection.
     ///
-    /// Returns a stream of document IDs from the collection directory.
-    /// IDs are streamed as they are discovered, without guaranteed ordering.
-    /// For sorted results, collect the stream and sort manually.
+    /// Returns a stream of document IDs from the collection's manifest. The manifest is checked
+    /// against the collection directory with a single stat and the directory is only rescanned
+    /// when it changed outside of Sentinel, so listing does not stat every document file.
+    /// No particular ordering is guaranteed. For sorted results, collect the stream and sort
+    /// manually.
     ///
     /// # Returns
     ///
@@ -45,16 +61,44 @@ impl Collection {
     /// # Ok(())
     /// # }
     /// ```
-    pub fn list(&self) -> std::pin::Pin<Box<dyn Stream<Item = Result<String>> + Send>> {
+    pub fn list(&self) -> std::pin::Pin<Box<dyn Stream<Item = Result<String>> + Send>> { self.list_after(None) }
+
+    /// Streams the IDs of the documents whose ID sorts after `after`, in ID order.
+    ///
+    /// The IDs before `after` are not listed at all, which lets a paged query resume where the
+    /// previous page stopped.
+    pub(crate) fn list_after(
+        &self,
+        after: Option<String>,
+    ) -> std::pin::Pin<Box<dyn Stream<Item = Result<String>> + Send>> {
         trace!("Streaming document IDs from collection: {}", self.name());
-        stream_document_ids(self.path.clone())
+        let manifest = self.manifest.clone();
+        Box::pin(stream! {
+            match manifest.document_ids_after(after.as_deref()).await {
+                Ok(ids) => {
+                    for id in ids {
+                        yield Ok(id);
+                    }
+                },
+                Err(e) => yield Err(e),
+            }
+        })
     }
 
+    /// Rebuilds the manifest of the collection by rescanning its directory.
+    ///
+    /// Documents added or removed outside of Sentinel are normally detected through the
+    /// modification time of the collection directory. Call this after changing document files
+    /// in a way that may have preserved it, such as restoring a backup with its timestamps. In a
+    /// sharded collection changes inside the shard directories do not show in that modification
+    /// time, so this is needed after any change made outside of Sentinel.
+    pub async fn rebuild_manifest(&self) -> Result<()> { self.manifest.rebuild().await }
+
     /// Filters documents in the collection using a predicate function.
     ///
-    /// This method performs streaming filtering by loading and checking documents
-    /// one by one, keeping only matching documents in memory. This approach
-    /// minimizes memory usage while maintaining good performance for most use cases.
+    /// Documents are loaded and verified by a concurrent pipeline using the default
+    /// [`ScanOptions`], keeping only matching documents in memory. Results are yielded in
+    /// directory order.
     ///
     /// By default, this method verifies both hash and signature with strict mode.
     /// Use `filter_with_verification()` to customize verification behavior.
@@ -110,9 +154,9 @@ impl Collection {
     /// Filters documents in the collection using a predicate function with custom verification
     /// options.
     ///
-    /// This method performs streaming filtering by loading and checking documents
-    /// one by one, keeping only matching documents in memory. This approach
-    /// minimizes memory usage while maintaining good performance for most use cases.
+    /// Documents are loaded and verified by a concurrent pipeline using the default
+    /// [`ScanOptions`], keeping only matching documents in memory. Results are yielded in
+    /// directory order.
     ///
     /// # Arguments
     ///
@@ -168,94 +212,83 @@ impl Collection {
     where
         F: Fn(&Document) -> bool + Send + Sync + 'static,
     {
-        let collection_path = self.path.clone();
-        let signing_key = self.signing_key.clone();
-        let options = *options;
+        self.filter_with_options(predicate, options, ScanOptions::default())
+    }
 
-        Box::pin(stream! {
-            trace!(
-                "Streaming filter on collection (verification enabled: {})",
-                options.verify_signature || options.verify_hash
-            );
-            let mut entries = match tokio_fs::read_dir(&collection_path).await {
-                Ok(entries) => entries,
-                Err(e) => {
-                    yield Err(e.into());
-                    return;
-                }
+    /// Filters documents in the collection using a predicate function with custom verification
+    /// and scan options.
+    ///
+    /// Documents are read, parsed and verified by up to `scan.concurrency` concurrent tasks. With
+    /// `scan.ordered` set to false, matching documents are yielded as soon as they are verified
+    /// rather than in directory order.
+    ///
+    /// # Arguments
+    ///
+    /// * `predicate` - A function that takes a `&Document` and returns `true` if the document
+    ///   should be included in the results.
+    /// * `options` - Verification options controlling hash and signature verification.
+    /// * `scan` - Scan options controlling concurrency and ordering.
+    ///
+    /// # Returns
+    ///
+    /// Returns a stream of documents that match the predicate.
+    ///
+    /// # Example
+    ///
+    /// ```rust
+    /// use sentinel_dbms::{Store, Collection, ScanOptions, VerificationOptions};
+    /// use serde_json::json;
+    /// use futures::TryStreamExt;
+    ///
+    /// # async fn example() -> sentinel_dbms::Result<()> {
+    /// let store = Store::new("/path/to/data", None).await?;
+    /// let collection = store.collection("users").await?;
+    ///
+    /// collection.insert("user-1", json!({"name": "Alice", "age": 25})).await?;
+    /// collection.insert("user-2", json!({"name": "Bob", "age": 30})).await?;
+    ///
+    /// let adults: Vec<_> = collection
+    ///     .filter_with_options(
+    ///         |doc| doc.data().get("age").and_then(|v| v.as_i64()).map_or(false, |age| age > 26),
+    ///         &VerificationOptions::default(),
+    ///         ScanOptions::unordered(),
+    ///     )
+    ///     .try_collect()
+    ///     .await?;
+    /// assert_eq!(adults.len(), 1);
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn filter_with_options<F>(
+        &self,
+        predicate: F,
+        options: &crate::VerificationOptions,
+        scan: ScanOptions,
+    ) -> std::pin::Pin<Box<dyn Stream<Item = Result<Document>> + Send>>
+    where
+        F: Fn(&Document) -> bool + Send + Sync + 'static,
+    {
+        trace!(
+            "Streaming filter on collection (verification enabled: {}, concurrency: {}, ordered: {})",
+            options.verify_signature || options.verify_hash,
+            scan.concurrency,
+            scan.ordered
+        );
+        let documents = self.load_documents(self.list(), options, scan, false);
+        Box::pin(documents.filter(move |result| {
+            let keep = match *result {
+                Ok(ref doc) => predicate(doc),
+                Err(_) => true,
             };
-
-            loop {
-                let entry = match entries.next_entry().await {
-                    Ok(Some(entry)) => entry,
-                    Ok(None) => break,
-                    Err(e) => {
-                        yield Err(e.into());
-                        continue;
-                    }
-                };
-
-                let path = entry.path();
-                if !tokio_fs::metadata(&path).await.map(|m| m.is_dir()).unwrap_or(false)
-                    && let Some(file_name) = path.file_name().and_then(|n| n.to_str())
-                        && file_name.ends_with(".json") && !file_name.starts_with('.') {
-                            let id = file_name.strip_suffix(".json").unwrap();
-                            let file_path = collection_path.join(format!("{}.json", id));
-                            match tokio_fs::read_to_string(&file_path).await {
-                                Ok(content) => {
-                                    match serde_json::from_str::<Document>(&content) {
-                                        Ok(mut doc) => {
-                                            doc.id = id.to_owned();
-
-                                            let collection_ref = Self {
-                                                path: collection_path.clone(),
-                                                created_at: chrono::Utc::now(),
-                                                updated_at: std::sync::RwLock::new(chrono::Utc::now()),
-                                                last_checkpoint_at: std::sync::RwLock::new(None),
-                                                total_documents: std::sync::Arc::new(std::sync::atomic::AtomicU64::new(0)),
-                                                total_size_bytes: std::sync::Arc::new(std::sync::atomic::AtomicU64::new(0)),
-                                                signing_key: signing_key.clone(),
-                                                wal_manager: None,
-                                                stored_wal_config: sentinel_wal::CollectionWalConfig::default(),
-                                                wal_config: sentinel_wal::CollectionWalConfig::default(),
-                                                event_sender: None,
-                                                event_task: None,
-                                                recovery_mode: std::sync::atomic::AtomicBool::new(false),
-                                            };
-
-                                            if let Err(e) = collection_ref.verify_document(&doc, &options).await {
-                                                if matches!(e, SentinelError::HashVerificationFailed { .. } | SentinelError::SignatureVerificationFailed { .. }) {
-                                                    if options.hash_verification_mode == crate::VerificationMode::Strict
-                                                        || options.signature_verification_mode == crate::VerificationMode::Strict
-                                                    {
-                                                        yield Err(e);
-                                                        continue;
-                                                    }
-                                                } else {
-                                                    yield Err(e);
-                                                    continue;
-                                                }
-                                            }
-
-                                            if predicate(&doc) {
-                                                yield Ok(doc);
-                                            }
-                                        }
-                                        Err(e) => yield Err(e.into()),
-                                    }
-                                }
-                                Err(e) => yield Err(e.into()),
-                            }
-                        }
-            }
-            debug!("Streaming filter completed");
-        })
+            std::future::ready(keep)
+        }))
     }
 
     /// Streams all documents in the collection.
     ///
-    /// This method performs streaming by loading documents one by one,
-    /// minimizing memory usage.
+    /// Documents are loaded and verified by a concurrent pipeline using the default
+    /// [`ScanOptions`], keeping only a bounded number of documents in memory. Results are yielded
+    /// in directory order.
     ///
     /// By default, this method verifies both hash and signature with strict mode.
     /// Use `all_with_verification()` to customize verification behavior.
@@ -289,8 +322,9 @@ impl Collection {
 
     /// Streams all documents in the collection with custom verification options.
     ///
-    /// This method performs streaming by loading documents one by one,
-    /// minimizing memory usage.
+    /// Documents are loaded and verified by a concurrent pipeline using the default
+    /// [`ScanOptions`], keeping only a bounded number of documents in memory. Results are yielded
+    /// in directory order.
     ///
     /// # Arguments
     ///
@@ -324,85 +358,242 @@ impl Collection {
         &self,
         options: &crate::VerificationOptions,
     ) -> std::pin::Pin<Box<dyn Stream<Item = Result<Document>> + Send>> {
-        let collection_path = self.path.clone();
-        let signing_key = self.signing_key.clone();
-        let options = *options;
+        self.all_with_options(options, ScanOptions::default())
+    }
 
-        Box::pin(stream! {
-            trace!(
-                "Streaming all documents on collection (verification enabled: {})",
-                options.verify_signature || options.verify_hash
-            );
-            let mut entries = match tokio_fs::read_dir(&collection_path).await {
-                Ok(entries) => entries,
-                Err(e) => {
-                    yield Err(e.into());
-                    return;
-                }
-            };
+    /// Streams all documents in the collection with custom verification and scan options.
+    ///
+    /// Documents are read, parsed and verified by up to `scan.concurrency` concurrent tasks. With
+    /// `scan.ordered` set to false, documents are yielded as soon as they are verified rather than
+    /// in directory order.
+    ///
+    /// # Arguments
+    ///
+    /// * `options` - Verification options controlling hash and signature verification.
+    /// * `scan` - Scan options controlling concurrency and ordering.
+    ///
+    /// # Returns
+    ///
+    /// Returns a stream of all documents in the collection.
+    ///
+    /// # Example
+    ///
+    /// ```rust
+    /// use sentinel_dbms::{Collection, ScanOptions, Store, VerificationOptions};
+    /// use futures::stream::StreamExt;
+    ///
+    /// # async fn example() -> sentinel_dbms::Result<()> {
+    /// let store = Store::new("/path/to/data", None).await?;
+    /// let collection = store.collection("users").await?;
+    ///
+    /// // Verify every document using 16 concurrent loaders
+    /// let scan = ScanOptions {
+    ///     concurrency: 16,
+    ///     ordered:     false,
+    /// };
+    /// let mut all_docs =
+    ///     collection.all_with_options(&VerificationOptions::strict(), scan);
+    /// while let Some(doc) = all_docs.next().await {
+    ///     let doc = doc?;
+    ///     println!("Document: {}", doc.id());
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn all_with_options(
+        &self,
+        options: &crate::VerificationOptions,
+        scan: ScanOptions,
+    ) -> std::pin::Pin<Box<dyn Stream<Item = Result<Document>> + Send>> {
+        trace!(
+            "Streaming all documents on collection (verification enabled: {}, concurrency: {}, ordered: {})",
+            options.verify_signature || options.verify_hash,
+            scan.concurrency,
+            scan.ordered
+        );
+        self.load_documents(self.list(), options, scan, false)
+    }
+
+    /// Loads and verifies the documents named by `ids` as a concurrent pipeline.
+    ///
+    /// Each document is read, parsed and hash-checked on its own runtime task, with at most
+    /// `scan.concurrency` tasks in flight. The loaded documents are then gathered into batches of
+    /// up to [`SIGNATURE_BATCH_SIZE`] whose signatures are verified together, each batch on its
+    /// own task. When `skip_missing` is set, IDs whose file no longer exists are dropped instead
+    /// of producing an error, which index lookups rely on.
+    pub(crate) fn load_documents(
+        &self,
+        ids: std::pin::Pin<Box<dyn Stream<Item = Result<String>> + Send>>,
+        options: &crate::VerificationOptions,
+        scan: ScanOptions,
+        skip_missing: bool,
+    ) -> std::pin::Pin<Box<dyn Stream<Item = Result<Document>> + Send>> {
+        let locator = self.locator();
+        let context = Arc::new(self.verification_context(*options));
+        let signature_context = context.clone();
+        let concurrency = scan.concurrency.max(1);
+        let metrics = self.metrics.clone();
+        let files = self.files.clone();
 
-            loop {
-                let entry = match entries.next_entry().await {
-                    Ok(Some(entry)) => entry,
-                    Ok(None) => break,
-                    Err(e) => {
-                        yield Err(e.into());
-                        continue;
+        let tasks = ids.map(move |id_result| {
+            let locator = locator.clone();
+            let context = context.clone();
+            let metrics = metrics.clone();
+            let files = files.clone();
+            async move {
+                let id = id_result?;
+                tokio::spawn(async move {
+                    Self::load_verified(&locator, id, &files, &context, &metrics, skip_missing).await
+                })
+                .await
+                .map_err(|e| {
+                    SentinelError::Internal {
+                        message: format!("Document load task failed: {}", e),
                     }
-                };
+                })?
+            }
+        });
 
-                let path = entry.path();
-                if !tokio_fs::metadata(&path).await.map(|m| m.is_dir()).unwrap_or(false)
-                    && let Some(file_name) = path.file_name().and_then(|n| n.to_str())
-                        && file_name.ends_with(".json") && !file_name.starts_with('.') {
-                            let id = file_name.strip_suffix(".json").unwrap();
-                            let file_path = collection_path.join(format!("{}.json", id));
-                            match tokio_fs::read_to_string(&file_path).await {
-                                Ok(content) => {
-                                    match serde_json::from_str::<Document>(&content) {
-                                        Ok(mut doc) => {
-                                            doc.id = id.to_owned();
+        let loaded: std::pin::Pin<Box<dyn Stream<Item = Result<Option<Document>>> + Send>> = if scan.ordered {
+            Box::pin(tasks.buffered(concurrency))
+        }
+        else {
+            Box::pin(tasks.buffer_unordered(concurrency))
+        };
 
-                                            let collection_ref = Self {
-                                                path: collection_path.clone(),
-                                                created_at: chrono::Utc::now(),
-                                                updated_at: std::sync::RwLock::new(chrono::Utc::now()),
-                                                last_checkpoint_at: std::sync::RwLock::new(None),
-                                                total_documents: std::sync::Arc::new(std::sync::atomic::AtomicU64::new(0)),
-                                                total_size_bytes: std::sync::Arc::new(std::sync::atomic::AtomicU64::new(0)),
-                                                signing_key: signing_key.clone(),
-                                                wal_manager: None,
-                                                stored_wal_config: sentinel_wal::CollectionWalConfig::default(),
-                                                wal_config: sentinel_wal::CollectionWalConfig::default(),
-                                                event_sender: None,
-                                                event_task: None,
-                                                recovery_mode: std::sync::atomic::AtomicBool::new(false),
-                                            };
+        let batches = loaded
+            .filter_map(|result| std::future::ready(result.transpose()))
+            .ready_chunks(SIGNATURE_BATCH_SIZE)
+            .map(move |batch| {
+                let context = signature_context.clone();
+                async move {
+                    tokio::spawn(async move { context.verify_signatures(batch).await })
+                        .await
+                        .map_err(|e| {
+                            SentinelError::Internal {
+                                message: format!("Signature verification task failed: {}", e),
+                            }
+                        })
+                }
+            });
+        let verified: std::pin::Pin<Box<dyn Stream<Item = Result<Vec<Result<Document>>>> + Send>> = if scan.ordered {
+            Box::pin(batches.buffered(concurrency))
+        }
+        else {
+            Box::pin(batches.buffer_unordered(concurrency))
+        };
 
-                                            if let Err(e) = collection_ref.verify_document(&doc, &options).await {
-                                                if matches!(e, SentinelError::HashVerificationFailed { .. } | SentinelError::SignatureVerificationFailed { .. }) {
-                                                    if options.hash_verification_mode == crate::VerificationMode::Strict
-                                                        || options.signature_verification_mode == crate::VerificationMode::Strict
-                                                    {
-                                                        yield Err(e);
-                                                        continue;
-                                                    }
-                                                } else {
-                                                    yield Err(e);
-                                                    continue;
-                                                }
-                                            }
+        Box::pin(verified.flat_map(|batch| {
+            futures::stream::iter(match batch {
+                Ok(docs) => docs,
+                Err(e) => vec![Err(e)],
+            })
+        }))
+    }
 
-                                            yield Ok(doc);
-                                        }
-                                        Err(e) => yield Err(e.into()),
-                                    }
-                                }
-                                Err(e) => yield Err(e.into()),
-                            }
-                        }
+    /// Reads, parses and verifies a single document for [`Self::load_documents`], leaving a
+    /// present signature to the batch verification that follows.
+    ///
+    /// Returns `Ok(None)` when the document file is missing and `skip_missing` is set.
+    async fn load_verified(
+        locator: &DocumentLocator,
+        id: String,
+        files: &DocumentFiles,
+        context: &VerificationContext,
+        metrics: &StoreMetrics,
+        skip_missing: bool,
+    ) -> Result<Option<Document>> {
+        let Some(content) = Self::read_file(locator, &id, files, metrics, skip_missing).await?
+        else {
+            return Ok(None);
+        };
+
+        let (mut doc, canonical_data) = decode_document_with_data(&content)?;
+        doc.id = id;
+        context
+            .verify_document_except_signature(&doc, canonical_data)
+            .await?;
+        Ok(Some(doc))
+    }
+
+    /// Reads the bytes of the document file for `id` from `files`, decrypted when the file is
+    /// encrypted, or `None` when it is missing and `skip_missing` is set, recording the bytes
+    /// read in `metrics`.
+    async fn read_file(
+        locator: &DocumentLocator,
+        id: &str,
+        files: &DocumentFiles,
+        metrics: &StoreMetrics,
+        skip_missing: bool,
+    ) -> Result<Option<Vec<u8>>> {
+        let file_path = locator.resolve(id).await;
+        match files.read(&file_path).await? {
+            Some((content, file_len)) => {
+                metrics.record_read(file_len);
+                Ok(Some(content))
+            },
+            // Indexed documents may have been removed outside of Sentinel
+            None if skip_missing => Ok(None),
+            None => Err(std::io::Error::from(std::io::ErrorKind::NotFound).into()),
+        }
+    }
+
+    /// Loads the documents named by `ids` that match `plan`, without verifying them.
+    ///
+    /// Each file is parsed as a [`LazyDocument`], so the filters only decode the fields they
+    /// test, and a matching document is built from the `projection` fields alone when a
+    /// projection is given. Used instead of [`Self::load_documents`] when verification is
+    /// disabled, since verifying a hash needs the fully decoded data.
+    pub(crate) fn load_matching(
+        &self,
+        ids: std::pin::Pin<Box<dyn Stream<Item = Result<String>> + Send>>,
+        plan: Arc<FilterPlan>,
+        projection: Option<Arc<[String]>>,
+        scan: ScanOptions,
+        skip_missing: bool,
+    ) -> std::pin::Pin<Box<dyn Stream<Item = Result<Document>> + Send>> {
+        let locator = self.locator();
+        let concurrency = scan.concurrency.max(1);
+        let metrics = self.metrics.clone();
+        let files = self.files.clone();
+
+        let tasks = ids.map(move |id_result| {
+            let locator = locator.clone();
+            let plan = plan.clone();
+            let projection = projection.clone();
+            let metrics = metrics.clone();
+            let files = files.clone();
+            async move {
+                let id = id_result?;
+                tokio::spawn(async move {
+                    let Some(content) = Self::read_file(&locator, &id, &files, &metrics, skip_missing).await?
+                    else {
+                        return Ok(None);
+                    };
+                    let lazy = LazyDocument::parse(&content)?;
+                    if !plan.matches(&lazy) {
+                        return Ok(None);
+                    }
+                    let mut doc = lazy.into_projected(projection.as_deref().unwrap_or_default())?;
+                    doc.id = id;
+                    Ok(Some(doc))
+                })
+                .await
+                .map_err(|e| {
+                    SentinelError::Internal {
+                        message: format!("Document load task failed: {}", e),
+                    }
+                })?
             }
-            debug!("Streaming all completed");
-        })
+        });
+
+        let loaded: std::pin::Pin<Box<dyn Stream<Item = Result<Option<Document>>> + Send>> = if scan.ordered {
+            Box::pin(tasks.buffered(concurrency))
+        }
+        else {
+            Box::pin(tasks.buffer_unordered(concurrency))
+        };
+
+        Box::pin(loaded.filter_map(|result| std::future::ready(result.transpose())))
     }
 }
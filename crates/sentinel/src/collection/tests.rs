@@ -1,13 +1,15 @@
 #[cfg(test)]
 mod tests {
+    use std::sync::Arc;
+
     use serde_json::{self, json};
     use tempfile;
     use tokio::fs;
-    use futures::TryStreamExt;
+    use futures::{StreamExt as _, TryStreamExt};
 
     use crate::{Collection, Document, SentinelError, Store};
 
-    async fn setup_collection() -> (Collection, tempfile::TempDir) {
+    async fn setup_collection() -> (Arc<Collection>, tempfile::TempDir) {
         let temp_dir = tempfile::tempdir().unwrap();
         let store = Store::new_with_config(
             temp_dir.path(),
@@ -20,7 +22,7 @@ mod tests {
         (collection, temp_dir)
     }
 
-    async fn setup_collection_with_signing_key() -> (Collection, tempfile::TempDir) {
+    async fn setup_collection_with_signing_key() -> (Arc<Collection>, tempfile::TempDir) {
         let temp_dir = tempfile::tempdir().unwrap();
         let store = Store::new_with_config(
             temp_dir.path(),
@@ -693,6 +695,45 @@ mod tests {
         assert_eq!(docs.len(), 3);
     }
 
+    #[tokio::test]
+    async fn test_all_with_verification_batches_signatures() {
+        let (collection, _temp_dir) = setup_collection_with_signing_key().await;
+
+        for i in 0 .. 100 {
+            collection
+                .insert(&format!("signed-{}", i), json!({ "id": i }))
+                .await
+                .unwrap();
+        }
+        // Give one document the signature of another
+        let donor = collection.get("signed-1").await.unwrap().unwrap();
+        let mut forged = collection.get("signed-42").await.unwrap().unwrap();
+        forged.signature = donor.signature().to_owned();
+        let path = collection.path.join("signed-42.json");
+        fs::write(&path, serde_json::to_vec(&forged).unwrap())
+            .await
+            .unwrap();
+
+        let results: Vec<_> = collection
+            .all_with_verification(&crate::VerificationOptions::strict())
+            .collect()
+            .await;
+        assert_eq!(results.len(), 100);
+        let failed: Vec<_> = results.iter().filter(|result| result.is_err()).collect();
+        assert_eq!(failed.len(), 1);
+        assert!(matches!(
+            *failed[0],
+            Err(SentinelError::SignatureVerificationFailed { ref id, .. }) if id == "signed-42"
+        ));
+
+        let warned: Vec<_> = collection
+            .all_with_verification(&crate::VerificationOptions::warn())
+            .try_collect()
+            .await
+            .unwrap();
+        assert_eq!(warned.len(), 100);
+    }
+
     #[tokio::test]
     async fn test_filter_empty_result() {
         let (collection, _temp_dir) = setup_collection().await;
@@ -757,6 +798,96 @@ mod tests {
         assert_eq!(results.len(), 3);
     }
 
+    #[tokio::test]
+    async fn test_all_with_options_ordered_matches_sequential() {
+        let (collection, _temp_dir) = setup_collection_with_signing_key().await;
+
+        for i in 0 .. 20 {
+            collection
+                .insert(&format!("doc-{}", i), json!({ "id": i }))
+                .await
+                .unwrap();
+        }
+
+        let options = crate::VerificationOptions::strict();
+        let sequential: Vec<_> = collection
+            .all_with_options(&options, crate::ScanOptions::sequential())
+            .try_collect()
+            .await
+            .unwrap();
+        let parallel: Vec<_> = collection
+            .all_with_options(
+                &options,
+                crate::ScanOptions {
+                    concurrency: 8,
+                    ordered:     true,
+                },
+            )
+            .try_collect()
+            .await
+            .unwrap();
+
+        let sequential_ids: Vec<_> = sequential.iter().map(|d| d.id().to_owned()).collect();
+        let parallel_ids: Vec<_> = parallel.iter().map(|d| d.id().to_owned()).collect();
+        assert_eq!(sequential_ids.len(), 20);
+        assert_eq!(sequential_ids, parallel_ids);
+    }
+
+    #[tokio::test]
+    async fn test_filter_with_options_unordered() {
+        let (collection, _temp_dir) = setup_collection_with_signing_key().await;
+
+        for i in 0 .. 20 {
+            collection
+                .insert(
+                    &format!("doc-{}", i),
+                    json!({ "id": i, "even": i % 2 == 0 }),
+                )
+                .await
+                .unwrap();
+        }
+
+        let options = crate::VerificationOptions::strict();
+        let results: Vec<_> = collection
+            .filter_with_options(
+                |doc| doc.data().get("even") == Some(&json!(true)),
+                &options,
+                crate::ScanOptions::unordered(),
+            )
+            .try_collect()
+            .await
+            .unwrap();
+
+        let ids: std::collections::HashSet<_> = results.iter().map(|d| d.id().to_owned()).collect();
+        assert_eq!(ids.len(), 10);
+        for i in (0 .. 20).step_by(2) {
+            assert!(ids.contains(&format!("doc-{}", i)));
+        }
+    }
+
+    #[tokio::test]
+    async fn test_all_with_options_unordered_reports_corrupted_documents() {
+        let (collection, _temp_dir) = setup_collection().await;
+
+        for i in 0 .. 5 {
+            collection
+                .insert(&format!("doc-{}", i), json!({ "id": i }))
+                .await
+                .unwrap();
+        }
+        fs::write(collection.path.join("broken.json"), "{ not json")
+            .await
+            .unwrap();
+
+        let results: Vec<_> = futures::StreamExt::collect(collection.all_with_options(
+            &crate::VerificationOptions::disabled(),
+            crate::ScanOptions::unordered(),
+        ))
+        .await;
+        assert_eq!(results.len(), 6);
+        assert_eq!(results.iter().filter(|r| r.is_err()).count(), 1);
+    }
+
     #[tokio::test]
     async fn test_bulk_insert_empty_all() {
         let (collection, _temp_dir) = setup_collection().await;
@@ -915,6 +1046,161 @@ mod tests {
         }
     }
 
+    #[tokio::test]
+    async fn test_query_with_sort_limit_and_offset() {
+        let (collection, _temp_dir) = setup_collection().await;
+
+        for i in [3, 9, 1, 7, 5, 0, 8, 2, 6, 4] {
+            let doc = json!({ "id": i, "even": i % 2 == 0 });
+            collection.insert(&format!("doc-{}", i), doc).await.unwrap();
+        }
+
+        let query = crate::QueryBuilder::new()
+            .filter("even", crate::Operator::Equals, json!(true))
+            .sort("id", crate::SortOrder::Descending)
+            .offset(1)
+            .limit(3)
+            .build();
+        let result = collection.query(query).await.unwrap();
+        let docs: Vec<_> = result.documents.try_collect().await.unwrap();
+
+        let ids: Vec<_> = docs.iter().map(|d| d.data()["id"].clone()).collect();
+        assert_eq!(ids, vec![json!(6), json!(4), json!(2)]);
+    }
+
+    #[tokio::test]
+    async fn test_query_with_sort_and_offset_without_limit() {
+        let (collection, temp_dir) = setup_collection().await;
+
+        for i in (0 .. 6).rev() {
+            let doc = json!({ "id": i });
+            collection.insert(&format!("doc-{}", i), doc).await.unwrap();
+        }
+        // Documents without the sort field sort first in ascending order
+        collection
+            .insert("doc-missing", json!({ "other": true }))
+            .await
+            .unwrap();
+
+        let query = crate::QueryBuilder::new()
+            .sort("id", crate::SortOrder::Ascending)
+            .offset(2)
+            .projection(vec!["id"])
+            .build();
+        let result = collection.query(query).await.unwrap();
+        let docs: Vec<_> = result.documents.try_collect().await.unwrap();
+
+        let ids: Vec<_> = docs.iter().map(|d| d.data()["id"].clone()).collect();
+        assert_eq!(ids, vec![json!(1), json!(2), json!(3), json!(4), json!(5)]);
+
+        // No spilled sort runs are left behind
+        let spill_dir = temp_dir
+            .path()
+            .join("data")
+            .join("test")
+            .join(crate::SORT_SPILL_DIR);
+        assert!(
+            !fs::try_exists(&spill_dir).await.unwrap() ||
+                fs::read_dir(&spill_dir)
+                    .await
+                    .unwrap()
+                    .next_entry()
+                    .await
+                    .unwrap()
+                    .is_none()
+        );
+    }
+
+    /// Reads every page of `query` by following the cursor of each page, returning the documents
+    /// of every page.
+    async fn read_pages(collection: &Collection, query: crate::QueryBuilder, page_size: usize) -> Vec<Vec<Document>> {
+        let mut pages = Vec::new();
+        let mut cursor = None;
+        loop {
+            let mut page_query = query.clone().limit(page_size);
+            if let Some(cursor) = cursor.take() {
+                page_query = page_query.after(cursor);
+            }
+            let mut result = collection.query(page_query.build()).await.unwrap();
+            let mut page = Vec::new();
+            while let Some(doc) = result.documents.next().await {
+                page.push(doc.unwrap());
+            }
+            if page.is_empty() {
+                return pages;
+            }
+            cursor = result.next_cursor();
+            pages.push(page);
+        }
+    }
+
+    #[tokio::test]
+    async fn test_query_pages_with_cursor() {
+        let (collection, _temp_dir) = setup_collection().await;
+
+        for i in 0 .. 7 {
+            let doc = json!({ "group": i % 3, "even": i % 2 == 0 });
+            collection.insert(&format!("doc-{}", i), doc).await.unwrap();
+        }
+
+        // Unsorted pages follow the ID order
+        let pages = read_pages(&collection, crate::QueryBuilder::new(), 3).await;
+        let ids: Vec<Vec<&str>> = pages
+            .iter()
+            .map(|page| page.iter().map(Document::id).collect())
+            .collect();
+        assert_eq!(
+            ids,
+            vec![
+                vec!["doc-0", "doc-1", "doc-2"],
+                vec!["doc-3", "doc-4", "doc-5"],
+                vec!["doc-6"],
+            ]
+        );
+
+        // Sorted pages break ties by ID, even when the projection drops the sort field
+        let query = crate::QueryBuilder::new()
+            .sort("group", crate::SortOrder::Descending)
+            .projection(vec!["even"]);
+        let ids: Vec<String> = read_pages(&collection, query, 2)
+            .await
+            .into_iter()
+            .flatten()
+            .map(|doc| doc.id().to_owned())
+            .collect();
+        assert_eq!(
+            ids,
+            vec!["doc-2", "doc-5", "doc-1", "doc-4", "doc-0", "doc-3", "doc-6"]
+        );
+
+        // Filtered pages resume within the matching documents
+        let query = crate::QueryBuilder::new().filter("even", crate::Operator::Equals, json!(true));
+        let ids: Vec<String> = read_pages(&collection, query, 3)
+            .await
+            .into_iter()
+            .flatten()
+            .map(|doc| doc.id().to_owned())
+            .collect();
+        assert_eq!(ids, vec!["doc-0", "doc-2", "doc-4", "doc-6"]);
+
+        // Without a limit, a sorted query returns everything after the cursor
+        let cursor = crate::QueryCursor::new(Some(json!(1)), "doc-1".to_owned());
+        let query = crate::QueryBuilder::new()
+            .sort("group", crate::SortOrder::Ascending)
+            .after(cursor)
+            .build();
+        let docs: Vec<_> = collection
+            .query(query)
+            .await
+            .unwrap()
+            .documents
+            .try_collect()
+            .await
+            .unwrap();
+        let ids: Vec<&str> = docs.iter().map(Document::id).collect();
+        assert_eq!(ids, vec!["doc-4", "doc-2", "doc-5"]);
+    }
+
     #[tokio::test]
     async fn test_query_with_projection() {
         let (collection, _temp_dir) = setup_collection().await;
@@ -1012,6 +1298,53 @@ mod tests {
         assert_eq!(docs[0].data()["name"], json!("Diana"));
     }
 
+    #[tokio::test]
+    async fn test_query_nested_fields() {
+        let (collection, _temp_dir) = setup_collection().await;
+        collection
+            .insert(
+                "doc1",
+                json!({ "name": "Alice", "address": { "city": "Paris", "zip": "75001" } }),
+            )
+            .await
+            .unwrap();
+        collection
+            .insert(
+                "doc2",
+                json!({ "name": "Bob", "address": { "city": "Rome", "zip": "00118" } }),
+            )
+            .await
+            .unwrap();
+
+        let query = crate::QueryBuilder::new()
+            .filter("address.city", crate::Operator::Equals, json!("Paris"))
+            .build();
+        let docs: Vec<_> = collection
+            .query(query)
+            .await
+            .unwrap()
+            .documents
+            .try_collect()
+            .await
+            .unwrap();
+        assert_eq!(docs.len(), 1);
+        assert_eq!(docs[0].id(), "doc1");
+
+        let query = crate::QueryBuilder::new()
+            .filter("/address/zip", crate::Operator::StartsWith, json!("00"))
+            .build();
+        let docs: Vec<_> = collection
+            .query_with_verification(query, &crate::VerificationOptions::disabled())
+            .await
+            .unwrap()
+            .documents
+            .try_collect()
+            .await
+            .unwrap();
+        assert_eq!(docs.len(), 1);
+        assert_eq!(docs[0].id(), "doc2");
+    }
+
     #[tokio::test]
     async fn test_delete_and_recover() {
         let (collection, _temp_dir) = setup_collection().await;
@@ -1134,6 +1467,54 @@ mod tests {
         assert!(result.is_ok());
     }
 
+    #[tokio::test]
+    async fn test_verify_hash_of_compact_file() {
+        let (collection, _temp_dir) = setup_collection().await;
+        collection
+            .set_document_encoding(crate::DocumentEncoding::Compact)
+            .await
+            .unwrap();
+        collection
+            .insert("compact", json!({ "a": 1, "b": 2 }))
+            .await
+            .unwrap();
+        let options = crate::VerificationOptions {
+            verify_signature:            false,
+            verify_hash:                 true,
+            signature_verification_mode: crate::VerificationMode::Strict,
+            empty_signature_mode:        crate::VerificationMode::Silent,
+            hash_verification_mode:      crate::VerificationMode::Strict,
+        };
+        assert!(collection
+            .get_with_verification("compact", &options)
+            .await
+            .unwrap()
+            .is_some());
+
+        // Same data in a non-canonical form still verifies
+        let path = collection.path.join("compact.json");
+        let content = fs::read_to_string(&path).await.unwrap();
+        let reordered = content.replace(r#""a":1,"b":2"#, r#""b":2, "a":1"#);
+        assert_ne!(reordered, content);
+        fs::write(&path, &reordered).await.unwrap();
+        let doc = collection
+            .get_with_verification("compact", &options)
+            .await
+            .unwrap()
+            .unwrap();
+        assert_eq!(doc.data(), &json!({ "a": 1, "b": 2 }));
+
+        // Changed data does not
+        fs::write(&path, reordered.replace(r#""a":1"#, r#""a":10"#))
+            .await
+            .unwrap();
+        let result = collection.get_with_verification("compact", &options).await;
+        assert!(matches!(
+            result,
+            Err(SentinelError::HashVerificationFailed { .. })
+        ));
+    }
+
     #[tokio::test]
     async fn test_verify_hash_invalid() {
         let (collection, _temp_dir) = setup_collection_with_signing_key().await;
@@ -1298,6 +1679,44 @@ mod tests {
         assert!(ids.contains("doc-4"));
     }
 
+    #[tokio::test]
+    async fn test_list_tracks_manifest_across_reopen() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        {
+            let store = Store::new(temp_dir.path(), None).await.unwrap();
+            let collection = store.collection("test").await.unwrap();
+            for i in 0 .. 3 {
+                collection
+                    .insert(&format!("doc-{}", i), json!({ "id": i }))
+                    .await
+                    .unwrap();
+            }
+            collection.delete("doc-1").await.unwrap();
+            assert!(collection
+                .path
+                .join(crate::COLLECTION_MANIFEST_FILE)
+                .exists());
+        }
+
+        let store = Store::new(temp_dir.path(), None).await.unwrap();
+        let collection = store.collection("test").await.unwrap();
+        let mut ids: Vec<_> = collection.list().try_collect().await.unwrap();
+        ids.sort();
+        assert_eq!(ids, vec!["doc-0", "doc-2"]);
+
+        // Files added outside of Sentinel are picked up through the directory modification time
+        fs::write(collection.path.join("external.json"), "{}")
+            .await
+            .unwrap();
+        let ids: Vec<_> = collection.list().try_collect().await.unwrap();
+        assert_eq!(ids.len(), 3);
+        assert!(ids.contains(&"external".to_owned()));
+
+        collection.rebuild_manifest().await.unwrap();
+        let ids: Vec<_> = collection.list().try_collect().await.unwrap();
+        assert_eq!(ids.len(), 3);
+    }
+
     #[tokio::test]
     async fn test_count_method() {
         // Test line 449-452: count() method trace logs
@@ -1727,6 +2146,8 @@ mod tests {
 
 #[cfg(test)]
 mod persistence_tests {
+    use std::sync::Arc;
+
     use tempfile::tempdir;
     use tokio::fs;
     use futures::TryStreamExt;
@@ -1735,7 +2156,7 @@ mod persistence_tests {
     use super::*;
     use crate::{Collection, CollectionMetadata, Document, Store};
 
-    async fn setup_collection_with_signing_key() -> (Collection, tempfile::TempDir) {
+    async fn setup_collection_with_signing_key() -> (Arc<Collection>, tempfile::TempDir) {
         let temp_dir = tempfile::tempdir().unwrap();
         let store = Store::new_with_config(
             temp_dir.path(),
@@ -1748,7 +2169,7 @@ mod persistence_tests {
         (collection, temp_dir)
     }
 
-    async fn setup_collection() -> (Collection, tempfile::TempDir) {
+    async fn setup_collection() -> (Arc<Collection>, tempfile::TempDir) {
         let temp_dir = tempfile::tempdir().unwrap();
         let store = Store::new_with_config(
             temp_dir.path(),
@@ -1908,7 +2329,7 @@ mod persistence_tests {
 
     #[tokio::test]
     async fn test_collection_wal_config_methods() {
-        let (collection, _temp_dir): (Collection, tempfile::TempDir) = setup_collection().await;
+        let (collection, _temp_dir): (Arc<Collection>, tempfile::TempDir) = setup_collection().await;
 
         // Test stored_wal_config
         let stored = collection.stored_wal_config();
@@ -1923,7 +2344,7 @@ mod persistence_tests {
 
     #[tokio::test]
     async fn test_all_with_verification_hash_failure_strict() {
-        let (collection, _temp_dir): (Collection, tempfile::TempDir) = setup_collection_with_signing_key().await;
+        let (collection, _temp_dir): (Arc<Collection>, tempfile::TempDir) = setup_collection_with_signing_key().await;
 
         // Insert a valid document
         let doc = json!({"name": "Valid"});
@@ -1953,7 +2374,7 @@ mod persistence_tests {
 
     #[tokio::test]
     async fn test_all_with_verification_hash_failure_warn() {
-        let (collection, _temp_dir): (Collection, tempfile::TempDir) = setup_collection_with_signing_key().await;
+        let (collection, _temp_dir): (Arc<Collection>, tempfile::TempDir) = setup_collection_with_signing_key().await;
 
         // Insert a valid document
         let doc = json!({"name": "Valid"});
@@ -1985,7 +2406,7 @@ mod persistence_tests {
 
     #[tokio::test]
     async fn test_filter_with_verification_signature_failure_strict() {
-        let (collection, _temp_dir): (Collection, tempfile::TempDir) = setup_collection_with_signing_key().await;
+        let (collection, _temp_dir): (Arc<Collection>, tempfile::TempDir) = setup_collection_with_signing_key().await;
 
         // Insert a valid document
         let doc = json!({"name": "Valid", "status": "active"});
@@ -2018,7 +2439,7 @@ mod persistence_tests {
 
     #[tokio::test]
     async fn test_filter_with_verification_signature_failure_warn() {
-        let (collection, _temp_dir): (Collection, tempfile::TempDir) = setup_collection_with_signing_key().await;
+        let (collection, _temp_dir): (Arc<Collection>, tempfile::TempDir) = setup_collection_with_signing_key().await;
 
         // Insert a valid document
         let doc = json!({"name": "Valid", "status": "active"});
@@ -2050,7 +2471,7 @@ mod persistence_tests {
 
     #[tokio::test]
     async fn test_all_with_verification_corrupted_json() {
-        let (collection, _temp_dir): (Collection, tempfile::TempDir) = setup_collection_with_signing_key().await;
+        let (collection, _temp_dir): (Arc<Collection>, tempfile::TempDir) = setup_collection_with_signing_key().await;
 
         // Create a corrupted JSON file manually
         let file_path = collection.path.join("corrupted.json");
@@ -2071,7 +2492,7 @@ mod persistence_tests {
 
     #[tokio::test]
     async fn test_filter_with_verification_corrupted_json() {
-        let (collection, _temp_dir): (Collection, tempfile::TempDir) = setup_collection_with_signing_key().await;
+        let (collection, _temp_dir): (Arc<Collection>, tempfile::TempDir) = setup_collection_with_signing_key().await;
 
         // Create a corrupted JSON file manually
         let file_path = collection.path.join("corrupted.json");
@@ -2218,7 +2639,8 @@ mod store_tests {
         let collections = store.list_collections().await.unwrap();
         assert!(collections.contains(&"temp_collection".to_string()));
 
-        // Delete it
+        // Delete it once its handle is dropped
+        drop(collection);
         let result = store.delete_collection("temp_collection").await;
         assert!(result.is_ok());
 
@@ -2420,6 +2842,59 @@ mod store_tests {
         assert!(true); // If we got here, sender is valid
     }
 
+    #[tokio::test]
+    async fn test_document_stats_reach_store_merged() {
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new_with_config(
+            temp_dir.path(),
+            None,
+            sentinel_wal::StoreWalConfig::default(),
+        )
+        .await
+        .unwrap();
+        let collection = store.collection("stats").await.unwrap();
+
+        for i in 0 .. 5 {
+            collection
+                .insert(&format!("doc-{}", i), json!({"value": i}))
+                .await
+                .unwrap();
+        }
+        collection.delete("doc-0").await.unwrap();
+
+        // Collection counters are updated by the operations themselves
+        assert_eq!(collection.total_documents(), 4);
+
+        // The store receives the merged change on the next flush
+        tokio::time::sleep(tokio::time::Duration::from_millis(1200)).await;
+        assert_eq!(store.total_documents(), 4);
+        assert_eq!(store.total_size_bytes(), collection.total_size_bytes());
+    }
+
+    #[tokio::test]
+    async fn test_save_metadata_does_not_reread_file() {
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new_with_config(
+            temp_dir.path(),
+            None,
+            sentinel_wal::StoreWalConfig::default(),
+        )
+        .await
+        .unwrap();
+        let collection = store.collection("test").await.unwrap();
+        collection.insert("doc1", json!({"a": 1})).await.unwrap();
+
+        // A damaged file on disk is replaced from the in-memory copy
+        let metadata_path = collection.path.join(".metadata.json");
+        tokio::fs::write(&metadata_path, "not json").await.unwrap();
+        collection.save_metadata().await.unwrap();
+
+        let content = tokio::fs::read_to_string(&metadata_path).await.unwrap();
+        let metadata: crate::CollectionMetadata = serde_json::from_str(&content).unwrap();
+        assert_eq!(metadata.name, "test");
+        assert_eq!(metadata.document_count, 1);
+    }
+
     #[tokio::test]
     async fn test_store_collection_with_config_default() {
         let temp_dir = tempdir().unwrap();
@@ -2471,6 +2946,7 @@ mod store_tests {
         assert_eq!(all_docs.len(), 5);
 
         // Delete the collection
+        drop(collection);
         store.delete_collection("to_delete").await.unwrap();
 
         // Verify collection no longer exists
@@ -2503,6 +2979,7 @@ mod store_tests {
         assert_eq!(collections.len(), 2);
 
         // Delete first
+        drop(col1);
         store.delete_collection("first").await.unwrap();
 
         // Verify only second remains
@@ -2897,12 +3374,14 @@ mod collection_streaming_tests {
 }
 #[cfg(test)]
 mod collection_error_tests {
+    use std::sync::Arc;
+
     use tempfile::tempdir;
     use serde_json::json;
 
     use crate::{Collection, Store};
 
-    async fn setup_collection() -> (Collection, tempfile::TempDir) {
+    async fn setup_collection() -> (Arc<Collection>, tempfile::TempDir) {
         let temp_dir = tempfile::tempdir().unwrap();
         let store = Store::new_with_config(
             temp_dir.path(),
@@ -3120,7 +3599,7 @@ mod collection_error_tests {
 
     #[tokio::test]
     async fn test_collection_getters() {
-        let (collection, _temp_dir): (crate::Collection, _) = setup_collection().await;
+        let (collection, _temp_dir): (Arc<crate::Collection>, _) = setup_collection().await;
 
         // Test getter methods
         assert_eq!(collection.name(), "test");
@@ -3148,4 +3627,245 @@ mod collection_error_tests {
         collection.save_metadata().await.unwrap();
         collection.flush_metadata().await.unwrap();
     }
+
+    #[tokio::test]
+    async fn test_get_with_cache_hits_and_invalidation() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let store = Store::new_with_config(
+            temp_dir.path(),
+            Some("test_passphrase"),
+            sentinel_wal::StoreWalConfig::default(),
+        )
+        .await
+        .unwrap();
+        let collection = store
+            .collection_with_config("cached", None)
+            .await
+            .unwrap()
+            .with_cache(1024 * 1024);
+
+        collection
+            .insert("policy", json!({"allow": true}))
+            .await
+            .unwrap();
+        assert!(collection.get("policy").await.unwrap().is_some());
+        assert!(collection.get("policy").await.unwrap().is_some());
+        let stats = collection.cache_stats().unwrap();
+        assert_eq!(stats.misses, 1);
+        assert_eq!(stats.hits, 1);
+        assert_eq!(stats.entries, 1);
+
+        // Updates through the collection drop the cached copy
+        collection
+            .update("policy", json!({"allow": false}))
+            .await
+            .unwrap();
+        let doc = collection.get("policy").await.unwrap().unwrap();
+        assert_eq!(doc.data()["allow"], json!(false));
+
+        // Changes made outside this handle are noticed through the file fingerprint
+        let other = store.collection_with_config("cached", None).await.unwrap();
+        other
+            .update("policy", json!({"allow": true, "note": "edited elsewhere"}))
+            .await
+            .unwrap();
+        let doc = collection.get("policy").await.unwrap().unwrap();
+        assert_eq!(doc.data()["note"], json!("edited elsewhere"));
+
+        other.delete("policy").await.unwrap();
+        assert!(collection.get("policy").await.unwrap().is_none());
+        assert_eq!(collection.cache_stats().unwrap().entries, 0);
+    }
+
+    #[tokio::test]
+    async fn test_cache_read_racing_with_same_size_update() {
+        let (collection, _temp_dir) = setup_collection().await;
+        let collection = collection.with_cache(1024 * 1024);
+        collection.insert("counter", json!({"n": 1})).await.unwrap();
+        let cache = collection.cache.get().unwrap().clone();
+        let path = collection.locator().resolve("counter").await;
+
+        // A reader takes the generation and fingerprint and reads the old file...
+        let generation = cache.generation("counter");
+        let fingerprint =
+            crate::cache::FileFingerprint::from_metadata(&collection.files.metadata(&path).await.unwrap().unwrap());
+        let stale = collection.get("counter").await.unwrap().unwrap();
+        cache.invalidate("counter");
+
+        // ...while a writer replaces it with a document of the same size
+        collection.update("counter", json!({"n": 2})).await.unwrap();
+
+        // The reader's late insert is refused, as it was invalidated in between
+        cache.insert(
+            stale.clone(),
+            fingerprint,
+            crate::cache::VerifiedChecks::default(),
+            generation,
+        );
+        assert_eq!(
+            collection.get("counter").await.unwrap().unwrap().data()["n"],
+            json!(2)
+        );
+
+        // Even if inserted, the replaced file no longer matches the fingerprint of the old one
+        #[cfg(unix)]
+        {
+            cache.invalidate("counter");
+            cache.insert(
+                stale,
+                fingerprint,
+                crate::cache::VerifiedChecks::default(),
+                cache.generation("counter"),
+            );
+            assert_eq!(
+                collection.get("counter").await.unwrap().unwrap().data()["n"],
+                json!(2)
+            );
+        }
+    }
+
+    #[tokio::test]
+    async fn test_sharded_layout_and_migration() {
+        let (collection, _temp_dir) = setup_collection().await;
+        collection
+            .migrate_layout(crate::DocumentLayout::Sharded)
+            .await
+            .unwrap();
+        collection.insert("a", json!({ "n": 1 })).await.unwrap();
+        collection.insert("b", json!({ "n": 2 })).await.unwrap();
+        assert!(!collection.path.join("a.json").exists());
+        assert!(crate::DocumentLayout::Sharded
+            .document_path(&collection.path, "a")
+            .exists());
+        assert_eq!(
+            collection.get("a").await.unwrap().unwrap().data(),
+            &json!({ "n": 1 })
+        );
+        let mut ids: Vec<String> = collection.list().try_collect().await.unwrap();
+        ids.sort();
+        assert_eq!(ids, vec!["a", "b"]);
+
+        collection.delete("b").await.unwrap();
+        assert!(collection.get("b").await.unwrap().is_none());
+        assert!(collection.path.join(".deleted").join("b.json").exists());
+
+        // Back to flat and sharded again, with the data intact
+        assert_eq!(
+            collection
+                .migrate_layout(crate::DocumentLayout::Flat)
+                .await
+                .unwrap(),
+            1
+        );
+        assert!(collection.path.join("a.json").exists());
+        let mut entries = fs::read_dir(&collection.path).await.unwrap();
+        while let Some(entry) = entries.next_entry().await.unwrap() {
+            assert!(!crate::layout::is_shard_dir_name(
+                entry.file_name().to_str().unwrap()
+            ));
+        }
+        collection.insert("c", json!({ "n": 3 })).await.unwrap();
+        assert_eq!(
+            collection
+                .migrate_layout(crate::DocumentLayout::Sharded)
+                .await
+                .unwrap(),
+            2
+        );
+        let mut ids: Vec<String> = collection.list().try_collect().await.unwrap();
+        ids.sort();
+        assert_eq!(ids, vec!["a", "c"]);
+        assert_eq!(
+            collection.get("c").await.unwrap().unwrap().data(),
+            &json!({ "n": 3 })
+        );
+    }
+
+    #[tokio::test(flavor = "multi_thread", worker_threads = 4)]
+    async fn test_migration_does_not_restore_concurrently_deleted_documents() {
+        let (collection, _temp_dir) = setup_collection().await;
+        let ids: Vec<String> = (0 .. 200).map(|i| format!("doc-{}", i)).collect();
+        collection
+            .bulk_insert(ids.iter().map(|id| (id.as_str(), json!({}))).collect())
+            .await
+            .unwrap();
+
+        let deleter = {
+            let collection = collection.clone();
+            let ids = ids.clone();
+            tokio::spawn(async move {
+                for id in ids {
+                    collection.delete(&id).await.unwrap();
+                }
+            })
+        };
+        collection
+            .migrate_layout(crate::DocumentLayout::Sharded)
+            .await
+            .unwrap();
+        deleter.await.unwrap();
+
+        for id in &ids {
+            assert!(collection.get(id).await.unwrap().is_none());
+        }
+        let listed: Vec<String> = collection.list().try_collect().await.unwrap();
+        assert!(listed.is_empty());
+    }
+
+    #[tokio::test]
+    async fn test_aggregate_pipeline_groups_in_one_scan() {
+        let (collection, _temp_dir) = setup_collection().await;
+        let ids: Vec<String> = (0 .. 1200).map(|i| format!("order-{}", i)).collect();
+        let orders = ids
+            .iter()
+            .enumerate()
+            .map(|(i, id)| {
+                let region = if i % 3 == 0 { "eu" } else { "us" };
+                (
+                    id.as_str(),
+                    json!({ "region": region, "amount": i, "user": i % 10, "paid": i % 2 == 0 }),
+                )
+            })
+            .collect();
+        collection.bulk_insert(orders).await.unwrap();
+
+        let pipeline = crate::AggregationPipeline::new()
+            .filter(crate::Filter::Equals("paid".to_owned(), json!(true)))
+            .group_by("region")
+            .aggregate("orders", crate::Aggregation::Count)
+            .aggregate("total", crate::Aggregation::Sum("amount".to_owned()))
+            .aggregate("largest", crate::Aggregation::Max("amount".to_owned()))
+            .aggregate(
+                "users",
+                crate::Aggregation::DistinctCount("user".to_owned()),
+            )
+            .aggregate(
+                "p50",
+                crate::Aggregation::Percentile("amount".to_owned(), 50.0),
+            );
+
+        // Paid orders are the even ones; every sixth order is a paid one from eu
+        let eu_total: i64 = (0 .. 1200).step_by(6).sum();
+        let us_total: i64 = (0 .. 1200).step_by(2).filter(|i| i % 3 != 0).sum();
+        for options in [
+            crate::VerificationOptions::default(),
+            crate::VerificationOptions::disabled(),
+        ] {
+            let groups = collection
+                .aggregate_pipeline_with_verification(&pipeline, &options)
+                .await
+                .unwrap();
+            assert_eq!(groups.len(), 2);
+            assert_eq!(groups[0]["region"], json!("eu"));
+            assert_eq!(groups[0]["orders"], json!(200));
+            assert_eq!(groups[0]["total"], json!(eu_total as f64));
+            assert_eq!(groups[0]["largest"], json!(1194.0));
+            assert_eq!(groups[0]["users"], json!(5));
+            assert_eq!(groups[1]["region"], json!("us"));
+            assert_eq!(groups[1]["orders"], json!(400));
+            assert_eq!(groups[1]["total"], json!(us_total as f64));
+            let p50 = groups[1]["p50"].as_f64().unwrap();
+            assert!((p50 - 600.0).abs() < 25.0, "p50 {}", p50);
+        }
+    }
 }
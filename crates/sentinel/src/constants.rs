@@ -18,9 +18,61 @@ pub const WAL_FILE: &str = "transactions.wal";
 /// Directory name for soft-deleted documents within a collection.
 pub const DELETED_DIR: &str = ".deleted";
 
+/// Directory name for temporary runs spilled by sorted queries within a collection.
+pub const SORT_SPILL_DIR: &str = ".sort";
+
+/// Number of documents a query sorted by an ordered index takes from the index at a time.
+pub const SORTED_INDEX_BATCH_SIZE: usize = 256;
+
+/// Maximum number of documents hashed, signed and written concurrently by a bulk insert.
+pub const BULK_INSERT_CONCURRENCY: usize = 64;
+
+/// Maximum number of document signatures a scan checks in one batch verification.
+pub const SIGNATURE_BATCH_SIZE: usize = 64;
+
+/// Maximum number of document files read concurrently by `Collection::get_many`.
+///
+/// Bounds the number of open file descriptors however many IDs are requested.
+pub const GET_MANY_CONCURRENCY: usize = 64;
+
+/// Number of lock stripes serializing the writers of the documents of a collection.
+///
+/// Writers of documents that hash to different stripes proceed in parallel.
+pub const DOCUMENT_LOCK_STRIPES: usize = 1024;
+
+/// Number of documents each parallel shard of an aggregation accumulates before it is merged.
+pub const AGGREGATION_CHUNK_SIZE: usize = 1024;
+
+/// Number of changed document files and directories a collection tracks before syncing them to
+/// disk ahead of its next WAL checkpoint.
+pub const UNSYNCED_FILES_LIMIT: usize = 16 * 1024;
+
+/// Maximum number of document files moved concurrently by a collection layout migration.
+pub const LAYOUT_MIGRATION_CONCURRENCY: usize = 64;
+
+/// Maximum number of collections recovered from their WAL concurrently by a store.
+pub const COLLECTION_RECOVERY_CONCURRENCY: usize = 4;
+
+/// How long a store keeps a collection open after its last handle was dropped.
+pub const COLLECTION_IDLE_TIMEOUT: std::time::Duration = std::time::Duration::from_secs(60);
+
+/// Maximum number of events queued from collections to the store before senders wait, unless
+/// the store configuration sets `event_queue_capacity`.
+pub const STORE_EVENT_QUEUE_CAPACITY: usize = 256;
+
+/// Default maximum number of changes per batch of a change feed.
+pub const CHANGE_FEED_BATCH_SIZE: usize = 256;
+
 /// Filename for collection metadata stored within a collection directory.
 pub const COLLECTION_METADATA_FILE: &str = ".metadata.json";
 
+/// Filename for the persisted secondary indexes stored next to the collection metadata.
+pub const COLLECTION_INDEXES_FILE: &str = ".indexes.json";
+
+/// Filename for the manifest of document IDs, sizes and hashes stored within a collection
+/// directory.
+pub const COLLECTION_MANIFEST_FILE: &str = ".manifest.jsonl";
+
 /// Filename for store metadata stored in the store root directory.
 pub const STORE_METADATA_FILE: &str = ".store.json";
 
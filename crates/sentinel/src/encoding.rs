@@ -0,0 +1,396 @@
+//! On-disk encodings of document files.
+//!
+//! Every document file holds one serialized [`Document`]. A collection chooses how new and
+//! rewritten files are encoded:
+//!
+//! - `pretty`: indented JSON, easy to read and edit by hand (the default)
+//! - `compact`: JSON without whitespace, typically 25-35% smaller than `pretty`
+//! - `cbor`: the [`CBOR_DOCUMENT_MAGIC`] prefix followed by the document encoded as CBOR
+//!
+//! Readers detect the encoding of each file from its content, so a collection can hold files in
+//! several encodings after its setting changes and nothing needs rewriting.
+//!
+//! [`LazyDocument`] reads a JSON file without building the full `serde_json::Value` tree of its
+//! data: only the top level of the data object is split into raw, unparsed field values, and a
+//! field is parsed when a filter or projection asks for it.
+
+use std::{borrow::Cow, collections::BTreeMap};
+
+use serde::{Deserialize, Serialize};
+use serde_json::{value::RawValue, Value};
+
+use crate::{filtering::DocumentFields, Document, Result, SentinelError};
+
+/// Prefix identifying a CBOR-encoded document file
+pub const CBOR_DOCUMENT_MAGIC: [u8; 4] = *b"SDC\x01";
+
+/// Encoding used to write document files.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, Serialize, Deserialize)]
+#[serde(rename_all = "lowercase")]
+pub enum DocumentEncoding {
+    /// Indented JSON.
+    #[default]
+    Pretty,
+    /// JSON without insignificant whitespace.
+    Compact,
+    /// Binary CBOR behind [`CBOR_DOCUMENT_MAGIC`].
+    Cbor,
+}
+
+impl std::str::FromStr for DocumentEncoding {
+    type Err = String;
+
+    fn from_str(s: &str) -> std::result::Result<Self, Self::Err> {
+        match s.to_lowercase().as_str() {
+            "pretty" => Ok(Self::Pretty),
+            "compact" => Ok(Self::Compact),
+            "cbor" => Ok(Self::Cbor),
+            _ => Err(format!("Invalid document encoding: {}", s)),
+        }
+    }
+}
+
+impl std::fmt::Display for DocumentEncoding {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match *self {
+            Self::Pretty => write!(f, "pretty"),
+            Self::Compact => write!(f, "compact"),
+            Self::Cbor => write!(f, "cbor"),
+        }
+    }
+}
+
+/// Serializes a document into the bytes of its file.
+///
+/// # Errors
+///
+/// * `SentinelError::Json` - If the document cannot be serialized as JSON
+/// * `SentinelError::Internal` - If the document cannot be serialized as CBOR
+pub fn encode_document(doc: &Document, encoding: DocumentEncoding) -> Result<Vec<u8>> {
+    match encoding {
+        DocumentEncoding::Pretty => Ok(serde_json::to_vec_pretty(doc)?),
+        DocumentEncoding::Compact => Ok(serde_json::to_vec(doc)?),
+        DocumentEncoding::Cbor => {
+            let mut bytes = CBOR_DOCUMENT_MAGIC.to_vec();
+            ciborium::into_writer(doc, &mut bytes).map_err(|e| {
+                SentinelError::Internal {
+                    message: format!("Failed to encode document {} as CBOR: {}", doc.id(), e),
+                }
+            })?;
+            Ok(bytes)
+        },
+    }
+}
+
+/// Returns the encoding of a document file from its content.
+///
+/// JSON files are reported as `Pretty` or `Compact` depending on whether they contain a newline.
+pub fn detect_encoding(bytes: &[u8]) -> DocumentEncoding {
+    if bytes.starts_with(&CBOR_DOCUMENT_MAGIC) {
+        DocumentEncoding::Cbor
+    }
+    else if bytes.contains(&b'\n') {
+        DocumentEncoding::Pretty
+    }
+    else {
+        DocumentEncoding::Compact
+    }
+}
+
+/// Parses the bytes of a document file in any encoding.
+///
+/// # Errors
+///
+/// * `SentinelError::Json` - If a JSON file is not a valid document
+/// * `SentinelError::StoreCorruption` - If a CBOR file is not a valid document
+pub fn decode_document(bytes: &[u8]) -> Result<Document> {
+    bytes.strip_prefix(&CBOR_DOCUMENT_MAGIC).map_or_else(
+        || serde_json::from_slice(bytes).map_err(SentinelError::from),
+        decode_cbor,
+    )
+}
+
+/// Parses the bytes of a document file like [`decode_document`], also returning the serialized
+/// data when the file holds it in canonical form.
+///
+/// Compact files store the data exactly as the document hash serializes it, so those bytes can be
+/// hashed directly instead of re-serializing the decoded data. Pretty and CBOR files return `None`.
+///
+/// # Errors
+///
+/// * `SentinelError::Json` - If a JSON file is not a valid document
+/// * `SentinelError::StoreCorruption` - If a CBOR file is not a valid document
+pub(crate) fn decode_document_with_data(bytes: &[u8]) -> Result<(Document, Option<&[u8]>)> {
+    if detect_encoding(bytes) != DocumentEncoding::Compact {
+        return Ok((decode_document(bytes)?, None));
+    }
+    let header: RawDocument<'_> = serde_json::from_slice(bytes)?;
+    let data: &RawValue = header.data;
+    let raw = data.get();
+    let data = serde_json::from_str(raw)?;
+    Ok((header.into_document(data), Some(raw.as_bytes())))
+}
+
+/// Parses a CBOR document body.
+fn decode_cbor(cbor: &[u8]) -> Result<Document> {
+    ciborium::from_reader(cbor).map_err(|e| {
+        SentinelError::StoreCorruption {
+            reason: format!("Invalid CBOR document: {}", e),
+        }
+    })
+}
+
+/// A document file parsed without its data, borrowing the raw JSON field values from the file.
+#[derive(Deserialize)]
+struct RawDocument<'a> {
+    /// The unique identifier of the document.
+    id:         String,
+    /// The version of the document.
+    version:    u32,
+    /// The timestamp when the document was created.
+    created_at: chrono::DateTime<chrono::Utc>,
+    /// The timestamp when the document was last updated.
+    updated_at: chrono::DateTime<chrono::Utc>,
+    /// The hash of the document data.
+    hash:       String,
+    /// The signature of the document data.
+    signature:  String,
+    /// The unparsed data of the document.
+    #[serde(borrow)]
+    data:       &'a RawValue,
+}
+
+/// A document whose data fields are decoded on demand.
+///
+/// JSON files are parsed one level deep: the top-level data fields are kept as raw JSON and only
+/// parsed by [`DocumentFields::field`], [`Self::into_projected`] or [`Self::into_document`]. CBOR
+/// files have no cheap partial parse and are decoded in full.
+pub struct LazyDocument<'a> {
+    /// The header and raw data of a JSON file, or a fully decoded CBOR document.
+    inner: LazyInner<'a>,
+}
+
+/// Representation behind a [`LazyDocument`].
+enum LazyInner<'a> {
+    /// A JSON file with its data split into raw top-level fields.
+    Json {
+        /// The document without its data.
+        header: RawDocument<'a>,
+        /// Raw top-level fields of the data, empty when the data is not an object.
+        fields: BTreeMap<String, &'a RawValue>,
+    },
+    /// A fully decoded document.
+    Decoded(Document),
+}
+
+impl<'a> LazyDocument<'a> {
+    /// Parses the bytes of a document file in any encoding, leaving JSON field values undecoded.
+    ///
+    /// # Errors
+    ///
+    /// * `SentinelError::Json` - If a JSON file is not a valid document
+    /// * `SentinelError::StoreCorruption` - If a CBOR file is not a valid document
+    pub fn parse(bytes: &'a [u8]) -> Result<Self> {
+        if let Some(cbor) = bytes.strip_prefix(&CBOR_DOCUMENT_MAGIC) {
+            return Ok(Self {
+                inner: LazyInner::Decoded(decode_cbor(cbor)?),
+            });
+        }
+        let header: RawDocument<'a> = serde_json::from_slice(bytes)?;
+        let data: &'a RawValue = header.data;
+        let raw = data.get();
+        let fields = if raw.starts_with('{') {
+            serde_json::from_str(raw)?
+        }
+        else {
+            BTreeMap::new()
+        };
+        Ok(Self {
+            inner: LazyInner::Json {
+                header,
+                fields,
+            },
+        })
+    }
+
+    /// Builds the document with only the given top-level data fields, parsing nothing else.
+    ///
+    /// An empty field list keeps every field, like [`crate::projection::project_document`].
+    ///
+    /// # Errors
+    ///
+    /// * `SentinelError::Json` - If a selected field is not valid JSON
+    pub fn into_projected(self, projection: &[String]) -> Result<Document> {
+        if projection.is_empty() {
+            return self.into_document();
+        }
+        match self.inner {
+            LazyInner::Json {
+                header,
+                fields,
+            } => {
+                let mut data = serde_json::Map::new();
+                for name in projection {
+                    if let Some(raw) = fields.get(name.as_str()) {
+                        data.insert(name.clone(), serde_json::from_str(raw.get())?);
+                    }
+                }
+                Ok(header.into_document(Value::Object(data)))
+            },
+            LazyInner::Decoded(doc) => Ok(crate::projection::project_document(doc, projection)),
+        }
+    }
+
+    /// Parses the remaining data and returns the full document.
+    ///
+    /// # Errors
+    ///
+    /// * `SentinelError::Json` - If the data is not valid JSON
+    pub fn into_document(self) -> Result<Document> {
+        match self.inner {
+            LazyInner::Json {
+                header,
+                ..
+            } => {
+                let data = serde_json::from_str(header.data.get())?;
+                Ok(header.into_document(data))
+            },
+            LazyInner::Decoded(doc) => Ok(doc),
+        }
+    }
+}
+
+impl RawDocument<'_> {
+    /// Combines the header with decoded data.
+    fn into_document(self, data: Value) -> Document {
+        Document {
+            id: self.id,
+            version: self.version,
+            created_at: self.created_at,
+            updated_at: self.updated_at,
+            hash: self.hash,
+            signature: self.signature,
+            data,
+        }
+    }
+}
+
+impl DocumentFields for LazyDocument<'_> {
+    fn field(&self, name: &str) -> Option<Cow<'_, Value>> {
+        match self.inner {
+            LazyInner::Json {
+                ref fields,
+                ..
+            } => {
+                fields
+                    .get(name)
+                    .and_then(|raw| serde_json::from_str(raw.get()).ok())
+                    .map(Cow::Owned)
+            },
+            LazyInner::Decoded(ref doc) => doc.field(name),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use serde_json::json;
+
+    use super::*;
+
+    /// Builds an unsigned document for the tests
+    async fn sample() -> Document {
+        Document::new_without_signature(
+            "doc-1".to_owned(),
+            json!({"name": "Alice", "age": 30, "tags": ["a", "b"], "nested": {"x": 1.5}}),
+        )
+        .await
+        .unwrap()
+    }
+
+    #[tokio::test]
+    async fn test_every_encoding_roundtrips() {
+        let doc = sample().await;
+        for encoding in [
+            DocumentEncoding::Pretty,
+            DocumentEncoding::Compact,
+            DocumentEncoding::Cbor,
+        ] {
+            let bytes = encode_document(&doc, encoding).unwrap();
+            assert_eq!(detect_encoding(&bytes), encoding);
+            assert_eq!(decode_document(&bytes).unwrap(), doc);
+            assert_eq!(
+                LazyDocument::parse(&bytes)
+                    .unwrap()
+                    .into_document()
+                    .unwrap(),
+                doc
+            );
+        }
+    }
+
+    #[tokio::test]
+    async fn test_compact_is_smaller_than_pretty() {
+        let doc = sample().await;
+        let pretty = encode_document(&doc, DocumentEncoding::Pretty).unwrap();
+        let compact = encode_document(&doc, DocumentEncoding::Compact).unwrap();
+        assert!(compact.len() < pretty.len());
+    }
+
+    #[tokio::test]
+    async fn test_lazy_fields_and_projection() {
+        let doc = sample().await;
+        for encoding in [DocumentEncoding::Compact, DocumentEncoding::Cbor] {
+            let bytes = encode_document(&doc, encoding).unwrap();
+            let lazy = LazyDocument::parse(&bytes).unwrap();
+            assert_eq!(lazy.field("age").as_deref(), Some(&json!(30)));
+            assert_eq!(lazy.field("missing"), None);
+
+            let projected = lazy.into_projected(&["name".to_owned()]).unwrap();
+            assert_eq!(projected.data(), &json!({"name": "Alice"}));
+            assert_eq!(projected.hash(), doc.hash());
+        }
+    }
+
+    #[tokio::test]
+    async fn test_compact_files_expose_canonical_data() {
+        let doc = sample().await;
+        let compact = encode_document(&doc, DocumentEncoding::Compact).unwrap();
+        let (decoded, data) = decode_document_with_data(&compact).unwrap();
+        assert_eq!(decoded, doc);
+        assert_eq!(
+            data.unwrap(),
+            serde_json::to_vec(doc.data()).unwrap().as_slice()
+        );
+
+        let pretty = encode_document(&doc, DocumentEncoding::Pretty).unwrap();
+        let (decoded, data) = decode_document_with_data(&pretty).unwrap();
+        assert_eq!(decoded, doc);
+        assert!(data.is_none());
+    }
+
+    #[tokio::test]
+    async fn test_corrupt_cbor_is_reported() {
+        let mut bytes = CBOR_DOCUMENT_MAGIC.to_vec();
+        bytes.extend_from_slice(&[0xff, 0x00]);
+        assert!(matches!(
+            decode_document(&bytes),
+            Err(SentinelError::StoreCorruption { .. })
+        ));
+    }
+
+    #[test]
+    fn test_encoding_parse_and_display() {
+        for encoding in [
+            DocumentEncoding::Pretty,
+            DocumentEncoding::Compact,
+            DocumentEncoding::Cbor,
+        ] {
+            assert_eq!(
+                encoding.to_string().parse::<DocumentEncoding>().unwrap(),
+                encoding
+            );
+        }
+        assert!("yaml".parse::<DocumentEncoding>().is_err());
+    }
+}
@@ -0,0 +1,35 @@
+//! Encryption at rest of encrypted collections.
+//!
+//! A store opened with a passphrase holds a random data key, wrapped by the key derived from the
+//! passphrase, and every encrypted collection derives its own [`EnvelopeCipher`] from it once,
+//! when it is opened. The files of an encrypted collection hold their encoded document inside an
+//! envelope, and the entries of its WAL are encrypted through [`WalPayloadCipher`].
+//!
+//! Document files are sealed and opened by the [storage backend](crate::storage) of the store, on
+//! the blocking pool together with the file I/O and one chunk of the envelope at a time, so
+//! neither the encrypted nor the decrypted form is built in a separate buffer and the runtime
+//! threads never run the cipher. Readers detect envelopes from their magic, so files written
+//! before a collection was encrypted stay readable and are encrypted when they are next
+//! rewritten.
+
+use std::sync::Arc;
+
+use sentinel_crypto::EnvelopeCipher;
+
+/// Encrypts the entries of the WAL of an encrypted collection with its envelope cipher.
+#[derive(Debug)]
+pub struct WalPayloadCipher(pub Arc<EnvelopeCipher>);
+
+impl sentinel_wal::PayloadCipher for WalPayloadCipher {
+    fn encrypt(&self, payload: &[u8]) -> sentinel_wal::Result<Vec<u8>> {
+        self.0
+            .seal(payload)
+            .map_err(|e| sentinel_wal::WalError::Serialization(format!("failed to encrypt WAL entry: {}", e)))
+    }
+
+    fn decrypt(&self, encrypted: &[u8]) -> sentinel_wal::Result<Vec<u8>> {
+        self.0
+            .open(encrypted)
+            .map_err(|e| sentinel_wal::WalError::InvalidEntry(format!("failed to decrypt WAL entry: {}", e)))
+    }
+}
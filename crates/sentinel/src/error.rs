@@ -41,6 +41,15 @@ pub enum SentinelError {
         collection: String,
     },
 
+    /// Document changed since the version a conditional update expected
+    #[error("Document '{id}' in collection '{collection}' changed: expected hash {expected}, found {actual}")]
+    VersionConflict {
+        id:         String,
+        collection: String,
+        expected:   String,
+        actual:     String,
+    },
+
     /// Invalid document ID format
     #[error("Invalid document ID: {id}")]
     InvalidDocumentId {
@@ -2,6 +2,12 @@
 ///
 /// This module defines the event types that collections emit when operations occur,
 /// allowing the store to maintain accurate metadata without requiring wrapper methods.
+///
+/// Document operations do not send one event each: collections merge their document count and
+/// size changes into a [`StatsDelta`] and forward the net change to the store as a single
+/// [`StoreEvent::StatsChanged`] per flush, over a bounded channel.
+use std::sync::atomic::{AtomicI64, AtomicU64, Ordering};
+
 use serde::{Deserialize, Serialize};
 
 /// Events emitted by collections to notify the store of metadata changes.
@@ -21,31 +27,63 @@ pub enum StoreEvent {
         /// Total size in bytes of all documents in the collection.
         total_size_bytes: u64,
     },
-    /// A document was inserted into a collection.
-    DocumentInserted {
-        /// Name of the collection.
-        collection: String,
-        /// Size in bytes of the inserted document.
-        size_bytes: u64,
-    },
-    /// A document was updated in a collection.
-    DocumentUpdated {
+    /// The document count and size of a collection changed by the given net amounts.
+    StatsChanged {
         /// Name of the collection.
         collection:     String,
-        /// Size in bytes of the document before the update.
-        old_size_bytes: u64,
-        /// Size in bytes of the document after the update.
-        new_size_bytes: u64,
-    },
-    /// A document was deleted from a collection.
-    DocumentDeleted {
-        /// Name of the collection.
-        collection: String,
-        /// Size in bytes of the deleted document.
-        size_bytes: u64,
+        /// Net change in the number of documents.
+        document_delta: i64,
+        /// Net change in the total size in bytes of the documents.
+        size_delta:     i64,
     },
 }
 
+/// Document count and size changes accumulated by a collection between two flushes.
+///
+/// Producers merge their changes with two atomic additions, so a burst of document operations
+/// reaches the store as one event instead of one event per document.
+#[derive(Debug, Default)]
+pub struct StatsDelta {
+    /// Net change in the number of documents.
+    documents:  AtomicI64,
+    /// Net change in the total size in bytes.
+    size_bytes: AtomicI64,
+}
+
+impl StatsDelta {
+    /// Adds a change to the accumulated delta.
+    pub fn record(&self, documents: i64, size_bytes: i64) {
+        self.documents.fetch_add(documents, Ordering::Relaxed);
+        self.size_bytes.fetch_add(size_bytes, Ordering::Relaxed);
+    }
+
+    /// Takes the accumulated delta, leaving it empty.
+    pub fn take(&self) -> (i64, i64) {
+        (
+            self.documents.swap(0, Ordering::Relaxed),
+            self.size_bytes.swap(0, Ordering::Relaxed),
+        )
+    }
+}
+
+/// Applies a signed delta to a counter, saturating at zero and `u64::MAX`.
+pub fn apply_delta(counter: &AtomicU64, delta: i64) {
+    let magnitude = delta.unsigned_abs();
+    // The update closure never returns `None`, so the update cannot fail
+    drop(
+        counter.fetch_update(Ordering::Relaxed, Ordering::Relaxed, |value| {
+            Some(
+                if delta >= 0 {
+                    value.saturating_add(magnitude)
+                }
+                else {
+                    value.saturating_sub(magnitude)
+                },
+            )
+        }),
+    );
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -61,18 +99,10 @@ mod tests {
                 document_count:   42,
                 total_size_bytes: 1024,
             },
-            StoreEvent::DocumentInserted {
-                collection: "test_collection".to_string(),
-                size_bytes: 256,
-            },
-            StoreEvent::DocumentUpdated {
+            StoreEvent::StatsChanged {
                 collection:     "test_collection".to_string(),
-                old_size_bytes: 128,
-                new_size_bytes: 256,
-            },
-            StoreEvent::DocumentDeleted {
-                collection: "test_collection".to_string(),
-                size_bytes: 256,
+                document_delta: -2,
+                size_delta:     512,
             },
         ];
 
@@ -85,13 +115,33 @@ mod tests {
 
     #[test]
     fn test_store_event_debug() {
-        let event = StoreEvent::DocumentInserted {
-            collection: "users".to_string(),
-            size_bytes: 512,
+        let event = StoreEvent::StatsChanged {
+            collection:     "users".to_string(),
+            document_delta: 1,
+            size_delta:     512,
         };
         let debug_str = format!("{:?}", event);
-        assert!(debug_str.contains("DocumentInserted"));
+        assert!(debug_str.contains("StatsChanged"));
         assert!(debug_str.contains("users"));
         assert!(debug_str.contains("512"));
     }
+
+    #[test]
+    fn test_stats_delta_merges_and_resets() {
+        let delta = StatsDelta::default();
+        delta.record(1, 100);
+        delta.record(1, 50);
+        delta.record(-1, -100);
+        assert_eq!(delta.take(), (1, 50));
+        assert_eq!(delta.take(), (0, 0));
+    }
+
+    #[test]
+    fn test_apply_delta_saturates() {
+        let counter = AtomicU64::new(5);
+        apply_delta(&counter, 3);
+        assert_eq!(counter.load(Ordering::Relaxed), 8);
+        apply_delta(&counter, -10);
+        assert_eq!(counter.load(Ordering::Relaxed), 0);
+    }
 }
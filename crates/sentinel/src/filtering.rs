@@ -1,119 +1,441 @@
 //! Filtering utilities for document matching.
 
+use std::{borrow::Cow, collections::HashSet};
+
+use memchr::memmem::Finder;
 use serde_json::Value;
 
 use crate::{Document, Filter};
 
+/// Read access to the top-level data fields of a document.
+///
+/// Implemented by fully parsed documents and by [`crate::encoding::LazyDocument`], which only
+/// decodes the fields a filter asks for.
+pub trait DocumentFields {
+    /// Returns the value of the top-level data field `name`, if present.
+    fn field(&self, name: &str) -> Option<Cow<'_, Value>>;
+}
+
+impl DocumentFields for Document {
+    fn field(&self, name: &str) -> Option<Cow<'_, Value>> { self.data().field(name) }
+}
+
+impl DocumentFields for Value {
+    fn field(&self, name: &str) -> Option<Cow<'_, Value>> { self.get(name).map(Cow::Borrowed) }
+}
+
 /// Checks if a document matches all the given filters.
-pub fn matches_filters(doc: &Document, filters: &[&Filter]) -> bool {
-    #[allow(
-        clippy::needless_borrowed_reference,
-        reason = "clippy suggestions are incorrect for matching &Value patterns"
-    )]
-    for &filter in filters {
-        let matches = match *filter {
-            Filter::Equals(ref field, ref value) => doc.data().get(field.as_str()) == Some(value),
-            Filter::GreaterThan(ref field, ref value) => {
-                if let &Value::Number(ref v) = value {
-                    if let Some(&Value::Number(ref n)) = doc.data().get(field.as_str()) {
-                        n.as_f64().unwrap_or(0.0) > v.as_f64().unwrap_or(0.0)
-                    }
-                    else {
-                        false
-                    }
-                }
-                else {
-                    false
-                }
+///
+/// The filters are compiled for this call only; compile a [`FilterPlan`] once instead when
+/// matching many documents against the same filters.
+pub fn matches_filters<D: DocumentFields + ?Sized>(doc: &D, filters: &[&Filter]) -> bool {
+    FilterPlan::compile(filters.iter().copied()).matches(doc)
+}
+
+/// A reference to a possibly nested document field.
+///
+/// A field name starting with `/` is a JSON pointer (RFC 6901) whose first token names a
+/// top-level field. Any other name containing `.` is a dotted path, which resolves to a top-level
+/// field of that exact name when present and otherwise walks into nested objects one segment at a
+/// time. Segments index into arrays when they are a number.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub(crate) struct FieldPath {
+    /// The field name as written.
+    name:     String,
+    /// The segments leading to a nested value; empty for a plain top-level field.
+    segments: Vec<String>,
+    /// Whether the name is a JSON pointer, which is never looked up as a top-level name.
+    pointer:  bool,
+}
+
+impl FieldPath {
+    /// Parses a field name into its segments.
+    pub(crate) fn parse(name: &str) -> Self {
+        let (segments, pointer) = match name.strip_prefix('/') {
+            Some(pointer) => {
+                let tokens = pointer
+                    .split('/')
+                    .map(|token| token.replace("~1", "/").replace("~0", "~"))
+                    .collect();
+                (tokens, true)
             },
-            Filter::LessThan(ref field, ref value) => {
-                if let &Value::Number(ref v) = value {
-                    if let Some(&Value::Number(ref n)) = doc.data().get(field.as_str()) {
-                        n.as_f64().unwrap_or(0.0) < v.as_f64().unwrap_or(0.0)
-                    }
-                    else {
-                        false
-                    }
-                }
-                else {
-                    false
-                }
+            None if name.contains('.') => (name.split('.').map(str::to_owned).collect(), false),
+            None => (Vec::new(), false),
+        };
+        Self {
+            name: name.to_owned(),
+            segments,
+            pointer,
+        }
+    }
+
+    /// Returns the value the path points to in `doc`, if present.
+    pub(crate) fn resolve<'d, D: DocumentFields + ?Sized>(&self, doc: &'d D) -> Option<Cow<'d, Value>> {
+        if !self.pointer &&
+            let Some(value) = doc.field(&self.name)
+        {
+            return Some(value);
+        }
+        let (first, rest) = self.segments.split_first()?;
+        rest.iter()
+            .try_fold(doc.field(first)?, |value, segment| child(value, segment))
+    }
+
+    /// Returns whether the path is a plain top-level field, resolved by its name alone.
+    pub(crate) const fn is_top_level(&self) -> bool { !self.pointer && self.segments.is_empty() }
+
+    /// Returns the number of lookups needed to resolve the path.
+    fn depth(&self) -> u32 {
+        u32::try_from(self.segments.len())
+            .unwrap_or(u32::MAX)
+            .max(1)
+    }
+}
+
+/// Returns the member `segment` of an object, or the element at index `segment` of an array.
+fn child<'d>(value: Cow<'d, Value>, segment: &str) -> Option<Cow<'d, Value>> {
+    match value {
+        Cow::Borrowed(value) => {
+            match *value {
+                Value::Object(ref map) => map.get(segment).map(Cow::Borrowed),
+                Value::Array(ref items) => items.get(segment.parse::<usize>().ok()?).map(Cow::Borrowed),
+                Value::Null | Value::Bool(_) | Value::Number(_) | Value::String(_) => None,
+            }
+        },
+        Cow::Owned(value) => {
+            match value {
+                Value::Object(mut map) => map.remove(segment).map(Cow::Owned),
+                Value::Array(mut items) => {
+                    items
+                        .get_mut(segment.parse::<usize>().ok()?)
+                        .map(|item| Cow::Owned(item.take()))
+                },
+                Value::Null | Value::Bool(_) | Value::Number(_) | Value::String(_) => None,
+            }
+        },
+    }
+}
+
+/// A numeric comparison against a constant.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Comparison {
+    /// `field > constant`
+    Greater,
+    /// `field < constant`
+    Less,
+    /// `field >= constant`
+    GreaterOrEqual,
+    /// `field <= constant`
+    LessOrEqual,
+}
+
+impl Comparison {
+    /// Returns whether `value` compares to `bound` as required.
+    fn holds(self, value: f64, bound: f64) -> bool {
+        match self {
+            Self::Greater => value > bound,
+            Self::Less => value < bound,
+            Self::GreaterOrEqual => value >= bound,
+            Self::LessOrEqual => value <= bound,
+        }
+    }
+}
+
+/// The constants of an `In` filter, hashed by kind.
+#[derive(Debug, Clone, Default)]
+struct ValueSet {
+    /// String constants.
+    strings: HashSet<String>,
+    /// Numeric constants by their textual form, which is how numbers compare for equality.
+    numbers: HashSet<String>,
+    /// All other constants, compared one by one.
+    others:  Vec<Value>,
+}
+
+impl ValueSet {
+    /// Builds the set of `values`.
+    fn new(values: &[Value]) -> Self {
+        let mut set = Self::default();
+        for value in values {
+            match *value {
+                Value::String(ref s) => {
+                    set.strings.insert(s.clone());
+                },
+                Value::Number(ref n) => {
+                    set.numbers.insert(n.as_str().to_owned());
+                },
+                Value::Null | Value::Bool(_) | Value::Array(_) | Value::Object(_) => set.others.push(value.clone()),
+            }
+        }
+        set
+    }
+
+    /// Returns whether `value` is one of the constants.
+    fn contains(&self, value: &Value) -> bool {
+        match *value {
+            Value::String(ref s) => self.strings.contains(s.as_str()),
+            Value::Number(ref n) => self.numbers.contains(n.as_str()),
+            Value::Null | Value::Bool(_) | Value::Array(_) | Value::Object(_) => self.others.contains(value),
+        }
+    }
+}
+
+/// A compiled filter.
+#[derive(Debug, Clone)]
+enum Predicate {
+    /// Matches no document, such as a numeric comparison against a non-numeric constant.
+    Never,
+    /// `field == value`
+    Equals(FieldPath, Value),
+    /// A numeric comparison of the field against a constant.
+    Compare(FieldPath, Comparison, f64),
+    /// The field value is one of the constants.
+    In(FieldPath, ValueSet),
+    /// The string field, or a string element of the array field, contains the substring.
+    Contains(FieldPath, Finder<'static>),
+    /// The string field starts with the prefix.
+    StartsWith(FieldPath, String),
+    /// The string field ends with the suffix.
+    EndsWith(FieldPath, String),
+    /// The field exists, or does not exist if `false`.
+    Exists(FieldPath, bool),
+    /// All predicates match, tested in order.
+    All(Vec<Self>),
+    /// Any predicate matches, tested in order.
+    Any(Vec<Self>),
+}
+
+impl Predicate {
+    /// Compiles a filter, flattening nested `And` and `Or` filters.
+    fn compile(filter: &Filter) -> Self {
+        /// Compiles a numeric comparison; a non-numeric constant never matches.
+        fn compare(field: &str, comparison: Comparison, value: &Value) -> Predicate {
+            match *value {
+                Value::Number(ref n) => {
+                    Predicate::Compare(
+                        FieldPath::parse(field),
+                        comparison,
+                        n.as_f64().unwrap_or(0.0),
+                    )
+                },
+                Value::Null | Value::Bool(_) | Value::String(_) | Value::Array(_) | Value::Object(_) => {
+                    Predicate::Never
+                },
+            }
+        }
+
+        match *filter {
+            Filter::Equals(ref field, ref value) => Self::Equals(FieldPath::parse(field), value.clone()),
+            Filter::GreaterThan(ref field, ref value) => compare(field, Comparison::Greater, value),
+            Filter::LessThan(ref field, ref value) => compare(field, Comparison::Less, value),
+            Filter::GreaterOrEqual(ref field, ref value) => compare(field, Comparison::GreaterOrEqual, value),
+            Filter::LessOrEqual(ref field, ref value) => compare(field, Comparison::LessOrEqual, value),
+            Filter::In(ref field, ref values) => Self::In(FieldPath::parse(field), ValueSet::new(values)),
+            Filter::Contains(ref field, ref substring) => {
+                Self::Contains(
+                    FieldPath::parse(field),
+                    Finder::new(substring.as_bytes()).into_owned(),
+                )
             },
-            Filter::GreaterOrEqual(ref field, ref value) => {
-                if let &Value::Number(ref v) = value {
-                    if let Some(&Value::Number(ref n)) = doc.data().get(field.as_str()) {
-                        n.as_f64().unwrap_or(0.0) >= v.as_f64().unwrap_or(0.0)
-                    }
-                    else {
-                        false
-                    }
-                }
-                else {
-                    false
-                }
+            Filter::StartsWith(ref field, ref prefix) => Self::StartsWith(FieldPath::parse(field), prefix.clone()),
+            Filter::EndsWith(ref field, ref suffix) => Self::EndsWith(FieldPath::parse(field), suffix.clone()),
+            Filter::Exists(ref field, exists) => Self::Exists(FieldPath::parse(field), exists),
+            Filter::And(..) => {
+                let mut predicates = Vec::new();
+                collect_and(filter, &mut predicates);
+                Self::all(predicates)
             },
-            Filter::LessOrEqual(ref field, ref value) => {
-                if let &Value::Number(ref v) = value {
-                    if let Some(&Value::Number(ref n)) = doc.data().get(field.as_str()) {
-                        n.as_f64().unwrap_or(0.0) <= v.as_f64().unwrap_or(0.0)
-                    }
-                    else {
-                        false
-                    }
-                }
-                else {
-                    false
+            Filter::Or(..) => {
+                let mut predicates = Vec::new();
+                collect_or(filter, &mut predicates);
+                Self::any(predicates)
+            },
+        }
+    }
+
+    /// Combines predicates that must all match, testing the cheapest first.
+    fn all(mut predicates: Vec<Self>) -> Self {
+        if predicates.iter().any(|p| matches!(*p, Self::Never)) {
+            return Self::Never;
+        }
+        predicates.sort_by_key(Self::cost);
+        Self::All(predicates)
+    }
+
+    /// Combines predicates of which any must match, testing the cheapest first.
+    fn any(mut predicates: Vec<Self>) -> Self {
+        predicates.retain(|p| !matches!(*p, Self::Never));
+        if predicates.is_empty() {
+            return Self::Never;
+        }
+        predicates.sort_by_key(Self::cost);
+        Self::Any(predicates)
+    }
+
+    /// Returns the relative cost of testing the predicate against a document.
+    ///
+    /// Selective predicates rank as cheaper than equally fast ones that match more documents,
+    /// since evaluating them first skips more of the remaining predicates.
+    fn cost(&self) -> u32 {
+        match *self {
+            Self::Never => 0,
+            Self::Equals(ref path, _) => path.depth(),
+            Self::In(ref path, _) => path.depth().saturating_add(1),
+            Self::Compare(ref path, ..) | Self::StartsWith(ref path, _) | Self::EndsWith(ref path, _) => {
+                path.depth().saturating_add(2)
+            },
+            Self::Exists(ref path, _) => path.depth().saturating_add(3),
+            Self::Contains(ref path, _) => path.depth().saturating_add(5),
+            Self::All(ref predicates) | Self::Any(ref predicates) => {
+                predicates
+                    .iter()
+                    .fold(0u32, |cost, p| cost.saturating_add(p.cost()))
+            },
+        }
+    }
+
+    /// Returns whether the document matches the predicate.
+    fn matches<D: DocumentFields + ?Sized>(&self, doc: &D) -> bool {
+        #[allow(
+            clippy::needless_borrowed_reference,
+            reason = "clippy suggestions are incorrect for matching &Value patterns"
+        )]
+        match *self {
+            Self::Never => false,
+            Self::Equals(ref path, ref value) => path.resolve(doc).as_deref() == Some(value),
+            Self::Compare(ref path, comparison, bound) => {
+                match path.resolve(doc).as_deref() {
+                    Some(&Value::Number(ref n)) => comparison.holds(n.as_f64().unwrap_or(0.0), bound),
+                    _ => false,
                 }
             },
-            Filter::In(ref field, ref values) => {
-                doc.data()
-                    .get(field.as_str())
+            Self::In(ref path, ref values) => {
+                path.resolve(doc)
+                    .as_deref()
                     .is_some_and(|v| values.contains(v))
             },
-            Filter::Contains(ref field, ref substring) => {
-                match doc.data().get(field.as_str()) {
+            Self::Contains(ref path, ref finder) => {
+                match path.resolve(doc).as_deref() {
                     Some(&Value::Array(ref arr)) => {
                         arr.iter().any(|v| {
                             if let &Value::String(ref s) = v {
-                                s.contains(substring)
+                                finder.find(s.as_bytes()).is_some()
                             }
                             else {
                                 false
                             }
                         })
                     },
-                    Some(&Value::String(ref s)) => s.contains(substring),
+                    Some(&Value::String(ref s)) => finder.find(s.as_bytes()).is_some(),
                     _ => false,
                 }
             },
-            Filter::StartsWith(ref field, ref prefix) => {
-                match doc.data().get(field.as_str()) {
-                    Some(&Value::String(ref s)) => s.starts_with(prefix),
+            Self::StartsWith(ref path, ref prefix) => {
+                match path.resolve(doc).as_deref() {
+                    Some(&Value::String(ref s)) => s.starts_with(prefix.as_str()),
                     _ => false,
                 }
             },
-            Filter::EndsWith(ref field, ref suffix) => {
-                match doc.data().get(field.as_str()) {
-                    Some(&Value::String(ref s)) => s.ends_with(suffix),
+            Self::EndsWith(ref path, ref suffix) => {
+                match path.resolve(doc).as_deref() {
+                    Some(&Value::String(ref s)) => s.ends_with(suffix.as_str()),
                     _ => false,
                 }
             },
-            Filter::Exists(ref field, ref exists) => {
-                let field_exists = doc.data().get(field.as_str()).is_some();
-                field_exists == *exists
-            },
-            Filter::And(ref left, ref right) => {
-                matches_filters(doc, &[left.as_ref()]) && matches_filters(doc, &[right.as_ref()])
-            },
-            Filter::Or(ref left, ref right) => {
-                matches_filters(doc, &[left.as_ref()]) || matches_filters(doc, &[right.as_ref()])
-            },
-        };
-        if !matches {
-            return false;
+            Self::Exists(ref path, exists) => path.resolve(doc).is_some() == exists,
+            Self::All(ref predicates) => predicates.iter().all(|p| p.matches(doc)),
+            Self::Any(ref predicates) => predicates.iter().any(|p| p.matches(doc)),
         }
     }
-    true
+}
+
+/// Collects the compiled operands of a tree of `And` filters.
+fn collect_and(filter: &Filter, predicates: &mut Vec<Predicate>) {
+    if let Filter::And(ref left, ref right) = *filter {
+        collect_and(left, predicates);
+        collect_and(right, predicates);
+    }
+    else {
+        predicates.push(Predicate::compile(filter));
+    }
+}
+
+/// Collects the compiled operands of a tree of `Or` filters.
+fn collect_or(filter: &Filter, predicates: &mut Vec<Predicate>) {
+    if let Filter::Or(ref left, ref right) = *filter {
+        collect_or(left, predicates);
+        collect_or(right, predicates);
+    }
+    else {
+        predicates.push(Predicate::compile(filter));
+    }
+}
+
+/// A set of filters combined with AND, compiled once for matching many documents.
+///
+/// Compiling parses the field paths, converts numeric constants, hashes the constants of `In`
+/// filters, builds the substring searchers of `Contains` filters and orders the filters so the
+/// cheapest and most selective are tested first. A plan matches exactly the documents
+/// [`matches_filters`] matches for the same filters.
+///
+/// # Example
+///
+/// ```rust
+/// use sentinel_dbms::{Filter, FilterPlan, Document};
+/// use serde_json::json;
+///
+/// # async fn example() -> Result<(), Box<dyn std::error::Error>> {
+/// let plan = FilterPlan::compile(&[
+///     Filter::Contains("bio".to_string(), "rust".to_string()),
+///     Filter::Equals("address.city".to_string(), json!("Paris")),
+/// ]);
+/// let doc = Document::new_without_signature(
+///     "user-1".to_string(),
+///     json!({"bio": "rustacean", "address": {"city": "Paris"}}),
+/// )
+/// .await?;
+/// assert!(plan.matches(&doc));
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Debug, Clone)]
+pub struct FilterPlan {
+    /// The compiled filters.
+    predicate: Predicate,
+    /// The filters with nested `And` filters flattened, for index selection.
+    conjuncts: Vec<Filter>,
+}
+
+impl FilterPlan {
+    /// Compiles a set of filters combined with AND.
+    pub fn compile<'f, I: IntoIterator<Item = &'f Filter>>(filters: I) -> Self {
+        /// Flattens a tree of `And` filters into its operands.
+        fn flatten(filter: &Filter, conjuncts: &mut Vec<Filter>) {
+            if let Filter::And(ref left, ref right) = *filter {
+                flatten(left, conjuncts);
+                flatten(right, conjuncts);
+            }
+            else {
+                conjuncts.push(filter.clone());
+            }
+        }
+
+        let mut conjuncts = Vec::new();
+        for filter in filters {
+            flatten(filter, &mut conjuncts);
+        }
+        let predicate = Predicate::all(conjuncts.iter().map(Predicate::compile).collect());
+        Self {
+            predicate,
+            conjuncts,
+        }
+    }
+
+    /// Returns whether the document matches all filters of the plan.
+    pub fn matches<D: DocumentFields + ?Sized>(&self, doc: &D) -> bool { self.predicate.matches(doc) }
+
+    /// Returns the filters of the plan, none of which is an `And` filter.
+    pub fn conjuncts(&self) -> &[Filter] { &self.conjuncts }
 }
 
 #[cfg(test)]
@@ -376,4 +698,138 @@ mod tests {
         ];
         assert!(!matches_filters(&doc, &filters.iter().collect::<Vec<_>>()));
     }
+
+    #[tokio::test]
+    async fn test_matches_filters_nested_paths() {
+        let doc = create_doc(json!({
+            "address": {"city": "Paris", "geo": {"lat": 48.8}},
+            "tags": ["rust", "db"],
+            "a.b": 1,
+            "a": {"b": 2},
+            "x/y": {"~z": true}
+        }))
+        .await;
+
+        assert!(matches_filters(
+            &doc,
+            &[&Filter::Equals("address.city".to_string(), json!("Paris"))]
+        ));
+        assert!(matches_filters(
+            &doc,
+            &[&Filter::GreaterThan(
+                "address.geo.lat".to_string(),
+                json!(40)
+            )]
+        ));
+        assert!(matches_filters(
+            &doc,
+            &[&Filter::Equals("tags.1".to_string(), json!("db"))]
+        ));
+        assert!(matches_filters(
+            &doc,
+            &[&Filter::Exists("address.zip".to_string(), false)]
+        ));
+
+        // A top-level field named like the dotted path takes precedence
+        assert!(matches_filters(
+            &doc,
+            &[&Filter::Equals("a.b".to_string(), json!(1))]
+        ));
+        // JSON pointers always walk into nested values
+        assert!(matches_filters(
+            &doc,
+            &[&Filter::Equals("/a/b".to_string(), json!(2))]
+        ));
+        assert!(matches_filters(
+            &doc,
+            &[&Filter::Equals("/x~1y/~0z".to_string(), json!(true))]
+        ));
+        assert!(matches_filters(
+            &doc,
+            &[&Filter::Contains("/tags".to_string(), "us".to_string())]
+        ));
+    }
+
+    #[tokio::test]
+    async fn test_matches_filters_in_mixed_constants() {
+        let filter = Filter::In(
+            "value".to_string(),
+            vec![json!("a"), json!(2), json!(null), json!([1])],
+        );
+        for (value, expected) in [
+            (json!("a"), true),
+            (json!(2), true),
+            (json!(null), true),
+            (json!([1]), true),
+            (json!("2"), false),
+            (json!(2.5), false),
+            (json!(false), false),
+        ] {
+            let doc = create_doc(json!({ "value": value })).await;
+            assert_eq!(
+                matches_filters(&doc, &[&filter]),
+                expected,
+                "value {}",
+                value
+            );
+        }
+    }
+
+    #[test]
+    fn test_filter_plan_orders_predicates() {
+        let plan = FilterPlan::compile(&[
+            Filter::Contains("bio".to_string(), "x".to_string()),
+            Filter::And(
+                Box::new(Filter::Exists("name".to_string(), true)),
+                Box::new(Filter::Equals("age".to_string(), json!(3))),
+            ),
+        ]);
+        assert_eq!(plan.conjuncts().len(), 3);
+
+        let Predicate::All(ref predicates) = plan.predicate
+        else {
+            panic!("expected a conjunction, got {:?}", plan.predicate);
+        };
+        assert!(matches!(predicates[0], Predicate::Equals(..)));
+        assert!(matches!(predicates[1], Predicate::Exists(..)));
+        assert!(matches!(predicates[2], Predicate::Contains(..)));
+
+        let never = FilterPlan::compile(&[
+            Filter::Equals("age".to_string(), json!(3)),
+            Filter::GreaterThan("age".to_string(), json!("x")),
+        ]);
+        assert!(matches!(never.predicate, Predicate::Never));
+    }
+
+    #[tokio::test]
+    async fn test_filter_plan_matches_like_filters() {
+        let docs = [
+            json!({"name": "Alice", "age": 25, "tags": ["admin"]}),
+            json!({"name": "Bob", "age": 40}),
+            json!({"name": "Carol", "tags": ["dev", "ops"]}),
+        ];
+        let filters = [
+            Filter::Or(
+                Box::new(Filter::Contains("tags".to_string(), "dm".to_string())),
+                Box::new(Filter::Or(
+                    Box::new(Filter::GreaterOrEqual("age".to_string(), json!(30))),
+                    Box::new(Filter::EndsWith("name".to_string(), "ol".to_string())),
+                )),
+            ),
+            Filter::In("name".to_string(), vec![json!("Alice"), json!("Carol")]),
+        ];
+        let plan = FilterPlan::compile(&filters);
+        let mut matched = Vec::new();
+        for data in docs {
+            let doc = create_doc(data).await;
+            assert_eq!(
+                plan.matches(&doc),
+                matches_filters(&doc, &filters.iter().collect::<Vec<_>>())
+            );
+            if plan.matches(&doc) {
+                matched.push(doc.data()["name"].clone());
+            }
+        }
+        assert_eq!(matched, vec![json!("Alice"), json!("Carol")]);
+    }
 }
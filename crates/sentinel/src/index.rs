@@ -0,0 +1,1077 @@
+//! Secondary field indexes for collections.
+//!
+//! An index maps the value of a document field to the set of document IDs holding that value,
+//! which lets queries resolve their candidate documents without opening every file in the
+//! collection. The field is resolved like the fields of filters, so it may be a dotted path or a
+//! JSON pointer into nested values. Two kinds of index are supported:
+//!
+//! - [`IndexKind::Hash`] serves `Equals` and `In` filters.
+//! - [`IndexKind::Ordered`] additionally serves numeric range filters (`GreaterThan`, `LessThan`,
+//!   `GreaterOrEqual`, `LessOrEqual`) and string `StartsWith` filters, and lets queries sorted by a
+//!   top-level field read their documents in sort order from a cursor.
+//!
+//! Index definitions are persisted in the collection metadata, while the indexed values live in
+//! `.indexes.json` next to `.metadata.json`, sealed like the document files when the collection
+//! is encrypted. Indexes only ever narrow the set of candidate
+//! documents: every candidate is still checked against the full filter set, so using an index
+//! never changes the result of a query.
+
+use std::{
+    cmp::Ordering,
+    collections::{BTreeMap, BTreeSet, HashMap},
+    ops::Bound,
+    path::Path,
+    sync::{Arc, RwLock},
+};
+
+use serde::{Deserialize, Serialize};
+use serde_json::Value;
+use tracing::{debug, trace, warn};
+
+use crate::{
+    constants::COLLECTION_INDEXES_FILE,
+    filtering::FieldPath,
+    storage::DocumentFiles,
+    Filter,
+    Result,
+    SortOrder,
+};
+
+/// Format version of the persisted index file.
+const INDEX_FILE_VERSION: u32 = 1;
+
+/// Index set shared between a collection and its background metadata task.
+pub type SharedIndexes = Arc<RwLock<IndexSet>>;
+
+/// The kind of a secondary index.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, Serialize, Deserialize)]
+#[serde(rename_all = "lowercase")]
+pub enum IndexKind {
+    /// Exact-match index serving `Equals` and `In` filters.
+    Hash,
+    /// Ordered index serving exact matches, numeric ranges and string prefixes.
+    Ordered,
+}
+
+impl std::fmt::Display for IndexKind {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match *self {
+            Self::Hash => write!(f, "hash"),
+            Self::Ordered => write!(f, "ordered"),
+        }
+    }
+}
+
+impl std::str::FromStr for IndexKind {
+    type Err = String;
+
+    fn from_str(s: &str) -> std::result::Result<Self, Self::Err> {
+        match s.to_lowercase().as_str() {
+            "hash" => Ok(Self::Hash),
+            "ordered" => Ok(Self::Ordered),
+            _ => Err(format!("Invalid index kind: {}", s)),
+        }
+    }
+}
+
+/// Declaration of a secondary index on a document field.
+#[derive(Debug, Clone, PartialEq, Eq, Hash, Serialize, Deserialize)]
+pub struct IndexDefinition {
+    /// The indexed field, resolved like the fields of filters.
+    pub field: String,
+    /// The kind of index maintained for the field.
+    pub kind:  IndexKind,
+}
+
+impl IndexDefinition {
+    /// Creates a new index definition for the given field.
+    pub fn new<S: Into<String>>(field: S, kind: IndexKind) -> Self {
+        Self {
+            field: field.into(),
+            kind,
+        }
+    }
+}
+
+/// A JSON number with a total order, used as key of the numeric side of ordered indexes.
+#[derive(Debug, Clone, Copy)]
+struct OrderedNumber(f64);
+
+impl OrderedNumber {
+    /// Converts a JSON number the same way filter matching does.
+    #[allow(
+        clippy::float_cmp,
+        reason = "exact comparison against zero is intended"
+    )]
+    fn from_number(n: &serde_json::Number) -> Self {
+        let value = n.as_f64().unwrap_or(0.0);
+        // Filters compare with IEEE semantics where -0.0 == 0.0, while `total_cmp` orders them
+        // apart, so fold negative zero into positive zero.
+        if value == 0.0 {
+            Self(0.0)
+        }
+        else {
+            Self(value)
+        }
+    }
+}
+
+impl PartialEq for OrderedNumber {
+    fn eq(&self, other: &Self) -> bool { self.cmp(other) == Ordering::Equal }
+}
+
+impl Eq for OrderedNumber {}
+
+impl PartialOrd for OrderedNumber {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> { Some(self.cmp(other)) }
+}
+
+impl Ord for OrderedNumber {
+    fn cmp(&self, other: &Self) -> Ordering { self.0.total_cmp(&other.0) }
+}
+
+/// Returns the canonical key used for exact-match lookups of a value.
+///
+/// Object keys are sorted and numbers keep their textual representation, so two values produce
+/// the same key exactly when they compare equal.
+fn exact_key(value: &Value) -> String { value.to_string() }
+
+/// Adds an ID to the posting set stored under `key`.
+fn link<K: Ord>(map: &mut BTreeMap<K, BTreeSet<String>>, key: K, id: &str) {
+    map.entry(key).or_default().insert(id.to_owned());
+}
+
+/// Removes an ID from the posting set stored under `key`, dropping the set once empty.
+fn unlink<K: Ord>(map: &mut BTreeMap<K, BTreeSet<String>>, key: &K, id: &str) {
+    if let Some(ids) = map.get_mut(key) {
+        ids.remove(id);
+        if ids.is_empty() {
+            map.remove(key);
+        }
+    }
+}
+
+/// Collects the union of all posting sets in a range of an ordered map.
+fn collect_range<K: Ord>(map: &BTreeMap<K, BTreeSet<String>>, lower: Bound<K>, upper: Bound<K>) -> BTreeSet<String> {
+    // `BTreeMap::range` panics when the start bound lies after the end bound
+    let is_empty_range = match (&lower, &upper) {
+        (&Bound::Included(ref l), &Bound::Included(ref u)) => l > u,
+        (&Bound::Included(ref l), &Bound::Excluded(ref u)) |
+        (&Bound::Excluded(ref l), &Bound::Included(ref u)) |
+        (&Bound::Excluded(ref l), &Bound::Excluded(ref u)) => l >= u,
+        _ => false,
+    };
+    if is_empty_range {
+        return BTreeSet::new();
+    }
+
+    map.range((lower, upper))
+        .flat_map(|(_, ids)| ids.iter().cloned())
+        .collect()
+}
+
+/// Rank of a number among the sort keys ordered by [`sort_rank`].
+const NUMBER_RANK: u8 = 3;
+
+/// Rank of a string among the sort keys ordered by [`sort_rank`].
+const STRING_RANK: u8 = 4;
+
+/// Returns the rank of a sort key among the kinds of keys sorted queries order apart: missing
+/// keys first, then null, booleans, numbers, strings, arrays and objects.
+const fn sort_rank(key: Option<&Value>) -> u8 {
+    match key {
+        None => 0,
+        Some(&Value::Null) => 1,
+        Some(&Value::Bool(_)) => 2,
+        Some(&Value::Number(_)) => NUMBER_RANK,
+        Some(&Value::String(_)) => STRING_RANK,
+        Some(&Value::Array(_)) => 5,
+        Some(&Value::Object(_)) => 6,
+    }
+}
+
+/// Appends the IDs of the posting sets `groups` yields to `ids` until it holds `limit` of them.
+///
+/// The IDs of the set stored under the key of `cursor` are taken after the cursor ID only.
+fn take_postings<'a, K, I>(groups: I, cursor: Option<(&K, &str)>, limit: usize, ids: &mut Vec<&'a String>)
+where
+    K: Ord + 'a,
+    I: Iterator<Item = (&'a K, &'a BTreeSet<String>)>,
+{
+    for (key, postings) in groups {
+        let after = cursor
+            .filter(|&(cursor_key, _)| cursor_key == key)
+            .map_or(Bound::Unbounded, |(_, id)| Bound::Excluded(id));
+        for id in postings.range::<str, _>((after, Bound::Unbounded)) {
+            if ids.len() >= limit {
+                return;
+            }
+            ids.push(id);
+        }
+    }
+}
+
+/// The in-memory structures of a single field index.
+#[derive(Debug)]
+pub struct FieldIndex {
+    /// The kind of this index.
+    kind:      IndexKind,
+    /// The parsed path of the indexed field.
+    path:      FieldPath,
+    /// Indexed value per document, used to unlink stale postings on update and delete.
+    values:    HashMap<String, Value>,
+    /// Postings by canonical value, serving exact matches.
+    exact:     BTreeMap<String, BTreeSet<String>>,
+    /// Postings by numeric value (ordered indexes only).
+    numbers:   BTreeMap<OrderedNumber, BTreeSet<String>>,
+    /// Postings by string value (ordered indexes only).
+    strings:   BTreeMap<String, BTreeSet<String>>,
+    /// Number of indexed values that are neither numbers nor strings, which the ordered maps
+    /// leave out.
+    unordered: usize,
+}
+
+impl FieldIndex {
+    /// Creates an empty index of the given kind on `field`.
+    fn new(field: &str, kind: IndexKind) -> Self {
+        Self {
+            kind,
+            path: FieldPath::parse(field),
+            values: HashMap::new(),
+            exact: BTreeMap::new(),
+            numbers: BTreeMap::new(),
+            strings: BTreeMap::new(),
+            unordered: 0,
+        }
+    }
+
+    /// Records the value of the indexed field for a document, replacing any previous value.
+    ///
+    /// A `None` value means the document does not have the field and is only unlinked.
+    fn set(&mut self, id: &str, value: Option<&Value>) {
+        self.remove(id);
+        let Some(value) = value
+        else {
+            return;
+        };
+
+        link(&mut self.exact, exact_key(value), id);
+        if self.kind == IndexKind::Ordered {
+            match *value {
+                Value::Number(ref n) => link(&mut self.numbers, OrderedNumber::from_number(n), id),
+                Value::String(ref s) => link(&mut self.strings, s.clone(), id),
+                _ => self.unordered = self.unordered.saturating_add(1),
+            }
+        }
+        self.values.insert(id.to_owned(), value.clone());
+    }
+
+    /// Removes a document from the index.
+    fn remove(&mut self, id: &str) {
+        let Some(previous) = self.values.remove(id)
+        else {
+            return;
+        };
+
+        unlink(&mut self.exact, &exact_key(&previous), id);
+        match previous {
+            Value::Number(ref n) => unlink(&mut self.numbers, &OrderedNumber::from_number(n), id),
+            Value::String(ref s) => unlink(&mut self.strings, s, id),
+            _ if self.kind == IndexKind::Ordered => self.unordered = self.unordered.saturating_sub(1),
+            _ => {},
+        }
+    }
+
+    /// Returns whether the index holds the documents of a query sorted by its field in order.
+    ///
+    /// Only ordered indexes on a top-level field whose values are all numbers or strings do, as
+    /// those are the values kept in order, and the top-level field is the one queries sort by.
+    fn sorts(&self) -> bool { self.kind == IndexKind::Ordered && self.unordered == 0 && self.path.is_top_level() }
+
+    /// Returns up to `limit` indexed documents that come after `after`, a sort key and a
+    /// document ID, in the sort `order`, with their sort keys.
+    ///
+    /// Documents are returned in sort order, ties broken by ascending ID, starting with the first
+    /// one when there is no cursor. Only meaningful when [`Self::sorts`] holds.
+    fn sorted_after(
+        &self,
+        order: SortOrder,
+        after: Option<(Option<&Value>, &str)>,
+        limit: usize,
+    ) -> Vec<(Value, String)> {
+        let cursor_rank = after.map(|(key, _)| sort_rank(key));
+        // A map is walked unless the cursor lies past it in walk order
+        let walks = |rank: u8| {
+            cursor_rank.is_none_or(|cursor| {
+                match order {
+                    SortOrder::Ascending => cursor <= rank,
+                    SortOrder::Descending => cursor >= rank,
+                }
+            })
+        };
+        let number_cursor = after.and_then(|(key, id)| {
+            match key {
+                Some(&Value::Number(ref n)) => Some((OrderedNumber::from_number(n), id)),
+                _ => None,
+            }
+        });
+        let string_cursor = after.and_then(|(key, id)| {
+            match key {
+                Some(&Value::String(ref s)) => Some((s, id)),
+                _ => None,
+            }
+        });
+        let number_bound = number_cursor.map_or(Bound::Unbounded, |(key, _)| Bound::Included(key));
+        let string_bound = string_cursor.map_or(Bound::Unbounded, |(key, _)| Bound::Included(key.as_str()));
+        let number_cursor = number_cursor.as_ref().map(|&(ref key, id)| (key, id));
+
+        let mut ids = Vec::new();
+        match order {
+            SortOrder::Ascending => {
+                if walks(NUMBER_RANK) {
+                    take_postings(
+                        self.numbers.range((number_bound, Bound::Unbounded)),
+                        number_cursor,
+                        limit,
+                        &mut ids,
+                    );
+                }
+                if walks(STRING_RANK) {
+                    take_postings(
+                        self.strings
+                            .range::<str, _>((string_bound, Bound::Unbounded)),
+                        string_cursor,
+                        limit,
+                        &mut ids,
+                    );
+                }
+            },
+            SortOrder::Descending => {
+                if walks(STRING_RANK) {
+                    take_postings(
+                        self.strings
+                            .range::<str, _>((Bound::Unbounded, string_bound))
+                            .rev(),
+                        string_cursor,
+                        limit,
+                        &mut ids,
+                    );
+                }
+                if walks(NUMBER_RANK) {
+                    take_postings(
+                        self.numbers.range((Bound::Unbounded, number_bound)).rev(),
+                        number_cursor,
+                        limit,
+                        &mut ids,
+                    );
+                }
+            },
+        }
+        ids.into_iter()
+            .filter_map(|id| Some((self.values.get(id)?.clone(), id.clone())))
+            .collect()
+    }
+
+    /// Returns the documents whose value equals `value` exactly.
+    fn lookup_exact(&self, value: &Value) -> BTreeSet<String> {
+        self.exact
+            .get(&exact_key(value))
+            .cloned()
+            .unwrap_or_default()
+    }
+
+    /// Returns the documents whose numeric value falls in the given bounds.
+    ///
+    /// Returns `None` for hash indexes, which cannot serve range lookups.
+    fn lookup_numeric_range(&self, lower: Bound<&Value>, upper: Bound<&Value>) -> Option<BTreeSet<String>> {
+        if self.kind != IndexKind::Ordered {
+            return None;
+        }
+
+        /// Converts a filter bound; a non-numeric constant never matches a numeric filter.
+        fn convert(bound: Bound<&Value>) -> Option<Bound<OrderedNumber>> {
+            match bound {
+                Bound::Included(&Value::Number(ref n)) => Some(Bound::Included(OrderedNumber::from_number(n))),
+                Bound::Excluded(&Value::Number(ref n)) => Some(Bound::Excluded(OrderedNumber::from_number(n))),
+                Bound::Unbounded => Some(Bound::Unbounded),
+                _ => None,
+            }
+        }
+
+        match (convert(lower), convert(upper)) {
+            (Some(l), Some(u)) => Some(collect_range(&self.numbers, l, u)),
+            _ => Some(BTreeSet::new()),
+        }
+    }
+
+    /// Returns the documents whose string value starts with `prefix`.
+    ///
+    /// Returns `None` for hash indexes, which cannot serve prefix lookups.
+    fn lookup_prefix(&self, prefix: &str) -> Option<BTreeSet<String>> {
+        if self.kind != IndexKind::Ordered {
+            return None;
+        }
+
+        Some(
+            self.strings
+                .range::<str, _>((Bound::Included(prefix), Bound::Unbounded))
+                .take_while(|entry| entry.0.starts_with(prefix))
+                .flat_map(|(_, ids)| ids.iter().cloned())
+                .collect(),
+        )
+    }
+}
+
+/// On-disk representation of a single index.
+#[derive(Debug, Serialize, Deserialize)]
+struct PersistedIndex {
+    /// The indexed field.
+    field:  String,
+    /// The kind of the index.
+    kind:   IndexKind,
+    /// Indexed value per document ID.
+    values: BTreeMap<String, Value>,
+}
+
+/// On-disk representation of all indexes of a collection.
+#[derive(Debug, Serialize, Deserialize)]
+struct PersistedIndexes {
+    /// File format version.
+    version: u32,
+    /// The persisted indexes.
+    indexes: Vec<PersistedIndex>,
+}
+
+/// All secondary indexes of a collection.
+#[derive(Debug, Default)]
+pub struct IndexSet {
+    /// Indexes keyed by field name.
+    indexes: BTreeMap<String, FieldIndex>,
+    /// Whether the in-memory state differs from what was last persisted.
+    dirty:   bool,
+}
+
+impl IndexSet {
+    /// Returns whether no index is defined.
+    pub fn is_empty(&self) -> bool { self.indexes.is_empty() }
+
+    /// Returns the definitions of all indexes, ordered by field name.
+    pub fn definitions(&self) -> Vec<IndexDefinition> {
+        self.indexes
+            .iter()
+            .map(|(field, index)| IndexDefinition::new(field.clone(), index.kind))
+            .collect()
+    }
+
+    /// Defines a new empty index, replacing any existing index on the same field.
+    pub fn define(&mut self, definition: &IndexDefinition) {
+        self.indexes.insert(
+            definition.field.clone(),
+            FieldIndex::new(&definition.field, definition.kind),
+        );
+        self.dirty = true;
+    }
+
+    /// Removes the index on `field`, returning whether one existed.
+    pub fn remove_index(&mut self, field: &str) -> bool {
+        let removed = self.indexes.remove(field).is_some();
+        self.dirty |= removed;
+        removed
+    }
+
+    /// Indexes (or re-indexes) a document with the given data.
+    pub fn index_document(&mut self, id: &str, data: &Value) {
+        for index in self.indexes.values_mut() {
+            let value = index.path.resolve(data);
+            index.set(id, value.as_deref());
+        }
+        self.dirty |= !self.indexes.is_empty();
+    }
+
+    /// Indexes a document in a single index only, used while building a new index.
+    pub fn index_document_field(&mut self, field: &str, id: &str, data: &Value) {
+        if let Some(index) = self.indexes.get_mut(field) {
+            let value = index.path.resolve(data);
+            index.set(id, value.as_deref());
+            self.dirty = true;
+        }
+    }
+
+    /// Removes a document from all indexes.
+    pub fn remove_document(&mut self, id: &str) {
+        for index in self.indexes.values_mut() {
+            index.remove(id);
+        }
+        self.dirty |= !self.indexes.is_empty();
+    }
+
+    /// Resolves the candidate document IDs for a set of filters combined with AND.
+    ///
+    /// Returns `None` when no filter can be answered from an index, meaning the caller has to
+    /// scan the whole collection. Otherwise returns a sorted superset of the matching IDs.
+    pub fn candidate_ids(&self, filters: &[Filter]) -> Option<Vec<String>> {
+        let mut candidates: Option<BTreeSet<String>> = None;
+        for filter in filters {
+            if let Some(ids) = self.candidates_for(filter) {
+                candidates = Some(match candidates {
+                    Some(current) => current.intersection(&ids).cloned().collect(),
+                    None => ids,
+                });
+            }
+        }
+        candidates.map(|ids| ids.into_iter().collect())
+    }
+
+    /// Resolves the candidate IDs for a single filter, or `None` if no index applies.
+    fn candidates_for(&self, filter: &Filter) -> Option<BTreeSet<String>> {
+        match *filter {
+            Filter::Equals(ref field, ref value) => {
+                self.indexes
+                    .get(field)
+                    .map(|index| index.lookup_exact(value))
+            },
+            Filter::In(ref field, ref values) => {
+                self.indexes.get(field).map(|index| {
+                    values
+                        .iter()
+                        .flat_map(|value| index.lookup_exact(value))
+                        .collect()
+                })
+            },
+            Filter::GreaterThan(ref field, ref value) => {
+                self.indexes
+                    .get(field)
+                    .and_then(|index| index.lookup_numeric_range(Bound::Excluded(value), Bound::Unbounded))
+            },
+            Filter::GreaterOrEqual(ref field, ref value) => {
+                self.indexes
+                    .get(field)
+                    .and_then(|index| index.lookup_numeric_range(Bound::Included(value), Bound::Unbounded))
+            },
+            Filter::LessThan(ref field, ref value) => {
+                self.indexes
+                    .get(field)
+                    .and_then(|index| index.lookup_numeric_range(Bound::Unbounded, Bound::Excluded(value)))
+            },
+            Filter::LessOrEqual(ref field, ref value) => {
+                self.indexes
+                    .get(field)
+                    .and_then(|index| index.lookup_numeric_range(Bound::Unbounded, Bound::Included(value)))
+            },
+            Filter::StartsWith(ref field, ref prefix) => {
+                self.indexes
+                    .get(field)
+                    .and_then(|index| index.lookup_prefix(prefix))
+            },
+            Filter::And(ref left, ref right) => {
+                match (self.candidates_for(left), self.candidates_for(right)) {
+                    (Some(l), Some(r)) => Some(l.intersection(&r).cloned().collect()),
+                    (Some(ids), None) | (None, Some(ids)) => Some(ids),
+                    (None, None) => None,
+                }
+            },
+            Filter::Or(ref left, ref right) => {
+                // Both branches must be indexed, otherwise the unindexed branch may match anything
+                let mut ids = self.candidates_for(left)?;
+                ids.extend(self.candidates_for(right)?);
+                Some(ids)
+            },
+            Filter::Contains(..) | Filter::EndsWith(..) | Filter::Exists(..) => None,
+        }
+    }
+
+    /// Returns whether queries sorted by `field` can read their documents in sort order from its
+    /// index, see [`Self::sorted_after`].
+    pub fn sorts_by(&self, field: &str) -> bool { self.indexes.get(field).is_some_and(FieldIndex::sorts) }
+
+    /// Returns up to `limit` documents holding `field` that come after `after`, a sort key and a
+    /// document ID, in the sort `order`, with their sort keys and in sort order.
+    ///
+    /// Ties are broken by ascending ID, like sorted queries do. Documents without the field are
+    /// not indexed and never returned. Returns `None` unless [`Self::sorts_by`] holds.
+    pub fn sorted_after(
+        &self,
+        field: &str,
+        order: SortOrder,
+        after: Option<(Option<&Value>, &str)>,
+        limit: usize,
+    ) -> Option<Vec<(Value, String)>> {
+        let index = self.indexes.get(field).filter(|index| index.sorts())?;
+        Some(index.sorted_after(order, after, limit))
+    }
+
+    /// Returns whether the index on `field` holds a value for the document `id`.
+    pub fn indexes_document(&self, field: &str, id: &str) -> bool {
+        self.indexes
+            .get(field)
+            .is_some_and(|index| index.values.contains_key(id))
+    }
+
+    /// Marks the index set as modified so it is persisted on the next save.
+    pub const fn mark_dirty(&mut self) { self.dirty = true; }
+
+    /// Serializes the index set if it changed since the last call, clearing the dirty flag.
+    ///
+    /// Returns `Ok(None)` when there is nothing to persist.
+    fn take_snapshot(&mut self) -> Result<Option<String>> {
+        if !self.dirty {
+            return Ok(None);
+        }
+
+        let persisted = PersistedIndexes {
+            version: INDEX_FILE_VERSION,
+            indexes: self
+                .indexes
+                .iter()
+                .map(|(field, index)| {
+                    PersistedIndex {
+                        field:  field.clone(),
+                        kind:   index.kind,
+                        values: index
+                            .values
+                            .iter()
+                            .map(|(id, value)| (id.clone(), value.clone()))
+                            .collect(),
+                    }
+                })
+                .collect(),
+        };
+        let content = serde_json::to_string(&persisted)?;
+        self.dirty = false;
+        Ok(Some(content))
+    }
+
+    /// Loads the indexes of a collection from its `.indexes.json` file, read through `files` so
+    /// that the file of an encrypted collection is opened with its cipher.
+    ///
+    /// Only the indexes listed in `definitions` are loaded. The returned flag is `true` when at
+    /// least one defined index could not be restored from disk (missing or unreadable file,
+    /// unknown field or changed kind) and the set must be rebuilt from the documents.
+    pub async fn load(collection_path: &Path, definitions: &[IndexDefinition], files: &DocumentFiles) -> (Self, bool) {
+        let mut set = Self::default();
+        for definition in definitions {
+            set.indexes.insert(
+                definition.field.clone(),
+                FieldIndex::new(&definition.field, definition.kind),
+            );
+        }
+        if definitions.is_empty() {
+            return (set, false);
+        }
+
+        let index_path = collection_path.join(COLLECTION_INDEXES_FILE);
+        let persisted = match files.read(&index_path).await {
+            Ok(Some((content, _))) => {
+                match serde_json::from_slice::<PersistedIndexes>(&content) {
+                    Ok(persisted) if persisted.version == INDEX_FILE_VERSION => persisted,
+                    Ok(persisted) => {
+                        warn!(
+                            "Unsupported index file version {} in {:?}, rebuilding indexes",
+                            persisted.version, index_path
+                        );
+                        return (set, true);
+                    },
+                    Err(e) => {
+                        warn!(
+                            "Failed to parse index file {:?}: {}, rebuilding indexes",
+                            index_path, e
+                        );
+                        return (set, true);
+                    },
+                }
+            },
+            Ok(None) => {
+                debug!("Index file {:?} not found, rebuilding indexes", index_path);
+                return (set, true);
+            },
+            Err(e) => {
+                debug!(
+                    "Index file {:?} not readable ({}), rebuilding indexes",
+                    index_path, e
+                );
+                return (set, true);
+            },
+        };
+
+        let mut restored = 0_usize;
+        for persisted_index in persisted.indexes {
+            if let Some(index) = set.indexes.get_mut(&persisted_index.field) &&
+                index.kind == persisted_index.kind
+            {
+                for (id, value) in &persisted_index.values {
+                    index.set(id, Some(value));
+                }
+                restored = restored.saturating_add(1);
+            }
+        }
+
+        trace!(
+            "Restored {} of {} indexes from {:?}",
+            restored,
+            definitions.len(),
+            index_path
+        );
+        (set, restored < definitions.len())
+    }
+}
+
+/// Persists the indexes of a collection to its `.indexes.json` file if they changed.
+///
+/// The file is written through `files`, so the indexes of an encrypted collection are sealed
+/// like its documents. When no index is defined anymore the file is removed.
+pub async fn persist_indexes(collection_path: &Path, indexes: &SharedIndexes, files: &DocumentFiles) -> Result<()> {
+    let (snapshot, is_empty) = {
+        let mut guard = indexes.write().unwrap();
+        (guard.take_snapshot()?, guard.is_empty())
+    };
+    let Some(content) = snapshot
+    else {
+        return Ok(());
+    };
+
+    let index_path = collection_path.join(COLLECTION_INDEXES_FILE);
+    let result = if is_empty {
+        files.remove(&index_path).await.map(drop)
+    }
+    else {
+        files
+            .write(&index_path, content.into_bytes(), false)
+            .await
+            .map(drop)
+    };
+
+    if let Err(e) = result {
+        // Keep the changes pending so the next save retries
+        indexes.write().unwrap().mark_dirty();
+        return Err(e);
+    }
+
+    trace!("Indexes persisted to {:?}", index_path);
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use serde_json::json;
+
+    use super::*;
+
+    fn plain_files() -> DocumentFiles { DocumentFiles::new(Arc::new(crate::BlockingBackend), None) }
+
+    fn make_set(definitions: &[IndexDefinition]) -> IndexSet {
+        let mut set = IndexSet::default();
+        for definition in definitions {
+            set.define(definition);
+        }
+        set
+    }
+
+    #[test]
+    fn test_hash_index_equals_and_in() {
+        let mut set = make_set(&[IndexDefinition::new("actor", IndexKind::Hash)]);
+        set.index_document("a", &json!({"actor": "alice"}));
+        set.index_document("b", &json!({"actor": "bob"}));
+        set.index_document("c", &json!({"actor": "alice"}));
+
+        let ids = set.candidate_ids(&[Filter::Equals("actor".to_owned(), json!("alice"))]);
+        assert_eq!(ids, Some(vec!["a".to_owned(), "c".to_owned()]));
+
+        let ids = set.candidate_ids(&[Filter::In(
+            "actor".to_owned(),
+            vec![json!("bob"), json!("carol")],
+        )]);
+        assert_eq!(ids, Some(vec!["b".to_owned()]));
+    }
+
+    #[test]
+    fn test_index_on_nested_field() {
+        let mut set = make_set(&[
+            IndexDefinition::new("address.city", IndexKind::Hash),
+            IndexDefinition::new("/geo/lat", IndexKind::Ordered),
+        ]);
+        set.index_document(
+            "a",
+            &json!({"address": {"city": "Paris"}, "geo": {"lat": 48.8}}),
+        );
+        set.index_document("b", &json!({"address.city": "Paris", "geo": {"lat": 40.4}}));
+        set.index_document("c", &json!({"address": {"city": "Rome"}}));
+
+        let ids = set.candidate_ids(&[Filter::Equals("address.city".to_owned(), json!("Paris"))]);
+        assert_eq!(ids, Some(vec!["a".to_owned(), "b".to_owned()]));
+
+        let ids = set.candidate_ids(&[Filter::GreaterThan("/geo/lat".to_owned(), json!(45))]);
+        assert_eq!(ids, Some(vec!["a".to_owned()]));
+    }
+
+    #[test]
+    fn test_hash_index_does_not_serve_ranges() {
+        let mut set = make_set(&[IndexDefinition::new("age", IndexKind::Hash)]);
+        set.index_document("a", &json!({"age": 30}));
+        assert_eq!(
+            set.candidate_ids(&[Filter::GreaterThan("age".to_owned(), json!(10))]),
+            None
+        );
+    }
+
+    #[test]
+    fn test_ordered_index_ranges() {
+        let mut set = make_set(&[IndexDefinition::new("age", IndexKind::Ordered)]);
+        set.index_document("a", &json!({"age": 20}));
+        set.index_document("b", &json!({"age": 30}));
+        set.index_document("c", &json!({"age": 40.5}));
+        set.index_document("d", &json!({"age": "old"}));
+
+        let ids = set.candidate_ids(&[Filter::GreaterThan("age".to_owned(), json!(20))]);
+        assert_eq!(ids, Some(vec!["b".to_owned(), "c".to_owned()]));
+
+        let ids = set.candidate_ids(&[
+            Filter::GreaterOrEqual("age".to_owned(), json!(20)),
+            Filter::LessThan("age".to_owned(), json!(40)),
+        ]);
+        assert_eq!(ids, Some(vec!["a".to_owned(), "b".to_owned()]));
+
+        let ids = set.candidate_ids(&[Filter::LessOrEqual("age".to_owned(), json!(40.5))]);
+        assert_eq!(
+            ids,
+            Some(vec!["a".to_owned(), "b".to_owned(), "c".to_owned()])
+        );
+
+        // Inverted and non-numeric bounds match nothing
+        let ids = set.candidate_ids(&[
+            Filter::GreaterThan("age".to_owned(), json!(50)),
+            Filter::LessThan("age".to_owned(), json!(10)),
+        ]);
+        assert_eq!(ids, Some(vec![]));
+        let ids = set.candidate_ids(&[Filter::GreaterThan("age".to_owned(), json!("x"))]);
+        assert_eq!(ids, Some(vec![]));
+    }
+
+    #[test]
+    fn test_ordered_index_prefix() {
+        let mut set = make_set(&[IndexDefinition::new("path", IndexKind::Ordered)]);
+        set.index_document("a", &json!({"path": "/var/log"}));
+        set.index_document("b", &json!({"path": "/var/lib"}));
+        set.index_document("c", &json!({"path": "/usr"}));
+
+        let ids = set.candidate_ids(&[Filter::StartsWith("path".to_owned(), "/var".to_owned())]);
+        assert_eq!(ids, Some(vec!["a".to_owned(), "b".to_owned()]));
+    }
+
+    #[test]
+    fn test_ordered_index_sorted_after_cursor() {
+        let mut set = make_set(&[
+            IndexDefinition::new("rank", IndexKind::Ordered),
+            IndexDefinition::new("actor", IndexKind::Hash),
+        ]);
+        set.index_document("a", &json!({"rank": 2, "actor": "x"}));
+        set.index_document("b", &json!({"rank": "z"}));
+        set.index_document("c", &json!({"rank": 2}));
+        set.index_document("d", &json!({"rank": 1.5}));
+        set.index_document("e", &json!({"rank": "y"}));
+        set.index_document("f", &json!({}));
+        assert!(set.sorts_by("rank"));
+        assert!(!set.sorts_by("actor"));
+        assert!(!set.indexes_document("rank", "f"));
+
+        let ids = |order, after, limit| {
+            set.sorted_after("rank", order, after, limit)
+                .unwrap()
+                .into_iter()
+                .map(|(_, id)| id)
+                .collect::<Vec<_>>()
+        };
+        assert_eq!(
+            ids(SortOrder::Ascending, None, 10),
+            vec!["d", "a", "c", "e", "b"]
+        );
+        assert_eq!(
+            ids(SortOrder::Descending, None, 10),
+            vec!["b", "e", "a", "c", "d"]
+        );
+
+        // The walk resumes after the cursor, within ties and across value types
+        let two = json!(2);
+        assert_eq!(
+            ids(SortOrder::Ascending, Some((Some(&two), "a")), 2),
+            vec!["c", "e"]
+        );
+        assert_eq!(
+            ids(SortOrder::Descending, Some((Some(&two), "a")), 10),
+            vec!["c", "d"]
+        );
+        let y = json!("y");
+        assert_eq!(
+            ids(SortOrder::Descending, Some((Some(&y), "e")), 1),
+            vec!["a"]
+        );
+
+        // Documents without the field sort first, so nothing indexed precedes them
+        assert_eq!(
+            ids(SortOrder::Descending, Some((None, "f")), 10),
+            Vec::<String>::new()
+        );
+        assert_eq!(ids(SortOrder::Ascending, Some((None, "f")), 1), vec!["d"]);
+
+        // Values that are not kept in order stop the index from serving sorts
+        set.index_document("g", &json!({"rank": true}));
+        assert!(!set.sorts_by("rank"));
+        assert!(set
+            .sorted_after("rank", SortOrder::Ascending, None, 10)
+            .is_none());
+        set.remove_document("g");
+        assert!(set.sorts_by("rank"));
+    }
+
+    #[test]
+    fn test_reindex_and_remove() {
+        let mut set = make_set(&[IndexDefinition::new("status", IndexKind::Hash)]);
+        set.index_document("a", &json!({"status": "open"}));
+        set.index_document("a", &json!({"status": "closed"}));
+
+        let open = Filter::Equals("status".to_owned(), json!("open"));
+        let closed = Filter::Equals("status".to_owned(), json!("closed"));
+        assert_eq!(set.candidate_ids(&[open.clone()]), Some(vec![]));
+        assert_eq!(
+            set.candidate_ids(&[closed.clone()]),
+            Some(vec!["a".to_owned()])
+        );
+
+        set.index_document("a", &json!({"other": 1}));
+        assert_eq!(set.candidate_ids(&[closed.clone()]), Some(vec![]));
+
+        set.index_document("a", &json!({"status": "closed"}));
+        set.remove_document("a");
+        assert_eq!(set.candidate_ids(&[closed]), Some(vec![]));
+        assert!(set.indexes.get("status").unwrap().values.is_empty());
+    }
+
+    #[test]
+    fn test_and_or_combination() {
+        let mut set = make_set(&[
+            IndexDefinition::new("actor", IndexKind::Hash),
+            IndexDefinition::new("level", IndexKind::Ordered),
+        ]);
+        set.index_document("a", &json!({"actor": "alice", "level": 1}));
+        set.index_document("b", &json!({"actor": "bob", "level": 5}));
+        set.index_document("c", &json!({"actor": "alice", "level": 9}));
+
+        let and = Filter::And(
+            Box::new(Filter::Equals("actor".to_owned(), json!("alice"))),
+            Box::new(Filter::GreaterThan("level".to_owned(), json!(3))),
+        );
+        assert_eq!(set.candidate_ids(&[and]), Some(vec!["c".to_owned()]));
+
+        let or = Filter::Or(
+            Box::new(Filter::Equals("actor".to_owned(), json!("bob"))),
+            Box::new(Filter::LessThan("level".to_owned(), json!(2))),
+        );
+        assert_eq!(
+            set.candidate_ids(&[or]),
+            Some(vec!["a".to_owned(), "b".to_owned()])
+        );
+
+        // An OR with an unindexed branch cannot be answered from indexes
+        let or = Filter::Or(
+            Box::new(Filter::Equals("actor".to_owned(), json!("bob"))),
+            Box::new(Filter::Equals("unindexed".to_owned(), json!(true))),
+        );
+        assert_eq!(set.candidate_ids(&[or]), None);
+
+        // Unindexed filters alone fall back to a full scan
+        assert_eq!(
+            set.candidate_ids(&[Filter::Contains("actor".to_owned(), "li".to_owned())]),
+            None
+        );
+    }
+
+    #[tokio::test]
+    async fn test_persist_and_load_round_trip() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let definitions = vec![
+            IndexDefinition::new("actor", IndexKind::Hash),
+            IndexDefinition::new("level", IndexKind::Ordered),
+        ];
+        let shared: SharedIndexes = Arc::new(RwLock::new(make_set(&definitions)));
+        shared
+            .write()
+            .unwrap()
+            .index_document("a", &json!({"actor": "alice", "level": 3}));
+        let files = plain_files();
+        persist_indexes(temp_dir.path(), &shared, &files)
+            .await
+            .unwrap();
+
+        let (loaded, stale) = IndexSet::load(temp_dir.path(), &definitions, &files).await;
+        assert!(!stale);
+        assert_eq!(loaded.definitions(), definitions);
+        assert_eq!(
+            loaded.candidate_ids(&[Filter::GreaterThan("level".to_owned(), json!(1))]),
+            Some(vec!["a".to_owned()])
+        );
+
+        // A definition missing from the file requires a rebuild
+        let mut extended = definitions.clone();
+        extended.push(IndexDefinition::new("other", IndexKind::Hash));
+        let (_, stale) = IndexSet::load(temp_dir.path(), &extended, &files).await;
+        assert!(stale);
+    }
+
+    #[tokio::test]
+    async fn test_persisted_indexes_of_encrypted_collections_are_sealed() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let cipher = Arc::new(sentinel_crypto::EnvelopeCipher::new(
+            sentinel_crypto::EncryptionAlgorithmChoice::XChaCha20Poly1305,
+            &[7u8; 32],
+        ));
+        let files = DocumentFiles::new(Arc::new(crate::BlockingBackend), Some(cipher));
+        let definitions = vec![IndexDefinition::new("actor", IndexKind::Hash)];
+        let shared: SharedIndexes = Arc::new(RwLock::new(make_set(&definitions)));
+        shared
+            .write()
+            .unwrap()
+            .index_document("a", &json!({"actor": "alice"}));
+        persist_indexes(temp_dir.path(), &shared, &files)
+            .await
+            .unwrap();
+
+        let raw = std::fs::read(temp_dir.path().join(COLLECTION_INDEXES_FILE)).unwrap();
+        assert!(sentinel_crypto::is_envelope(&raw));
+        assert!(!raw.windows(5).any(|window| window == b"alice"));
+
+        let (loaded, stale) = IndexSet::load(temp_dir.path(), &definitions, &files).await;
+        assert!(!stale);
+        assert_eq!(
+            loaded.candidate_ids(&[Filter::Equals("actor".to_owned(), json!("alice"))]),
+            Some(vec!["a".to_owned()])
+        );
+
+        // Without the cipher the sealed file cannot be restored
+        let (_, stale) = IndexSet::load(temp_dir.path(), &definitions, &plain_files()).await;
+        assert!(stale);
+    }
+
+    #[tokio::test]
+    async fn test_load_without_file_is_stale() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let (set, stale) = IndexSet::load(temp_dir.path(), &[], &plain_files()).await;
+        assert!(set.is_empty());
+        assert!(!stale);
+
+        let (set, stale) = IndexSet::load(
+            temp_dir.path(),
+            &[IndexDefinition::new("actor", IndexKind::Hash)],
+            &plain_files(),
+        )
+        .await;
+        assert!(stale);
+        assert_eq!(set.definitions().len(), 1);
+    }
+
+    #[test]
+    fn test_index_kind_from_str() {
+        assert_eq!("hash".parse::<IndexKind>().unwrap(), IndexKind::Hash);
+        assert_eq!("Ordered".parse::<IndexKind>().unwrap(), IndexKind::Ordered);
+        assert!("btree".parse::<IndexKind>().is_err());
+        assert_eq!(IndexKind::Ordered.to_string(), "ordered");
+    }
+}
@@ -0,0 +1,244 @@
+//! Placement of document files within a collection directory.
+//!
+//! Every document is stored as a plain `<id>.json` file. A collection chooses where those files
+//! live:
+//!
+//! - `flat`: directly in the collection directory (the default)
+//! - `sharded`: two directory levels down, in `ab/cd/<id>.json`, where `abcd` are the first four
+//!   hex digits of the BLAKE3 hash of the ID
+//!
+//! Creating, renaming and listing files slows down once a directory holds hundreds of thousands
+//! of entries, on local filesystems and NFS alike. The sharded layout spreads the files of a
+//! collection over up to 65536 directories. The files themselves stay the same, and the shard of
+//! a document can be found by hand with `printf %s <id> | b3sum`.
+//!
+//! [`crate::Collection::migrate_layout`] moves a collection from one layout to the other while it
+//! stays in use. Until the migration completes, documents are looked up under both layouts and
+//! new files are written in the target layout.
+
+use std::{
+    path::{Path, PathBuf},
+    sync::Arc,
+};
+
+use serde::{Deserialize, Serialize};
+use sentinel_crypto::{hash::Blake3Hasher, HashFunction as _};
+
+use crate::{constants::DOCUMENT_EXTENSION, storage::DocumentFiles, Result};
+
+/// Number of directory levels between a sharded collection directory and its document files
+pub(crate) const SHARD_LEVELS: usize = 2;
+
+/// Number of hex digits naming each shard directory
+const SHARD_DIGITS: usize = 2;
+
+/// Placement of the document files of a collection.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, Serialize, Deserialize)]
+#[serde(rename_all = "lowercase")]
+pub enum DocumentLayout {
+    /// Every file directly in the collection directory.
+    #[default]
+    Flat,
+    /// Files spread over `ab/cd/` subdirectories by the hash of their ID.
+    Sharded,
+}
+
+impl std::str::FromStr for DocumentLayout {
+    type Err = String;
+
+    fn from_str(s: &str) -> std::result::Result<Self, Self::Err> {
+        match s.to_lowercase().as_str() {
+            "flat" => Ok(Self::Flat),
+            "sharded" => Ok(Self::Sharded),
+            _ => Err(format!("Invalid document layout: {}", s)),
+        }
+    }
+}
+
+impl std::fmt::Display for DocumentLayout {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match *self {
+            Self::Flat => write!(f, "flat"),
+            Self::Sharded => write!(f, "sharded"),
+        }
+    }
+}
+
+impl DocumentLayout {
+    /// Returns the path of the file of document `id` in the collection at `collection_path`.
+    pub fn document_path(self, collection_path: &Path, id: &str) -> PathBuf {
+        let file_name = format!("{}.{}", id, DOCUMENT_EXTENSION);
+        match self {
+            Self::Flat => collection_path.join(file_name),
+            Self::Sharded => {
+                let hash = Blake3Hasher::hash_bytes(id.as_bytes());
+                collection_path
+                    .join(hash.get(.. SHARD_DIGITS).unwrap_or_default())
+                    .join(
+                        hash.get(SHARD_DIGITS .. SHARD_DIGITS.saturating_mul(2))
+                            .unwrap_or_default(),
+                    )
+                    .join(file_name)
+            },
+        }
+    }
+
+    /// Whether document files live in subdirectories of the collection directory.
+    pub const fn is_nested(self) -> bool { matches!(self, Self::Sharded) }
+}
+
+/// Whether `name` is the name of a shard directory.
+pub(crate) fn is_shard_dir_name(name: &str) -> bool {
+    name.len() == SHARD_DIGITS &&
+        name.bytes()
+            .all(|b| b.is_ascii_digit() || (b'a' ..= b'f').contains(&b))
+}
+
+/// Layout of a collection, together with the layout it is migrating from.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub(crate) struct LayoutState {
+    /// Layout new files are written in.
+    pub current:  DocumentLayout,
+    /// Layout files are still being moved out of, while a migration is in progress.
+    pub previous: Option<DocumentLayout>,
+}
+
+/// Finds the document files of one collection.
+///
+/// Lookups cost nothing beyond building the path, except during a layout migration, when a file
+/// missing under the current layout is looked for under the previous one.
+#[derive(Debug, Clone)]
+pub(crate) struct DocumentLocator {
+    /// The collection directory.
+    root:  Arc<Path>,
+    /// The layout of the collection.
+    state: LayoutState,
+    /// The document files, through which lookups check for files.
+    files: DocumentFiles,
+}
+
+impl DocumentLocator {
+    /// Creates a locator for the collection at `root`, whose files are accessed through `files`.
+    pub(crate) const fn new(root: Arc<Path>, state: LayoutState, files: DocumentFiles) -> Self {
+        Self {
+            root,
+            state,
+            files,
+        }
+    }
+
+    /// Returns the path the file of document `id` is written to.
+    pub(crate) fn path(&self, id: &str) -> PathBuf { self.state.current.document_path(&self.root, id) }
+
+    /// Returns the path of document `id` under the layout being migrated from, if any.
+    pub(crate) fn previous_path(&self, id: &str) -> Option<PathBuf> {
+        self.state
+            .previous
+            .filter(|&previous| previous != self.state.current)
+            .map(|previous| previous.document_path(&self.root, id))
+    }
+
+    /// Returns the path where the file of document `id` currently is, or the path it would be
+    /// written to if it does not exist.
+    pub(crate) async fn resolve(&self, id: &str) -> PathBuf {
+        let path = self.path(id);
+        let Some(previous) = self.previous_path(id)
+        else {
+            return path;
+        };
+        if self.files.exists(&path).await {
+            return path;
+        }
+        if self.files.exists(&previous).await {
+            return previous;
+        }
+        // The migration may have moved the file between the two checks, and it only ever moves
+        // files towards the current layout
+        path
+    }
+
+    /// Moves the file of document `id` from the layout being migrated from to the current one,
+    /// see [`DocumentFiles::move_file`].
+    ///
+    /// Returns whether a file was moved.
+    ///
+    /// # Errors
+    ///
+    /// * `SentinelError::Io` - If the shard directories cannot be created or the file moved
+    pub(crate) async fn migrate(&self, id: &str) -> Result<bool> {
+        let Some(source) = self.previous_path(id)
+        else {
+            return Ok(false);
+        };
+        self.files
+            .move_file(&source, &self.path(id), self.nests_files())
+            .await
+    }
+
+    /// Returns whether document files are nested in shard directories, which writes must create.
+    pub(crate) const fn nests_files(&self) -> bool { self.state.current.is_nested() }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_sharded_paths_use_the_id_hash() {
+        let root = Path::new("/data/users");
+        assert_eq!(
+            DocumentLayout::Flat.document_path(root, "user-1"),
+            Path::new("/data/users/user-1.json")
+        );
+
+        let path = DocumentLayout::Sharded.document_path(root, "user-1");
+        let hash = Blake3Hasher::hash_bytes(b"user-1");
+        assert_eq!(
+            path,
+            root.join(&hash[.. 2])
+                .join(&hash[2 .. 4])
+                .join("user-1.json")
+        );
+        assert!(is_shard_dir_name(&hash[.. 2]));
+        assert!(!is_shard_dir_name(".deleted"));
+        assert!(!is_shard_dir_name("AB"));
+    }
+
+    #[test]
+    fn test_layout_parse_and_display() {
+        for layout in [DocumentLayout::Flat, DocumentLayout::Sharded] {
+            assert_eq!(
+                layout.to_string().parse::<DocumentLayout>().unwrap(),
+                layout
+            );
+        }
+        assert!("nested".parse::<DocumentLayout>().is_err());
+    }
+
+    #[tokio::test]
+    async fn test_locator_falls_back_to_previous_layout() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let root: Arc<Path> = Arc::from(temp_dir.path());
+        let locator = DocumentLocator::new(
+            root.clone(),
+            LayoutState {
+                current:  DocumentLayout::Sharded,
+                previous: Some(DocumentLayout::Flat),
+            },
+            DocumentFiles::new(Arc::new(crate::BlockingBackend), None),
+        );
+        let flat = root.join("doc.json");
+        assert_eq!(locator.previous_path("doc"), Some(flat.clone()));
+        assert_eq!(locator.resolve("doc").await, locator.path("doc"));
+        assert!(!locator.migrate("doc").await.unwrap());
+
+        tokio::fs::write(&flat, "{}").await.unwrap();
+        assert_eq!(locator.resolve("doc").await, flat);
+
+        assert!(locator.nests_files());
+        assert!(locator.migrate("doc").await.unwrap());
+        assert!(!flat.exists());
+        assert_eq!(locator.resolve("doc").await, locator.path("doc"));
+        assert!(locator.path("doc").exists());
+    }
+}
@@ -1,3 +1,7 @@
+/// Aggregation pipeline module.
+mod aggregation;
+/// Document cache module.
+mod cache;
 /// Collection management module.
 mod collection;
 /// Comparison utilities module.
@@ -6,18 +10,38 @@ mod comparison;
 mod constants;
 /// Document handling module.
 mod document;
+/// Document file encoding module.
+mod encoding;
+/// Encryption at rest module.
+mod encryption;
 /// Error types module.
 mod error;
 /// Event system module.
 mod events;
 /// Filtering utilities module.
 mod filtering;
+/// Secondary index module.
+mod index;
+/// Document file layout module.
+mod layout;
+/// Document lock striping module.
+mod locks;
+/// Document manifest module.
+mod manifest;
 /// Metadata management module.
 mod metadata;
+/// Operation and WAL metrics module.
+mod metrics;
 /// Projection utilities module.
 mod projection;
 /// Query building module.
 mod query;
+/// Approximate aggregation summaries module.
+mod sketches;
+/// Memory-bounded sorting module.
+mod sorting;
+/// Storage I/O backend module.
+mod storage;
 /// Store management module.
 mod store;
 /// Streaming utilities module.
@@ -33,11 +57,24 @@ pub mod wal;
 pub use async_stream;
 pub use futures;
 // Re-export internal modules
+pub use aggregation::AggregationPipeline;
+pub use cache::CacheStats;
 pub use collection::Collection;
 pub use constants::*;
 pub use document::Document;
+pub use encoding::{
+    decode_document,
+    detect_encoding,
+    encode_document,
+    DocumentEncoding,
+    LazyDocument,
+    CBOR_DOCUMENT_MAGIC,
+};
+pub use filtering::{DocumentFields, FilterPlan};
+pub use index::{IndexDefinition, IndexKind};
+pub use layout::DocumentLayout;
 pub use error::{Result, SentinelError};
-pub use query::{Aggregation, Filter, Operator, Query, QueryBuilder, QueryResult, SortOrder};
+pub use query::{Aggregation, Filter, Operator, Query, QueryBuilder, QueryCursor, QueryResult, SortOrder};
 pub use sentinel_crypto::{
     crypto_config::*,
     derive_key_from_passphrase,
@@ -52,9 +89,13 @@ pub use sentinel_crypto::{
     SigningKeyManager,
     VerifyingKey,
 };
+pub use storage::{BlockingBackend, StorageBackend, TokioBackend};
 pub use store::Store;
-pub use verification::{VerificationMode, VerificationOptions};
+pub use streaming::ScanOptions;
+pub use verification::{VerificationContext, VerificationMode, VerificationOptions};
 pub use metadata::{CollectionMetadata, MetadataVersion, StoreMetadata};
+pub use metrics::{MetricsSnapshot, OperationLatencies};
+pub use wal::changes::{Change, ChangeBatch, ChangeCursor, ChangeFeedOptions};
 pub use sentinel_wal::{
     recover_from_wal_force,
     recover_from_wal_safe,
@@ -63,16 +104,27 @@ pub use sentinel_wal::{
     CollectionWalConfigOverrides,
     CompressionAlgorithm,
     EntryType,
+    GroupCommitConfig,
+    HistogramSnapshot,
     LogEntry,
+    LogEntryRef,
+    SegmentEntries,
     StoreWalConfig,
+    WalChange,
+    WalChangeBatch,
     WalConfig,
     WalDocumentOps,
+    WalDurability,
     WalError,
     WalFailureMode,
     WalFormat,
     WalManager,
+    WalMetricsSnapshot,
     WalRecoveryFailure,
     WalRecoveryResult,
+    WalRetention,
+    WalSegment,
+    WalSegments,
     WalVerificationIssue,
     WalVerificationResult,
 };
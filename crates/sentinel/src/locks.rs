@@ -0,0 +1,166 @@
+//! Striped locks serializing the writers of each document.
+//!
+//! Updating a document reads, merges and rewrites its file, so two writers of the same document
+//! running at once can lose one of the writes. Every collection holds a fixed table of
+//! [`DOCUMENT_LOCK_STRIPES`] asynchronous mutexes, and each write locks the stripe its document
+//! ID hashes to for the whole read-modify-write. Writers of different documents almost always
+//! take different stripes and proceed in parallel, and the table does not grow with the number
+//! of documents. Documents sharing a stripe are serialized as well, which only costs
+//! parallelism.
+//!
+//! Readers never take the locks. A WAL checkpoint takes all of them at once, to wait for the
+//! writes whose entries it covers to reach their files.
+
+use std::hash::{BuildHasher as _, RandomState};
+
+use tokio::sync::{Mutex, MutexGuard};
+
+use crate::constants::DOCUMENT_LOCK_STRIPES;
+
+/// Table of striped locks serializing the writers of each document of a collection.
+#[derive(Debug)]
+pub struct DocumentLocks {
+    /// The lock stripes, a power of two of them.
+    stripes: Vec<Mutex<()>>,
+    /// Hasher mapping document IDs to stripes, seeded per table.
+    hasher:  RandomState,
+}
+
+impl Default for DocumentLocks {
+    fn default() -> Self { Self::with_stripes(DOCUMENT_LOCK_STRIPES) }
+}
+
+impl DocumentLocks {
+    /// Creates a table of at least `count` stripes, rounded up to a power of two.
+    pub fn with_stripes(count: usize) -> Self {
+        Self {
+            stripes: std::iter::repeat_with(|| Mutex::new(()))
+                .take(count.max(1).next_power_of_two())
+                .collect(),
+            hasher:  RandomState::new(),
+        }
+    }
+
+    /// Returns the index of the stripe guarding the document `id`.
+    fn stripe_of(&self, id: &str) -> usize {
+        let mask = self.stripes.len().saturating_sub(1);
+        (self.hasher.hash_one(id) as usize) & mask
+    }
+
+    /// Waits for the lock of the document `id`, held until the returned guard is dropped.
+    #[allow(
+        clippy::indexing_slicing,
+        reason = "the index is masked to the number of stripes"
+    )]
+    pub async fn lock(&self, id: &str) -> MutexGuard<'_, ()> { self.stripes[self.stripe_of(id)].lock().await }
+
+    /// Waits for the locks of all the documents `ids`, held until the returned guards are dropped.
+    ///
+    /// Each stripe is taken once, in index order, so batches locking overlapping sets of stripes
+    /// cannot deadlock with each other or with writers of a single document.
+    #[allow(
+        clippy::indexing_slicing,
+        reason = "the indexes are masked to the number of stripes"
+    )]
+    pub async fn lock_many<'a, I>(&self, ids: I) -> Vec<MutexGuard<'_, ()>>
+    where
+        I: IntoIterator<Item = &'a str>,
+    {
+        let mut stripes: Vec<usize> = ids.into_iter().map(|id| self.stripe_of(id)).collect();
+        stripes.sort_unstable();
+        stripes.dedup();
+
+        let mut guards = Vec::with_capacity(stripes.len());
+        for stripe in stripes {
+            guards.push(self.stripes[stripe].lock().await);
+        }
+        guards
+    }
+
+    /// Waits for every stripe, held until the returned guards are dropped, so that no document
+    /// write is in progress meanwhile.
+    pub async fn lock_all(&self) -> Vec<MutexGuard<'_, ()>> {
+        let mut guards = Vec::with_capacity(self.stripes.len());
+        for stripe in &self.stripes {
+            guards.push(stripe.lock().await);
+        }
+        guards
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::{sync::Arc, time::Duration};
+
+    use super::*;
+
+    #[test]
+    fn test_stripes_are_a_power_of_two() {
+        assert_eq!(DocumentLocks::with_stripes(0).stripes.len(), 1);
+        assert_eq!(DocumentLocks::with_stripes(100).stripes.len(), 128);
+        assert_eq!(
+            DocumentLocks::default().stripes.len(),
+            DOCUMENT_LOCK_STRIPES
+        );
+
+        let locks = DocumentLocks::with_stripes(16);
+        for i in 0 .. 100 {
+            let id = format!("doc-{}", i);
+            assert!(locks.stripe_of(&id) < 16);
+            assert_eq!(locks.stripe_of(&id), locks.stripe_of(&id));
+        }
+    }
+
+    #[tokio::test]
+    async fn test_lock_serializes_one_document() {
+        let locks = Arc::new(DocumentLocks::with_stripes(1));
+        let guard = locks.lock("a").await;
+
+        // With a single stripe, every document waits for the held lock
+        let waiter = {
+            let locks = locks.clone();
+            tokio::spawn(async move { drop(locks.lock("b").await) })
+        };
+        tokio::time::sleep(Duration::from_millis(20)).await;
+        assert!(!waiter.is_finished());
+
+        drop(guard);
+        waiter.await.unwrap();
+    }
+
+    #[tokio::test]
+    async fn test_lock_many_takes_each_stripe_once() {
+        let locks = Arc::new(DocumentLocks::with_stripes(4));
+        let ids: Vec<String> = (0 .. 64).map(|i| format!("doc-{}", i)).collect();
+
+        // Every stripe is covered, and documents sharing a stripe do not deadlock the batch
+        let guards = locks.lock_many(ids.iter().map(String::as_str)).await;
+        assert_eq!(guards.len(), 4);
+
+        let waiter = {
+            let locks = locks.clone();
+            tokio::spawn(async move { drop(locks.lock("doc-0").await) })
+        };
+        tokio::time::sleep(Duration::from_millis(20)).await;
+        assert!(!waiter.is_finished());
+
+        drop(guards);
+        waiter.await.unwrap();
+    }
+
+    #[tokio::test]
+    async fn test_lock_all_waits_for_writers() {
+        let locks = Arc::new(DocumentLocks::with_stripes(8));
+        let guard = locks.lock("a").await;
+
+        let waiter = {
+            let locks = locks.clone();
+            tokio::spawn(async move { locks.lock_all().await.len() })
+        };
+        tokio::time::sleep(Duration::from_millis(20)).await;
+        assert!(!waiter.is_finished());
+
+        drop(guard);
+        assert_eq!(waiter.await.unwrap(), 8);
+    }
+}
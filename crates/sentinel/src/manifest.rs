@@ -0,0 +1,889 @@
+//! Persistent manifest of the documents stored in a collection.
+//!
+//! Listing a collection used to mean reading its directory and stating every entry. The
+//! manifest keeps the ID, size and hash of every document in `.manifest.jsonl` instead, as an
+//! append-only log of JSON records maintained by the write paths:
+//!
+//! ```text
+//! {"op":"put","id":"user-1","size":182,"hash":"9f2c...","stamp":{...}}
+//! {"op":"remove","id":"user-1","stamp":{...}}
+//! {"op":"sync","stamp":{...}}
+//! ```
+//!
+//! Each record carries the modification time of the collection directory observed right after
+//! the change it describes. Scans trust the manifest as long as the directory still has that
+//! modification time, so files added or removed outside of Sentinel are noticed with a single
+//! stat. Changes this process recorded itself are trusted as soon as they are recorded; the
+//! modification time only serves to detect changes made by others. Otherwise the directory is
+//! rescanned using the file types returned by the directory listing, and the manifest is
+//! rewritten if the rescan found a difference. The manifest is only a cache of the directory
+//! contents: whenever it cannot be trusted, falling back to a rescan is always correct.
+//!
+//! In a sharded collection the files live in shard subdirectories, whose changes do not show in
+//! the modification time of the collection directory. The manifest of such a collection is
+//! trusted as long as it is intact, so files changed there outside of Sentinel are only noticed
+//! after [`DocumentManifest::rebuild`].
+
+use std::{
+    collections::BTreeMap,
+    ops::Bound,
+    path::{Path, PathBuf},
+    sync::{
+        atomic::{AtomicBool, AtomicUsize, Ordering},
+        Arc,
+        Mutex,
+    },
+    time::{Duration, SystemTime},
+};
+
+use futures::TryStreamExt as _;
+use serde::{Deserialize, Serialize};
+use tracing::{debug, trace, warn};
+
+use crate::{
+    constants::COLLECTION_MANIFEST_FILE,
+    storage::StorageBackend,
+    streaming::stream_document_ids,
+    Result,
+    SentinelError,
+};
+
+/// Minimum age of a directory modification time before the manifest trusts it.
+///
+/// Filesystems record modification times with a limited resolution, so a change made shortly
+/// after the manifest observed the directory may leave the modification time unchanged. Stamps
+/// loaded from the manifest file or taken by a rescan within this window of the modification
+/// time are treated as unreliable.
+const MANIFEST_RACY_WINDOW: Duration = Duration::from_secs(1);
+
+/// Number of superfluous records tolerated in the manifest file before it is compacted on load.
+const MANIFEST_COMPACTION_SLACK: usize = 1024;
+
+/// Size and hash of a document recorded in the manifest.
+#[derive(Debug, Clone, Default, PartialEq, Eq, Serialize, Deserialize)]
+pub struct ManifestEntry {
+    /// Size of the document file in bytes, unknown for documents discovered by a rescan.
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub size: Option<u64>,
+    /// Hash of the document data, unknown for documents discovered by a rescan.
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub hash: Option<String>,
+}
+
+/// Modification time of the collection directory and when it was observed.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
+struct DirStamp {
+    /// Modification time of the collection directory.
+    modified: SystemTime,
+    /// When the modification time was read.
+    observed: SystemTime,
+}
+
+impl DirStamp {
+    /// Reads the current modification time of the collection directory through `backend`.
+    async fn observe(backend: &dyn StorageBackend, collection_path: &Path) -> Result<Self> {
+        let metadata = backend.metadata(collection_path).await?.ok_or_else(|| {
+            SentinelError::Io {
+                source: std::io::Error::new(
+                    std::io::ErrorKind::NotFound,
+                    format!("collection directory {:?} not found", collection_path),
+                ),
+            }
+        })?;
+        let modified = metadata.modified()?;
+        Ok(Self {
+            modified,
+            observed: SystemTime::now(),
+        })
+    }
+
+    /// Whether the stamp proves that a directory with modification time `current` is unchanged.
+    ///
+    /// A stamp this process `recorded` right after its own change vouches for that change, so it
+    /// is trusted as long as the modification time did not move. Other stamps are only trusted
+    /// once the modification time was older than [`MANIFEST_RACY_WINDOW`] when they were taken.
+    fn proves(&self, current: SystemTime, recorded: bool) -> bool {
+        current == self.modified &&
+            (recorded ||
+                self.modified
+                    .checked_add(MANIFEST_RACY_WINDOW)
+                    .is_some_and(|settled| self.observed >= settled))
+    }
+}
+
+/// A single record of the manifest file.
+#[derive(Debug, Clone, PartialEq, Eq, Serialize, Deserialize)]
+#[serde(tag = "op", rename_all = "lowercase")]
+enum ManifestRecord {
+    /// A document was written.
+    Put {
+        /// The document ID.
+        id:    String,
+        /// The recorded size and hash.
+        #[serde(flatten)]
+        entry: ManifestEntry,
+        /// The directory stamp observed after the write.
+        stamp: Option<DirStamp>,
+    },
+    /// A document was removed.
+    Remove {
+        /// The document ID.
+        id:    String,
+        /// The directory stamp observed after the removal.
+        stamp: Option<DirStamp>,
+    },
+    /// The manifest was checked against the directory.
+    Sync {
+        /// The directory stamp observed before the check.
+        stamp: Option<DirStamp>,
+    },
+}
+
+impl ManifestRecord {
+    /// Returns the directory stamp carried by the record.
+    const fn stamp(&self) -> Option<DirStamp> {
+        match *self {
+            Self::Put {
+                stamp,
+                ..
+            } |
+            Self::Remove {
+                stamp,
+                ..
+            } |
+            Self::Sync {
+                stamp,
+            } => stamp,
+        }
+    }
+
+    /// Replaces the directory stamp carried by the record.
+    const fn set_stamp(&mut self, new_stamp: Option<DirStamp>) {
+        match *self {
+            Self::Put {
+                ref mut stamp,
+                ..
+            } |
+            Self::Remove {
+                ref mut stamp,
+                ..
+            } |
+            Self::Sync {
+                ref mut stamp,
+            } => *stamp = new_stamp,
+        }
+    }
+}
+
+/// In-memory state of the manifest.
+#[derive(Debug, Default)]
+struct ManifestState {
+    /// The documents of the collection, ordered by ID.
+    entries:  BTreeMap<String, ManifestEntry>,
+    /// The stamp the entries were last checked against, `None` when they cannot be trusted.
+    stamp:    Option<DirStamp>,
+    /// Whether the stamp was observed by this process right after a change it recorded.
+    recorded: bool,
+    /// Whether the entries were checked against the directory and only changed by recorded
+    /// writes since, so the writes may vouch for them with their stamps.
+    verified: bool,
+    /// Whether replaying the manifest file yields the entries.
+    intact:   bool,
+    /// Number of records in the manifest file.
+    records:  usize,
+}
+
+impl ManifestState {
+    /// Applies a record to the entries.
+    fn apply(&mut self, record: &ManifestRecord) {
+        match *record {
+            ManifestRecord::Put {
+                ref id,
+                ref entry,
+                ..
+            } => {
+                self.entries.insert(id.clone(), entry.clone());
+            },
+            ManifestRecord::Remove {
+                ref id,
+                ..
+            } => {
+                self.entries.remove(id);
+            },
+            ManifestRecord::Sync {
+                ..
+            } => {},
+        }
+        self.stamp = record.stamp();
+        self.recorded = false;
+        self.records = self.records.saturating_add(1);
+    }
+
+    /// Serializes the entries followed by a sync record carrying `stamp`.
+    fn snapshot(&self, stamp: Option<DirStamp>) -> Result<String> {
+        let mut content = String::new();
+        for (id, entry) in &self.entries {
+            let record = ManifestRecord::Put {
+                id:    id.clone(),
+                entry: entry.clone(),
+                stamp: None,
+            };
+            content.push_str(&serde_json::to_string(&record)?);
+            content.push('\n');
+        }
+        content.push_str(&serde_json::to_string(&ManifestRecord::Sync {
+            stamp,
+        })?);
+        content.push('\n');
+        Ok(content)
+    }
+}
+
+/// Manifest of the documents stored in a collection directory.
+///
+/// Shared between a collection and its read views. Write paths bracket every change to a
+/// document file with [`DocumentManifest::begin_write`], scans read the document IDs through
+/// [`DocumentManifest::document_ids`].
+#[derive(Debug)]
+pub struct DocumentManifest {
+    /// The collection directory.
+    collection_path: PathBuf,
+    /// Backend performing the file I/O of the manifest and of the directory checks.
+    backend:         Arc<dyn StorageBackend>,
+    /// The manifest entries.
+    state:           Mutex<ManifestState>,
+    /// Serializes appends to and rewrites of the manifest file.
+    file:            tokio::sync::Mutex<()>,
+    /// Number of document writes currently in progress.
+    in_flight:       AtomicUsize,
+    /// Set when a write could not be recorded, forcing a rescan before the entries are trusted.
+    stale:           AtomicBool,
+    /// Whether document files live in subdirectories the directory stamp does not cover.
+    nested:          AtomicBool,
+}
+
+impl DocumentManifest {
+    /// Loads the manifest of a collection from its `.manifest.jsonl` file.
+    ///
+    /// A missing or damaged file is not an error: the manifest simply starts untrusted and the
+    /// first scan rebuilds it from the directory. The file is created if it does not exist yet,
+    /// so later appends never change the modification time of the collection directory. Every
+    /// file operation goes through `backend`.
+    pub async fn load(collection_path: &Path, backend: Arc<dyn StorageBackend>) -> Self {
+        let manifest_path = collection_path.join(COLLECTION_MANIFEST_FILE);
+        let mut state = ManifestState::default();
+        let content = match backend.read_document(&manifest_path, None).await {
+            Ok(Some((content, _))) => String::from_utf8(content).map_err(|e| e.to_string()),
+            Ok(None) => Err("not found".to_owned()),
+            Err(e) => Err(e.to_string()),
+        };
+        match content {
+            Ok(content) => {
+                state.intact = true;
+                for line in content.lines().filter(|line| !line.trim().is_empty()) {
+                    match serde_json::from_str::<ManifestRecord>(line) {
+                        Ok(record) => state.apply(&record),
+                        Err(e) => {
+                            // A torn record means the file cannot be trusted past this point
+                            warn!(
+                                "Failed to parse manifest record in {:?}: {}, rescanning collection",
+                                manifest_path, e
+                            );
+                            state.stamp = None;
+                            state.intact = false;
+                            break;
+                        },
+                    }
+                }
+                // A stamp on the last record means the manifest was checked by its writer
+                state.verified = state.stamp.is_some();
+            },
+            Err(e) => {
+                debug!(
+                    "Manifest file {:?} not readable ({}), rescanning collection",
+                    manifest_path, e
+                );
+            },
+        }
+
+        let manifest = Self {
+            collection_path: collection_path.to_path_buf(),
+            backend,
+            state: Mutex::new(state),
+            file: tokio::sync::Mutex::new(()),
+            in_flight: AtomicUsize::new(0),
+            stale: AtomicBool::new(false),
+            nested: AtomicBool::new(false),
+        };
+
+        let needs_compaction = {
+            let state = manifest.state.lock().unwrap();
+            state.records >
+                state
+                    .entries
+                    .len()
+                    .saturating_mul(2)
+                    .saturating_add(MANIFEST_COMPACTION_SLACK)
+        };
+        let prepared = if needs_compaction {
+            manifest.compact().await
+        }
+        else {
+            manifest.ensure_file().await
+        };
+        if let Err(e) = prepared {
+            warn!("Failed to prepare manifest file {:?}: {}", manifest_path, e);
+            manifest.stale.store(true, Ordering::Relaxed);
+        }
+        manifest
+    }
+
+    /// Returns the IDs of all documents in the collection, in ID order.
+    ///
+    /// The recorded entries are returned if the collection directory has not been modified
+    /// since they were last checked, otherwise the directory is rescanned first.
+    pub async fn document_ids(&self) -> Result<Vec<String>> { self.document_ids_after(None).await }
+
+    /// Returns the IDs of the documents whose ID sorts after `after`, in ID order.
+    ///
+    /// Only the entries following `after` are copied out of a trusted manifest, so resuming a
+    /// listing does not cost the IDs listed before.
+    pub async fn document_ids_after(&self, after: Option<&str>) -> Result<Vec<String>> {
+        if let Some(ids) = self.trusted_ids(after).await {
+            trace!(
+                "Listing {} documents of {:?} from the manifest",
+                ids.len(),
+                self.collection_path
+            );
+            return Ok(ids);
+        }
+        let mut ids = self.rescan().await?;
+        if let Some(after) = after {
+            let start = ids.partition_point(|id| id.as_str() <= after);
+            ids = ids.split_off(start);
+        }
+        Ok(ids)
+    }
+
+    /// Marks the start of a change to a document file.
+    ///
+    /// The returned guard must be completed with [`ManifestWrite::put`] or
+    /// [`ManifestWrite::remove`] once the file has been written; dropping it instead marks the
+    /// manifest stale. Stamps are only recorded when no other write is in progress, so a writer
+    /// never vouches for a file another writer has created but not yet recorded.
+    pub fn begin_write(&self) -> ManifestWrite<'_> {
+        self.in_flight.fetch_add(1, Ordering::AcqRel);
+        ManifestWrite {
+            manifest:  self,
+            completed: false,
+        }
+    }
+
+    /// Sets whether document files live in subdirectories of the collection directory, which
+    /// the directory stamp cannot vouch for.
+    pub fn set_nested(&self, nested: bool) { self.nested.store(nested, Ordering::Relaxed); }
+
+    /// Marks the entries as untrusted so the next scan rescans the collection directory.
+    pub fn mark_stale(&self) { self.stale.store(true, Ordering::Relaxed); }
+
+    /// Forces a rescan of the collection directory and rewrites the manifest.
+    pub async fn rebuild(&self) -> Result<()> {
+        self.mark_stale();
+        self.rescan().await.map(|_| ())
+    }
+
+    /// Returns the recorded IDs sorting after `after` if the directory provably did not change
+    /// since they were checked.
+    async fn trusted_ids(&self, after: Option<&str>) -> Option<Vec<String>> {
+        if self.stale.load(Ordering::Relaxed) {
+            return None;
+        }
+        let (stamp, recorded) = {
+            let state = self.state.lock().unwrap();
+            (state.stamp?, state.recorded)
+        };
+        if !self.nested.load(Ordering::Relaxed) {
+            let current = self
+                .backend
+                .metadata(&self.collection_path)
+                .await
+                .ok()??
+                .modified()
+                .ok()?;
+            if !stamp.proves(current, recorded) {
+                return None;
+            }
+        }
+        let lower = after.map_or(Bound::Unbounded, Bound::Excluded);
+        Some(
+            self.state
+                .lock()
+                .unwrap()
+                .entries
+                .range::<str, _>((lower, Bound::Unbounded))
+                .map(|(id, _)| id.clone())
+                .collect(),
+        )
+    }
+
+    /// Lists the collection directory and replaces the entries with its contents.
+    ///
+    /// Sizes and hashes of documents that were already recorded are kept. The manifest file is
+    /// only rewritten if the listing differs from the entries or the file does not hold them.
+    async fn rescan(&self) -> Result<Vec<String>> {
+        let _file = self.file.lock().await;
+        self.ensure_file().await?;
+
+        debug!("Rescanning collection directory {:?}", self.collection_path);
+        self.stale.store(false, Ordering::Relaxed);
+        let observed = DirStamp::observe(&*self.backend, &self.collection_path).await?;
+        let mut ids: Vec<String> = stream_document_ids(self.collection_path.clone())
+            .try_collect()
+            .await?;
+        ids.sort_unstable();
+
+        // Another writer may have created a file that is listed but not recorded yet
+        let stamp = (self.in_flight.load(Ordering::Acquire) == 0).then_some(observed);
+        let content = {
+            let mut state = self.state.lock().unwrap();
+            state.stamp = stamp;
+            state.recorded = false;
+            state.verified = true;
+            if state.intact && state.entries.keys().eq(ids.iter()) {
+                None
+            }
+            else {
+                let mut previous = std::mem::take(&mut state.entries);
+                state.entries = ids
+                    .iter()
+                    .map(|id| {
+                        let entry = previous.remove(id).unwrap_or_default();
+                        (id.clone(), entry)
+                    })
+                    .collect();
+                state.records = state.entries.len().saturating_add(1);
+                Some(state.snapshot(stamp)?)
+            }
+        };
+
+        // Rewriting the existing file in place leaves the directory modification time untouched
+        if let Some(content) = content {
+            let rewritten = self.rewrite(content).await;
+            self.state.lock().unwrap().intact = rewritten.is_ok();
+            if let Err(e) = rewritten {
+                warn!(
+                    "Failed to rewrite manifest of {:?}: {}",
+                    self.collection_path, e
+                );
+                self.stale.store(true, Ordering::Relaxed);
+            }
+        }
+        else {
+            trace!(
+                "Rescan of {:?} matched the manifest, keeping the file",
+                self.collection_path
+            );
+        }
+
+        Ok(ids)
+    }
+
+    /// Rewrites the existing manifest file with one record per entry.
+    async fn compact(&self) -> Result<()> {
+        let _file = self.file.lock().await;
+        let content = {
+            let mut state = self.state.lock().unwrap();
+            state.records = state.entries.len().saturating_add(1);
+            let stamp = state.stamp;
+            state.snapshot(stamp)?
+        };
+        let rewritten = self.rewrite(content).await;
+        self.state.lock().unwrap().intact = rewritten.is_ok();
+        rewritten?;
+        trace!("Manifest of {:?} compacted", self.collection_path);
+        Ok(())
+    }
+
+    /// Creates an empty manifest file if none exists yet.
+    ///
+    /// Creating the file modifies the collection directory, so the entries are no longer
+    /// trusted afterwards, and the new empty file no longer holds them.
+    async fn ensure_file(&self) -> Result<()> {
+        if !self.backend.exists(&self.manifest_path()).await {
+            self.backend
+                .append(&self.manifest_path(), Vec::new(), true)
+                .await?;
+            let mut state = self.state.lock().unwrap();
+            state.stamp = None;
+            state.verified = false;
+            state.intact = state.entries.is_empty();
+        }
+        Ok(())
+    }
+
+    /// Replaces the contents of the existing manifest file.
+    async fn rewrite(&self, content: String) -> Result<()> {
+        self.backend
+            .write_document(&self.manifest_path(), content.into_bytes(), None, false)
+            .await
+            .map(|_| ())
+    }
+
+    /// Appends records to the manifest file, applying them to the entries first.
+    ///
+    /// The directory stamp is observed once for the whole batch and attached to the last
+    /// record, or omitted while other writes are still in progress or the entries were not
+    /// checked against the directory. A recorded stamp vouches for the entries right away, see
+    /// [`DirStamp::proves`].
+    async fn record(&self, mut records: Vec<ManifestRecord>) {
+        let _file = self.file.lock().await;
+        let remaining = self
+            .in_flight
+            .fetch_sub(1, Ordering::AcqRel)
+            .saturating_sub(1);
+
+        let verified = self.state.lock().unwrap().verified;
+        let stamp = if remaining == 0 && verified && !self.stale.load(Ordering::Relaxed) {
+            match DirStamp::observe(&*self.backend, &self.collection_path).await {
+                Ok(stamp) => Some(stamp),
+                Err(e) => {
+                    warn!(
+                        "Failed to read modification time of {:?}: {}",
+                        self.collection_path, e
+                    );
+                    None
+                },
+            }
+        }
+        else {
+            None
+        };
+        if let Some(last) = records.last_mut() {
+            last.set_stamp(stamp);
+        }
+
+        let mut content = String::new();
+        {
+            let mut state = self.state.lock().unwrap();
+            for record in &records {
+                state.apply(record);
+                match serde_json::to_string(record) {
+                    Ok(line) => {
+                        content.push_str(&line);
+                        content.push('\n');
+                    },
+                    Err(e) => {
+                        warn!("Failed to serialize manifest record: {}", e);
+                        self.stale.store(true, Ordering::Relaxed);
+                        state.intact = false;
+                    },
+                }
+            }
+            state.recorded = stamp.is_some();
+        }
+
+        if let Err(e) = self
+            .backend
+            .append(&self.manifest_path(), content.into_bytes(), false)
+            .await
+        {
+            warn!(
+                "Failed to append to manifest of {:?}: {}",
+                self.collection_path, e
+            );
+            self.stale.store(true, Ordering::Relaxed);
+            self.state.lock().unwrap().intact = false;
+        }
+    }
+
+    /// Returns the path of the manifest file.
+    fn manifest_path(&self) -> PathBuf { self.collection_path.join(COLLECTION_MANIFEST_FILE) }
+}
+
+/// A change to document files in progress, recorded in the manifest once completed.
+#[derive(Debug)]
+pub struct ManifestWrite<'manifest> {
+    /// The manifest the change is recorded in.
+    manifest:  &'manifest DocumentManifest,
+    /// Whether the change was recorded.
+    completed: bool,
+}
+
+impl ManifestWrite<'_> {
+    /// Records that a document file was written.
+    pub async fn put(self, id: &str, size: u64, hash: &str) {
+        self.put_many(vec![(id.to_owned(), size, hash.to_owned())])
+            .await;
+    }
+
+    /// Records that several document files were written.
+    pub async fn put_many(mut self, documents: Vec<(String, u64, String)>) {
+        self.completed = true;
+        let mut records: Vec<_> = documents
+            .into_iter()
+            .map(|(id, size, hash)| {
+                ManifestRecord::Put {
+                    id,
+                    entry: ManifestEntry {
+                        size: Some(size),
+                        hash: Some(hash),
+                    },
+                    stamp: None,
+                }
+            })
+            .collect();
+        if records.is_empty() {
+            records.push(ManifestRecord::Sync {
+                stamp: None,
+            });
+        }
+        self.manifest.record(records).await;
+    }
+
+    /// Records that a document file was removed.
+    pub async fn remove(mut self, id: &str) {
+        self.completed = true;
+        self.manifest
+            .record(vec![ManifestRecord::Remove {
+                id:    id.to_owned(),
+                stamp: None,
+            }])
+            .await;
+    }
+}
+
+impl Drop for ManifestWrite<'_> {
+    fn drop(&mut self) {
+        if !self.completed {
+            // The file may or may not have been changed, so the entries can no longer be trusted
+            self.manifest.stale.store(true, Ordering::Relaxed);
+            self.manifest.in_flight.fetch_sub(1, Ordering::AcqRel);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use tokio::fs as tokio_fs;
+
+    use super::*;
+
+    /// Loads the manifest of `collection_path` through the default backend.
+    async fn load(collection_path: &Path) -> DocumentManifest {
+        DocumentManifest::load(collection_path, Arc::new(crate::BlockingBackend)).await
+    }
+
+    /// Moves the recorded stamp out of the racy window so the manifest is trusted.
+    fn settle(manifest: &DocumentManifest) {
+        let mut state = manifest.state.lock().unwrap();
+        if let Some(ref mut stamp) = state.stamp {
+            stamp.observed = stamp.modified.checked_add(MANIFEST_RACY_WINDOW).unwrap();
+        }
+    }
+
+    #[tokio::test]
+    async fn test_load_without_file_rescans() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        tokio_fs::write(temp_dir.path().join("a.json"), "{}")
+            .await
+            .unwrap();
+
+        let manifest = load(temp_dir.path()).await;
+        assert!(temp_dir.path().join(COLLECTION_MANIFEST_FILE).exists());
+        assert!(manifest.trusted_ids(None).await.is_none());
+        assert_eq!(manifest.document_ids().await.unwrap(), vec!["a"]);
+    }
+
+    #[tokio::test]
+    async fn test_document_ids_after() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        for id in ["a", "b", "c"] {
+            tokio_fs::write(temp_dir.path().join(format!("{}.json", id)), "{}")
+                .await
+                .unwrap();
+        }
+
+        // Both a rescan and a trusted manifest resume after the given ID
+        let manifest = load(temp_dir.path()).await;
+        manifest.mark_stale();
+        assert_eq!(
+            manifest.document_ids_after(Some("a")).await.unwrap(),
+            vec!["b", "c"]
+        );
+        settle(&manifest);
+        assert_eq!(
+            manifest.trusted_ids(Some("b")).await,
+            Some(vec!["c".to_owned()])
+        );
+        assert_eq!(
+            manifest.document_ids_after(Some("ab")).await.unwrap(),
+            vec!["b", "c"]
+        );
+        assert!(manifest
+            .document_ids_after(Some("c"))
+            .await
+            .unwrap()
+            .is_empty());
+    }
+
+    #[tokio::test]
+    async fn test_writes_are_recorded_and_reloaded() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let manifest = load(temp_dir.path()).await;
+        manifest.document_ids().await.unwrap();
+
+        let write = manifest.begin_write();
+        tokio_fs::write(temp_dir.path().join("a.json"), "{}")
+            .await
+            .unwrap();
+        write.put("a", 2, "hash-a").await;
+        let write = manifest.begin_write();
+        tokio_fs::write(temp_dir.path().join("b.json"), "{}")
+            .await
+            .unwrap();
+        write.put("b", 2, "hash-b").await;
+        let write = manifest.begin_write();
+        tokio_fs::remove_file(temp_dir.path().join("a.json"))
+            .await
+            .unwrap();
+        write.remove("a").await;
+
+        settle(&manifest);
+        assert_eq!(manifest.trusted_ids(None).await, Some(vec!["b".to_owned()]));
+
+        let reloaded = load(temp_dir.path()).await;
+        {
+            let state = reloaded.state.lock().unwrap();
+            assert_eq!(
+                state.entries.get("b"),
+                Some(&ManifestEntry {
+                    size: Some(2),
+                    hash: Some("hash-b".to_owned()),
+                })
+            );
+            assert!(!state.entries.contains_key("a"));
+        }
+        assert_eq!(reloaded.document_ids().await.unwrap(), vec!["b"]);
+    }
+
+    #[tokio::test]
+    async fn test_external_change_triggers_rescan() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let manifest = load(temp_dir.path()).await;
+        manifest.document_ids().await.unwrap();
+        settle(&manifest);
+        assert_eq!(manifest.trusted_ids(None).await, Some(Vec::new()));
+
+        // Make sure the directory modification time moves past the recorded one
+        tokio::time::sleep(Duration::from_millis(20)).await;
+        tokio_fs::write(temp_dir.path().join("external.json"), "{}")
+            .await
+            .unwrap();
+        assert!(manifest.trusted_ids(None).await.is_none());
+        assert_eq!(manifest.document_ids().await.unwrap(), vec!["external"]);
+    }
+
+    #[tokio::test]
+    async fn test_own_writes_are_trusted_right_away() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let manifest = load(temp_dir.path()).await;
+        manifest.document_ids().await.unwrap();
+        settle(&manifest);
+
+        // No rescan is needed to list a document this process just wrote
+        let write = manifest.begin_write();
+        tokio_fs::write(temp_dir.path().join("a.json"), "{}")
+            .await
+            .unwrap();
+        write.put("a", 2, "hash-a").await;
+        assert_eq!(manifest.trusted_ids(None).await, Some(vec!["a".to_owned()]));
+
+        // Changes made by others still show in the modification time
+        tokio::time::sleep(Duration::from_millis(20)).await;
+        tokio_fs::write(temp_dir.path().join("external.json"), "{}")
+            .await
+            .unwrap();
+        assert!(manifest.trusted_ids(None).await.is_none());
+        assert_eq!(
+            manifest.document_ids().await.unwrap(),
+            vec!["a", "external"]
+        );
+    }
+
+    #[tokio::test]
+    async fn test_unchanged_rescan_keeps_the_file() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        tokio_fs::write(temp_dir.path().join("a.json"), "{}")
+            .await
+            .unwrap();
+        let manifest = load(temp_dir.path()).await;
+        assert_eq!(manifest.document_ids().await.unwrap(), vec!["a"]);
+        let manifest_path = temp_dir.path().join(COLLECTION_MANIFEST_FILE);
+        let written = tokio_fs::read_to_string(&manifest_path).await.unwrap();
+        assert!(written.contains("\"a\""));
+
+        manifest.mark_stale();
+        assert_eq!(manifest.document_ids().await.unwrap(), vec!["a"]);
+        assert_eq!(
+            tokio_fs::read_to_string(&manifest_path).await.unwrap(),
+            written
+        );
+
+        // A rescan that finds a difference rewrites the file
+        tokio_fs::write(temp_dir.path().join("b.json"), "{}")
+            .await
+            .unwrap();
+        manifest.mark_stale();
+        assert_eq!(manifest.document_ids().await.unwrap(), vec!["a", "b"]);
+        assert!(tokio_fs::read_to_string(&manifest_path)
+            .await
+            .unwrap()
+            .contains("\"b\""));
+    }
+
+    #[tokio::test]
+    async fn test_abandoned_write_marks_stale() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let manifest = load(temp_dir.path()).await;
+        manifest.document_ids().await.unwrap();
+        settle(&manifest);
+
+        drop(manifest.begin_write());
+        assert!(manifest.trusted_ids(None).await.is_none());
+        manifest.document_ids().await.unwrap();
+        settle(&manifest);
+        assert!(manifest.trusted_ids(None).await.is_some());
+    }
+
+    #[tokio::test]
+    async fn test_concurrent_writes_do_not_record_stamp() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let manifest = load(temp_dir.path()).await;
+        manifest.document_ids().await.unwrap();
+
+        let first = manifest.begin_write();
+        let second = manifest.begin_write();
+        first.put("a", 1, "hash-a").await;
+        assert!(manifest.state.lock().unwrap().stamp.is_none());
+        second.put("b", 1, "hash-b").await;
+        assert!(manifest.state.lock().unwrap().stamp.is_some());
+    }
+
+    #[tokio::test]
+    async fn test_torn_record_is_ignored() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        tokio_fs::write(temp_dir.path().join("a.json"), "{}")
+            .await
+            .unwrap();
+        tokio_fs::write(
+            temp_dir.path().join(COLLECTION_MANIFEST_FILE),
+            "{\"op\":\"put\",\"id\":\"a\"}\n{\"op\":\"pu",
+        )
+        .await
+        .unwrap();
+
+        let manifest = load(temp_dir.path()).await;
+        assert!(manifest.trusted_ids(None).await.is_none());
+        assert_eq!(manifest.document_ids().await.unwrap(), vec!["a"]);
+    }
+}
@@ -13,7 +13,7 @@
 use serde::{Deserialize, Serialize};
 use sentinel_wal::{CollectionWalConfig, StoreWalConfig};
 
-use crate::META_SENTINEL_VERSION;
+use crate::{DocumentEncoding, DocumentLayout, IndexDefinition, META_SENTINEL_VERSION};
 
 /// Version of the metadata format.
 ///
@@ -30,19 +30,34 @@ pub type MetadataVersion = u32;
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct CollectionMetadata {
     /// Metadata format version
-    pub version:          MetadataVersion,
+    pub version:           MetadataVersion,
     /// Collection name
-    pub name:             String,
+    pub name:              String,
     /// Creation timestamp (Unix timestamp)
-    pub created_at:       u64,
+    pub created_at:        u64,
     /// Last modification timestamp
-    pub updated_at:       u64,
+    pub updated_at:        u64,
     /// Number of documents in the collection
-    pub document_count:   u64,
+    pub document_count:    u64,
     /// Total size of all documents (bytes)
-    pub total_size_bytes: u64,
+    pub total_size_bytes:  u64,
     /// WAL configuration for this collection
-    pub wal_config:       Option<CollectionWalConfig>,
+    pub wal_config:        Option<CollectionWalConfig>,
+    /// Secondary indexes declared on this collection
+    #[serde(default)]
+    pub indexes:           Vec<IndexDefinition>,
+    /// Encoding of newly written document files
+    #[serde(default)]
+    pub document_encoding: DocumentEncoding,
+    /// Placement of the document files
+    #[serde(default)]
+    pub layout:            DocumentLayout,
+    /// Layout the files are being moved out of, while a layout migration is in progress
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub layout_migration:  Option<DocumentLayout>,
+    /// Whether the documents and WAL entries of this collection are encrypted at rest
+    #[serde(default)]
+    pub encrypted:         bool,
 }
 
 impl CollectionMetadata {
@@ -61,6 +76,11 @@ impl CollectionMetadata {
             document_count: 0,
             total_size_bytes: 0,
             wal_config: None,
+            indexes: Vec::new(),
+            document_encoding: DocumentEncoding::default(),
+            layout: DocumentLayout::default(),
+            layout_migration: None,
+            encrypted: false,
         }
     }
 
@@ -0,0 +1,471 @@
+//! Metrics recorded by a store and its collections.
+//!
+//! Every collection of a store records into the store's [`StoreMetrics`]: operation latencies,
+//! document bytes read and written, the documents queries scan and return, and the time spent
+//! verifying hashes and signatures. The WAL managers of the collections share the store's
+//! [`WalMetrics`]. [`Store::metrics`](crate::Store::metrics) returns everything as a
+//! [`MetricsSnapshot`].
+//!
+//! Latencies are recorded in microseconds, from the call of an operation until it returns. A
+//! query is only complete once its result stream has been consumed or dropped, so query latency
+//! is recorded at that point rather than when `query` returns.
+
+use std::{
+    pin::Pin,
+    sync::{
+        atomic::{AtomicU64, Ordering},
+        Arc,
+    },
+    task::{Context, Poll},
+    time::Instant,
+};
+
+use futures::StreamExt as _;
+use serde::{Deserialize, Serialize};
+use sentinel_wal::{Histogram, HistogramSnapshot, WalMetrics, WalMetricsSnapshot};
+use tokio_stream::Stream;
+
+use crate::{Document, Result};
+
+/// Collection operations whose latency is recorded.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub(crate) enum Operation {
+    /// Inserting a document, including bulk inserts.
+    Insert,
+    /// Reading a document by ID.
+    Get,
+    /// Updating a document.
+    Update,
+    /// Deleting a document.
+    Delete,
+    /// Running a query, until its result stream is consumed or dropped.
+    Query,
+    /// Running an aggregation.
+    Aggregate,
+}
+
+/// Metrics shared by a store and all of its collections.
+#[derive(Debug, Default)]
+pub(crate) struct StoreMetrics {
+    /// Insert latency.
+    insert:                 Histogram,
+    /// Get latency.
+    get:                    Histogram,
+    /// Update latency.
+    update:                 Histogram,
+    /// Delete latency.
+    delete:                 Histogram,
+    /// Query latency, until the results are consumed.
+    query:                  Histogram,
+    /// Aggregation latency.
+    aggregate:              Histogram,
+    /// Time spent verifying the hash of a document.
+    hash_verification:      Histogram,
+    /// Time spent verifying a signature or a batch of signatures.
+    signature_verification: Histogram,
+    /// Documents read while executing queries and aggregations.
+    documents_scanned:      AtomicU64,
+    /// Documents returned by queries.
+    documents_returned:     AtomicU64,
+    /// Bytes of document files read.
+    bytes_read:             AtomicU64,
+    /// Bytes of document files written.
+    bytes_written:          AtomicU64,
+    /// Metrics of the WAL managers of the collections.
+    wal:                    Arc<WalMetrics>,
+}
+
+impl StoreMetrics {
+    /// Returns the histogram recording the latency of `operation`.
+    const fn histogram(&self, operation: Operation) -> &Histogram {
+        match operation {
+            Operation::Insert => &self.insert,
+            Operation::Get => &self.get,
+            Operation::Update => &self.update,
+            Operation::Delete => &self.delete,
+            Operation::Query => &self.query,
+            Operation::Aggregate => &self.aggregate,
+        }
+    }
+
+    /// Starts timing `operation`; the latency is recorded when the returned timer is dropped.
+    pub(crate) fn time(self: &Arc<Self>, operation: Operation) -> OperationTimer {
+        OperationTimer {
+            metrics: self.clone(),
+            operation,
+            started: Instant::now(),
+        }
+    }
+
+    /// Records the time spent verifying a document hash since `started`.
+    pub(crate) fn record_hash_verification(&self, started: Instant) {
+        self.hash_verification.record_duration(started.elapsed());
+    }
+
+    /// Records the time spent verifying signatures since `started`.
+    pub(crate) fn record_signature_verification(&self, started: Instant) {
+        self.signature_verification
+            .record_duration(started.elapsed());
+    }
+
+    /// Records a document read while executing a query or aggregation.
+    pub(crate) fn record_scanned(&self) { self.documents_scanned.fetch_add(1, Ordering::Relaxed); }
+
+    /// Wraps the IDs of the documents a query or aggregation reads so that each one is recorded
+    /// as scanned when it is pulled from the stream.
+    pub(crate) fn count_scanned(
+        self: &Arc<Self>,
+        ids: Pin<Box<dyn Stream<Item = Result<String>> + Send>>,
+    ) -> Pin<Box<dyn Stream<Item = Result<String>> + Send>> {
+        let metrics = self.clone();
+        Box::pin(ids.inspect(move |id| {
+            if id.is_ok() {
+                metrics.record_scanned();
+            }
+        }))
+    }
+
+    /// Records `bytes` bytes of document files read.
+    pub(crate) fn record_read(&self, bytes: usize) { self.bytes_read.fetch_add(bytes as u64, Ordering::Relaxed); }
+
+    /// Records `bytes` bytes of document files written.
+    pub(crate) fn record_written(&self, bytes: u64) { self.bytes_written.fetch_add(bytes, Ordering::Relaxed); }
+
+    /// Returns the WAL metrics shared by the collections' WAL managers.
+    pub(crate) const fn wal(&self) -> &Arc<WalMetrics> { &self.wal }
+
+    /// Returns the metrics recorded so far, with the current depth of the store event queue.
+    pub(crate) fn snapshot(&self, event_queue_depth: usize) -> MetricsSnapshot {
+        MetricsSnapshot {
+            operations:             OperationLatencies {
+                insert:    self.insert.snapshot(),
+                get:       self.get.snapshot(),
+                update:    self.update.snapshot(),
+                delete:    self.delete.snapshot(),
+                query:     self.query.snapshot(),
+                aggregate: self.aggregate.snapshot(),
+            },
+            hash_verification:      self.hash_verification.snapshot(),
+            signature_verification: self.signature_verification.snapshot(),
+            documents_scanned:      self.documents_scanned.load(Ordering::Relaxed),
+            documents_returned:     self.documents_returned.load(Ordering::Relaxed),
+            bytes_read:             self.bytes_read.load(Ordering::Relaxed),
+            bytes_written:          self.bytes_written.load(Ordering::Relaxed),
+            event_queue_depth:      event_queue_depth as u64,
+            wal:                    self.wal.snapshot(),
+        }
+    }
+}
+
+/// Records the latency of an operation when dropped.
+#[derive(Debug)]
+pub(crate) struct OperationTimer {
+    /// The metrics recorded into.
+    metrics:   Arc<StoreMetrics>,
+    /// The operation being timed.
+    operation: Operation,
+    /// When the operation started.
+    started:   Instant,
+}
+
+impl Drop for OperationTimer {
+    fn drop(&mut self) {
+        self.metrics
+            .histogram(self.operation)
+            .record_duration(self.started.elapsed());
+    }
+}
+
+/// A query result stream counting the documents it returns and recording the query latency once
+/// it is exhausted or dropped.
+pub(crate) struct MeteredStream {
+    /// The query results.
+    inner: Pin<Box<dyn Stream<Item = Result<Document>> + Send>>,
+    /// Timer of the query, dropped with the stream or once it is exhausted.
+    timer: Option<OperationTimer>,
+}
+
+impl MeteredStream {
+    /// Wraps the results of the query timed by `timer`.
+    pub(crate) const fn new(
+        inner: Pin<Box<dyn Stream<Item = Result<Document>> + Send>>,
+        timer: OperationTimer,
+    ) -> Self {
+        Self {
+            inner,
+            timer: Some(timer),
+        }
+    }
+}
+
+impl Stream for MeteredStream {
+    type Item = Result<Document>;
+
+    fn poll_next(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Option<Self::Item>> {
+        let next = self.inner.as_mut().poll_next(cx);
+        match next {
+            Poll::Ready(Some(Ok(_))) => {
+                if let Some(ref timer) = self.timer {
+                    timer
+                        .metrics
+                        .documents_returned
+                        .fetch_add(1, Ordering::Relaxed);
+                }
+            },
+            Poll::Ready(None) => self.timer = None,
+            Poll::Ready(Some(Err(_))) | Poll::Pending => {},
+        }
+        next
+    }
+}
+
+/// Latency of each collection operation, in microseconds.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, Serialize, Deserialize)]
+pub struct OperationLatencies {
+    /// Inserts, bulk inserts included.
+    pub insert:    HistogramSnapshot,
+    /// Reads of a document by ID.
+    pub get:       HistogramSnapshot,
+    /// Updates.
+    pub update:    HistogramSnapshot,
+    /// Deletes.
+    pub delete:    HistogramSnapshot,
+    /// Queries, until their results were consumed or dropped.
+    pub query:     HistogramSnapshot,
+    /// Aggregations.
+    pub aggregate: HistogramSnapshot,
+}
+
+/// The metrics of a store at one point in time.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, Serialize, Deserialize)]
+pub struct MetricsSnapshot {
+    /// Latency of each collection operation.
+    pub operations:             OperationLatencies,
+    /// Time spent verifying document hashes, in microseconds.
+    pub hash_verification:      HistogramSnapshot,
+    /// Time spent verifying a signature or a batch of signatures, in microseconds.
+    pub signature_verification: HistogramSnapshot,
+    /// Documents read while executing queries and aggregations.
+    pub documents_scanned:      u64,
+    /// Documents returned by queries.
+    pub documents_returned:     u64,
+    /// Bytes of document files read.
+    pub bytes_read:             u64,
+    /// Bytes of document files written.
+    pub bytes_written:          u64,
+    /// Events waiting in the store event queue.
+    pub event_queue_depth:      u64,
+    /// Timings and volumes of the WAL writes of all collections.
+    pub wal:                    WalMetricsSnapshot,
+}
+
+#[cfg(feature = "prometheus")]
+impl MetricsSnapshot {
+    /// Renders the metrics in the Prometheus text exposition format.
+    ///
+    /// Histograms are exported as summaries with their 0.5, 0.9, 0.99 and 0.999 quantiles.
+    pub fn to_prometheus(&self) -> String { PrometheusText(self).to_string() }
+}
+
+/// A [`MetricsSnapshot`] formatted in the Prometheus text exposition format.
+#[cfg(feature = "prometheus")]
+struct PrometheusText<'a>(&'a MetricsSnapshot);
+
+#[cfg(feature = "prometheus")]
+impl std::fmt::Display for PrometheusText<'_> {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        let metrics = self.0;
+        write_summary(
+            f,
+            "sentinel_operation_duration_microseconds",
+            "Latency of collection operations.",
+            "operation",
+            &[
+                ("insert", &metrics.operations.insert),
+                ("get", &metrics.operations.get),
+                ("update", &metrics.operations.update),
+                ("delete", &metrics.operations.delete),
+                ("query", &metrics.operations.query),
+                ("aggregate", &metrics.operations.aggregate),
+            ],
+        )?;
+        write_summary(
+            f,
+            "sentinel_verification_duration_microseconds",
+            "Time spent verifying documents.",
+            "check",
+            &[
+                ("hash", &metrics.hash_verification),
+                ("signature", &metrics.signature_verification),
+            ],
+        )?;
+        write_summary(
+            f,
+            "sentinel_wal_duration_microseconds",
+            "Latency of WAL writes.",
+            "operation",
+            &[
+                ("append", &metrics.wal.append),
+                ("flush", &metrics.wal.flush),
+                ("fsync", &metrics.wal.fsync),
+                ("rotate", &metrics.wal.rotate),
+            ],
+        )?;
+        write_summary(
+            f,
+            "sentinel_wal_batch_entries",
+            "Number of entries per WAL batch.",
+            "",
+            &[("", &metrics.wal.batch_entries)],
+        )?;
+
+        let values = [
+            (
+                "sentinel_documents_scanned_total",
+                "Documents read while executing queries and aggregations.",
+                "counter",
+                metrics.documents_scanned,
+            ),
+            (
+                "sentinel_documents_returned_total",
+                "Documents returned by queries.",
+                "counter",
+                metrics.documents_returned,
+            ),
+            (
+                "sentinel_document_read_bytes_total",
+                "Bytes of document files read.",
+                "counter",
+                metrics.bytes_read,
+            ),
+            (
+                "sentinel_document_written_bytes_total",
+                "Bytes of document files written.",
+                "counter",
+                metrics.bytes_written,
+            ),
+            (
+                "sentinel_wal_entries_written_total",
+                "WAL entries written.",
+                "counter",
+                metrics.wal.entries_written,
+            ),
+            (
+                "sentinel_wal_written_bytes_total",
+                "Bytes written to the WAL.",
+                "counter",
+                metrics.wal.bytes_written,
+            ),
+            (
+                "sentinel_event_queue_depth",
+                "Events waiting in the store event queue.",
+                "gauge",
+                metrics.event_queue_depth,
+            ),
+        ];
+        for (name, help, kind, value) in values {
+            writeln!(f, "# HELP {name} {help}")?;
+            writeln!(f, "# TYPE {name} {kind}")?;
+            writeln!(f, "{name} {value}")?;
+        }
+        Ok(())
+    }
+}
+
+/// Writes one Prometheus summary per `(label value, histogram)` pair, all under `name`.
+///
+/// An empty `label` writes a single summary without labels.
+#[cfg(feature = "prometheus")]
+fn write_summary(
+    f: &mut std::fmt::Formatter<'_>,
+    name: &str,
+    help: &str,
+    label: &str,
+    series: &[(&str, &HistogramSnapshot)],
+) -> std::fmt::Result {
+    writeln!(f, "# HELP {name} {help}")?;
+    writeln!(f, "# TYPE {name} summary")?;
+    for &(value, histogram) in series {
+        let labels = if label.is_empty() {
+            String::new()
+        }
+        else {
+            format!("{label}=\"{value}\"")
+        };
+        let separator = if labels.is_empty() { "" } else { "," };
+        for (quantile, estimate) in [
+            ("0.5", histogram.p50),
+            ("0.9", histogram.p90),
+            ("0.99", histogram.p99),
+            ("0.999", histogram.p999),
+        ] {
+            writeln!(
+                f,
+                "{name}{{{labels}{separator}quantile=\"{quantile}\"}} {estimate}"
+            )?;
+        }
+        let braces = if labels.is_empty() {
+            String::new()
+        }
+        else {
+            format!("{{{labels}}}")
+        };
+        writeln!(f, "{name}_sum{braces} {}", histogram.sum)?;
+        writeln!(f, "{name}_count{braces} {}", histogram.count)?;
+    }
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use futures::StreamExt as _;
+    use serde_json::json;
+
+    use super::*;
+
+    #[tokio::test]
+    async fn test_metered_stream_records_query_on_completion() {
+        let metrics = Arc::new(StoreMetrics::default());
+        let doc = Document::new_without_signature("a".to_owned(), json!({}))
+            .await
+            .unwrap();
+        let inner: Pin<Box<dyn Stream<Item = Result<Document>> + Send>> =
+            Box::pin(futures::stream::iter(vec![Ok(doc.clone()), Ok(doc)]));
+        let mut stream = MeteredStream::new(inner, metrics.time(Operation::Query));
+
+        assert!(stream.next().await.is_some());
+        assert_eq!(metrics.snapshot(0).operations.query.count, 0);
+        assert!(stream.next().await.is_some());
+        assert!(stream.next().await.is_none());
+
+        let snapshot = metrics.snapshot(0);
+        assert_eq!(snapshot.operations.query.count, 1);
+        assert_eq!(snapshot.documents_returned, 2);
+        drop(stream);
+        assert_eq!(metrics.snapshot(0).operations.query.count, 1);
+    }
+
+    #[test]
+    fn test_operation_timer_records_on_drop() {
+        let metrics = Arc::new(StoreMetrics::default());
+        drop(metrics.time(Operation::Insert));
+        drop(metrics.time(Operation::Insert));
+        let snapshot = metrics.snapshot(3);
+        assert_eq!(snapshot.operations.insert.count, 2);
+        assert_eq!(snapshot.operations.get.count, 0);
+        assert_eq!(snapshot.event_queue_depth, 3);
+    }
+
+    #[cfg(feature = "prometheus")]
+    #[test]
+    fn test_prometheus_export() {
+        let metrics = Arc::new(StoreMetrics::default());
+        drop(metrics.time(Operation::Get));
+        metrics.record_read(42);
+        let text = metrics.snapshot(0).to_prometheus();
+        assert!(text.contains("sentinel_operation_duration_microseconds_count{operation=\"get\"} 1\n"));
+        assert!(text.contains("sentinel_document_read_bytes_total 42\n"));
+        assert!(text.contains("sentinel_wal_batch_entries{quantile=\"0.5\"} 0\n"));
+        assert!(text.contains("sentinel_wal_batch_entries_count 0\n"));
+    }
+}
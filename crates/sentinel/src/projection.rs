@@ -2,21 +2,28 @@
 
 use serde_json::Value;
 
-use crate::{Document, Result};
+use crate::Document;
 
 /// Projects a document to include only specified fields.
-pub async fn project_document(doc: &Document, fields: &[String]) -> Result<Document> {
+///
+/// The projection is a view of the source document: the selected values are moved out of it
+/// rather than cloned, and the id, timestamps, hash and signature are carried over unchanged.
+/// The hash and signature therefore describe the full stored document, not the projected data,
+/// which avoids re-hashing every projected result.
+pub fn project_document(mut doc: Document, fields: &[String]) -> Document {
     if fields.is_empty() {
-        return Ok(doc.clone());
+        return doc;
     }
     let mut projected_data = serde_json::Map::new();
-    for field in fields {
-        if let Some(value) = doc.data().get(field) {
-            projected_data.insert(field.clone(), value.clone());
+    if let Value::Object(ref mut data) = doc.data {
+        for field in fields {
+            if let Some(value) = data.remove(field) {
+                projected_data.insert(field.clone(), value);
+            }
         }
     }
-    // Create a new document with projected data
-    Document::new_without_signature(doc.id().to_owned(), Value::Object(projected_data)).await
+    doc.data = Value::Object(projected_data);
+    doc
 }
 
 #[cfg(test)]
@@ -34,16 +41,14 @@ mod tests {
     #[tokio::test]
     async fn test_project_document_empty_fields() {
         let doc = create_doc(json!({"name": "Alice", "age": 25})).await;
-        let projected = project_document(&doc, &[]).await.unwrap();
+        let projected = project_document(doc.clone(), &[]);
         assert_eq!(projected.data(), doc.data());
     }
 
     #[tokio::test]
     async fn test_project_document_with_fields() {
         let doc = create_doc(json!({"name": "Alice", "age": 25, "city": "NYC"})).await;
-        let projected = project_document(&doc, &["name".to_string(), "age".to_string()])
-            .await
-            .unwrap();
+        let projected = project_document(doc, &["name".to_string(), "age".to_string()]);
         let expected = json!({"name": "Alice", "age": 25});
         assert_eq!(projected.data(), &expected);
     }
@@ -51,10 +56,25 @@ mod tests {
     #[tokio::test]
     async fn test_project_document_missing_fields() {
         let doc = create_doc(json!({"name": "Alice"})).await;
-        let projected = project_document(&doc, &["name".to_string(), "age".to_string()])
-            .await
-            .unwrap();
+        let projected = project_document(doc, &["name".to_string(), "age".to_string()]);
         let expected = json!({"name": "Alice"});
         assert_eq!(projected.data(), &expected);
     }
+
+    #[tokio::test]
+    async fn test_project_document_keeps_source_metadata() {
+        let doc = create_doc(json!({"name": "Alice", "age": 25})).await;
+        let projected = project_document(doc.clone(), &["name".to_string()]);
+        assert_eq!(projected.id(), doc.id());
+        assert_eq!(projected.hash(), doc.hash());
+        assert_eq!(projected.created_at(), doc.created_at());
+        assert_eq!(projected.data(), &json!({"name": "Alice"}));
+    }
+
+    #[tokio::test]
+    async fn test_project_document_non_object_data() {
+        let doc = create_doc(json!([1, 2, 3])).await;
+        let projected = project_document(doc, &["name".to_string()]);
+        assert_eq!(projected.data(), &json!({}));
+    }
 }
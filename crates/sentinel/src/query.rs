@@ -1,10 +1,23 @@
+use std::{
+    cmp::Ordering,
+    fmt,
+    str::FromStr,
+    sync::{Arc, Mutex},
+};
+
+use serde::{Deserialize, Serialize};
 use serde_json::Value;
 use tokio_stream::Stream;
 
+use crate::{sorting::compare_keys, SentinelError};
+
 /// Represents a query for filtering documents in a collection.
 ///
 /// A query consists of filters, sorting, limits, offsets, and field projections.
 /// Queries are executed in-memory for basic filtering operations.
+///
+/// Results are ordered by the sort key, if any, and then by document ID, so a page of results can
+/// be resumed from its last document with [`QueryBuilder::after`] instead of skipping an offset.
 #[allow(
     clippy::missing_docs_in_private_items,
     reason = "fields are documented with ///"
@@ -19,18 +32,120 @@ pub struct Query {
     pub limit:      Option<usize>,
     /// Number of results to skip
     pub offset:     Option<usize>,
+    /// Only return results ordered after this cursor
+    pub after:      Option<QueryCursor>,
     /// Fields to include in results (projection)
     pub projection: Option<Vec<String>>,
 }
 
+impl Query {
+    /// Returns whether a document with this sort key and ID comes after the cursor of the query.
+    ///
+    /// Every document does when the query has no cursor.
+    pub fn is_after(&self, key: Option<&Value>, id: &str) -> bool {
+        let Some(ref cursor) = self.after
+        else {
+            return true;
+        };
+        let order = self
+            .sort
+            .as_ref()
+            .map_or(SortOrder::Ascending, |&(_, order)| order);
+        match compare_keys(key, cursor.key.as_ref(), order) {
+            Ordering::Greater => true,
+            Ordering::Equal => id > cursor.id.as_str(),
+            Ordering::Less => false,
+        }
+    }
+}
+
+/// Position in the results of a query, right after a given document.
+///
+/// A cursor holds the sort key and the ID of the last document of a page. Passing it to
+/// [`QueryBuilder::after`] resumes the same query with the next document, without reading the
+/// documents of the earlier pages again as an offset would. The text form is an opaque token.
+#[derive(Debug, Clone, PartialEq, Eq, Serialize, Deserialize)]
+pub struct QueryCursor {
+    /// Sort key of the document, `None` if the query is unsorted or the field is missing
+    key: Option<Value>,
+    /// ID of the document
+    id:  String,
+}
+
+impl QueryCursor {
+    /// Create a cursor positioned after the document with this sort key and ID.
+    pub const fn new(key: Option<Value>, id: String) -> Self {
+        Self {
+            key,
+            id,
+        }
+    }
+
+    /// Create the cursor positioned after `document` in the results of a query sorted by
+    /// `sort_field`.
+    pub fn after_document(document: &crate::Document, sort_field: Option<&str>) -> Self {
+        Self::new(
+            sort_field.and_then(|field| document.data().get(field).cloned()),
+            document.id().to_owned(),
+        )
+    }
+
+    /// Get the sort key of the cursor.
+    pub const fn key(&self) -> Option<&Value> { self.key.as_ref() }
+
+    /// Get the document ID of the cursor.
+    pub fn id(&self) -> &str { &self.id }
+}
+
+impl fmt::Display for QueryCursor {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        let encoded = serde_json::to_vec(self).map_err(|_e| fmt::Error)?;
+        f.write_str(&hex::encode(encoded))
+    }
+}
+
+impl FromStr for QueryCursor {
+    type Err = SentinelError;
+
+    fn from_str(s: &str) -> Result<Self, Self::Err> {
+        hex::decode(s.trim())
+            .ok()
+            .and_then(|encoded| serde_json::from_slice(&encoded).ok())
+            .ok_or_else(|| {
+                SentinelError::ConfigError {
+                    message: format!("Invalid query cursor '{}'", s),
+                }
+            })
+    }
+}
+
 /// The result of executing a query.
+#[allow(
+    clippy::field_scoped_visibility_modifiers,
+    reason = "the cursor slot is written by the result stream of the collection"
+)]
 pub struct QueryResult {
     /// The matching documents as a stream
     pub documents:      std::pin::Pin<Box<dyn Stream<Item = crate::Result<crate::Document>> + Send>>,
     /// Total number of documents that matched (before limit/offset), None if not known
     pub total_count:    Option<usize>,
-    /// Time taken to execute the query
+    /// Time taken to plan the query and open its result stream.
+    ///
+    /// Documents are read as the stream is consumed, so this does not cover reading them, except
+    /// for sorted queries that scan the candidates up front. The full latency of every query is
+    /// recorded in [`Store::metrics`](crate::Store::metrics) once its stream is exhausted or
+    /// dropped.
     pub execution_time: std::time::Duration,
+    /// Cursor after the last document yielded by `documents`
+    pub(crate) last:    Arc<Mutex<Option<QueryCursor>>>,
+}
+
+impl QueryResult {
+    /// Returns the cursor positioned after the last document yielded so far.
+    ///
+    /// Once a page has been consumed, pass it to [`QueryBuilder::after`] to read the next one. It
+    /// is `None` if no document has been yielded.
+    pub fn next_cursor(&self) -> Option<QueryCursor> { self.last.lock().unwrap().clone() }
 }
 
 /// Sort order for query results.
@@ -107,6 +222,8 @@ pub struct QueryBuilder {
     limit:      Option<usize>,
     /// Optional offset for pagination
     offset:     Option<usize>,
+    /// Optional cursor to resume after
+    after:      Option<QueryCursor>,
     /// Optional projection of fields
     projection: Option<Vec<String>>,
 }
@@ -123,6 +240,7 @@ impl QueryBuilder {
             sort:       None,
             limit:      None,
             offset:     None,
+            after:      None,
             projection: None,
         }
     }
@@ -294,6 +412,38 @@ impl QueryBuilder {
         self
     }
 
+    /// Resumes the query after a cursor, returned by [`QueryResult::next_cursor`] for the
+    /// previous page of the same query.
+    ///
+    /// Unlike an offset, the skipped documents are not read again: unsorted queries start
+    /// listing document IDs right after the cursor, and sorted queries only retain the documents
+    /// ordered after it.
+    ///
+    /// # Arguments
+    ///
+    /// * `cursor` - Cursor after the last document of the previous page
+    ///
+    /// # Returns
+    ///
+    /// Returns the query builder for chaining.
+    ///
+    /// # Example
+    ///
+    /// ```rust
+    /// use sentinel_dbms::{QueryBuilder, QueryCursor, SortOrder};
+    /// use serde_json::json;
+    ///
+    /// let cursor = QueryCursor::new(Some(json!(30)), "user-42".to_owned());
+    /// let query = QueryBuilder::new()
+    ///     .sort("age", SortOrder::Ascending)
+    ///     .after(cursor)
+    ///     .limit(50);
+    /// ```
+    pub fn after(mut self, cursor: QueryCursor) -> Self {
+        self.after = Some(cursor);
+        self
+    }
+
     /// Sets the fields to include in the results (projection).
     ///
     /// If projection is set, only the specified fields will be included
@@ -330,13 +480,14 @@ impl QueryBuilder {
             sort:       self.sort,
             limit:      self.limit,
             offset:     self.offset,
+            after:      self.after,
             projection: self.projection,
         }
     }
 }
 
 /// Aggregation operations for queries.
-#[derive(Debug, Clone, PartialEq, Eq)]
+#[derive(Debug, Clone, PartialEq)]
 pub enum Aggregation {
     /// Count of matching documents
     Count,
@@ -348,6 +499,10 @@ pub enum Aggregation {
     Min(String),
     /// Maximum value in the specified field
     Max(String),
+    /// Estimated number of distinct non-null values in the specified field
+    DistinctCount(String),
+    /// Estimated percentile, between 0 and 100, of numeric values in the specified field
+    Percentile(String, f64),
 }
 
 #[cfg(test)]
@@ -587,6 +742,58 @@ mod tests {
         assert_eq!(qb.offset, Some(5));
     }
 
+    #[test]
+    fn test_query_builder_after() {
+        let cursor = QueryCursor::new(Some(json!(30)), "user-42".to_owned());
+        let query = QueryBuilder::new().after(cursor.clone()).build();
+        assert_eq!(query.after, Some(cursor));
+    }
+
+    #[test]
+    fn test_query_cursor_round_trip() {
+        let cursor = QueryCursor::new(Some(json!({"nested": [1, "a"]})), "doc:1,2".to_owned());
+        let parsed: QueryCursor = cursor.to_string().parse().unwrap();
+        assert_eq!(parsed, cursor);
+        assert_eq!(parsed.key(), Some(&json!({"nested": [1, "a"]})));
+        assert_eq!(parsed.id(), "doc:1,2");
+
+        assert!("not a cursor".parse::<QueryCursor>().is_err());
+        assert!(hex::encode("[1]").parse::<QueryCursor>().is_err());
+    }
+
+    #[test]
+    fn test_query_is_after_cursor() {
+        let unsorted = QueryBuilder::new()
+            .after(QueryCursor::new(None, "b".to_owned()))
+            .build();
+        assert!(!unsorted.is_after(None, "a"));
+        assert!(!unsorted.is_after(None, "b"));
+        assert!(unsorted.is_after(None, "c"));
+
+        // Ties on the sort key are broken by ascending ID in both orders
+        let cursor = QueryCursor::new(Some(json!(5)), "m".to_owned());
+        let ascending = QueryBuilder::new()
+            .sort("n", SortOrder::Ascending)
+            .after(cursor.clone())
+            .build();
+        assert!(!ascending.is_after(Some(&json!(4)), "z"));
+        assert!(!ascending.is_after(Some(&json!(5)), "a"));
+        assert!(ascending.is_after(Some(&json!(5)), "n"));
+        assert!(ascending.is_after(Some(&json!(6)), "a"));
+        assert!(!ascending.is_after(None, "z"));
+
+        let descending = QueryBuilder::new()
+            .sort("n", SortOrder::Descending)
+            .after(cursor)
+            .build();
+        assert!(descending.is_after(Some(&json!(4)), "a"));
+        assert!(descending.is_after(Some(&json!(5)), "n"));
+        assert!(!descending.is_after(Some(&json!(6)), "z"));
+        assert!(descending.is_after(None, "a"));
+
+        assert!(QueryBuilder::new().build().is_after(None, "a"));
+    }
+
     #[test]
     fn test_query_builder_projection() {
         let qb = QueryBuilder::new().projection(vec!["name", "age"]);
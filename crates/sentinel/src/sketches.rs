@@ -0,0 +1,290 @@
+//! Mergeable summaries for approximate aggregations.
+//!
+//! Both summaries use bounded memory however many values they see, and two summaries built over
+//! disjoint sets of values merge into the summary of their union, so aggregations can build them
+//! in parallel over parts of a collection.
+
+use std::hash::{DefaultHasher, Hash, Hasher as _};
+
+/// Number of hash bits selecting a HyperLogLog register
+const HLL_PRECISION: u32 = 12;
+
+/// Number of HyperLogLog registers; the standard error of the estimate is
+/// `1.04 / sqrt(HLL_REGISTERS)`, about 1.6%
+const HLL_REGISTERS: usize = 1 << HLL_PRECISION;
+
+/// Compression of t-digests; higher values keep more centroids and give more accurate quantiles
+const TDIGEST_COMPRESSION: f64 = 100.0;
+
+/// Number of values a t-digest buffers before merging them into its centroids
+const TDIGEST_BUFFER_LEN: usize = 500;
+
+/// Estimates the number of distinct values in a set.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub(crate) struct HyperLogLog {
+    /// Highest rank seen for each register.
+    registers: Vec<u8>,
+}
+
+impl Default for HyperLogLog {
+    fn default() -> Self {
+        Self {
+            registers: vec![0; HLL_REGISTERS],
+        }
+    }
+}
+
+impl HyperLogLog {
+    /// Adds a value to the set.
+    pub(crate) fn insert<T: Hash + ?Sized>(&mut self, value: &T) {
+        let mut hasher = DefaultHasher::new();
+        value.hash(&mut hasher);
+        let hash = hasher.finish();
+
+        let index = hash.wrapping_shr(u64::BITS.saturating_sub(HLL_PRECISION)) as usize;
+        let rest = hash.wrapping_shl(HLL_PRECISION);
+        let rank = rest
+            .leading_zeros()
+            .min(u64::BITS.saturating_sub(HLL_PRECISION))
+            .saturating_add(1) as u8;
+        if let Some(register) = self.registers.get_mut(index) {
+            *register = (*register).max(rank);
+        }
+    }
+
+    /// Adds the values of another set.
+    pub(crate) fn merge(&mut self, other: &Self) {
+        for (register, &rank) in self.registers.iter_mut().zip(other.registers.iter()) {
+            *register = (*register).max(rank);
+        }
+    }
+
+    /// Returns the estimated number of distinct values.
+    pub(crate) fn estimate(&self) -> u64 {
+        let registers = HLL_REGISTERS as f64;
+        let alpha = 0.7213 / (1.0 + 1.079 / registers);
+        let inverse_sum: f64 = self
+            .registers
+            .iter()
+            .map(|&rank| 0.5f64.powi(i32::from(rank)))
+            .sum();
+        let raw = alpha * registers * registers / inverse_sum;
+
+        // Linear counting is more accurate while many registers are still empty
+        let empty = self.registers.iter().filter(|&&rank| rank == 0).count();
+        let estimate = if raw <= 2.5 * registers && empty > 0 {
+            registers * (registers / empty as f64).ln()
+        }
+        else {
+            raw
+        };
+        estimate.round() as u64
+    }
+}
+
+/// A weighted cluster of nearby values in a t-digest.
+#[derive(Debug, Clone, Copy, PartialEq)]
+struct Centroid {
+    /// Mean of the values in the cluster.
+    mean:   f64,
+    /// Number of values in the cluster.
+    weight: f64,
+}
+
+/// Estimates quantiles of a set of numbers.
+///
+/// Values are clustered into centroids that stay small near both ends of the distribution, so
+/// extreme quantiles such as p99 stay accurate while memory is bounded by the compression.
+#[derive(Debug, Clone, PartialEq)]
+pub(crate) struct TDigest {
+    /// Centroids sorted by mean.
+    centroids: Vec<Centroid>,
+    /// Values not merged into the centroids yet.
+    buffer:    Vec<f64>,
+    /// Smallest value seen.
+    min:       f64,
+    /// Largest value seen.
+    max:       f64,
+}
+
+impl Default for TDigest {
+    fn default() -> Self {
+        Self {
+            centroids: Vec::new(),
+            buffer:    Vec::new(),
+            min:       f64::INFINITY,
+            max:       f64::NEG_INFINITY,
+        }
+    }
+}
+
+impl TDigest {
+    /// Adds a value. Values that are not finite are ignored.
+    pub(crate) fn insert(&mut self, value: f64) {
+        if !value.is_finite() {
+            return;
+        }
+        self.min = self.min.min(value);
+        self.max = self.max.max(value);
+        self.buffer.push(value);
+        if self.buffer.len() >= TDIGEST_BUFFER_LEN {
+            self.compress();
+        }
+    }
+
+    /// Adds the values of another digest.
+    pub(crate) fn merge(&mut self, other: &Self) {
+        self.min = self.min.min(other.min);
+        self.max = self.max.max(other.max);
+        self.buffer.extend_from_slice(&other.buffer);
+        self.centroids.extend_from_slice(&other.centroids);
+        self.compress();
+    }
+
+    /// Returns the estimated value at quantile `q`, between 0 and 1, or `None` if no value was
+    /// added.
+    pub(crate) fn quantile(&mut self, q: f64) -> Option<f64> {
+        if !self.buffer.is_empty() {
+            self.compress();
+        }
+        let first = *self.centroids.first()?;
+        let last = *self.centroids.last()?;
+        if self.centroids.len() == 1 {
+            return Some(first.mean);
+        }
+        let total: f64 = self.centroids.iter().map(|c| c.weight).sum();
+        let target = q.clamp(0.0, 1.0) * total;
+
+        // Each centroid is taken to sit at the middle of the values it holds
+        let first_center = first.weight / 2.0;
+        if target <= first_center {
+            return Some(interpolate(self.min, first.mean, target / first_center));
+        }
+        let last_center = total - last.weight / 2.0;
+        if target >= last_center {
+            return Some(interpolate(
+                last.mean,
+                self.max,
+                (target - last_center) / (total - last_center),
+            ));
+        }
+
+        let mut center = first_center;
+        for pair in self.centroids.windows(2) {
+            let &[left, right] = pair
+            else {
+                continue;
+            };
+            let next_center = center + (left.weight + right.weight) / 2.0;
+            if target <= next_center {
+                return Some(interpolate(
+                    left.mean,
+                    right.mean,
+                    (target - center) / (next_center - center),
+                ));
+            }
+            center = next_center;
+        }
+        Some(last.mean)
+    }
+
+    /// Merges the buffered values into the centroids and the centroids with each other.
+    fn compress(&mut self) {
+        let mut all = std::mem::take(&mut self.centroids);
+        all.extend(self.buffer.drain(..).map(|value| {
+            Centroid {
+                mean:   value,
+                weight: 1.0,
+            }
+        }));
+        all.sort_by(|a, b| a.mean.total_cmp(&b.mean));
+
+        let total: f64 = all.iter().map(|c| c.weight).sum();
+        let mut merged = Vec::with_capacity(all.len());
+        let mut values = all.into_iter();
+        let Some(mut current) = values.next()
+        else {
+            return;
+        };
+        let mut weight_before = 0.0;
+        let mut k_lower = scale(0.0);
+        for centroid in values {
+            let q_upper = (weight_before + current.weight + centroid.weight) / total;
+            if scale(q_upper) - k_lower <= 1.0 {
+                let weight = current.weight + centroid.weight;
+                current.mean = current
+                    .mean
+                    .mul_add(current.weight, centroid.mean * centroid.weight) /
+                    weight;
+                current.weight = weight;
+            }
+            else {
+                weight_before += current.weight;
+                k_lower = scale(weight_before / total);
+                merged.push(current);
+                current = centroid;
+            }
+        }
+        merged.push(current);
+        self.centroids = merged;
+    }
+}
+
+/// Maps a quantile to the t-digest scale, on which every centroid spans at most one unit.
+fn scale(q: f64) -> f64 { TDIGEST_COMPRESSION / (2.0 * std::f64::consts::PI) * 2.0f64.mul_add(q, -1.0).asin() }
+
+/// Returns the value a fraction `t` of the way from `from` to `to`.
+fn interpolate(from: f64, to: f64, t: f64) -> f64 { (to - from).mul_add(t.clamp(0.0, 1.0), from) }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_hyperloglog_estimates_distinct_values() {
+        let mut small = HyperLogLog::default();
+        for value in ["a", "b", "c", "a", "b"] {
+            small.insert(value);
+        }
+        assert_eq!(small.estimate(), 3);
+
+        let mut left = HyperLogLog::default();
+        let mut right = HyperLogLog::default();
+        for i in 0 .. 60_000u32 {
+            left.insert(&i);
+            right.insert(&(i + 40_000));
+        }
+        left.merge(&right);
+        let estimate = left.estimate() as f64;
+        assert!(
+            (estimate - 100_000.0).abs() < 5_000.0,
+            "estimate {}",
+            estimate
+        );
+    }
+
+    #[test]
+    fn test_tdigest_quantiles() {
+        let mut small = TDigest::default();
+        for value in [5.0, 1.0, 3.0, 2.0, 4.0] {
+            small.insert(value);
+        }
+        assert_eq!(small.quantile(0.0), Some(1.0));
+        assert_eq!(small.quantile(0.5), Some(3.0));
+        assert_eq!(small.quantile(1.0), Some(5.0));
+        assert_eq!(TDigest::default().quantile(0.5), None);
+
+        let mut left = TDigest::default();
+        let mut right = TDigest::default();
+        for i in 0 .. 50_000 {
+            left.insert(f64::from(i));
+            right.insert(f64::from(i + 50_000));
+        }
+        left.merge(&right);
+        let p50 = left.quantile(0.5).unwrap();
+        let p99 = left.quantile(0.99).unwrap();
+        assert!((p50 - 50_000.0).abs() < 500.0, "p50 {}", p50);
+        assert!((p99 - 99_000.0).abs() < 200.0, "p99 {}", p99);
+        assert!(left.centroids.len() < 500);
+    }
+}
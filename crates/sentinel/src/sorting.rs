@@ -0,0 +1,677 @@
+//! Memory-bounded sorting utilities for sorted queries.
+//!
+//! Sorted queries never hold the whole collection in memory:
+//!
+//! - [`TopK`] keeps only the best `offset + limit` items in a bounded binary heap when the query
+//!   has a limit.
+//! - [`ExternalSorter`] sorts `(sort key, document id)` pairs for unbounded sorts, spilling sorted
+//!   runs of at most [`SORT_RUN_CAPACITY`] pairs to disk and merging them lazily, at most
+//!   [`SORT_MERGE_FAN_IN`] runs at a time. The runs of an encrypted collection are sealed with its
+//!   cipher, so sort keys never reach disk in the clear.
+//!
+//! Both are stable: items with equal sort keys keep the order in which they were pushed.
+
+use std::{
+    cmp::{Ordering, Reverse},
+    collections::BinaryHeap,
+    path::{Path, PathBuf},
+    pin::Pin,
+    sync::Arc,
+};
+
+use async_stream::stream;
+use futures::Stream;
+use sentinel_crypto::EnvelopeCipher;
+use serde_json::Value;
+use tokio::{
+    fs as tokio_fs,
+    io::{AsyncReadExt as _, AsyncWriteExt as _, BufReader, BufWriter},
+};
+use tracing::{debug, trace, warn};
+
+use crate::{comparison::compare_values, Result, SentinelError, SortOrder};
+
+/// Number of `(sort key, id)` pairs buffered in memory before a sorted run is spilled to disk.
+pub const SORT_RUN_CAPACITY: usize = 8192;
+
+/// Maximum number of spilled runs merged at once, bounding the run files open during a merge.
+pub const SORT_MERGE_FAN_IN: usize = 64;
+
+/// Size in bytes above which the entries of a spilled run are written out as one block.
+const SPILL_BLOCK_BYTES: usize = 64 * 1024;
+
+/// Compares two sort keys in the requested output order.
+pub fn compare_keys(a: Option<&Value>, b: Option<&Value>, order: SortOrder) -> Ordering {
+    match order {
+        SortOrder::Ascending => compare_values(a, b),
+        SortOrder::Descending => compare_values(b, a),
+    }
+}
+
+/// An item held by [`TopK`], ordered by sort key and then by insertion sequence.
+struct RankedItem<T> {
+    /// The sort key of the item, `None` if the sort field is missing.
+    key:   Option<Value>,
+    /// Insertion sequence number, used to keep the sort stable.
+    seq:   u64,
+    /// The requested output order.
+    order: SortOrder,
+    /// The ranked item.
+    item:  T,
+}
+
+impl<T> PartialEq for RankedItem<T> {
+    fn eq(&self, other: &Self) -> bool { self.cmp(other) == Ordering::Equal }
+}
+
+impl<T> Eq for RankedItem<T> {}
+
+impl<T> PartialOrd for RankedItem<T> {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> { Some(self.cmp(other)) }
+}
+
+impl<T> Ord for RankedItem<T> {
+    fn cmp(&self, other: &Self) -> Ordering {
+        compare_keys(self.key.as_ref(), other.key.as_ref(), self.order).then(self.seq.cmp(&other.seq))
+    }
+}
+
+/// Keeps the first `capacity` items of a sorted sequence without materializing the sequence.
+///
+/// Items are pushed in any order; the heap always evicts the item that would come last in the
+/// output, so memory is bounded by `capacity` regardless of how many items are pushed.
+pub struct TopK<T> {
+    /// Maximum number of items retained.
+    capacity: usize,
+    /// The requested output order.
+    order:    SortOrder,
+    /// Sequence number assigned to the next pushed item.
+    next_seq: u64,
+    /// Max-heap whose top is the item that would be evicted next.
+    heap:     BinaryHeap<RankedItem<T>>,
+}
+
+impl<T> TopK<T> {
+    /// Creates an empty top-k selector retaining at most `capacity` items.
+    pub fn new(capacity: usize, order: SortOrder) -> Self {
+        Self {
+            capacity,
+            order,
+            next_seq: 0,
+            heap: BinaryHeap::with_capacity(capacity.min(SORT_RUN_CAPACITY)),
+        }
+    }
+
+    /// Offers an item with its sort key.
+    pub fn push(&mut self, key: Option<Value>, item: T) {
+        let ranked = RankedItem {
+            key,
+            seq: self.next_seq,
+            order: self.order,
+            item,
+        };
+        self.next_seq = self.next_seq.saturating_add(1);
+
+        if self.heap.len() < self.capacity {
+            self.heap.push(ranked);
+        }
+        else if let Some(mut worst) = self.heap.peek_mut() &&
+            ranked < *worst
+        {
+            *worst = ranked;
+        }
+    }
+
+    /// Returns the retained items in output order.
+    pub fn into_sorted_vec(self) -> Vec<T> {
+        self.heap
+            .into_sorted_vec()
+            .into_iter()
+            .map(|ranked| ranked.item)
+            .collect()
+    }
+}
+
+/// A spilled run entry: whether the sort field was present, its value, and the document id.
+type SpilledEntry = (bool, Value, String);
+
+/// The head entry of a sorted run during the k-way merge.
+struct MergeHead {
+    /// The sort key of the entry.
+    key:   Option<Value>,
+    /// Index of the run the entry came from; earlier runs win ties to keep the sort stable.
+    run:   usize,
+    /// The requested output order.
+    order: SortOrder,
+    /// The document id.
+    id:    String,
+}
+
+impl PartialEq for MergeHead {
+    fn eq(&self, other: &Self) -> bool { self.cmp(other) == Ordering::Equal }
+}
+
+impl Eq for MergeHead {}
+
+impl PartialOrd for MergeHead {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> { Some(self.cmp(other)) }
+}
+
+impl Ord for MergeHead {
+    fn cmp(&self, other: &Self) -> Ordering {
+        compare_keys(self.key.as_ref(), other.key.as_ref(), self.order).then(self.run.cmp(&other.run))
+    }
+}
+
+/// Temporary directory holding the spilled runs of one sort, removed when dropped.
+struct SpillDir(PathBuf);
+
+impl Drop for SpillDir {
+    fn drop(&mut self) {
+        if let Err(e) = std::fs::remove_dir_all(&self.0) &&
+            e.kind() != std::io::ErrorKind::NotFound
+        {
+            warn!("Failed to remove sort spill directory {:?}: {}", self.0, e);
+        }
+    }
+}
+
+/// Writes a block of newline-separated run entries, sealed with `cipher` when one is given.
+///
+/// Each block is prefixed with its length as a little-endian `u32`.
+async fn write_spilled_block(
+    writer: &mut BufWriter<tokio_fs::File>,
+    block: &[u8],
+    cipher: Option<&EnvelopeCipher>,
+) -> Result<()> {
+    let sealed = cipher.map(|cipher| cipher.seal(block)).transpose()?;
+    let payload = sealed.as_deref().unwrap_or(block);
+    let len = u32::try_from(payload.len()).map_err(|_| {
+        SentinelError::Internal {
+            message: format!("sort run block of {} bytes is too large", payload.len()),
+        }
+    })?;
+    writer.write_all(&len.to_le_bytes()).await?;
+    writer.write_all(payload).await?;
+    Ok(())
+}
+
+/// Writer of a spilled run, writing out one block of entries at a time.
+struct RunWriter {
+    /// Path of the run file.
+    path:   PathBuf,
+    /// The run file.
+    writer: BufWriter<tokio_fs::File>,
+    /// Cipher the blocks of the run are sealed with.
+    cipher: Option<Arc<EnvelopeCipher>>,
+    /// The entries of the current block not written yet.
+    block:  Vec<u8>,
+}
+
+impl RunWriter {
+    /// Creates the run file at `path`.
+    async fn create(path: PathBuf, cipher: Option<Arc<EnvelopeCipher>>) -> Result<Self> {
+        Ok(Self {
+            writer: BufWriter::new(tokio_fs::File::create(&path).await?),
+            path,
+            cipher,
+            block: Vec::with_capacity(SPILL_BLOCK_BYTES),
+        })
+    }
+
+    /// Appends an entry to the run; entries must be pushed in output order.
+    async fn push(&mut self, key: Option<Value>, id: String) -> Result<()> {
+        let entry: SpilledEntry = (key.is_some(), key.unwrap_or(Value::Null), id);
+        serde_json::to_writer(&mut self.block, &entry)?;
+        self.block.push(b'\n');
+        if self.block.len() >= SPILL_BLOCK_BYTES {
+            write_spilled_block(&mut self.writer, &self.block, self.cipher.as_deref()).await?;
+            self.block.clear();
+        }
+        Ok(())
+    }
+
+    /// Writes out the last block and flushes the run, returning its path.
+    async fn finish(mut self) -> Result<PathBuf> {
+        if !self.block.is_empty() {
+            write_spilled_block(&mut self.writer, &self.block, self.cipher.as_deref()).await?;
+        }
+        self.writer.flush().await?;
+        Ok(self.path)
+    }
+}
+
+/// Reader of a spilled run, loading one block of entries at a time.
+struct SpilledRun {
+    /// The run file.
+    reader: BufReader<tokio_fs::File>,
+    /// Cipher the blocks of the run are sealed with.
+    cipher: Option<Arc<EnvelopeCipher>>,
+    /// The entries of the current block not read yet, in reverse order.
+    block:  Vec<SpilledEntry>,
+}
+
+impl SpilledRun {
+    /// Opens the run file at `path`.
+    async fn open(path: &Path, cipher: Option<Arc<EnvelopeCipher>>) -> Result<Self> {
+        Ok(Self {
+            reader: BufReader::new(tokio_fs::File::open(path).await?),
+            cipher,
+            block: Vec::new(),
+        })
+    }
+
+    /// Reads the next entry of the run.
+    async fn next_entry(&mut self) -> Result<Option<SpilledEntry>> {
+        while self.block.is_empty() {
+            let mut len = [0_u8; 4];
+            match self.reader.read_exact(&mut len).await {
+                Ok(_) => {},
+                Err(e) if e.kind() == std::io::ErrorKind::UnexpectedEof => return Ok(None),
+                Err(e) => return Err(e.into()),
+            }
+            let mut block = vec![0_u8; u32::from_le_bytes(len) as usize];
+            self.reader.read_exact(&mut block).await?;
+            if let Some(cipher) = self.cipher.as_ref() {
+                block = cipher.open(&block)?;
+            }
+            self.block = block
+                .split(|byte| *byte == b'\n')
+                .filter(|line| !line.is_empty())
+                .map(serde_json::from_slice)
+                .collect::<serde_json::Result<_>>()?;
+            self.block.reverse();
+        }
+        Ok(self.block.pop())
+    }
+}
+
+/// K-way merge of sorted runs, holding the head entry of each run.
+struct RunMerge {
+    /// The merged runs, in spill order.
+    runs:  Vec<SpilledRun>,
+    /// The head entries of the runs not exhausted yet.
+    heap:  BinaryHeap<Reverse<MergeHead>>,
+    /// The requested output order.
+    order: SortOrder,
+}
+
+impl RunMerge {
+    /// Opens the run files at `paths`, given in spill order, and reads their first entries.
+    async fn open(paths: &[PathBuf], cipher: Option<&Arc<EnvelopeCipher>>, order: SortOrder) -> Result<Self> {
+        let mut merge = Self {
+            runs: Vec::with_capacity(paths.len()),
+            heap: BinaryHeap::with_capacity(paths.len()),
+            order,
+        };
+        for path in paths {
+            merge
+                .runs
+                .push(SpilledRun::open(path, cipher.cloned()).await?);
+        }
+        for run in 0 .. merge.runs.len() {
+            merge.advance(run).await?;
+        }
+        Ok(merge)
+    }
+
+    /// Reads the next entry of `run` into the heap, if the run has one left.
+    async fn advance(&mut self, run: usize) -> Result<()> {
+        let Some(reader) = self.runs.get_mut(run)
+        else {
+            return Ok(());
+        };
+        if let Some((present, value, id)) = reader.next_entry().await? {
+            self.heap.push(Reverse(MergeHead {
+                key: present.then_some(value),
+                run,
+                order: self.order,
+                id,
+            }));
+        }
+        Ok(())
+    }
+
+    /// Returns the next `(sort key, id)` pair in output order.
+    async fn next_entry(&mut self) -> Result<Option<(Option<Value>, String)>> {
+        let Some(Reverse(head)) = self.heap.pop()
+        else {
+            return Ok(None);
+        };
+        self.advance(head.run).await?;
+        Ok(Some((head.key, head.id)))
+    }
+}
+
+/// Sorts `(sort key, document id)` pairs with bounded memory.
+///
+/// Pairs are buffered until [`SORT_RUN_CAPACITY`] is reached, then sorted and written to a run
+/// file below the spill directory, sealed with the cipher set by [`ExternalSorter::with_cipher`].
+/// [`ExternalSorter::finish`] merges all runs into a stream of document ids in output order,
+/// first merging groups of adjacent runs into longer ones while more than
+/// [`SORT_MERGE_FAN_IN`] remain, so only that many run files are ever open at once. If
+/// everything fits in a single run, nothing touches disk.
+pub struct ExternalSorter {
+    /// Directory below which the spill directory of this sort is created.
+    spill_root:   PathBuf,
+    /// The spill directory, created on the first spill.
+    spill_dir:    Option<SpillDir>,
+    /// The requested output order.
+    order:        SortOrder,
+    /// Maximum number of pairs buffered in memory.
+    run_capacity: usize,
+    /// The pairs of the current, not yet spilled run.
+    run:          Vec<(Option<Value>, String)>,
+    /// Paths of the spilled runs, in spill order.
+    runs:         Vec<PathBuf>,
+    /// Number of run files created so far, naming the next one.
+    created_runs: usize,
+    /// Maximum number of runs merged at once.
+    fan_in:       usize,
+    /// Cipher sealing the spilled runs.
+    cipher:       Option<Arc<EnvelopeCipher>>,
+}
+
+impl ExternalSorter {
+    /// Creates a new sorter spilling below `spill_root`.
+    pub fn new(spill_root: &Path, order: SortOrder) -> Self {
+        Self::with_run_capacity(spill_root, order, SORT_RUN_CAPACITY)
+    }
+
+    /// Creates a new sorter with a custom in-memory run capacity.
+    pub fn with_run_capacity(spill_root: &Path, order: SortOrder, run_capacity: usize) -> Self {
+        Self {
+            spill_root: spill_root.to_path_buf(),
+            spill_dir: None,
+            order,
+            run_capacity: run_capacity.max(1),
+            run: Vec::new(),
+            runs: Vec::new(),
+            created_runs: 0,
+            fan_in: SORT_MERGE_FAN_IN,
+            cipher: None,
+        }
+    }
+
+    /// Merges at most `fan_in` runs at once instead of [`SORT_MERGE_FAN_IN`], at least two.
+    #[must_use]
+    pub fn with_fan_in(mut self, fan_in: usize) -> Self {
+        self.fan_in = fan_in.max(2);
+        self
+    }
+
+    /// Seals the spilled runs with `cipher` when one is given, for the sorts of an encrypted
+    /// collection.
+    #[must_use]
+    pub fn with_cipher(mut self, cipher: Option<Arc<EnvelopeCipher>>) -> Self {
+        self.cipher = cipher;
+        self
+    }
+
+    /// Adds a pair, spilling the current run to disk if it is full.
+    pub async fn push(&mut self, key: Option<Value>, id: String) -> Result<()> {
+        self.run.push((key, id));
+        if self.run.len() >= self.run_capacity {
+            self.spill().await?;
+        }
+        Ok(())
+    }
+
+    /// Sorts the current run in place; `sort_by` is stable, preserving push order on ties.
+    fn sort_run(&mut self) {
+        let order = self.order;
+        self.run
+            .sort_by(|a, b| compare_keys(a.0.as_ref(), b.0.as_ref(), order));
+    }
+
+    /// Creates a new run file in the spill directory, creating the directory on first use.
+    async fn create_run(&mut self) -> Result<RunWriter> {
+        let dir = if let Some(ref dir) = self.spill_dir {
+            dir.0.clone()
+        }
+        else {
+            let dir = self.spill_root.join(cuid2::create_id());
+            tokio_fs::create_dir_all(&dir).await?;
+            self.spill_dir = Some(SpillDir(dir.clone()));
+            dir
+        };
+
+        let run_path = dir.join(format!("run-{}", self.created_runs));
+        self.created_runs = self.created_runs.saturating_add(1);
+        RunWriter::create(run_path, self.cipher.clone()).await
+    }
+
+    /// Sorts the current run and writes it to a new run file.
+    async fn spill(&mut self) -> Result<()> {
+        self.sort_run();
+
+        let mut writer = self.create_run().await?;
+        for (key, id) in std::mem::take(&mut self.run) {
+            writer.push(key, id).await?;
+        }
+        let run_path = writer.finish().await?;
+
+        trace!("Spilled sort run {:?}", run_path);
+        self.runs.push(run_path);
+        Ok(())
+    }
+
+    /// Merges groups of at most `fan_in` adjacent runs into single runs until at most `fan_in`
+    /// runs remain, removing the merged run files.
+    ///
+    /// Adjacent runs are merged in spill order, so ties still resolve in push order.
+    async fn reduce_runs(&mut self) -> Result<()> {
+        while self.runs.len() > self.fan_in {
+            debug!(
+                "Merging {} spilled sort runs in groups of {}",
+                self.runs.len(),
+                self.fan_in
+            );
+            let runs = std::mem::take(&mut self.runs);
+            for group in runs.chunks(self.fan_in) {
+                if let [run] = group {
+                    self.runs.push(run.clone());
+                    continue;
+                }
+
+                let mut merge = RunMerge::open(group, self.cipher.as_ref(), self.order).await?;
+                let mut writer = self.create_run().await?;
+                while let Some((key, id)) = merge.next_entry().await? {
+                    writer.push(key, id).await?;
+                }
+                self.runs.push(writer.finish().await?);
+                drop(merge);
+                for run in group {
+                    tokio_fs::remove_file(run).await?;
+                }
+            }
+        }
+        Ok(())
+    }
+
+    /// Finishes the sort, returning the document ids in output order.
+    pub async fn finish(mut self) -> Result<Pin<Box<dyn Stream<Item = Result<String>> + Send>>> {
+        if self.runs.is_empty() {
+            self.sort_run();
+            let ids: Vec<_> = self.run.into_iter().map(|(_, id)| id).collect();
+            let stream = tokio_stream::iter(ids.into_iter().map(Ok));
+            return Ok(Box::pin(stream) as Pin<Box<dyn Stream<Item = Result<String>> + Send>>);
+        }
+
+        if !self.run.is_empty() {
+            self.spill().await?;
+        }
+        self.reduce_runs().await?;
+        debug!("Merging {} spilled sort runs", self.runs.len());
+
+        let mut merge = RunMerge::open(&self.runs, self.cipher.as_ref(), self.order).await?;
+        let spill_dir = self.spill_dir.take();
+        Ok(Box::pin(stream! {
+            // Keep the spill directory alive until the merge completes or the stream is dropped
+            let _spill_dir = spill_dir;
+            loop {
+                match merge.next_entry().await {
+                    Ok(Some((_, id))) => yield Ok(id),
+                    Ok(None) => return,
+                    Err(e) => {
+                        yield Err(e);
+                        return;
+                    }
+                }
+            }
+        }))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use futures::TryStreamExt as _;
+    use serde_json::json;
+
+    use super::*;
+
+    #[test]
+    fn test_top_k_keeps_best_items() {
+        let mut top = TopK::new(3, SortOrder::Ascending);
+        for (i, v) in [5, 1, 9, 3, 7, 2].iter().enumerate() {
+            top.push(Some(json!(v)), i);
+        }
+        // Values 1, 2, 3 were pushed at positions 1, 5, 3
+        assert_eq!(top.into_sorted_vec(), vec![1, 5, 3]);
+    }
+
+    #[test]
+    fn test_top_k_descending_and_missing_keys() {
+        let mut top = TopK::new(2, SortOrder::Descending);
+        top.push(None, "missing");
+        top.push(Some(json!(1)), "one");
+        top.push(Some(json!(10)), "ten");
+        assert_eq!(top.into_sorted_vec(), vec!["ten", "one"]);
+
+        let mut top = TopK::new(2, SortOrder::Ascending);
+        top.push(Some(json!(1)), "one");
+        top.push(None, "missing");
+        assert_eq!(top.into_sorted_vec(), vec!["missing", "one"]);
+    }
+
+    #[test]
+    fn test_top_k_is_stable() {
+        let mut top = TopK::new(3, SortOrder::Ascending);
+        top.push(Some(json!(1)), "a");
+        top.push(Some(json!(1)), "b");
+        top.push(Some(json!(1)), "c");
+        top.push(Some(json!(1)), "d");
+        assert_eq!(top.into_sorted_vec(), vec!["a", "b", "c"]);
+    }
+
+    #[test]
+    fn test_top_k_zero_capacity() {
+        let mut top = TopK::new(0, SortOrder::Ascending);
+        top.push(Some(json!(1)), ());
+        assert!(top.into_sorted_vec().is_empty());
+    }
+
+    #[tokio::test]
+    async fn test_external_sorter_in_memory() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let mut sorter = ExternalSorter::new(temp_dir.path(), SortOrder::Ascending);
+        sorter.push(Some(json!("b")), "2".to_owned()).await.unwrap();
+        sorter.push(Some(json!("a")), "1".to_owned()).await.unwrap();
+        let ids: Vec<String> = sorter.finish().await.unwrap().try_collect().await.unwrap();
+        assert_eq!(ids, vec!["1", "2"]);
+
+        // Nothing was spilled
+        let mut entries = tokio_fs::read_dir(temp_dir.path()).await.unwrap();
+        assert!(entries.next_entry().await.unwrap().is_none());
+    }
+
+    #[tokio::test]
+    async fn test_external_sorter_spills_and_merges() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let mut sorter = ExternalSorter::with_run_capacity(temp_dir.path(), SortOrder::Descending, 3);
+        let values = [4, 8, 1, 8, 3, 9, 0, 5, 8, 2];
+        for (i, v) in values.iter().enumerate() {
+            sorter
+                .push(Some(json!(v)), format!("doc-{}", i))
+                .await
+                .unwrap();
+        }
+        sorter.push(None, "missing".to_owned()).await.unwrap();
+
+        let ids: Vec<String> = sorter.finish().await.unwrap().try_collect().await.unwrap();
+        assert_eq!(
+            ids,
+            vec!["doc-5", "doc-1", "doc-3", "doc-8", "doc-7", "doc-0", "doc-4", "doc-9", "doc-2", "doc-6", "missing",]
+        );
+
+        // The spill directory is removed once the merge stream is dropped
+        let mut entries = tokio_fs::read_dir(temp_dir.path()).await.unwrap();
+        assert!(entries.next_entry().await.unwrap().is_none());
+    }
+
+    #[tokio::test]
+    async fn test_external_sorter_merges_runs_in_bounded_groups() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let mut sorter = ExternalSorter::with_run_capacity(temp_dir.path(), SortOrder::Ascending, 2).with_fan_in(3);
+        for i in 0 .. 30_i32 {
+            sorter
+                .push(Some(json!(i.rem_euclid(4))), format!("doc-{:02}", i))
+                .await
+                .unwrap();
+        }
+        assert_eq!(sorter.runs.len(), 15);
+
+        // Several merge passes keep equal keys in push order
+        let ids: Vec<String> = sorter.finish().await.unwrap().try_collect().await.unwrap();
+        let mut expected: Vec<_> = (0 .. 30_i32).collect();
+        expected.sort_by_key(|i| i.rem_euclid(4));
+        let expected: Vec<_> = expected.iter().map(|i| format!("doc-{:02}", i)).collect();
+        assert_eq!(ids, expected);
+
+        let mut entries = tokio_fs::read_dir(temp_dir.path()).await.unwrap();
+        assert!(entries.next_entry().await.unwrap().is_none());
+    }
+
+    #[tokio::test]
+    async fn test_external_sorter_seals_spilled_runs() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let cipher = Arc::new(EnvelopeCipher::new(
+            sentinel_crypto::EncryptionAlgorithmChoice::XChaCha20Poly1305,
+            &[3u8; 32],
+        ));
+        let mut sorter =
+            ExternalSorter::with_run_capacity(temp_dir.path(), SortOrder::Ascending, 2).with_cipher(Some(cipher));
+        for i in (0 .. 5).rev() {
+            sorter
+                .push(Some(json!(format!("secret-{}", i))), format!("doc-{}", i))
+                .await
+                .unwrap();
+        }
+
+        // Every spilled run is sealed
+        let spill_dir = sorter.spill_dir.as_ref().unwrap().0.clone();
+        for run in &sorter.runs {
+            let raw = std::fs::read(run).unwrap();
+            assert!(!raw.windows(6).any(|window| window == b"secret"));
+        }
+
+        let ids: Vec<String> = sorter.finish().await.unwrap().try_collect().await.unwrap();
+        assert_eq!(ids, vec!["doc-0", "doc-1", "doc-2", "doc-3", "doc-4"]);
+        assert!(!spill_dir.exists());
+    }
+
+    #[tokio::test]
+    async fn test_external_sorter_preserves_null_and_missing_keys() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let mut sorter = ExternalSorter::with_run_capacity(temp_dir.path(), SortOrder::Ascending, 1);
+        sorter
+            .push(Some(json!(null)), "null".to_owned())
+            .await
+            .unwrap();
+        sorter.push(None, "missing".to_owned()).await.unwrap();
+        sorter.push(Some(json!(1)), "one".to_owned()).await.unwrap();
+
+        let ids: Vec<String> = sorter.finish().await.unwrap().try_collect().await.unwrap();
+        assert_eq!(ids, vec!["missing", "null", "one"]);
+    }
+}
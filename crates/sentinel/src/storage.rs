@@ -0,0 +1,695 @@
+//! Storage I/O backends of document files.
+//!
+//! Collections read and write their document files through the [`StorageBackend`] of their
+//! store, chosen with [`Store::new_with_backend`](crate::Store::new_with_backend):
+//!
+//! - [`BlockingBackend`] (the default) runs the whole sequence of file system calls of an
+//!   operation, such as creating the shard directory, writing the file and encrypting it, in a
+//!   single task on the blocking pool
+//! - [`TokioBackend`] issues each call through `tokio::fs`, which hands every one of them to the
+//!   blocking pool separately
+//!
+//! Each hand-off to the blocking pool costs a few microseconds of scheduling, which dominates the
+//! latency of small documents: a sharded insert takes three of them through `tokio::fs` and two
+//! through [`BlockingBackend`], the existence check preceding the WAL write being the other one.
+//!
+//! Backends work on whole document files, so every backend reads the files written by the others.
+//! Deletes, layout migrations, the document manifest and the collection metadata go through the
+//! same backend.
+
+use std::{
+    collections::HashSet,
+    fs::Metadata,
+    io::{BufRead as _, BufReader, BufWriter, ErrorKind, Read as _, Write as _},
+    path::{Path, PathBuf},
+    sync::{Arc, Mutex},
+};
+
+use async_trait::async_trait;
+use sentinel_crypto::{is_envelope, EnvelopeCipher};
+use tokio::{fs as tokio_fs, io::AsyncWriteExt as _};
+use tracing::{debug, trace};
+
+use crate::{constants::UNSYNCED_FILES_LIMIT, layout::SHARD_LEVELS, Result, SentinelError};
+
+/// File I/O of the document files of a store.
+///
+/// Implementations must not run blocking file system calls or ciphers on the runtime threads.
+#[async_trait]
+pub trait StorageBackend: Send + Sync + std::fmt::Debug {
+    /// Returns whether a file exists at `path`, `false` when it cannot be checked.
+    async fn exists(&self, path: &Path) -> bool;
+
+    /// Returns the metadata of the file at `path`, or `None` when it does not exist.
+    async fn metadata(&self, path: &Path) -> Result<Option<Metadata>>;
+
+    /// Reads the document file at `path`, opening its envelope with `cipher` when it holds one.
+    ///
+    /// Returns the encoded document together with the size of the file, or `None` when the file
+    /// does not exist.
+    async fn read_document(
+        &self,
+        path: &Path,
+        cipher: Option<&Arc<EnvelopeCipher>>,
+    ) -> Result<Option<(Vec<u8>, usize)>>;
+
+    /// Writes the encoded document `bytes` to `path`, inside an envelope when `cipher` is set,
+    /// creating the parent directory first when `create_parent` is set.
+    ///
+    /// Returns the size in bytes of the file written.
+    async fn write_document(
+        &self,
+        path: &Path,
+        bytes: Vec<u8>,
+        cipher: Option<&Arc<EnvelopeCipher>>,
+        create_parent: bool,
+    ) -> Result<u64>;
+
+    /// Appends `bytes` to the file at `path`, creating the file first when `create` is set.
+    async fn append(&self, path: &Path, bytes: Vec<u8>, create: bool) -> Result<()>;
+
+    /// Renames the file at `from` to `to`, replacing any file at `to`, creating the parent
+    /// directory of `to` first when `create_parent` is set.
+    async fn rename(&self, from: &Path, to: &Path, create_parent: bool) -> Result<()>;
+
+    /// Removes the file at `path`, returning whether it existed.
+    async fn remove(&self, path: &Path) -> Result<bool>;
+
+    /// Moves the file at `from` to `to` without replacing a file already at `to`, creating the
+    /// parent directory of `to` first when `create_parent` is set.
+    ///
+    /// A file already at `to` was written after the one at `from`, which is removed as stale.
+    /// Returns whether a file was removed from `from`, `false` when there was none.
+    async fn move_file(&self, from: &Path, to: &Path, create_parent: bool) -> Result<bool>;
+
+    /// Flushes the files and directories at `paths` to disk, skipping those that no longer
+    /// exist.
+    async fn sync(&self, paths: Vec<PathBuf>) -> Result<()>;
+}
+
+/// Backend running the file system calls of each operation in a single blocking task.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct BlockingBackend;
+
+#[async_trait]
+impl StorageBackend for BlockingBackend {
+    async fn exists(&self, path: &Path) -> bool {
+        let path = path.to_path_buf();
+        run_blocking(move || Ok(path.try_exists().unwrap_or(false)))
+            .await
+            .unwrap_or(false)
+    }
+
+    async fn metadata(&self, path: &Path) -> Result<Option<Metadata>> {
+        let path = path.to_path_buf();
+        run_blocking(move || {
+            match std::fs::metadata(&path) {
+                Ok(metadata) => Ok(Some(metadata)),
+                Err(e) if e.kind() == std::io::ErrorKind::NotFound => Ok(None),
+                Err(e) => Err(e.into()),
+            }
+        })
+        .await
+    }
+
+    async fn read_document(
+        &self,
+        path: &Path,
+        cipher: Option<&Arc<EnvelopeCipher>>,
+    ) -> Result<Option<(Vec<u8>, usize)>> {
+        let path = path.to_path_buf();
+        let cipher = cipher.cloned();
+        run_blocking(move || read_document_file(&path, cipher.as_deref())).await
+    }
+
+    async fn write_document(
+        &self,
+        path: &Path,
+        bytes: Vec<u8>,
+        cipher: Option<&Arc<EnvelopeCipher>>,
+        create_parent: bool,
+    ) -> Result<u64> {
+        let path = path.to_path_buf();
+        let cipher = cipher.cloned();
+        run_blocking(move || {
+            if create_parent && let Some(parent) = path.parent() {
+                std::fs::create_dir_all(parent)?;
+            }
+            write_document_file(&path, &bytes, cipher.as_deref())
+        })
+        .await
+    }
+
+    async fn append(&self, path: &Path, bytes: Vec<u8>, create: bool) -> Result<()> {
+        let path = path.to_path_buf();
+        run_blocking(move || {
+            let mut file = std::fs::OpenOptions::new()
+                .create(create)
+                .append(true)
+                .open(&path)?;
+            file.write_all(&bytes)?;
+            Ok(())
+        })
+        .await
+    }
+
+    async fn rename(&self, from: &Path, to: &Path, create_parent: bool) -> Result<()> {
+        let from = from.to_path_buf();
+        let to = to.to_path_buf();
+        run_blocking(move || {
+            if create_parent && let Some(parent) = to.parent() {
+                std::fs::create_dir_all(parent)?;
+            }
+            std::fs::rename(&from, &to)?;
+            Ok(())
+        })
+        .await
+    }
+
+    async fn remove(&self, path: &Path) -> Result<bool> {
+        let path = path.to_path_buf();
+        run_blocking(move || found(std::fs::remove_file(&path))).await
+    }
+
+    async fn move_file(&self, from: &Path, to: &Path, create_parent: bool) -> Result<bool> {
+        let from = from.to_path_buf();
+        let to = to.to_path_buf();
+        run_blocking(move || {
+            if create_parent && let Some(parent) = to.parent() {
+                std::fs::create_dir_all(parent)?;
+            }
+            match std::fs::hard_link(&from, &to) {
+                Ok(()) => {},
+                Err(e) if e.kind() == ErrorKind::NotFound => return Ok(false),
+                Err(e) if e.kind() == ErrorKind::AlreadyExists => {},
+                Err(e) => {
+                    debug!(
+                        "Hard link of {:?} failed ({}), renaming it instead",
+                        from, e
+                    );
+                    if to.try_exists()? {
+                        return found(std::fs::remove_file(&from));
+                    }
+                    return found(std::fs::rename(&from, &to));
+                },
+            }
+            found(std::fs::remove_file(&from))
+        })
+        .await
+    }
+
+    async fn sync(&self, paths: Vec<PathBuf>) -> Result<()> {
+        run_blocking(move || {
+            for path in &paths {
+                match std::fs::File::open(path) {
+                    Ok(file) => file.sync_all()?,
+                    Err(e) if skips_sync(&e) => {},
+                    Err(e) => return Err(e.into()),
+                }
+            }
+            Ok(())
+        })
+        .await
+    }
+}
+
+/// Backend issuing each file system call through `tokio::fs`.
+///
+/// Encrypted files are still sealed and opened in a single blocking task, so the cipher never
+/// runs on the runtime threads.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct TokioBackend;
+
+#[async_trait]
+impl StorageBackend for TokioBackend {
+    async fn exists(&self, path: &Path) -> bool { tokio_fs::try_exists(path).await.unwrap_or(false) }
+
+    async fn metadata(&self, path: &Path) -> Result<Option<Metadata>> {
+        match tokio_fs::metadata(path).await {
+            Ok(metadata) => Ok(Some(metadata)),
+            Err(e) if e.kind() == std::io::ErrorKind::NotFound => Ok(None),
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    async fn read_document(
+        &self,
+        path: &Path,
+        cipher: Option<&Arc<EnvelopeCipher>>,
+    ) -> Result<Option<(Vec<u8>, usize)>> {
+        if let Some(cipher) = cipher {
+            let path = path.to_path_buf();
+            let cipher = cipher.clone();
+            return run_blocking(move || read_document_file(&path, Some(&cipher))).await;
+        }
+        match tokio_fs::read(path).await {
+            Ok(content) if is_envelope(&content) => Err(encrypted_without_key(path)),
+            Ok(content) => {
+                let len = content.len();
+                Ok(Some((content, len)))
+            },
+            Err(e) if e.kind() == std::io::ErrorKind::NotFound => Ok(None),
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    async fn write_document(
+        &self,
+        path: &Path,
+        bytes: Vec<u8>,
+        cipher: Option<&Arc<EnvelopeCipher>>,
+        create_parent: bool,
+    ) -> Result<u64> {
+        if create_parent && let Some(parent) = path.parent() {
+            tokio_fs::create_dir_all(parent).await?;
+        }
+        if let Some(cipher) = cipher {
+            let path = path.to_path_buf();
+            let cipher = cipher.clone();
+            return run_blocking(move || write_document_file(&path, &bytes, Some(&cipher))).await;
+        }
+        tokio_fs::write(path, &bytes).await?;
+        Ok(bytes.len() as u64)
+    }
+
+    async fn append(&self, path: &Path, bytes: Vec<u8>, create: bool) -> Result<()> {
+        let mut file = tokio_fs::OpenOptions::new()
+            .create(create)
+            .append(true)
+            .open(path)
+            .await?;
+        file.write_all(&bytes).await?;
+        file.flush().await?;
+        Ok(())
+    }
+
+    async fn rename(&self, from: &Path, to: &Path, create_parent: bool) -> Result<()> {
+        if create_parent && let Some(parent) = to.parent() {
+            tokio_fs::create_dir_all(parent).await?;
+        }
+        tokio_fs::rename(from, to).await?;
+        Ok(())
+    }
+
+    async fn remove(&self, path: &Path) -> Result<bool> { found(tokio_fs::remove_file(path).await) }
+
+    async fn move_file(&self, from: &Path, to: &Path, create_parent: bool) -> Result<bool> {
+        if create_parent && let Some(parent) = to.parent() {
+            tokio_fs::create_dir_all(parent).await?;
+        }
+        match tokio_fs::hard_link(from, to).await {
+            Ok(()) => {},
+            Err(e) if e.kind() == ErrorKind::NotFound => return Ok(false),
+            Err(e) if e.kind() == ErrorKind::AlreadyExists => {},
+            Err(e) => {
+                debug!(
+                    "Hard link of {:?} failed ({}), renaming it instead",
+                    from, e
+                );
+                if tokio_fs::try_exists(to).await? {
+                    return found(tokio_fs::remove_file(from).await);
+                }
+                return found(tokio_fs::rename(from, to).await);
+            },
+        }
+        found(tokio_fs::remove_file(from).await)
+    }
+
+    async fn sync(&self, paths: Vec<PathBuf>) -> Result<()> {
+        for path in &paths {
+            match tokio_fs::File::open(path).await {
+                Ok(file) => file.sync_all().await?,
+                Err(e) if skips_sync(&e) => {},
+                Err(e) => return Err(e.into()),
+            }
+        }
+        Ok(())
+    }
+}
+
+/// The document files of one collection: its storage backend, and its cipher when the collection
+/// is encrypted.
+#[derive(Debug, Clone)]
+pub struct DocumentFiles {
+    /// Backend performing the file I/O.
+    backend:  Arc<dyn StorageBackend>,
+    /// Cipher sealing the files of an encrypted collection.
+    cipher:   Option<Arc<EnvelopeCipher>>,
+    /// Files and directories changed since they were last synced to disk.
+    unsynced: Arc<Mutex<UnsyncedFiles>>,
+}
+
+/// Document files and directories changed since they were last synced to disk.
+///
+/// A WAL checkpoint lets recovery skip the changes it covers, so the files holding them are
+/// synced first.
+#[derive(Debug, Default)]
+pub struct UnsyncedFiles {
+    /// Whether files changed before the tracking started may not be on disk yet, in which case
+    /// every document file must be synced.
+    pub all:   bool,
+    /// The changed files and the directories whose entries changed.
+    pub paths: HashSet<PathBuf>,
+}
+
+impl DocumentFiles {
+    /// Creates the document files of a collection stored through `backend`, encrypted with
+    /// `cipher` when one is given.
+    pub fn new(backend: Arc<dyn StorageBackend>, cipher: Option<Arc<EnvelopeCipher>>) -> Self {
+        Self {
+            backend,
+            cipher,
+            unsynced: Arc::default(),
+        }
+    }
+
+    /// Returns whether the files are encrypted.
+    pub const fn is_encrypted(&self) -> bool { self.cipher.is_some() }
+
+    /// Returns the cipher sealing the files of an encrypted collection.
+    pub const fn cipher(&self) -> Option<&Arc<EnvelopeCipher>> { self.cipher.as_ref() }
+
+    /// Returns whether a file exists at `path`.
+    pub async fn exists(&self, path: &Path) -> bool { self.backend.exists(path).await }
+
+    /// Returns the metadata of the file at `path`, or `None` when it does not exist.
+    pub async fn metadata(&self, path: &Path) -> Result<Option<Metadata>> { self.backend.metadata(path).await }
+
+    /// Reads the document file at `path`, see [`StorageBackend::read_document`].
+    pub async fn read(&self, path: &Path) -> Result<Option<(Vec<u8>, usize)>> {
+        self.backend.read_document(path, self.cipher.as_ref()).await
+    }
+
+    /// Writes the document file at `path`, see [`StorageBackend::write_document`].
+    pub async fn write(&self, path: &Path, bytes: Vec<u8>, create_parent: bool) -> Result<u64> {
+        let written = self
+            .backend
+            .write_document(path, bytes, self.cipher.as_ref(), create_parent)
+            .await;
+        self.changed(Some(path), &[(path, create_parent)]).await?;
+        written
+    }
+
+    /// Replaces the file at `path` with the unencrypted `bytes`.
+    ///
+    /// The bytes are written and synced to a temporary file next to it, which is then renamed
+    /// over it, so a crash leaves either the previous content or the new one, never a torn file.
+    pub async fn replace(&self, path: &Path, bytes: Vec<u8>) -> Result<()> {
+        let mut tmp_path = path.as_os_str().to_owned();
+        tmp_path.push(".tmp");
+        let tmp_path = PathBuf::from(tmp_path);
+        self.backend
+            .write_document(&tmp_path, bytes, None, false)
+            .await?;
+        self.backend.sync(vec![tmp_path.clone()]).await?;
+        let renamed = self.backend.rename(&tmp_path, path, false).await;
+        self.changed(None, &[(path, false)]).await?;
+        renamed
+    }
+
+    /// Renames the document file at `from`, see [`StorageBackend::rename`].
+    pub async fn rename(&self, from: &Path, to: &Path, create_parent: bool) -> Result<()> {
+        let renamed = self.backend.rename(from, to, create_parent).await;
+        self.changed(None, &[(from, false), (to, create_parent)])
+            .await?;
+        renamed
+    }
+
+    /// Removes the document file at `path`, see [`StorageBackend::remove`].
+    pub async fn remove(&self, path: &Path) -> Result<bool> {
+        let removed = self.backend.remove(path).await;
+        self.changed(None, &[(path, false)]).await?;
+        removed
+    }
+
+    /// Moves the document file at `from`, see [`StorageBackend::move_file`].
+    pub async fn move_file(&self, from: &Path, to: &Path, create_parent: bool) -> Result<bool> {
+        let moved = self.backend.move_file(from, to, create_parent).await;
+        // The file may not have been synced under its old name
+        self.changed(Some(to), &[(from, false), (to, create_parent)])
+            .await?;
+        moved
+    }
+
+    /// Flushes the files and directories at `paths` to disk, see [`StorageBackend::sync`].
+    pub async fn sync(&self, paths: Vec<PathBuf>) -> Result<()> { self.backend.sync(paths).await }
+
+    /// Flags every document file as possibly not synced, for files changed before the tracking
+    /// started.
+    pub fn mark_all_unsynced(&self) { self.unsynced.lock().unwrap().all = true; }
+
+    /// Takes the files and directories changed since the last call, which the caller syncs or
+    /// hands back with [`Self::restore_unsynced`].
+    pub fn take_unsynced(&self) -> UnsyncedFiles { std::mem::take(&mut *self.unsynced.lock().unwrap()) }
+
+    /// Hands back files taken with [`Self::take_unsynced`] that could not be synced.
+    pub fn restore_unsynced(&self, unsynced: UnsyncedFiles) {
+        let mut current = self.unsynced.lock().unwrap();
+        current.all |= unsynced.all;
+        current.paths.extend(unsynced.paths);
+    }
+
+    /// Records a changed `file` and the directories holding the entries of `entries`, each with
+    /// whether its shard directories may have been created, syncing them right away once too
+    /// many have accumulated.
+    async fn changed(&self, file: Option<&Path>, entries: &[(&Path, bool)]) -> Result<()> {
+        let full = {
+            let mut unsynced = self.unsynced.lock().unwrap();
+            unsynced.paths.extend(file.map(Path::to_path_buf));
+            for &(path, created_dirs) in entries {
+                let levels = if created_dirs {
+                    SHARD_LEVELS.saturating_add(1)
+                }
+                else {
+                    1
+                };
+                unsynced
+                    .paths
+                    .extend(path.ancestors().skip(1).take(levels).map(Path::to_path_buf));
+            }
+            (unsynced.paths.len() >= UNSYNCED_FILES_LIMIT).then(|| std::mem::take(&mut unsynced.paths))
+        };
+        let Some(paths) = full
+        else {
+            return Ok(());
+        };
+        trace!("Syncing {} changed document files early", paths.len());
+        let synced = self.sync(paths.iter().cloned().collect()).await;
+        if synced.is_err() {
+            self.restore_unsynced(UnsyncedFiles {
+                all: false,
+                paths,
+            });
+        }
+        synced
+    }
+
+    /// Returns the backend performing the file I/O.
+    pub fn backend(&self) -> &Arc<dyn StorageBackend> { &self.backend }
+}
+
+/// Maps the outcome of removing or renaming a file to whether the file existed.
+fn found(outcome: std::io::Result<()>) -> Result<bool> {
+    match outcome {
+        Ok(()) => Ok(true),
+        Err(e) if e.kind() == ErrorKind::NotFound => Ok(false),
+        Err(e) => Err(e.into()),
+    }
+}
+
+/// Returns whether a path failing to open with `error` is left out of a sync: it no longer
+/// exists, or it is a directory on a platform that cannot open directories as files.
+fn skips_sync(error: &std::io::Error) -> bool {
+    error.kind() == ErrorKind::NotFound || (cfg!(windows) && error.kind() == ErrorKind::PermissionDenied)
+}
+
+/// Writes the encoded document `bytes` to `path`, inside an envelope when `cipher` is set.
+///
+/// Blocks the calling thread.
+fn write_document_file(path: &Path, bytes: &[u8], cipher: Option<&EnvelopeCipher>) -> Result<u64> {
+    let Some(cipher) = cipher
+    else {
+        std::fs::write(path, bytes)?;
+        return Ok(bytes.len() as u64);
+    };
+    let mut writer = BufWriter::new(std::fs::File::create(path)?);
+    let written = cipher.seal_to(bytes, &mut writer)?;
+    writer.flush()?;
+    Ok(written)
+}
+
+/// Reads the encoded document stored at `path`, opening its envelope with `cipher`.
+///
+/// Files without an envelope were written before the collection was encrypted and are returned
+/// as they are. Blocks the calling thread.
+fn read_document_file(path: &Path, cipher: Option<&EnvelopeCipher>) -> Result<Option<(Vec<u8>, usize)>> {
+    let file = match std::fs::File::open(path) {
+        Ok(file) => file,
+        Err(e) if e.kind() == std::io::ErrorKind::NotFound => return Ok(None),
+        Err(e) => return Err(e.into()),
+    };
+    let len = usize::try_from(file.metadata()?.len()).unwrap_or(usize::MAX);
+    let mut reader = BufReader::new(file);
+    if is_envelope(reader.fill_buf()?) {
+        let cipher = cipher.ok_or_else(|| encrypted_without_key(path))?;
+        return Ok(Some((cipher.open_from(reader)?, len)));
+    }
+    let mut content = Vec::with_capacity(len);
+    reader.read_to_end(&mut content)?;
+    Ok(Some((content, len)))
+}
+
+/// Error returned for an envelope read by a collection that has no cipher.
+fn encrypted_without_key(path: &Path) -> SentinelError {
+    SentinelError::ConfigError {
+        message: format!(
+            "document file {:?} is encrypted, open the store with its passphrase to read it",
+            path
+        ),
+    }
+}
+
+/// Runs `task` on the blocking pool.
+async fn run_blocking<T, F>(task: F) -> Result<T>
+where
+    T: Send + 'static,
+    F: FnOnce() -> Result<T> + Send + 'static,
+{
+    tokio::task::spawn_blocking(task).await.map_err(|e| {
+        SentinelError::Internal {
+            message: format!("Storage I/O task failed: {}", e),
+        }
+    })?
+}
+
+#[cfg(test)]
+mod tests {
+    use tempfile::tempdir;
+
+    use super::*;
+
+    /// Every backend, so each test runs against all of them
+    fn backends() -> [Arc<dyn StorageBackend>; 2] { [Arc::new(BlockingBackend), Arc::new(TokioBackend)] }
+
+    #[tokio::test]
+    async fn test_backends_write_and_read_documents() {
+        for backend in backends() {
+            let dir = tempdir().unwrap();
+            let files = DocumentFiles::new(backend.clone(), None);
+            let path = dir.path().join("ab").join("cd").join("doc.json");
+            let document = br#"{"id":"doc","data":{"name":"value"}}"#.to_vec();
+
+            assert!(!files.exists(&path).await);
+            assert!(files.metadata(&path).await.unwrap().is_none());
+            assert!(files.read(&path).await.unwrap().is_none());
+            assert!(files.write(&path, document.clone(), false).await.is_err());
+
+            let size = files.write(&path, document.clone(), true).await.unwrap();
+            assert_eq!(size, document.len() as u64);
+            assert!(files.exists(&path).await);
+            assert_eq!(files.metadata(&path).await.unwrap().unwrap().len(), size);
+            assert_eq!(
+                files.read(&path).await.unwrap(),
+                Some((document.clone(), document.len()))
+            );
+        }
+    }
+
+    #[tokio::test]
+    async fn test_backends_move_rename_and_remove_files() {
+        for backend in backends() {
+            let dir = tempdir().unwrap();
+            let files = DocumentFiles::new(backend.clone(), None);
+            let flat = dir.path().join("doc.json");
+            let sharded = dir.path().join("ab").join("cd").join("doc.json");
+            files.write(&flat, b"old".to_vec(), false).await.unwrap();
+
+            // Moving creates the target directories and never replaces a newer file
+            assert!(files.move_file(&flat, &sharded, true).await.unwrap());
+            assert!(!files.exists(&flat).await);
+            assert!(!files.move_file(&flat, &sharded, true).await.unwrap());
+            files.write(&flat, b"stale".to_vec(), false).await.unwrap();
+            assert!(files.move_file(&flat, &sharded, true).await.unwrap());
+            assert!(!files.exists(&flat).await);
+            assert_eq!(std::fs::read(&sharded).unwrap(), b"old");
+
+            let deleted = dir.path().join(".deleted").join("doc.json");
+            files.rename(&sharded, &deleted, true).await.unwrap();
+            assert!(!files.exists(&sharded).await);
+            assert!(files.remove(&deleted).await.unwrap());
+            assert!(!files.remove(&deleted).await.unwrap());
+
+            let log = dir.path().join("log.jsonl");
+            assert!(backend.append(&log, b"a".to_vec(), false).await.is_err());
+            backend.append(&log, b"a".to_vec(), true).await.unwrap();
+            backend.append(&log, b"b".to_vec(), false).await.unwrap();
+            assert_eq!(std::fs::read(&log).unwrap(), b"ab");
+
+            // Every changed file and directory is tracked, and those removed since are skipped
+            let unsynced = files.take_unsynced();
+            assert!(!unsynced.all);
+            for path in [&sharded, &deleted, &flat] {
+                assert!(unsynced.paths.contains(path.parent().unwrap()));
+            }
+            assert!(unsynced.paths.contains(&dir.path().join("ab")));
+            files
+                .sync(unsynced.paths.into_iter().collect())
+                .await
+                .unwrap();
+            assert!(files.take_unsynced().paths.is_empty());
+        }
+    }
+
+    #[tokio::test]
+    async fn test_backends_encrypt_documents() {
+        let cipher = Arc::new(EnvelopeCipher::new(
+            sentinel_crypto::EncryptionAlgorithmChoice::XChaCha20Poly1305,
+            &[5u8; 32],
+        ));
+        for backend in backends() {
+            let dir = tempdir().unwrap();
+            let files = DocumentFiles::new(backend.clone(), Some(cipher.clone()));
+            let plain = DocumentFiles::new(backend.clone(), None);
+            assert!(files.is_encrypted());
+            let path = dir.path().join("doc.json");
+            let document = br#"{"id":"doc","data":{"secret":"value"}}"#.to_vec();
+
+            let size = files.write(&path, document.clone(), false).await.unwrap();
+            let on_disk = std::fs::read(&path).unwrap();
+            assert_eq!(on_disk.len() as u64, size);
+            assert!(is_envelope(&on_disk));
+            assert!(!on_disk.windows(6).any(|window| window == b"secret"));
+
+            let (read, len) = files.read(&path).await.unwrap().unwrap();
+            assert_eq!(read, document);
+            assert_eq!(len as u64, size);
+            assert!(plain.read(&path).await.is_err());
+
+            // Files written before the collection was encrypted are read as they are
+            plain.write(&path, document.clone(), false).await.unwrap();
+            let (read, _) = files.read(&path).await.unwrap().unwrap();
+            assert_eq!(read, document);
+        }
+    }
+
+    #[tokio::test]
+    async fn test_backends_replace_files() {
+        let cipher = Arc::new(EnvelopeCipher::new(
+            sentinel_crypto::EncryptionAlgorithmChoice::XChaCha20Poly1305,
+            &[5u8; 32],
+        ));
+        for backend in backends() {
+            let dir = tempdir().unwrap();
+            let files = DocumentFiles::new(backend.clone(), Some(cipher.clone()));
+            let path = dir.path().join(".metadata.json");
+            std::fs::write(&path, b"old").unwrap();
+            files.take_unsynced();
+
+            files.replace(&path, b"new".to_vec()).await.unwrap();
+            // Replaced files are never sealed, whatever the cipher
+            assert_eq!(std::fs::read(&path).unwrap(), b"new");
+            assert!(!dir.path().join(".metadata.json.tmp").exists());
+            assert!(files.take_unsynced().paths.contains(dir.path()));
+        }
+    }
+}
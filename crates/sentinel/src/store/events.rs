@@ -1,6 +1,12 @@
 use tracing::{debug, error, trace, warn};
 
-use crate::{events::StoreEvent, StoreMetadata, META_SENTINEL_VERSION, STORE_METADATA_FILE};
+use crate::{
+    events::{apply_delta, StoreEvent},
+    StoreMetadata,
+    COLLECTION_IDLE_TIMEOUT,
+    META_SENTINEL_VERSION,
+    STORE_METADATA_FILE,
+};
 use super::stor::Store;
 
 /// Starts the background event processing task.
@@ -27,6 +33,7 @@ pub fn start_event_processor(store: &mut Store) {
     let stored_wal_config = store.stored_wal_config.clone();
     let root_path = store.root_path.clone();
     let created_at = store.created_at;
+    let collections = store.collections.clone();
 
     let task = tokio::spawn(async move {
         // Debouncing: save metadata every 500 milliseconds instead of after every event
@@ -48,28 +55,15 @@ pub fn start_event_processor(store: &mut Store) {
                         Some(StoreEvent::CollectionDeleted { name, document_count, total_size_bytes: event_size }) => {
                             debug!("Processing collection deleted event: {} (docs: {}, size: {})",
                                   name, document_count, event_size);
-                            collection_count.fetch_sub(1, std::sync::atomic::Ordering::Relaxed);
-                            total_documents.fetch_sub(document_count, std::sync::atomic::Ordering::Relaxed);
-                            total_size_bytes.fetch_sub(event_size, std::sync::atomic::Ordering::Relaxed);
+                            apply_delta(&collection_count, -1);
+                            apply_delta(&total_documents, (document_count as i64).saturating_neg());
+                            apply_delta(&total_size_bytes, (event_size as i64).saturating_neg());
                             changed = true;
                         }
-                        Some(StoreEvent::DocumentInserted { collection, size_bytes }) => {
-                            debug!("Processing document inserted event: {} (size: {})", collection, size_bytes);
-                            total_documents.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
-                            total_size_bytes.fetch_add(size_bytes, std::sync::atomic::Ordering::Relaxed);
-                            changed = true;
-                        }
-                        Some(StoreEvent::DocumentUpdated { collection, old_size_bytes, new_size_bytes }) => {
-                            debug!("Processing document updated event: {} (old: {}, new: {})",
-                                  collection, old_size_bytes, new_size_bytes);
-                            total_size_bytes.fetch_sub(old_size_bytes, std::sync::atomic::Ordering::Relaxed);
-                            total_size_bytes.fetch_add(new_size_bytes, std::sync::atomic::Ordering::Relaxed);
-                            changed = true;
-                        }
-                        Some(StoreEvent::DocumentDeleted { collection, size_bytes }) => {
-                            debug!("Processing document deleted event: {} (size: {})", collection, size_bytes);
-                            total_documents.fetch_sub(1, std::sync::atomic::Ordering::Relaxed);
-                            total_size_bytes.fetch_sub(size_bytes, std::sync::atomic::Ordering::Relaxed);
+                        Some(StoreEvent::StatsChanged { collection, document_delta, size_delta }) => {
+                            trace!("Processing stats changed event: {} (docs: {}, size: {})", collection, document_delta, size_delta);
+                            apply_delta(&total_documents, document_delta);
+                            apply_delta(&total_size_bytes, size_delta);
                             changed = true;
                         }
                         None => {
@@ -81,6 +75,11 @@ pub fn start_event_processor(store: &mut Store) {
 
                 // Periodic metadata save
                 _ = save_interval.tick() => {
+                    let evicted = collections.evict_idle(COLLECTION_IDLE_TIMEOUT);
+                    if evicted > 0 {
+                        debug!("Closed {} idle collections", evicted);
+                    }
+
                     if changed {
                         let metadata = StoreMetadata {
                             version: META_SENTINEL_VERSION,
@@ -2,6 +2,8 @@
 pub mod events;
 /// Store operations.
 pub mod operations;
+/// Registry of the collections open in a store.
+pub mod registry;
 /// Store implementation.
 pub mod stor;
 /// Store tests.
@@ -1,20 +1,26 @@
 use std::sync::Arc;
 
 use tokio::fs as tokio_fs;
-use tracing::{debug, error, trace};
+use tracing::{debug, error, trace, warn};
 use sentinel_wal::WalManager;
 
 use crate::{
+    encryption::WalPayloadCipher,
     events::StoreEvent,
+    index::IndexSet,
+    layout::LayoutState,
+    manifest::DocumentManifest,
+    storage::DocumentFiles,
     Collection,
     CollectionMetadata,
     Result,
+    SentinelError,
     COLLECTION_METADATA_FILE,
     DATA_DIR,
     WAL_DIR,
     WAL_FILE,
 };
-use super::{stor::Store, validation::validate_collection_name};
+use super::{registry::Removal, stor::Store, validation::validate_collection_name};
 
 /// Retrieves or creates a collection with the specified name and custom WAL configuration
 /// overrides.
@@ -24,9 +30,122 @@ pub async fn collection_with_config(
     store: &Store,
     name: &str,
     wal_overrides: Option<sentinel_wal::CollectionWalConfigOverrides>,
-) -> Result<Collection> {
+) -> Result<Arc<Collection>> {
+    access_collection(store, name, wal_overrides, false).await
+}
+
+/// Retrieves or creates a collection, encrypting it at rest from now on when `encrypt` is set.
+async fn access_collection(
+    store: &Store,
+    name: &str,
+    wal_overrides: Option<sentinel_wal::CollectionWalConfigOverrides>,
+    encrypt: bool,
+) -> Result<Arc<Collection>> {
     trace!("Accessing collection: {} with custom WAL config", name);
     validate_collection_name(name)?;
+    if let Some(collection) = shared_collection(store, name, wal_overrides.as_ref(), encrypt, false).await? {
+        return Ok(collection);
+    }
+
+    let _opening = store.collections.lock_opening().await;
+    // Another caller may have opened the collection while this one waited
+    if let Some(collection) = shared_collection(store, name, wal_overrides.as_ref(), encrypt, true).await? {
+        return Ok(collection);
+    }
+    let collection = Arc::new(open_collection(store, name, wal_overrides, encrypt).await?);
+    store.collections.insert(name, collection.clone());
+    Ok(collection)
+}
+
+/// Returns the open handle of a collection if it can serve a caller asking for `wal_overrides`,
+/// and for encryption when `encrypt` is set.
+///
+/// A caller without overrides accepts any open handle that is encrypted if it asks for
+/// encryption. Otherwise the handle must already run the configuration the overrides produce; a
+/// handle that does not is closed and `None` is returned so the collection is reopened, unless
+/// another caller still holds it. Handles are only closed when `reopen` is set, by callers
+/// holding the opening lock so no other caller opens the collection before it is closed.
+async fn shared_collection(
+    store: &Store,
+    name: &str,
+    wal_overrides: Option<&sentinel_wal::CollectionWalConfigOverrides>,
+    encrypt: bool,
+    reopen: bool,
+) -> Result<Option<Arc<Collection>>> {
+    let Some(collection) = store.collections.get(name)
+    else {
+        return Ok(None);
+    };
+    *store.last_accessed_at.write().unwrap() = chrono::Utc::now();
+    let encryption_matches = !encrypt || collection.is_encrypted();
+    let Some(overrides) = wal_overrides
+    else {
+        if encryption_matches {
+            return Ok(Some(collection));
+        }
+        drop(collection);
+        return reopen_unused(store, name, "unencrypted", reopen).await;
+    };
+
+    let requested = collection.stored_wal_config.apply_overrides(overrides);
+    let persisted = !overrides.persist_overrides || requested == collection.stored_wal_config;
+    let effective = effective_wal_config(requested, collection.is_encrypted());
+    if effective == collection.wal_config && persisted && encryption_matches {
+        return Ok(Some(collection));
+    }
+    drop(collection);
+    reopen_unused(store, name, "with a different WAL configuration", reopen).await
+}
+
+/// Closes the idle handle of a collection so it is reopened, returning `None`, or a
+/// `ConfigError` naming `open_as` when a caller still holds the handle.
+///
+/// The handle is closed before returning, so its statistics are on disk when the collection is
+/// opened again. Without `reopen` the handle is left open and `None` is returned, for the caller
+/// to retry once it holds the opening lock.
+async fn reopen_unused(store: &Store, name: &str, open_as: &str, reopen: bool) -> Result<Option<Arc<Collection>>> {
+    if !reopen {
+        return Ok(None);
+    }
+    match store.collections.remove_if_unused(name) {
+        Removal::Removed(collection) => {
+            debug!("Reopening collection {}, open {}", name, open_as);
+            collection.close().await;
+            Ok(None)
+        },
+        Removal::NotOpen => Ok(None),
+        Removal::InUse => {
+            Err(SentinelError::ConfigError {
+                message: format!("collection '{}' is already open {}", name, open_as),
+            })
+        },
+    }
+}
+
+/// Returns the WAL configuration a collection runs with for `config`.
+///
+/// The WAL of an encrypted collection is always written in the `BinaryV2` format, the only one
+/// whose entries can be encrypted.
+fn effective_wal_config(
+    mut config: sentinel_wal::CollectionWalConfig,
+    encrypted: bool,
+) -> sentinel_wal::CollectionWalConfig {
+    if encrypted {
+        config.format = sentinel_wal::WalFormat::BinaryV2;
+    }
+    config
+}
+
+/// Opens a collection from its directory, creating the directory and metadata if needed.
+///
+/// When `encrypt` is set the collection is marked as encrypted in its metadata, and stays
+/// encrypted from then on.
+async fn open_collection(
+    store: &Store,
+    name: &str,
+    wal_overrides: Option<sentinel_wal::CollectionWalConfigOverrides>,
+    encrypt: bool,
+) -> Result<Collection> {
     let path = store.root_path.join(DATA_DIR).join(name);
     tokio_fs::create_dir_all(&path).await.map_err(|e| {
         error!("Failed to create collection directory {:?}: {}", path, e);
@@ -40,6 +159,7 @@ pub async fn collection_with_config(
     let metadata = if is_new_collection {
         debug!("Creating new collection metadata for {}", name);
         let mut metadata = CollectionMetadata::new(name.to_owned());
+        metadata.encrypted = encrypt;
         // For new collections, if overrides are provided, create a config with overrides applied to
         // defaults
         if let Some(overrides) = wal_overrides.as_ref() {
@@ -60,6 +180,8 @@ pub async fn collection_with_config(
         debug!("Loading existing collection metadata for {}", name);
         let content = tokio_fs::read_to_string(&metadata_path).await?;
         let mut metadata: CollectionMetadata = serde_json::from_str(&content)?;
+        let mut changed = encrypt && !metadata.encrypted;
+        metadata.encrypted |= encrypt;
         // For existing collections, conditionally update metadata if persist_overrides is true
         if let Some(overrides) = wal_overrides.as_ref() &&
             overrides.persist_overrides
@@ -74,19 +196,40 @@ pub async fn collection_with_config(
             });
             let merged_config = base_config.apply_overrides(overrides);
             metadata.wal_config = Some(merged_config);
+            changed = true;
+        }
+        if changed {
             let content = serde_json::to_string_pretty(&metadata)?;
             tokio_fs::write(&metadata_path, content).await?;
         }
         metadata
     };
 
+    let cipher = if metadata.encrypted {
+        let data_cipher = store.data_cipher.as_ref().ok_or_else(|| {
+            SentinelError::ConfigError {
+                message: format!(
+                    "collection '{}' is encrypted, open the store with its passphrase to access it",
+                    name
+                ),
+            }
+        })?;
+        // Derived once per opening and shared by every caller of the handle
+        Some(Arc::new(data_cipher.derive(name)))
+    }
+    else {
+        None
+    };
+
     // If this is a new collection, emit event (metadata will be saved by event handler)
     if is_new_collection {
         // Emit collection created event
         let event = StoreEvent::CollectionCreated {
             name: name.to_owned(),
         };
-        let _ = store.event_sender.send(event).ok();
+        if store.event_sender.send(event).await.is_err() {
+            warn!("Failed to send CollectionCreated event for {}", name);
+        }
     }
 
     // Get collection WAL config: use metadata's config, or provided config, or fall back to
@@ -106,12 +249,31 @@ pub async fn collection_with_config(
     if let Some(overrides) = wal_overrides {
         collection_wal_config = collection_wal_config.apply_overrides(&overrides);
     }
+    let collection_wal_config = effective_wal_config(collection_wal_config, cipher.is_some());
 
     // Create WAL manager with collection config
     let wal_path = path.join(WAL_DIR).join(WAL_FILE);
-    let wal_manager = Some(Arc::new(
-        WalManager::new(wal_path, collection_wal_config.clone().into()).await?,
-    ));
+    let mut wal_manager = WalManager::new_with_metrics(
+        wal_path,
+        collection_wal_config.clone().into(),
+        store.metrics.wal().clone(),
+    )
+    .await?;
+    if let Some(cipher) = cipher.as_ref() {
+        wal_manager = wal_manager.with_cipher(Arc::new(WalPayloadCipher(cipher.clone())))?;
+    }
+    // Files written since the last checkpoint may not have been synced before the collection
+    // was last closed
+    let files = DocumentFiles::new(store.storage.clone(), cipher);
+    if wal_manager.checkpoint_lsn().await < wal_manager.last_lsn() {
+        files.mark_all_unsynced();
+    }
+    let wal_manager = Some(Arc::new(wal_manager));
+
+    // Load the secondary indexes declared in the metadata
+    let (indexes, indexes_stale) = IndexSet::load(&path, &metadata.indexes, &files).await;
+    let manifest = Arc::new(DocumentManifest::load(&path, store.storage.clone()).await);
+    manifest.set_nested(metadata.layout.is_nested() || metadata.layout_migration.is_some());
 
     trace!("Collection '{}' accessed successfully", name);
     let now = chrono::Utc::now();
@@ -131,10 +293,32 @@ pub async fn collection_with_config(
         total_documents: std::sync::Arc::new(std::sync::atomic::AtomicU64::new(metadata.document_count)),
         total_size_bytes: std::sync::Arc::new(std::sync::atomic::AtomicU64::new(metadata.total_size_bytes)),
         event_sender: Some(store.event_sender.clone()),
+        pending_stats: Arc::default(),
+        metadata_dirty: Arc::default(),
+        document_encoding: std::sync::RwLock::new(metadata.document_encoding),
+        layout: std::sync::RwLock::new(LayoutState {
+            current:  metadata.layout,
+            previous: metadata.layout_migration,
+        }),
+        metadata: Arc::new(tokio::sync::Mutex::new(metadata)),
         event_task: None,
         recovery_mode: std::sync::atomic::AtomicBool::new(false),
+        indexes: Arc::new(std::sync::RwLock::new(indexes)),
+        cache: std::sync::OnceLock::new(),
+        manifest,
+        metrics: store.metrics.clone(),
+        files,
+        locks: Arc::default(),
     };
     collection.start_event_processor();
+
+    if indexes_stale {
+        debug!(
+            "Persisted indexes of collection {} are stale, rebuilding",
+            name
+        );
+        collection.rebuild_indexes().await?;
+    }
     Ok(collection)
 }
 
@@ -157,8 +341,8 @@ impl Store {
     ///
     /// # Returns
     ///
-    /// * `Result<Collection>` - Returns a `Collection` instance on success, or a `SentinelError`
-    ///   if:
+    /// * `Result<Arc<Collection>>` - Returns the shared `Collection` handle on success, or a
+    ///   `SentinelError` if:
     ///   - The collection directory cannot be created due to permission issues
     ///   - The name contains invalid characters for the filesystem
     ///   - I/O errors occur during directory creation
@@ -197,16 +381,20 @@ impl Store {
     ///
     /// # Notes
     ///
-    /// - Calling this method multiple times with the same name returns separate `Collection`
-    ///   instances pointing to the same directory
+    /// - Calling this method multiple times with the same name returns the same shared
+    ///   `Collection`, so only the first call reads the collection from disk and every caller
+    ///   writes through a single WAL manager
     /// - The `data/` subdirectory is created automatically on first collection access
-    /// - Collections are not cached; each call creates a new `Collection` instance
+    /// - The store closes a collection once no caller has held it for
+    ///   [`COLLECTION_IDLE_TIMEOUT`](crate::COLLECTION_IDLE_TIMEOUT)
     /// - No validation is performed on the collection name beyond filesystem constraints
     #[deprecated(
         since = "2.0.2",
         note = "Please use collection_with_config to specify WAL configuration"
     )]
-    pub async fn collection(&self, name: &str) -> Result<Collection> { collection_with_config(self, name, None).await }
+    pub async fn collection(&self, name: &str) -> Result<Arc<Collection>> {
+        collection_with_config(self, name, None).await
+    }
 
     /// Retrieves or creates a collection with the specified name and custom WAL configuration
     /// overrides.
@@ -216,6 +404,14 @@ impl Store {
     /// exist, it will be created automatically under the `data/` subdirectory of the store's
     /// root path.
     ///
+    /// Collections are opened once and shared: the first call opens the collection and later
+    /// calls return the same handle, avoiding any filesystem access. Calls without overrides
+    /// accept the handle whatever WAL configuration it was opened with. Calls with overrides get
+    /// the shared handle when it already runs the resulting configuration; otherwise the
+    /// collection is reopened with the new configuration if no caller holds it, and a
+    /// `SentinelError::ConfigError` is returned if one does, since a collection only ever has a
+    /// single WAL writer.
+    ///
     /// # Parameters
     ///
     /// * `name` - The name of the collection. This will be used as the directory name under
@@ -224,11 +420,12 @@ impl Store {
     ///
     /// # Returns
     ///
-    /// * `Result<Collection>` - Returns a `Collection` instance on success, or a `SentinelError`
-    ///   if:
+    /// * `Result<Arc<Collection>>` - Returns the shared `Collection` handle on success, or a
+    ///   `SentinelError` if:
     ///   - The collection directory cannot be created due to permission issues
     ///   - The name contains invalid characters for the filesystem
     ///   - I/O errors occur during directory creation
+    ///   - The collection is in use with a WAL configuration the overrides would change
     ///
     /// # Examples
     ///
@@ -259,10 +456,101 @@ impl Store {
         &self,
         name: &str,
         wal_overrides: Option<sentinel_wal::CollectionWalConfigOverrides>,
-    ) -> Result<Collection> {
+    ) -> Result<Arc<Collection>> {
         collection_with_config(self, name, wal_overrides).await
     }
 
+    /// Retrieves or creates a collection whose documents and WAL entries are encrypted at rest.
+    ///
+    /// Document files hold their encoded document inside a binary envelope sealed with
+    /// authenticated encryption, in chunks so large documents are never buffered in their
+    /// encrypted form, and WAL entries are encrypted before they are framed. The WAL of an
+    /// encrypted collection is always written in the `BinaryV2` format. The cipher is the
+    /// encryption algorithm of the global crypto configuration when the store was opened, keyed
+    /// with a key derived for this collection from the data key of the store, once per opening.
+    ///
+    /// Encryption is recorded in the metadata of the collection, so later accesses through
+    /// [`Store::collection_with_config`] keep encrypting it. Files written before the collection
+    /// was encrypted stay readable and are encrypted when they are next rewritten. The secondary
+    /// indexes persisted next to the documents and the runs large sorted queries spill to disk
+    /// are sealed with the same cipher. Document IDs, which name the files, are not encrypted.
+    ///
+    /// # Arguments
+    ///
+    /// * `name` - The name of the collection
+    ///
+    /// # Returns
+    ///
+    /// Returns the shared `Collection` handle, or a `SentinelError::ConfigError` if the store was
+    /// opened without a passphrase, so has no data key, or if the collection is already open
+    /// unencrypted by another caller.
+    ///
+    /// # Examples
+    ///
+    /// ```no_run
+    /// use sentinel_dbms::{Store, StoreWalConfig};
+    /// use serde_json::json;
+    ///
+    /// # async fn example() -> Result<(), Box<dyn std::error::Error>> {
+    /// let store = Store::new_with_config("/var/lib/sentinel", Some("passphrase"), StoreWalConfig::default()).await?;
+    /// let patients = store.encrypted_collection("patients").await?;
+    /// assert!(patients.is_encrypted());
+    ///
+    /// patients.insert("patient-1", json!({"name": "Alice"})).await?;
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub async fn encrypted_collection(&self, name: &str) -> Result<Arc<Collection>> {
+        if self.data_cipher.is_none() {
+            return Err(SentinelError::ConfigError {
+                message: format!(
+                    "cannot encrypt collection '{}', the store was opened without a passphrase",
+                    name
+                ),
+            });
+        }
+        access_collection(self, name, None, true).await
+    }
+
+    /// Closes the shared handle of a collection so the next access reopens it from disk.
+    ///
+    /// The metadata of the collection is saved first. Handles still held by callers stay usable;
+    /// the collection closes once the last of them is dropped.
+    ///
+    /// # Arguments
+    ///
+    /// * `name` - The name of the collection to close
+    ///
+    /// # Returns
+    ///
+    /// Returns whether the collection was open, or a `SentinelError` if its metadata cannot be
+    /// saved.
+    ///
+    /// # Examples
+    ///
+    /// ```rust
+    /// use sentinel_dbms::Store;
+    ///
+    /// # async fn example() -> Result<(), Box<dyn std::error::Error>> {
+    /// let store = Store::new("/path/to/data", None).await?;
+    /// let users = store.collection("users").await?;
+    /// drop(users);
+    ///
+    /// assert!(store.close_collection("users").await?);
+    /// assert!(!store.close_collection("users").await?);
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub async fn close_collection(&self, name: &str) -> Result<bool> {
+        let Some(collection) = self.collections.remove(name)
+        else {
+            return Ok(false);
+        };
+        debug!("Closing collection {}", name);
+        collection.save_metadata().await?;
+        Ok(true)
+    }
+
     /// Deletes a collection and all its documents.
     ///
     /// This method removes the entire collection directory and all documents within it.
@@ -275,7 +563,8 @@ impl Store {
     ///
     /// # Returns
     ///
-    /// Returns `Ok(())` on success, or a `SentinelError` if the operation fails.
+    /// Returns `Ok(())` on success, a `SentinelError::ConfigError` while callers still hold
+    /// handles to the collection, or a `SentinelError` if the operation fails.
     ///
     /// # Examples
     ///
@@ -290,7 +579,8 @@ impl Store {
     ///
     /// // ... use collection ...
     ///
-    /// // Delete the collection
+    /// // Delete the collection once its handles are dropped
+    /// drop(collection);
     /// store.delete_collection("temp_collection").await?;
     /// # Ok(())
     /// # }
@@ -300,6 +590,23 @@ impl Store {
         validate_collection_name(name)?;
         let path = self.root_path.join("data").join(name);
 
+        // No caller may open the collection again while its directory is removed
+        let _opening = self.collections.lock_opening().await;
+        // Close the shared handle first, so its background task does not write into the
+        // directory being removed
+        match self.collections.remove_if_unused(name) {
+            Removal::Removed(collection) => collection.discard(),
+            Removal::NotOpen => {},
+            Removal::InUse => {
+                return Err(SentinelError::ConfigError {
+                    message: format!(
+                        "collection '{}' cannot be deleted while handles to it are in use",
+                        name
+                    ),
+                });
+            },
+        }
+
         // Check if collection exists
         if !path.exists() {
             debug!("Collection '{}' does not exist, nothing to delete", name);
@@ -333,7 +640,9 @@ impl Store {
                 document_count:   metadata.document_count,
                 total_size_bytes: metadata.total_size_bytes,
             };
-            drop(self.event_sender.send(event));
+            if self.event_sender.send(event).await.is_err() {
+                warn!("Failed to send CollectionDeleted event for {}", name);
+            }
         }
 
         Ok(())
@@ -0,0 +1,145 @@
+use std::{
+    collections::HashMap,
+    sync::{Arc, RwLock},
+    time::{Duration, Instant},
+};
+
+use tokio::sync::{Mutex, MutexGuard};
+
+use crate::Collection;
+
+/// A collection opened through the store.
+#[derive(Debug)]
+struct OpenCollection {
+    /// The handle shared by every caller of the collection.
+    collection: Arc<Collection>,
+    /// When the handle was last handed out.
+    last_used:  RwLock<Instant>,
+}
+
+/// What [`CollectionRegistry::remove_if_unused`] found for a collection.
+#[derive(Debug)]
+pub enum Removal {
+    /// The collection was not open.
+    NotOpen,
+    /// The collection was open and unused, and its handle has been unregistered.
+    Removed(Box<Collection>),
+    /// A caller still holds the handle, which stays registered.
+    InUse,
+}
+
+/// The collections currently open in a store.
+///
+/// Each collection is opened once and handed out as a shared [`Arc<Collection>`], so every
+/// caller works on the same metadata, indexes and WAL writer. The registry holds a reference of
+/// its own, which keeps a collection open between callers until it has been idle for a while.
+#[derive(Debug, Default)]
+pub struct CollectionRegistry {
+    /// Open collections keyed by name.
+    open:    RwLock<HashMap<String, OpenCollection>>,
+    /// Held while a collection is being opened, so no collection is ever opened twice.
+    opening: Mutex<()>,
+}
+
+impl CollectionRegistry {
+    /// Returns the open handle of the collection `name`, if any.
+    pub fn get(&self, name: &str) -> Option<Arc<Collection>> {
+        let open = self.open.read().unwrap();
+        let entry = open.get(name)?;
+        *entry.last_used.write().unwrap() = Instant::now();
+        Some(entry.collection.clone())
+    }
+
+    /// Waits until no other collection is being opened.
+    ///
+    /// Callers check [`Self::get`] again once the guard is held, since the collection may have
+    /// been opened while they waited.
+    pub async fn lock_opening(&self) -> MutexGuard<'_, ()> { self.opening.lock().await }
+
+    /// Registers a newly opened collection.
+    pub fn insert(&self, name: &str, collection: Arc<Collection>) {
+        self.open.write().unwrap().insert(
+            name.to_owned(),
+            OpenCollection {
+                collection,
+                last_used: RwLock::new(Instant::now()),
+            },
+        );
+    }
+
+    /// Unregisters the collection `name`, returning its handle if it was open.
+    pub fn remove(&self, name: &str) -> Option<Arc<Collection>> {
+        self.open
+            .write()
+            .unwrap()
+            .remove(name)
+            .map(|entry| entry.collection)
+    }
+
+    /// Unregisters the collection `name` if no caller holds its handle, handing the handle back
+    /// so the caller can close it.
+    pub fn remove_if_unused(&self, name: &str) -> Removal {
+        let mut open = self.open.write().unwrap();
+        match open.get(name) {
+            Some(entry) if Arc::strong_count(&entry.collection) > 1 => Removal::InUse,
+            Some(_) => {
+                let entry = open.remove(name).unwrap();
+                // The registry held the only reference, and no caller can take one meanwhile
+                Arc::try_unwrap(entry.collection).map_or(Removal::InUse, |collection| {
+                    Removal::Removed(Box::new(collection))
+                })
+            },
+            None => Removal::NotOpen,
+        }
+    }
+
+    /// Closes the collections no caller holds that were last handed out more than
+    /// `idle_timeout` ago, returning how many were closed.
+    pub fn evict_idle(&self, idle_timeout: Duration) -> usize {
+        let mut open = self.open.write().unwrap();
+        let before = open.len();
+        open.retain(|_, entry| {
+            Arc::strong_count(&entry.collection) > 1 || entry.last_used.read().unwrap().elapsed() < idle_timeout
+        });
+        before.saturating_sub(open.len())
+    }
+
+    /// Closes every collection, leaving handles still held by callers usable.
+    pub fn clear(&self) { self.open.write().unwrap().clear(); }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::{Store, StoreWalConfig};
+
+    #[tokio::test]
+    async fn test_evict_idle_keeps_collections_in_use() {
+        let temp_dir = tempfile::tempdir().unwrap();
+        let store = Store::new_with_config(temp_dir.path(), None, StoreWalConfig::default())
+            .await
+            .unwrap();
+        let held = store.collection_with_config("held", None).await.unwrap();
+        drop(store.collection_with_config("idle", None).await.unwrap());
+
+        assert_eq!(store.collections.evict_idle(Duration::from_secs(60)), 0);
+        assert_eq!(store.collections.evict_idle(Duration::ZERO), 1);
+        assert!(store.collections.get("idle").is_none());
+        assert!(Arc::ptr_eq(&store.collections.get("held").unwrap(), &held));
+
+        assert!(matches!(
+            store.collections.remove_if_unused("held"),
+            Removal::InUse
+        ));
+        drop(held);
+        assert!(matches!(
+            store.collections.remove_if_unused("held"),
+            Removal::Removed(_)
+        ));
+        assert!(store.collections.get("held").is_none());
+        assert!(matches!(
+            store.collections.remove_if_unused("held"),
+            Removal::NotOpen
+        ));
+    }
+}
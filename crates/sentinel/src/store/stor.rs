@@ -7,8 +7,20 @@ use chrono::{DateTime, Utc};
 use tokio::{fs as tokio_fs, sync::mpsc};
 use tracing::{debug, error, trace};
 
-use crate::{events::StoreEvent, Result, SentinelError, StoreMetadata, KEYS_COLLECTION, STORE_METADATA_FILE};
-use super::{events::start_event_processor, operations::collection_with_config};
+use crate::{
+    events::StoreEvent,
+    metrics::StoreMetrics,
+    BlockingBackend,
+    MetricsSnapshot,
+    Result,
+    SentinelError,
+    StorageBackend,
+    StoreMetadata,
+    KEYS_COLLECTION,
+    STORE_EVENT_QUEUE_CAPACITY,
+    STORE_METADATA_FILE,
+};
+use super::{events::start_event_processor, operations::collection_with_config, registry::CollectionRegistry};
 
 /// The top-level manager for document collections in Cyberpath Sentinel.
 ///
@@ -43,7 +55,8 @@ use super::{events::start_event_processor, operations::collection_with_config};
 /// # Thread Safety
 ///
 /// `Store` is safe to share across threads. Multiple collections can be accessed
-/// concurrently, with each collection managing its own locking internally.
+/// concurrently, with each collection managing its own locking internally. Each collection is
+/// opened once per store and shared by every caller, see [`Store::collection_with_config`].
 #[allow(
     clippy::field_scoped_visibility_modifiers,
     reason = "fields need to be accessible for operations but should not be public API"
@@ -54,6 +67,8 @@ pub struct Store {
     pub(crate) root_path:         PathBuf,
     /// The signing key for the store.
     pub(crate) signing_key:       Option<Arc<sentinel_crypto::SigningKey>>,
+    /// Cipher holding the data key of the store, from which encrypted collections derive theirs.
+    pub(crate) data_cipher:       Option<Arc<sentinel_crypto::EnvelopeCipher>>,
     /// When the store was created.
     pub(crate) created_at:        chrono::DateTime<chrono::Utc>,
     /// When the store was last accessed.
@@ -69,11 +84,17 @@ pub struct Store {
     /// WAL configuration for the store (stored/persisted config).
     pub(crate) stored_wal_config: sentinel_wal::StoreWalConfig,
     /// Channel receiver for events from collections.
-    pub(crate) event_receiver:    Option<mpsc::UnboundedReceiver<StoreEvent>>,
-    /// Channel sender for collections to emit events.
-    pub(crate) event_sender:      mpsc::UnboundedSender<StoreEvent>,
+    pub(crate) event_receiver:    Option<mpsc::Receiver<StoreEvent>>,
+    /// Bounded channel sender for collections to emit events, senders wait while it is full.
+    pub(crate) event_sender:      mpsc::Sender<StoreEvent>,
     /// Background task handle for processing events.
     pub(crate) event_task:        Option<tokio::task::JoinHandle<()>>,
+    /// Collections currently open, shared by every caller accessing them.
+    pub(crate) collections:       Arc<CollectionRegistry>,
+    /// Operation, verification and WAL metrics shared by every collection of the store.
+    pub(crate) metrics:           Arc<StoreMetrics>,
+    /// Storage backend the collections read and write their document files through.
+    pub(crate) storage:           Arc<dyn StorageBackend>,
 }
 
 #[allow(
@@ -164,11 +185,12 @@ impl Store {
         let now = chrono::Utc::now();
 
         // Create event channel for collection synchronization
-        let (event_sender, event_receiver) = mpsc::unbounded_channel();
+        let (event_sender, event_receiver) = mpsc::channel(event_queue_capacity(&store_metadata.wal_config));
 
         let mut store = Self {
             root_path,
             signing_key: None,
+            data_cipher: None,
             created_at: now,
             last_accessed_at: std::sync::RwLock::new(now),
             total_size_bytes: std::sync::Arc::new(std::sync::atomic::AtomicU64::new(
@@ -185,70 +207,12 @@ impl Store {
             event_receiver: Some(event_receiver),
             event_sender,
             event_task: None,
+            collections: Arc::default(),
+            metrics: Arc::default(),
+            storage: Arc::new(BlockingBackend),
         };
         if let Some(passphrase) = passphrase {
-            debug!("Passphrase provided, handling signing key");
-            let keys_collection = collection_with_config(&store, KEYS_COLLECTION, None).await?;
-            if let Some(doc) = keys_collection
-                .get_with_verification("signing_key", &crate::VerificationOptions::disabled())
-                .await?
-            {
-                // Load existing signing key
-                debug!("Loading existing signing key from store");
-                let data = doc.data();
-                let encrypted = data["encrypted"].as_str().ok_or_else(|| {
-                    error!("Stored signing key document missing 'encrypted' field");
-                    SentinelError::StoreCorruption {
-                        reason: "stored signing key document missing 'encrypted' field or not a string".to_owned(),
-                    }
-                })?;
-                let salt_hex = data["salt"].as_str().ok_or_else(|| {
-                    error!("Stored signing key document missing 'salt' field");
-                    SentinelError::StoreCorruption {
-                        reason: "stored signing key document missing 'salt' field or not a string".to_owned(),
-                    }
-                })?;
-                let salt = hex::decode(salt_hex).map_err(|err| {
-                    error!("Stored signing key salt is not valid hex: {}", err);
-                    SentinelError::StoreCorruption {
-                        reason: format!("stored signing key salt is not valid hex ({})", err),
-                    }
-                })?;
-                let encryption_key = sentinel_crypto::derive_key_from_passphrase_with_salt(passphrase, &salt).await?;
-                let key_bytes = sentinel_crypto::decrypt_data(encrypted, &encryption_key).await?;
-                let key_array: [u8; 32] = key_bytes.try_into().map_err(|kb: Vec<u8>| {
-                    error!(
-                        "Stored signing key has invalid length: {}, expected 32",
-                        kb.len()
-                    );
-                    SentinelError::StoreCorruption {
-                        reason: format!(
-                            "stored signing key has an invalid length ({}, expected 32)",
-                            kb.len()
-                        ),
-                    }
-                })?;
-                let signing_key = sentinel_crypto::SigningKey::from_bytes(&key_array);
-                store.signing_key = Some(Arc::new(signing_key));
-                debug!("Existing signing key loaded successfully");
-            }
-            else {
-                // Generate new signing key and salt
-                debug!("Generating new signing key");
-                let (salt, encryption_key) = sentinel_crypto::derive_key_from_passphrase(passphrase).await?;
-                let signing_key = sentinel_crypto::SigningKeyManager::generate_key();
-                let key_bytes = signing_key.to_bytes();
-                let encrypted = sentinel_crypto::encrypt_data(&key_bytes, &encryption_key).await?;
-                let salt_hex = hex::encode(&salt);
-                keys_collection
-                    .insert(
-                        "signing_key",
-                        serde_json::json!({"encrypted": encrypted, "salt": salt_hex}),
-                    )
-                    .await?;
-                store.signing_key = Some(Arc::new(signing_key));
-                debug!("New signing key generated and stored");
-            }
+            load_keys(&mut store, passphrase).await?;
         }
         trace!("Store created successfully");
 
@@ -291,12 +255,63 @@ impl Store {
     /// # Ok(())
     /// # }
     /// ```
-    #[allow(clippy::cognitive_complexity, reason = "complex initialization logic")]
     pub async fn new_with_config<P>(
         root_path: P,
         passphrase: Option<&str>,
         wal_config: sentinel_wal::StoreWalConfig,
     ) -> Result<Self>
+    where
+        P: AsRef<Path>,
+    {
+        Self::new_with_backend(root_path, passphrase, wal_config, Arc::new(BlockingBackend)).await
+    }
+
+    /// Creates a new `Store` instance with custom WAL configuration whose collections read and
+    /// write their document files through `backend`.
+    ///
+    /// [`Store::new_with_config`] uses [`BlockingBackend`], which runs the file system calls of
+    /// each operation in a single blocking task. [`TokioBackend`](crate::TokioBackend) issues
+    /// each call separately through `tokio::fs`, and custom backends can implement
+    /// [`StorageBackend`]. The backend only affects document files; the WAL keeps its own
+    /// buffered file.
+    ///
+    /// # Parameters
+    ///
+    /// * `root_path` - The filesystem path where the store will be created
+    /// * `passphrase` - Optional passphrase for encrypting the signing key
+    /// * `wal_config` - Custom WAL configuration for the store
+    /// * `backend` - Storage backend of the document files
+    ///
+    /// # Returns
+    ///
+    /// Returns a new `Store` instance on success, or a `SentinelError` under the same conditions
+    /// as [`Store::new_with_config`].
+    ///
+    /// # Examples
+    ///
+    /// ```no_run
+    /// use std::sync::Arc;
+    ///
+    /// use sentinel_dbms::{Store, StoreWalConfig, TokioBackend};
+    ///
+    /// # async fn example() -> Result<(), Box<dyn std::error::Error>> {
+    /// let store = Store::new_with_backend(
+    ///     "/var/lib/sentinel",
+    ///     None,
+    ///     StoreWalConfig::default(),
+    ///     Arc::new(TokioBackend),
+    /// )
+    /// .await?;
+    /// # Ok(())
+    /// # }
+    /// ```
+    #[allow(clippy::cognitive_complexity, reason = "complex initialization logic")]
+    pub async fn new_with_backend<P>(
+        root_path: P,
+        passphrase: Option<&str>,
+        wal_config: sentinel_wal::StoreWalConfig,
+        backend: Arc<dyn StorageBackend>,
+    ) -> Result<Self>
     where
         P: AsRef<Path>,
     {
@@ -343,11 +358,12 @@ impl Store {
         let now = chrono::Utc::now();
 
         // Create event channel for collection synchronization
-        let (event_sender, event_receiver) = mpsc::unbounded_channel();
+        let (event_sender, event_receiver) = mpsc::channel(event_queue_capacity(&store_metadata.wal_config));
 
         let mut store = Self {
             root_path,
             signing_key: None,
+            data_cipher: None,
             created_at: now,
             last_accessed_at: std::sync::RwLock::new(now),
             total_size_bytes: std::sync::Arc::new(std::sync::atomic::AtomicU64::new(
@@ -364,70 +380,12 @@ impl Store {
             event_receiver: Some(event_receiver),
             event_sender,
             event_task: None,
+            collections: Arc::default(),
+            metrics: Arc::default(),
+            storage: backend,
         };
         if let Some(passphrase) = passphrase {
-            debug!("Passphrase provided, handling signing key");
-            let keys_collection = collection_with_config(&store, KEYS_COLLECTION, None).await?;
-            if let Some(doc) = keys_collection
-                .get_with_verification("signing_key", &crate::VerificationOptions::disabled())
-                .await?
-            {
-                // Load existing signing key
-                debug!("Loading existing signing key from store");
-                let data = doc.data();
-                let encrypted = data["encrypted"].as_str().ok_or_else(|| {
-                    error!("Stored signing key document missing 'encrypted' field");
-                    SentinelError::StoreCorruption {
-                        reason: "stored signing key document missing 'encrypted' field or not a string".to_owned(),
-                    }
-                })?;
-                let salt_hex = data["salt"].as_str().ok_or_else(|| {
-                    error!("Stored signing key document missing 'salt' field");
-                    SentinelError::StoreCorruption {
-                        reason: "stored signing key document missing 'salt' field or not a string".to_owned(),
-                    }
-                })?;
-                let salt = hex::decode(salt_hex).map_err(|err| {
-                    error!("Stored signing key salt is not valid hex: {}", err);
-                    SentinelError::StoreCorruption {
-                        reason: format!("stored signing key salt is not valid hex ({})", err),
-                    }
-                })?;
-                let encryption_key = sentinel_crypto::derive_key_from_passphrase_with_salt(passphrase, &salt).await?;
-                let key_bytes = sentinel_crypto::decrypt_data(encrypted, &encryption_key).await?;
-                let key_array: [u8; 32] = key_bytes.try_into().map_err(|kb: Vec<u8>| {
-                    error!(
-                        "Stored signing key has invalid length: {}, expected 32",
-                        kb.len()
-                    );
-                    SentinelError::StoreCorruption {
-                        reason: format!(
-                            "stored signing key has an invalid length ({}, expected 32)",
-                            kb.len()
-                        ),
-                    }
-                })?;
-                let signing_key = sentinel_crypto::SigningKey::from_bytes(&key_array);
-                store.signing_key = Some(Arc::new(signing_key));
-                debug!("Existing signing key loaded successfully");
-            }
-            else {
-                // Generate new signing key and salt
-                debug!("Generating new signing key");
-                let (salt, encryption_key) = sentinel_crypto::derive_key_from_passphrase(passphrase).await?;
-                let signing_key = sentinel_crypto::SigningKeyManager::generate_key();
-                let key_bytes = signing_key.to_bytes();
-                let encrypted = sentinel_crypto::encrypt_data(&key_bytes, &encryption_key).await?;
-                let salt_hex = hex::encode(&salt);
-                keys_collection
-                    .insert(
-                        "signing_key",
-                        serde_json::json!({"encrypted": encrypted, "salt": salt_hex}),
-                    )
-                    .await?;
-                store.signing_key = Some(Arc::new(signing_key));
-                debug!("New signing key generated and stored");
-            }
+            load_keys(&mut store, passphrase).await?;
         }
         trace!("Store created successfully");
 
@@ -472,12 +430,144 @@ impl Store {
     /// Returns a reference to the `PathBuf` containing the store's root path.
     pub const fn root_path(&self) -> &PathBuf { &self.root_path }
 
+    /// Returns the metrics recorded since the store was opened.
+    ///
+    /// Latencies are in microseconds and cover every collection of the store. The event queue
+    /// depth is the number of collection events waiting for the background task to apply them.
+    pub fn metrics(&self) -> MetricsSnapshot {
+        let event_queue_depth = self
+            .event_sender
+            .max_capacity()
+            .saturating_sub(self.event_sender.capacity());
+        self.metrics.snapshot(event_queue_depth)
+    }
+
     /// Returns a clone of the event sender for collections to emit events.
     #[allow(
         dead_code,
         reason = "method may be used by external crates or future features"
     )]
-    pub(crate) fn event_sender(&self) -> mpsc::UnboundedSender<StoreEvent> { self.event_sender.clone() }
+    pub(crate) fn event_sender(&self) -> mpsc::Sender<StoreEvent> { self.event_sender.clone() }
+}
+
+/// Returns the capacity of the event queue from collections to the store configured by
+/// `wal_config`, [`STORE_EVENT_QUEUE_CAPACITY`] by default.
+fn event_queue_capacity(wal_config: &sentinel_wal::StoreWalConfig) -> usize {
+    wal_config
+        .event_queue_capacity
+        .unwrap_or(STORE_EVENT_QUEUE_CAPACITY)
+        .max(1)
+}
+
+/// Loads the signing and data keys of the store, creating them when the store has none yet.
+///
+/// Both keys are stored in the keys collection, encrypted with the key derived from `passphrase`
+/// and the salt kept with the signing key, so the slow passphrase derivation runs once per
+/// opening. Encrypted collections derive their own keys from the data key when they are opened.
+async fn load_keys(store: &mut Store, passphrase: &str) -> Result<()> {
+    debug!("Passphrase provided, handling signing and data keys");
+    let keys_collection = collection_with_config(store, KEYS_COLLECTION, None).await?;
+    let encryption_key = if let Some(doc) = keys_collection
+        .get_with_verification("signing_key", &crate::VerificationOptions::disabled())
+        .await?
+    {
+        // Load existing signing key
+        debug!("Loading existing signing key from store");
+        let data = doc.data();
+        let encrypted = data["encrypted"].as_str().ok_or_else(|| {
+            error!("Stored signing key document missing 'encrypted' field");
+            SentinelError::StoreCorruption {
+                reason: "stored signing key document missing 'encrypted' field or not a string".to_owned(),
+            }
+        })?;
+        let salt_hex = data["salt"].as_str().ok_or_else(|| {
+            error!("Stored signing key document missing 'salt' field");
+            SentinelError::StoreCorruption {
+                reason: "stored signing key document missing 'salt' field or not a string".to_owned(),
+            }
+        })?;
+        let salt = hex::decode(salt_hex).map_err(|err| {
+            error!("Stored signing key salt is not valid hex: {}", err);
+            SentinelError::StoreCorruption {
+                reason: format!("stored signing key salt is not valid hex ({})", err),
+            }
+        })?;
+        let encryption_key = sentinel_crypto::derive_key_from_passphrase_with_salt(passphrase, &salt).await?;
+        let key_bytes = sentinel_crypto::decrypt_data(encrypted, &encryption_key).await?;
+        let key_array = stored_key_array("signing", key_bytes)?;
+        let signing_key = sentinel_crypto::SigningKey::from_bytes(&key_array);
+        store.signing_key = Some(Arc::new(signing_key));
+        debug!("Existing signing key loaded successfully");
+        encryption_key
+    }
+    else {
+        // Generate new signing key and salt
+        debug!("Generating new signing key");
+        let (salt, encryption_key) = sentinel_crypto::derive_key_from_passphrase(passphrase).await?;
+        let signing_key = sentinel_crypto::SigningKeyManager::generate_key();
+        let key_bytes = signing_key.to_bytes();
+        let encrypted = sentinel_crypto::encrypt_data(&key_bytes, &encryption_key).await?;
+        let salt_hex = hex::encode(&salt);
+        keys_collection
+            .insert(
+                "signing_key",
+                serde_json::json!({"encrypted": encrypted, "salt": salt_hex}),
+            )
+            .await?;
+        store.signing_key = Some(Arc::new(signing_key));
+        debug!("New signing key generated and stored");
+        encryption_key
+    };
+
+    // Stores created before collections could be encrypted have no data key yet
+    let data_key = if let Some(doc) = keys_collection
+        .get_with_verification("data_key", &crate::VerificationOptions::disabled())
+        .await?
+    {
+        debug!("Loading existing data key from store");
+        let encrypted = doc.data()["encrypted"].as_str().ok_or_else(|| {
+            error!("Stored data key document missing 'encrypted' field");
+            SentinelError::StoreCorruption {
+                reason: "stored data key document missing 'encrypted' field or not a string".to_owned(),
+            }
+        })?;
+        let key_bytes = sentinel_crypto::decrypt_data(encrypted, &encryption_key).await?;
+        stored_key_array("data", key_bytes)?
+    }
+    else {
+        debug!("Generating new data key");
+        let data_key = sentinel_crypto::EncryptionKeyManager::generate_key();
+        let encrypted = sentinel_crypto::encrypt_data(&data_key, &encryption_key).await?;
+        keys_collection
+            .insert("data_key", serde_json::json!({"encrypted": encrypted}))
+            .await?;
+        data_key
+    };
+    let algorithm = sentinel_crypto::get_global_crypto_config()
+        .await?
+        .encryption_algorithm;
+    store.data_cipher = Some(Arc::new(sentinel_crypto::EnvelopeCipher::new(
+        algorithm, &data_key,
+    )));
+    Ok(())
+}
+
+/// Converts the decrypted bytes of the stored `name` key into a key array.
+fn stored_key_array(name: &str, key_bytes: Vec<u8>) -> Result<[u8; 32]> {
+    key_bytes.try_into().map_err(|kb: Vec<u8>| {
+        error!(
+            "Stored {} key has invalid length: {}, expected 32",
+            name,
+            kb.len()
+        );
+        SentinelError::StoreCorruption {
+            reason: format!(
+                "stored {} key has an invalid length ({}, expected 32)",
+                name,
+                kb.len()
+            ),
+        }
+    })
 }
 
 impl Drop for Store {
@@ -488,5 +578,7 @@ impl Drop for Store {
             // We can't await here, but the task will be aborted when the runtime shuts down
             task.abort();
         }
+        // Collections still held by callers stay usable and close once they are dropped
+        self.collections.clear();
     }
 }
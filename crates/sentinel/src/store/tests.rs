@@ -68,6 +68,90 @@ mod tests {
         assert_eq!(coll1.path, coll2.path);
     }
 
+    #[tokio::test]
+    async fn test_store_collection_shares_one_handle() {
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new(temp_dir.path(), None).await.unwrap();
+
+        let coll1 = store.collection("users").await.unwrap();
+        let coll2 = store.collection("users").await.unwrap();
+        assert!(std::sync::Arc::ptr_eq(&coll1, &coll2));
+
+        drop(coll1);
+        drop(coll2);
+        store.delete_collection("users").await.unwrap();
+        assert!(store.collections.get("users").is_none());
+
+        let recreated = store.collection("users").await.unwrap();
+        assert_eq!(recreated.count().await.unwrap(), 0);
+    }
+
+    #[tokio::test]
+    async fn test_reopening_a_collection_keeps_its_statistics() {
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new(temp_dir.path(), None).await.unwrap();
+        let users = store.collection("users").await.unwrap();
+        for i in 0 .. 3 {
+            users
+                .insert(&format!("user-{}", i), serde_json::json!({"i": i}))
+                .await
+                .unwrap();
+        }
+        drop(users);
+
+        // Reopening right away, before the background flush, still loads the new documents
+        let overrides = sentinel_wal::CollectionWalConfigOverrides {
+            max_records_per_file: Some(Some(7)),
+            persist_overrides: false,
+            ..Default::default()
+        };
+        let users = store
+            .collection_with_config("users", Some(overrides))
+            .await
+            .unwrap();
+        assert_eq!(users.total_documents(), 3);
+    }
+
+    #[tokio::test]
+    async fn test_store_metrics_record_operations() {
+        use futures::TryStreamExt as _;
+
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new(temp_dir.path(), None).await.unwrap();
+        let collection = store.collection("users").await.unwrap();
+
+        for (id, age) in [("user-1", 20), ("user-2", 30), ("user-3", 40)] {
+            collection
+                .insert(id, serde_json::json!({ "age": age }))
+                .await
+                .unwrap();
+        }
+        collection.get("user-1").await.unwrap().unwrap();
+        let query = crate::QueryBuilder::new()
+            .filter("age", crate::Operator::GreaterThan, serde_json::json!(25))
+            .build();
+        let documents: Vec<_> = collection
+            .query(query)
+            .await
+            .unwrap()
+            .documents
+            .try_collect()
+            .await
+            .unwrap();
+        assert_eq!(documents.len(), 2);
+
+        let metrics = store.metrics();
+        assert_eq!(metrics.operations.insert.count, 3);
+        assert_eq!(metrics.operations.get.count, 1);
+        assert_eq!(metrics.operations.query.count, 1);
+        assert_eq!(metrics.documents_scanned, 3);
+        assert_eq!(metrics.documents_returned, 2);
+        assert_eq!(metrics.hash_verification.count, 4);
+        assert!(metrics.bytes_read > 0);
+        assert!(metrics.bytes_written > 0);
+        assert_eq!(metrics.wal.entries_written, 3);
+    }
+
     #[tokio::test]
     async fn test_store_collection_invalid_empty_name() {
         let temp_dir = tempdir().unwrap();
@@ -253,6 +337,133 @@ mod tests {
         assert_eq!(key1.to_bytes(), key2.to_bytes());
     }
 
+    #[tokio::test]
+    async fn test_store_encrypted_collection() {
+        use futures::{StreamExt as _, TryStreamExt as _};
+
+        use crate::wal::ops::CollectionWalOps as _;
+
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new_with_config(temp_dir.path(), None, StoreWalConfig::default())
+            .await
+            .unwrap();
+        assert!(matches!(
+            store.encrypted_collection("patients").await,
+            Err(SentinelError::ConfigError { .. })
+        ));
+        drop(store);
+
+        let store = Store::new_with_config(
+            temp_dir.path(),
+            Some("test_passphrase"),
+            StoreWalConfig::default(),
+        )
+        .await
+        .unwrap();
+        let patients = store.encrypted_collection("patients").await.unwrap();
+        assert!(patients.is_encrypted());
+        assert_eq!(
+            patients.wal_config().format,
+            sentinel_wal::WalFormat::BinaryV2
+        );
+        let large = "x".repeat(200 * 1024);
+        patients
+            .insert(
+                "alice",
+                serde_json::json!({"diagnosis": "confidential", "notes": large}),
+            )
+            .await
+            .unwrap();
+        patients
+            .insert("bob", serde_json::json!({"diagnosis": "confidential"}))
+            .await
+            .unwrap();
+        patients
+            .update("bob", serde_json::json!({"diagnosis": "recovered"}))
+            .await
+            .unwrap();
+
+        // Neither the document files nor the WAL hold the plaintext
+        let collection_path = temp_dir.path().join(crate::DATA_DIR).join("patients");
+        let on_disk = std::fs::read(patients.locator().resolve("alice").await).unwrap();
+        assert!(sentinel_crypto::is_envelope(&on_disk));
+        let wal = std::fs::read(collection_path.join(crate::WAL_DIR).join(crate::WAL_FILE)).unwrap();
+        for secret in [b"confidential".as_slice(), b"recovered".as_slice()] {
+            assert!(!on_disk.windows(secret.len()).any(|window| window == secret));
+            assert!(!wal.windows(secret.len()).any(|window| window == secret));
+        }
+
+        let alice = patients.get("alice").await.unwrap().unwrap();
+        assert_eq!(alice.data()["notes"].as_str().unwrap().len(), large.len());
+        let documents: Vec<_> = patients.all().try_collect().await.unwrap();
+        assert_eq!(documents.len(), 2);
+        let mut changes = patients.changes_since(0, 10).await.unwrap();
+        let batch = changes.next().await.unwrap().unwrap();
+        assert_eq!(batch.changes.len(), 3);
+        drop(patients);
+        drop(store);
+
+        // Encryption is persisted, and needs the passphrase
+        let store = Store::new_with_config(temp_dir.path(), None, StoreWalConfig::default())
+            .await
+            .unwrap();
+        assert!(store
+            .collection_with_config("patients", None)
+            .await
+            .is_err());
+        drop(store);
+        let store = Store::new_with_config(
+            temp_dir.path(),
+            Some("test_passphrase"),
+            StoreWalConfig::default(),
+        )
+        .await
+        .unwrap();
+        let patients = store
+            .collection_with_config("patients", None)
+            .await
+            .unwrap();
+        assert!(patients.is_encrypted());
+        let bob = patients.get("bob").await.unwrap().unwrap();
+        assert_eq!(bob.data()["diagnosis"], "recovered");
+    }
+
+    #[tokio::test]
+    async fn test_store_storage_backends() {
+        use std::sync::Arc;
+
+        use futures::TryStreamExt as _;
+
+        let backends: [Arc<dyn crate::StorageBackend>; 2] = [
+            Arc::new(crate::BlockingBackend),
+            Arc::new(crate::TokioBackend),
+        ];
+        for backend in backends {
+            let temp_dir = tempdir().unwrap();
+            let store = Store::new_with_backend(temp_dir.path(), None, StoreWalConfig::default(), backend)
+                .await
+                .unwrap();
+            let users = store.collection_with_config("users", None).await.unwrap();
+            for i in 0 .. 3 {
+                users
+                    .insert(&format!("user-{}", i), serde_json::json!({"i": i}))
+                    .await
+                    .unwrap();
+            }
+            users
+                .update("user-1", serde_json::json!({"i": 10}))
+                .await
+                .unwrap();
+            assert!(users.insert("user-1", serde_json::json!({})).await.is_err());
+
+            let user = users.get("user-1").await.unwrap().unwrap();
+            assert_eq!(user.data()["i"], 10);
+            let documents: Vec<_> = users.all().try_collect().await.unwrap();
+            assert_eq!(documents.len(), 3);
+            assert_eq!(users.count().await.unwrap(), 3);
+        }
+    }
+
     #[tokio::test]
     async fn test_store_new_with_corrupted_keys() {
         let temp_dir = tempdir().unwrap();
@@ -461,13 +672,24 @@ mod tests {
         let store = Store::new(temp_dir.path(), None).await.unwrap();
 
         // Create a collection
-        let _collection = store.collection("test_delete").await.unwrap();
+        let collection = store.collection("test_delete").await.unwrap();
 
         // Verify it exists
         let collections = store.list_collections().await.unwrap();
         assert!(collections.contains(&"test_delete".to_string()));
 
+        // It cannot be deleted while its handle is in use
+        assert!(matches!(
+            store.delete_collection("test_delete").await,
+            Err(SentinelError::ConfigError { .. })
+        ));
+        collection
+            .insert("doc", serde_json::json!({}))
+            .await
+            .unwrap();
+
         // Delete it
+        drop(collection);
         store.delete_collection("test_delete").await.unwrap();
 
         // Verify it's gone
@@ -522,6 +744,28 @@ mod tests {
         assert!(sender.is_closed() == false); // Should be open
     }
 
+    #[tokio::test]
+    async fn test_store_event_queue_capacity_is_configurable() {
+        let temp_dir = tempdir().unwrap();
+        let store = Store::new_with_config(temp_dir.path(), None, StoreWalConfig::default())
+            .await
+            .unwrap();
+        assert_eq!(
+            store.event_sender().max_capacity(),
+            crate::STORE_EVENT_QUEUE_CAPACITY
+        );
+        drop(store);
+
+        let wal_config = StoreWalConfig {
+            event_queue_capacity: Some(16),
+            ..StoreWalConfig::default()
+        };
+        let store = Store::new_with_config(temp_dir.path(), None, wal_config)
+            .await
+            .unwrap();
+        assert_eq!(store.event_sender().max_capacity(), 16);
+    }
+
     #[tokio::test]
     async fn test_store_event_processor_started() {
         let temp_dir = tempdir().unwrap();
@@ -577,7 +821,7 @@ mod tests {
         let event = StoreEvent::CollectionCreated {
             name: "test_collection".to_string(),
         };
-        let _ = store.event_sender.send(event);
+        let _ = store.event_sender.send(event).await;
 
         // Wait a bit for processing
         tokio::time::sleep(tokio::time::Duration::from_millis(600)).await;
@@ -597,7 +841,7 @@ mod tests {
         let create_event = StoreEvent::CollectionCreated {
             name: "test_collection".to_string(),
         };
-        let _ = store.event_sender.send(create_event);
+        let _ = store.event_sender.send(create_event).await;
 
         // Wait for processing
         tokio::time::sleep(tokio::time::Duration::from_millis(200)).await;
@@ -608,7 +852,7 @@ mod tests {
             document_count:   0,
             total_size_bytes: 0,
         };
-        let result = store.event_sender.send(delete_event);
+        let result = store.event_sender.send(delete_event).await;
         assert!(result.is_ok(), "Failed to send CollectionDeleted event");
 
         // Wait a bit for processing
@@ -627,12 +871,13 @@ mod tests {
             .await
             .unwrap();
 
-        // Send a document inserted event
-        let event = StoreEvent::DocumentInserted {
-            collection: "test_collection".to_string(),
-            size_bytes: 256,
+        // Send the statistics of an inserted document
+        let event = StoreEvent::StatsChanged {
+            collection:     "test_collection".to_string(),
+            document_delta: 1,
+            size_delta:     256,
         };
-        let _ = store.event_sender.send(event);
+        let _ = store.event_sender.send(event).await;
 
         // Wait a bit for processing
         tokio::time::sleep(tokio::time::Duration::from_millis(600)).await;
@@ -649,13 +894,13 @@ mod tests {
             .await
             .unwrap();
 
-        // Send a document updated event
-        let event = StoreEvent::DocumentUpdated {
+        // Send the statistics of an updated document
+        let event = StoreEvent::StatsChanged {
             collection:     "test_collection".to_string(),
-            old_size_bytes: 128,
-            new_size_bytes: 256,
+            document_delta: 0,
+            size_delta:     128,
         };
-        let _ = store.event_sender.send(event);
+        let _ = store.event_sender.send(event).await;
 
         // Wait a bit for processing
         tokio::time::sleep(tokio::time::Duration::from_millis(600)).await;
@@ -673,21 +918,23 @@ mod tests {
             .unwrap();
 
         // First add a document
-        let event_insert = StoreEvent::DocumentInserted {
-            collection: "test_collection".to_string(),
-            size_bytes: 256,
+        let event_insert = StoreEvent::StatsChanged {
+            collection:     "test_collection".to_string(),
+            document_delta: 1,
+            size_delta:     256,
         };
-        let _ = store.event_sender.send(event_insert);
+        let _ = store.event_sender.send(event_insert).await;
 
         // Wait for processing
         tokio::time::sleep(tokio::time::Duration::from_millis(600)).await;
 
         // Now delete it
-        let event_delete = StoreEvent::DocumentDeleted {
-            collection: "test_collection".to_string(),
-            size_bytes: 256,
+        let event_delete = StoreEvent::StatsChanged {
+            collection:     "test_collection".to_string(),
+            document_delta: -1,
+            size_delta:     -256,
         };
-        let _ = store.event_sender.send(event_delete);
+        let _ = store.event_sender.send(event_delete).await;
 
         // Wait for processing
         tokio::time::sleep(tokio::time::Duration::from_millis(600)).await;
@@ -734,7 +981,7 @@ mod tests {
         let event = StoreEvent::CollectionCreated {
             name: "test_collection".to_string(),
         };
-        let _ = store.event_sender.send(event);
+        let _ = store.event_sender.send(event).await;
 
         // Wait longer than the save interval (500ms) plus some buffer
         tokio::time::sleep(tokio::time::Duration::from_millis(1200)).await;
@@ -766,7 +1013,7 @@ mod tests {
         let event = StoreEvent::CollectionCreated {
             name: "test_collection".to_string(),
         };
-        let _ = store.event_sender.send(event);
+        let _ = store.event_sender.send(event).await;
 
         // Wait a bit to ensure processing happened
         tokio::time::sleep(tokio::time::Duration::from_millis(100)).await;
@@ -806,7 +1053,7 @@ mod tests {
         let event = StoreEvent::CollectionCreated {
             name: "test_collection".to_string(),
         };
-        let _ = store.event_sender.send(event);
+        let _ = store.event_sender.send(event).await;
 
         // Wait for the save attempt
         tokio::time::sleep(tokio::time::Duration::from_millis(1200)).await;
@@ -6,42 +6,113 @@ use async_stream::stream;
 use futures::Stream;
 use tokio::fs as tokio_fs;
 
-use crate::Result;
+use crate::{
+    layout::{is_shard_dir_name, SHARD_LEVELS},
+    Result,
+};
+
+/// Options controlling how collection scans read and verify documents.
+///
+/// Scans run as a pipeline: up to `concurrency` documents are read, parsed and verified at the
+/// same time on the runtime's worker threads, so full-collection scans scale with the number of
+/// cores.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct ScanOptions {
+    /// Maximum number of documents loaded and verified concurrently.
+    /// Defaults to the available parallelism of the machine.
+    pub concurrency: usize,
+    /// Whether documents are yielded in directory order.
+    /// Unordered scans yield each document as soon as it has been verified.
+    /// Defaults to true.
+    pub ordered:     bool,
+}
+
+impl Default for ScanOptions {
+    fn default() -> Self {
+        Self {
+            concurrency: std::thread::available_parallelism().map_or(4, std::num::NonZeroUsize::get),
+            ordered:     true,
+        }
+    }
+}
+
+impl ScanOptions {
+    /// Create scan options loading one document at a time, in directory order.
+    pub const fn sequential() -> Self {
+        Self {
+            concurrency: 1,
+            ordered:     true,
+        }
+    }
+
+    /// Create scan options with the default concurrency that yield documents as soon as they
+    /// are ready.
+    pub fn unordered() -> Self {
+        Self {
+            ordered: false,
+            ..Self::default()
+        }
+    }
+}
 
 /// Streams document IDs from a collection directory.
+///
+/// Entries are classified with the file type returned by the directory listing, so only
+/// symbolic links need an extra stat to find out what they point to. Shard directories of the
+/// sharded layout are descended into, so IDs are found under either layout, also while a
+/// collection migrates between them.
 pub fn stream_document_ids(collection_path: PathBuf) -> Pin<Box<dyn Stream<Item = Result<String>> + Send>> {
     Box::pin(stream! {
-        let mut entries = match tokio_fs::read_dir(&collection_path).await {
-            Ok(entries) => entries,
-            Err(e) => {
-                yield Err(e.into());
-                return;
-            }
-        };
-
-        loop {
-            let entry = match entries.next_entry().await {
-                Ok(Some(entry)) => entry,
-                Ok(None) => break,
+        let mut pending = vec![(collection_path, 0_usize)];
+        while let Some((dir, depth)) = pending.pop() {
+            let mut entries = match tokio_fs::read_dir(&dir).await {
+                Ok(entries) => entries,
                 Err(e) => {
                     yield Err(e.into());
                     continue;
                 }
             };
 
-            let path = entry.path();
-            let metadata = match tokio_fs::metadata(&path).await {
-                Ok(metadata) => metadata,
-                Err(e) => {
-                    yield Err(e.into());
+            loop {
+                let entry = match entries.next_entry().await {
+                    Ok(Some(entry)) => entry,
+                    Ok(None) => break,
+                    Err(e) => {
+                        yield Err(e.into());
+                        continue;
+                    }
+                };
+
+                let path = entry.path();
+                let is_dir = match entry.file_type().await {
+                    Ok(file_type) if file_type.is_symlink() => {
+                        match tokio_fs::metadata(&path).await {
+                            Ok(metadata) => metadata.is_dir(),
+                            Err(e) => {
+                                yield Err(e.into());
+                                continue;
+                            }
+                        }
+                    }
+                    Ok(file_type) => file_type.is_dir(),
+                    Err(e) => {
+                        yield Err(e.into());
+                        continue;
+                    }
+                };
+                let Some(file_name) = path.file_name().and_then(|n| n.to_str())
+                else {
                     continue;
+                };
+                if is_dir {
+                    if depth < SHARD_LEVELS && is_shard_dir_name(file_name) {
+                        pending.push((path.clone(), depth.saturating_add(1)));
+                    }
+                }
+                else if file_name.ends_with(".json") && !file_name.starts_with('.') {
+                    let id = file_name.strip_suffix(".json").unwrap();
+                    yield Ok(id.to_owned());
                 }
-            };
-            if !metadata.is_dir()
-                && let Some(file_name) = path.file_name().and_then(|n| n.to_str())
-                && file_name.ends_with(".json") && !file_name.starts_with('.') {
-                let id = file_name.strip_suffix(".json").unwrap();
-                yield Ok(id.to_owned());
             }
         }
     })
@@ -111,6 +182,33 @@ mod tests {
         // Error count may be 0 or more depending on platform
     }
 
+    #[tokio::test]
+    async fn test_stream_document_ids_descends_into_shards() {
+        let temp_dir = TempDir::new().unwrap();
+        let collection_path = temp_dir.path().to_path_buf();
+        let shard = collection_path.join("ab").join("cd");
+        tokio_fs::create_dir_all(&shard).await.unwrap();
+        tokio_fs::create_dir_all(collection_path.join("notes"))
+            .await
+            .unwrap();
+        tokio_fs::write(shard.join("sharded.json"), b"{}")
+            .await
+            .unwrap();
+        tokio_fs::write(collection_path.join("flat.json"), b"{}")
+            .await
+            .unwrap();
+        tokio_fs::write(collection_path.join("notes").join("hidden.json"), b"{}")
+            .await
+            .unwrap();
+
+        let mut ids: Vec<String> = stream_document_ids(collection_path)
+            .map(|result| result.unwrap())
+            .collect()
+            .await;
+        ids.sort();
+        assert_eq!(ids, vec!["flat", "sharded"]);
+    }
+
     #[tokio::test]
     async fn test_stream_document_ids_with_invalid_path() {
         // Test with a path that is not a directory to trigger read_dir error
@@ -1,4 +1,9 @@
+use std::{sync::Arc, time::Instant};
+
 use serde::{Deserialize, Serialize};
+use tracing::{error, trace, warn};
+
+use crate::{metrics::StoreMetrics, Document, SentinelError};
 
 /// Verification mode for signature and hash checks.
 ///
@@ -111,6 +116,306 @@ impl VerificationOptions {
     }
 }
 
+/// Everything needed to verify documents, independent of any collection.
+///
+/// A context is built once per read or scan and shared by every document it checks, so
+/// verification only borrows the document and never allocates on success.
+#[derive(Debug, Clone)]
+pub struct VerificationContext {
+    /// The key signatures are checked against, if the collection signs its documents.
+    verifying_key: Option<sentinel_crypto::VerifyingKey>,
+    /// The verification options applied to every document.
+    options:       VerificationOptions,
+    /// The metrics the time spent verifying is recorded into, if any.
+    metrics:       Option<Arc<StoreMetrics>>,
+}
+
+impl VerificationContext {
+    /// Create a verification context from the collection signing key and the options to apply.
+    pub fn new(signing_key: Option<&sentinel_crypto::SigningKey>, options: VerificationOptions) -> Self {
+        Self {
+            verifying_key: signing_key.map(sentinel_crypto::SigningKey::verifying_key),
+            options,
+            metrics: None,
+        }
+    }
+
+    /// Records the time spent verifying hashes and signatures into `metrics`.
+    pub(crate) fn with_metrics(mut self, metrics: Arc<StoreMetrics>) -> Self {
+        self.metrics = Some(metrics);
+        self
+    }
+
+    /// Get the verification options applied by this context.
+    pub const fn options(&self) -> &VerificationOptions { &self.options }
+
+    /// Verifies the document hash according to the hash verification mode.
+    ///
+    /// Returns `Err(SentinelError::HashVerificationFailed)` if verification fails in Strict mode.
+    pub async fn verify_hash(&self, doc: &Document) -> crate::Result<()> { self.verify_hash_with_data(doc, None).await }
+
+    /// Verifies the document hash like [`Self::verify_hash`], hashing `canonical_data` directly
+    /// when the serialized data of the document is at hand.
+    async fn verify_hash_with_data(&self, doc: &Document, canonical_data: Option<&[u8]>) -> crate::Result<()> {
+        if self.options.hash_verification_mode == VerificationMode::Silent {
+            return Ok(());
+        }
+
+        trace!("Verifying hash for document: {}", doc.id());
+        let started = Instant::now();
+        let computed_hash = Self::compute_hash(doc, canonical_data).await?;
+        if let Some(ref metrics) = self.metrics {
+            metrics.record_hash_verification(started);
+        }
+
+        if computed_hash != doc.hash() {
+            let reason = format!(
+                "Expected hash: {}, Computed hash: {}",
+                doc.hash(),
+                computed_hash
+            );
+
+            match self.options.hash_verification_mode {
+                VerificationMode::Strict => {
+                    error!("Document {} hash verification failed: {}", doc.id(), reason);
+                    return Err(SentinelError::HashVerificationFailed {
+                        id: doc.id().to_owned(),
+                        reason,
+                    });
+                },
+                VerificationMode::Warn => {
+                    warn!("Document {} hash verification failed: {}", doc.id(), reason);
+                },
+                VerificationMode::Silent => {},
+            }
+        }
+        else {
+            trace!("Document {} hash verified successfully", doc.id());
+        }
+
+        Ok(())
+    }
+
+    /// Computes the hash of the document data, from `canonical_data` when it matches.
+    ///
+    /// A file edited by hand can hold the right data in a non-canonical form, so a mismatch on
+    /// the raw bytes falls back to hashing the decoded data before the document is reported.
+    async fn compute_hash(doc: &Document, canonical_data: Option<&[u8]>) -> crate::Result<String> {
+        if let Some(bytes) = canonical_data {
+            let hash = sentinel_crypto::hash_bytes(bytes).await?;
+            if hash == doc.hash() {
+                return Ok(hash);
+            }
+            trace!(
+                "Data of document {} is not in canonical form, hashing the decoded data",
+                doc.id()
+            );
+        }
+        Ok(sentinel_crypto::hash_data(doc.data()).await?)
+    }
+
+    /// Verifies the document signature according to the signature verification modes.
+    ///
+    /// Returns `Err(SentinelError::SignatureVerificationFailed)` if verification fails in Strict
+    /// mode.
+    pub async fn verify_signature(&self, doc: &Document) -> crate::Result<()> {
+        if self.options.signature_verification_mode == VerificationMode::Silent &&
+            self.options.empty_signature_mode == VerificationMode::Silent
+        {
+            return Ok(());
+        }
+
+        trace!("Verifying signature for document: {}", doc.id());
+
+        if doc.signature().is_empty() {
+            return self.check_empty_signature(doc);
+        }
+
+        if !self.options.verify_signature {
+            trace!("Signature verification disabled for document: {}", doc.id());
+            return Ok(());
+        }
+
+        if let Some(ref public_key) = self.verifying_key {
+            let started = Instant::now();
+            let is_valid = sentinel_crypto::verify_signature(doc.hash(), doc.signature(), public_key).await?;
+            if let Some(ref metrics) = self.metrics {
+                metrics.record_signature_verification(started);
+            }
+            self.apply_signature_result(doc, is_valid)?;
+        }
+        else {
+            trace!("No signing key available for verification, skipping signature check");
+        }
+
+        Ok(())
+    }
+
+    /// Verifies the signatures of a batch of documents whose other checks were done by
+    /// [`Self::verify_document_except_signature`].
+    ///
+    /// All signatures are checked with one batch verification. When the batch is rejected the
+    /// documents with an invalid signature are singled out, so every entry gets the same result
+    /// [`Self::verify_document`] would give it. Entries that are already errors pass through
+    /// unchanged, which lets a scan hand over a chunk of its stream as is.
+    pub async fn verify_signatures(&self, docs: Vec<crate::Result<Document>>) -> Vec<crate::Result<Document>> {
+        let Some(ref public_key) = self.verifying_key
+        else {
+            return docs;
+        };
+        if !self.options.verify_signature ||
+            (self.options.signature_verification_mode == VerificationMode::Silent &&
+                self.options.empty_signature_mode == VerificationMode::Silent)
+        {
+            return docs;
+        }
+
+        let items: Vec<(&str, &str)> = docs
+            .iter()
+            .filter_map(|result| result.as_ref().ok())
+            .filter(|doc| !doc.signature().is_empty())
+            .map(|doc| (doc.hash(), doc.signature()))
+            .collect();
+        if items.is_empty() {
+            return docs;
+        }
+        trace!(
+            "Verifying signatures of {} documents as a batch",
+            items.len()
+        );
+        let started = Instant::now();
+        let batch = sentinel_crypto::verify_signatures(&items, public_key).await;
+        if let Some(ref metrics) = self.metrics {
+            metrics.record_signature_verification(started);
+        }
+
+        let mut results = match batch {
+            Ok(results) => results.into_iter(),
+            Err(e) => {
+                let operation = e.to_string();
+                return docs
+                    .into_iter()
+                    .map(|result| {
+                        result.and_then(|doc| {
+                            if doc.signature().is_empty() {
+                                Ok(doc)
+                            }
+                            else {
+                                Err(SentinelError::CryptoFailed {
+                                    operation: operation.clone(),
+                                })
+                            }
+                        })
+                    })
+                    .collect();
+            },
+        };
+        docs.into_iter()
+            .map(|result| {
+                let doc = result?;
+                if doc.signature().is_empty() {
+                    return Ok(doc);
+                }
+                let is_valid = results.next().unwrap_or(Ok(false))?;
+                self.apply_signature_result(&doc, is_valid)?;
+                Ok(doc)
+            })
+            .collect()
+    }
+
+    /// Applies the signature verification mode to the outcome of a signature check.
+    fn apply_signature_result(&self, doc: &Document, is_valid: bool) -> crate::Result<()> {
+        if is_valid {
+            trace!("Document {} signature verified successfully", doc.id());
+            return Ok(());
+        }
+
+        let reason = "Signature verification using public key failed".to_owned();
+        match self.options.signature_verification_mode {
+            VerificationMode::Strict => {
+                error!(
+                    "Document {} signature verification failed: {}",
+                    doc.id(),
+                    reason
+                );
+                Err(SentinelError::SignatureVerificationFailed {
+                    id: doc.id().to_owned(),
+                    reason,
+                })
+            },
+            VerificationMode::Warn => {
+                warn!(
+                    "Document {} signature verification failed: {}",
+                    doc.id(),
+                    reason
+                );
+                Ok(())
+            },
+            VerificationMode::Silent => Ok(()),
+        }
+    }
+
+    /// Verifies both hash and signature of a document according to the options.
+    ///
+    /// Returns an error if a verification fails in Strict mode.
+    pub async fn verify_document(&self, doc: &Document) -> crate::Result<()> {
+        self.verify_document_with_data(doc, None).await
+    }
+
+    /// Verifies a document read from a file like [`Self::verify_document`], hashing
+    /// `canonical_data`, the serialized data of a compact file, instead of
+    /// re-serializing the decoded data when the file provides it.
+    ///
+    /// Returns an error if a verification fails in Strict mode.
+    pub async fn verify_document_with_data(&self, doc: &Document, canonical_data: Option<&[u8]>) -> crate::Result<()> {
+        self.verify_document_except_signature(doc, canonical_data)
+            .await?;
+        if !doc.signature().is_empty() && self.options.verify_signature {
+            self.verify_signature(doc).await?;
+        }
+        Ok(())
+    }
+
+    /// Runs every check of [`Self::verify_document_with_data`] except the verification of a
+    /// present signature, which [`Self::verify_signatures`] then does for a whole batch.
+    pub async fn verify_document_except_signature(
+        &self,
+        doc: &Document,
+        canonical_data: Option<&[u8]>,
+    ) -> crate::Result<()> {
+        if self.options.verify_hash {
+            self.verify_hash_with_data(doc, canonical_data).await?;
+        }
+
+        // Check for empty signature regardless of verify_signature option
+        if doc.signature().is_empty() {
+            self.check_empty_signature(doc)?;
+        }
+        Ok(())
+    }
+
+    /// Applies the empty signature mode to a document without a signature.
+    fn check_empty_signature(&self, doc: &Document) -> crate::Result<()> {
+        let reason = "Document has no signature";
+
+        match self.options.empty_signature_mode {
+            VerificationMode::Strict => {
+                error!("Document {} has no signature: {}", doc.id(), reason);
+                return Err(SentinelError::SignatureVerificationFailed {
+                    id:     doc.id().to_owned(),
+                    reason: reason.to_owned(),
+                });
+            },
+            VerificationMode::Warn => {
+                warn!("Document {} has no signature: {}", doc.id(), reason);
+            },
+            VerificationMode::Silent => {},
+        }
+
+        Ok(())
+    }
+}
+
 #[cfg(test)]
 mod tests {
     use std::str::FromStr;
@@ -184,4 +489,77 @@ mod tests {
         assert_eq!(opts.empty_signature_mode, VerificationMode::Warn);
         assert_eq!(opts.hash_verification_mode, VerificationMode::Warn);
     }
+
+    #[tokio::test]
+    async fn test_verification_context_without_key() {
+        let doc = Document::new_without_signature("doc".to_owned(), serde_json::json!({"a": 1}))
+            .await
+            .unwrap();
+
+        let strict = VerificationContext::new(None, VerificationOptions::strict());
+        assert!(matches!(
+            strict.verify_document(&doc).await,
+            Err(SentinelError::SignatureVerificationFailed { .. })
+        ));
+
+        let lenient = VerificationContext::new(None, VerificationOptions::default());
+        assert!(lenient.verify_document(&doc).await.is_ok());
+        assert_eq!(lenient.options(), &VerificationOptions::default());
+    }
+
+    #[tokio::test]
+    async fn test_verification_context_hash_mismatch() {
+        let key = sentinel_crypto::SigningKeyManager::generate_key();
+        let mut doc = Document::new("doc".to_owned(), serde_json::json!({"a": 1}), &key)
+            .await
+            .unwrap();
+        doc.data = serde_json::json!({"a": 2});
+
+        let context = VerificationContext::new(Some(&key), VerificationOptions::strict());
+        assert!(matches!(
+            context.verify_document(&doc).await,
+            Err(SentinelError::HashVerificationFailed { .. })
+        ));
+        assert!(context.verify_signature(&doc).await.is_ok());
+    }
+
+    #[tokio::test]
+    async fn test_verify_signatures_singles_out_bad_documents() {
+        let key = sentinel_crypto::SigningKeyManager::generate_key();
+        let mut docs = Vec::new();
+        for i in 0 .. 10 {
+            let doc = Document::new(format!("doc-{}", i), serde_json::json!({"i": i}), &key)
+                .await
+                .unwrap();
+            docs.push(doc);
+        }
+        docs[4].signature = docs[5].signature.clone();
+        let mut batch: Vec<crate::Result<Document>> = docs.into_iter().map(Ok).collect();
+        batch.push(Err(SentinelError::Internal {
+            message: "read failed".to_owned(),
+        }));
+
+        let context = VerificationContext::new(Some(&key), VerificationOptions::strict());
+        let results = context.verify_signatures(batch).await;
+        assert_eq!(results.len(), 11);
+        for (i, result) in results.iter().enumerate() {
+            match i {
+                4 => {
+                    assert!(matches!(
+                        *result,
+                        Err(SentinelError::SignatureVerificationFailed { .. })
+                    ))
+                },
+                10 => assert!(matches!(*result, Err(SentinelError::Internal { .. }))),
+                _ => assert!(result.is_ok()),
+            }
+        }
+
+        let warn = VerificationContext::new(Some(&key), VerificationOptions::warn());
+        let mut doc = Document::new("doc".to_owned(), serde_json::json!({"a": 1}), &key)
+            .await
+            .unwrap();
+        doc.hash = "tampered".to_owned();
+        assert!(warn.verify_signatures(vec![Ok(doc)]).await[0].is_ok());
+    }
 }
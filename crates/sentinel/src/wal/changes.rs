@@ -0,0 +1,202 @@
+//! Change feed across the collections of a store.
+//!
+//! Every collection has its own WAL and therefore its own LSN sequence, so the position of a
+//! store-wide feed is a [`ChangeCursor`] holding the last LSN delivered for each collection.
+//! [`StoreWalOps::changes_since`](crate::wal::ops::StoreWalOps::changes_since) reads the
+//! collections one after the other, in name order, and every [`ChangeBatch`] it yields carries
+//! the cursor to persist once the batch has been applied.
+//!
+//! Changes are read from the committed entries of the WAL, across rotated and compressed
+//! segments, with the delivery guarantees described in [`sentinel_wal::changes`]: delivery is at
+//! least once, and changes already retired by a checkpoint are only available when the WAL keeps
+//! its segments ([`WalRetention::Keep`](crate::WalRetention::Keep)).
+//!
+//! # Examples
+//!
+//! ```rust,no_run
+//! # use sentinel_dbms::Store;
+//! # use futures::StreamExt;
+//! # async fn example() -> Result<(), Box<dyn std::error::Error>> {
+//! # let store = Store::new("/tmp/store", None).await?;
+//! use sentinel_dbms::wal::{
+//!     changes::{ChangeCursor, ChangeFeedOptions},
+//!     ops::StoreWalOps,
+//! };
+//!
+//! let mut cursor: ChangeCursor = "users:0".parse()?;
+//! let mut changes = store
+//!     .changes_since(&cursor, &ChangeFeedOptions::default())
+//!     .await?;
+//! while let Some(batch) = changes.next().await {
+//!     let batch = batch?;
+//!     for change in &batch.changes {
+//!         println!(
+//!             "{} {:?} {}",
+//!             change.lsn, change.operation, change.document_id
+//!         );
+//!     }
+//!     cursor = batch.cursor;
+//! }
+//! println!("Resume with --since {}", cursor);
+//! # Ok(())
+//! # }
+//! ```
+
+use std::{collections::BTreeMap, fmt, str::FromStr};
+
+use serde::{Deserialize, Serialize};
+use serde_json::Value;
+use sentinel_wal::{EntryType, WalChange};
+
+use crate::{constants::CHANGE_FEED_BATCH_SIZE, SentinelError};
+
+/// Position of a change feed, as the last LSN delivered for each collection.
+///
+/// Collections the cursor does not mention are read from their first retained change. The text
+/// form lists `collection:lsn` pairs separated by commas, such as `orders:17,users:42`.
+#[derive(Debug, Clone, Default, PartialEq, Eq, Serialize, Deserialize)]
+pub struct ChangeCursor {
+    /// Last LSN delivered, by collection name
+    positions: BTreeMap<String, u64>,
+}
+
+impl ChangeCursor {
+    /// Create a cursor reading every collection from its first retained change.
+    pub fn new() -> Self { Self::default() }
+
+    /// Get the last LSN delivered for `collection`, 0 if none was.
+    pub fn position(&self, collection: &str) -> u64 { self.positions.get(collection).copied().unwrap_or(0) }
+
+    /// Record that every change of `collection` up to `lsn` was delivered.
+    pub fn set_position(&mut self, collection: &str, lsn: u64) { self.positions.insert(collection.to_owned(), lsn); }
+
+    /// Iterate over the collections and positions of the cursor, in name order.
+    pub fn positions(&self) -> impl Iterator<Item = (&str, u64)> {
+        self.positions
+            .iter()
+            .map(|(collection, &lsn)| (collection.as_str(), lsn))
+    }
+}
+
+impl fmt::Display for ChangeCursor {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        for (index, (collection, lsn)) in self.positions().enumerate() {
+            if index > 0 {
+                f.write_str(",")?;
+            }
+            write!(f, "{}:{}", collection, lsn)?;
+        }
+        Ok(())
+    }
+}
+
+impl FromStr for ChangeCursor {
+    type Err = SentinelError;
+
+    fn from_str(s: &str) -> Result<Self, Self::Err> {
+        let mut cursor = Self::new();
+        for pair in s.split(',').map(str::trim).filter(|pair| !pair.is_empty()) {
+            let parsed = pair
+                .rsplit_once(':')
+                .and_then(|(collection, lsn)| Some((collection, lsn.parse::<u64>().ok()?)))
+                .filter(|&(collection, _)| !collection.is_empty());
+            let Some((collection, lsn)) = parsed
+            else {
+                return Err(SentinelError::ConfigError {
+                    message: format!(
+                        "Invalid change cursor entry '{}', expected collection:lsn",
+                        pair
+                    ),
+                });
+            };
+            cursor.set_position(collection, lsn);
+        }
+        Ok(cursor)
+    }
+}
+
+/// A committed change to a document, read from the WAL of its collection.
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+pub struct Change {
+    /// Name of the collection
+    pub collection:     String,
+    /// LSN of the change in the WAL of the collection
+    pub lsn:            u64,
+    /// Kind of change, an insert, update or delete
+    pub operation:      EntryType,
+    /// ID of the document changed
+    pub document_id:    String,
+    /// ID of the transaction that logged the change
+    pub transaction_id: String,
+    /// Time the change was logged, in milliseconds since the Unix epoch
+    pub timestamp:      u64,
+    /// Document data for inserts and updates
+    pub data:           Option<Value>,
+}
+
+impl Change {
+    /// Build a change from an entry read from the WAL of `collection`
+    pub(crate) fn from_wal(collection: &str, change: &WalChange) -> crate::Result<Self> {
+        Ok(Self {
+            collection:     collection.to_owned(),
+            lsn:            change.lsn,
+            operation:      change.entry.entry_type,
+            document_id:    change.entry.document_id_str().to_owned(),
+            transaction_id: change.entry.transaction_id_str().to_owned(),
+            timestamp:      change.entry.timestamp,
+            data:           change.entry.data_as_value()?,
+        })
+    }
+}
+
+/// A batch of changes of one collection.
+#[derive(Debug, Clone, PartialEq, Serialize, Deserialize)]
+pub struct ChangeBatch {
+    /// Name of the collection the changes belong to
+    pub collection: String,
+    /// The changes, in commit order
+    pub changes:    Vec<Change>,
+    /// Cursor to resume the feed from once the batch has been applied
+    pub cursor:     ChangeCursor,
+}
+
+/// Options of a change feed.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct ChangeFeedOptions {
+    /// Collections to read, every collection of the store when `None`
+    pub collections: Option<Vec<String>>,
+    /// Maximum number of changes per batch
+    pub batch_size:  usize,
+}
+
+impl Default for ChangeFeedOptions {
+    fn default() -> Self {
+        Self {
+            collections: None,
+            batch_size:  CHANGE_FEED_BATCH_SIZE,
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_change_cursor_round_trips_through_text() {
+        let cursor: ChangeCursor = "users:42, orders:17,".parse().unwrap();
+        assert_eq!(cursor.position("users"), 42);
+        assert_eq!(cursor.position("orders"), 17);
+        assert_eq!(cursor.position("missing"), 0);
+        assert_eq!(cursor.to_string(), "orders:17,users:42");
+        assert_eq!(cursor.to_string().parse::<ChangeCursor>().unwrap(), cursor);
+        assert_eq!("".parse::<ChangeCursor>().unwrap(), ChangeCursor::new());
+    }
+
+    #[test]
+    fn test_change_cursor_rejects_malformed_entries() {
+        for text in ["users", "users:", ":3", "users:-1", "users:abc"] {
+            assert!(text.parse::<ChangeCursor>().is_err(), "{}", text);
+        }
+    }
+}
@@ -1,7 +1,8 @@
 //! WAL (Write-Ahead Logging) functionality for Sentinel DBMS.
 //!
 //! This module provides comprehensive WAL operations including configuration,
-//! verification, recovery, and streaming capabilities. The WAL ensures data
+//! verification, recovery, streaming and change feed capabilities. The WAL ensures data
 //! durability and enables crash recovery for the filesystem-backed database.
 
+pub mod changes;
 pub mod ops;
@@ -17,6 +17,8 @@
 //! - **Recovery**: Replays WAL entries to restore data consistency after a crash
 //! - **Verification**: Validates WAL integrity and consistency with the main data store
 //! - **Streaming**: Provides real-time access to WAL entries for monitoring and replication
+//! - **Change feed**: Streams the committed changes after a cursor, across rotated and compressed
+//!   segments, for followers that apply only the deltas (see [`changes`](crate::wal::changes))
 //!
 //! # Examples
 //!
@@ -86,6 +88,7 @@
 
 use std::{collections::HashMap, pin::Pin};
 
+use async_stream::stream;
 use async_trait::async_trait;
 use futures::{Stream, StreamExt as _};
 use tracing::{debug, error, info, warn};
@@ -93,12 +96,21 @@ use sentinel_wal::{
     recover_from_wal_safe,
     verify_wal_consistency,
     LogEntry,
+    WalChangeBatch,
     WalRecoveryResult,
+    WalSegments,
     WalVerificationIssue,
     WalVerificationResult,
 };
 
-use crate::{store::operations::collection_with_config, Collection, Store};
+use crate::{
+    constants::COLLECTION_RECOVERY_CONCURRENCY,
+    store::operations::collection_with_config,
+    wal::changes::{Change, ChangeBatch, ChangeCursor, ChangeFeedOptions},
+    Collection,
+    SentinelError,
+    Store,
+};
 
 /// Extension trait for Store to add WAL operations.
 ///
@@ -213,6 +225,8 @@ pub trait StoreWalOps {
     ///
     /// Performs crash recovery on all collections by replaying WAL entries.
     /// This is typically called during store initialization after an unclean shutdown.
+    /// Collections are recovered concurrently; if any of them fails, the first error is returned
+    /// once the others have finished.
     ///
     /// # Returns
     ///
@@ -238,6 +252,52 @@ pub trait StoreWalOps {
     /// # }
     /// ```
     async fn recover_all_collections(&self) -> crate::Result<HashMap<String, usize>>;
+
+    /// Stream the committed changes of the store after `cursor`.
+    ///
+    /// Collections are read one after the other in name order, each from its position in the
+    /// cursor, and only the collections listed in `options` when it lists any. Every batch holds
+    /// changes of a single collection and carries the cursor to resume from once it has been
+    /// applied; the stream ends once every collection has been read up to its last entry.
+    ///
+    /// # Returns
+    ///
+    /// Returns a stream of change batches, or an error if a listed collection does not exist.
+    /// Reading a collection whose position precedes its retained segments yields
+    /// `SentinelError::Wal` with `WalError::LsnUnavailable`.
+    ///
+    /// # Examples
+    ///
+    /// ```rust,no_run
+    /// # use sentinel_dbms::Store;
+    /// # async fn example() -> Result<(), Box<dyn std::error::Error>> {
+    /// # let store = Store::new("/tmp/store", None).await?;
+    /// use sentinel_dbms::{
+    ///     wal::ops::StoreWalOps,
+    ///     ChangeCursor,
+    ///     ChangeFeedOptions,
+    /// };
+    /// use futures::StreamExt;
+    ///
+    /// let options = ChangeFeedOptions {
+    ///     collections: Some(vec!["users".to_string()]),
+    ///     ..Default::default()
+    /// };
+    /// let mut cursor = ChangeCursor::new();
+    /// let mut changes = store.changes_since(&cursor, &options).await?;
+    /// while let Some(batch) = changes.next().await {
+    ///     let batch = batch?;
+    ///     println!("{} changes in {}", batch.changes.len(), batch.collection);
+    ///     cursor = batch.cursor;
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    async fn changes_since(
+        &self,
+        cursor: &ChangeCursor,
+        options: &ChangeFeedOptions,
+    ) -> crate::Result<Pin<Box<dyn Stream<Item = crate::Result<ChangeBatch>> + Send>>>;
 }
 
 /// Extension trait for Collection to add WAL operations.
@@ -252,8 +312,12 @@ pub trait StoreWalOps {
 pub trait CollectionWalOps {
     /// Perform a checkpoint on this collection's WAL.
     ///
-    /// Flushes all pending WAL entries to the main data store and truncates the WAL file.
-    /// This operation ensures durability and can help manage WAL file size.
+    /// Waits for the document writes in progress, syncs the document files changed since the
+    /// previous checkpoint to disk, then records the checkpoint at the last entry those writes
+    /// logged and retires the segments it covers. Recovery no longer replays the covered
+    /// entries, so they must not be lost with the page cache. Writes logged while the files are
+    /// synced stay after the checkpoint. This operation ensures durability and can help manage
+    /// WAL file size.
     ///
     /// # Returns
     ///
@@ -310,7 +374,7 @@ pub trait CollectionWalOps {
     /// # Ok(())
     /// # }
     /// ```
-    async fn stream_wal_entries(self) -> crate::Result<Pin<Box<dyn Stream<Item = crate::Result<LogEntry>> + Send>>>;
+    async fn stream_wal_entries(&self) -> crate::Result<Pin<Box<dyn Stream<Item = crate::Result<LogEntry>> + Send>>>;
 
     /// Verify this collection against its WAL file.
     ///
@@ -350,7 +414,8 @@ pub trait CollectionWalOps {
     ///
     /// Replays WAL entries to restore the collection to a consistent state after
     /// a crash or unclean shutdown. This operation is safe and will not overwrite
-    /// newer data.
+    /// newer data. Secondary indexes are brought back in sync for every document
+    /// referenced by the WAL.
     ///
     /// # Returns
     ///
@@ -443,6 +508,75 @@ pub trait CollectionWalOps {
     /// # }
     /// ```
     async fn wal_entries_count(&self) -> crate::Result<usize>;
+
+    /// Open the segments of this collection's WAL for zero-copy reading.
+    ///
+    /// Segments are loaded one at a time, oldest first, and their entries are decoded as
+    /// borrowed views instead of owned `LogEntry` values. This is the cheapest way to scan a
+    /// large WAL.
+    ///
+    /// # Returns
+    ///
+    /// Returns the segment reader, which yields no segments if no WAL is configured.
+    ///
+    /// # Examples
+    ///
+    /// ```rust,no_run
+    /// # use sentinel_dbms::{Store, Collection};
+    /// # async fn example() -> Result<(), Box<dyn std::error::Error>> {
+    /// # let store = Store::new("/tmp/store", None).await?;
+    /// # let collection = store.collection_with_config("users", None).await?;
+    /// use sentinel_dbms::wal::ops::CollectionWalOps;
+    ///
+    /// let mut segments = collection.wal_segments().await?;
+    /// while let Some(segment) = segments.next_segment().await {
+    ///     for entry in segment?.entries() {
+    ///         println!("{:?} {}", entry.entry_type, entry.document_id_str());
+    ///     }
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    async fn wal_segments(&self) -> crate::Result<WalSegments>;
+
+    /// Stream the committed changes of this collection after LSN `lsn`.
+    ///
+    /// Unlike [`stream_wal_entries`](CollectionWalOps::stream_wal_entries), the feed reads the
+    /// rotated and compressed segments as well as the current file, skips transaction markers
+    /// and uncommitted or rolled back changes, and delivers batches of up to `batch_size` changes
+    /// that carry the LSN to resume from.
+    ///
+    /// # Returns
+    ///
+    /// Returns a stream of change batches, empty if no WAL is configured.
+    ///
+    /// # Examples
+    ///
+    /// ```rust,no_run
+    /// # use sentinel_dbms::{Store, Collection};
+    /// # async fn example() -> Result<(), Box<dyn std::error::Error>> {
+    /// # let store = Store::new("/tmp/store", None).await?;
+    /// # let collection = store.collection_with_config("users", None).await?;
+    /// use sentinel_dbms::wal::ops::CollectionWalOps;
+    /// use futures::StreamExt;
+    ///
+    /// let mut lsn = 0;
+    /// let mut changes = collection.changes_since(lsn, 100).await?;
+    /// while let Some(batch) = changes.next().await {
+    ///     let batch = batch?;
+    ///     for change in &batch.changes {
+    ///         println!("{} {:?}", change.lsn, change.entry.entry_type);
+    ///     }
+    ///     lsn = batch.cursor;
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    async fn changes_since(
+        &self,
+        lsn: u64,
+        batch_size: usize,
+    ) -> crate::Result<Pin<Box<dyn Stream<Item = crate::Result<WalChangeBatch>> + Send>>>;
 }
 
 #[async_trait]
@@ -454,7 +588,7 @@ impl StoreWalOps for Store {
         for collection_name in collections {
             debug!("Checkpointing collection: {}", collection_name);
             let collection = collection_with_config(self, &collection_name, None).await?;
-            CollectionWalOps::checkpoint_wal(&collection).await?;
+            CollectionWalOps::checkpoint_wal(&*collection).await?;
         }
 
         info!("Checkpoint completed for all collections");
@@ -482,7 +616,7 @@ impl StoreWalOps for Store {
         let stream_of_streams = futures::stream::iter(collections).filter_map(|collection| {
             async move {
                 let name = collection.name().to_owned();
-                CollectionWalOps::stream_wal_entries(collection)
+                CollectionWalOps::stream_wal_entries(&*collection)
                     .await
                     .map_or_else(
                         |_| None,
@@ -508,7 +642,7 @@ impl StoreWalOps for Store {
         for collection_name in collections {
             debug!("Verifying collection: {}", collection_name);
             let collection = collection_with_config(self, &collection_name, None).await?;
-            match CollectionWalOps::verify_against_wal(&collection).await {
+            match CollectionWalOps::verify_against_wal(&*collection).await {
                 Ok(verification_result) => {
                     if !verification_result.issues.is_empty() {
                         let issue_count = verification_result.issues.len();
@@ -564,11 +698,26 @@ impl StoreWalOps for Store {
 
         let mut results = HashMap::new();
         let mut total_operations: usize = 0;
+        let mut first_error = None;
+
+        let store = self;
+        let mut recoveries = futures::stream::iter(collections)
+            .map(|collection_name| {
+                async move {
+                    debug!("Recovering collection: {}", collection_name);
+                    let result = match collection_with_config(store, &collection_name, None).await {
+                        Ok(collection) => CollectionWalOps::recover_from_wal(&*collection).await,
+                        Err(e) => Err(e),
+                    };
+                    (collection_name, result)
+                }
+            })
+            .buffer_unordered(COLLECTION_RECOVERY_CONCURRENCY);
 
-        for collection_name in collections {
-            debug!("Recovering collection: {}", collection_name);
-            let collection = collection_with_config(self, &collection_name, None).await?;
-            match CollectionWalOps::recover_from_wal(&collection).await {
+        // Let every started recovery finish before reporting a failure, so no collection is
+        // left half-replayed
+        while let Some((collection_name, result)) = recoveries.next().await {
+            match result {
                 Ok(recovery_result) => {
                     let operations = recovery_result.recovered_operations;
                     results.insert(collection_name.clone(), operations);
@@ -587,10 +736,13 @@ impl StoreWalOps for Store {
                 },
                 Err(e) => {
                     error!("Failed to recover collection {}: {}", collection_name, e);
-                    return Err(e);
+                    first_error.get_or_insert(e);
                 },
             }
         }
+        if let Some(e) = first_error {
+            return Err(e);
+        }
 
         info!(
             "WAL recovery completed - {} total operations recovered across {} collections",
@@ -599,6 +751,72 @@ impl StoreWalOps for Store {
         );
         Ok(results)
     }
+
+    async fn changes_since(
+        &self,
+        cursor: &ChangeCursor,
+        options: &ChangeFeedOptions,
+    ) -> crate::Result<Pin<Box<dyn Stream<Item = crate::Result<ChangeBatch>> + Send>>> {
+        let mut names = self.list_collections().await?;
+        if let Some(wanted) = options.collections.as_ref() {
+            if let Some(missing) = wanted.iter().find(|name| !names.contains(name)) {
+                return Err(SentinelError::CollectionNotFound {
+                    name: missing.clone(),
+                });
+            }
+            names.retain(|name| wanted.contains(name));
+        }
+        names.sort_unstable();
+        debug!(
+            "Streaming changes of {} collections from {}",
+            names.len(),
+            cursor
+        );
+
+        let mut collections = Vec::with_capacity(names.len());
+        for name in names {
+            collections.push(collection_with_config(self, &name, None).await?);
+        }
+
+        let mut cursor = cursor.clone();
+        let batch_size = options.batch_size;
+        Ok(Box::pin(stream! {
+            for collection in collections {
+                let name = collection.name().to_owned();
+                let mut batches =
+                    match CollectionWalOps::changes_since(&*collection, cursor.position(&name), batch_size).await {
+                        Ok(batches) => batches,
+                        Err(e) => {
+                            yield Err(e);
+                            return;
+                        },
+                    };
+                while let Some(batch) = batches.next().await {
+                    let changes = batch.and_then(|batch| {
+                        cursor.set_position(&name, batch.cursor);
+                        batch
+                            .changes
+                            .iter()
+                            .map(|change| Change::from_wal(&name, change))
+                            .collect::<crate::Result<Vec<_>>>()
+                    });
+                    match changes {
+                        Ok(changes) => {
+                            yield Ok(ChangeBatch {
+                                collection: name.clone(),
+                                changes,
+                                cursor: cursor.clone(),
+                            });
+                        },
+                        Err(e) => {
+                            yield Err(e);
+                            return;
+                        },
+                    }
+                }
+            }
+        }))
+    }
 }
 
 #[async_trait]
@@ -606,7 +824,28 @@ impl CollectionWalOps for Collection {
     async fn checkpoint_wal(&self) -> crate::Result<()> {
         if let Some(wal) = self.wal_manager.as_ref() {
             debug!("Starting WAL checkpoint for collection {}", self.name());
-            wal.checkpoint().await?;
+            // Writers log their entry and write the file under their document lock, so with every
+            // lock held each logged change has reached its file
+            let (covered_lsn, unsynced) = {
+                let _locks = self.locks.lock_all().await;
+                (wal.last_lsn(), self.files.take_unsynced())
+            };
+            let paths = match self.unsynced_paths(&unsynced).await {
+                Ok(paths) => paths,
+                Err(e) => {
+                    self.files.restore_unsynced(unsynced);
+                    return Err(e);
+                },
+            };
+            debug!(
+                "Syncing {} document files and directories before the checkpoint",
+                paths.len()
+            );
+            if let Err(e) = self.files.sync(paths).await {
+                self.files.restore_unsynced(unsynced);
+                return Err(e);
+            }
+            wal.checkpoint_through(covered_lsn).await?;
             info!("WAL checkpoint completed for collection {}", self.name());
         }
         else {
@@ -615,7 +854,7 @@ impl CollectionWalOps for Collection {
         Ok(())
     }
 
-    async fn stream_wal_entries(self) -> crate::Result<Pin<Box<dyn Stream<Item = crate::Result<LogEntry>> + Send>>> {
+    async fn stream_wal_entries(&self) -> crate::Result<Pin<Box<dyn Stream<Item = crate::Result<LogEntry>> + Send>>> {
         self.wal_manager.as_ref().map_or_else(
             || {
                 debug!(
@@ -686,6 +925,7 @@ impl CollectionWalOps for Collection {
         if let Some(wal) = self.wal_manager.as_ref() {
             info!("Starting WAL recovery for collection {}", self.name());
             let result = recover_from_wal_safe(wal, self).await?;
+            self.rebuild_indexes_from_wal().await?;
             info!(
                 "WAL recovery completed for collection {}: {} operations recovered, {} skipped, {} failed",
                 self.name(),
@@ -743,6 +983,42 @@ impl CollectionWalOps for Collection {
             Ok(0)
         }
     }
+
+    async fn wal_segments(&self) -> crate::Result<WalSegments> {
+        if let Some(wal) = self.wal_manager.as_ref() {
+            debug!("Opening WAL segments for collection {}", self.name());
+            Ok(wal.segments().await?)
+        }
+        else {
+            debug!("No WAL manager configured for collection {}", self.name());
+            Ok(WalSegments::default())
+        }
+    }
+
+    async fn changes_since(
+        &self,
+        lsn: u64,
+        batch_size: usize,
+    ) -> crate::Result<Pin<Box<dyn Stream<Item = crate::Result<WalChangeBatch>> + Send>>> {
+        if let Some(wal) = self.wal_manager.as_ref() {
+            debug!(
+                "Streaming changes of collection {} after LSN {}",
+                self.name(),
+                lsn
+            );
+            let changes = wal
+                .changes_since(lsn, batch_size)
+                .await?
+                .map(|batch| batch.map_err(crate::error::SentinelError::from));
+            Ok(Box::pin(changes))
+        }
+        else {
+            debug!("No WAL manager configured for collection {}", self.name());
+            Ok(Box::pin(futures::stream::empty::<
+                crate::Result<WalChangeBatch>,
+            >()))
+        }
+    }
 }
 
 #[cfg(test)]
@@ -1475,6 +1751,45 @@ mod tests {
         assert_eq!(doc.unwrap().data()["value"], 42);
     }
 
+    #[tokio::test]
+    async fn test_checkpoint_wal_syncs_changed_files_first() {
+        let (_temp_dir, store, collection_name) = create_test_store_with_collection().await;
+        let collection = collection_with_config(&store, &collection_name, None)
+            .await
+            .unwrap();
+        collection
+            .insert("doc-1", serde_json::json!({"value": 1}))
+            .await
+            .unwrap();
+        collection.delete("doc-1").await.unwrap();
+        collection
+            .insert("doc-2", serde_json::json!({"value": 2}))
+            .await
+            .unwrap();
+
+        // The files, the directory entries and the deleted copy are all tracked
+        let unsynced = collection.files.take_unsynced();
+        assert!(unsynced.paths.contains(&collection.locator().path("doc-2")));
+        assert!(unsynced.paths.contains(&collection.path));
+        assert!(unsynced.paths.contains(&collection.path.join(".deleted")));
+        collection.files.restore_unsynced(unsynced);
+
+        // A write in progress holds the checkpoint back
+        let lock = collection.locks.lock("doc-3").await;
+        let checkpoint = {
+            let collection = collection.clone();
+            tokio::spawn(async move { collection.checkpoint_wal().await })
+        };
+        tokio::time::sleep(std::time::Duration::from_millis(20)).await;
+        assert!(!checkpoint.is_finished());
+        drop(lock);
+        checkpoint.await.unwrap().unwrap();
+
+        let wal = collection.wal_manager.as_ref().unwrap();
+        assert_eq!(wal.checkpoint_lsn().await, wal.last_lsn());
+        assert!(collection.files.take_unsynced().paths.is_empty());
+    }
+
     #[tokio::test]
     async fn test_wal_ops_stream_all_with_mixed_collections() {
         // Test stream_all_wal_entries with collections that have different WAL states
@@ -1514,4 +1829,108 @@ mod tests {
 
         assert_eq!(collections.len(), 3);
     }
+
+    #[tokio::test]
+    async fn test_changes_since_follows_collections_with_a_cursor() {
+        let (_temp_dir, store, _collection_name) = create_test_store_with_collection().await;
+        let users = collection_with_config(&store, "users", None).await.unwrap();
+        users
+            .insert("alice", serde_json::json!({"age": 30}))
+            .await
+            .unwrap();
+        users
+            .update("alice", serde_json::json!({"age": 31}))
+            .await
+            .unwrap();
+        let orders = collection_with_config(&store, "orders", None)
+            .await
+            .unwrap();
+        orders
+            .bulk_insert(vec![
+                ("order-1", serde_json::json!({"total": 10})),
+                ("order-2", serde_json::json!({"total": 20})),
+            ])
+            .await
+            .unwrap();
+        users.delete("alice").await.unwrap();
+
+        let options = ChangeFeedOptions {
+            collections: Some(vec!["users".to_string(), "orders".to_string()]),
+            batch_size:  2,
+        };
+        let batches: Vec<ChangeBatch> = store
+            .changes_since(&ChangeCursor::new(), &options)
+            .await
+            .unwrap()
+            .map(|batch| batch.unwrap())
+            .collect()
+            .await;
+
+        let changes: Vec<(&str, sentinel_wal::EntryType, &str)> = batches
+            .iter()
+            .flat_map(|batch| batch.changes.iter())
+            .map(|change| {
+                (
+                    change.collection.as_str(),
+                    change.operation,
+                    change.document_id.as_str(),
+                )
+            })
+            .collect();
+        assert_eq!(
+            changes,
+            [
+                ("orders", sentinel_wal::EntryType::Insert, "order-1"),
+                ("orders", sentinel_wal::EntryType::Insert, "order-2"),
+                ("users", sentinel_wal::EntryType::Insert, "alice"),
+                ("users", sentinel_wal::EntryType::Update, "alice"),
+                ("users", sentinel_wal::EntryType::Delete, "alice"),
+            ]
+        );
+        assert!(batches.iter().all(|batch| batch.changes.len() <= 2));
+        assert_eq!(
+            batches[0].changes[0].data,
+            Some(serde_json::json!({"total": 10}))
+        );
+
+        // Resuming from the last cursor delivers nothing until something changes
+        let cursor = batches.last().unwrap().cursor.clone();
+        assert!(cursor.position("users") > 0 && cursor.position("orders") > 0);
+        let resumed: Vec<_> = store
+            .changes_since(&cursor, &options)
+            .await
+            .unwrap()
+            .collect()
+            .await;
+        assert!(resumed.is_empty());
+
+        orders.delete("order-1").await.unwrap();
+        let resumed: Vec<_> = store
+            .changes_since(&cursor, &options)
+            .await
+            .unwrap()
+            .map(|batch| batch.unwrap())
+            .collect()
+            .await;
+        assert_eq!(resumed.len(), 1);
+        assert_eq!(resumed[0].changes[0].document_id, "order-1");
+        assert_eq!(
+            resumed[0].cursor.position("users"),
+            cursor.position("users")
+        );
+    }
+
+    #[tokio::test]
+    async fn test_changes_since_rejects_unknown_collections() {
+        let (_temp_dir, store, _collection_name) = create_test_store_with_collection().await;
+        let options = ChangeFeedOptions {
+            collections: Some(vec!["missing".to_string()]),
+            ..Default::default()
+        };
+        let result = store.changes_since(&ChangeCursor::new(), &options).await;
+        assert!(matches!(
+            result,
+            Err(SentinelError::CollectionNotFound { .. })
+        ));
+    }
 }